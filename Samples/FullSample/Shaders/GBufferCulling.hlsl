@@ -0,0 +1,75 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma pack_matrix(row_major)
+
+#include <donut/shaders/bindless.h>
+#include "ShaderParameters.h"
+
+// Culls the G-buffer draw records against the view frustum and appends the visible ones to two lists of
+// indirect draw arguments, opaque first, then alpha-tested, each with room for all records.
+// The arguments buffer is cleared before this pass, so the unused draws at the end of each list are empty.
+// CullGBufferDrawRecords in GBufferDrawCulling.cpp is the CPU reference for this shader.
+
+ConstantBuffer<GBufferCullingConstants> g_Const : register(b0);
+
+StructuredBuffer<GBufferDrawRecord> t_DrawRecords : register(t0);
+StructuredBuffer<InstanceData> t_InstanceData : register(t1);
+
+RWBuffer<uint> u_DrawArguments : register(u0);  // DrawIndirectArguments, 4 uints each
+RWBuffer<uint> u_DrawCounts : register(u1);     // opaque, alpha-tested
+
+bool IsDrawRecordVisible(GBufferDrawRecord record, float3x4 transform)
+{
+    if (record.flags & GBUFFER_DRAW_NEVER_CULL)
+        return true;
+
+    // World space box around the transformed object space box
+    const float3 center = (record.boundsMin + record.boundsMax) * 0.5;
+    const float3 extent = (record.boundsMax - record.boundsMin) * 0.5;
+    const float3 worldCenter = mul(transform, float4(center, 1.0));
+    const float3 worldExtent = mul(abs(transform), float4(extent, 0.0));
+
+    for (uint planeIndex = 0; planeIndex < 6; planeIndex++)
+    {
+        const float4 plane = g_Const.frustumPlanes[planeIndex];
+        if (dot(plane.xyz, worldCenter) - dot(abs(plane.xyz), worldExtent) > plane.w)
+            return false;
+    }
+
+    return true;
+}
+
+[numthreads(GBUFFER_CULLING_GROUP_SIZE, 1, 1)]
+void main(uint recordIndex : SV_DispatchThreadID)
+{
+    if (recordIndex >= g_Const.recordCount)
+        return;
+
+    const GBufferDrawRecord record = t_DrawRecords[recordIndex];
+    const bool alphaTested = (record.flags & GBUFFER_DRAW_ALPHA_TESTED) != 0;
+
+    if (alphaTested && !g_Const.enableAlphaTestedGeometry)
+        return;
+
+    if (!IsDrawRecordVisible(record, t_InstanceData[record.instanceIndex].transform))
+        return;
+
+    const uint list = alphaTested ? 1 : 0;
+    uint slot;
+    InterlockedAdd(u_DrawCounts[list], 1, slot);
+
+    // The record index is passed to the vertex shader through the instance-rate DRAW_INDEX attribute
+    const uint argumentsOffset = (list * g_Const.recordCount + slot) * 4;
+    u_DrawArguments[argumentsOffset + 0] = record.indexCount;   // vertexCount
+    u_DrawArguments[argumentsOffset + 1] = 1;                   // instanceCount
+    u_DrawArguments[argumentsOffset + 2] = 0;                   // startVertexLocation
+    u_DrawArguments[argumentsOffset + 3] = recordIndex;         // startInstanceLocation
+}
@@ -0,0 +1,44 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#ifndef GBUFFER_DRAW_RECORD_H
+#define GBUFFER_DRAW_RECORD_H
+
+#define GBUFFER_DRAW_ALPHA_TESTED 0x01  // drawn with the alpha-tested pipeline
+#define GBUFFER_DRAW_NEVER_CULL 0x02    // the object space bounds are not valid, e.g. for skinned meshes
+
+#define GBUFFER_CULLING_GROUP_SIZE 64
+
+// One draw of the rasterized G-buffer pass: a geometry of a mesh instance.
+// The records are created when the scene is loaded and culled on the GPU every frame.
+struct GBufferDrawRecord
+{
+    uint instanceIndex;
+    uint geometryIndex;
+    uint indexCount;
+    uint flags;
+
+    float3 boundsMin;       // object space
+    uint pad0;
+    float3 boundsMax;
+    uint pad1;
+};
+
+struct GBufferCullingConstants
+{
+    float4 frustumPlanes[6];    // xyz = normal, w = distance; a point is outside when dot(normal, point) > distance
+
+    uint recordCount;
+    uint enableAlphaTestedGeometry;
+    uint pad0;
+    uint pad1;
+};
+
+#endif // GBUFFER_DRAW_RECORD_H
@@ -30,6 +30,7 @@ void RayGen()
     uint2 GlobalIndex = DispatchRaysIndex().xy;
 #endif
     uint2 pixelPosition = RTXDI_ReservoirPosToPixelPos(GlobalIndex, g_Const.runtimeParams.activeCheckerboardField);
+    SetRayCountPixelPosition(pixelPosition);
 
     RAB_Surface surface = RAB_GetGBufferSurface(pixelPosition, false);
 
@@ -165,6 +166,7 @@ void RayGen()
     if (g_PerPassConstants.rayCountBufferIndex >= 0)
     {
         InterlockedAdd(u_RayCountBuffer[RAY_COUNT_TRACED(g_PerPassConstants.rayCountBufferIndex)], 1);
+        ReportRayCountTile(false);
     }
 
     uint gbufferIndex = RTXDI_ReservoirPositionToPointer(g_Const.restirGI.reservoirBufferParams, GlobalIndex, 0);
@@ -189,6 +191,7 @@ void RayGen()
         if (g_PerPassConstants.rayCountBufferIndex >= 0)
         {
             InterlockedAdd(u_RayCountBuffer[RAY_COUNT_HITS(g_PerPassConstants.rayCountBufferIndex)], 1);
+            ReportRayCountTile(true);
         }
 
         GeometrySample gs = getGeometryFromHit(
@@ -16,6 +16,7 @@
 #endif
 
 #include "../RtxdiApplicationBridge/RtxdiApplicationBridge.hlsli"
+#include "../ResamplingSpecialization.hlsli"
 
 #include <Rtxdi/DI/BoilingFilter.hlsli>
 #include <Rtxdi/DI/InitialSampling.hlsli>
@@ -38,6 +39,7 @@ void RayGen()
     const RTXDI_RuntimeParameters params = g_Const.runtimeParams;
 
     uint2 pixelPosition = RTXDI_ReservoirPosToPixelPos(GlobalIndex, params.activeCheckerboardField);
+    SetRayCountPixelPosition(pixelPosition);
 
     RAB_RandomSamplerState rng = RAB_InitRandomSampler(pixelPosition, 1);
     RAB_RandomSamplerState tileRng = RAB_InitRandomSampler(pixelPosition / RTXDI_TILE_SIZE_IN_PIXELS, 1);
@@ -54,7 +56,7 @@ void RayGen()
 
     RAB_LightSample lightSample;
     RTXDI_DIReservoir reservoir = RTXDI_SampleLightsForSurface(rng, tileRng, surface,
-        sampleParams, g_Const.lightBufferParams, g_Const.restirDI.initialSamplingParams.localLightSamplingMode,
+        sampleParams, g_Const.lightBufferParams, DI_LOCAL_LIGHT_SAMPLING_MODE,
 #ifdef RTXDI_ENABLE_PRESAMPLING
         g_Const.localLightsRISBufferSegmentParams, g_Const.environmentLightRISBufferSegmentParams,
 #endif
@@ -84,7 +86,7 @@ void RayGen()
     stparams.screenSpaceMotion = motionVector;
     stparams.sourceBufferIndex = g_Const.restirDI.bufferIndices.temporalResamplingInputBufferIndex;
     stparams.maxHistoryLength = g_Const.restirDI.temporalResamplingParams.maxHistoryLength;
-    stparams.biasCorrectionMode = g_Const.restirDI.temporalResamplingParams.temporalBiasCorrection;
+    stparams.biasCorrectionMode = DI_TEMPORAL_BIAS_CORRECTION;
     stparams.depthThreshold = g_Const.restirDI.temporalResamplingParams.temporalDepthThreshold;
     stparams.normalThreshold = g_Const.restirDI.temporalResamplingParams.temporalNormalThreshold;
     stparams.numSamples = g_Const.restirDI.spatialResamplingParams.numSpatialSamples + 1;
@@ -102,7 +104,7 @@ void RayGen()
     u_TemporalSamplePositions[GlobalIndex] = temporalSamplePixelPos;
 
 #ifdef RTXDI_ENABLE_BOILING_FILTER
-    if (g_Const.restirDI.temporalResamplingParams.enableBoilingFilter)
+    if (DI_BOILING_FILTER)
     {
         RTXDI_BoilingFilter(LocalIndex, g_Const.restirDI.temporalResamplingParams.boilingFilterStrength, reservoir);
     }
@@ -31,6 +31,7 @@ void RayGen()
     const RTXDI_RuntimeParameters params = g_Const.runtimeParams;
 
     uint2 pixelPosition = RTXDI_ReservoirPosToPixelPos(GlobalIndex, params.activeCheckerboardField);
+    SetRayCountPixelPosition(pixelPosition);
 
     RAB_Surface surface = RAB_GetGBufferSurface(pixelPosition, false);
 
@@ -11,6 +11,7 @@
 #pragma pack_matrix(row_major)
 
 #include "../RtxdiApplicationBridge/RtxdiApplicationBridge.hlsli"
+#include "../ResamplingSpecialization.hlsli"
 
 #include <Rtxdi/DI/SpatialResampling.hlsli>
 
@@ -29,6 +30,7 @@ void RayGen()
     const RTXDI_RuntimeParameters params = g_Const.runtimeParams;
 
     uint2 pixelPosition = RTXDI_ReservoirPosToPixelPos(GlobalIndex, params.activeCheckerboardField);
+    SetRayCountPixelPosition(pixelPosition);
 
     RAB_RandomSamplerState rng = RAB_InitRandomSampler(pixelPosition, 3);
 
@@ -46,7 +48,7 @@ void RayGen()
         sparams.numSamples = g_Const.restirDI.spatialResamplingParams.numSpatialSamples;
         sparams.numDisocclusionBoostSamples = g_Const.restirDI.spatialResamplingParams.numDisocclusionBoostSamples;
         sparams.targetHistoryLength = g_Const.restirDI.temporalResamplingParams.maxHistoryLength;
-        sparams.biasCorrectionMode = g_Const.restirDI.spatialResamplingParams.spatialBiasCorrection;
+        sparams.biasCorrectionMode = DI_SPATIAL_BIAS_CORRECTION;
         sparams.samplingRadius = g_Const.restirDI.spatialResamplingParams.spatialSamplingRadius;
         sparams.depthThreshold = g_Const.restirDI.spatialResamplingParams.spatialDepthThreshold;
         sparams.normalThreshold = g_Const.restirDI.spatialResamplingParams.spatialNormalThreshold;
@@ -17,6 +17,7 @@
 #endif
 
 #include "../RtxdiApplicationBridge/RtxdiApplicationBridge.hlsli"
+#include "../ResamplingSpecialization.hlsli"
 
 #include <Rtxdi/DI/BoilingFilter.hlsli>
 #include <Rtxdi/DI/TemporalResampling.hlsli>
@@ -36,6 +37,7 @@ void RayGen()
     const RTXDI_RuntimeParameters params = g_Const.runtimeParams;
 
     uint2 pixelPosition = RTXDI_ReservoirPosToPixelPos(GlobalIndex, params.activeCheckerboardField);
+    SetRayCountPixelPosition(pixelPosition);
 
     RAB_RandomSamplerState rng = RAB_InitRandomSampler(pixelPosition, 2);
 
@@ -63,10 +65,10 @@ void RayGen()
         tparams.screenSpaceMotion = motionVector;
         tparams.sourceBufferIndex = g_Const.restirDI.bufferIndices.temporalResamplingInputBufferIndex;
         tparams.maxHistoryLength = g_Const.restirDI.temporalResamplingParams.maxHistoryLength;
-        tparams.biasCorrectionMode = g_Const.restirDI.temporalResamplingParams.temporalBiasCorrection;
+        tparams.biasCorrectionMode = DI_TEMPORAL_BIAS_CORRECTION;
         tparams.depthThreshold = g_Const.restirDI.temporalResamplingParams.temporalDepthThreshold;
         tparams.normalThreshold = g_Const.restirDI.temporalResamplingParams.temporalNormalThreshold;
-        tparams.enableVisibilityShortcut = g_Const.restirDI.temporalResamplingParams.discardInvisibleSamples;
+        tparams.enableVisibilityShortcut = DI_DISCARD_INVISIBLE_SAMPLES;
         tparams.enablePermutationSampling = usePermutationSampling;
         tparams.uniformRandomNumber = g_Const.restirDI.temporalResamplingParams.uniformRandomNumber;
 
@@ -77,7 +79,7 @@ void RayGen()
     }
 
 #ifdef RTXDI_ENABLE_BOILING_FILTER
-    if (g_Const.restirDI.temporalResamplingParams.enableBoilingFilter)
+    if (DI_BOILING_FILTER)
     {
         RTXDI_BoilingFilter(LocalIndex, g_Const.restirDI.temporalResamplingParams.boilingFilterStrength, temporalResult);
     }
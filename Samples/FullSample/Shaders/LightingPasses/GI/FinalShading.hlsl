@@ -58,6 +58,7 @@ void RayGen()
     uint2 GlobalIndex = DispatchRaysIndex().xy;
 #endif
     uint2 pixelPosition = RTXDI_ReservoirPosToPixelPos(GlobalIndex, g_Const.runtimeParams.activeCheckerboardField);
+    SetRayCountPixelPosition(pixelPosition);
 
     if (any(pixelPosition > int2(g_Const.view.viewportSize)))
         return;
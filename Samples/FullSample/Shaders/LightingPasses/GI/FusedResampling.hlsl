@@ -16,6 +16,7 @@
 #endif
 
 #include "../RtxdiApplicationBridge/RtxdiApplicationBridge.hlsli"
+#include "../ResamplingSpecialization.hlsli"
 
 #include <Rtxdi/GI/BoilingFilter.hlsli>
 #include <Rtxdi/GI/SpatioTemporalResampling.hlsli>
@@ -32,6 +33,7 @@ void RayGen()
     uint2 GlobalIndex = DispatchRaysIndex().xy;
 #endif
     uint2 pixelPosition = RTXDI_ReservoirPosToPixelPos(GlobalIndex, g_Const.runtimeParams.activeCheckerboardField);
+    SetRayCountPixelPosition(pixelPosition);
 
     RAB_RandomSamplerState rng = RAB_InitRandomSampler(GlobalIndex, 7);
     
@@ -49,7 +51,7 @@ void RayGen()
         stParams.screenSpaceMotion = motionVector;
         stParams.sourceBufferIndex = g_Const.restirGI.bufferIndices.temporalResamplingInputBufferIndex;
         stParams.maxHistoryLength = g_Const.restirGI.temporalResamplingParams.maxHistoryLength;
-        stParams.biasCorrectionMode = g_Const.restirGI.temporalResamplingParams.temporalBiasCorrectionMode;
+        stParams.biasCorrectionMode = GI_TEMPORAL_BIAS_CORRECTION;
         stParams.depthThreshold = g_Const.restirGI.temporalResamplingParams.depthThreshold;
         stParams.normalThreshold = g_Const.restirGI.temporalResamplingParams.normalThreshold;
         stParams.enablePermutationSampling = g_Const.restirGI.temporalResamplingParams.enablePermutationSampling;
@@ -67,7 +69,7 @@ void RayGen()
     }
 
 #ifdef RTXDI_ENABLE_BOILING_FILTER
-    if (g_Const.restirGI.temporalResamplingParams.enableBoilingFilter)
+    if (GI_BOILING_FILTER)
     {
         RTXDI_GIBoilingFilter(LocalIndex, g_Const.restirGI.temporalResamplingParams.boilingFilterStrength, reservoir);
     }
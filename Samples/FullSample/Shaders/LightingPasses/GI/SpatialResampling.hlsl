@@ -11,6 +11,7 @@
 #pragma pack_matrix(row_major)
 
 #include "../RtxdiApplicationBridge/RtxdiApplicationBridge.hlsli"
+#include "../ResamplingSpecialization.hlsli"
 
 #include <Rtxdi/GI/SpatialResampling.hlsli>
 
@@ -26,6 +27,7 @@ void RayGen()
     uint2 GlobalIndex = DispatchRaysIndex().xy;
 #endif
     uint2 pixelPosition = RTXDI_ReservoirPosToPixelPos(GlobalIndex, g_Const.runtimeParams.activeCheckerboardField);
+    SetRayCountPixelPosition(pixelPosition);
 
     if (any(pixelPosition > int2(g_Const.view.viewportSize)))
         return;
@@ -41,7 +43,7 @@ void RayGen()
         RTXDI_GISpatialResamplingParameters sparams;
 
         sparams.sourceBufferIndex = g_Const.restirGI.bufferIndices.spatialResamplingInputBufferIndex;
-        sparams.biasCorrectionMode = g_Const.restirGI.spatialResamplingParams.spatialBiasCorrectionMode;
+        sparams.biasCorrectionMode = GI_SPATIAL_BIAS_CORRECTION;
         sparams.depthThreshold = g_Const.restirGI.spatialResamplingParams.spatialDepthThreshold;
         sparams.normalThreshold = g_Const.restirGI.spatialResamplingParams.spatialNormalThreshold;
         sparams.numSamples = g_Const.restirGI.spatialResamplingParams.numSpatialSamples;
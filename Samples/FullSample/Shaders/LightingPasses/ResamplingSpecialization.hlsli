@@ -0,0 +1,67 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#ifndef RESAMPLING_SPECIALIZATION_HLSLI
+#define RESAMPLING_SPECIALIZATION_HLSLI
+
+// The resampling settings that select code paths. A specialized permutation defines them as
+// compile-time constants (see ResamplingSpecialization.h), so that the branches on them are removed,
+// the generic permutation reads them from the constant buffer.
+// Include after the application bridge, which declares g_Const.
+
+#ifdef SPECIALIZE_DI_LOCAL_LIGHT_SAMPLING_MODE
+#define DI_LOCAL_LIGHT_SAMPLING_MODE SPECIALIZE_DI_LOCAL_LIGHT_SAMPLING_MODE
+#else
+#define DI_LOCAL_LIGHT_SAMPLING_MODE g_Const.restirDI.initialSamplingParams.localLightSamplingMode
+#endif
+
+#ifdef SPECIALIZE_DI_TEMPORAL_BIAS_CORRECTION
+#define DI_TEMPORAL_BIAS_CORRECTION SPECIALIZE_DI_TEMPORAL_BIAS_CORRECTION
+#else
+#define DI_TEMPORAL_BIAS_CORRECTION g_Const.restirDI.temporalResamplingParams.temporalBiasCorrection
+#endif
+
+#ifdef SPECIALIZE_DI_SPATIAL_BIAS_CORRECTION
+#define DI_SPATIAL_BIAS_CORRECTION SPECIALIZE_DI_SPATIAL_BIAS_CORRECTION
+#else
+#define DI_SPATIAL_BIAS_CORRECTION g_Const.restirDI.spatialResamplingParams.spatialBiasCorrection
+#endif
+
+#ifdef SPECIALIZE_DI_BOILING_FILTER
+#define DI_BOILING_FILTER SPECIALIZE_DI_BOILING_FILTER
+#else
+#define DI_BOILING_FILTER g_Const.restirDI.temporalResamplingParams.enableBoilingFilter
+#endif
+
+#ifdef SPECIALIZE_DI_DISCARD_INVISIBLE_SAMPLES
+#define DI_DISCARD_INVISIBLE_SAMPLES SPECIALIZE_DI_DISCARD_INVISIBLE_SAMPLES
+#else
+#define DI_DISCARD_INVISIBLE_SAMPLES g_Const.restirDI.temporalResamplingParams.discardInvisibleSamples
+#endif
+
+#ifdef SPECIALIZE_GI_TEMPORAL_BIAS_CORRECTION
+#define GI_TEMPORAL_BIAS_CORRECTION SPECIALIZE_GI_TEMPORAL_BIAS_CORRECTION
+#else
+#define GI_TEMPORAL_BIAS_CORRECTION g_Const.restirGI.temporalResamplingParams.temporalBiasCorrectionMode
+#endif
+
+#ifdef SPECIALIZE_GI_SPATIAL_BIAS_CORRECTION
+#define GI_SPATIAL_BIAS_CORRECTION SPECIALIZE_GI_SPATIAL_BIAS_CORRECTION
+#else
+#define GI_SPATIAL_BIAS_CORRECTION g_Const.restirGI.spatialResamplingParams.spatialBiasCorrectionMode
+#endif
+
+#ifdef SPECIALIZE_GI_BOILING_FILTER
+#define GI_BOILING_FILTER SPECIALIZE_GI_BOILING_FILTER
+#else
+#define GI_BOILING_FILTER g_Const.restirGI.temporalResamplingParams.enableBoilingFilter
+#endif
+
+#endif // RESAMPLING_SPECIALIZATION_HLSLI
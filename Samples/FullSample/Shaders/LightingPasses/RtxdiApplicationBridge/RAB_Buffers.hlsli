@@ -30,6 +30,8 @@ Buffer<uint> t_LightIndexMappingBuffer : register(t22);
 Texture2D t_EnvironmentPdfTexture : register(t23);
 Texture2D t_LocalLightPdfTexture : register(t24);
 StructuredBuffer<uint> t_GeometryInstanceToLight : register(t25);
+StructuredBuffer<InstancedLightRecord> t_InstancedLightRecords : register(t26);
+Buffer<uint2> t_LightRecordIndexBuffer : register(t27);
 
 // Screen-sized UAVs
 RWStructuredBuffer<RTXDI_PackedDIReservoir> u_LightReservoirs : register(u0);
@@ -45,6 +47,7 @@ RWBuffer<uint2> u_RisBuffer : register(u10);
 RWBuffer<uint4> u_RisLightDataBuffer : register(u11);
 RWBuffer<uint> u_RayCountBuffer : register(u12);
 RWStructuredBuffer<SecondaryGBufferData> u_SecondaryGBuffer : register(u13);
+RWBuffer<uint> u_RayCountTileBuffer : register(u14);
 
 // Other
 ConstantBuffer<ResamplingConstants> g_Const : register(b0);
@@ -59,6 +62,28 @@ SamplerState s_EnvironmentSampler : register(s1);
 
 #define IES_SAMPLER s_EnvironmentSampler
 
+// Pixel processed by the current thread, used to attribute the traced rays to screen tiles.
+// Set by the screen-space entry points before any rays are traced.
+static uint2 g_RayCountPixelPosition = 0;
+
+void SetRayCountPixelPosition(uint2 pixelPosition)
+{
+    g_RayCountPixelPosition = pixelPosition;
+}
+
+// Increments the traced or hit counter of the tile containing g_RayCountPixelPosition,
+// if the per-tile ray counters are enabled for the current pass.
+void ReportRayCountTile(bool hit)
+{
+    if (g_PerPassConstants.rayCountTileGridWidth == 0)
+        return;
+
+    uint2 tile = g_RayCountPixelPosition / RAY_COUNT_TILE_SIZE;
+    uint tileIndex = tile.y * g_PerPassConstants.rayCountTileGridWidth + tile.x;
+
+    InterlockedAdd(u_RayCountTileBuffer[hit ? RAY_COUNT_HITS(tileIndex) : RAY_COUNT_TRACED(tileIndex)], 1);
+}
+
 // Translates the light index from the current frame to the previous frame (if currentToPrevious = true)
 // or from the previous frame to the current frame (if currentToPrevious = false).
 // Returns the new index, or a negative number if the light does not exist in the other frame.
@@ -13,9 +13,20 @@ RAB_LightInfo RAB_EmptyLightInfo()
 }
 
 // Loads polymorphic light data from the global light buffer.
+// Emissive triangles are stored once per geometry in object space and moved into world space
+// with the transform of the instance that owns the light index, see PrepareLightsPass::Process.
 RAB_LightInfo RAB_LoadLightInfo(uint index, bool previousFrame)
 {
-    return t_LightDataBuffer[index];
+    uint2 recordAndStoredLight = t_LightRecordIndexBuffer[index];
+    RAB_LightInfo lightInfo = t_LightDataBuffer[recordAndStoredLight.y];
+
+    if (recordAndStoredLight.x == LIGHT_RECORD_NONE)
+        return lightInfo;
+
+    InstancedLightRecord record = t_InstancedLightRecords[recordAndStoredLight.x];
+    float3x4 transform = float3x4(record.transformRow0, record.transformRow1, record.transformRow2);
+
+    return TriangleLight::TransformInstanced(lightInfo, transform);
 }
 
 // Loads triangle light data from a tile produced by the presampling pass.
@@ -732,6 +732,38 @@ struct TriangleLight
         
         return lightInfo;
     }
+
+    // Stores an object-space triangle for TransformInstanced. Triangles don't use the shaping words,
+    // so they keep the edge lengths at full precision and the world-space lengths are only quantized once.
+    PolymorphicLightInfo StoreInstanced()
+    {
+        PolymorphicLightInfo lightInfo = Store();
+        lightInfo.iesProfileIndex = asuint(length(edge1));
+        lightInfo.primaryAxis = asuint(length(edge2));
+
+        return lightInfo;
+    }
+
+    // Moves a triangle written by StoreInstanced into world space. Only the center, directions and
+    // edge lengths are re-encoded, the color, radiance and flags are passed through unchanged.
+    static PolymorphicLightInfo TransformInstanced(PolymorphicLightInfo lightInfo, float3x4 transform)
+    {
+        float3x3 linearTransform = (float3x3)transform;
+        float3 edge1 = mul(linearTransform, octToNdirUnorm32(lightInfo.direction1)) * asfloat(lightInfo.iesProfileIndex);
+        float3 edge2 = mul(linearTransform, octToNdirUnorm32(lightInfo.direction2)) * asfloat(lightInfo.primaryAxis);
+        float edge1Length = length(edge1);
+        float edge2Length = length(edge2);
+
+        // The center is the centroid, which an affine transform maps to the centroid of the transformed triangle
+        lightInfo.center = mul(transform, float4(lightInfo.center, 1)).xyz;
+        lightInfo.direction1 = ndirToOctUnorm32(edge1 / edge1Length);
+        lightInfo.direction2 = ndirToOctUnorm32(edge2 / edge2Length);
+        lightInfo.scalars = f32tof16(edge1Length) | (f32tof16(edge2Length) << 16);
+        lightInfo.iesProfileIndex = 0;
+        lightInfo.primaryAxis = 0;
+
+        return lightInfo;
+    }
 };
 
 struct EnvironmentLight
@@ -20,6 +20,8 @@ VK_PUSH_CONSTANT ConstantBuffer<PrepareLightsConstants> g_Const : register(b0);
 RWStructuredBuffer<PolymorphicLightInfo> u_LightDataBuffer : register(u0);
 RWBuffer<uint> u_LightIndexMappingBuffer : register(u1);
 RWTexture2D<float> u_LocalLightPdfTexture : register(u2);
+RWStructuredBuffer<InstancedLightRecord> u_InstancedLightRecords : register(u3);
+RWBuffer<uint2> u_LightRecordIndexBuffer : register(u4);
 StructuredBuffer<PrepareLightsTask> t_TaskBuffer : register(t0);
 StructuredBuffer<PolymorphicLightInfo> t_PrimitiveLights : register(t1);
 StructuredBuffer<InstanceData> t_InstanceData : register(t2);
@@ -34,13 +36,14 @@ VK_BINDING(1, 1) Texture2D t_BindlessTextures[] : register(t0, space2);
 #define IES_SAMPLER s_MaterialSampler
 #include "PolymorphicLight.hlsli"
 
-bool FindTask(uint dispatchThreadId, out PrepareLightsTask task)
+bool FindTask(uint dispatchThreadId, out PrepareLightsTask task, out uint taskIndex)
 {
     // Use binary search to find the task that contains the current thread's output index:
     //   task.lightBufferOffset <= dispatchThreadId < (task.lightBufferOffset + task.triangleCount)
 
     int left = 0;
     int right = int(g_Const.numTasks) - 1;
+    taskIndex = 0;
 
     while (right >= left)
     {
@@ -57,6 +60,7 @@ bool FindTask(uint dispatchThreadId, out PrepareLightsTask task)
         else if (tri < task.triangleCount)
         {
             // Found it!
+            taskIndex = uint(middle);
             return true;
         }
         else
@@ -73,14 +77,17 @@ bool FindTask(uint dispatchThreadId, out PrepareLightsTask task)
 void main(uint dispatchThreadId : SV_DispatchThreadID, uint groupThreadId : SV_GroupThreadID)
 {
     PrepareLightsTask task = (PrepareLightsTask)0;
+    uint taskIndex;
 
-    if (!FindTask(dispatchThreadId, task))
+    if (!FindTask(dispatchThreadId, task, taskIndex))
         return;
 
     uint triangleIdx = dispatchThreadId - task.lightBufferOffset;
     bool isPrimitiveLight = (task.instanceAndGeometryIndex & TASK_PRIMITIVE_LIGHT_BIT) != 0;
     
-    PolymorphicLightInfo lightInfo = (PolymorphicLightInfo)0;
+    PolymorphicLightInfo storedLightInfo = (PolymorphicLightInfo)0;
+    float3x4 transform = float3x4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0);
+    float emissiveFlux;
 
     if (!isPrimitiveLight)
     {
@@ -99,9 +106,7 @@ void main(uint dispatchThreadId : SV_DispatchThreadID, uint groupThreadId : SV_G
         positions[1] = asfloat(vertexBuffer.Load3(geometry.positionOffset + indices[1] * c_SizeOfPosition));
         positions[2] = asfloat(vertexBuffer.Load3(geometry.positionOffset + indices[2] * c_SizeOfPosition));
         
-        positions[0] = mul(instance.transform, float4(positions[0], 1)).xyz;
-        positions[1] = mul(instance.transform, float4(positions[1], 1)).xyz;
-        positions[2] = mul(instance.transform, float4(positions[2], 1)).xyz;
+        transform = instance.transform;
 
         float3 radiance = material.emissiveColor;
 
@@ -166,22 +171,57 @@ void main(uint dispatchThreadId : SV_DispatchThreadID, uint groupThreadId : SV_G
 
         radiance.rgb = max(0, radiance.rgb);
 
-        TriangleLight triLight;
-        triLight.base = positions[0];
-        triLight.edge1 = positions[1] - positions[0];
-        triLight.edge2 = positions[2] - positions[0];
-        triLight.radiance = radiance;
+        // The light data buffer has the object-space triangle, only its world-space flux is needed for the PDF
+        if (task.storeLights != 0)
+        {
+            TriangleLight triLight;
+            triLight.base = positions[0];
+            triLight.edge1 = positions[1] - positions[0];
+            triLight.edge2 = positions[2] - positions[0];
+            triLight.radiance = radiance;
+
+            storedLightInfo = triLight.StoreInstanced();
+        }
+
+        float3x3 linearTransform = (float3x3)transform;
+        float3 worldEdge1 = mul(linearTransform, positions[1] - positions[0]);
+        float3 worldEdge2 = mul(linearTransform, positions[2] - positions[0]);
+        float surfaceArea = 0.5 * length(cross(worldEdge1, worldEdge2));
 
-        lightInfo = triLight.Store();
+        emissiveFlux = surfaceArea * c_pi * calcLuminance(radiance);
     }
     else
     {
         uint primitiveLightIndex = task.instanceAndGeometryIndex & ~TASK_PRIMITIVE_LIGHT_BIT;
-        lightInfo = t_PrimitiveLights[primitiveLightIndex];
+        storedLightInfo = t_PrimitiveLights[primitiveLightIndex];
+
+        emissiveFlux = PolymorphicLight::getPower(storedLightInfo);
+    }
+
+    // Only the first instance of a geometry stores its triangles, the other ones share them
+    uint storedLightIndex = g_Const.currentFrameStoredLightOffset + task.storedLightOffset + triangleIdx;
+    if (task.storeLights != 0)
+        u_LightDataBuffer[storedLightIndex] = storedLightInfo;
+
+    // Primitive lights are stored in world space and have no record
+    uint recordIndex = LIGHT_RECORD_NONE;
+    if (!isPrimitiveLight)
+    {
+        recordIndex = g_Const.currentFrameRecordOffset + taskIndex;
+
+        if (triangleIdx == 0)
+        {
+            InstancedLightRecord record;
+            record.transformRow0 = transform[0];
+            record.transformRow1 = transform[1];
+            record.transformRow2 = transform[2];
+            u_InstancedLightRecords[recordIndex] = record;
+        }
     }
 
+    // Both halves of the mapping are written per light index, so that RAB_LoadLightInfo can load the record and the stored light together
     uint lightBufferPtr = task.lightBufferOffset + triangleIdx;
-    u_LightDataBuffer[g_Const.currentFrameLightOffset + lightBufferPtr] = lightInfo;
+    u_LightRecordIndexBuffer[g_Const.currentFrameLightOffset + lightBufferPtr] = uint2(recordIndex, storedLightIndex);
 
     // If this light has existed on the previous frame, write the index mapping information
     // so that temporal resampling can be applied to the light correctly when it changes
@@ -201,9 +241,6 @@ void main(uint dispatchThreadId : SV_DispatchThreadID, uint groupThreadId : SV_G
             g_Const.previousFrameLightOffset + prevBufferPtr + 1;
     }
 
-    // Calculate the total flux
-    float emissiveFlux = PolymorphicLight::getPower(lightInfo);
-
     // Write the flux into the PDF texture
     uint2 pdfTexturePosition = RTXDI_LinearIndexToZCurve(lightBufferPtr);
     u_LocalLightPdfTexture[pdfTexturePosition] = emissiveFlux;
@@ -34,13 +34,26 @@ SamplerState s_MaterialSampler : register(s0);
 
 RWBuffer<uint> u_RayCountBuffer : register(u0);
 
+#if INDIRECT_DRAW
+// The draws are generated by GBufferCulling.hlsl, and the draw record index arrives through
+// the instance-rate DRAW_INDEX attribute, see GBufferPass::CreatePipeline.
+StructuredBuffer<GBufferDrawRecord> t_DrawRecords : register(t3);
+#endif
+
 /* The #ifdef SPIRV... parts in this shader are a workaround for DXC not having full
    support for SV_Barycentrics pixel shader inputs. It translates such inputs as BaryCoordSmoothAMD
    but NVIDIA drivers do not support that extension, and they need BaryCoordNV instead. */
 
 void vs_main(
     in uint i_vertexID : SV_VertexID,
+#if INDIRECT_DRAW
+    in uint i_drawIndex : DRAW_INDEX,
+#endif
     out float4 o_position : SV_Position
+#if INDIRECT_DRAW
+    ,
+    nointerpolation out uint o_drawIndex : DRAW_INDEX
+#endif
 #ifdef SPIRV
     ,
     out float3 o_objectPos : OBJECTPOS,
@@ -51,8 +64,18 @@ void vs_main(
 #endif
     )
 {
-    InstanceData instance = t_InstanceData[g_Instance.instance];
-    GeometryData geometry = t_GeometryData[instance.firstGeometryIndex + g_Instance.geometryIndex];
+#if INDIRECT_DRAW
+    const GBufferDrawRecord drawRecord = t_DrawRecords[i_drawIndex];
+    const uint instanceIndex = drawRecord.instanceIndex;
+    const uint geometryIndex = drawRecord.geometryIndex;
+    o_drawIndex = i_drawIndex;
+#else
+    const uint instanceIndex = g_Instance.instance;
+    const uint geometryIndex = g_Instance.geometryIndex;
+#endif
+
+    InstanceData instance = t_InstanceData[instanceIndex];
+    GeometryData geometry = t_GeometryData[instance.firstGeometryIndex + geometryIndex];
 
     ByteAddressBuffer indexBuffer = t_BindlessBuffers[NonUniformResourceIndex(geometry.indexBufferIndex)];
     ByteAddressBuffer vertexBuffer = t_BindlessBuffers[NonUniformResourceIndex(geometry.vertexBufferIndex)];
@@ -105,6 +128,9 @@ void vs_main(
 void ps_main(
     in float4 i_position : SV_Position,
     nointerpolation in uint i_primitiveID : SV_PrimitiveID,
+#if INDIRECT_DRAW
+    nointerpolation in uint i_drawIndex : DRAW_INDEX,
+#endif
 #ifdef SPIRV
     in float3 i_objectPos : OBJECTPOS,
     in float3 i_prevObjectPos : PREV_OBJECTPOS,
@@ -123,10 +149,19 @@ void ps_main(
     out float4 o_motion : SV_Target6
     )
 {
+#if INDIRECT_DRAW
+    const GBufferDrawRecord drawRecord = t_DrawRecords[i_drawIndex];
+    const uint instanceIndex = drawRecord.instanceIndex;
+    const uint geometryIndex = drawRecord.geometryIndex;
+#else
+    const uint instanceIndex = g_Instance.instance;
+    const uint geometryIndex = g_Instance.geometryIndex;
+#endif
+
 #ifdef SPIRV
     GeometrySample gs = (GeometrySample)0;
-    gs.instance = t_InstanceData[g_Instance.instance];
-    gs.geometry = t_GeometryData[gs.instance.firstGeometryIndex + g_Instance.geometryIndex];
+    gs.instance = t_InstanceData[instanceIndex];
+    gs.geometry = t_GeometryData[gs.instance.firstGeometryIndex + geometryIndex];
     gs.material = t_MaterialConstants[gs.geometry.materialIndex];
 
     gs.texcoord = i_texcoord;
@@ -136,7 +171,7 @@ void ps_main(
     gs.tangent.xyz = normalize(i_tangent.xyz);
     gs.tangent.w = i_tangent.w;
 #else
-    GeometrySample gs = getGeometryFromHit(g_Instance.instance, g_Instance.geometryIndex, i_primitiveID, i_bary.yz,
+    GeometrySample gs = getGeometryFromHit(instanceIndex, geometryIndex, i_primitiveID, i_bary.yz,
         GeomAttr_All, t_InstanceData, t_GeometryData, t_MaterialConstants);
 #endif
 
@@ -18,8 +18,10 @@
 #include <Rtxdi/GI/ReSTIRGIParameters.h>
 
 #include "BRDFPTParameters.h"
+#include "GBufferDrawRecord.h"
 
 #define TASK_PRIMITIVE_LIGHT_BIT 0x80000000u
+#define LIGHT_RECORD_NONE 0xffffffffu // light record index of lights that are stored in world space
 
 #define RTXDI_PRESAMPLING_GROUP_SIZE 256
 #define RTXDI_GRID_BUILD_GROUP_SIZE 256
@@ -40,9 +42,13 @@
 #define RAY_COUNT_TRACED(index) ((index) * 2)
 #define RAY_COUNT_HITS(index) ((index) * 2 + 1)
 
+// Size of the screen tiles used for the optional per-tile ray counters, in pixels
+#define RAY_COUNT_TILE_SIZE 8
+
 #define REPORT_RAY(hit) if (g_PerPassConstants.rayCountBufferIndex >= 0) { \
     InterlockedAdd(u_RayCountBuffer[RAY_COUNT_TRACED(g_PerPassConstants.rayCountBufferIndex)], 1); \
-    if (hit) InterlockedAdd(u_RayCountBuffer[RAY_COUNT_HITS(g_PerPassConstants.rayCountBufferIndex)], 1); }
+    ReportRayCountTile(false); \
+    if (hit) { InterlockedAdd(u_RayCountBuffer[RAY_COUNT_HITS(g_PerPassConstants.rayCountBufferIndex)], 1); ReportRayCountTile(true); } }
 
 struct BrdfRayTracingConstants
 {
@@ -56,6 +62,8 @@ struct PrepareLightsConstants
     uint numTasks;
     uint currentFrameLightOffset;
     uint previousFrameLightOffset;
+    uint currentFrameStoredLightOffset;
+    uint currentFrameRecordOffset;
 };
 
 struct PrepareLightsTask
@@ -64,6 +72,19 @@ struct PrepareLightsTask
     uint triangleCount;
     uint lightBufferOffset;
     int previousLightBufferOffset; // -1 means no previous data
+    uint storedLightOffset; // first stored light in the light data buffer, shared by all instances of a geometry
+    uint storeLights; // nonzero for the task that writes the stored lights, i.e. the first instance of a geometry
+    uint2 pad;
+};
+
+// Object to world transform of the instance that owns a range of emissive triangle lights, see PrepareLightsPass::Process.
+// Written by PrepareLights for every mesh task, double-buffered like the lights. The rows are stored explicitly
+// so that the layout doesn't depend on the pack_matrix setting of the shader that reads it.
+struct InstancedLightRecord
+{
+    float4 transformRow0;
+    float4 transformRow1;
+    float4 transformRow2;
 };
 
 struct RenderEnvironmentMapConstants
@@ -227,6 +248,7 @@ struct ResamplingConstants
 struct PerPassConstants
 {
     int rayCountBufferIndex;
+    uint rayCountTileGridWidth; // 0 if the per-tile ray counters are disabled for this pass
 };
 
 struct SecondaryGBufferData
@@ -0,0 +1,300 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+struct AtomicAllocationStats
+{
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> frees{ 0 };
+};
+
+static std::atomic<bool> g_TrackingActive{ false };
+static std::array<AtomicAllocationStats, ProfilerSection::Count + 1> g_CurrentFrame;
+static AllocationFrameStats g_LastFrame;
+
+// The scope stack must not allocate, because it is used from inside operator new
+constexpr uint32_t c_MaxScopeDepth = 16;
+static thread_local uint32_t t_ScopeStack[c_MaxScopeDepth];
+static thread_local uint32_t t_ScopeDepth = 0;
+
+static uint32_t GetCurrentScope()
+{
+    if (t_ScopeDepth == 0)
+        return AllocationFrameStats::OtherScope;
+
+    return t_ScopeStack[std::min(t_ScopeDepth, c_MaxScopeDepth) - 1];
+}
+
+bool AllocationTracker::IsAvailable()
+{
+#if RTXDI_ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationTracker::BeginFrame()
+{
+    for (AtomicAllocationStats& scope : g_CurrentFrame)
+    {
+        scope.allocations.store(0, std::memory_order_relaxed);
+        scope.bytes.store(0, std::memory_order_relaxed);
+        scope.frees.store(0, std::memory_order_relaxed);
+    }
+
+    g_TrackingActive.store(IsAvailable(), std::memory_order_release);
+}
+
+void AllocationTracker::EndFrame()
+{
+    g_TrackingActive.store(false, std::memory_order_release);
+
+    AllocationFrameStats stats;
+    for (size_t scope = 0; scope < stats.scopes.size(); scope++)
+    {
+        AllocationStats& scopeStats = stats.scopes[scope];
+        scopeStats.allocations = g_CurrentFrame[scope].allocations.load(std::memory_order_relaxed);
+        scopeStats.bytes = g_CurrentFrame[scope].bytes.load(std::memory_order_relaxed);
+        scopeStats.frees = g_CurrentFrame[scope].frees.load(std::memory_order_relaxed);
+
+        stats.total.allocations += scopeStats.allocations;
+        stats.total.bytes += scopeStats.bytes;
+        stats.total.frees += scopeStats.frees;
+    }
+
+    g_LastFrame = stats;
+}
+
+const AllocationFrameStats& AllocationTracker::GetLastFrameStats()
+{
+    return g_LastFrame;
+}
+
+void AllocationTracker::PushScope(ProfilerSection::Enum section)
+{
+    // Deeper scopes than the stack can hold are attributed to the innermost stored scope
+    if (t_ScopeDepth < c_MaxScopeDepth)
+        t_ScopeStack[t_ScopeDepth] = uint32_t(section);
+    ++t_ScopeDepth;
+}
+
+void AllocationTracker::PopScope()
+{
+    if (t_ScopeDepth > 0)
+        --t_ScopeDepth;
+}
+
+void AllocationTracker::RecordAllocation(size_t bytes)
+{
+    if (!g_TrackingActive.load(std::memory_order_relaxed))
+        return;
+
+    AtomicAllocationStats& scope = g_CurrentFrame[GetCurrentScope()];
+    scope.allocations.fetch_add(1, std::memory_order_relaxed);
+    scope.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void AllocationTracker::RecordFree()
+{
+    if (!g_TrackingActive.load(std::memory_order_relaxed))
+        return;
+
+    g_CurrentFrame[GetCurrentScope()].frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string AllocationTracker::FormatFrameStats(const AllocationFrameStats& stats, const char* const* sectionNames)
+{
+    std::stringstream text;
+    text << "Total: " << stats.total.allocations << " allocations, " << stats.total.bytes << " bytes, "
+        << stats.total.frees << " frees" << std::endl;
+
+    for (uint32_t scope = 0; scope < stats.scopes.size(); scope++)
+    {
+        const AllocationStats& scopeStats = stats.scopes[scope];
+        if (scopeStats.allocations == 0 && scopeStats.frees == 0)
+            continue;
+
+        text << ((scope == AllocationFrameStats::OtherScope) ? "Other" : sectionNames[scope]) << ": "
+            << scopeStats.allocations << " allocations, " << scopeStats.bytes << " bytes, "
+            << scopeStats.frees << " frees" << std::endl;
+    }
+
+    return text.str();
+}
+
+AllocationBudgetTest::AllocationBudgetTest(const AllocationBudgetSettings& settings)
+    : m_settings(settings)
+{
+}
+
+AllocationBudgetTest::Status AllocationBudgetTest::Update(const AllocationFrameStats& frameStats)
+{
+    if (m_status != Status::Running)
+        return m_status;
+
+    const uint32_t frame = m_frameCount++;
+
+    if (frame < m_settings.warmupFrames)
+        return m_status;
+
+    if (frameStats.total.allocations > m_settings.maxAllocations || frameStats.total.bytes > m_settings.maxBytes)
+    {
+        m_status = Status::Failed;
+        m_failedFrame = frame;
+        m_failedFrameStats = frameStats;
+        return m_status;
+    }
+
+    if (frame + 1 >= m_settings.warmupFrames + m_settings.checkedFrames)
+        m_status = Status::Passed;
+
+    return m_status;
+}
+
+AllocationBudgetTest::Status AllocationBudgetTest::GetStatus() const
+{
+    return m_status;
+}
+
+uint32_t AllocationBudgetTest::GetFailedFrame() const
+{
+    return m_failedFrame;
+}
+
+const AllocationFrameStats& AllocationBudgetTest::GetFailedFrameStats() const
+{
+    return m_failedFrameStats;
+}
+
+#if RTXDI_ALLOCATION_TRACKING
+
+// Replacements for the global allocation functions.
+// The plain versions forward to malloc/free, the aligned ones to the platform aligned allocator.
+
+static void* TrackedAllocate(size_t size)
+{
+    void* ptr = malloc(size ? size : 1);
+    if (ptr)
+        AllocationTracker::RecordAllocation(size);
+    return ptr;
+}
+
+static void* TrackedAllocateAligned(size_t size, std::align_val_t alignment)
+{
+    size_t align = static_cast<size_t>(alignment);
+    if (size == 0)
+        size = align;
+
+#ifdef _WIN32
+    void* ptr = _aligned_malloc(size, align);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, std::max(align, sizeof(void*)), size) != 0)
+        ptr = nullptr;
+#endif
+
+    if (ptr)
+        AllocationTracker::RecordAllocation(size);
+    return ptr;
+}
+
+static void TrackedFree(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    AllocationTracker::RecordFree();
+    free(ptr);
+}
+
+static void TrackedFreeAligned(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    AllocationTracker::RecordFree();
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+void* operator new(size_t size)
+{
+    if (void* ptr = TrackedAllocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    if (void* ptr = TrackedAllocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return TrackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return TrackedAllocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (void* ptr = TrackedAllocateAligned(size, alignment))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    if (void* ptr = TrackedAllocateAligned(size, alignment))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return TrackedAllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return TrackedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { TrackedFreeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { TrackedFreeAligned(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { TrackedFreeAligned(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { TrackedFreeAligned(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFreeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFreeAligned(ptr); }
+
+#endif // RTXDI_ALLOCATION_TRACKING
@@ -0,0 +1,96 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "ProfilerSections.h"
+
+// Heap allocation tracking for the frame loop.
+// When the sample is built with RTXDI_ALLOCATION_TRACKING=1, the global operator new/delete
+// are replaced with versions that count allocations between BeginFrame and EndFrame,
+// attributed to the innermost profiler section that is open on the calling thread.
+// Without that define, the tracker compiles but never records anything.
+
+struct AllocationStats
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t frees = 0;
+};
+
+struct AllocationFrameStats
+{
+    // Allocations made outside of any profiler section are attributed to this scope
+    static constexpr uint32_t OtherScope = ProfilerSection::Count;
+
+    std::array<AllocationStats, ProfilerSection::Count + 1> scopes{};
+    AllocationStats total;
+};
+
+class AllocationTracker
+{
+public:
+    // Returns true if the allocation hooks are compiled in.
+    static bool IsAvailable();
+
+    static void BeginFrame();
+    static void EndFrame();
+    static const AllocationFrameStats& GetLastFrameStats();
+
+    // Scope attribution, driven by the profiler sections. Scopes nest per thread.
+    static void PushScope(ProfilerSection::Enum section);
+    static void PopScope();
+
+    // Called by the allocation hooks.
+    static void RecordAllocation(size_t bytes);
+    static void RecordFree();
+
+    // sectionNames must have ProfilerSection::Count entries.
+    static std::string FormatFrameStats(const AllocationFrameStats& stats, const char* const* sectionNames);
+};
+
+struct AllocationBudgetSettings
+{
+    uint32_t warmupFrames = 100;    // frames to skip before the steady state is reached
+    uint32_t checkedFrames = 100;   // number of steady-state frames to check
+    uint64_t maxAllocations = 0;
+    uint64_t maxBytes = 0;
+};
+
+// Checks per-frame allocation stats against a budget, used by the allocation test mode.
+class AllocationBudgetTest
+{
+public:
+    enum class Status
+    {
+        Running,
+        Passed,
+        Failed
+    };
+
+    explicit AllocationBudgetTest(const AllocationBudgetSettings& settings);
+
+    Status Update(const AllocationFrameStats& frameStats);
+
+    [[nodiscard]] Status GetStatus() const;
+    [[nodiscard]] uint32_t GetFailedFrame() const;
+    [[nodiscard]] const AllocationFrameStats& GetFailedFrameStats() const;
+
+private:
+    AllocationBudgetSettings m_settings;
+    Status m_status = Status::Running;
+    uint32_t m_frameCount = 0;
+    uint32_t m_failedFrame = 0;
+    AllocationFrameStats m_failedFrameStats;
+};
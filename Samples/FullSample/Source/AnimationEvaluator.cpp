@@ -0,0 +1,580 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "AnimationEvaluator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <random>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE__)
+#include <xmmintrin.h>
+#define ANIMATION_SSE 1
+#else
+#define ANIMATION_SSE 0
+#endif
+
+void SerialAnimationFor(size_t taskCount, const std::function<void(size_t task)>& task)
+{
+    for (size_t index = 0; index < taskCount; index++)
+        task(index);
+}
+
+static AnimationSample SlerpQuaternions(const float* a, const float* b, float u)
+{
+    float cosTheta = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+
+    // Take the short way around
+    float sign = 1.f;
+    if (cosTheta < 0.f)
+    {
+        cosTheta = -cosTheta;
+        sign = -1.f;
+    }
+
+    float weightA = 1.f - u;
+    float weightB = u;
+    if (cosTheta < 0.9995f)
+    {
+        const float theta = std::acos(cosTheta);
+        const float sinTheta = std::sin(theta);
+        weightA = std::sin((1.f - u) * theta) / sinTheta;
+        weightB = std::sin(u * theta) / sinTheta;
+    }
+    weightB *= sign;
+
+    AnimationSample result;
+    float lengthSquared = 0.f;
+    for (int i = 0; i < 4; i++)
+    {
+        result.value[i] = a[i] * weightA + b[i] * weightB;
+        lengthSquared += result.value[i] * result.value[i];
+    }
+
+    const float invLength = lengthSquared > 0.f ? 1.f / std::sqrt(lengthSquared) : 0.f;
+    for (float& component : result.value)
+        component *= invLength;
+
+    return result;
+}
+
+// Hermite basis functions
+struct HermiteWeights
+{
+    float s0, s1, s2, s3;
+};
+
+static HermiteWeights GetHermiteWeights(float t)
+{
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    return { 2.f * t3 - 3.f * t2 + 1.f, t3 - 2.f * t2 + t, -2.f * t3 + 3.f * t2, t3 - t2 };
+}
+
+#if ANIMATION_SSE
+// Keyframes a, b, c, d are p[n-1], p[n], p[n+1], p[n+2], the result is between b and c.
+// 4 components at a time with the operations of the scalar version below, in the same order.
+static AnimationSample InterpolateKeyframes(AnimationInterpolation mode, const AnimationKeyframe& a, const AnimationKeyframe& b,
+    const AnimationKeyframe& c, const AnimationKeyframe& d, float t, float dt)
+{
+    const __m128 vt = _mm_set1_ps(t);
+    const __m128 vb = _mm_loadu_ps(b.value);
+    const __m128 vc = _mm_loadu_ps(c.value);
+    __m128 result;
+
+    switch (mode)
+    {
+    case AnimationInterpolation::Linear:
+        result = _mm_add_ps(vb, _mm_mul_ps(_mm_sub_ps(vc, vb), vt));
+        break;
+
+    case AnimationInterpolation::Slerp:
+        return SlerpQuaternions(b.value, c.value, t);
+
+    case AnimationInterpolation::CatmullRomSpline: {
+        const __m128 va = _mm_loadu_ps(a.value);
+        const __m128 vd = _mm_loadu_ps(d.value);
+        const __m128 minusA = _mm_xor_ps(va, _mm_set1_ps(-0.f));
+        const __m128 i = _mm_add_ps(_mm_sub_ps(_mm_add_ps(minusA, _mm_mul_ps(_mm_set1_ps(3.f), vb)), _mm_mul_ps(_mm_set1_ps(3.f), vc)), vd);
+        const __m128 j = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.f), va), _mm_mul_ps(_mm_set1_ps(5.f), vb)), _mm_mul_ps(_mm_set1_ps(4.f), vc)), vd);
+        const __m128 k = _mm_add_ps(minusA, vc);
+        const __m128 polynomial = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(i, vt), j), vt), k);
+        result = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), polynomial), vt), vb);
+        break;
+    }
+
+    case AnimationInterpolation::HermiteSpline: {
+        const HermiteWeights w = GetHermiteWeights(t);
+        const __m128 vdt = _mm_set1_ps(dt);
+        const __m128 outTangent = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(w.s1), _mm_loadu_ps(b.outTangent)), vdt);
+        const __m128 inTangent = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(w.s3), _mm_loadu_ps(c.inTangent)), vdt);
+        result = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(w.s0), vb), outTangent), _mm_mul_ps(_mm_set1_ps(w.s2), vc)), inTangent);
+        break;
+    }
+
+    case AnimationInterpolation::Step:
+    default:
+        result = vb;
+        break;
+    }
+
+    AnimationSample sample;
+    _mm_storeu_ps(sample.value, result);
+    return sample;
+}
+#else
+// Keyframes a, b, c, d are p[n-1], p[n], p[n+1], p[n+2], the result is between b and c
+static AnimationSample InterpolateKeyframes(AnimationInterpolation mode, const AnimationKeyframe& a, const AnimationKeyframe& b,
+    const AnimationKeyframe& c, const AnimationKeyframe& d, float t, float dt)
+{
+    AnimationSample result;
+
+    switch (mode)
+    {
+    case AnimationInterpolation::Linear:
+        for (int i = 0; i < 4; i++)
+            result.value[i] = b.value[i] + (c.value[i] - b.value[i]) * t;
+        return result;
+
+    case AnimationInterpolation::Slerp:
+        return SlerpQuaternions(b.value, c.value, t);
+
+    case AnimationInterpolation::CatmullRomSpline:
+        for (int n = 0; n < 4; n++)
+        {
+            const float i = -a.value[n] + 3.f * b.value[n] - 3.f * c.value[n] + d.value[n];
+            const float j = 2.f * a.value[n] - 5.f * b.value[n] + 4.f * c.value[n] - d.value[n];
+            const float k = -a.value[n] + c.value[n];
+            result.value[n] = 0.5f * ((i * t + j) * t + k) * t + b.value[n];
+        }
+        return result;
+
+    case AnimationInterpolation::HermiteSpline: {
+        const HermiteWeights w = GetHermiteWeights(t);
+        for (int i = 0; i < 4; i++)
+            result.value[i] = w.s0 * b.value[i] + w.s1 * b.outTangent[i] * dt + w.s2 * c.value[i] + w.s3 * c.inTangent[i] * dt;
+        return result;
+    }
+
+    case AnimationInterpolation::Step:
+    default:
+        std::memcpy(result.value, b.value, sizeof(result.value));
+        return result;
+    }
+}
+#endif
+
+static AnimationSample GetKeyframeValue(const AnimationKeyframe& keyframe)
+{
+    AnimationSample result;
+    std::memcpy(result.value, keyframe.value, sizeof(result.value));
+    return result;
+}
+
+AnimationSample SampleAnimationTrack(const AnimationTrack& track, const AnimationKeyframe* keyframes, float time)
+{
+    const uint32_t count = track.keyframeCount;
+    const AnimationKeyframe* keys = keyframes + track.firstKeyframe;
+
+    if (count == 0)
+        return AnimationSample();
+
+    if (time <= keys[0].time)
+        return GetKeyframeValue(keys[0]);
+
+    if (count == 1 || time >= keys[count - 1].time)
+        return GetKeyframeValue(keys[count - 1]);
+
+    for (uint32_t offset = 0; offset < count - 1; offset++)
+    {
+        const float tb = keys[offset].time;
+        const float tc = keys[offset + 1].time;
+        if (tb <= time && time < tc)
+        {
+            const AnimationKeyframe& b = keys[offset];
+            const AnimationKeyframe& c = keys[offset + 1];
+            const AnimationKeyframe& a = (offset > 0) ? keys[offset - 1] : b;
+            const AnimationKeyframe& d = (offset + 2 < count) ? keys[offset + 2] : c;
+            const float dt = tc - tb;
+            const float u = (time - tb) / dt;
+            return InterpolateKeyframes(track.interpolation, a, b, c, d, u, dt);
+        }
+    }
+
+    // Only reachable with decreasing keyframe times
+    return GetKeyframeValue(keys[count - 1]);
+}
+
+void AnimationEvaluator::Build(std::vector<AnimationTrack> tracks, std::vector<AnimationKeyframe> keyframes, uint32_t tracksPerTask)
+{
+    m_tracks = std::move(tracks);
+    m_keyframes = std::move(keyframes);
+    m_results.assign(m_tracks.size(), AnimationSample());
+    m_segments.assign(m_tracks.size(), 0);
+
+    m_order.resize(m_tracks.size());
+    std::iota(m_order.begin(), m_order.end(), 0u);
+    std::stable_sort(m_order.begin(), m_order.end(), [this](uint32_t a, uint32_t b)
+    {
+        return m_tracks[a].target < m_tracks[b].target;
+    });
+
+    // Close a task once it's full, but never between two tracks of the same target
+    tracksPerTask = std::max(tracksPerTask, 1u);
+    m_taskBegin.clear();
+    m_taskBegin.push_back(0);
+    for (uint32_t position = 1; position < uint32_t(m_order.size()); position++)
+    {
+        const bool full = position - m_taskBegin.back() >= tracksPerTask;
+        if (full && m_tracks[m_order[position]].target != m_tracks[m_order[position - 1]].target)
+            m_taskBegin.push_back(position);
+    }
+    m_taskBegin.push_back(uint32_t(m_order.size()));
+}
+
+void AnimationEvaluator::EvaluateTask(size_t task, const float* clockTimes)
+{
+    for (uint32_t position = m_taskBegin[task]; position < m_taskBegin[task + 1]; position++)
+    {
+        const uint32_t index = m_order[position];
+        const AnimationTrack& track = m_tracks[index];
+        const uint32_t count = track.keyframeCount;
+        const AnimationKeyframe* keys = m_keyframes.data() + track.firstKeyframe;
+        const float time = clockTimes[track.clock];
+
+        if (count == 0)
+        {
+            m_results[index] = AnimationSample();
+            continue;
+        }
+
+        if (time <= keys[0].time)
+        {
+            m_results[index] = GetKeyframeValue(keys[0]);
+            continue;
+        }
+
+        if (count == 1 || time >= keys[count - 1].time)
+        {
+            m_results[index] = GetKeyframeValue(keys[count - 1]);
+            continue;
+        }
+
+        // Try the last segment and the one after it before searching
+        uint32_t segment = m_segments[index];
+        auto contains = [keys, count, time](uint32_t offset)
+        {
+            return offset + 1 < count && keys[offset].time <= time && time < keys[offset + 1].time;
+        };
+
+        if (!contains(segment))
+        {
+            if (contains(segment + 1))
+                segment++;
+            else
+            {
+                const AnimationKeyframe* next = std::upper_bound(keys, keys + count, time, [](float t, const AnimationKeyframe& keyframe)
+                {
+                    return t < keyframe.time;
+                });
+                segment = uint32_t(next - keys) - 1;
+            }
+            m_segments[index] = segment;
+        }
+
+        const AnimationKeyframe& b = keys[segment];
+        const AnimationKeyframe& c = keys[segment + 1];
+        const AnimationKeyframe& a = (segment > 0) ? keys[segment - 1] : b;
+        const AnimationKeyframe& d = (segment + 2 < count) ? keys[segment + 2] : c;
+        const float dt = c.time - b.time;
+        const float u = (time - b.time) / dt;
+        m_results[index] = InterpolateKeyframes(track.interpolation, a, b, c, d, u, dt);
+    }
+}
+
+void AnimationEvaluator::Evaluate(const float* clockTimes, const AnimationParallelFor& parallelFor)
+{
+    const size_t taskCount = GetTaskCount();
+
+    if (taskCount <= 1 || !parallelFor)
+    {
+        for (size_t task = 0; task < taskCount; task++)
+            EvaluateTask(task, clockTimes);
+        return;
+    }
+
+    parallelFor(taskCount, [this, clockTimes](size_t task)
+    {
+        EvaluateTask(task, clockTimes);
+    });
+}
+
+void AnimationEvaluator::EvaluateSerial(const float* clockTimes)
+{
+    for (size_t index = 0; index < m_tracks.size(); index++)
+        m_results[index] = SampleAnimationTrack(m_tracks[index], m_keyframes.data(), clockTimes[m_tracks[index].clock]);
+}
+
+const std::vector<AnimationSample>& AnimationEvaluator::GetResults() const
+{
+    return m_results;
+}
+
+const std::vector<AnimationTrack>& AnimationEvaluator::GetTracks() const
+{
+    return m_tracks;
+}
+
+size_t AnimationEvaluator::GetTaskCount() const
+{
+    return m_taskBegin.empty() ? 0 : m_taskBegin.size() - 1;
+}
+
+void TransformHierarchy::Build(const std::vector<uint32_t>& parents)
+{
+    m_parents = parents;
+
+    std::vector<uint32_t> depths(parents.size());
+    uint32_t levelCount = 0;
+    for (size_t node = 0; node < parents.size(); node++)
+    {
+        depths[node] = (parents[node] == NoParent) ? 0 : depths[parents[node]] + 1;
+        levelCount = std::max(levelCount, depths[node] + 1);
+    }
+
+    // Counting sort by depth keeps the node order within a level
+    m_levelBegin.assign(levelCount + 1, 0);
+    for (uint32_t depth : depths)
+        m_levelBegin[depth + 1]++;
+    for (uint32_t level = 0; level < levelCount; level++)
+        m_levelBegin[level + 1] += m_levelBegin[level];
+
+    std::vector<uint32_t> cursors(m_levelBegin.begin(), m_levelBegin.end() - 1);
+    m_levelNodes.resize(parents.size());
+    for (uint32_t node = 0; node < uint32_t(parents.size()); node++)
+        m_levelNodes[cursors[depths[node]]++] = node;
+}
+
+void TransformHierarchy::UpdateNode(uint32_t node, const AnimationTransform* locals, AnimationMatrix* worlds) const
+{
+    const AnimationTransform& local = locals[node];
+    const float x = local.rotation[0];
+    const float y = local.rotation[1];
+    const float z = local.rotation[2];
+    const float w = local.rotation[3];
+
+    // T * R * S
+    const float rotation[3][3] = {
+        { 1.f - 2.f * (y * y + z * z), 2.f * (x * y - z * w), 2.f * (x * z + y * w) },
+        { 2.f * (x * y + z * w), 1.f - 2.f * (x * x + z * z), 2.f * (y * z - x * w) },
+        { 2.f * (x * z - y * w), 2.f * (y * z + x * w), 1.f - 2.f * (x * x + y * y) }
+    };
+
+    AnimationMatrix localMatrix;
+    for (int row = 0; row < 3; row++)
+    {
+        for (int column = 0; column < 3; column++)
+            localMatrix.m[row][column] = rotation[row][column] * local.scaling[column];
+        localMatrix.m[row][3] = local.translation[row];
+    }
+
+    const uint32_t parent = m_parents[node];
+    if (parent == NoParent)
+    {
+        worlds[node] = localMatrix;
+        return;
+    }
+
+    const AnimationMatrix& parentMatrix = worlds[parent];
+    AnimationMatrix& world = worlds[node];
+    for (int row = 0; row < 3; row++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            world.m[row][column] = parentMatrix.m[row][0] * localMatrix.m[0][column]
+                + parentMatrix.m[row][1] * localMatrix.m[1][column]
+                + parentMatrix.m[row][2] * localMatrix.m[2][column];
+        }
+        world.m[row][3] += parentMatrix.m[row][3];
+    }
+}
+
+void TransformHierarchy::Propagate(const AnimationTransform* locals, AnimationMatrix* worlds, const AnimationParallelFor& parallelFor,
+    uint32_t nodesPerTask) const
+{
+    nodesPerTask = std::max(nodesPerTask, 1u);
+
+    for (size_t level = 0; level + 1 < m_levelBegin.size(); level++)
+    {
+        const uint32_t begin = m_levelBegin[level];
+        const uint32_t end = m_levelBegin[level + 1];
+        const uint32_t taskCount = (end - begin + nodesPerTask - 1) / nodesPerTask;
+
+        auto updateRange = [this, locals, worlds, begin, end, nodesPerTask](size_t task)
+        {
+            const uint32_t first = begin + uint32_t(task) * nodesPerTask;
+            const uint32_t last = std::min(end, first + nodesPerTask);
+            for (uint32_t position = first; position < last; position++)
+                UpdateNode(m_levelNodes[position], locals, worlds);
+        };
+
+        // The parents are complete when the level starts, so the nodes of a level are independent
+        if (taskCount <= 1 || !parallelFor)
+            SerialAnimationFor(taskCount, updateRange);
+        else
+            parallelFor(taskCount, updateRange);
+    }
+}
+
+void TransformHierarchy::PropagateSerial(const AnimationTransform* locals, AnimationMatrix* worlds) const
+{
+    for (uint32_t node = 0; node < uint32_t(m_parents.size()); node++)
+        UpdateNode(node, locals, worlds);
+}
+
+size_t TransformHierarchy::GetNodeCount() const
+{
+    return m_parents.size();
+}
+
+size_t TransformHierarchy::GetLevelCount() const
+{
+    return m_levelBegin.empty() ? 0 : m_levelBegin.size() - 1;
+}
+
+AnimationBenchmarkResult BenchmarkAnimationEvaluation(uint32_t nodeCount, uint32_t iterations, const AnimationParallelFor& parallelFor)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+    constexpr uint32_t keyframesPerTrack = 32;
+    constexpr uint32_t nodesPerClock = 16;
+    constexpr float keyframeInterval = 0.25f;
+    const float duration = keyframeInterval * float(keyframesPerTrack - 1);
+
+    AnimationBenchmarkResult result;
+    result.nodeCount = nodeCount;
+    iterations = std::max(iterations, 1u);
+
+    // Every node has a translation, a rotation and a scaling track with the interpolation modes of a typical glTF scene
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> random(-1.f, 1.f);
+
+    std::vector<AnimationTrack> tracks;
+    std::vector<AnimationKeyframe> keyframes;
+    const AnimationInterpolation modes[3] = { AnimationInterpolation::Linear, AnimationInterpolation::Slerp, AnimationInterpolation::HermiteSpline };
+
+    for (uint32_t node = 0; node < nodeCount; node++)
+    {
+        for (uint32_t attribute = 0; attribute < 3; attribute++)
+        {
+            AnimationTrack track;
+            track.firstKeyframe = uint32_t(keyframes.size());
+            track.keyframeCount = keyframesPerTrack;
+            track.interpolation = modes[attribute];
+            track.clock = node / nodesPerClock;
+            track.target = node;
+            tracks.push_back(track);
+
+            for (uint32_t key = 0; key < keyframesPerTrack; key++)
+            {
+                AnimationKeyframe keyframe;
+                keyframe.time = float(key) * keyframeInterval;
+                for (int i = 0; i < 4; i++)
+                {
+                    keyframe.value[i] = random(rng);
+                    keyframe.inTangent[i] = random(rng);
+                    keyframe.outTangent[i] = random(rng);
+                }
+                if (attribute == 2)
+                {
+                    for (float& scale : keyframe.value)
+                        scale = 1.f + 0.25f * scale;
+                }
+                keyframes.push_back(keyframe);
+            }
+        }
+    }
+    result.trackCount = uint32_t(tracks.size());
+
+    // Wide and shallow, like instanced props under a few group nodes
+    std::vector<uint32_t> parents(nodeCount);
+    for (uint32_t node = 0; node < nodeCount; node++)
+        parents[node] = (node == 0) ? TransformHierarchy::NoParent : (node - 1) / 8;
+
+    AnimationEvaluator evaluator;
+    evaluator.Build(std::move(tracks), std::move(keyframes));
+
+    TransformHierarchy hierarchy;
+    hierarchy.Build(parents);
+
+    std::vector<float> clockTimes((nodeCount + nodesPerClock - 1) / nodesPerClock);
+    std::vector<AnimationSample> serialSamples;
+    std::vector<AnimationTransform> locals(nodeCount);
+    std::vector<AnimationMatrix> serialWorlds(nodeCount);
+    std::vector<AnimationMatrix> parallelWorlds(nodeCount);
+    result.resultsMatch = true;
+
+    auto setClocks = [&clockTimes, duration](uint32_t iteration)
+    {
+        for (size_t clock = 0; clock < clockTimes.size(); clock++)
+            clockTimes[clock] = std::fmod(float(iteration) * (1.f / 60.f) + float(clock) * 0.1f, duration);
+    };
+
+    auto setLocals = [&locals, &evaluator]()
+    {
+        const std::vector<AnimationSample>& samples = evaluator.GetResults();
+        for (size_t node = 0; node < locals.size(); node++)
+        {
+            std::memcpy(locals[node].translation, samples[node * 3 + 0].value, sizeof(locals[node].translation));
+            std::memcpy(locals[node].rotation, samples[node * 3 + 1].value, sizeof(locals[node].rotation));
+            std::memcpy(locals[node].scaling, samples[node * 3 + 2].value, sizeof(locals[node].scaling));
+        }
+    };
+
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        setClocks(iteration);
+
+        Clock::time_point start = Clock::now();
+        evaluator.EvaluateSerial(clockTimes.data());
+        result.serialSamplingMs += elapsedMs(start);
+        serialSamples = evaluator.GetResults();
+
+        start = Clock::now();
+        evaluator.Evaluate(clockTimes.data(), parallelFor);
+        result.parallelSamplingMs += elapsedMs(start);
+
+        if (std::memcmp(serialSamples.data(), evaluator.GetResults().data(), serialSamples.size() * sizeof(AnimationSample)) != 0)
+            result.resultsMatch = false;
+
+        setLocals();
+
+        start = Clock::now();
+        hierarchy.PropagateSerial(locals.data(), serialWorlds.data());
+        result.serialPropagationMs += elapsedMs(start);
+
+        start = Clock::now();
+        hierarchy.Propagate(locals.data(), parallelWorlds.data(), parallelFor);
+        result.parallelPropagationMs += elapsedMs(start);
+
+        if (std::memcmp(serialWorlds.data(), parallelWorlds.data(), serialWorlds.size() * sizeof(AnimationMatrix)) != 0)
+            result.resultsMatch = false;
+    }
+
+    result.serialSamplingMs /= iterations;
+    result.parallelSamplingMs /= iterations;
+    result.serialPropagationMs /= iterations;
+    result.parallelPropagationMs /= iterations;
+    return result;
+}
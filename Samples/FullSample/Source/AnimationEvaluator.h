@@ -0,0 +1,157 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Parallel evaluation of keyframe animation tracks and of the transforms they drive.
+//
+// A track is one animation channel: a keyframe array, an interpolation mode, the clock of the animation
+// it belongs to, and its target. Tracks are grouped by target, and targets are numbered in pre-order, so
+// every task gets a contiguous range of scene subtrees and the tracks of one node never span two tasks.
+// Every track remembers the keyframe segment it sampled last, which turns the keyframe search into a
+// constant time check while the clock advances. The interpolation is done on 4-wide vectors with SSE.
+//
+// SampleAnimationTrack is the serial reference. It follows the sampling rules and the interpolation
+// formulas of donut's animation::Sampler with extrapolation: the first value before the first keyframe,
+// the last value after the last one, and a linear search for the segment. Both paths share the same
+// interpolation kernel, so the parallel results are bitwise identical to the serial ones regardless of
+// the task partitioning.
+//
+// TransformHierarchy computes world matrices from local transforms one tree level at a time, so the
+// nodes of a level are independent of each other and can be split across threads.
+//
+// The module has no dependencies on the renderer, parallelism is provided by the caller.
+
+// Same order as donut::engine::animation::InterpolationMode
+enum class AnimationInterpolation : uint32_t
+{
+    Step,
+    Linear,
+    Slerp,
+    CatmullRomSpline,
+    HermiteSpline
+};
+
+struct AnimationKeyframe
+{
+    float time = 0.f;
+    float value[4] = {};
+    float inTangent[4] = {};
+    float outTangent[4] = {};
+};
+
+struct AnimationTrack
+{
+    uint32_t firstKeyframe = 0;
+    uint32_t keyframeCount = 0;
+    AnimationInterpolation interpolation = AnimationInterpolation::Linear;
+    uint32_t clock = 0;     // index into the clock times passed to Evaluate, usually one per animation
+    uint32_t target = 0;    // tracks with the same target are evaluated by the same task
+};
+
+struct AnimationSample
+{
+    float value[4] = {};
+};
+
+// Calls task(0) ... task(taskCount - 1), possibly in parallel, and returns when all of them are done.
+using AnimationParallelFor = std::function<void(size_t taskCount, const std::function<void(size_t task)>& task)>;
+
+// Runs the tasks one after another on the calling thread
+void SerialAnimationFor(size_t taskCount, const std::function<void(size_t task)>& task);
+
+// Serial reference sampling of one track. Keyframe times must not decrease.
+AnimationSample SampleAnimationTrack(const AnimationTrack& track, const AnimationKeyframe* keyframes, float time);
+
+class AnimationEvaluator
+{
+public:
+    // Takes the tracks and their keyframes. The results are indexed like the tracks.
+    void Build(std::vector<AnimationTrack> tracks, std::vector<AnimationKeyframe> keyframes, uint32_t tracksPerTask = 256);
+
+    // Samples all tracks at the times of their clocks.
+    void Evaluate(const float* clockTimes, const AnimationParallelFor& parallelFor);
+
+    // Samples all tracks with SampleAnimationTrack, in order, on the calling thread.
+    void EvaluateSerial(const float* clockTimes);
+
+    [[nodiscard]] const std::vector<AnimationSample>& GetResults() const;
+    [[nodiscard]] const std::vector<AnimationTrack>& GetTracks() const;
+    [[nodiscard]] size_t GetTaskCount() const;
+
+private:
+    void EvaluateTask(size_t task, const float* clockTimes);
+
+    std::vector<AnimationTrack> m_tracks;
+    std::vector<AnimationKeyframe> m_keyframes;
+    std::vector<uint32_t> m_order;          // track indices sorted by target
+    std::vector<uint32_t> m_taskBegin;      // ranges of m_order, one per task and one past the end
+    std::vector<uint32_t> m_segments;       // last sampled keyframe segment, indexed by track
+    std::vector<AnimationSample> m_results;
+};
+
+struct AnimationTransform
+{
+    float translation[3] = { 0.f, 0.f, 0.f };
+    float rotation[4] = { 0.f, 0.f, 0.f, 1.f };    // x, y, z, w
+    float scaling[3] = { 1.f, 1.f, 1.f };
+};
+
+// Affine transform, row-major 3x3 linear part in the first 3 columns and the translation in the last one
+struct AnimationMatrix
+{
+    float m[3][4] = {};
+};
+
+class TransformHierarchy
+{
+public:
+    static constexpr uint32_t NoParent = ~0u;
+
+    // Every parent must come before its children
+    void Build(const std::vector<uint32_t>& parents);
+
+    // Computes the world matrices level by level, splitting every level into tasks of up to nodesPerTask nodes.
+    void Propagate(const AnimationTransform* locals, AnimationMatrix* worlds, const AnimationParallelFor& parallelFor,
+        uint32_t nodesPerTask = 1024) const;
+
+    // Computes the world matrices in node order on the calling thread.
+    void PropagateSerial(const AnimationTransform* locals, AnimationMatrix* worlds) const;
+
+    [[nodiscard]] size_t GetNodeCount() const;
+    [[nodiscard]] size_t GetLevelCount() const;
+
+private:
+    void UpdateNode(uint32_t node, const AnimationTransform* locals, AnimationMatrix* worlds) const;
+
+    std::vector<uint32_t> m_parents;
+    std::vector<uint32_t> m_levelNodes;     // nodes sorted by depth, in node order within a level
+    std::vector<uint32_t> m_levelBegin;     // ranges of m_levelNodes, one per level and one past the end
+};
+
+struct AnimationBenchmarkResult
+{
+    uint32_t trackCount = 0;
+    uint32_t nodeCount = 0;
+    double serialSamplingMs = 0.0;
+    double parallelSamplingMs = 0.0;
+    double serialPropagationMs = 0.0;
+    double parallelPropagationMs = 0.0;
+    bool resultsMatch = false;      // bitwise, samples and matrices
+};
+
+// Compares the serial and the parallel paths on a synthetic scene with the given number of animated nodes,
+// each with a translation, a rotation and a scaling track.
+AnimationBenchmarkResult BenchmarkAnimationEvaluation(uint32_t nodeCount, uint32_t iterations, const AnimationParallelFor& parallelFor);
@@ -0,0 +1,213 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "AsyncComputeSchedule.h"
+
+#include <algorithm>
+
+namespace
+{
+    const uint32_t c_None = ~0u;
+
+    bool IsWrite(RenderGraphAccess access)
+    {
+        return access == RenderGraphAccess::UnorderedWrite || access == RenderGraphAccess::UnorderedReadWrite;
+    }
+
+    uint32_t GetQueueIndex(QueueType queue)
+    {
+        return queue == QueueType::Compute ? 1 : 0;
+    }
+
+    // Earlier tasks that each task depends on: read after write, write after read and write after write
+    std::vector<std::vector<uint32_t>> FindDependencies(const std::vector<AsyncComputeTask>& tasks)
+    {
+        uint32_t resourceCount = 0;
+        for (const AsyncComputeTask& task : tasks)
+        {
+            for (const RenderGraphUse& use : task.uses)
+                resourceCount = std::max(resourceCount, use.resource + 1);
+        }
+
+        std::vector<std::vector<uint32_t>> dependencies(tasks.size());
+        std::vector<uint32_t> lastWriters(resourceCount, c_None);
+        std::vector<std::vector<uint32_t>> readersSinceWrite(resourceCount);
+
+        for (uint32_t taskIndex = 0; taskIndex < uint32_t(tasks.size()); taskIndex++)
+        {
+            std::vector<uint32_t>& taskDependencies = dependencies[taskIndex];
+
+            for (const RenderGraphUse& use : tasks[taskIndex].uses)
+            {
+                if (use.access == RenderGraphAccess::None)
+                    continue;
+
+                if (lastWriters[use.resource] != c_None)
+                    taskDependencies.push_back(lastWriters[use.resource]);
+
+                if (IsWrite(use.access))
+                {
+                    taskDependencies.insert(taskDependencies.end(), readersSinceWrite[use.resource].begin(), readersSinceWrite[use.resource].end());
+                    readersSinceWrite[use.resource].clear();
+                    lastWriters[use.resource] = taskIndex;
+                }
+                else
+                    readersSinceWrite[use.resource].push_back(taskIndex);
+            }
+
+            std::sort(taskDependencies.begin(), taskDependencies.end());
+            taskDependencies.erase(std::unique(taskDependencies.begin(), taskDependencies.end()), taskDependencies.end());
+            taskDependencies.erase(std::remove(taskDependencies.begin(), taskDependencies.end(), taskIndex), taskDependencies.end());
+        }
+
+        return dependencies;
+    }
+}
+
+size_t AsyncComputeSchedule::GetWaitCount() const
+{
+    size_t count = 0;
+    for (const AsyncComputeBatch& batch : batches)
+        count += batch.waits.size();
+    return count;
+}
+
+AsyncComputeSchedule ScheduleAsyncCompute(const std::vector<AsyncComputeTask>& tasks, bool enableComputeQueue)
+{
+    const uint32_t taskCount = uint32_t(tasks.size());
+    const std::vector<std::vector<uint32_t>> dependencies = FindDependencies(tasks);
+
+    AsyncComputeSchedule schedule;
+    schedule.taskQueues.assign(taskCount, QueueType::Graphics);
+    schedule.taskBatches.assign(taskCount, c_None);
+
+    // Assign the queues: compute when a graphics task can overlap the task
+
+    if (enableComputeQueue)
+    {
+        std::vector<std::vector<bool>> ancestors(taskCount, std::vector<bool>(taskCount, false));
+        for (uint32_t taskIndex = 0; taskIndex < taskCount; taskIndex++)
+        {
+            for (uint32_t dependency : dependencies[taskIndex])
+            {
+                ancestors[taskIndex][dependency] = true;
+                for (uint32_t ancestor = 0; ancestor < dependency; ancestor++)
+                {
+                    if (ancestors[dependency][ancestor])
+                        ancestors[taskIndex][ancestor] = true;
+                }
+            }
+        }
+
+        for (uint32_t taskIndex = 0; taskIndex < taskCount; taskIndex++)
+        {
+            if (!tasks[taskIndex].allowCompute)
+                continue;
+
+            for (uint32_t other = 0; other < taskCount; other++)
+            {
+                if (!tasks[other].allowCompute && !ancestors[taskIndex][other] && !ancestors[other][taskIndex])
+                {
+                    schedule.taskQueues[taskIndex] = QueueType::Compute;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Interleave the queues and cut them into batches at the waits
+
+    AsyncComputeBatch openBatches[2];
+    uint32_t waitedBatches[2] = { c_None, c_None };    // last batch of the other queue that each queue waited for
+    uint32_t nextTasks[2] = { 0, 0 };                   // first unscheduled task of each queue
+
+    auto findNextTask = [&schedule, taskCount](uint32_t queueIndex, uint32_t start)
+    {
+        while (start < taskCount && GetQueueIndex(schedule.taskQueues[start]) != queueIndex)
+            start++;
+        return start;
+    };
+
+    auto isScheduled = [&schedule, &openBatches](uint32_t task)
+    {
+        if (schedule.taskBatches[task] != c_None)
+            return true;
+        for (const AsyncComputeBatch& batch : openBatches)
+        {
+            if (std::find(batch.tasks.begin(), batch.tasks.end(), task) != batch.tasks.end())
+                return true;
+        }
+        return false;
+    };
+
+    auto closeBatch = [&schedule, &openBatches](uint32_t queueIndex)
+    {
+        AsyncComputeBatch& batch = openBatches[queueIndex];
+        if (batch.tasks.empty())
+            return;
+
+        const uint32_t batchIndex = uint32_t(schedule.batches.size());
+        for (uint32_t task : batch.tasks)
+            schedule.taskBatches[task] = batchIndex;
+
+        batch.queue = queueIndex ? QueueType::Compute : QueueType::Graphics;
+        schedule.batches.push_back(std::move(batch));
+        batch = AsyncComputeBatch();
+    };
+
+    nextTasks[0] = findNextTask(0, 0);
+    nextTasks[1] = findNextTask(1, 0);
+
+    while (nextTasks[0] < taskCount || nextTasks[1] < taskCount)
+    {
+        // The earliest unscheduled task is always ready, its dependencies are declared before it
+        auto isReady = [&](uint32_t task)
+        {
+            return task < taskCount && std::all_of(dependencies[task].begin(), dependencies[task].end(), isScheduled);
+        };
+
+        const uint32_t queueIndex = isReady(nextTasks[1]) ? 1 : 0;
+        const uint32_t otherQueueIndex = 1 - queueIndex;
+        const uint32_t task = nextTasks[queueIndex];
+
+        uint32_t requiredBatch = c_None;
+        for (uint32_t dependency : dependencies[task])
+        {
+            if (GetQueueIndex(schedule.taskQueues[dependency]) != otherQueueIndex)
+                continue;
+
+            // The batch has to be submitted before a wait can refer to it
+            if (schedule.taskBatches[dependency] == c_None)
+                closeBatch(otherQueueIndex);
+
+            const uint32_t batch = schedule.taskBatches[dependency];
+            if (requiredBatch == c_None || batch > requiredBatch)
+                requiredBatch = batch;
+        }
+
+        if (requiredBatch != c_None && (waitedBatches[queueIndex] == c_None || requiredBatch > waitedBatches[queueIndex]))
+        {
+            closeBatch(queueIndex);
+            openBatches[queueIndex].waits.push_back(requiredBatch);
+            waitedBatches[queueIndex] = requiredBatch;
+        }
+
+        openBatches[queueIndex].tasks.push_back(task);
+        nextTasks[queueIndex] = findNextTask(queueIndex, task + 1);
+    }
+
+    // Submit the remaining batches in the order of their first tasks
+    const bool computeFirst = !openBatches[1].tasks.empty() &&
+        (openBatches[0].tasks.empty() || openBatches[1].tasks.front() < openBatches[0].tasks.front());
+    closeBatch(computeFirst ? 1 : 0);
+    closeBatch(computeFirst ? 0 : 1);
+
+    return schedule;
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include "RenderGraph.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Assignment of the tasks of a frame to the graphics and compute queues, and the waits between them.
+//
+// The tasks declare their resource accesses like render graph passes, in the order the frame records
+// them. A task depends on the earlier tasks that write what it reads, and on the earlier tasks that
+// access what it writes. A task that allows it runs on the compute queue when some graphics task
+// neither depends on it nor is one of its dependencies: otherwise there is no work to overlap with, and
+// it stays on the graphics queue without the cost of the waits.
+//
+// The tasks of each queue keep their declaration order. Consecutive tasks of a queue form a batch,
+// one command list, and a batch that depends on a batch of the other queue waits for it before it
+// starts. A wait covers the earlier batches of that queue as well, so a queue never waits for the same
+// batch twice. When both queues have a ready task, the compute task is placed first, so the graphics
+// batch it waits for ends right after the tasks it depends on.
+//
+// The module has no dependencies on the renderer.
+
+enum class QueueType : uint8_t
+{
+    Graphics,
+    Compute
+};
+
+struct AsyncComputeTask
+{
+    std::string name;
+    std::vector<RenderGraphUse> uses;
+    bool allowCompute = false;      // can run on the compute queue
+};
+
+struct AsyncComputeBatch
+{
+    QueueType queue = QueueType::Graphics;
+    std::vector<uint32_t> tasks;    // in recording order
+    std::vector<uint32_t> waits;    // earlier batches of the other queue to wait for before starting
+};
+
+struct AsyncComputeSchedule
+{
+    std::vector<QueueType> taskQueues;      // by task
+    std::vector<uint32_t> taskBatches;      // by task
+    std::vector<AsyncComputeBatch> batches; // in submission order
+
+    [[nodiscard]] size_t GetWaitCount() const;
+};
+
+// Everything runs in one graphics batch when the compute queue is disabled
+AsyncComputeSchedule ScheduleAsyncCompute(const std::vector<AsyncComputeTask>& tasks, bool enableComputeQueue);
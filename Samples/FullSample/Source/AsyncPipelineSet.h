@@ -0,0 +1,159 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include "PipelineJobList.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Background build of a set of pipelines that replaces the live set all at once.
+//
+// Every build owns a complete staging set of type T, and its jobs write only to that set. The renderer
+// keeps using the live set while a build runs. Commit, called at a frame boundary, moves the staging set
+// into the live one only when every job of the build succeeded, so a frame never sees a mix of old and
+// new pipelines. Starting a build while another one runs supersedes the older build: it runs to
+// completion, because driver compiles can't be interrupted, but it is never committed, and its set is
+// released with the build. The replaced live set is released by Commit on the calling thread.
+//
+// The module has no dependencies on the renderer, T only has to be default constructible and movable.
+
+enum class AsyncPipelineStatus
+{
+    Idle,       // no build was started since the last commit
+    Building,   // the newest build is still running
+    Committed,  // the newest build succeeded and its set is now live
+    Failed      // the newest build failed, the live set is unchanged unless commitFailed was set
+};
+
+template<typename T>
+class AsyncPipelineSet
+{
+public:
+    // Adds the jobs that fill the given staging set
+    using JobFactory = std::function<void(T& set, PipelineJobList& jobs)>;
+
+    AsyncPipelineSet() = default;
+    ~AsyncPipelineSet() { Wait(); }
+
+    AsyncPipelineSet(const AsyncPipelineSet&) = delete;
+    AsyncPipelineSet& operator=(const AsyncPipelineSet&) = delete;
+
+    // Creates the jobs on the calling thread and starts them with the launcher.
+    void Start(const JobFactory& createJobs, const PipelineJobLauncher& launch)
+    {
+        auto build = std::make_shared<PendingBuild>();
+        createJobs(build->set, build->jobs);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            build->generation = ++m_generation;
+            m_newest = build;
+            m_runningBuilds++;
+        }
+
+        build->jobs.RunAsync(launch, [this, build](bool succeeded)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            build->succeeded = succeeded;
+            build->finished = true;
+            m_runningBuilds--;
+            m_buildFinished.notify_all();
+        });
+    }
+
+    // Creates and runs the jobs, blocking until they are done. Commit makes the set live.
+    void Build(const JobFactory& createJobs, const PipelineJobParallelFor& parallelFor)
+    {
+        Start(createJobs, [&parallelFor](size_t taskCount, std::function<void(size_t task)> task, std::function<void()> done)
+        {
+            if (parallelFor && taskCount > 1)
+                parallelFor(taskCount, task);
+            else
+                SerialPipelineJobFor(taskCount, task);
+            done();
+        });
+    }
+
+    // Makes the newest build live if it has finished successfully. Call between frames.
+    // With commitFailed, a failed build is made live as well, for when there is no working set to keep.
+    AsyncPipelineStatus Commit(T& live, bool commitFailed = false)
+    {
+        std::shared_ptr<PendingBuild> build;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_newest)
+                return AsyncPipelineStatus::Idle;
+            if (!m_newest->finished)
+                return AsyncPipelineStatus::Building;
+            build = std::move(m_newest);
+        }
+
+        m_lastFailures = build->jobs.GetFailures();
+        m_lastBuildMs = build->jobs.GetWallTimeMs();
+        m_lastJobCount = build->jobs.GetJobCount();
+
+        if (!build->succeeded && !commitFailed)
+            return AsyncPipelineStatus::Failed;
+
+        // The old set is released here when it goes out of scope, not on a worker thread
+        T replaced = std::move(live);
+        live = std::move(build->set);
+        m_committedGeneration = build->generation;
+        return build->succeeded ? AsyncPipelineStatus::Committed : AsyncPipelineStatus::Failed;
+    }
+
+    // Blocks until all builds, including the superseded ones, have finished
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_buildFinished.wait(lock, [this]() { return m_runningBuilds == 0; });
+    }
+
+    [[nodiscard]] bool IsBuilding() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_newest && !m_newest->finished;
+    }
+
+    // Failed jobs of the last committed or failed build, in job order
+    [[nodiscard]] const std::vector<std::string>& GetLastFailures() const { return m_lastFailures; }
+    [[nodiscard]] double GetLastBuildMs() const { return m_lastBuildMs; }
+    [[nodiscard]] size_t GetLastJobCount() const { return m_lastJobCount; }
+
+    // Number of the build whose set is live, builds are numbered from 1 in the order they were started
+    [[nodiscard]] uint64_t GetCommittedGeneration() const { return m_committedGeneration; }
+
+private:
+    struct PendingBuild
+    {
+        T set;
+        PipelineJobList jobs;
+        uint64_t generation = 0;
+        bool succeeded = false;
+        bool finished = false;      // guarded by m_mutex
+    };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_buildFinished;
+    std::shared_ptr<PendingBuild> m_newest;
+    uint32_t m_runningBuilds = 0;
+    uint64_t m_generation = 0;
+    uint64_t m_committedGeneration = 0;
+    std::vector<std::string> m_lastFailures;
+    double m_lastBuildMs = 0.0;
+    size_t m_lastJobCount = 0;
+};
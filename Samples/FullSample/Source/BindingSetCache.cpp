@@ -0,0 +1,46 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "BindingSetCache.h"
+#include "SceneCache.h"
+
+uint64_t HashBindingSetKey(const BindingSetCacheKey& key)
+{
+    SceneCacheHasher hasher;
+
+    const uint64_t layout = uint64_t(reinterpret_cast<uintptr_t>(key.layout));
+    hasher.Update(&layout, sizeof(layout));
+
+    for (const BindingSetCacheItem& item : key.items)
+    {
+        // Field by field, the struct has padding
+        const uint64_t resource = uint64_t(reinterpret_cast<uintptr_t>(item.resource));
+        hasher.Update(&item.slot, sizeof(item.slot));
+        hasher.Update(&item.type, sizeof(item.type));
+        hasher.Update(&resource, sizeof(resource));
+        hasher.Update(&item.view, sizeof(item.view));
+    }
+
+    return hasher.GetHash();
+}
+
+std::vector<uint32_t> DiffBindingSetItems(const BindingSetCacheKey& previous, const BindingSetCacheKey& current)
+{
+    std::vector<uint32_t> changed;
+    const bool sameLayout = previous.layout == current.layout;
+
+    for (uint32_t index = 0; index < uint32_t(current.items.size()); index++)
+    {
+        if (!sameLayout || index >= previous.items.size() || previous.items[index] != current.items[index])
+            changed.push_back(index);
+    }
+
+    return changed;
+}
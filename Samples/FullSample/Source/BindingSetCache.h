@@ -0,0 +1,199 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Cache of binding sets keyed by the hash of their layout and items.
+//
+// Every binding set belongs to one or more owners, named slots like "LightingPasses/Current". Requesting
+// a set for an owner returns an existing set with the same layout and the same items when there is one,
+// and creates it otherwise. ReleaseUnused, called after a round of requests, releases the sets that no
+// owner uses anymore, so the cache never keeps the resources of replaced render targets alive, unlike a
+// cache that only grows. Until then, owners can trade sets, like the current and previous frame sets
+// that a pass swaps every frame.
+//
+// Binding sets can't be modified after creation, so when the resources of an owner moved, its set is
+// recreated, but only that one: the sets of the other owners are reused as long as their items are
+// unchanged. The items that differ from the previous set of the owner are counted, and the hit rate of
+// the requests is reported.
+//
+// An item is identified by its slot, its type, the address of the bound object and a hash of the view
+// parameters. The cached set references the bound objects, so their addresses can't be reused by other
+// objects while the set is in the cache.
+//
+// The module has no dependencies on the renderer, Handle only has to be copyable and testable with !.
+// Like the device objects it creates, the cache is not thread-safe.
+
+struct BindingSetCacheItem
+{
+    uint32_t slot = 0;
+    uint32_t type = 0;              // resource type of the binding, like nvrhi::ResourceType
+    const void* resource = nullptr; // bound object, null for push constants
+    uint64_t view = 0;              // hash of the view parameters: format, dimension, subresources or range
+
+    bool operator==(const BindingSetCacheItem& other) const
+    {
+        return slot == other.slot && type == other.type && resource == other.resource && view == other.view;
+    }
+
+    bool operator!=(const BindingSetCacheItem& other) const { return !(*this == other); }
+};
+
+struct BindingSetCacheKey
+{
+    const void* layout = nullptr;
+    std::vector<BindingSetCacheItem> items;
+
+    bool operator==(const BindingSetCacheKey& other) const { return layout == other.layout && items == other.items; }
+};
+
+// Depends on the order of the items, like the binding set does
+uint64_t HashBindingSetKey(const BindingSetCacheKey& key);
+
+// Indices of the items of current that differ from the items at the same index in previous.
+// Every index when the layouts differ.
+std::vector<uint32_t> DiffBindingSetItems(const BindingSetCacheKey& previous, const BindingSetCacheKey& current);
+
+struct BindingSetCacheStats
+{
+    uint64_t requests = 0;
+    uint64_t hits = 0;              // requests that returned an existing set
+    uint64_t creations = 0;         // sets created, including failed creations
+    uint64_t createdItems = 0;      // items of the created sets
+    uint64_t changedItems = 0;      // items of the created sets that differ from the previous set of their owner
+    size_t liveSets = 0;            // sets in the cache, including unused sets until ReleaseUnused
+
+    [[nodiscard]] double GetHitRate() const { return requests ? double(hits) / double(requests) : 0.0; }
+};
+
+template<typename Handle>
+class BindingSetCache
+{
+public:
+    using CreateFunction = std::function<Handle()>;
+
+    // Returns the set with the key, calling create when there is none, and makes it the set of the owner.
+    // A null set is returned but not cached, and the owner keeps its previous set.
+    Handle GetOrCreate(const std::string& owner, const BindingSetCacheKey& key, const CreateFunction& create)
+    {
+        m_stats.requests++;
+
+        const uint64_t hash = HashBindingSetKey(key);
+        std::shared_ptr<Entry> entry = Find(hash, key);
+
+        auto previous = m_owners.find(owner);
+        if (entry)
+        {
+            m_stats.hits++;
+        }
+        else
+        {
+            m_stats.creations++;
+            m_stats.createdItems += key.items.size();
+            m_stats.changedItems += previous != m_owners.end()
+                ? DiffBindingSetItems(previous->second->key, key).size()
+                : key.items.size();
+
+            Handle handle = create();
+            if (!handle)
+                return handle;
+
+            entry = std::make_shared<Entry>();
+            entry->key = key;
+            entry->handle = std::move(handle);
+            m_entries.emplace(hash, entry);
+        }
+
+        if (previous == m_owners.end())
+        {
+            entry->owners++;
+            m_owners.emplace(owner, entry);
+        }
+        else if (previous->second != entry)
+        {
+            entry->owners++;
+            previous->second->owners--;
+            previous->second = entry;
+        }
+
+        m_stats.liveSets = m_entries.size();
+        return entry->handle;
+    }
+
+    // The owner no longer needs a set
+    void Release(const std::string& owner)
+    {
+        auto it = m_owners.find(owner);
+        if (it == m_owners.end())
+            return;
+
+        it->second->owners--;
+        m_owners.erase(it);
+    }
+
+    // Releases the sets that are not the set of any owner, returns their number
+    size_t ReleaseUnused()
+    {
+        size_t released = 0;
+        for (auto it = m_entries.begin(); it != m_entries.end(); )
+        {
+            if (it->second->owners == 0)
+            {
+                it = m_entries.erase(it);
+                released++;
+            }
+            else
+                ++it;
+        }
+
+        m_stats.liveSets = m_entries.size();
+        return released;
+    }
+
+    void Clear()
+    {
+        m_owners.clear();
+        m_entries.clear();
+        m_stats.liveSets = 0;
+    }
+
+    [[nodiscard]] const BindingSetCacheStats& GetStats() const { return m_stats; }
+    void ResetStats() { m_stats = BindingSetCacheStats(); m_stats.liveSets = m_entries.size(); }
+
+private:
+    struct Entry
+    {
+        BindingSetCacheKey key;
+        Handle handle;
+        uint32_t owners = 0;
+    };
+
+    std::shared_ptr<Entry> Find(uint64_t hash, const BindingSetCacheKey& key) const
+    {
+        auto range = m_entries.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second->key == key)
+                return it->second;
+        }
+        return nullptr;
+    }
+
+    std::unordered_map<std::string, std::shared_ptr<Entry>> m_owners;
+    std::unordered_multimap<uint64_t, std::shared_ptr<Entry>> m_entries;
+    BindingSetCacheStats m_stats;
+};
@@ -0,0 +1,114 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "BlasBuildPlanner.h"
+
+#include <algorithm>
+#include <numeric>
+
+static bool FitsIntoBatch(const BlasBuildBatch& batch, const BlasBuildRequest& request, const BlasBuildPlannerSettings& settings)
+{
+    // An empty batch accepts anything, oversized requests are built on their own
+    if (batch.requests.empty())
+        return true;
+
+    if (batch.scratchSize + request.scratchSize > settings.scratchBudget)
+        return false;
+
+    if (settings.maxBatchCost != 0 && batch.cost + request.cost > settings.maxBatchCost)
+        return false;
+
+    return true;
+}
+
+static void AddToBatch(BlasBuildBatch& batch, const BlasBuildRequest& request, uint32_t index)
+{
+    batch.requests.push_back(index);
+    batch.scratchSize += request.scratchSize;
+    batch.cost += request.cost;
+}
+
+std::vector<BlasBuildBatch> PlanBlasBuildBatches(const std::vector<BlasBuildRequest>& requests, const BlasBuildPlannerSettings& settings)
+{
+    std::vector<uint32_t> order(requests.size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    std::vector<BlasBuildBatch> batches;
+
+    if (settings.order == BlasBuildOrder::CheapestFirst)
+    {
+        std::stable_sort(order.begin(), order.end(), [&requests](uint32_t a, uint32_t b)
+        {
+            return requests[a].cost < requests[b].cost;
+        });
+
+        // Next-fit keeps the batches in cost order
+        for (uint32_t index : order)
+        {
+            const BlasBuildRequest& request = requests[index];
+
+            if (batches.empty() || !FitsIntoBatch(batches.back(), request, settings))
+                batches.emplace_back();
+
+            AddToBatch(batches.back(), request, index);
+        }
+    }
+    else
+    {
+        std::stable_sort(order.begin(), order.end(), [&requests](uint32_t a, uint32_t b)
+        {
+            return requests[a].cost > requests[b].cost;
+        });
+
+        // First-fit decreasing
+        for (uint32_t index : order)
+        {
+            const BlasBuildRequest& request = requests[index];
+
+            auto batch = std::find_if(batches.begin(), batches.end(), [&request, &settings](const BlasBuildBatch& batch)
+            {
+                return FitsIntoBatch(batch, request, settings);
+            });
+
+            if (batch == batches.end())
+                batch = batches.emplace(batches.end());
+
+            AddToBatch(*batch, request, index);
+        }
+    }
+
+    return batches;
+}
+
+HeapLayout PlanHeapLayout(const std::vector<HeapLayoutRequest>& requests)
+{
+    std::vector<uint32_t> order(requests.size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    std::stable_sort(order.begin(), order.end(), [&requests](uint32_t a, uint32_t b)
+    {
+        return requests[a].alignment > requests[b].alignment;
+    });
+
+    HeapLayout layout;
+    layout.offsets.resize(requests.size());
+
+    for (uint32_t index : order)
+    {
+        const HeapLayoutRequest& request = requests[index];
+        const uint64_t alignment = std::max<uint64_t>(request.alignment, 1);
+
+        layout.size = (layout.size + alignment - 1) & ~(alignment - 1);
+        layout.offsets[index] = layout.size;
+        layout.size += request.size;
+    }
+
+    return layout;
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Splits a set of BLAS builds into batches that each fit into a scratch memory budget.
+// Every batch is meant to be recorded into its own command list, or into a separate frame,
+// so that the scratch memory of one batch can be recycled before the next one is built.
+// The planner only works with sizes and costs, the caller maps the request indices back to meshes.
+
+enum class BlasBuildOrder
+{
+    // Cheap builds first, in order, so that as many meshes as possible become available early
+    CheapestFirst,
+
+    // Expensive builds first, packed with first-fit, which produces the fewest batches
+    MostExpensiveFirst
+};
+
+struct BlasBuildRequest
+{
+    uint64_t scratchSize = 0;
+    uint64_t cost = 0;          // relative build cost estimate, e.g. the triangle count
+};
+
+struct BlasBuildBatch
+{
+    std::vector<uint32_t> requests; // indices into the request array
+    uint64_t scratchSize = 0;
+    uint64_t cost = 0;
+};
+
+struct BlasBuildPlannerSettings
+{
+    // Scratch memory that a single batch may use. A request that is larger than the budget on its own
+    // gets a batch of its own.
+    uint64_t scratchBudget = 256ull << 20;
+
+    // Optional limit on the total cost of a batch, 0 for no limit. Keeps progressive builds from
+    // taking too much time in any single frame.
+    uint64_t maxBatchCost = 0;
+
+    BlasBuildOrder order = BlasBuildOrder::CheapestFirst;
+
+    // Build the static BLAS'es over multiple frames instead of at load time
+    bool progressive = true;
+};
+
+std::vector<BlasBuildBatch> PlanBlasBuildBatches(const std::vector<BlasBuildRequest>& requests, const BlasBuildPlannerSettings& settings);
+
+struct HeapLayoutRequest
+{
+    uint64_t size = 0;
+    uint64_t alignment = 1;     // power of two
+};
+
+struct HeapLayout
+{
+    std::vector<uint64_t> offsets;  // one per request, in request order
+    uint64_t size = 0;
+};
+
+// Places a set of allocations into one heap. Allocations with larger alignment are placed first,
+// which keeps the padding between allocations to a minimum.
+HeapLayout PlanHeapLayout(const std::vector<HeapLayoutRequest>& requests);
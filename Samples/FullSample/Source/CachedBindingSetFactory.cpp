@@ -0,0 +1,76 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "CachedBindingSetFactory.h"
+#include "SceneCache.h"
+
+static bool IsTextureBinding(nvrhi::ResourceType type)
+{
+    return type == nvrhi::ResourceType::Texture_SRV || type == nvrhi::ResourceType::Texture_UAV;
+}
+
+static BindingSetCacheKey MakeBindingSetCacheKey(const nvrhi::BindingSetDesc& desc, nvrhi::IBindingLayout* layout)
+{
+    BindingSetCacheKey key;
+    key.layout = layout;
+    key.items.reserve(desc.bindings.size());
+
+    for (const nvrhi::BindingSetItem& binding : desc.bindings)
+    {
+        // The subresources and the buffer range share storage, hash only the one the binding uses
+        SceneCacheHasher hasher;
+        hasher.Update(&binding.format, sizeof(binding.format));
+        hasher.Update(&binding.dimension, sizeof(binding.dimension));
+        if (IsTextureBinding(binding.type))
+        {
+            hasher.Update(&binding.subresources.baseMipLevel, sizeof(binding.subresources.baseMipLevel));
+            hasher.Update(&binding.subresources.numMipLevels, sizeof(binding.subresources.numMipLevels));
+            hasher.Update(&binding.subresources.baseArraySlice, sizeof(binding.subresources.baseArraySlice));
+            hasher.Update(&binding.subresources.numArraySlices, sizeof(binding.subresources.numArraySlices));
+        }
+        else
+        {
+            hasher.Update(&binding.range.byteOffset, sizeof(binding.range.byteOffset));
+            hasher.Update(&binding.range.byteSize, sizeof(binding.range.byteSize));
+        }
+
+        BindingSetCacheItem item;
+        item.slot = binding.slot;
+        item.type = uint32_t(binding.type);
+        item.resource = binding.resourceHandle;
+        item.view = hasher.GetHash();
+        key.items.push_back(item);
+    }
+
+    return key;
+}
+
+CachedBindingSetFactory::CachedBindingSetFactory(nvrhi::IDevice* device)
+    : m_device(device)
+{
+}
+
+nvrhi::BindingSetHandle CachedBindingSetFactory::CreateBindingSet(const std::string& owner, const nvrhi::BindingSetDesc& desc, nvrhi::IBindingLayout* layout)
+{
+    return m_cache.GetOrCreate(owner, MakeBindingSetCacheKey(desc, layout), [this, &desc, layout]()
+    {
+        return m_device->createBindingSet(desc, layout);
+    });
+}
+
+void CachedBindingSetFactory::ReleaseUnused()
+{
+    m_cache.ReleaseUnused();
+}
+
+const BindingSetCacheStats& CachedBindingSetFactory::GetStats() const
+{
+    return m_cache.GetStats();
+}
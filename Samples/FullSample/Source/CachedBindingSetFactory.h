@@ -0,0 +1,40 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include "BindingSetCache.h"
+
+#include <nvrhi/nvrhi.h>
+
+#include <string>
+
+// Binding set factory of the application passes, which reuses the sets of a BindingSetCache.
+//
+// The passes name every set they create with an owner, so recreating the render targets or the RTXDI
+// resources recreates only the sets that reference the replaced resources, and ReleaseUnused releases the
+// replaced sets. Like the device, this is used from the render thread only.
+class CachedBindingSetFactory
+{
+public:
+    explicit CachedBindingSetFactory(nvrhi::IDevice* device);
+
+    // Returns the set of the owner for the description, reusing an existing set with the same items
+    nvrhi::BindingSetHandle CreateBindingSet(const std::string& owner, const nvrhi::BindingSetDesc& desc, nvrhi::IBindingLayout* layout);
+
+    // Call after the passes have requested their sets, releases the replaced sets
+    void ReleaseUnused();
+
+    [[nodiscard]] const BindingSetCacheStats& GetStats() const;
+
+private:
+    nvrhi::DeviceHandle m_device;
+    BindingSetCache<nvrhi::BindingSetHandle> m_cache;
+};
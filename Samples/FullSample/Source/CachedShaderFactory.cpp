@@ -0,0 +1,184 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "CachedShaderFactory.h"
+#include "ShaderConfig.h"
+#include "ShaderPermutationCache.h"
+
+#include <donut/engine/ShaderFactory.h>
+
+#include <cstring>
+
+static const char c_AppShaderPrefix[] = "app/";
+
+static std::vector<ShaderPermutationMacro> ConvertMacros(const std::vector<donut::engine::ShaderMacro>* pDefines)
+{
+    std::vector<ShaderPermutationMacro> macros;
+    if (pDefines)
+    {
+        for (const donut::engine::ShaderMacro& define : *pDefines)
+            macros.push_back({ define.name, define.definition });
+    }
+    return macros;
+}
+
+// Target profile names of Shaders.cfg
+static const char* GetTargetName(nvrhi::ShaderType shaderType)
+{
+    switch (shaderType)
+    {
+    case nvrhi::ShaderType::Vertex: return "vs";
+    case nvrhi::ShaderType::Hull: return "hs";
+    case nvrhi::ShaderType::Domain: return "ds";
+    case nvrhi::ShaderType::Geometry: return "gs";
+    case nvrhi::ShaderType::Pixel: return "ps";
+    case nvrhi::ShaderType::Compute: return "cs";
+    case nvrhi::ShaderType::Amplification: return "as";
+    case nvrhi::ShaderType::Mesh: return "ms";
+    default: return "lib";
+    }
+}
+
+CachedShaderFactory::CachedShaderFactory(nvrhi::IDevice* device, donut::engine::ShaderFactory& shaderFactory, ShaderPermutationCache* cache,
+    std::filesystem::path appShaderPath)
+    : m_device(device)
+    , m_shaderFactory(shaderFactory)
+    , m_cache(cache)
+    , m_appShaderPath(std::move(appShaderPath))
+{
+}
+
+void CachedShaderFactory::RecordUsage(const char* fileName, const char* entryName, const char* target,
+    const std::vector<donut::engine::ShaderMacro>* pDefines)
+{
+    if (!m_usageRecorder)
+        return;
+
+    const std::string path = NormalizeShaderPath(fileName);
+    if (path.compare(0, sizeof(c_AppShaderPrefix) - 1, c_AppShaderPrefix) != 0)
+        return;
+
+    m_usageRecorder->Record(MakeShaderConfigPermutation(path.substr(sizeof(c_AppShaderPrefix) - 1), target, entryName ? entryName : "",
+        ConvertMacros(pDefines)));
+}
+
+bool CachedShaderFactory::GetBinaryHash(const char* fileName, const char* entryName, uint64_t& binaryHash)
+{
+    if (!m_cache || m_appShaderPath.empty())
+        return false;
+
+    // Same naming as the donut factory: the source extension is replaced, non-default entries get a suffix
+    std::string binaryName = NormalizeShaderPath(fileName);
+    if (binaryName.compare(0, sizeof(c_AppShaderPrefix) - 1, c_AppShaderPrefix) != 0)
+        return false;
+
+    binaryName = binaryName.substr(sizeof(c_AppShaderPrefix) - 1);
+    const size_t extension = binaryName.rfind(".hlsl");
+    if (extension != std::string::npos)
+        binaryName.erase(extension);
+    if (entryName && strcmp(entryName, "main") != 0)
+        binaryName += std::string("_") + entryName;
+    binaryName += ".bin";
+
+    const auto found = m_binaryHashes.find(binaryName);
+    if (found != m_binaryHashes.end())
+    {
+        binaryHash = found->second;
+        return true;
+    }
+
+    if (!HashShaderBinaryFile(m_appShaderPath / binaryName, binaryHash))
+        return false;
+
+    m_binaryHashes[binaryName] = binaryHash;
+    return true;
+}
+
+nvrhi::ShaderHandle CachedShaderFactory::CreateShader(const char* fileName, const char* entryName,
+    const std::vector<donut::engine::ShaderMacro>* pDefines, nvrhi::ShaderType shaderType)
+{
+    RecordUsage(fileName, entryName, GetTargetName(shaderType), pDefines);
+
+    uint64_t binaryHash = 0;
+    if (!GetBinaryHash(fileName, entryName, binaryHash))
+        return m_shaderFactory.CreateShader(fileName, entryName, pDefines, shaderType);
+
+    const ShaderPermutationKey key = MakeShaderPermutationKey(fileName, entryName, ConvertMacros(pDefines), binaryHash);
+
+    size_t size = 0;
+    if (const void* bytecode = m_cache->Find(key, ShaderCacheBlobType::ShaderBinary, size))
+    {
+        nvrhi::ShaderDesc desc;
+        desc.shaderType = shaderType;
+        desc.entryName = entryName;
+        desc.debugName = fileName;
+
+        nvrhi::ShaderHandle shader = m_device->createShader(desc, bytecode, size);
+        if (shader)
+            return shader;
+    }
+
+    nvrhi::ShaderHandle shader = m_shaderFactory.CreateShader(fileName, entryName, pDefines, shaderType);
+    if (shader)
+    {
+        const void* bytecode = nullptr;
+        shader->getBytecode(&bytecode, &size);
+        if (bytecode && size)
+            m_cache->Store(key, ShaderCacheBlobType::ShaderBinary, bytecode, size);
+    }
+
+    return shader;
+}
+
+nvrhi::ShaderLibraryHandle CachedShaderFactory::CreateShaderLibrary(const char* fileName, const std::vector<donut::engine::ShaderMacro>* pDefines)
+{
+    RecordUsage(fileName, nullptr, "lib", pDefines);
+
+    // Libraries are compiled with the default entry name, and the key has an empty one
+    uint64_t binaryHash = 0;
+    if (!GetBinaryHash(fileName, "main", binaryHash))
+        return m_shaderFactory.CreateShaderLibrary(fileName, pDefines);
+
+    const ShaderPermutationKey key = MakeShaderPermutationKey(fileName, "", ConvertMacros(pDefines), binaryHash);
+
+    size_t size = 0;
+    if (const void* bytecode = m_cache->Find(key, ShaderCacheBlobType::ShaderBinary, size))
+    {
+        nvrhi::ShaderLibraryHandle library = m_device->createShaderLibrary(bytecode, size);
+        if (library)
+            return library;
+    }
+
+    nvrhi::ShaderLibraryHandle library = m_shaderFactory.CreateShaderLibrary(fileName, pDefines);
+    if (library)
+    {
+        const void* bytecode = nullptr;
+        library->getBytecode(&bytecode, &size);
+        if (bytecode && size)
+            m_cache->Store(key, ShaderCacheBlobType::ShaderBinary, bytecode, size);
+    }
+
+    return library;
+}
+
+ShaderPermutationCache* CachedShaderFactory::GetCache() const
+{
+    return m_cache;
+}
+
+void CachedShaderFactory::SetUsageRecorder(ShaderUsageRecorder* recorder)
+{
+    m_usageRecorder = recorder;
+}
+
+void CachedShaderFactory::ClearCache()
+{
+    m_binaryHashes.clear();
+}
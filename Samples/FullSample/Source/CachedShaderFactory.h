@@ -0,0 +1,75 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace donut::engine
+{
+    class ShaderFactory;
+    struct ShaderMacro;
+}
+
+class ShaderPermutationCache;
+class ShaderUsageRecorder;
+
+// Shader factory front end of the application passes, which serves permutations from a
+// ShaderPermutationCache and reports every request to a ShaderUsageRecorder.
+//
+// A hit creates the shader straight from the mapped bytecode, without opening the compiled shader blob
+// or searching it for the permutation. A miss goes through the donut shader factory and stores the
+// bytecode it returns. The binary hash of the key is a hash of the contents of the compiled blob file,
+// so rebuilt shaders never match old entries, even when a copy keeps the size and modification time of
+// the file. Every blob file is hashed once, until ClearCache. Shaders outside of the application shader
+// directory, and all shaders when there is no cache, go to the donut factory.
+//
+// Requests for application shaders are recorded with their path relative to the shader directory, as
+// they appear in Shaders.cfg, see ShaderConfig.h.
+//
+// Like the donut factory, this is not thread-safe.
+class CachedShaderFactory
+{
+public:
+    // appShaderPath is the native directory mounted at "/shaders/app", cache may be null.
+    // The shader factory and the cache must outlive this object.
+    CachedShaderFactory(nvrhi::IDevice* device, donut::engine::ShaderFactory& shaderFactory, ShaderPermutationCache* cache,
+        std::filesystem::path appShaderPath);
+
+    nvrhi::ShaderHandle CreateShader(const char* fileName, const char* entryName,
+        const std::vector<donut::engine::ShaderMacro>* pDefines, nvrhi::ShaderType shaderType);
+
+    nvrhi::ShaderLibraryHandle CreateShaderLibrary(const char* fileName, const std::vector<donut::engine::ShaderMacro>* pDefines);
+
+    [[nodiscard]] ShaderPermutationCache* GetCache() const;
+
+    // Receives every requested application shader permutation, may be null
+    void SetUsageRecorder(ShaderUsageRecorder* recorder);
+
+    // Forgets the hashes of the compiled blob files, call it with ShaderFactory::ClearCache
+    void ClearCache();
+
+private:
+    // Returns false if the shader can't be cached
+    bool GetBinaryHash(const char* fileName, const char* entryName, uint64_t& binaryHash);
+    void RecordUsage(const char* fileName, const char* entryName, const char* target, const std::vector<donut::engine::ShaderMacro>* pDefines);
+
+    nvrhi::IDevice* m_device;
+    donut::engine::ShaderFactory& m_shaderFactory;
+    ShaderPermutationCache* m_cache;
+    ShaderUsageRecorder* m_usageRecorder = nullptr;
+    std::filesystem::path m_appShaderPath;
+    std::unordered_map<std::string, uint64_t> m_binaryHashes;     // by blob file name
+};
@@ -0,0 +1,430 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "FrameRecording.h"
+
+#include <cstring>
+#include <sstream>
+
+static const char c_Magic[8] = { 'R', 'T', 'X', 'D', 'I', 'R', 'E', 'C' };
+
+// Upper limit for the settings snapshot, protects the reader from allocating garbage sizes
+constexpr uint32_t c_MaxSettingsSize = 1 << 20;
+
+// Unchanged runs shorter than this are folded into the surrounding settings span,
+// because a separate span would cost more than the bytes it skips
+constexpr uint32_t c_MinSettingsGap = 4;
+
+constexpr uint32_t c_ViewElementCount = 14;
+
+enum FrameFlags : uint8_t
+{
+    FrameFlag_View = 0x01,
+    FrameFlag_AnimationTime = 0x02,
+    FrameFlag_EnvironmentMap = 0x04,
+    FrameFlag_Settings = 0x08,
+    FrameFlag_ElapsedTime = 0x10,
+
+    FrameFlag_All = 0x1f
+};
+
+static void GetViewElements(const RecordedView& view, uint32_t elements[c_ViewElementCount])
+{
+    static_assert(sizeof(view.worldToView) == 12 * sizeof(uint32_t));
+    memcpy(elements, view.worldToView.data(), sizeof(view.worldToView));
+    memcpy(&elements[12], &view.verticalFov, sizeof(uint32_t));
+    memcpy(&elements[13], &view.zNear, sizeof(uint32_t));
+}
+
+static void SetViewElements(RecordedView& view, const uint32_t elements[c_ViewElementCount])
+{
+    memcpy(view.worldToView.data(), elements, sizeof(view.worldToView));
+    memcpy(&view.verticalFov, &elements[12], sizeof(uint32_t));
+    memcpy(&view.zNear, &elements[13], sizeof(uint32_t));
+}
+
+static uint32_t ZigZagEncode(int32_t value)
+{
+    return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+static int32_t ZigZagDecode(uint32_t value)
+{
+    return int32_t(value >> 1) ^ -int32_t(value & 1);
+}
+
+static void WriteVarint(std::ostream& stream, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        stream.put(char(uint8_t(value) | 0x80));
+        value >>= 7;
+    }
+    stream.put(char(value));
+}
+
+static bool ReadVarint(std::istream& stream, uint64_t& value)
+{
+    value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7)
+    {
+        const int byte = stream.get();
+        if (byte == std::char_traits<char>::eof())
+            return false;
+
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+static bool ReadVarint32(std::istream& stream, uint32_t& value)
+{
+    uint64_t wide;
+    if (!ReadVarint(stream, wide) || wide > UINT32_MAX)
+        return false;
+    value = uint32_t(wide);
+    return true;
+}
+
+template<typename T>
+static void WriteRaw(std::ostream& stream, const T& value)
+{
+    // Values are stored little-endian; the sample only runs on little-endian platforms
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool ReadRaw(std::istream& stream, T& value)
+{
+    stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return stream.gcount() == std::streamsize(sizeof(T));
+}
+
+template<typename T>
+static bool BitwiseEqual(const T& a, const T& b)
+{
+    return memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+FrameRecordWriter::FrameRecordWriter(std::ostream& stream)
+    : m_stream(stream)
+{
+}
+
+bool FrameRecordWriter::Begin(uint32_t settingsSize, uint64_t settingsLayout)
+{
+    if (settingsSize > c_MaxSettingsSize)
+        return false;
+
+    m_settingsSize = settingsSize;
+    m_frameCount = 0;
+    m_previous = RecordedFrame();
+    m_previous.frameIndex = UINT32_MAX; // the first frame is expected to be frame 0
+    m_previous.settings.assign(settingsSize, 0);
+
+    m_stream.write(c_Magic, sizeof(c_Magic));
+    WriteVarint(m_stream, Version);
+    WriteVarint(m_stream, settingsSize);
+    WriteRaw(m_stream, settingsLayout);
+
+    return m_stream.good();
+}
+
+bool FrameRecordWriter::WriteFrame(const RecordedFrame& frame)
+{
+    if (frame.settings.size() != m_settingsSize)
+        return false;
+
+    uint32_t viewElements[c_ViewElementCount];
+    uint32_t previousViewElements[c_ViewElementCount];
+    GetViewElements(frame.view, viewElements);
+    GetViewElements(m_previous.view, previousViewElements);
+
+    uint32_t viewMask = 0;
+    for (uint32_t i = 0; i < c_ViewElementCount; i++)
+    {
+        if (viewElements[i] != previousViewElements[i])
+            viewMask |= 1u << i;
+    }
+
+    // Find the settings byte ranges that changed, as (offset, length) pairs
+    std::vector<std::pair<uint32_t, uint32_t>> spans;
+    for (uint32_t offset = 0; offset < m_settingsSize; )
+    {
+        if (frame.settings[offset] == m_previous.settings[offset])
+        {
+            offset++;
+            continue;
+        }
+
+        uint32_t end = offset + 1;
+        uint32_t unchanged = 0;
+        for (uint32_t i = end; i < m_settingsSize && unchanged < c_MinSettingsGap; i++)
+        {
+            if (frame.settings[i] != m_previous.settings[i])
+            {
+                end = i + 1;
+                unchanged = 0;
+            }
+            else
+                unchanged++;
+        }
+
+        spans.push_back({ offset, end - offset });
+        offset = end;
+    }
+
+    uint8_t flags = 0;
+    if (viewMask)
+        flags |= FrameFlag_View;
+    if (!BitwiseEqual(frame.animationTime, m_previous.animationTime))
+        flags |= FrameFlag_AnimationTime;
+    if (frame.environmentMapIndex != m_previous.environmentMapIndex)
+        flags |= FrameFlag_EnvironmentMap;
+    if (!spans.empty())
+        flags |= FrameFlag_Settings;
+    if (!BitwiseEqual(frame.elapsedTime, m_previous.elapsedTime))
+        flags |= FrameFlag_ElapsedTime;
+
+    m_stream.put(char(flags));
+    WriteVarint(m_stream, ZigZagEncode(int32_t(frame.frameIndex - (m_previous.frameIndex + 1))));
+
+    if (flags & FrameFlag_View)
+    {
+        WriteVarint(m_stream, viewMask);
+        for (uint32_t i = 0; i < c_ViewElementCount; i++)
+        {
+            if (viewMask & (1u << i))
+                WriteRaw(m_stream, viewElements[i]);
+        }
+    }
+
+    if (flags & FrameFlag_AnimationTime)
+        WriteRaw(m_stream, frame.animationTime);
+
+    if (flags & FrameFlag_EnvironmentMap)
+        WriteVarint(m_stream, ZigZagEncode(frame.environmentMapIndex - m_previous.environmentMapIndex));
+
+    if (flags & FrameFlag_Settings)
+    {
+        WriteVarint(m_stream, spans.size());
+
+        uint32_t previousEnd = 0;
+        for (const auto& [offset, length] : spans)
+        {
+            WriteVarint(m_stream, offset - previousEnd);
+            WriteVarint(m_stream, length);
+            m_stream.write(reinterpret_cast<const char*>(frame.settings.data() + offset), length);
+            previousEnd = offset + length;
+        }
+    }
+
+    if (flags & FrameFlag_ElapsedTime)
+        WriteRaw(m_stream, frame.elapsedTime);
+
+    m_previous = frame;
+    m_frameCount++;
+
+    return m_stream.good();
+}
+
+uint32_t FrameRecordWriter::GetFrameCount() const
+{
+    return m_frameCount;
+}
+
+FrameRecordReader::FrameRecordReader(std::istream& stream)
+    : m_stream(stream)
+{
+}
+
+bool FrameRecordReader::Fail(const char* message)
+{
+    m_error = message;
+    return false;
+}
+
+bool FrameRecordReader::Begin()
+{
+    char magic[sizeof(c_Magic)];
+    m_stream.read(magic, sizeof(magic));
+    if (m_stream.gcount() != std::streamsize(sizeof(magic)) || memcmp(magic, c_Magic, sizeof(magic)) != 0)
+        return Fail("Not a frame recording");
+
+    uint32_t version;
+    if (!ReadVarint32(m_stream, version))
+        return Fail("Truncated header");
+
+    if (version != FrameRecordWriter::Version)
+    {
+        std::stringstream ss;
+        ss << "Unsupported recording version " << version << ", expected " << FrameRecordWriter::Version;
+        m_error = ss.str();
+        return false;
+    }
+
+    if (!ReadVarint32(m_stream, m_settingsSize))
+        return Fail("Truncated header");
+
+    if (m_settingsSize > c_MaxSettingsSize)
+        return Fail("Invalid settings size");
+
+    if (!ReadRaw(m_stream, m_settingsLayout))
+        return Fail("Truncated header");
+
+    m_frameCount = 0;
+    m_previous = RecordedFrame();
+    m_previous.frameIndex = UINT32_MAX;
+    m_previous.settings.assign(m_settingsSize, 0);
+
+    return true;
+}
+
+bool FrameRecordReader::ReadFrame(RecordedFrame& frame)
+{
+    if (!m_error.empty())
+        return false;
+
+    const int flagsByte = m_stream.get();
+    if (flagsByte == std::char_traits<char>::eof())
+        return false; // regular end of the recording
+
+    const uint8_t flags = uint8_t(flagsByte);
+    if (flags & ~FrameFlag_All)
+        return Fail("Corrupted frame header");
+
+    RecordedFrame current = m_previous;
+
+    uint32_t frameIndexDelta;
+    if (!ReadVarint32(m_stream, frameIndexDelta))
+        return Fail("Truncated frame");
+    current.frameIndex = m_previous.frameIndex + 1 + uint32_t(ZigZagDecode(frameIndexDelta));
+
+    if (flags & FrameFlag_View)
+    {
+        uint32_t viewMask;
+        if (!ReadVarint32(m_stream, viewMask) || viewMask >= (1u << c_ViewElementCount))
+            return Fail("Corrupted view mask");
+
+        uint32_t viewElements[c_ViewElementCount];
+        GetViewElements(current.view, viewElements);
+        for (uint32_t i = 0; i < c_ViewElementCount; i++)
+        {
+            if ((viewMask & (1u << i)) && !ReadRaw(m_stream, viewElements[i]))
+                return Fail("Truncated frame");
+        }
+        SetViewElements(current.view, viewElements);
+    }
+
+    if ((flags & FrameFlag_AnimationTime) && !ReadRaw(m_stream, current.animationTime))
+        return Fail("Truncated frame");
+
+    if (flags & FrameFlag_EnvironmentMap)
+    {
+        uint32_t delta;
+        if (!ReadVarint32(m_stream, delta))
+            return Fail("Truncated frame");
+        current.environmentMapIndex += ZigZagDecode(delta);
+    }
+
+    if (flags & FrameFlag_Settings)
+    {
+        uint32_t spanCount;
+        if (!ReadVarint32(m_stream, spanCount))
+            return Fail("Truncated frame");
+
+        uint32_t offset = 0;
+        for (uint32_t span = 0; span < spanCount; span++)
+        {
+            uint32_t gap, length;
+            if (!ReadVarint32(m_stream, gap) || !ReadVarint32(m_stream, length))
+                return Fail("Truncated frame");
+
+            if (uint64_t(offset) + gap + length > m_settingsSize)
+                return Fail("Settings span out of range");
+
+            offset += gap;
+            m_stream.read(reinterpret_cast<char*>(current.settings.data() + offset), length);
+            if (m_stream.gcount() != std::streamsize(length))
+                return Fail("Truncated frame");
+            offset += length;
+        }
+    }
+
+    if ((flags & FrameFlag_ElapsedTime) && !ReadRaw(m_stream, current.elapsedTime))
+        return Fail("Truncated frame");
+
+    m_previous = current;
+    frame = std::move(current);
+    m_frameCount++;
+
+    return true;
+}
+
+uint32_t FrameRecordReader::GetSettingsSize() const
+{
+    return m_settingsSize;
+}
+
+uint64_t FrameRecordReader::GetSettingsLayout() const
+{
+    return m_settingsLayout;
+}
+
+uint32_t FrameRecordReader::GetFrameCount() const
+{
+    return m_frameCount;
+}
+
+const std::string& FrameRecordReader::GetError() const
+{
+    return m_error;
+}
+
+std::vector<uint8_t> EncodeFrameRecording(const std::vector<RecordedFrame>& frames, uint32_t settingsSize, uint64_t settingsLayout)
+{
+    std::stringstream stream(std::ios::out | std::ios::binary);
+    FrameRecordWriter writer(stream);
+
+    if (!writer.Begin(settingsSize, settingsLayout))
+        return {};
+
+    for (const RecordedFrame& frame : frames)
+    {
+        if (!writer.WriteFrame(frame))
+            return {};
+    }
+
+    const std::string data = stream.str();
+    return std::vector<uint8_t>(data.begin(), data.end());
+}
+
+bool DecodeFrameRecording(const std::vector<uint8_t>& data, std::vector<RecordedFrame>& frames, std::string& error)
+{
+    std::stringstream stream(std::string(data.begin(), data.end()), std::ios::in | std::ios::binary);
+    FrameRecordReader reader(stream);
+
+    frames.clear();
+
+    if (!reader.Begin())
+    {
+        error = reader.GetError();
+        return false;
+    }
+
+    RecordedFrame frame;
+    while (reader.ReadFrame(frame))
+        frames.push_back(frame);
+
+    error = reader.GetError();
+    return error.empty();
+}
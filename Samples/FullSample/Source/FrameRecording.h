@@ -0,0 +1,102 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-frame recording of the inputs that determine what the sample renders: the view,
+// the render settings, the scene animation time, the environment map and the frame index
+// that seeds the ReSTIR random numbers. Replaying a recording reproduces the frames
+// without any input devices.
+//
+// The stream starts with a versioned header, followed by one record per frame.
+// The header also has a hash of the settings snapshot layout, so that a recording made
+// by a build with different settings is rejected instead of being misread.
+// Each record only stores what changed since the previous frame: view matrix elements
+// are stored under a change mask, settings are stored as the byte spans that differ
+// from the previous snapshot, and integers are varint-encoded deltas.
+// Records can be written and read one at a time, so a recording can be streamed to
+// or from a file while the application is running.
+
+struct RecordedView
+{
+    // World-to-view transform: the 3x3 linear part in row-major order, then the translation
+    std::array<float, 12> worldToView{};
+    float verticalFov = 0.f;    // radians
+    float zNear = 0.f;
+};
+
+struct RecordedFrame
+{
+    uint32_t frameIndex = 0;
+    float elapsedTime = 0.f;    // seconds since the previous frame, used for time-dependent effects like exposure adaptation
+    double animationTime = 0.0; // scene animation clock
+    int environmentMapIndex = 0;
+    RecordedView view;
+    std::vector<uint8_t> settings; // opaque snapshot of the render settings, see UIData::SaveRecordedSettings
+};
+
+class FrameRecordWriter
+{
+public:
+    static constexpr uint32_t Version = 2;
+
+    explicit FrameRecordWriter(std::ostream& stream);
+
+    // Writes the stream header. settingsSize is the size of the settings snapshot in every frame,
+    // settingsLayout identifies its layout, see UIData::GetRecordedSettingsLayout.
+    bool Begin(uint32_t settingsSize, uint64_t settingsLayout);
+    bool WriteFrame(const RecordedFrame& frame);
+
+    [[nodiscard]] uint32_t GetFrameCount() const;
+
+private:
+    std::ostream& m_stream;
+    uint32_t m_settingsSize = 0;
+    uint32_t m_frameCount = 0;
+    RecordedFrame m_previous;
+};
+
+class FrameRecordReader
+{
+public:
+    explicit FrameRecordReader(std::istream& stream);
+
+    // Reads and validates the stream header.
+    bool Begin();
+
+    // Reads the next frame. Returns false at the end of the stream or on error, see GetError.
+    bool ReadFrame(RecordedFrame& frame);
+
+    [[nodiscard]] uint32_t GetSettingsSize() const;
+    [[nodiscard]] uint64_t GetSettingsLayout() const;
+    [[nodiscard]] uint32_t GetFrameCount() const;
+    [[nodiscard]] const std::string& GetError() const;
+
+private:
+    bool Fail(const char* message);
+
+    std::istream& m_stream;
+    uint32_t m_settingsSize = 0;
+    uint64_t m_settingsLayout = 0;
+    uint32_t m_frameCount = 0;
+    RecordedFrame m_previous;
+    std::string m_error;
+};
+
+// Convenience functions for whole recordings kept in memory.
+std::vector<uint8_t> EncodeFrameRecording(const std::vector<RecordedFrame>& frames, uint32_t settingsSize, uint64_t settingsLayout);
+bool DecodeFrameRecording(const std::vector<uint8_t>& data, std::vector<RecordedFrame>& frames, std::string& error);
@@ -0,0 +1,217 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "FrameTimeController.h"
+
+#include <algorithm>
+#include <limits>
+
+bool FrameTimeQuality::operator==(const FrameTimeQuality& other) const
+{
+    return resolutionScale == other.resolutionScale
+        && checkerboard == other.checkerboard
+        && numLocalLightSamples == other.numLocalLightSamples
+        && numSpatialSamples == other.numSpatialSamples
+        && numBrdfSamples == other.numBrdfSamples;
+}
+
+std::vector<FrameTimeQuality> BuildFrameTimeQualityLadder()
+{
+    // Start from the most expensive level and reduce one setting per step.
+    // Sample counts go first because they cost the least image quality per millisecond saved,
+    // checkerboard sampling is a single step close to the bottom because it is a static parameter.
+    std::vector<FrameTimeQuality> ladder;
+
+    FrameTimeQuality quality;
+    quality.resolutionScale = 1.f;
+    quality.checkerboard = false;
+    quality.numLocalLightSamples = 16;
+    quality.numSpatialSamples = 4;
+    quality.numBrdfSamples = 1;
+    ladder.push_back(quality);
+
+    quality.numLocalLightSamples = 8;   ladder.push_back(quality);
+    quality.numSpatialSamples = 2;      ladder.push_back(quality);
+    quality.numLocalLightSamples = 4;   ladder.push_back(quality);
+    quality.numBrdfSamples = 0;         ladder.push_back(quality);
+    quality.numSpatialSamples = 1;      ladder.push_back(quality);
+    quality.resolutionScale = 0.85f;    ladder.push_back(quality);
+    quality.numLocalLightSamples = 2;   ladder.push_back(quality);
+    quality.resolutionScale = 0.75f;    ladder.push_back(quality);
+    quality.checkerboard = true;        ladder.push_back(quality);
+    quality.resolutionScale = 0.67f;    ladder.push_back(quality);
+    quality.resolutionScale = 0.5f;     ladder.push_back(quality);
+    quality.numLocalLightSamples = 1;   ladder.push_back(quality);
+
+    std::reverse(ladder.begin(), ladder.end());
+    return ladder;
+}
+
+FrameTimeController::FrameTimeController(std::vector<FrameTimeQuality> ladder)
+    : m_ladder(std::move(ladder))
+{
+    if (m_ladder.empty())
+        m_ladder.push_back(FrameTimeQuality());
+
+    m_stepCostRatio.assign(m_ladder.size(), 0.f);
+    Reset(uint32_t(m_ladder.size()) - 1);
+}
+
+void FrameTimeController::SetSettings(const FrameTimeControllerSettings& settings)
+{
+    m_settings = settings;
+}
+
+const FrameTimeControllerSettings& FrameTimeController::GetSettings() const
+{
+    return m_settings;
+}
+
+void FrameTimeController::Reset(uint32_t level)
+{
+    m_level = std::min(level, GetLevelCount() - 1);
+    m_previousLevel = m_level;
+    m_costBeforeChange = 0.f;
+    m_filteredFrameTime = 0.f;
+    m_framesSinceChange = 0;
+    m_framesSinceStaticChange = std::numeric_limits<uint32_t>::max();
+}
+
+uint32_t FrameTimeController::FindLevel(const FrameTimeQuality& quality) const
+{
+    uint32_t cheapestMatch = UINT32_MAX;
+    uint32_t bestMatch = UINT32_MAX;
+
+    for (uint32_t level = 0; level < GetLevelCount(); level++)
+    {
+        const FrameTimeQuality& candidate = m_ladder[level];
+        if (candidate.checkerboard != quality.checkerboard)
+            continue;
+
+        if (cheapestMatch == UINT32_MAX)
+            cheapestMatch = level;
+
+        if (candidate.resolutionScale <= quality.resolutionScale
+            && candidate.numLocalLightSamples <= quality.numLocalLightSamples
+            && candidate.numSpatialSamples <= quality.numSpatialSamples
+            && candidate.numBrdfSamples <= quality.numBrdfSamples)
+            bestMatch = level;
+    }
+
+    if (bestMatch != UINT32_MAX)
+        return bestMatch;
+
+    return (cheapestMatch != UINT32_MAX) ? cheapestMatch : 0;
+}
+
+bool FrameTimeController::SetLevel(uint32_t level)
+{
+    const bool staticChange = m_ladder[level].checkerboard != m_ladder[m_level].checkerboard;
+    if (staticChange)
+    {
+        if (m_framesSinceStaticChange < m_settings.staticChangeFrames)
+            return false;
+
+        m_framesSinceStaticChange = 0;
+        m_staticChangeCount++;
+    }
+
+    m_previousLevel = m_level;
+    m_costBeforeChange = m_filteredFrameTime;
+    m_level = level;
+    m_filteredFrameTime = 0.f;
+    m_framesSinceChange = 0;
+    return true;
+}
+
+bool FrameTimeController::Update(float frameTimeMs)
+{
+    m_framesSinceChange++;
+    if (m_framesSinceStaticChange != std::numeric_limits<uint32_t>::max())
+        m_framesSinceStaticChange++;
+
+    if (!(frameTimeMs > 0.f))
+        return false;
+
+    // Frames right after a change may still have been rendered or timed with the old settings
+    if (m_framesSinceChange <= m_settings.settleFrames)
+        return false;
+
+    if (m_framesSinceChange == m_settings.settleFrames + 1)
+        m_filteredFrameTime = frameTimeMs;
+    else
+        m_filteredFrameTime += (frameTimeMs - m_filteredFrameTime) * m_settings.smoothing;
+
+    if (m_framesSinceChange < m_settings.settleFrames + m_settings.measureFrames)
+        return false;
+
+    // The new level has been measured, learn what the last step cost
+    if (m_previousLevel != m_level && m_costBeforeChange > 0.f)
+    {
+        const uint32_t lowerLevel = std::min(m_previousLevel, m_level);
+        const float ratio = (m_level > m_previousLevel)
+            ? m_filteredFrameTime / m_costBeforeChange
+            : m_costBeforeChange / m_filteredFrameTime;
+
+        float& learnedRatio = m_stepCostRatio[lowerLevel];
+        learnedRatio = (learnedRatio > 0.f) ? (learnedRatio + ratio) * 0.5f : ratio;
+    }
+    m_previousLevel = m_level;
+
+    const float upperBound = m_settings.targetFrameTimeMs * (1.f + m_settings.hysteresis);
+    const float lowerBound = m_settings.targetFrameTimeMs * (1.f - m_settings.hysteresis);
+
+    if (m_filteredFrameTime > upperBound && m_level > 0)
+        return SetLevel(m_level - 1);
+
+    if (m_filteredFrameTime < lowerBound && m_level + 1 < GetLevelCount())
+    {
+        // Don't step up into a level that is expected to be over budget, that would oscillate.
+        // Static changes are expensive, so they need to be expected to land below the target.
+        const bool staticChange = m_ladder[m_level + 1].checkerboard != m_ladder[m_level].checkerboard;
+        const float ratio = m_stepCostRatio[m_level];
+        if (ratio > 0.f && m_filteredFrameTime * ratio > (staticChange ? m_settings.targetFrameTimeMs : upperBound))
+            return false;
+
+        return SetLevel(m_level + 1);
+    }
+
+    return false;
+}
+
+uint32_t FrameTimeController::GetLevel() const
+{
+    return m_level;
+}
+
+uint32_t FrameTimeController::GetLevelCount() const
+{
+    return uint32_t(m_ladder.size());
+}
+
+const FrameTimeQuality& FrameTimeController::GetQuality() const
+{
+    return m_ladder[m_level];
+}
+
+float FrameTimeController::GetFilteredFrameTime() const
+{
+    return m_filteredFrameTime;
+}
+
+uint32_t FrameTimeController::GetStaticChangeCount() const
+{
+    return m_staticChangeCount;
+}
+
+float FrameTimeController::GetStepCostRatio(uint32_t level) const
+{
+    return (level < m_stepCostRatio.size()) ? m_stepCostRatio[level] : 0.f;
+}
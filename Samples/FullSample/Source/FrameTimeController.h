@@ -0,0 +1,92 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Closed-loop controller that adjusts the ReSTIR quality settings to hold a frame time target.
+// The settings are arranged in a ladder of quality levels, from the cheapest to the most expensive,
+// where each step changes one setting. The controller moves one step at a time when the smoothed
+// frame time leaves a band around the target, waits for the frame time to settle after every step,
+// and learns the cost ratio between neighboring levels so that it does not step up into a level
+// that was already measured to be over budget. The controller has no dependencies on the renderer;
+// it consumes frame times and produces settings.
+
+struct FrameTimeQuality
+{
+    float resolutionScale = 1.f;
+    bool checkerboard = false;      // static parameter, changing it resets the importance sampling context
+    uint32_t numLocalLightSamples = 8;
+    uint32_t numSpatialSamples = 1;
+    uint32_t numBrdfSamples = 1;
+
+    bool operator==(const FrameTimeQuality& other) const;
+    bool operator!=(const FrameTimeQuality& other) const { return !(*this == other); }
+};
+
+// The default quality ladder, cheapest level first.
+std::vector<FrameTimeQuality> BuildFrameTimeQualityLadder();
+
+struct FrameTimeControllerSettings
+{
+    float targetFrameTimeMs = 16.6f;
+    float hysteresis = 0.1f;                // relative half-width of the band around the target where nothing changes
+    float smoothing = 0.1f;                 // weight of each new frame in the moving average
+    uint32_t settleFrames = 8;              // frames ignored after a change, covers the profiler latency
+    uint32_t measureFrames = 24;            // frames averaged before the next decision
+    uint32_t staticChangeFrames = 600;      // minimum number of frames between changes of static parameters
+};
+
+class FrameTimeController
+{
+public:
+    explicit FrameTimeController(std::vector<FrameTimeQuality> ladder = BuildFrameTimeQualityLadder());
+
+    void SetSettings(const FrameTimeControllerSettings& settings);
+    [[nodiscard]] const FrameTimeControllerSettings& GetSettings() const;
+
+    // Starts over from the given level, forgetting the frame time history but not the learned costs.
+    void Reset(uint32_t level);
+
+    // Returns the best level that is nowhere above the given quality and has the same checkerboard setting,
+    // so that starting there from the current settings doesn't change a static parameter.
+    // Without such a level, returns the cheapest level with the same checkerboard setting, or level 0.
+    [[nodiscard]] uint32_t FindLevel(const FrameTimeQuality& quality) const;
+
+    // Feeds the frame time of the last frame that was rendered with the current quality.
+    // Returns true if the quality level changed.
+    bool Update(float frameTimeMs);
+
+    [[nodiscard]] uint32_t GetLevel() const;
+    [[nodiscard]] uint32_t GetLevelCount() const;
+    [[nodiscard]] const FrameTimeQuality& GetQuality() const;
+    [[nodiscard]] float GetFilteredFrameTime() const;   // 0 while settling
+    [[nodiscard]] uint32_t GetStaticChangeCount() const;
+
+    // Learned frame time ratio between the level above and the given level, or 0 if not measured yet.
+    [[nodiscard]] float GetStepCostRatio(uint32_t level) const;
+
+private:
+    bool SetLevel(uint32_t level);
+
+    std::vector<FrameTimeQuality> m_ladder;
+    std::vector<float> m_stepCostRatio;
+    FrameTimeControllerSettings m_settings;
+
+    uint32_t m_level = 0;
+    uint32_t m_previousLevel = 0;
+    float m_costBeforeChange = 0.f;     // filtered frame time at m_previousLevel
+    float m_filteredFrameTime = 0.f;
+    uint32_t m_framesSinceChange = 0;
+    uint32_t m_framesSinceStaticChange = 0;
+    uint32_t m_staticChangeCount = 0;
+};
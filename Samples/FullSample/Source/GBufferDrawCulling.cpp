@@ -0,0 +1,65 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "GBufferDrawCulling.h"
+
+#include <algorithm>
+
+bool IsGBufferDrawRecordVisible(const GBufferDrawRecord& record, const affine3& instanceTransform, const GBufferCullingConstants& constants)
+{
+    if (record.flags & GBUFFER_DRAW_NEVER_CULL)
+        return true;
+
+    // World space box around the transformed object space box, same as in the shader
+    const float3 center = (record.boundsMin + record.boundsMax) * 0.5f;
+    const float3 extent = (record.boundsMax - record.boundsMin) * 0.5f;
+    const float3 worldCenter = instanceTransform.transformPoint(center);
+    const float3 worldExtent =
+        abs(instanceTransform.m_linear.row0) * extent.x +
+        abs(instanceTransform.m_linear.row1) * extent.y +
+        abs(instanceTransform.m_linear.row2) * extent.z;
+
+    for (const float4& plane : constants.frustumPlanes)
+    {
+        const float3 normal = float3(plane.x, plane.y, plane.z);
+        if (dot(normal, worldCenter) - dot(abs(normal), worldExtent) > plane.w)
+            return false;
+    }
+
+    return true;
+}
+
+void CullGBufferDrawRecords(
+    const std::vector<GBufferDrawRecord>& records,
+    const std::vector<affine3>& instanceTransforms,
+    const GBufferCullingConstants& constants,
+    std::vector<GBufferDrawArguments>& opaqueDraws,
+    std::vector<GBufferDrawArguments>& alphaTestedDraws)
+{
+    const uint32_t recordCount = std::min(uint32_t(records.size()), constants.recordCount);
+
+    for (uint32_t recordIndex = 0; recordIndex < recordCount; recordIndex++)
+    {
+        const GBufferDrawRecord& record = records[recordIndex];
+        const bool alphaTested = (record.flags & GBUFFER_DRAW_ALPHA_TESTED) != 0;
+
+        if (alphaTested && !constants.enableAlphaTestedGeometry)
+            continue;
+
+        if (!IsGBufferDrawRecordVisible(record, instanceTransforms[record.instanceIndex], constants))
+            continue;
+
+        GBufferDrawArguments& draw = alphaTested ? alphaTestedDraws.emplace_back() : opaqueDraws.emplace_back();
+        draw.vertexCount = record.indexCount;
+        draw.instanceCount = 1;
+        draw.startVertexLocation = 0;
+        draw.startInstanceLocation = recordIndex;
+    }
+}
@@ -0,0 +1,44 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <donut/core/math/math.h>
+#include <cstdint>
+#include <vector>
+
+using namespace donut::math;
+#include "../shaders/GBufferDrawRecord.h"
+
+// CPU reference for GBufferCulling.hlsl, which turns the G-buffer draw records into indirect draw arguments.
+// Both implementations use the same record format and the same box-plane test, so the draw lists match
+// except for their order: the shader allocates the slots with atomics, this function keeps the record order.
+// It is used to validate the culling shader and to test the record layout without a GPU.
+
+// Matches nvrhi::DrawIndirectArguments and the argument layout written by the shader
+struct GBufferDrawArguments
+{
+    uint32_t vertexCount = 0;
+    uint32_t instanceCount = 0;
+    uint32_t startVertexLocation = 0;
+    uint32_t startInstanceLocation = 0;  // the draw record index
+};
+
+// Returns true if the object space bounds of the record, transformed to world space, intersect all frustum planes.
+bool IsGBufferDrawRecordVisible(const GBufferDrawRecord& record, const affine3& instanceTransform, const GBufferCullingConstants& constants);
+
+// Appends the draws for the visible records to the opaque and alpha-tested lists.
+// The transforms are indexed by GBufferDrawRecord::instanceIndex.
+void CullGBufferDrawRecords(
+    const std::vector<GBufferDrawRecord>& records,
+    const std::vector<affine3>& instanceTransforms,
+    const GBufferCullingConstants& constants,
+    std::vector<GBufferDrawArguments>& opaqueDraws,
+    std::vector<GBufferDrawArguments>& alphaTestedDraws);
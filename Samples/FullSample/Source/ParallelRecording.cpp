@@ -0,0 +1,68 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "ParallelRecording.h"
+
+#include <algorithm>
+
+std::vector<RecordingRange> SplitRecordingRange(uint32_t itemCount, uint32_t maxRanges, uint32_t minItemsPerRange)
+{
+    std::vector<RecordingRange> ranges;
+    if (itemCount == 0)
+        return ranges;
+
+    const uint32_t rangeCount = std::clamp(itemCount / std::max(minItemsPerRange, 1u), 1u, std::max(maxRanges, 1u));
+    const uint32_t baseSize = itemCount / rangeCount;
+    const uint32_t largerRanges = itemCount % rangeCount;
+
+    ranges.reserve(rangeCount);
+    uint32_t begin = 0;
+    for (uint32_t rangeIndex = 0; rangeIndex < rangeCount; rangeIndex++)
+    {
+        const uint32_t size = baseSize + (rangeIndex < largerRanges ? 1 : 0);
+        ranges.push_back({ begin, begin + size });
+        begin += size;
+    }
+
+    return ranges;
+}
+
+RecordingPlan PlanRecording(const std::vector<RecordingGroup>& groups)
+{
+    RecordingPlan plan;
+    std::vector<uint32_t> groupWaves(groups.size(), 0);
+
+    for (uint32_t groupIndex = 0; groupIndex < uint32_t(groups.size()); groupIndex++)
+    {
+        for (uint32_t dependency : groups[groupIndex].dependencies)
+        {
+            if (dependency >= groupIndex)
+            {
+                plan.errors.push_back("Group '" + groups[groupIndex].name + "' depends on a later group or itself");
+                continue;
+            }
+
+            groupWaves[groupIndex] = std::max(groupWaves[groupIndex], groupWaves[dependency] + 1);
+        }
+    }
+
+    if (!plan.errors.empty())
+        return plan;
+
+    for (uint32_t groupIndex = 0; groupIndex < uint32_t(groups.size()); groupIndex++)
+    {
+        const uint32_t wave = groupWaves[groupIndex];
+        if (plan.waves.size() <= wave)
+            plan.waves.resize(wave + 1);
+        plan.waves[wave].push_back(groupIndex);
+    }
+
+    return plan;
+}
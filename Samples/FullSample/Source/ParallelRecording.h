@@ -0,0 +1,217 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include "AsyncComputeSchedule.h"
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Recording of a frame into several command lists on several threads, with the same commands in the
+// same order on the GPU as recording it into one command list on one thread.
+//
+// - A long stream of draws is split into contiguous ranges, and workers record each range into its own
+//   command list. Every list sets the state of its first draw, so the lists don't depend on each other,
+//   and submitting them in range order replays the draws in stream order.
+// - The tasks of the frame are recorded in groups. A group records after the groups it depends on,
+//   because it uses CPU state that they produce, like the light buffer parameters, and the groups of
+//   a wave record concurrently.
+// - FrameCommandLists keeps the command lists of the tasks of an async compute schedule, including
+//   the lists that workers recorded for a task, and returns them by batch in submission order. The
+//   order in which the lists were recorded doesn't matter.
+//
+// The module has no dependencies on the renderer. The command list handles only have to be copyable,
+// comparable, and provide open() and close() through ->.
+
+struct RecordingRange
+{
+    uint32_t begin = 0;
+    uint32_t end = 0;
+
+    [[nodiscard]] uint32_t GetSize() const { return end - begin; }
+};
+
+// Contiguous ranges in order that cover the items, at most maxRanges of them and with at least
+// minItemsPerRange items each, unless there are fewer items. The sizes differ by one item at most.
+std::vector<RecordingRange> SplitRecordingRange(uint32_t itemCount, uint32_t maxRanges, uint32_t minItemsPerRange);
+
+struct DrawStreamItem
+{
+    uint32_t state = 0;                 // index of a graphics state defined by the caller
+    uint32_t pushConstants[2] = {};
+    uint32_t vertexCount = 0;
+};
+
+// Records the draws of a range. The sink sets the state before the first draw of the range and
+// whenever it changes, so every range can be recorded into a command list of its own.
+template<typename Sink>
+void RecordDrawStream(Sink& sink, const std::vector<DrawStreamItem>& items, RecordingRange range)
+{
+    uint32_t currentState = ~0u;
+    for (uint32_t index = range.begin; index < range.end; index++)
+    {
+        const DrawStreamItem& item = items[index];
+        if (item.state != currentState)
+        {
+            sink.SetState(item.state);
+            currentState = item.state;
+        }
+
+        sink.Draw(item);
+    }
+}
+
+struct RecordingGroup
+{
+    std::string name;
+    std::vector<uint32_t> dependencies;     // earlier groups
+};
+
+struct RecordingPlan
+{
+    std::vector<std::vector<uint32_t>> waves;   // groups that can record concurrently, in group order
+    std::vector<std::string> errors;            // no waves when there are errors
+};
+
+// Places every group in the wave after the last of its dependencies
+RecordingPlan PlanRecording(const std::vector<RecordingGroup>& groups);
+
+// Command lists of the tasks of a frame, submitted by batch of an async compute schedule.
+//
+// Consecutive tasks of a batch that belong to the same recording group share a command list, and
+// without groups, the tasks of a batch share one, like recording on one thread does. Groups that
+// record concurrently therefore never record into the same list. Insert places lists that workers
+// recorded for a task after the current list of the task, and continues the task in another list.
+// The lists are created once and reused in the following frames.
+//
+// The last task records into the final command list, which the caller keeps recording into after
+// the frame tasks until End, so that task can't insert lists. Different groups can record and insert
+// lists on different threads, so createCommandList has to be thread-safe.
+template<typename Handle>
+class FrameCommandLists
+{
+public:
+    using CreateFunction = std::function<Handle(QueueType queue)>;
+
+    // taskGroups holds the recording group of every task, or nothing for a single group
+    void Configure(const AsyncComputeSchedule& schedule, const std::vector<uint32_t>& taskGroups, Handle finalCommandList,
+        CreateFunction createCommandList)
+    {
+        m_schedule = schedule;
+        m_createCommandList = std::move(createCommandList);
+        m_slots.clear();
+        m_taskSlots.assign(schedule.taskBatches.size(), 0);
+
+        for (const AsyncComputeBatch& batch : schedule.batches)
+        {
+            uint32_t previousGroup = ~0u;
+            for (uint32_t task : batch.tasks)
+            {
+                const uint32_t group = taskGroups.empty() ? 0 : taskGroups[task];
+                if (task == batch.tasks.front() || group != previousGroup)
+                {
+                    m_slots.emplace_back();
+                    m_slots.back().queue = batch.queue;
+                }
+
+                m_taskSlots[task] = uint32_t(m_slots.size() - 1);
+                previousGroup = group;
+            }
+        }
+
+        m_finalSlot = m_taskSlots.empty() ? ~0u : m_taskSlots.back();
+        for (uint32_t slotIndex = 0; slotIndex < uint32_t(m_slots.size()); slotIndex++)
+        {
+            Slot& slot = m_slots[slotIndex];
+            slot.commandLists.push_back(slotIndex == m_finalSlot ? finalCommandList : m_createCommandList(slot.queue));
+        }
+    }
+
+    // Opens the first command list of every task
+    void Begin()
+    {
+        for (Slot& slot : m_slots)
+        {
+            slot.usedCommandLists = 1;
+            slot.sequence.assign(1, slot.commandLists[0]);
+            slot.commandLists[0]->open();
+        }
+    }
+
+    [[nodiscard]] const Handle& GetCommandList(uint32_t task) const { return m_slots[m_taskSlots[task]].sequence.back(); }
+
+    // Closes the current list of the task, places the closed lists after it, and returns an open list
+    // for the rest of the task and the following tasks that shared its list
+    Handle Insert(uint32_t task, const std::vector<Handle>& commandLists)
+    {
+        assert(m_taskSlots[task] != m_finalSlot);
+
+        Slot& slot = m_slots[m_taskSlots[task]];
+        if (commandLists.empty())
+            return slot.sequence.back();
+
+        slot.sequence.back()->close();
+        slot.sequence.insert(slot.sequence.end(), commandLists.begin(), commandLists.end());
+
+        if (slot.usedCommandLists == slot.commandLists.size())
+            slot.commandLists.push_back(m_createCommandList(slot.queue));
+
+        Handle commandList = slot.commandLists[slot.usedCommandLists++];
+        commandList->open();
+        slot.sequence.push_back(commandList);
+        return commandList;
+    }
+
+    // Closes the current lists of the tasks and returns the lists of every batch in submission order
+    std::vector<std::vector<Handle>> End()
+    {
+        for (Slot& slot : m_slots)
+            slot.sequence.back()->close();
+
+        std::vector<std::vector<Handle>> batches(m_schedule.batches.size());
+        for (size_t batchIndex = 0; batchIndex < m_schedule.batches.size(); batchIndex++)
+        {
+            uint32_t previousSlot = ~0u;
+            for (uint32_t task : m_schedule.batches[batchIndex].tasks)
+            {
+                const uint32_t slotIndex = m_taskSlots[task];
+                if (slotIndex != previousSlot)
+                    batches[batchIndex].insert(batches[batchIndex].end(), m_slots[slotIndex].sequence.begin(), m_slots[slotIndex].sequence.end());
+                previousSlot = slotIndex;
+            }
+        }
+
+        return batches;
+    }
+
+    [[nodiscard]] const AsyncComputeSchedule& GetSchedule() const { return m_schedule; }
+    [[nodiscard]] bool IsConfigured() const { return !m_slots.empty(); }
+
+private:
+    // The lists of consecutive tasks of one group in one batch
+    struct Slot
+    {
+        QueueType queue = QueueType::Graphics;
+        std::vector<Handle> commandLists;   // in the order the slot uses them, created once
+        size_t usedCommandLists = 0;        // in this frame
+        std::vector<Handle> sequence;       // every list of the slot in this frame in submission order
+    };
+
+    AsyncComputeSchedule m_schedule;
+    CreateFunction m_createCommandList;
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_taskSlots;      // by task
+    uint32_t m_finalSlot = ~0u;
+};
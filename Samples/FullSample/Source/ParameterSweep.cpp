@@ -0,0 +1,614 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "ParameterSweep.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+static std::string TrimWhitespace(const std::string& s)
+{
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+        return std::string();
+
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+void SweepGrid::AddAxis(const std::string& name, const std::vector<float>& values, bool isStatic)
+{
+    SweepAxis axis;
+    axis.name = name;
+    axis.values = values;
+    axis.isStatic = isStatic;
+    m_axes.push_back(axis);
+}
+
+bool SweepGrid::SetAxisStatic(const std::string& name, bool isStatic)
+{
+    int axisIndex = FindAxis(name);
+    if (axisIndex < 0)
+        return false;
+
+    m_axes[axisIndex].isStatic = isStatic;
+    return true;
+}
+
+bool SweepGrid::Parse(const std::string& text, std::string& errorMessage)
+{
+    std::vector<SweepAxis> axes;
+
+    std::istringstream declarations(text);
+    std::string declaration;
+    while (std::getline(declarations, declaration, ';'))
+    {
+        declaration = TrimWhitespace(declaration);
+        if (declaration.empty())
+            continue;
+
+        size_t equals = declaration.find('=');
+        if (equals == std::string::npos)
+        {
+            errorMessage = "Missing '=' in '" + declaration + "'";
+            return false;
+        }
+
+        SweepAxis axis;
+        axis.name = TrimWhitespace(declaration.substr(0, equals));
+        if (axis.name.empty())
+        {
+            errorMessage = "Missing parameter name in '" + declaration + "'";
+            return false;
+        }
+
+        for (const SweepAxis& existing : axes)
+        {
+            if (existing.name == axis.name)
+            {
+                errorMessage = "Parameter '" + axis.name + "' is declared more than once";
+                return false;
+            }
+        }
+
+        std::istringstream values(declaration.substr(equals + 1));
+        std::string value;
+        while (std::getline(values, value, ','))
+        {
+            value = TrimWhitespace(value);
+            char* end = nullptr;
+            float parsed = strtof(value.c_str(), &end);
+            if (value.empty() || *end != 0)
+            {
+                errorMessage = "Invalid value '" + value + "' for parameter '" + axis.name + "'";
+                return false;
+            }
+            axis.values.push_back(parsed);
+        }
+
+        if (axis.values.empty())
+        {
+            errorMessage = "Parameter '" + axis.name + "' has no values";
+            return false;
+        }
+
+        axes.push_back(axis);
+    }
+
+    if (axes.empty())
+    {
+        errorMessage = "The grid has no parameters";
+        return false;
+    }
+
+    m_axes = std::move(axes);
+    errorMessage.clear();
+    return true;
+}
+
+void SweepGrid::Clear()
+{
+    m_axes.clear();
+}
+
+const std::vector<SweepAxis>& SweepGrid::GetAxes() const
+{
+    return m_axes;
+}
+
+int SweepGrid::FindAxis(const std::string& name) const
+{
+    for (size_t i = 0; i < m_axes.size(); i++)
+    {
+        if (m_axes[i].name == name)
+            return int(i);
+    }
+    return -1;
+}
+
+size_t SweepGrid::GetPointCount() const
+{
+    if (m_axes.empty())
+        return 0;
+
+    size_t count = 1;
+    for (const SweepAxis& axis : m_axes)
+        count *= axis.values.size();
+    return count;
+}
+
+SweepPoint SweepGrid::GetPoint(size_t index) const
+{
+    assert(index < GetPointCount());
+
+    SweepPoint point;
+    point.index = uint32_t(index);
+    point.values.resize(m_axes.size());
+
+    // Mixed-radix decomposition, last axis is the least significant digit
+    for (size_t axisIndex = m_axes.size(); axisIndex-- > 0; )
+    {
+        const SweepAxis& axis = m_axes[axisIndex];
+        point.values[axisIndex] = axis.values[index % axis.values.size()];
+        index /= axis.values.size();
+    }
+
+    return point;
+}
+
+std::vector<SweepPoint> SweepGrid::Expand() const
+{
+    std::vector<SweepPoint> points;
+    size_t count = GetPointCount();
+    points.reserve(count);
+    for (size_t index = 0; index < count; index++)
+        points.push_back(GetPoint(index));
+    return points;
+}
+
+std::vector<SweepPoint> SweepGrid::Schedule() const
+{
+    std::vector<SweepPoint> points = Expand();
+
+    // Static axes become the most significant sort keys, in declaration order,
+    // followed by the dynamic axes; the grid index breaks any remaining ties.
+    std::vector<size_t> keyOrder;
+    for (size_t axisIndex = 0; axisIndex < m_axes.size(); axisIndex++)
+    {
+        if (m_axes[axisIndex].isStatic)
+            keyOrder.push_back(axisIndex);
+    }
+
+    if (keyOrder.empty())
+        return points;
+
+    auto valuePosition = [this](size_t axisIndex, float value)
+    {
+        const std::vector<float>& values = m_axes[axisIndex].values;
+        return size_t(std::find(values.begin(), values.end(), value) - values.begin());
+    };
+
+    std::stable_sort(points.begin(), points.end(), [&keyOrder, &valuePosition](const SweepPoint& a, const SweepPoint& b)
+    {
+        for (size_t axisIndex : keyOrder)
+        {
+            size_t pa = valuePosition(axisIndex, a.values[axisIndex]);
+            size_t pb = valuePosition(axisIndex, b.values[axisIndex]);
+            if (pa != pb)
+                return pa < pb;
+        }
+        return a.index < b.index;
+    });
+
+    return points;
+}
+
+std::string SweepGrid::DescribePoint(const SweepPoint& point) const
+{
+    std::stringstream ss;
+    for (size_t axisIndex = 0; axisIndex < m_axes.size() && axisIndex < point.values.size(); axisIndex++)
+    {
+        if (axisIndex > 0)
+            ss << " ";
+        ss << m_axes[axisIndex].name << "=" << point.values[axisIndex];
+    }
+    return ss.str();
+}
+
+std::vector<size_t> ComputeParetoFront(const std::vector<SweepResult>& results)
+{
+    const bool hasImageErrors = std::any_of(results.begin(), results.end(),
+        [](const SweepResult& result) { return result.hasImageError; });
+
+    std::vector<size_t> order;
+    for (size_t index = 0; index < results.size(); index++)
+    {
+        if (results[index].hasImageError || !hasImageErrors)
+            order.push_back(index);
+    }
+
+    std::sort(order.begin(), order.end(), [&results](size_t a, size_t b)
+    {
+        if (results[a].frameTimeMs != results[b].frameTimeMs)
+            return results[a].frameTimeMs < results[b].frameTimeMs;
+        return results[a].imageError < results[b].imageError;
+    });
+
+    // Without a reference, the frame time is the only objective
+    if (!hasImageErrors)
+    {
+        order.resize(std::min<size_t>(order.size(), 1));
+        return order;
+    }
+
+    // Walking in the order of increasing cost, a result is on the front
+    // only if it has a strictly lower error than everything cheaper.
+    std::vector<size_t> front;
+    double bestError = INFINITY;
+    for (size_t index : order)
+    {
+        if (results[index].imageError < bestError)
+        {
+            front.push_back(index);
+            bestError = results[index].imageError;
+        }
+    }
+
+    return front;
+}
+
+void SweepResultStore::Clear()
+{
+    m_results.clear();
+}
+
+void SweepResultStore::Add(const SweepResult& result)
+{
+    m_results.push_back(result);
+}
+
+const std::vector<SweepResult>& SweepResultStore::GetResults() const
+{
+    return m_results;
+}
+
+std::vector<size_t> SweepResultStore::GetParetoFront() const
+{
+    return ComputeParetoFront(m_results);
+}
+
+void SweepResultStore::WriteCsv(std::ostream& stream, const SweepGrid& grid, const std::vector<std::string>& sectionNames) const
+{
+    std::vector<size_t> front = GetParetoFront();
+    std::vector<bool> onFront(m_results.size(), false);
+    for (size_t index : front)
+        onFront[index] = true;
+
+    stream << "point";
+    for (const SweepAxis& axis : grid.GetAxes())
+        stream << "," << axis.name;
+    stream << ",frameTimeMs,imageError,pareto";
+    for (const std::string& name : sectionNames)
+        stream << "," << name;
+    stream << "\n";
+
+    for (size_t resultIndex = 0; resultIndex < m_results.size(); resultIndex++)
+    {
+        const SweepResult& result = m_results[resultIndex];
+
+        stream << result.point.index;
+        for (float value : result.point.values)
+            stream << "," << value;
+        stream << "," << result.frameTimeMs;
+        stream << ",";
+        if (result.hasImageError)
+            stream << result.imageError;
+        stream << "," << (onFront[resultIndex] ? 1 : 0);
+        for (size_t section = 0; section < sectionNames.size(); section++)
+        {
+            stream << ",";
+            if (section < result.sectionTimesMs.size())
+                stream << result.sectionTimesMs[section];
+        }
+        stream << "\n";
+    }
+}
+
+std::string SweepResultStore::GetReport(const SweepGrid& grid) const
+{
+    std::vector<size_t> front = GetParetoFront();
+
+    std::stringstream ss;
+    ss << std::fixed;
+    ss << "Parameter sweep: " << m_results.size() << " configurations, "
+        << front.size() << " on the Pareto front" << std::endl << std::endl;
+
+    ss << "Pareto front (frame time vs. image error):" << std::endl;
+    for (size_t index : front)
+    {
+        const SweepResult& result = m_results[index];
+        ss << std::setprecision(3) << std::setw(9) << result.frameTimeMs << " ms  ";
+        if (result.hasImageError)
+            ss << std::scientific << std::setprecision(3) << result.imageError << std::fixed;
+        else
+            ss << "      n/a";
+        ss << "  " << grid.DescribePoint(result.point) << std::endl;
+    }
+
+    ss << std::endl << "All configurations:" << std::endl;
+    for (const SweepResult& result : m_results)
+    {
+        ss << std::setprecision(3) << std::setw(9) << result.frameTimeMs << " ms  ";
+        if (result.hasImageError)
+            ss << std::scientific << std::setprecision(3) << result.imageError << std::fixed;
+        else
+            ss << "      n/a";
+        ss << "  " << grid.DescribePoint(result.point) << std::endl;
+    }
+
+    return ss.str();
+}
+
+double ComputeImageError(const float* image, const float* reference, size_t pixelCount, ImageErrorMetric metric)
+{
+    if (pixelCount == 0)
+        return 0.0;
+
+    // Relative MSE uses a small epsilon to keep black reference pixels from dominating the result
+    constexpr double relMseEpsilon = 1e-2;
+
+    double sum = 0.0;
+    size_t channelCount = 0;
+    for (size_t pixel = 0; pixel < pixelCount; pixel++)
+    {
+        for (size_t channel = 0; channel < 3; channel++)
+        {
+            const double value = image[pixel * 4 + channel];
+            const double expected = reference[pixel * 4 + channel];
+
+            // NaN or infinite output is maximally wrong, whatever the rest of the image looks like
+            if (!std::isfinite(value))
+                return INFINITY;
+
+            // A broken reference pixel says nothing about the image
+            if (!std::isfinite(expected))
+                continue;
+
+            double difference = value - expected;
+            double squared = difference * difference;
+
+            if (metric == ImageErrorMetric::RelMSE)
+                squared /= expected * expected + relMseEpsilon;
+
+            sum += squared;
+            channelCount++;
+        }
+    }
+
+    if (channelCount == 0)
+        return 0.0;
+
+    double mean = sum / double(channelCount);
+
+    return (metric == ImageErrorMetric::RMSE) ? std::sqrt(mean) : mean;
+}
+
+void ConvertHalfToFloat(const uint16_t* source, float* destination, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t h = source[i];
+        uint32_t sign = (h & 0x8000u) << 16;
+        uint32_t exponent = (h >> 10) & 0x1fu;
+        uint32_t mantissa = h & 0x3ffu;
+
+        uint32_t bits;
+        if (exponent == 0)
+        {
+            if (mantissa == 0)
+            {
+                bits = sign;
+            }
+            else
+            {
+                // Denormal: renormalize the mantissa
+                exponent = 127 - 15 + 1;
+                while ((mantissa & 0x400u) == 0)
+                {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                mantissa &= 0x3ffu;
+                bits = sign | (exponent << 23) | (mantissa << 13);
+            }
+        }
+        else if (exponent == 0x1f)
+        {
+            bits = sign | 0x7f800000u | (mantissa << 13);
+        }
+        else
+        {
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+
+        memcpy(&destination[i], &bits, sizeof(float));
+    }
+}
+
+void ParameterSweepRunner::Start(const SweepGrid& grid, const ParameterSweepSettings& settings)
+{
+    m_grid = grid;
+    m_settings = settings;
+    m_settings.measuredFrames = std::max(m_settings.measuredFrames, 1u);
+    m_schedule = grid.Schedule();
+    m_results.Clear();
+    m_referenceResult = SweepResult();
+    m_pendingResult = SweepResult();
+    m_referenceImage.clear();
+    m_referenceImageCount = 0;
+
+    m_running = !m_schedule.empty();
+    m_currentPoint = m_settings.captureReference ? SweepFramePlan::ReferencePoint : 0;
+    m_frameInPoint = 0;
+}
+
+void ParameterSweepRunner::Stop()
+{
+    m_running = false;
+}
+
+bool ParameterSweepRunner::IsRunning() const
+{
+    return m_running;
+}
+
+uint32_t ParameterSweepRunner::GetFramesPerPoint(int pointIndex) const
+{
+    // Warmup, measured frames, and one frame to resolve the timers of the last measured frame.
+    // The reference captures start on the last measured frame, so they cover the resolve frame.
+    const uint32_t frames = m_settings.warmupFrames + m_settings.measuredFrames;
+
+    if (pointIndex == SweepFramePlan::ReferencePoint)
+        return frames - 1 + std::max(m_settings.referenceFrames, 2u);
+
+    return frames + 1;
+}
+
+SweepFramePlan ParameterSweepRunner::GetFramePlan() const
+{
+    SweepFramePlan plan;
+    if (!m_running)
+        return plan;
+
+    const uint32_t firstMeasured = m_settings.warmupFrames;
+    const uint32_t lastMeasured = firstMeasured + m_settings.measuredFrames - 1;
+
+    plan.pointIndex = m_currentPoint;
+    plan.applySettings = (m_frameInPoint == 0);
+    plan.frameIndex = m_frameInPoint;
+
+    // Warmup frames stay on the first frame of the path so that temporal reuse converges
+    // on the same view that the measurement starts with.
+    if (m_frameInPoint > firstMeasured)
+        plan.pathFrame = std::min(m_frameInPoint, lastMeasured) - firstMeasured;
+
+    // The profiler resolves the previous frame's queries, so the timings of measured frame N
+    // are accumulated on frame N+1. The accumulator is reset right before the first measured
+    // frame is resolved, and the result is final after the extra frame at the end.
+    plan.accumulateTimings = (m_frameInPoint > firstMeasured);
+    plan.resetTimings = (m_frameInPoint == firstMeasured + 1);
+    plan.collectTimings = (m_frameInPoint == lastMeasured + 1);
+    plan.captureImage = (m_frameInPoint == lastMeasured);
+
+    if (m_currentPoint == SweepFramePlan::ReferencePoint)
+        plan.captureImage = (m_frameInPoint >= lastMeasured);
+
+    return plan;
+}
+
+const SweepPoint* ParameterSweepRunner::GetPoint(int pointIndex) const
+{
+    if (pointIndex < 0 || pointIndex >= int(m_schedule.size()))
+        return nullptr;
+
+    return &m_schedule[pointIndex];
+}
+
+void ParameterSweepRunner::AdvanceFrame()
+{
+    if (!m_running)
+        return;
+
+    m_frameInPoint++;
+    if (m_frameInPoint < GetFramesPerPoint(m_currentPoint))
+        return;
+
+    if (m_currentPoint != SweepFramePlan::ReferencePoint)
+    {
+        m_pendingResult.point = m_schedule[m_currentPoint];
+        m_results.Add(m_pendingResult);
+    }
+
+    m_pendingResult = SweepResult();
+    m_frameInPoint = 0;
+    m_currentPoint++;
+
+    if (m_currentPoint >= int(m_schedule.size()))
+        m_running = false;
+}
+
+void ParameterSweepRunner::SubmitImage(int pointIndex, const std::vector<float>& rgbaImage)
+{
+    if (pointIndex != m_currentPoint)
+        return;
+
+    if (pointIndex == SweepFramePlan::ReferencePoint)
+    {
+        // Keep a running average of the captured frames
+        if (m_referenceImage.size() != rgbaImage.size())
+        {
+            m_referenceImage = rgbaImage;
+            m_referenceImageCount = 1;
+            return;
+        }
+
+        m_referenceImageCount++;
+        const float weight = 1.f / float(m_referenceImageCount);
+        for (size_t i = 0; i < rgbaImage.size(); i++)
+            m_referenceImage[i] += (rgbaImage[i] - m_referenceImage[i]) * weight;
+        return;
+    }
+
+    if (m_referenceImage.empty() || rgbaImage.size() != m_referenceImage.size())
+        return;
+
+    m_pendingResult.imageError = ComputeImageError(rgbaImage.data(), m_referenceImage.data(),
+        rgbaImage.size() / 4, m_settings.errorMetric);
+    m_pendingResult.hasImageError = true;
+}
+
+void ParameterSweepRunner::SubmitTimings(int pointIndex, double frameTimeMs, const std::vector<double>& sectionTimesMs)
+{
+    if (pointIndex != m_currentPoint)
+        return;
+
+    SweepResult& result = (pointIndex == SweepFramePlan::ReferencePoint) ? m_referenceResult : m_pendingResult;
+    result.frameTimeMs = frameTimeMs;
+    result.sectionTimesMs = sectionTimesMs;
+}
+
+uint32_t ParameterSweepRunner::GetCompletedPointCount() const
+{
+    return uint32_t(m_results.GetResults().size());
+}
+
+uint32_t ParameterSweepRunner::GetTotalPointCount() const
+{
+    return uint32_t(m_schedule.size());
+}
+
+const SweepGrid& ParameterSweepRunner::GetGrid() const
+{
+    return m_grid;
+}
+
+const SweepResultStore& ParameterSweepRunner::GetResults() const
+{
+    return m_results;
+}
+
+const SweepResult& ParameterSweepRunner::GetReferenceResult() const
+{
+    return m_referenceResult;
+}
@@ -0,0 +1,182 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// The parameter sweep explores the quality/performance trade-off of the ReSTIR settings.
+// A sweep is described by a grid of named parameters, each taking a list of values.
+// Every point of the grid is rendered along a fixed camera path; the runner collects
+// the profiler timings and the image error against a reference rendering, and the
+// result store reports the Pareto front of cost versus error.
+//
+// Everything in this file is independent from the graphics device, so that grid expansion,
+// scheduling and result processing can be exercised without a GPU.
+
+struct SweepAxis
+{
+    std::string name;
+    std::vector<float> values;
+
+    // Static axes map to settings that force the importance sampling context to be recreated
+    // (e.g. checkerboard mode). The scheduler changes them as rarely as possible.
+    bool isStatic = false;
+};
+
+struct SweepPoint
+{
+    uint32_t index = 0;         // linear index in the grid, stable across scheduling
+    std::vector<float> values;  // one value per axis, in axis order
+};
+
+class SweepGrid
+{
+public:
+    void AddAxis(const std::string& name, const std::vector<float>& values, bool isStatic = false);
+    bool SetAxisStatic(const std::string& name, bool isStatic);
+
+    // Parses a grid declaration of the form "name=1,2,4; other=0,1".
+    // Returns false and fills errorMessage if the declaration is malformed.
+    bool Parse(const std::string& text, std::string& errorMessage);
+
+    void Clear();
+
+    [[nodiscard]] const std::vector<SweepAxis>& GetAxes() const;
+    [[nodiscard]] int FindAxis(const std::string& name) const;
+    [[nodiscard]] size_t GetPointCount() const;
+
+    // Returns the grid point with the given linear index; the last axis varies fastest.
+    [[nodiscard]] SweepPoint GetPoint(size_t index) const;
+    [[nodiscard]] std::vector<SweepPoint> Expand() const;
+
+    // Returns the points in the order in which they should be rendered:
+    // static axes vary slowest so that expensive context resets happen only when required.
+    [[nodiscard]] std::vector<SweepPoint> Schedule() const;
+
+    [[nodiscard]] std::string DescribePoint(const SweepPoint& point) const;
+
+private:
+    std::vector<SweepAxis> m_axes;
+};
+
+struct SweepResult
+{
+    SweepPoint point;
+    double frameTimeMs = 0.0;
+    double imageError = 0.0;
+    bool hasImageError = false;
+    std::vector<double> sectionTimesMs;
+};
+
+// Returns the indices of the results that are not dominated by any other result,
+// minimizing both frame time and image error. The indices are sorted by frame time.
+// Results without an image error can't be compared on quality and are left out; when no result
+// has an image error, the front is the cheapest result alone.
+std::vector<size_t> ComputeParetoFront(const std::vector<SweepResult>& results);
+
+class SweepResultStore
+{
+public:
+    void Clear();
+    void Add(const SweepResult& result);
+
+    [[nodiscard]] const std::vector<SweepResult>& GetResults() const;
+    [[nodiscard]] std::vector<size_t> GetParetoFront() const;
+
+    void WriteCsv(std::ostream& stream, const SweepGrid& grid, const std::vector<std::string>& sectionNames) const;
+    [[nodiscard]] std::string GetReport(const SweepGrid& grid) const;
+
+private:
+    std::vector<SweepResult> m_results;
+};
+
+enum class ImageErrorMetric : uint32_t
+{
+    RMSE,
+    RelMSE
+};
+
+// Computes the error of an RGBA image against a reference of the same size. Alpha is ignored.
+// An image with a non-finite channel is broken and gets an infinite error, which keeps it off the
+// Pareto front. Non-finite reference channels are skipped.
+double ComputeImageError(const float* image, const float* reference, size_t pixelCount, ImageErrorMetric metric);
+
+// Converts a tightly packed RGBA16_FLOAT row into floats, used for readback of HDR render targets.
+void ConvertHalfToFloat(const uint16_t* source, float* destination, size_t count);
+
+struct ParameterSweepSettings
+{
+    uint32_t warmupFrames = 30;     // frames rendered on the first path frame to fill the temporal history
+    uint32_t measuredFrames = 60;   // frames of the camera path that are timed
+    bool captureReference = true;   // render the reference configuration first and measure the image error
+    uint32_t referenceFrames = 16;  // frames averaged on the last path frame to reduce the noise of the reference
+    ImageErrorMetric errorMetric = ImageErrorMetric::RelMSE;
+};
+
+// What the renderer has to do on the current frame of a sweep.
+struct SweepFramePlan
+{
+    static constexpr int ReferencePoint = -1;
+
+    int pointIndex = ReferencePoint;    // index into the schedule, or ReferencePoint
+    bool applySettings = false;         // first frame of a point: reset and apply the settings
+    uint32_t frameIndex = 0;            // frame index within the point, used to seed the samplers deterministically
+    uint32_t pathFrame = 0;             // frame of the fixed camera path to render
+    bool accumulateTimings = false;     // profiler accumulation mode for this frame
+    bool resetTimings = false;          // reset the accumulated timings before resolving the previous frame
+    bool collectTimings = false;        // after resolving the previous frame, the timings of this point are final
+    bool captureImage = false;          // read back the final image at the end of this frame
+};
+
+// Frame-by-frame scheduler for a parameter sweep.
+// Each point is rendered for warmupFrames on path frame 0, then for measuredFrames along the path,
+// then one more frame so that the timer queries of the last measured frame can be resolved.
+// The reference point additionally holds the last path frame and averages referenceFrames captures.
+class ParameterSweepRunner
+{
+public:
+    void Start(const SweepGrid& grid, const ParameterSweepSettings& settings);
+    void Stop();
+
+    [[nodiscard]] bool IsRunning() const;
+    [[nodiscard]] SweepFramePlan GetFramePlan() const;
+    [[nodiscard]] const SweepPoint* GetPoint(int pointIndex) const;
+    void AdvanceFrame();
+
+    void SubmitImage(int pointIndex, const std::vector<float>& rgbaImage);
+    void SubmitTimings(int pointIndex, double frameTimeMs, const std::vector<double>& sectionTimesMs);
+
+    [[nodiscard]] uint32_t GetCompletedPointCount() const;
+    [[nodiscard]] uint32_t GetTotalPointCount() const;
+    [[nodiscard]] const SweepGrid& GetGrid() const;
+    [[nodiscard]] const SweepResultStore& GetResults() const;
+    [[nodiscard]] const SweepResult& GetReferenceResult() const;
+
+private:
+    [[nodiscard]] uint32_t GetFramesPerPoint(int pointIndex) const;
+
+    SweepGrid m_grid;
+    ParameterSweepSettings m_settings;
+    std::vector<SweepPoint> m_schedule;
+    SweepResultStore m_results;
+    SweepResult m_referenceResult;
+    SweepResult m_pendingResult;
+
+    std::vector<float> m_referenceImage;
+    uint32_t m_referenceImageCount = 0;
+
+    bool m_running = false;
+    int m_currentPoint = 0;
+    uint32_t m_frameInPoint = 0;
+};
@@ -0,0 +1,203 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "PipelineJobList.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double ElapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void SerialPipelineJobFor(size_t taskCount, const std::function<void(size_t task)>& task)
+{
+    for (size_t index = 0; index < taskCount; index++)
+        task(index);
+}
+
+void PipelineJobList::Add(std::string name, Job job)
+{
+    m_names.push_back(std::move(name));
+    m_jobs.push_back(std::move(job));
+}
+
+void PipelineJobList::Clear()
+{
+    m_names.clear();
+    m_jobs.clear();
+    m_results.clear();
+    m_wallTimeMs = 0.0;
+}
+
+void PipelineJobList::RunJob(size_t index)
+{
+    // Every task writes only its own result, so the results need no synchronization
+    PipelineJobResult& result = m_results[index];
+    const Clock::time_point start = Clock::now();
+
+    try
+    {
+        result.succeeded = m_jobs[index]();
+    }
+    catch (const std::exception& exception)
+    {
+        result.succeeded = false;
+        result.error = exception.what();
+    }
+    catch (...)
+    {
+        result.succeeded = false;
+        result.error = "unknown exception";
+    }
+
+    result.durationMs = ElapsedMs(start);
+}
+
+bool PipelineJobList::AllSucceeded() const
+{
+    for (const PipelineJobResult& result : m_results)
+    {
+        if (!result.succeeded)
+            return false;
+    }
+
+    return true;
+}
+
+bool PipelineJobList::Run(const PipelineJobParallelFor& parallelFor)
+{
+    m_results.assign(m_jobs.size(), PipelineJobResult());
+
+    auto runJob = [this](size_t index) { RunJob(index); };
+
+    const Clock::time_point start = Clock::now();
+
+    if (parallelFor && m_jobs.size() > 1)
+        parallelFor(m_jobs.size(), runJob);
+    else
+        SerialPipelineJobFor(m_jobs.size(), runJob);
+
+    m_wallTimeMs = ElapsedMs(start);
+
+    return AllSucceeded();
+}
+
+void PipelineJobList::RunAsync(const PipelineJobLauncher& launch, std::function<void(bool succeeded)> done)
+{
+    m_results.assign(m_jobs.size(), PipelineJobResult());
+
+    const Clock::time_point start = Clock::now();
+
+    launch(m_jobs.size(), [this](size_t index) { RunJob(index); }, [this, start, done = std::move(done)]()
+    {
+        m_wallTimeMs = ElapsedMs(start);
+        done(AllSucceeded());
+    });
+}
+
+std::vector<std::string> PipelineJobList::GetFailures() const
+{
+    std::vector<std::string> failures;
+    for (size_t index = 0; index < m_results.size(); index++)
+    {
+        const PipelineJobResult& result = m_results[index];
+        if (result.succeeded)
+            continue;
+
+        if (result.error.empty())
+            failures.push_back(m_names[index]);
+        else
+            failures.push_back(m_names[index] + ": " + result.error);
+    }
+    return failures;
+}
+
+size_t PipelineJobList::GetJobCount() const
+{
+    return m_jobs.size();
+}
+
+const std::string& PipelineJobList::GetJobName(size_t index) const
+{
+    return m_names[index];
+}
+
+const std::vector<PipelineJobResult>& PipelineJobList::GetResults() const
+{
+    return m_results;
+}
+
+double PipelineJobList::GetWallTimeMs() const
+{
+    return m_wallTimeMs;
+}
+
+double PipelineJobList::GetTotalJobTimeMs() const
+{
+    double total = 0.0;
+    for (const PipelineJobResult& result : m_results)
+        total += result.durationMs;
+    return total;
+}
+
+PipelineJobBenchmarkResult BenchmarkPipelineJobs(uint32_t jobCount, double compileLatencyMs, uint32_t failEvery,
+    const PipelineJobParallelFor& parallelFor)
+{
+    PipelineJobBenchmarkResult result;
+    result.jobCount = jobCount;
+    result.compileLatencyMs = compileLatencyMs;
+
+    // Mock device: every job blocks for the compile latency, like a shader load and a driver compile,
+    // and counts how many times it ran
+    std::vector<std::atomic<uint32_t>> runCounts(jobCount);
+    for (std::atomic<uint32_t>& count : runCounts)
+        count = 0;
+
+    PipelineJobList jobs;
+    for (uint32_t index = 0; index < jobCount; index++)
+    {
+        jobs.Add("Pass" + std::to_string(index), [&runCounts, index, compileLatencyMs, failEvery]()
+        {
+            runCounts[index]++;
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(compileLatencyMs));
+
+            if (failEvery == 0 || (index + 1) % failEvery != 0)
+                return true;
+
+            if (((index + 1) / failEvery) % 2 == 0)
+                throw std::runtime_error("compile error");
+
+            return false;
+        });
+    }
+
+    const bool serialSucceeded = jobs.Run(SerialPipelineJobFor);
+    result.serialMs = jobs.GetWallTimeMs();
+    const std::vector<std::string> serialFailures = jobs.GetFailures();
+
+    const bool parallelSucceeded = jobs.Run(parallelFor);
+    result.parallelMs = jobs.GetWallTimeMs();
+    const std::vector<std::string> parallelFailures = jobs.GetFailures();
+
+    result.resultsMatch = serialSucceeded == parallelSucceeded && serialFailures == parallelFailures;
+    for (const std::atomic<uint32_t>& count : runCounts)
+    {
+        if (count != 2)
+            result.resultsMatch = false;
+    }
+
+    return result;
+}
@@ -0,0 +1,93 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// List of independent pipeline creation jobs that are run in parallel.
+//
+// Every job loads the shaders of one pass and creates its pipeline. Jobs have no dependencies on each
+// other and write only to the pass they were created for, so the list can be fanned out to any number
+// of worker threads in any order. The outcome of every job is stored at the job's index, and failures
+// are reported in the order the jobs were added once all of them are done, so the error log is the same
+// regardless of the thread count and the completion order. A job that throws counts as failed.
+//
+// The module has no dependencies on the renderer, parallelism is provided by the caller.
+
+// Calls task(0) ... task(taskCount - 1), possibly in parallel, and returns when all of them are done.
+using PipelineJobParallelFor = std::function<void(size_t taskCount, const std::function<void(size_t task)>& task)>;
+
+// Runs the tasks one after another on the calling thread
+void SerialPipelineJobFor(size_t taskCount, const std::function<void(size_t task)>& task);
+
+// Starts task(0) ... task(taskCount - 1) in the background, possibly in parallel, and returns right away.
+// Calls done once after all tasks have finished, on any thread.
+using PipelineJobLauncher = std::function<void(size_t taskCount, std::function<void(size_t task)> task, std::function<void()> done)>;
+
+struct PipelineJobResult
+{
+    bool succeeded = false;
+    double durationMs = 0.0;
+    std::string error;          // message of the exception that ended the job, if any
+};
+
+class PipelineJobList
+{
+public:
+    // Returns true if the pipeline was created
+    using Job = std::function<bool()>;
+
+    void Add(std::string name, Job job);
+    void Clear();
+
+    // Runs every job exactly once. Returns true if all of them succeeded.
+    bool Run(const PipelineJobParallelFor& parallelFor);
+
+    // Like Run, but returns right away and calls done with the outcome when all jobs have finished.
+    // The list must stay alive and unchanged until then.
+    void RunAsync(const PipelineJobLauncher& launch, std::function<void(bool succeeded)> done);
+
+    // Names of the failed jobs with their errors, in the order the jobs were added
+    [[nodiscard]] std::vector<std::string> GetFailures() const;
+
+    [[nodiscard]] size_t GetJobCount() const;
+    [[nodiscard]] const std::string& GetJobName(size_t index) const;
+    [[nodiscard]] const std::vector<PipelineJobResult>& GetResults() const;
+    [[nodiscard]] double GetWallTimeMs() const;    // of the last Run
+    [[nodiscard]] double GetTotalJobTimeMs() const; // sum of the job durations of the last Run
+
+private:
+    void RunJob(size_t index);
+    [[nodiscard]] bool AllSucceeded() const;
+
+    std::vector<std::string> m_names;
+    std::vector<Job> m_jobs;
+    std::vector<PipelineJobResult> m_results;
+    double m_wallTimeMs = 0.0;
+};
+
+struct PipelineJobBenchmarkResult
+{
+    uint32_t jobCount = 0;
+    double compileLatencyMs = 0.0;
+    double serialMs = 0.0;
+    double parallelMs = 0.0;
+    bool resultsMatch = false;  // every job ran once and the failures are reported identically
+};
+
+// Runs a list of mock jobs that sleep for the given time, as a shader load and driver compile would,
+// serially and in parallel. Every failEvery-th job fails, half of them by throwing; 0 disables failures.
+PipelineJobBenchmarkResult BenchmarkPipelineJobs(uint32_t jobCount, double compileLatencyMs, uint32_t failEvery,
+    const PipelineJobParallelFor& parallelFor);
@@ -9,12 +9,15 @@
  **************************************************************************/
 
 #include "Profiler.h"
+#include "AllocationTracker.h"
 #include <donut/app/DeviceManager.h>
 #include <imgui.h>
 #include <sstream>
 
 #include "RenderTargets.h"
 
+using namespace donut::math;
+#include "../shaders/ShaderParameters.h"
 
 static const char* g_SectionNames[ProfilerSection::Count] = {
     "TLAS Update",
@@ -68,6 +71,36 @@ Profiler::Profiler(donut::app::DeviceManager& deviceManager)
     {
         m_rayCountReadback[bank] = m_device->createBuffer(rayCountBufferDesc);
     }
+
+    // The tile buffers are resized to match the render targets in SetRenderTargets
+    CreateRayCountTileBuffers(1, 1);
+}
+
+void Profiler::CreateRayCountTileBuffers(uint32_t width, uint32_t height)
+{
+    m_rayCountTiles.Resize(width, height, RAY_COUNT_TILE_SIZE);
+    m_tileGridWidth = m_rayCountTiles.gridWidth;
+    m_tileGridHeight = m_rayCountTiles.gridHeight;
+
+    nvrhi::BufferDesc tileBufferDesc;
+    tileBufferDesc.byteSize = sizeof(uint32_t) * 2 * m_tileGridWidth * m_tileGridHeight;
+    tileBufferDesc.format = nvrhi::Format::R32_UINT;
+    tileBufferDesc.canHaveUAVs = true;
+    tileBufferDesc.canHaveTypedViews = true;
+    tileBufferDesc.debugName = "RayCountTiles";
+    tileBufferDesc.initialState = nvrhi::ResourceStates::UnorderedAccess;
+    tileBufferDesc.keepInitialState = true;
+    m_rayCountTileBuffer = m_device->createBuffer(tileBufferDesc);
+
+    tileBufferDesc.canHaveUAVs = false;
+    tileBufferDesc.cpuAccess = nvrhi::CpuAccessMode::Read;
+    tileBufferDesc.initialState = nvrhi::ResourceStates::Common;
+    tileBufferDesc.debugName = "RayCountTilesReadback";
+    for (size_t bank = 0; bank < 2; bank++)
+    {
+        m_rayCountTileReadback[bank] = m_device->createBuffer(tileBufferDesc);
+        m_rayCountTileReadbackWritten[bank] = false;
+    }
 }
 
 bool Profiler::IsEnabled() const
@@ -152,15 +185,45 @@ void Profiler::ResolvePreviousFrame()
         m_accumulatedFrames += 1;
     else
         m_accumulatedFrames = 1;
+
+    if (m_rayCountTileReadbackWritten[m_activeBank])
+    {
+        m_rayCountTileReadbackWritten[m_activeBank] = false;
+
+        const uint32_t* tileData = static_cast<const uint32_t*>(m_device->mapBuffer(m_rayCountTileReadback[m_activeBank], nvrhi::CpuAccessMode::Read));
+        if (tileData)
+        {
+            std::vector<uint32_t>& counters = m_rayCountTiles.counters;
+
+            if (m_accumulateTileRayCounts)
+            {
+                for (size_t i = 0; i < counters.size(); i++)
+                    counters[i] += tileData[i];
+                m_rayCountTiles.frameCount += 1;
+            }
+            else
+            {
+                std::copy(tileData, tileData + counters.size(), counters.begin());
+                m_rayCountTiles.frameCount = 1;
+            }
+
+            m_device->unmapBuffer(m_rayCountTileReadback[m_activeBank]);
+        }
+    }
 }
 
 void Profiler::BeginFrame(nvrhi::ICommandList* commandList)
 {
-    if (!m_enabled)
-        return;
+    if (m_enabled)
+    {
+        commandList->clearBufferUInt(m_rayCountBuffer, 0);
 
-    commandList->clearBufferUInt(m_rayCountBuffer, 0);
+        if (m_tileRayCountsEnabled)
+            commandList->clearBufferUInt(m_rayCountTileBuffer, 0);
+    }
 
+    // Always open the frame section, even when the profiler is disabled, to keep the
+    // allocation scopes balanced with the unconditional EndSection in EndFrame.
     BeginSection(commandList, ProfilerSection::Frame);
 }
 
@@ -176,11 +239,25 @@ void Profiler::EndFrame(nvrhi::ICommandList* commandList)
             m_rayCountBuffer,
             0,
             ProfilerSection::Count * sizeof(uint32_t) * 2);
+
+        if (m_tileRayCountsEnabled)
+        {
+            commandList->copyBuffer(
+                m_rayCountTileReadback[m_activeBank],
+                0,
+                m_rayCountTileBuffer,
+                0,
+                m_rayCountTileBuffer->getDesc().byteSize);
+
+            m_rayCountTileReadbackWritten[m_activeBank] = true;
+        }
     }
 }
 
 void Profiler::BeginSection(nvrhi::ICommandList* commandList, const ProfilerSection::Enum section)
 {
+    AllocationTracker::PushScope(section);
+
     if (!m_enabled)
         return;
 
@@ -191,6 +268,8 @@ void Profiler::BeginSection(nvrhi::ICommandList* commandList, const ProfilerSect
 
 void Profiler::EndSection(nvrhi::ICommandList* commandList, const ProfilerSection::Enum section)
 {
+    AllocationTracker::PopScope();
+
     if (!m_enabled)
         return;
     
@@ -201,6 +280,9 @@ void Profiler::EndSection(nvrhi::ICommandList* commandList, const ProfilerSectio
 void Profiler::SetRenderTargets(const std::shared_ptr<RenderTargets>& renderTargets)
 {
     m_renderTargets = renderTargets;
+
+    if (renderTargets)
+        CreateRayCountTileBuffers(uint32_t(renderTargets->Size.x), uint32_t(renderTargets->Size.y));
 }
 
 double Profiler::GetTimer(ProfilerSection::Enum section)
@@ -211,6 +293,11 @@ double Profiler::GetTimer(ProfilerSection::Enum section)
     return m_timerValues[section] / double(m_accumulatedFrames);
 }
 
+const char* Profiler::GetSectionName(ProfilerSection::Enum section)
+{
+    return g_SectionNames[section];
+}
+
 double Profiler::GetRayCount(ProfilerSection::Enum section)
 {
     if (m_accumulatedFrames == 0)
@@ -371,3 +458,65 @@ ProfilerScope::~ProfilerScope()
     m_Profiler.EndSection(m_CommandList, m_Section);
     m_CommandList = nullptr;
 }
+
+void Profiler::EnableTileRayCounts(bool enable)
+{
+    if (enable && !m_tileRayCountsEnabled)
+        m_rayCountTiles.Clear();
+
+    m_tileRayCountsEnabled = enable;
+}
+
+bool Profiler::IsTileRayCountsEnabled() const
+{
+    return m_tileRayCountsEnabled;
+}
+
+void Profiler::SetTileRayCountSection(int section)
+{
+    if (section != m_tileRayCountSection)
+        m_rayCountTiles.Clear();
+
+    m_tileRayCountSection = section;
+}
+
+int Profiler::GetTileRayCountSection() const
+{
+    return m_tileRayCountSection;
+}
+
+void Profiler::EnableTileRayCountAccumulation(bool enable)
+{
+    m_accumulateTileRayCounts = enable;
+}
+
+bool Profiler::IsTileRayCountAccumulationEnabled() const
+{
+    return m_accumulateTileRayCounts;
+}
+
+void Profiler::ResetTileRayCounts()
+{
+    m_rayCountTiles.Clear();
+}
+
+uint32_t Profiler::GetRayCountTileGridWidth(ProfilerSection::Enum section) const
+{
+    if (!m_enabled || !m_tileRayCountsEnabled)
+        return 0;
+
+    if (m_tileRayCountSection >= 0 && m_tileRayCountSection != int(section))
+        return 0;
+
+    return m_tileGridWidth;
+}
+
+const RayCountTileGrid& Profiler::GetRayCountTiles() const
+{
+    return m_rayCountTiles;
+}
+
+nvrhi::IBuffer* Profiler::GetRayCountTileBuffer() const
+{
+    return m_rayCountTileBuffer;
+}
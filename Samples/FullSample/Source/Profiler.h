@@ -15,6 +15,7 @@
 #include <memory>
 
 #include "ProfilerSections.h"
+#include "RayCountHeatmap.h"
 
 class RenderTargets;
 
@@ -41,6 +42,7 @@ public:
 
     double GetTimer(ProfilerSection::Enum section);
     double GetRayCount(ProfilerSection::Enum section);
+    static const char* GetSectionName(ProfilerSection::Enum section);
     double GetHitCount(ProfilerSection::Enum section);
     int GetMaterialReadback();
 
@@ -49,7 +51,24 @@ public:
 
     [[nodiscard]] nvrhi::IBuffer* GetRayCountBuffer() const;
 
+    // Per-tile ray counters, see RAY_COUNT_TILE_SIZE.
+    // The tiles are collected for one section at a time, or for all sections if the section is negative.
+    void EnableTileRayCounts(bool enable);
+    [[nodiscard]] bool IsTileRayCountsEnabled() const;
+    void SetTileRayCountSection(int section);
+    [[nodiscard]] int GetTileRayCountSection() const;
+    void EnableTileRayCountAccumulation(bool enable);
+    [[nodiscard]] bool IsTileRayCountAccumulationEnabled() const;
+    void ResetTileRayCounts();
+
+    // Returns the tile grid width that the given section should pass to the shaders, or 0 if it should not count tiles.
+    [[nodiscard]] uint32_t GetRayCountTileGridWidth(ProfilerSection::Enum section) const;
+    [[nodiscard]] const RayCountTileGrid& GetRayCountTiles() const;
+    [[nodiscard]] nvrhi::IBuffer* GetRayCountTileBuffer() const;
+
 private:
+    void CreateRayCountTileBuffers(uint32_t width, uint32_t height);
+
     bool m_enabled = true;
     bool m_isAccumulating = false;
     uint32_t m_accumulatedFrames = 0;
@@ -65,6 +84,16 @@ private:
     nvrhi::DeviceHandle m_device;
     nvrhi::BufferHandle m_rayCountBuffer;
     std::array<nvrhi::BufferHandle, 2> m_rayCountReadback;
+
+    bool m_tileRayCountsEnabled = false;
+    bool m_accumulateTileRayCounts = false;
+    int m_tileRayCountSection = -1;
+    uint32_t m_tileGridWidth = 0;
+    uint32_t m_tileGridHeight = 0;
+    nvrhi::BufferHandle m_rayCountTileBuffer;
+    std::array<nvrhi::BufferHandle, 2> m_rayCountTileReadback;
+    std::array<bool, 2> m_rayCountTileReadbackWritten{};
+    RayCountTileGrid m_rayCountTiles;
     std::weak_ptr<RenderTargets> m_renderTargets;
 };
 
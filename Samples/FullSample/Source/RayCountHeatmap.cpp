@@ -0,0 +1,316 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "RayCountHeatmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+void RayCountTileGrid::Resize(uint32_t width, uint32_t height, uint32_t tileSizeInPixels)
+{
+    tileSize = std::max(tileSizeInPixels, 1u);
+    imageWidth = width;
+    imageHeight = height;
+    gridWidth = (width + tileSize - 1) / tileSize;
+    gridHeight = (height + tileSize - 1) / tileSize;
+    counters.assign(size_t(gridWidth) * gridHeight * 2, 0);
+    frameCount = 0;
+}
+
+void RayCountTileGrid::Clear()
+{
+    std::fill(counters.begin(), counters.end(), 0);
+    frameCount = 0;
+}
+
+uint32_t RayCountTileGrid::GetTileCount() const
+{
+    return gridWidth * gridHeight;
+}
+
+uint32_t RayCountTileGrid::GetTraced(uint32_t tileX, uint32_t tileY) const
+{
+    return counters[(size_t(tileY) * gridWidth + tileX) * 2];
+}
+
+uint32_t RayCountTileGrid::GetHits(uint32_t tileX, uint32_t tileY) const
+{
+    return counters[(size_t(tileY) * gridWidth + tileX) * 2 + 1];
+}
+
+uint32_t RayCountTileGrid::GetTilePixelCount(uint32_t tileX, uint32_t tileY) const
+{
+    const uint32_t width = std::min(tileSize, imageWidth - std::min(imageWidth, tileX * tileSize));
+    const uint32_t height = std::min(tileSize, imageHeight - std::min(imageHeight, tileY * tileSize));
+    return width * height;
+}
+
+double RayCountTileGrid::GetRaysPerPixel(uint32_t tileX, uint32_t tileY) const
+{
+    const uint32_t pixels = GetTilePixelCount(tileX, tileY);
+    if (pixels == 0 || frameCount == 0)
+        return 0.0;
+
+    return double(GetTraced(tileX, tileY)) / (double(pixels) * double(frameCount));
+}
+
+RayCountSummary SummarizeRayCounts(const RayCountTileGrid& grid)
+{
+    RayCountSummary summary;
+
+    for (uint32_t y = 0; y < grid.gridHeight; y++)
+    {
+        for (uint32_t x = 0; x < grid.gridWidth; x++)
+        {
+            summary.traced += grid.GetTraced(x, y);
+            summary.hits += grid.GetHits(x, y);
+            summary.maxRaysPerPixel = std::max(summary.maxRaysPerPixel, grid.GetRaysPerPixel(x, y));
+        }
+    }
+
+    const double pixels = double(grid.imageWidth) * double(grid.imageHeight);
+    if (pixels > 0.0 && grid.frameCount > 0)
+        summary.meanRaysPerPixel = double(summary.traced) / (pixels * double(grid.frameCount));
+
+    return summary;
+}
+
+RayCountHistogram BuildRayCountHistogram(const RayCountTileGrid& grid, uint32_t binCount, double maxRaysPerPixel)
+{
+    RayCountHistogram histogram;
+    binCount = std::max(binCount, 1u);
+    histogram.bins.assign(binCount, 0);
+
+    if (maxRaysPerPixel <= 0.0)
+        maxRaysPerPixel = SummarizeRayCounts(grid).maxRaysPerPixel;
+
+    if (maxRaysPerPixel <= 0.0)
+        maxRaysPerPixel = 1.0;
+
+    histogram.binWidth = maxRaysPerPixel / double(binCount);
+
+    for (uint32_t y = 0; y < grid.gridHeight; y++)
+    {
+        for (uint32_t x = 0; x < grid.gridWidth; x++)
+        {
+            const double raysPerPixel = grid.GetRaysPerPixel(x, y);
+            const uint32_t bin = std::min(uint32_t(raysPerPixel / histogram.binWidth), binCount - 1);
+            histogram.bins[bin]++;
+        }
+    }
+
+    return histogram;
+}
+
+std::vector<RayCountTile> FindHottestTiles(const RayCountTileGrid& grid, uint32_t count)
+{
+    std::vector<RayCountTile> tiles;
+    tiles.reserve(grid.GetTileCount());
+
+    for (uint32_t y = 0; y < grid.gridHeight; y++)
+    {
+        for (uint32_t x = 0; x < grid.gridWidth; x++)
+        {
+            RayCountTile tile;
+            tile.x = x;
+            tile.y = y;
+            tile.traced = grid.GetTraced(x, y);
+            tile.hits = grid.GetHits(x, y);
+            tile.raysPerPixel = grid.GetRaysPerPixel(x, y);
+            tiles.push_back(tile);
+        }
+    }
+
+    auto hotter = [](const RayCountTile& a, const RayCountTile& b)
+    {
+        if (a.raysPerPixel != b.raysPerPixel)
+            return a.raysPerPixel > b.raysPerPixel;
+        if (a.y != b.y)
+            return a.y < b.y;
+        return a.x < b.x;
+    };
+
+    count = std::min(count, uint32_t(tiles.size()));
+    std::partial_sort(tiles.begin(), tiles.begin() + count, tiles.end(), hotter);
+    tiles.resize(count);
+
+    return tiles;
+}
+
+// Black - blue - cyan - green - yellow - red
+static void HeatmapColor(double t, uint8_t* rgb)
+{
+    static const float stops[6][3] = {
+        { 0.f, 0.f, 0.f },
+        { 0.f, 0.f, 1.f },
+        { 0.f, 1.f, 1.f },
+        { 0.f, 1.f, 0.f },
+        { 1.f, 1.f, 0.f },
+        { 1.f, 0.f, 0.f }
+    };
+
+    t = std::min(std::max(t, 0.0), 1.0) * 5.0;
+    const int index = std::min(int(t), 4);
+    const float frac = float(t - double(index));
+
+    for (int channel = 0; channel < 3; channel++)
+    {
+        const float value = stops[index][channel] + (stops[index + 1][channel] - stops[index][channel]) * frac;
+        rgb[channel] = uint8_t(std::lround(value * 255.f));
+    }
+}
+
+std::vector<uint8_t> BuildRayCountHeatmap(const RayCountTileGrid& grid, double maxRaysPerPixel, bool fullResolution,
+    uint32_t& outWidth, uint32_t& outHeight)
+{
+    outWidth = fullResolution ? grid.imageWidth : grid.gridWidth;
+    outHeight = fullResolution ? grid.imageHeight : grid.gridHeight;
+
+    if (maxRaysPerPixel <= 0.0)
+        maxRaysPerPixel = SummarizeRayCounts(grid).maxRaysPerPixel;
+
+    if (maxRaysPerPixel <= 0.0)
+        maxRaysPerPixel = 1.0;
+
+    std::vector<uint8_t> tileColors(size_t(grid.GetTileCount()) * 3);
+    for (uint32_t y = 0; y < grid.gridHeight; y++)
+    {
+        for (uint32_t x = 0; x < grid.gridWidth; x++)
+        {
+            HeatmapColor(grid.GetRaysPerPixel(x, y) / maxRaysPerPixel, &tileColors[(size_t(y) * grid.gridWidth + x) * 3]);
+        }
+    }
+
+    if (!fullResolution)
+        return tileColors;
+
+    std::vector<uint8_t> image(size_t(outWidth) * outHeight * 3);
+    for (uint32_t y = 0; y < outHeight; y++)
+    {
+        for (uint32_t x = 0; x < outWidth; x++)
+        {
+            const uint8_t* source = &tileColors[(size_t(y / grid.tileSize) * grid.gridWidth + x / grid.tileSize) * 3];
+            uint8_t* dest = &image[(size_t(y) * outWidth + x) * 3];
+            dest[0] = source[0];
+            dest[1] = source[1];
+            dest[2] = source[2];
+        }
+    }
+
+    return image;
+}
+
+static void WriteLE16(std::ofstream& file, uint16_t value)
+{
+    const char bytes[2] = { char(value & 0xff), char(value >> 8) };
+    file.write(bytes, 2);
+}
+
+static void WriteLE32(std::ofstream& file, uint32_t value)
+{
+    const char bytes[4] = { char(value & 0xff), char((value >> 8) & 0xff), char((value >> 16) & 0xff), char(value >> 24) };
+    file.write(bytes, 4);
+}
+
+bool WriteHeatmapBmp(const std::string& fileName, const std::vector<uint8_t>& rgb, uint32_t width, uint32_t height)
+{
+    if (rgb.size() < size_t(width) * height * 3)
+        return false;
+
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    // Uncompressed 24-bit BMP, rows are bottom-up and padded to 4 bytes
+    const uint32_t rowSize = (width * 3 + 3) & ~3u;
+    const uint32_t headerSize = 14 + 40;
+    const uint32_t imageSize = rowSize * height;
+
+    file.write("BM", 2);
+    WriteLE32(file, headerSize + imageSize);
+    WriteLE32(file, 0);
+    WriteLE32(file, headerSize);
+
+    WriteLE32(file, 40);
+    WriteLE32(file, width);
+    WriteLE32(file, height);
+    WriteLE16(file, 1);     // planes
+    WriteLE16(file, 24);    // bits per pixel
+    WriteLE32(file, 0);     // no compression
+    WriteLE32(file, imageSize);
+    WriteLE32(file, 2835);  // 72 DPI
+    WriteLE32(file, 2835);
+    WriteLE32(file, 0);
+    WriteLE32(file, 0);
+
+    std::vector<char> row(rowSize, 0);
+    for (uint32_t y = height; y-- > 0; )
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint8_t* pixel = &rgb[(size_t(y) * width + x) * 3];
+            row[x * 3 + 0] = char(pixel[2]);
+            row[x * 3 + 1] = char(pixel[1]);
+            row[x * 3 + 2] = char(pixel[0]);
+        }
+        file.write(row.data(), rowSize);
+    }
+
+    return file.good();
+}
+
+void WriteRayCountTilesCsv(std::ostream& stream, const RayCountTileGrid& grid)
+{
+    stream << "tileX,tileY,pixelX,pixelY,traced,hits,raysPerPixel\n";
+
+    for (uint32_t y = 0; y < grid.gridHeight; y++)
+    {
+        for (uint32_t x = 0; x < grid.gridWidth; x++)
+        {
+            stream << x << "," << y << ","
+                << x * grid.tileSize << "," << y * grid.tileSize << ","
+                << grid.GetTraced(x, y) << "," << grid.GetHits(x, y) << ","
+                << grid.GetRaysPerPixel(x, y) << "\n";
+        }
+    }
+}
+
+void WriteRayCountHistogramCsv(std::ostream& stream, const RayCountHistogram& histogram)
+{
+    stream << "minRaysPerPixel,maxRaysPerPixel,tiles\n";
+
+    for (size_t bin = 0; bin < histogram.bins.size(); bin++)
+    {
+        stream << histogram.binWidth * double(bin) << "," << histogram.binWidth * double(bin + 1) << ","
+            << histogram.bins[bin] << "\n";
+    }
+}
+
+bool ExportRayCountTiles(const RayCountTileGrid& grid, const std::string& baseName, uint32_t histogramBins)
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const std::vector<uint8_t> heatmap = BuildRayCountHeatmap(grid, 0.0, true, width, height);
+    if (!WriteHeatmapBmp(baseName + "Heatmap.bmp", heatmap, width, height))
+        return false;
+
+    std::ofstream tilesFile(baseName + "Tiles.csv");
+    if (!tilesFile.is_open())
+        return false;
+    WriteRayCountTilesCsv(tilesFile, grid);
+
+    std::ofstream histogramFile(baseName + "Histogram.csv");
+    if (!histogramFile.is_open())
+        return false;
+    WriteRayCountHistogramCsv(histogramFile, BuildRayCountHistogram(grid, histogramBins));
+
+    return tilesFile.good() && histogramFile.good();
+}
@@ -0,0 +1,89 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// CPU-side processing of the per-tile ray counters written by the lighting passes.
+// The counters are laid out like the global ray counters: two uints per tile, traced rays
+// and hits, with the tiles stored in rows of gridWidth. Nothing here depends on the
+// graphics device, so the aggregation and export can be exercised with synthetic counters.
+
+struct RayCountTileGrid
+{
+    uint32_t tileSize = 8;
+    uint32_t imageWidth = 0;
+    uint32_t imageHeight = 0;
+    uint32_t gridWidth = 0;
+    uint32_t gridHeight = 0;
+    uint32_t frameCount = 0;            // number of frames summed in the counters
+    std::vector<uint32_t> counters;     // traced, hits for each tile
+
+    void Resize(uint32_t width, uint32_t height, uint32_t tileSizeInPixels);
+    void Clear();
+
+    [[nodiscard]] uint32_t GetTileCount() const;
+    [[nodiscard]] uint32_t GetTraced(uint32_t tileX, uint32_t tileY) const;
+    [[nodiscard]] uint32_t GetHits(uint32_t tileX, uint32_t tileY) const;
+
+    // Number of image pixels covered by the tile; tiles on the right and bottom edges may be partial.
+    [[nodiscard]] uint32_t GetTilePixelCount(uint32_t tileX, uint32_t tileY) const;
+
+    // Traced rays per pixel per frame in the tile.
+    [[nodiscard]] double GetRaysPerPixel(uint32_t tileX, uint32_t tileY) const;
+};
+
+struct RayCountTile
+{
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t traced = 0;
+    uint32_t hits = 0;
+    double raysPerPixel = 0.0;
+};
+
+struct RayCountHistogram
+{
+    double binWidth = 0.0;          // in rays per pixel
+    std::vector<uint32_t> bins;     // number of tiles in each bin; the last bin includes everything above
+};
+
+struct RayCountSummary
+{
+    uint64_t traced = 0;
+    uint64_t hits = 0;
+    double meanRaysPerPixel = 0.0;
+    double maxRaysPerPixel = 0.0;
+};
+
+RayCountSummary SummarizeRayCounts(const RayCountTileGrid& grid);
+
+// Builds a histogram of rays per pixel over all tiles. If maxRaysPerPixel is zero,
+// the range is derived from the most expensive tile.
+RayCountHistogram BuildRayCountHistogram(const RayCountTileGrid& grid, uint32_t binCount, double maxRaysPerPixel = 0.0);
+
+// Returns up to count tiles with the highest rays per pixel, most expensive first.
+std::vector<RayCountTile> FindHottestTiles(const RayCountTileGrid& grid, uint32_t count);
+
+// Builds an RGB8 heatmap of rays per pixel, either one pixel per tile or at image resolution.
+// Values at or above maxRaysPerPixel map to the hottest color; zero maps to black.
+std::vector<uint8_t> BuildRayCountHeatmap(const RayCountTileGrid& grid, double maxRaysPerPixel, bool fullResolution,
+    uint32_t& outWidth, uint32_t& outHeight);
+
+bool WriteHeatmapBmp(const std::string& fileName, const std::vector<uint8_t>& rgb, uint32_t width, uint32_t height);
+void WriteRayCountTilesCsv(std::ostream& stream, const RayCountTileGrid& grid);
+void WriteRayCountHistogramCsv(std::ostream& stream, const RayCountHistogram& histogram);
+
+// Writes <baseName>Heatmap.bmp at image resolution, <baseName>Tiles.csv and <baseName>Histogram.csv.
+bool ExportRayCountTiles(const RayCountTileGrid& grid, const std::string& baseName, uint32_t histogramBins = 32);
@@ -0,0 +1,364 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+namespace
+{
+    bool IsRead(RenderGraphAccess access)
+    {
+        return access == RenderGraphAccess::ShaderRead
+            || access == RenderGraphAccess::UnorderedRead
+            || access == RenderGraphAccess::UnorderedReadWrite;
+    }
+
+    bool IsWrite(RenderGraphAccess access)
+    {
+        return access == RenderGraphAccess::UnorderedWrite
+            || access == RenderGraphAccess::UnorderedReadWrite;
+    }
+
+    RenderGraphState GetRequiredState(RenderGraphAccess access)
+    {
+        return access == RenderGraphAccess::ShaderRead
+            ? RenderGraphState::ShaderResource
+            : RenderGraphState::UnorderedAccess;
+    }
+
+    struct ResourceState
+    {
+        RenderGraphState state = RenderGraphState::Unknown;
+        bool pendingRead = false;   // unordered reads since the last barrier
+        bool pendingWrite = false;  // unordered writes since the last barrier
+    };
+
+    ResourceState GetImportedState(RenderGraphAccess lastAccess)
+    {
+        ResourceState state;
+        if (lastAccess == RenderGraphAccess::None)
+            return state;
+
+        state.state = GetRequiredState(lastAccess);
+        if (state.state == RenderGraphState::UnorderedAccess)
+        {
+            state.pendingRead = IsRead(lastAccess);
+            state.pendingWrite = IsWrite(lastAccess);
+        }
+        return state;
+    }
+
+    std::vector<RenderGraphBarrier> GetRequiredBarriers(const std::vector<RenderGraphUse>& uses, const std::vector<ResourceState>& states)
+    {
+        std::vector<RenderGraphBarrier> barriers;
+
+        for (const RenderGraphUse& use : uses)
+        {
+            const ResourceState& current = states[use.resource];
+            const RenderGraphState required = GetRequiredState(use.access);
+
+            // The first use of a resource without a known state establishes it
+            if (current.state == RenderGraphState::Unknown)
+                continue;
+
+            RenderGraphBarrier barrier;
+            barrier.resource = use.resource;
+            barrier.before = current.state;
+            barrier.after = required;
+
+            if (current.state != required)
+            {
+                barrier.type = RenderGraphBarrierType::Transition;
+                barriers.push_back(barrier);
+            }
+            else if (required == RenderGraphState::UnorderedAccess &&
+                (current.pendingWrite || (current.pendingRead && IsWrite(use.access))))
+            {
+                barrier.type = RenderGraphBarrierType::Uav;
+                barriers.push_back(barrier);
+            }
+        }
+
+        return barriers;
+    }
+
+    bool UsesResource(const std::vector<RenderGraphUse>& uses, RenderGraphResource resource)
+    {
+        return std::any_of(uses.begin(), uses.end(), [resource](const RenderGraphUse& use) { return use.resource == resource; });
+    }
+}
+
+size_t RenderGraphSchedule::GetBarrierCount() const
+{
+    size_t count = 0;
+    for (const RenderGraphStep& step : steps)
+        count += step.barriers.size();
+    return count;
+}
+
+size_t RenderGraphSchedule::GetBarrierBatchCount() const
+{
+    return size_t(std::count_if(steps.begin(), steps.end(), [](const RenderGraphStep& step) { return !step.barriers.empty(); }));
+}
+
+RenderGraphResource RenderGraph::AddResource(const std::string& name, RenderGraphAccess lastAccess, bool exported)
+{
+    Resource resource;
+    resource.name = name;
+    resource.lastAccess = lastAccess;
+    resource.exported = exported;
+    m_resources.push_back(std::move(resource));
+    return RenderGraphResource(m_resources.size() - 1);
+}
+
+void RenderGraph::ExportResource(RenderGraphResource resource, bool exported)
+{
+    m_resources[resource].exported = exported;
+}
+
+RenderGraphPass RenderGraph::AddPass(const std::string& name, const std::vector<RenderGraphUse>& uses, bool sideEffects)
+{
+    Pass pass;
+    pass.name = name;
+    pass.uses = uses;
+    pass.sideEffects = sideEffects;
+    m_passes.push_back(std::move(pass));
+    return RenderGraphPass(m_passes.size() - 1);
+}
+
+void RenderGraph::Clear()
+{
+    m_resources.clear();
+    m_passes.clear();
+}
+
+RenderGraphSchedule RenderGraph::Compile() const
+{
+    RenderGraphSchedule schedule;
+    const uint32_t passCount = uint32_t(m_passes.size());
+    const uint32_t resourceCount = uint32_t(m_resources.size());
+
+    // Merge the uses of each resource by a pass into one access
+
+    std::vector<std::vector<RenderGraphUse>> passUses(passCount);
+    for (uint32_t passIndex = 0; passIndex < passCount; passIndex++)
+    {
+        const Pass& pass = m_passes[passIndex];
+        std::vector<RenderGraphUse>& uses = passUses[passIndex];
+
+        for (const RenderGraphUse& use : pass.uses)
+        {
+            if (use.resource >= resourceCount)
+            {
+                schedule.errors.push_back("Pass " + pass.name + " uses an undeclared resource");
+                continue;
+            }
+
+            if (use.access == RenderGraphAccess::None)
+                continue;
+
+            auto merged = std::find_if(uses.begin(), uses.end(), [&use](const RenderGraphUse& other) { return other.resource == use.resource; });
+            if (merged == uses.end())
+            {
+                uses.push_back(use);
+                continue;
+            }
+
+            if ((merged->access == RenderGraphAccess::ShaderRead) != (use.access == RenderGraphAccess::ShaderRead))
+            {
+                schedule.errors.push_back("Pass " + pass.name + " uses " + m_resources[use.resource].name + " as a shader resource and an unordered access view");
+                continue;
+            }
+
+            const bool read = IsRead(merged->access) || IsRead(use.access);
+            const bool write = IsWrite(merged->access) || IsWrite(use.access);
+            if (merged->access != RenderGraphAccess::ShaderRead)
+            {
+                merged->access = read && write
+                    ? RenderGraphAccess::UnorderedReadWrite
+                    : (write ? RenderGraphAccess::UnorderedWrite : RenderGraphAccess::UnorderedRead);
+            }
+        }
+    }
+
+    if (!schedule.errors.empty())
+        return schedule;
+
+    // Find the passes that contribute to the exported resources, following the reads back to their writers
+
+    std::vector<std::vector<RenderGraphPass>> producers(passCount);
+    std::vector<int> lastWriter(resourceCount, -1);
+    for (uint32_t passIndex = 0; passIndex < passCount; passIndex++)
+    {
+        for (const RenderGraphUse& use : passUses[passIndex])
+        {
+            if (IsRead(use.access) && lastWriter[use.resource] >= 0)
+                producers[passIndex].push_back(RenderGraphPass(lastWriter[use.resource]));
+        }
+
+        for (const RenderGraphUse& use : passUses[passIndex])
+        {
+            if (IsWrite(use.access))
+                lastWriter[use.resource] = int(passIndex);
+        }
+    }
+
+    std::vector<bool> live(passCount, false);
+    std::vector<RenderGraphPass> stack;
+    for (uint32_t passIndex = 0; passIndex < passCount; passIndex++)
+    {
+        if (m_passes[passIndex].sideEffects)
+            stack.push_back(passIndex);
+    }
+    for (uint32_t resourceIndex = 0; resourceIndex < resourceCount; resourceIndex++)
+    {
+        if (m_resources[resourceIndex].exported && lastWriter[resourceIndex] >= 0)
+            stack.push_back(RenderGraphPass(lastWriter[resourceIndex]));
+    }
+
+    while (!stack.empty())
+    {
+        const RenderGraphPass pass = stack.back();
+        stack.pop_back();
+
+        if (live[pass])
+            continue;
+
+        live[pass] = true;
+        stack.insert(stack.end(), producers[pass].begin(), producers[pass].end());
+    }
+
+    for (uint32_t passIndex = 0; passIndex < passCount; passIndex++)
+    {
+        if (!live[passIndex])
+            schedule.culledPasses.push_back(passIndex);
+    }
+
+    // Order the live passes: read after write, write after read and write after write
+
+    std::vector<std::vector<RenderGraphPass>> successors(passCount);
+    std::vector<uint32_t> predecessorCounts(passCount, 0);
+    std::vector<int> liveWriter(resourceCount, -1);
+    std::vector<std::vector<RenderGraphPass>> readersSinceWrite(resourceCount);
+
+    auto addEdge = [&successors, &predecessorCounts](RenderGraphPass from, RenderGraphPass to)
+    {
+        successors[from].push_back(to);
+        predecessorCounts[to]++;
+    };
+
+    for (uint32_t passIndex = 0; passIndex < passCount; passIndex++)
+    {
+        if (!live[passIndex])
+            continue;
+
+        for (const RenderGraphUse& use : passUses[passIndex])
+        {
+            if (liveWriter[use.resource] >= 0)
+                addEdge(RenderGraphPass(liveWriter[use.resource]), passIndex);
+
+            if (IsWrite(use.access))
+            {
+                for (RenderGraphPass reader : readersSinceWrite[use.resource])
+                    addEdge(reader, passIndex);
+
+                liveWriter[use.resource] = int(passIndex);
+                readersSinceWrite[use.resource].clear();
+            }
+            else
+                readersSinceWrite[use.resource].push_back(passIndex);
+        }
+    }
+
+    // Schedule the ready passes, the ones that need no barrier first
+
+    std::vector<ResourceState> states(resourceCount);
+    for (uint32_t resourceIndex = 0; resourceIndex < resourceCount; resourceIndex++)
+        states[resourceIndex] = GetImportedState(m_resources[resourceIndex].lastAccess);
+
+    std::vector<RenderGraphPass> ready;
+    for (uint32_t passIndex = 0; passIndex < passCount; passIndex++)
+    {
+        if (live[passIndex] && predecessorCounts[passIndex] == 0)
+            ready.push_back(passIndex);
+    }
+
+    while (!ready.empty())
+    {
+        // The ready list is sorted, so ties go to the declaration order
+        size_t chosen = 0;
+        std::vector<RenderGraphBarrier> barriers = GetRequiredBarriers(passUses[ready[0]], states);
+        for (size_t readyIndex = 1; readyIndex < ready.size() && !barriers.empty(); readyIndex++)
+        {
+            std::vector<RenderGraphBarrier> candidate = GetRequiredBarriers(passUses[ready[readyIndex]], states);
+            if (candidate.empty())
+            {
+                chosen = readyIndex;
+                barriers.clear();
+            }
+        }
+
+        const RenderGraphPass pass = ready[chosen];
+        ready.erase(ready.begin() + chosen);
+        const std::vector<RenderGraphUse>& uses = passUses[pass];
+
+        // Batch the UAV barriers that the other ready passes need on resources this pass doesn't use.
+        // Transitions are not batched: another ready pass may still use the resource in its current state.
+        if (!barriers.empty())
+        {
+            for (RenderGraphPass other : ready)
+            {
+                for (const RenderGraphBarrier& barrier : GetRequiredBarriers(passUses[other], states))
+                {
+                    if (barrier.type != RenderGraphBarrierType::Uav || UsesResource(uses, barrier.resource))
+                        continue;
+
+                    const bool batched = std::any_of(barriers.begin(), barriers.end(),
+                        [&barrier](const RenderGraphBarrier& existing) { return existing.resource == barrier.resource; });
+                    if (!batched)
+                        barriers.push_back(barrier);
+                }
+            }
+        }
+
+        for (const RenderGraphBarrier& barrier : barriers)
+        {
+            ResourceState& state = states[barrier.resource];
+            state.state = barrier.after;
+            state.pendingRead = false;
+            state.pendingWrite = false;
+        }
+
+        for (const RenderGraphUse& use : uses)
+        {
+            ResourceState& state = states[use.resource];
+            state.state = GetRequiredState(use.access);
+            if (state.state == RenderGraphState::UnorderedAccess)
+            {
+                state.pendingRead = state.pendingRead || IsRead(use.access);
+                state.pendingWrite = state.pendingWrite || IsWrite(use.access);
+            }
+        }
+
+        RenderGraphStep step;
+        step.pass = pass;
+        step.barriers = std::move(barriers);
+        schedule.steps.push_back(std::move(step));
+
+        for (RenderGraphPass successor : successors[pass])
+        {
+            if (--predecessorCounts[successor] == 0)
+                ready.insert(std::upper_bound(ready.begin(), ready.end(), successor), successor);
+        }
+    }
+
+    return schedule;
+}
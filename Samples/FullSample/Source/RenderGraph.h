@@ -0,0 +1,126 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compiler for a small render graph: a list of passes that declare how they access a set of resources.
+//
+// Compiling the graph orders the passes and places the barriers between them:
+// - A pass that reads a resource depends on the last pass that wrote it, and a pass that writes a resource
+//   depends on the passes that accessed it before, so the schedule is equivalent to the declaration order.
+// - Passes that don't contribute to an exported resource and have no side effects are culled.
+// - Among the passes whose dependencies are scheduled, the passes that need no barrier go first, so the
+//   barriers are issued as late and as few times as possible. The UAV barriers that other ready passes need
+//   are issued in the same batch.
+// - A resource needs a transition when it changes between the shader resource and unordered access states,
+//   and a UAV barrier between unordered accesses when one of them writes. Reads need nothing between them.
+//
+// Resources are declared with the last access before the graph, so the barriers against passes that ran
+// earlier in the command list are placed as well. The graph does not know what the resources are:
+// the caller maps the resources of the barriers to its device objects.
+//
+// The module has no dependencies on the renderer.
+
+using RenderGraphResource = uint32_t;
+using RenderGraphPass = uint32_t;
+
+enum class RenderGraphAccess : uint8_t
+{
+    None,
+    ShaderRead,             // through a shader resource view
+    UnorderedRead,          // through an unordered access view
+    UnorderedWrite,         // through an unordered access view, the previous contents are not read
+    UnorderedReadWrite
+};
+
+struct RenderGraphUse
+{
+    RenderGraphResource resource = 0;
+    RenderGraphAccess access = RenderGraphAccess::None;
+};
+
+enum class RenderGraphState : uint8_t
+{
+    Unknown,
+    ShaderResource,
+    UnorderedAccess
+};
+
+enum class RenderGraphBarrierType : uint8_t
+{
+    Uav,
+    Transition
+};
+
+struct RenderGraphBarrier
+{
+    RenderGraphResource resource = 0;
+    RenderGraphBarrierType type = RenderGraphBarrierType::Uav;
+    RenderGraphState before = RenderGraphState::Unknown;
+    RenderGraphState after = RenderGraphState::Unknown;
+};
+
+struct RenderGraphStep
+{
+    RenderGraphPass pass = 0;
+    std::vector<RenderGraphBarrier> barriers; // issued before the pass
+};
+
+struct RenderGraphSchedule
+{
+    std::vector<RenderGraphStep> steps;
+    std::vector<RenderGraphPass> culledPasses;
+    std::vector<std::string> errors;    // no steps when there are errors
+
+    [[nodiscard]] size_t GetBarrierCount() const;
+    [[nodiscard]] size_t GetBarrierBatchCount() const;
+};
+
+class RenderGraph
+{
+public:
+    // An exported resource is used after the graph, so the passes that write it are not culled
+    RenderGraphResource AddResource(const std::string& name, RenderGraphAccess lastAccess = RenderGraphAccess::None, bool exported = false);
+    void ExportResource(RenderGraphResource resource, bool exported = true);
+
+    // A pass with side effects is never culled
+    RenderGraphPass AddPass(const std::string& name, const std::vector<RenderGraphUse>& uses, bool sideEffects = false);
+
+    [[nodiscard]] RenderGraphSchedule Compile() const;
+
+    void Clear();
+
+    [[nodiscard]] size_t GetResourceCount() const { return m_resources.size(); }
+    [[nodiscard]] size_t GetPassCount() const { return m_passes.size(); }
+    [[nodiscard]] const std::string& GetResourceName(RenderGraphResource resource) const { return m_resources[resource].name; }
+    [[nodiscard]] const std::string& GetPassName(RenderGraphPass pass) const { return m_passes[pass].name; }
+
+private:
+    struct Resource
+    {
+        std::string name;
+        RenderGraphAccess lastAccess = RenderGraphAccess::None;
+        bool exported = false;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        std::vector<RenderGraphUse> uses;
+        bool sideEffects = false;
+    };
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+};
@@ -0,0 +1,84 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "RenderGraphExecutor.h"
+
+#include <donut/core/log.h>
+#include <nvrhi/utils.h>
+
+using namespace donut;
+
+RenderGraphResource RenderGraphExecutor::AddReadOnlyResource(const std::string& name)
+{
+    m_buffers.push_back(nullptr);
+    m_textures.push_back(nullptr);
+    return m_graph.AddResource(name, RenderGraphAccess::ShaderRead);
+}
+
+RenderGraphResource RenderGraphExecutor::AddBuffer(const std::string& name, nvrhi::IBuffer* buffer, RenderGraphAccess lastAccess, bool exported)
+{
+    m_buffers.push_back(buffer);
+    m_textures.push_back(nullptr);
+    return m_graph.AddResource(name, lastAccess, exported);
+}
+
+RenderGraphResource RenderGraphExecutor::AddTexture(const std::string& name, nvrhi::ITexture* texture, RenderGraphAccess lastAccess, bool exported)
+{
+    m_buffers.push_back(nullptr);
+    m_textures.push_back(texture);
+    return m_graph.AddResource(name, lastAccess, exported);
+}
+
+void RenderGraphExecutor::AddPass(const std::string& name, const std::vector<RenderGraphUse>& uses, PassFunction execute, bool sideEffects)
+{
+    m_graph.AddPass(name, uses, sideEffects);
+    m_passes.push_back(std::move(execute));
+}
+
+void RenderGraphExecutor::Execute(nvrhi::ICommandList* commandList)
+{
+    const RenderGraphSchedule schedule = m_graph.Compile();
+
+    for (const std::string& error : schedule.errors)
+        log::error("Render graph: %s", error.c_str());
+
+    for (const RenderGraphStep& step : schedule.steps)
+    {
+        for (const RenderGraphBarrier& barrier : step.barriers)
+        {
+            nvrhi::IBuffer* buffer = m_buffers[barrier.resource];
+            nvrhi::ITexture* texture = m_textures[barrier.resource];
+
+            if (barrier.type == RenderGraphBarrierType::Uav)
+            {
+                if (buffer)
+                    nvrhi::utils::BufferUavBarrier(commandList, buffer);
+                if (texture)
+                    nvrhi::utils::TextureUavBarrier(commandList, texture);
+            }
+            else
+            {
+                const nvrhi::ResourceStates state = barrier.after == RenderGraphState::ShaderResource
+                    ? nvrhi::ResourceStates::ShaderResource
+                    : nvrhi::ResourceStates::UnorderedAccess;
+
+                if (buffer)
+                    commandList->setBufferState(buffer, state);
+                if (texture)
+                    commandList->setTextureState(texture, nvrhi::AllSubresources, state);
+            }
+        }
+
+        if (!step.barriers.empty())
+            commandList->commitBarriers();
+
+        m_passes[step.pass]();
+    }
+}
@@ -0,0 +1,46 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include "RenderGraph.h"
+
+#include <nvrhi/nvrhi.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Render graph whose resources are device buffers and textures and whose passes record commands.
+//
+// Execute compiles the graph and records the scheduled passes with the barriers the compiler placed.
+// The passes of a graph usually share one binding set, so NVRHI doesn't place barriers between them.
+class RenderGraphExecutor
+{
+public:
+    using PassFunction = std::function<void()>;
+
+    // A group of resources that the passes only read through shader resource views, like the G-buffer.
+    // Declared for completeness, it never takes a barrier.
+    RenderGraphResource AddReadOnlyResource(const std::string& name);
+
+    RenderGraphResource AddBuffer(const std::string& name, nvrhi::IBuffer* buffer, RenderGraphAccess lastAccess = RenderGraphAccess::None, bool exported = false);
+    RenderGraphResource AddTexture(const std::string& name, nvrhi::ITexture* texture, RenderGraphAccess lastAccess = RenderGraphAccess::None, bool exported = false);
+
+    void AddPass(const std::string& name, const std::vector<RenderGraphUse>& uses, PassFunction execute, bool sideEffects = false);
+
+    void Execute(nvrhi::ICommandList* commandList);
+
+private:
+    RenderGraph m_graph;
+    std::vector<nvrhi::IBuffer*> m_buffers;     // by resource, null for textures and read-only resources
+    std::vector<nvrhi::ITexture*> m_textures;   // by resource, null for buffers and read-only resources
+    std::vector<PassFunction> m_passes;
+};
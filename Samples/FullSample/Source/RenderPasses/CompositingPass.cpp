@@ -9,11 +9,12 @@
  **************************************************************************/
 
 #include "CompositingPass.h"
+#include "../CachedBindingSetFactory.h"
+#include "../CachedShaderFactory.h"
 #include "../RenderTargets.h"
 #include "../SampleScene.h"
 #include "../UserInterface.h"
 
-#include <donut/engine/ShaderFactory.h>
 #include <donut/engine/View.h>
 #include <donut/engine/Scene.h>
 #include <donut/engine/CommonRenderPasses.h>
@@ -30,13 +31,15 @@ using namespace donut::engine;
 
 CompositingPass::CompositingPass(
     nvrhi::IDevice* device, 
-    std::shared_ptr<ShaderFactory> shaderFactory,
+    std::shared_ptr<CachedShaderFactory> shaderFactory,
+    std::shared_ptr<CachedBindingSetFactory> bindingSetFactory,
     std::shared_ptr<donut::engine::CommonRenderPasses> commonPasses,
     std::shared_ptr<donut::engine::Scene> scene,
     nvrhi::IBindingLayout* bindlessLayout)
     : m_device(device)
     , m_bindlessLayout(bindlessLayout)
     , m_shaderFactory(std::move(shaderFactory))
+    , m_bindingSetFactory(std::move(bindingSetFactory))
     , m_commonPasses(std::move(commonPasses))
     , m_scene(std::move(scene))
 {
@@ -93,14 +96,14 @@ void CompositingPass::CreateBindingSet(const RenderTargets& renderTargets)
         nvrhi::BindingSetItem::ConstantBuffer(0, m_constantBuffer)
     };
 
-    m_bindingSetEven = m_device->createBindingSet(bindingSetDesc, m_bindingLayout);
+    m_bindingSetEven = m_bindingSetFactory->CreateBindingSet("Compositing/Even", bindingSetDesc, m_bindingLayout);
 
     bindingSetDesc.bindings[0].resourceHandle = renderTargets.PrevDepth;
     bindingSetDesc.bindings[1].resourceHandle = renderTargets.PrevGBufferNormals;
     bindingSetDesc.bindings[2].resourceHandle = renderTargets.PrevGBufferDiffuseAlbedo;
     bindingSetDesc.bindings[3].resourceHandle = renderTargets.PrevGBufferSpecularRough;
 
-    m_bindingSetOdd = m_device->createBindingSet(bindingSetDesc, m_bindingLayout);
+    m_bindingSetOdd = m_bindingSetFactory->CreateBindingSet("Compositing/Odd", bindingSetDesc, m_bindingLayout);
 }
 
 void CompositingPass::Render(
@@ -17,10 +17,11 @@ namespace donut::engine
 {
     class Scene;
     class CommonRenderPasses;
-    class ShaderFactory;
     class IView;
 }
 
+class CachedBindingSetFactory;
+class CachedShaderFactory;
 class RenderTargets;
 class EnvironmentLight;
 struct UIData;
@@ -30,7 +31,8 @@ class CompositingPass
 public:
     CompositingPass(
         nvrhi::IDevice* device,
-        std::shared_ptr<donut::engine::ShaderFactory> shaderFactory,
+        std::shared_ptr<CachedShaderFactory> shaderFactory,
+        std::shared_ptr<CachedBindingSetFactory> bindingSetFactory,
         std::shared_ptr<donut::engine::CommonRenderPasses> commonPasses,
         std::shared_ptr<donut::engine::Scene> scene,
         nvrhi::IBindingLayout* bindlessLayout);
@@ -62,7 +64,8 @@ private:
 
     nvrhi::BufferHandle m_constantBuffer;
 
-    std::shared_ptr<donut::engine::ShaderFactory> m_shaderFactory;
+    std::shared_ptr<CachedShaderFactory> m_shaderFactory;
+    std::shared_ptr<CachedBindingSetFactory> m_bindingSetFactory;
     std::shared_ptr<donut::engine::CommonRenderPasses> m_commonPasses;
     std::shared_ptr<donut::engine::Scene> m_scene;
 };
@@ -9,6 +9,8 @@
  **************************************************************************/
 
 #include "GBufferPass.h"
+#include "../CachedBindingSetFactory.h"
+#include "../CachedShaderFactory.h"
 #include "../RenderTargets.h"
 #include "../Profiler.h"
 #include "../SampleScene.h"
@@ -21,6 +23,12 @@
 #include <donut/core/log.h>
 #include <nvrhi/utils.h>
 
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+#include <algorithm>
+#include <numeric>
 #include <utility>
 
 using namespace donut::math;
@@ -28,9 +36,46 @@ using namespace donut::math;
 
 using namespace donut::engine;
 
+namespace
+{
+    // Enough draws per command list to outweigh the cost of setting up the list
+    const uint32_t c_MinDrawsPerCommandList = 256;
+    const uint32_t c_MaxDrawCommandLists = 8;
+
+    // Records draws of the draw stream, the states are indexed by the state of the draws
+    class GBufferDrawSink
+    {
+    public:
+        GBufferDrawSink(nvrhi::ICommandList* commandList, const nvrhi::GraphicsState* states)
+            : m_commandList(commandList)
+            , m_states(states)
+        {
+        }
+
+        void SetState(uint32_t state)
+        {
+            m_commandList->setGraphicsState(m_states[state]);
+        }
+
+        void Draw(const DrawStreamItem& item)
+        {
+            m_commandList->setPushConstants(item.pushConstants, sizeof(item.pushConstants));
+
+            nvrhi::DrawArguments args{};
+            args.instanceCount = 1;
+            args.vertexCount = item.vertexCount;
+            m_commandList->draw(args);
+        }
+
+    private:
+        nvrhi::ICommandList* m_commandList;
+        const nvrhi::GraphicsState* m_states;
+    };
+}
+
 RasterizedGBufferPass::RasterizedGBufferPass(
     nvrhi::IDevice* device,
-    std::shared_ptr<donut::engine::ShaderFactory> shaderFactory,
+    std::shared_ptr<CachedShaderFactory> shaderFactory,
     std::shared_ptr<donut::engine::CommonRenderPasses> commonPasses,
     std::shared_ptr<donut::engine::Scene> scene,
     std::shared_ptr<Profiler> profiler,
@@ -52,16 +97,144 @@ RasterizedGBufferPass::RasterizedGBufferPass(
         nvrhi::BindingLayoutItem::StructuredBuffer_SRV(0),
         nvrhi::BindingLayoutItem::StructuredBuffer_SRV(1),
         nvrhi::BindingLayoutItem::StructuredBuffer_SRV(2),
+        nvrhi::BindingLayoutItem::StructuredBuffer_SRV(3),
         nvrhi::BindingLayoutItem::Sampler(0),
         nvrhi::BindingLayoutItem::TypedBuffer_UAV(0)
     };
 
     m_bindingLayout = m_device->createBindingLayout(globalBindingLayoutDesc);
 
+    m_cullingConstantBuffer = m_device->createBuffer(nvrhi::utils::CreateVolatileConstantBufferDesc(sizeof(GBufferCullingConstants), "GBufferCullingConstants", 16));
+
+    nvrhi::BindingLayoutDesc cullingBindingLayoutDesc;
+    cullingBindingLayoutDesc.visibility = nvrhi::ShaderType::Compute;
+    cullingBindingLayoutDesc.bindings = {
+        nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
+        nvrhi::BindingLayoutItem::StructuredBuffer_SRV(0),
+        nvrhi::BindingLayoutItem::StructuredBuffer_SRV(1),
+        nvrhi::BindingLayoutItem::TypedBuffer_UAV(0),
+        nvrhi::BindingLayoutItem::TypedBuffer_UAV(1)
+    };
+
+    m_cullingBindingLayout = m_device->createBindingLayout(cullingBindingLayoutDesc);
+}
+
+void RasterizedGBufferPass::CreateDrawRecords()
+{
+    const auto& instances = m_scene->GetSceneGraph()->GetMeshInstances();
+
+    std::vector<GBufferDrawRecord> records;
+    std::vector<uint64_t> sortKeys;
+
+    m_drawList.clear();
+    m_instanceFirstDraw.clear();
+
+    for (uint32_t instanceIndex = 0; instanceIndex < uint32_t(instances.size()); instanceIndex++)
+    {
+        const auto& instance = instances[instanceIndex];
+        const auto& mesh = instance->GetMesh();
+
+        m_instanceFirstDraw.push_back(uint32_t(m_drawList.size()));
+
+        for (size_t geometryIndex = 0; geometryIndex < mesh->geometries.size(); geometryIndex++)
+        {
+            const auto& geometry = mesh->geometries[geometryIndex];
+
+            GBufferDrawRecord record{};
+            record.instanceIndex = uint32_t(instance->GetInstanceIndex());
+            record.geometryIndex = uint32_t(geometryIndex);
+            record.indexCount = geometry->numIndices;
+
+            if (geometry->material->domain != MaterialDomain::Opaque)
+                record.flags |= GBUFFER_DRAW_ALPHA_TESTED;
+
+            // Skinned meshes are deformed on the GPU, their object space bounds don't follow the animation
+            if (mesh->skinPrototype || geometry->objectSpaceBounds.isempty())
+            {
+                record.flags |= GBUFFER_DRAW_NEVER_CULL;
+            }
+            else
+            {
+                record.boundsMin = geometry->objectSpaceBounds.m_mins;
+                record.boundsMax = geometry->objectSpaceBounds.m_maxs;
+            }
+
+            records.push_back(record);
+
+            // The depth buckets are filled in when the instance becomes visible
+            DrawSortKeyFields sortKey;
+            sortKey.alphaTested = (record.flags & GBUFFER_DRAW_ALPHA_TESTED) != 0;
+            sortKey.pipeline = sortKey.alphaTested ? 1 : 0;
+            sortKey.material = uint32_t(geometry->material->materialID);
+            sortKeys.push_back(PackDrawSortKey(sortKey));
+
+            m_drawList.push_back({ instanceIndex, uint32_t(geometryIndex) });
+        }
+    }
+
+    m_instanceFirstDraw.push_back(uint32_t(m_drawList.size()));
+    m_instanceVisible.assign(instances.size(), 0);
+    m_sortedDrawList.Build(sortKeys);
+
+    m_drawRecordCount = uint32_t(records.size());
+    m_drawRecordInstanceCount = instances.size();
+
+    // Avoid zero-sized buffers for empty scenes
+    const uint32_t bufferRecordCount = std::max(m_drawRecordCount, 1u);
+
+    nvrhi::BufferDesc bufferDesc;
+    bufferDesc.byteSize = sizeof(GBufferDrawRecord) * bufferRecordCount;
+    bufferDesc.structStride = sizeof(GBufferDrawRecord);
+    bufferDesc.debugName = "GBufferDrawRecords";
+    bufferDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+    bufferDesc.keepInitialState = true;
+    m_drawRecordBuffer = m_device->createBuffer(bufferDesc);
+
+    bufferDesc = nvrhi::BufferDesc();
+    bufferDesc.byteSize = sizeof(uint32_t) * bufferRecordCount;
+    bufferDesc.isVertexBuffer = true;
+    bufferDesc.debugName = "GBufferDrawIndices";
+    bufferDesc.initialState = nvrhi::ResourceStates::VertexBuffer;
+    bufferDesc.keepInitialState = true;
+    m_drawIndexBuffer = m_device->createBuffer(bufferDesc);
+
+    bufferDesc = nvrhi::BufferDesc();
+    bufferDesc.byteSize = sizeof(nvrhi::DrawIndirectArguments) * bufferRecordCount * 2;
+    bufferDesc.format = nvrhi::Format::R32_UINT;
+    bufferDesc.canHaveTypedViews = true;
+    bufferDesc.canHaveUAVs = true;
+    bufferDesc.isDrawIndirectArgs = true;
+    bufferDesc.debugName = "GBufferDrawArguments";
+    bufferDesc.initialState = nvrhi::ResourceStates::IndirectArgument;
+    bufferDesc.keepInitialState = true;
+    m_drawArgumentsBuffer = m_device->createBuffer(bufferDesc);
+
+    bufferDesc = nvrhi::BufferDesc();
+    bufferDesc.byteSize = sizeof(uint32_t) * 2;
+    bufferDesc.format = nvrhi::Format::R32_UINT;
+    bufferDesc.canHaveTypedViews = true;
+    bufferDesc.canHaveUAVs = true;
+    bufferDesc.debugName = "GBufferDrawCounts";
+    bufferDesc.initialState = nvrhi::ResourceStates::UnorderedAccess;
+    bufferDesc.keepInitialState = true;
+    m_drawCountBuffer = m_device->createBuffer(bufferDesc);
+
+    std::vector<uint32_t> drawIndices(bufferRecordCount);
+    std::iota(drawIndices.begin(), drawIndices.end(), 0u);
+
+    nvrhi::CommandListHandle commandList = m_device->createCommandList();
+    commandList->open();
+    if (!records.empty())
+        commandList->writeBuffer(m_drawRecordBuffer, records.data(), records.size() * sizeof(GBufferDrawRecord));
+    commandList->writeBuffer(m_drawIndexBuffer, drawIndices.data(), drawIndices.size() * sizeof(uint32_t));
+    commandList->close();
+    m_device->executeCommandList(commandList);
 }
 
 void RasterizedGBufferPass::CreateBindingSet()
 {
+    CreateDrawRecords();
+
     nvrhi::BindingSetDesc bindingSetDesc;
 
     bindingSetDesc.bindings = {
@@ -70,23 +243,36 @@ void RasterizedGBufferPass::CreateBindingSet()
         nvrhi::BindingSetItem::StructuredBuffer_SRV(0, m_scene->GetInstanceBuffer()),
         nvrhi::BindingSetItem::StructuredBuffer_SRV(1, m_scene->GetGeometryBuffer()),
         nvrhi::BindingSetItem::StructuredBuffer_SRV(2, m_scene->GetMaterialBuffer()),
+        nvrhi::BindingSetItem::StructuredBuffer_SRV(3, m_drawRecordBuffer),
         nvrhi::BindingSetItem::Sampler(0, m_commonPasses->m_AnisotropicWrapSampler),
         nvrhi::BindingSetItem::TypedBuffer_UAV(0, m_profiler->GetRayCountBuffer())
     };
 
     m_bindingSet = m_device->createBindingSet(bindingSetDesc, m_bindingLayout);
+
+    nvrhi::BindingSetDesc cullingBindingSetDesc;
+    cullingBindingSetDesc.bindings = {
+        nvrhi::BindingSetItem::ConstantBuffer(0, m_cullingConstantBuffer),
+        nvrhi::BindingSetItem::StructuredBuffer_SRV(0, m_drawRecordBuffer),
+        nvrhi::BindingSetItem::StructuredBuffer_SRV(1, m_scene->GetInstanceBuffer()),
+        nvrhi::BindingSetItem::TypedBuffer_UAV(0, m_drawArgumentsBuffer),
+        nvrhi::BindingSetItem::TypedBuffer_UAV(1, m_drawCountBuffer)
+    };
+
+    m_cullingBindingSet = m_device->createBindingSet(cullingBindingSetDesc, m_cullingBindingLayout);
 }
 
 void RasterizedGBufferPass::CreatePipeline(const RenderTargets& renderTargets)
 {
     donut::log::debug("Initializing RasterizedGBufferPass...");
 
-    std::vector<ShaderMacro> macros = { { "ALPHA_TESTED", "0"} };
+    std::vector<ShaderMacro> vertexMacros = { { "INDIRECT_DRAW", "0" } };
+    std::vector<ShaderMacro> macros = { { "ALPHA_TESTED", "0" }, { "INDIRECT_DRAW", "0" } };
 
     nvrhi::GraphicsPipelineDesc pipelineDesc;
 
     pipelineDesc.bindingLayouts = { m_bindingLayout, m_bindlessLayout };
-    pipelineDesc.VS = m_shaderFactory->CreateShader("app/RasterizedGBuffer.hlsl", "vs_main", nullptr, nvrhi::ShaderType::Vertex);
+    pipelineDesc.VS = m_shaderFactory->CreateShader("app/RasterizedGBuffer.hlsl", "vs_main", &vertexMacros, nvrhi::ShaderType::Vertex);
     pipelineDesc.PS = m_shaderFactory->CreateShader("app/RasterizedGBuffer.hlsl", "ps_main", &macros, nvrhi::ShaderType::Pixel);
     pipelineDesc.primType = nvrhi::PrimitiveType::TriangleList;
     pipelineDesc.renderState.rasterState.frontCounterClockwise = true;
@@ -103,6 +289,133 @@ void RasterizedGBufferPass::CreatePipeline(const RenderTargets& renderTargets)
     pipelineDesc.renderState.rasterState.cullMode = nvrhi::RasterCullMode::None;
 
     m_alphaTestedPipeline = m_device->createGraphicsPipeline(pipelineDesc, framebuffer);
+
+    // Indirect variants: the draw record index comes from an instance-rate attribute that advances from
+    // startInstanceLocation, which works the same way on D3D12 and Vulkan, unlike SV_InstanceID.
+    vertexMacros[0].definition = "1"; // INDIRECT_DRAW
+    pipelineDesc.VS = m_shaderFactory->CreateShader("app/RasterizedGBuffer.hlsl", "vs_main", &vertexMacros, nvrhi::ShaderType::Vertex);
+
+    nvrhi::VertexAttributeDesc drawIndexAttribute;
+    drawIndexAttribute.name = "DRAW_INDEX";
+    drawIndexAttribute.format = nvrhi::Format::R32_UINT;
+    drawIndexAttribute.bufferIndex = 0;
+    drawIndexAttribute.elementStride = sizeof(uint32_t);
+    drawIndexAttribute.isInstanced = true;
+    m_indirectInputLayout = m_device->createInputLayout(&drawIndexAttribute, 1, pipelineDesc.VS);
+    pipelineDesc.inputLayout = m_indirectInputLayout;
+
+    macros[1].definition = "1"; // INDIRECT_DRAW
+    pipelineDesc.PS = m_shaderFactory->CreateShader("app/RasterizedGBuffer.hlsl", "ps_main", &macros, nvrhi::ShaderType::Pixel);
+
+    m_indirectAlphaTestedPipeline = m_device->createGraphicsPipeline(pipelineDesc, framebuffer);
+
+    macros[0].definition = "0"; // ALPHA_TESTED
+    pipelineDesc.PS = m_shaderFactory->CreateShader("app/RasterizedGBuffer.hlsl", "ps_main", &macros, nvrhi::ShaderType::Pixel);
+    pipelineDesc.renderState.rasterState.cullMode = nvrhi::RasterCullMode::Back;
+
+    m_indirectOpaquePipeline = m_device->createGraphicsPipeline(pipelineDesc, framebuffer);
+
+    auto cullingPipelineDesc = nvrhi::ComputePipelineDesc()
+        .setComputeShader(m_shaderFactory->CreateShader("app/GBufferCulling.hlsl", "main", nullptr, nvrhi::ShaderType::Compute))
+        .addBindingLayout(m_cullingBindingLayout);
+
+    m_cullingPipeline = m_device->createComputePipeline(cullingPipelineDesc);
+}
+
+void RasterizedGBufferPass::UpdateDrawOrder(const donut::engine::IView& view)
+{
+    const auto& instances = m_scene->GetSceneGraph()->GetMeshInstances();
+    const float3 viewOrigin = view.GetViewOrigin();
+    const float3 viewDirection = view.GetViewDirection();
+
+    // Only the visible draws are submitted, so the keys of the others are left alone until they come into view
+    for (uint32_t instanceIndex : m_visibleInstances)
+    {
+        const auto node = instances[instanceIndex]->GetNode();
+        const box3 bounds = node ? node->GetGlobalBoundingBox() : box3::empty();
+        const float viewDepth = bounds.isempty() ? 0.f : dot(bounds.center() - viewOrigin, viewDirection);
+        const uint32_t depthBucket = GetDrawDepthBucket(viewDepth);
+
+        for (uint32_t draw = m_instanceFirstDraw[instanceIndex]; draw < m_instanceFirstDraw[instanceIndex + 1]; draw++)
+        {
+            DrawSortKeyFields sortKey = UnpackDrawSortKey(m_sortedDrawList.GetKey(draw));
+            sortKey.depthBucket = depthBucket;
+            m_sortedDrawList.SetKey(draw, PackDrawSortKey(sortKey));
+        }
+    }
+
+    m_sortedDrawList.Sort();
+}
+
+DrawStateStatistics RasterizedGBufferPass::CountSceneOrderDrawState(const GBufferSettings& settings) const
+{
+    DrawStateCounter counter;
+
+    for (int alphaTested = 0; alphaTested <= 1; alphaTested++)
+    {
+        if (alphaTested && !settings.enableAlphaTestedGeometry)
+            break;
+
+        for (uint32_t instanceIndex : m_visibleInstances)
+        {
+            for (uint32_t draw = m_instanceFirstDraw[instanceIndex]; draw < m_instanceFirstDraw[instanceIndex + 1]; draw++)
+            {
+                const uint64_t key = m_sortedDrawList.GetKey(draw);
+                if (UnpackDrawSortKey(key).alphaTested == (alphaTested != 0))
+                    counter.AddDraw(key);
+            }
+        }
+    }
+
+    return counter.GetStatistics();
+}
+
+const DrawStateStatistics& RasterizedGBufferPass::GetDrawStatistics() const
+{
+    return m_drawStatistics;
+}
+
+const DrawStateStatistics& RasterizedGBufferPass::GetSceneOrderDrawStatistics() const
+{
+    return m_sceneOrderDrawStatistics;
+}
+
+uint32_t RasterizedGBufferPass::GetResortedDrawCount() const
+{
+    return m_sortedDrawList.GetLastSortedCount();
+}
+
+void RasterizedGBufferPass::CullDrawRecords(
+    nvrhi::ICommandList* commandList,
+    const donut::engine::IView& view,
+    const GBufferSettings& settings)
+{
+    commandList->beginMarker("Culling");
+
+    GBufferCullingConstants constants{};
+    const auto viewFrustum = view.GetViewFrustum();
+    for (int planeIndex = 0; planeIndex < frustum::PLANES_COUNT; planeIndex++)
+    {
+        const plane& frustumPlane = viewFrustum.planes[planeIndex];
+        constants.frustumPlanes[planeIndex] = float4(frustumPlane.normal, frustumPlane.distance);
+    }
+    constants.recordCount = m_drawRecordCount;
+    constants.enableAlphaTestedGeometry = settings.enableAlphaTestedGeometry;
+    commandList->writeBuffer(m_cullingConstantBuffer, &constants, sizeof(constants));
+
+    // nvrhi has no draws with a GPU count, so both lists are drawn in full and the draws
+    // that the culling shader doesn't write stay zeroed and produce nothing
+    commandList->clearBufferUInt(m_drawArgumentsBuffer, 0);
+    commandList->clearBufferUInt(m_drawCountBuffer, 0);
+
+    auto state = nvrhi::ComputeState()
+        .setPipeline(m_cullingPipeline)
+        .addBindingSet(m_cullingBindingSet);
+
+    commandList->setComputeState(state);
+    commandList->dispatch(dm::div_ceil(m_drawRecordCount, GBUFFER_CULLING_GROUP_SIZE));
+
+    commandList->endMarker();
 }
 
 void RasterizedGBufferPass::Render(
@@ -110,13 +423,24 @@ void RasterizedGBufferPass::Render(
     const donut::engine::IView& view,
     const donut::engine::IView& viewPrev,
     const RenderTargets& renderTargets,
-    const GBufferSettings& settings)
+    const GBufferSettings& settings,
+    bool parallelRecording)
 {
     commandList->beginMarker("GBufferFill");
 
     commandList->clearDepthStencilTexture(renderTargets.DeviceDepth, nvrhi::AllSubresources, true, 0.f, false, 0);
     commandList->clearTextureFloat(renderTargets.Depth, nvrhi::AllSubresources, nvrhi::Color(BACKGROUND_DEPTH));
 
+    const auto& instances = m_scene->GetSceneGraph()->GetMeshInstances();
+
+    // The draw records and the draw list are created with the binding set, fall back to unsorted CPU culling
+    // if the scene has changed since then
+    const bool drawListValid = m_drawRecordInstanceCount == instances.size();
+    const bool gpuCulling = settings.enableGpuCulling && m_drawRecordCount != 0 && drawListValid;
+    const bool sortDraws = settings.sortDraws && !gpuCulling && drawListValid;
+
+    if (gpuCulling)
+        CullDrawRecords(commandList, view, settings);
 
     GBufferConstants constants;
     view.FillPlanarViewConstants(constants.view);
@@ -134,37 +458,105 @@ void RasterizedGBufferPass::Render(
 
     commandList->setEnableAutomaticBarriers(false);
     commandList->setResourceStatesForFramebuffer(framebuffer);
+    if (gpuCulling)
+        commandList->setBufferState(m_drawArgumentsBuffer, nvrhi::ResourceStates::IndirectArgument);
     commandList->commitBarriers();
 
-    const auto& instances = m_scene->GetSceneGraph()->GetMeshInstances();
+    m_visibleInstances.clear();
 
-    const auto viewFrustum = view.GetViewFrustum();
+    if (!gpuCulling)
+    {
+        // Find the visible instances once for both pipelines
+        const auto viewFrustum = view.GetViewFrustum();
+        CullingPlane cullingPlanes[frustum::PLANES_COUNT];
+        for (int planeIndex = 0; planeIndex < frustum::PLANES_COUNT; planeIndex++)
+        {
+            const plane& frustumPlane = viewFrustum.planes[planeIndex];
+            CullingPlane& cullingPlane = cullingPlanes[planeIndex];
+            cullingPlane.normal[0] = frustumPlane.normal.x;
+            cullingPlane.normal[1] = frustumPlane.normal.y;
+            cullingPlane.normal[2] = frustumPlane.normal.z;
+            cullingPlane.distance = frustumPlane.distance;
+        }
+
+        static_cast<const SampleScene&>(*m_scene).GetInstanceBvh().Cull(cullingPlanes, frustum::PLANES_COUNT, m_visibleInstances);
+
+        if (drawListValid)
+        {
+            std::fill(m_instanceVisible.begin(), m_instanceVisible.end(), 0);
+            for (uint32_t instanceIndex : m_visibleInstances)
+                m_instanceVisible[instanceIndex] = 1;
+        }
+
+        if (sortDraws)
+            UpdateDrawOrder(view);
+    }
+
+    DrawStateCounter submittedDrawState;
+    nvrhi::GraphicsState states[2];
+    m_drawStream.clear();
+    m_drawCommandLists.clear();
 
     for (int alphaTested = 0; alphaTested <= 1; alphaTested++)
     {
         if (alphaTested && !settings.enableAlphaTestedGeometry)
             break;
 
-        nvrhi::GraphicsState state;
+        nvrhi::GraphicsState& state = states[alphaTested];
         state.pipeline = alphaTested ? m_alphaTestedPipeline : m_opaquePipeline;
         state.bindings = { m_bindingSet, m_scene->GetDescriptorTable() };
         state.framebuffer = framebuffer;
         state.viewport = view.GetViewportState();
-        commandList->setGraphicsState(state);
 
-        nvrhi::DrawArguments args{};
-        args.instanceCount = 1;
+        if (gpuCulling)
+        {
+            state.pipeline = alphaTested ? m_indirectAlphaTestedPipeline : m_indirectOpaquePipeline;
+            state.vertexBuffers = { nvrhi::VertexBufferBinding().setBuffer(m_drawIndexBuffer).setSlot(0) };
+            state.indirectParams = m_drawArgumentsBuffer;
+            commandList->setGraphicsState(state);
+
+            const uint32_t listOffset = uint32_t(alphaTested * m_drawRecordCount * sizeof(nvrhi::DrawIndirectArguments));
+            commandList->drawIndirect(listOffset, m_drawRecordCount);
+            continue;
+        }
+
+        DrawStreamItem item;
+        item.state = uint32_t(alphaTested);
 
-        for (const auto& instance : instances)
+        if (sortDraws)
         {
-            const auto& mesh = instance->GetMesh();
-            const auto node = instance->GetNode();
+            // The opaque draws come before the alpha-tested ones in key order
+            const auto& sortedKeys = m_sortedDrawList.GetSortedKeys();
+            const auto& sortedDraws = m_sortedDrawList.GetSortedDraws();
+            const size_t firstAlphaTested = std::partition_point(sortedKeys.begin(), sortedKeys.end(),
+                [](uint64_t key) { return !UnpackDrawSortKey(key).alphaTested; }) - sortedKeys.begin();
+            const size_t begin = alphaTested ? firstAlphaTested : 0;
+            const size_t end = alphaTested ? sortedKeys.size() : firstAlphaTested;
+
+            for (size_t index = begin; index < end; index++)
+            {
+                const DrawListEntry& entry = m_drawList[sortedDraws[index]];
+                if (!m_instanceVisible[entry.instance])
+                    continue;
+
+                const auto& instance = instances[entry.instance];
+                const auto& geometry = instance->GetMesh()->geometries[entry.geometryIndex];
 
-            if (!node)
-                continue;
-            
-            if (!viewFrustum.intersectsWith(node->GetGlobalBoundingBox()))
-                continue;
+                item.pushConstants[0] = instance->GetInstanceIndex();
+                item.pushConstants[1] = entry.geometryIndex;
+                item.vertexCount = geometry->numIndices;
+                m_drawStream.push_back(item);
+
+                submittedDrawState.AddDraw(sortedKeys[index]);
+            }
+
+            continue;
+        }
+
+        for (uint32_t instanceIndex : m_visibleInstances)
+        {
+            const auto& instance = instances[instanceIndex];
+            const auto& mesh = instance->GetMesh();
 
             for (size_t geometryIndex = 0; geometryIndex < mesh->geometries.size(); geometryIndex++)
             {
@@ -174,24 +566,100 @@ void RasterizedGBufferPass::Render(
                 if ((materialDomain == MaterialDomain::Opaque) == alphaTested)
                     continue;
 
-                uint2 pushConstants = uint2(instance->GetInstanceIndex(), uint32_t(geometryIndex));
-
-                commandList->setPushConstants(&pushConstants, sizeof(pushConstants));
+                item.pushConstants[0] = instance->GetInstanceIndex();
+                item.pushConstants[1] = uint32_t(geometryIndex);
+                item.vertexCount = geometry->numIndices;
+                m_drawStream.push_back(item);
 
-                args.vertexCount = geometry->numIndices;
-                commandList->draw(args);
+                if (drawListValid)
+                    submittedDrawState.AddDraw(m_sortedDrawList.GetKey(m_instanceFirstDraw[instanceIndex] + uint32_t(geometryIndex)));
             }
         }
     }
 
+    // Workers record the draws when there are enough of them, otherwise they go into the list of the pass
+    if (!gpuCulling && (!parallelRecording || !RecordDrawsInParallel(states, constants, framebuffer)))
+    {
+        GBufferDrawSink sink(commandList, states);
+        RecordDrawStream(sink, m_drawStream, { 0, uint32_t(m_drawStream.size()) });
+    }
+
+    if (!gpuCulling && drawListValid)
+    {
+        m_drawStatistics = submittedDrawState.GetStatistics();
+        m_sceneOrderDrawStatistics = sortDraws ? CountSceneOrderDrawState(settings) : m_drawStatistics;
+    }
+
     commandList->setEnableAutomaticBarriers(true);
 
     commandList->endMarker();
 }
 
-PostprocessGBufferPass::PostprocessGBufferPass(nvrhi::IDevice* device, std::shared_ptr<donut::engine::ShaderFactory> shaderFactory)
+bool RasterizedGBufferPass::RecordDrawsInParallel(
+    const nvrhi::GraphicsState* states,
+    const GBufferConstants& constants,
+    nvrhi::IFramebuffer* framebuffer)
+{
+#ifdef DONUT_WITH_TASKFLOW
+    if (!m_executor)
+        return false;
+
+    const uint32_t maxCommandLists = std::min(uint32_t(m_executor->num_workers()), c_MaxDrawCommandLists);
+    const std::vector<RecordingRange> ranges = SplitRecordingRange(uint32_t(m_drawStream.size()), maxCommandLists, c_MinDrawsPerCommandList);
+    if (ranges.size() < 2)
+        return false;
+
+    while (m_drawCommandListPool.size() < ranges.size())
+        m_drawCommandListPool.push_back(m_device->createCommandList());
+    m_drawCommandLists.assign(m_drawCommandListPool.begin(), m_drawCommandListPool.begin() + ranges.size());
+
+    // Every list starts with the resources in their initial states and its own copy of the volatile
+    // constants, and sets up the framebuffer states like the list of the pass
+    tf::Taskflow taskflow;
+    taskflow.for_each_index(size_t(0), ranges.size(), size_t(1), [&](size_t rangeIndex)
+    {
+        nvrhi::ICommandList* commandList = m_drawCommandLists[rangeIndex];
+        commandList->open();
+        commandList->beginMarker("GBufferDraws");
+        commandList->writeBuffer(m_constantBuffer, &constants, sizeof(constants));
+
+        commandList->setEnableAutomaticBarriers(false);
+        commandList->setResourceStatesForFramebuffer(framebuffer);
+        commandList->commitBarriers();
+
+        GBufferDrawSink sink(commandList, states);
+        RecordDrawStream(sink, m_drawStream, ranges[rangeIndex]);
+
+        commandList->setEnableAutomaticBarriers(true);
+        commandList->endMarker();
+        commandList->close();
+    });
+    m_executor->run(taskflow).wait();
+
+    return true;
+#else
+    (void)states;
+    (void)constants;
+    (void)framebuffer;
+    return false;
+#endif
+}
+
+void RasterizedGBufferPass::SetExecutor(tf::Executor* executor)
+{
+    m_executor = executor;
+}
+
+const std::vector<nvrhi::CommandListHandle>& RasterizedGBufferPass::GetDrawCommandLists() const
+{
+    return m_drawCommandLists;
+}
+
+PostprocessGBufferPass::PostprocessGBufferPass(nvrhi::IDevice* device, std::shared_ptr<CachedShaderFactory> shaderFactory,
+    std::shared_ptr<CachedBindingSetFactory> bindingSetFactory)
     : m_device(device)
     , m_shaderFactory(std::move(shaderFactory))
+    , m_bindingSetFactory(std::move(bindingSetFactory))
 {
     nvrhi::BindingLayoutDesc globalBindingLayoutDesc;
     globalBindingLayoutDesc.visibility = nvrhi::ShaderType::Compute;
@@ -230,7 +698,7 @@ void PostprocessGBufferPass::CreateBindingSet(const RenderTargets& renderTargets
             nvrhi::BindingSetItem::Texture_SRV(1, currentFrame ? renderTargets.Depth : renderTargets.PrevDepth)
         };
 
-        const nvrhi::BindingSetHandle bindingSet = m_device->createBindingSet(bindingSetDesc, m_bindingLayout);
+        const nvrhi::BindingSetHandle bindingSet = m_bindingSetFactory->CreateBindingSet(currentFrame ? "PostprocessGBuffer/Current" : "PostprocessGBuffer/Previous", bindingSetDesc, m_bindingLayout);
 
         if (currentFrame)
             m_bindingSet = bindingSet;
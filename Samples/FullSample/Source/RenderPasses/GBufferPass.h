@@ -10,21 +10,32 @@
 
 #pragma once
 
+#include "../ParallelRecording.h"
+#include "../SortedDrawList.h"
+
 #include <donut/core/math/math.h>
 #include <nvrhi/nvrhi.h>
 #include <memory>
+#include <vector>
 
 namespace donut::engine
 {
     class Scene;
     class CommonRenderPasses;
     class IView;
-    class ShaderFactory;
 }
 
+namespace tf
+{
+    class Executor;
+}
+
+class CachedBindingSetFactory;
+class CachedShaderFactory;
 class RenderTargets;
 class Profiler;
 class SampleScene;
+struct GBufferConstants;
 
 typedef int ibool;
 
@@ -38,6 +49,12 @@ struct GBufferSettings
     ibool enableAlphaTestedGeometry = true;
     float textureLodBias = -1.f;
 
+    // Cull the draws in a compute shader and render them with indirect draws
+    bool enableGpuCulling = false;
+
+    // Submit the CPU-culled draws in pipeline, material and front-to-back order
+    bool sortDraws = true;
+
     bool enableMaterialReadback = false;
     dm::int2 materialReadbackPosition = 0;
 };
@@ -47,7 +64,7 @@ class RasterizedGBufferPass
 public:
     RasterizedGBufferPass(
         nvrhi::IDevice* device,
-        std::shared_ptr<donut::engine::ShaderFactory> shaderFactory,
+        std::shared_ptr<CachedShaderFactory> shaderFactory,
         std::shared_ptr<donut::engine::CommonRenderPasses> commonPasses,
         std::shared_ptr<donut::engine::Scene> scene,
         std::shared_ptr<Profiler> profiler,
@@ -57,28 +74,104 @@ public:
 
     void CreateBindingSet();
 
+    // Executor used to record the draws in parallel, may be null
+    void SetExecutor(tf::Executor* executor);
+
+    // With parallel recording and an executor, workers record the CPU-culled draws into command lists
+    // of their own, which the caller submits after commandList, see GetDrawCommandLists
     void Render(
         nvrhi::ICommandList* commandList,
         const donut::engine::IView& view,
         const donut::engine::IView& viewPrev,
         const RenderTargets& renderTargets,
-        const GBufferSettings& settings);
+        const GBufferSettings& settings,
+        bool parallelRecording = false);
+
+    // Closed command lists with the draws of the last Render call in submission order,
+    // empty when the draws were recorded into its command list
+    [[nodiscard]] const std::vector<nvrhi::CommandListHandle>& GetDrawCommandLists() const;
+
+    // State changes of the draws submitted by the last CPU-culled Render call
+    [[nodiscard]] const DrawStateStatistics& GetDrawStatistics() const;
+
+    // State changes that the same draws would cause in scene graph order
+    [[nodiscard]] const DrawStateStatistics& GetSceneOrderDrawStatistics() const;
+
+    // Draws whose sort keys changed in the last frame
+    [[nodiscard]] uint32_t GetResortedDrawCount() const;
 
 private:
+    void CreateDrawRecords();
+
+    void CullDrawRecords(
+        nvrhi::ICommandList* commandList,
+        const donut::engine::IView& view,
+        const GBufferSettings& settings);
+
+    void UpdateDrawOrder(const donut::engine::IView& view);
+
+    DrawStateStatistics CountSceneOrderDrawState(const GBufferSettings& settings) const;
+
+    // Returns false when there are too few draws to split, and the caller records them
+    bool RecordDrawsInParallel(
+        const nvrhi::GraphicsState* states,
+        const GBufferConstants& constants,
+        nvrhi::IFramebuffer* framebuffer);
+
     nvrhi::DeviceHandle m_device;
 
     nvrhi::GraphicsPipelineHandle m_opaquePipeline;
     nvrhi::GraphicsPipelineHandle m_alphaTestedPipeline;
+    nvrhi::GraphicsPipelineHandle m_indirectOpaquePipeline;
+    nvrhi::GraphicsPipelineHandle m_indirectAlphaTestedPipeline;
+    nvrhi::InputLayoutHandle m_indirectInputLayout;
     nvrhi::BindingLayoutHandle m_bindingLayout;
     nvrhi::BindingLayoutHandle m_bindlessLayout;
     nvrhi::BindingSetHandle m_bindingSet;
 
+    nvrhi::ComputePipelineHandle m_cullingPipeline;
+    nvrhi::BindingLayoutHandle m_cullingBindingLayout;
+    nvrhi::BindingSetHandle m_cullingBindingSet;
+
     nvrhi::BufferHandle m_constantBuffer;
+    nvrhi::BufferHandle m_cullingConstantBuffer;
 
-    std::shared_ptr<donut::engine::ShaderFactory> m_shaderFactory;
+    // Persistent draw records, one per geometry of every mesh instance, created with the binding set
+    nvrhi::BufferHandle m_drawRecordBuffer;
+    nvrhi::BufferHandle m_drawIndexBuffer;      // 0, 1, 2... read as the instance-rate DRAW_INDEX attribute
+    nvrhi::BufferHandle m_drawArgumentsBuffer;  // opaque and alpha-tested lists, recordCount draws each
+    nvrhi::BufferHandle m_drawCountBuffer;
+    uint32_t m_drawRecordCount = 0;
+    size_t m_drawRecordInstanceCount = 0;
+
+    std::shared_ptr<CachedShaderFactory> m_shaderFactory;
     std::shared_ptr<donut::engine::CommonRenderPasses> m_commonPasses;
     std::shared_ptr<donut::engine::Scene> m_scene;
     std::shared_ptr<Profiler> m_profiler;
+
+    std::vector<uint32_t> m_visibleInstances;
+    std::vector<uint8_t> m_instanceVisible;         // indexed by mesh instance
+
+    // CPU draw list with the same draws as the draw records
+    struct DrawListEntry
+    {
+        uint32_t instance;      // index into the mesh instances of the scene graph
+        uint32_t geometryIndex;
+    };
+
+    std::vector<DrawListEntry> m_drawList;
+    std::vector<uint32_t> m_instanceFirstDraw;      // indexed by mesh instance
+    SortedDrawList m_sortedDrawList;
+
+    DrawStateStatistics m_drawStatistics;
+    DrawStateStatistics m_sceneOrderDrawStatistics;
+
+    // CPU-culled draws of the frame in submission order, the state is 1 for alpha-tested draws
+    std::vector<DrawStreamItem> m_drawStream;
+    std::vector<nvrhi::CommandListHandle> m_drawCommandListPool;
+    std::vector<nvrhi::CommandListHandle> m_drawCommandLists;    // used in this frame
+
+    tf::Executor* m_executor = nullptr;
 };
 
 class PostprocessGBufferPass
@@ -86,7 +179,8 @@ class PostprocessGBufferPass
 public:
     PostprocessGBufferPass(
         nvrhi::IDevice* device,
-        std::shared_ptr<donut::engine::ShaderFactory> shaderFactory);
+        std::shared_ptr<CachedShaderFactory> shaderFactory,
+        std::shared_ptr<CachedBindingSetFactory> bindingSetFactory);
 
     void CreatePipeline();
 
@@ -109,5 +203,6 @@ private:
     nvrhi::BindingSetHandle m_bindingSet;
     nvrhi::BindingSetHandle m_prevBindingSet;
 
-    std::shared_ptr<donut::engine::ShaderFactory> m_shaderFactory;
+    std::shared_ptr<CachedShaderFactory> m_shaderFactory;
+    std::shared_ptr<CachedBindingSetFactory> m_bindingSetFactory;
 };
\ No newline at end of file
@@ -9,6 +9,7 @@
  **************************************************************************/
 
 #include "GenerateMipsPass.h"
+#include "../CachedShaderFactory.h"
 #include <donut/engine/ShaderFactory.h>
 #include <nvrhi/utils.h>
 
@@ -21,7 +22,7 @@ using namespace donut::math;
 
 GenerateMipsPass::GenerateMipsPass(
     nvrhi::IDevice* device, 
-    std::shared_ptr<donut::engine::ShaderFactory> shaderFactory,
+    std::shared_ptr<CachedShaderFactory> shaderFactory,
     nvrhi::ITexture* sourceEnvironmentMap,
     nvrhi::ITexture* destinationTexture)
     : m_sourceTexture(sourceEnvironmentMap)
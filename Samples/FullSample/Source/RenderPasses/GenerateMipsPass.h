@@ -13,17 +13,14 @@
 #include <nvrhi/nvrhi.h>
 #include <memory>
 
-namespace donut::engine
-{
-    class ShaderFactory;
-}
+class CachedShaderFactory;
 
 class GenerateMipsPass
 {
 public:
     GenerateMipsPass(
         nvrhi::IDevice* device,
-        std::shared_ptr<donut::engine::ShaderFactory> shaderFactory,
+        std::shared_ptr<CachedShaderFactory> shaderFactory,
         nvrhi::ITexture* sourceEnvironmentMap,
         nvrhi::ITexture* destinationTexture);
     
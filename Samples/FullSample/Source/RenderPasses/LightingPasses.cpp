@@ -9,9 +9,12 @@
  **************************************************************************/
 
 #include "LightingPasses.h"
+#include "../CachedBindingSetFactory.h"
+#include "../CachedShaderFactory.h"
 #include "../RenderTargets.h"
 #include "../RtxdiResources.h"
 #include "../Profiler.h"
+#include "../RenderGraphExecutor.h"
 #include "../SampleScene.h"
 #include "GBufferPass.h"
 
@@ -23,6 +26,10 @@
 #include <nvrhi/utils.h>
 #include <Rtxdi/ImportanceSamplingContext.h>
 
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
 #include <utility>
 
 using namespace donut::math;
@@ -73,7 +80,8 @@ BRDFPathTracing_Parameters GetDefaultBRDFPathTracingParams()
 
 LightingPasses::LightingPasses(
     nvrhi::IDevice* device, 
-    std::shared_ptr<ShaderFactory> shaderFactory,
+    std::shared_ptr<CachedShaderFactory> shaderFactory,
+    std::shared_ptr<CachedBindingSetFactory> bindingSetFactory,
     std::shared_ptr<donut::engine::CommonRenderPasses> commonPasses,
     std::shared_ptr<donut::engine::Scene> scene,
     std::shared_ptr<Profiler> profiler,
@@ -82,6 +90,7 @@ LightingPasses::LightingPasses(
     : m_device(device)
     , m_bindlessLayout(bindlessLayout)
     , m_shaderFactory(std::move(shaderFactory))
+    , m_bindingSetFactory(std::move(bindingSetFactory))
     , m_commonPasses(std::move(commonPasses))
     , m_scene(std::move(scene))
     , m_profiler(std::move(profiler))
@@ -117,6 +126,8 @@ LightingPasses::LightingPasses(
         nvrhi::BindingLayoutItem::Texture_SRV(23),
         nvrhi::BindingLayoutItem::Texture_SRV(24),
         nvrhi::BindingLayoutItem::StructuredBuffer_SRV(25),
+        nvrhi::BindingLayoutItem::StructuredBuffer_SRV(26),
+        nvrhi::BindingLayoutItem::TypedBuffer_SRV(27),
 
         nvrhi::BindingLayoutItem::StructuredBuffer_UAV(0),
         nvrhi::BindingLayoutItem::Texture_UAV(1),
@@ -130,6 +141,7 @@ LightingPasses::LightingPasses(
         nvrhi::BindingLayoutItem::TypedBuffer_UAV(11),
         nvrhi::BindingLayoutItem::TypedBuffer_UAV(12),
         nvrhi::BindingLayoutItem::StructuredBuffer_UAV(13),
+        nvrhi::BindingLayoutItem::TypedBuffer_UAV(14),
 
         nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
         nvrhi::BindingLayoutItem::PushConstants(1, sizeof(PerPassConstants)),
@@ -183,6 +195,8 @@ void LightingPasses::CreateBindingSet(
             nvrhi::BindingSetItem::Texture_SRV(23, resources.EnvironmentPdfTexture),
             nvrhi::BindingSetItem::Texture_SRV(24, resources.LocalLightPdfTexture),
             nvrhi::BindingSetItem::StructuredBuffer_SRV(25, resources.GeometryInstanceToLightBuffer),
+            nvrhi::BindingSetItem::StructuredBuffer_SRV(26, resources.InstancedLightRecordBuffer),
+            nvrhi::BindingSetItem::TypedBuffer_SRV(27, resources.LightRecordIndexBuffer),
 
             nvrhi::BindingSetItem::StructuredBuffer_UAV(0, resources.LightReservoirBuffer),
             nvrhi::BindingSetItem::Texture_UAV(1, renderTargets.DiffuseLighting),
@@ -196,6 +210,7 @@ void LightingPasses::CreateBindingSet(
             nvrhi::BindingSetItem::TypedBuffer_UAV(11, resources.RisLightDataBuffer),
             nvrhi::BindingSetItem::TypedBuffer_UAV(12, m_profiler->GetRayCountBuffer()),
             nvrhi::BindingSetItem::StructuredBuffer_UAV(13, resources.SecondaryGBuffer),
+            nvrhi::BindingSetItem::TypedBuffer_UAV(14, m_profiler->GetRayCountTileBuffer()),
 
             nvrhi::BindingSetItem::ConstantBuffer(0, m_constantBuffer),
             nvrhi::BindingSetItem::PushConstants(1, sizeof(PerPassConstants)),
@@ -203,7 +218,7 @@ void LightingPasses::CreateBindingSet(
             nvrhi::BindingSetItem::Sampler(1, m_commonPasses->m_LinearWrapSampler)
         };
 
-        const nvrhi::BindingSetHandle bindingSet = m_device->createBindingSet(bindingSetDesc, m_bindingLayout);
+        const nvrhi::BindingSetHandle bindingSet = m_bindingSetFactory->CreateBindingSet(currentFrame ? "LightingPasses/Current" : "LightingPasses/Previous", bindingSetDesc, m_bindingLayout);
 
         if (currentFrame)
             m_bindingSet = bindingSet;
@@ -222,18 +237,51 @@ void LightingPasses::CreateBindingSet(
     m_lightReservoirBuffer = resources.LightReservoirBuffer;
     m_secondarySurfaceBuffer = resources.SecondaryGBuffer;
     m_GIReservoirBuffer = resources.GIReservoirBuffer;
+    m_risBuffer = resources.RisBuffer;
+    m_risLightDataBuffer = resources.RisLightDataBuffer;
+    m_diffuseLighting = renderTargets.DiffuseLighting;
+    m_specularLighting = renderTargets.SpecularLighting;
+    m_temporalSamplePositions = renderTargets.TemporalSamplePositions;
+    m_gradients = renderTargets.Gradients;
+    m_restirLuminance = renderTargets.RestirLuminance;
+    m_prevRestirLuminance = renderTargets.PrevRestirLuminance;
 }
 
-void LightingPasses::CreateComputePass(ComputePass& pass, const char* shaderName, const std::vector<donut::engine::ShaderMacro>& macros)
+void LightingPasses::CreateComputePass(PipelineJobList& jobs, ComputePass& pass, const char* shaderName, const std::vector<donut::engine::ShaderMacro>& macros, ShaderFilter filter)
 {
+    if (filter && !filter->count(shaderName))
+        return;
+
+    // The shader factory caches the shader binaries without synchronization, so the shaders are loaded
+    // on this thread and only the pipeline creation becomes a job
     donut::log::debug("Initializing ComputePass %s...", shaderName);
 
     pass.Shader = m_shaderFactory->CreateShader(shaderName, "main", &macros, nvrhi::ShaderType::Compute);
 
-    nvrhi::ComputePipelineDesc pipelineDesc;
-    pipelineDesc.bindingLayouts = { m_bindingLayout, m_bindlessLayout };
-    pipelineDesc.CS = pass.Shader;
-    pass.Pipeline = m_device->createComputePipeline(pipelineDesc);
+    jobs.Add(shaderName, [this, &pass]()
+    {
+        if (!pass.Shader)
+            return false;
+
+        nvrhi::ComputePipelineDesc pipelineDesc;
+        pipelineDesc.bindingLayouts = { m_bindingLayout, m_bindlessLayout };
+        pipelineDesc.CS = pass.Shader;
+        pass.Pipeline = m_device->createComputePipeline(pipelineDesc);
+        return pass.Pipeline != nullptr;
+    });
+}
+
+void LightingPasses::CreateRayTracingPass(PipelineJobList& jobs, RayTracingPass& pass, const char* shaderName, const std::vector<donut::engine::ShaderMacro>& macros, bool useRayQuery, ShaderFilter filter)
+{
+    if (filter && !filter->count(shaderName))
+        return;
+
+    const bool shadersLoaded = pass.LoadShaders(*m_shaderFactory, shaderName, macros, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE);
+
+    jobs.Add(shaderName, [this, &pass, shadersLoaded]()
+    {
+        return shadersLoaded && pass.CreatePipeline(m_device, m_bindingLayout, nullptr, m_bindlessLayout);
+    });
 }
 
 void LightingPasses::ExecuteComputePass(nvrhi::ICommandList* commandList, ComputePass& pass, const char* passName, dm::int2 dispatchSize, ProfilerSection::Enum profilerSection)
@@ -263,6 +311,7 @@ void LightingPasses::ExecuteRayTracingPass(nvrhi::ICommandList* commandList, Ray
 
     PerPassConstants pushConstants{};
     pushConstants.rayCountBufferIndex = enableRayCounts ? profilerSection : -1;
+    pushConstants.rayCountTileGridWidth = enableRayCounts ? m_profiler->GetRayCountTileGridWidth(profilerSection) : 0;
     
     pass.Execute(commandList, dispatchSize.x, dispatchSize.y, m_bindingSet, extraBindingSet, m_scene->GetDescriptorTable(), &pushConstants, sizeof(pushConstants));
     
@@ -270,38 +319,200 @@ void LightingPasses::ExecuteRayTracingPass(nvrhi::ICommandList* commandList, Ray
     commandList->endMarker();
 }
 
-void LightingPasses::CreatePresamplingPipelines()
+void LightingPasses::CreatePresamplingPipelines(Pipelines& pipelines, PipelineJobList& jobs, ShaderFilter filter)
 {
-    CreateComputePass(m_presampleLightsPass, "app/LightingPasses/Presampling/PresampleLights.hlsl", {});
-    CreateComputePass(m_presampleEnvironmentMapPass, "app/LightingPasses/Presampling/PresampleEnvironmentMap.hlsl", {});
+    CreateComputePass(jobs, pipelines.PresampleLights, "app/LightingPasses/Presampling/PresampleLights.hlsl", {}, filter);
+    CreateComputePass(jobs, pipelines.PresampleEnvironmentMap, "app/LightingPasses/Presampling/PresampleEnvironmentMap.hlsl", {}, filter);
 }
 
-void LightingPasses::CreateReSTIRDIPipelines(bool useRayQuery)
+void LightingPasses::CreateReSTIRDIPipelines(Pipelines& pipelines, PipelineJobList& jobs, bool useRayQuery, ShaderFilter filter)
 {
     std::vector<donut::engine::ShaderMacro> regirMacros = { {"RTXDI_REGIR_MODE", "RTXDI_REGIR_DISABLED"} };
-    m_generateInitialSamplesPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/DI/GenerateInitialSamples.hlsl", regirMacros, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_temporalResamplingPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/DI/TemporalResampling.hlsl", {}, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_spatialResamplingPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/DI/SpatialResampling.hlsl", {}, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_shadeSamplesPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/DI/ShadeSamples.hlsl", regirMacros, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_brdfRayTracingPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/BrdfRayTracing.hlsl", {}, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_shadeSecondarySurfacesPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/ShadeSecondarySurfaces.hlsl", regirMacros, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_fusedResamplingPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/DI/FusedResampling.hlsl", regirMacros, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_gradientsPass.Init(m_device, *m_shaderFactory, "app/DenoisingPasses/ComputeGradients.hlsl", {}, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
+    CreateRayTracingPass(jobs, pipelines.GenerateInitialSamples, "app/LightingPasses/DI/GenerateInitialSamples.hlsl", regirMacros, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.TemporalResampling, "app/LightingPasses/DI/TemporalResampling.hlsl", {}, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.SpatialResampling, "app/LightingPasses/DI/SpatialResampling.hlsl", {}, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.ShadeSamples, "app/LightingPasses/DI/ShadeSamples.hlsl", regirMacros, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.BrdfRayTracing, "app/LightingPasses/BrdfRayTracing.hlsl", {}, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.ShadeSecondarySurfaces, "app/LightingPasses/ShadeSecondarySurfaces.hlsl", regirMacros, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.FusedResampling, "app/LightingPasses/DI/FusedResampling.hlsl", regirMacros, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.Gradients, "app/DenoisingPasses/ComputeGradients.hlsl", {}, useRayQuery, filter);
 }
 
-void LightingPasses::CreateReSTIRGIPipelines(bool useRayQuery)
+void LightingPasses::CreateReSTIRGIPipelines(Pipelines& pipelines, PipelineJobList& jobs, bool useRayQuery, ShaderFilter filter)
 {
-    m_GITemporalResamplingPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/GI/TemporalResampling.hlsl", {}, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_GISpatialResamplingPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/GI/SpatialResampling.hlsl", {}, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_GIFusedResamplingPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/GI/FusedResampling.hlsl", {}, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
-    m_GIFinalShadingPass.Init(m_device, *m_shaderFactory, "app/LightingPasses/GI/FinalShading.hlsl", {}, useRayQuery, RTXDI_SCREEN_SPACE_GROUP_SIZE, m_bindingLayout, nullptr, m_bindlessLayout);
+    CreateRayTracingPass(jobs, pipelines.GITemporalResampling, "app/LightingPasses/GI/TemporalResampling.hlsl", {}, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.GISpatialResampling, "app/LightingPasses/GI/SpatialResampling.hlsl", {}, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.GIFusedResampling, "app/LightingPasses/GI/FusedResampling.hlsl", {}, useRayQuery, filter);
+    CreateRayTracingPass(jobs, pipelines.GIFinalShading, "app/LightingPasses/GI/FinalShading.hlsl", {}, useRayQuery, filter);
 }
 
-void LightingPasses::CreatePipelines(bool useRayQuery)
+void LightingPasses::CreatePipelines(bool useRayQuery, bool async)
 {
-    CreatePresamplingPipelines();
-    CreateReSTIRDIPipelines(useRayQuery);
-    CreateReSTIRGIPipelines(useRayQuery);
+    BuildPipelines(useRayQuery, async, nullptr);
+}
+
+void LightingPasses::ReloadPipelines(const std::unordered_set<std::string>& shaderNames, bool useRayQuery, bool async)
+{
+    // A running build would be superseded by one that starts from the older live set
+    const bool reloadAll = useRayQuery != m_useRayQuery || m_pipelineBuilder.GetCommittedGeneration() == 0 || m_pipelineBuilder.IsBuilding();
+    if (!reloadAll && shaderNames.empty())
+        return;
+
+    BuildPipelines(useRayQuery, async, reloadAll ? nullptr : &shaderNames);
+}
+
+void LightingPasses::BuildPipelines(bool useRayQuery, bool async, ShaderFilter filter)
+{
+    m_useRayQuery = useRayQuery;
+
+    // Specializations of the reloaded shaders are recreated on their next use.
+    // Erasing a pass waits for its pipeline job if it is still running.
+    for (auto it = m_specializedPasses.begin(); it != m_specializedPasses.end(); )
+    {
+        if (!filter || filter->count(it->second->shaderName))
+            it = m_specializedPasses.erase(it);
+        else
+            ++it;
+    }
+
+    auto createJobs = [this, useRayQuery, filter](Pipelines& pipelines, PipelineJobList& jobs)
+    {
+        // The staging set starts as a copy of the live one when only some passes are replaced,
+        // the copy shares the pipeline objects of the unaffected passes
+        if (filter)
+            pipelines = m_pipelines;
+
+        CreatePresamplingPipelines(pipelines, jobs, filter);
+        CreateReSTIRDIPipelines(pipelines, jobs, useRayQuery, filter);
+        CreateReSTIRGIPipelines(pipelines, jobs, useRayQuery, filter);
+    };
+
+    PipelineJobParallelFor parallelFor;
+#ifdef DONUT_WITH_TASKFLOW
+    if (m_executor)
+    {
+        // Nothing to render with before the first commit, so that one is always synchronous
+        if (async && m_pipelineBuilder.GetCommittedGeneration() != 0)
+        {
+            m_pipelineBuilder.Start(createJobs, GetPipelineJobLauncher());
+            return;
+        }
+
+        parallelFor = [this](size_t taskCount, const std::function<void(size_t task)>& task)
+        {
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(size_t(0), taskCount, size_t(1), task);
+            m_executor->run(taskflow).wait();
+        };
+    }
+#endif
+
+    m_pipelineBuilder.Build(createJobs, parallelFor);
+
+    // A failed synchronous build still replaces the pipelines, like initializing the passes one by one did,
+    // because the previous pipelines may have been created for different settings
+    m_pipelineBuilder.Commit(m_pipelines, true);
+    LogPipelineBuild();
+}
+
+PipelineJobLauncher LightingPasses::GetPipelineJobLauncher()
+{
+#ifdef DONUT_WITH_TASKFLOW
+    if (m_executor)
+    {
+        return [this](size_t taskCount, std::function<void(size_t task)> task, std::function<void()> done)
+        {
+            tf::Taskflow taskflow;
+            tf::Task jobs = taskflow.for_each_index(size_t(0), taskCount, size_t(1), std::move(task));
+            taskflow.emplace(std::move(done)).succeed(jobs);
+            m_executor->run(std::move(taskflow));
+        };
+    }
+#endif
+
+    // Without an executor the jobs run before the launcher returns
+    return [](size_t taskCount, std::function<void(size_t task)> task, std::function<void()> done)
+    {
+        SerialPipelineJobFor(taskCount, task);
+        done();
+    };
+}
+
+RayTracingPass& LightingPasses::GetResamplingPass(ResamplingShader shader, RayTracingPass& genericPass, const RenderSettings& localSettings, const ResamplingStaticSettings& staticSettings)
+{
+    // Shaders.cfg specializes the compute permutations only
+    if (!localSettings.enableSpecializedResampling || !m_useRayQuery)
+        return genericPass;
+
+    const std::string key = GetResamplingSpecializationKey(shader, staticSettings);
+    if (key.empty())
+        return genericPass;
+
+    std::unique_ptr<SpecializedPass>& specialized = m_specializedPasses[key];
+    if (!specialized)
+    {
+        specialized = std::make_unique<SpecializedPass>();
+        specialized->shaderName = GetResamplingShaderName(shader);
+
+        // In the order of the defines on the Shaders.cfg lines, after the USE_RAY_QUERY added by LoadShaders
+        std::vector<donut::engine::ShaderMacro> macros;
+        for (const ShaderPermutationMacro& macro : GetResamplingSpecializationMacros(shader, staticSettings))
+            macros.push_back({ macro.name, macro.definition });
+
+        const char* shaderName = specialized->shaderName;
+        specialized->builder.Start([this, shaderName, &macros](RayTracingPass& pass, PipelineJobList& jobs)
+        {
+            CreateRayTracingPass(jobs, pass, shaderName, macros, true, nullptr);
+        }, GetPipelineJobLauncher());
+    }
+
+    if (!specialized->ready && !specialized->failed)
+    {
+        const AsyncPipelineStatus status = specialized->builder.Commit(specialized->pass);
+        if (status == AsyncPipelineStatus::Committed)
+        {
+            specialized->ready = true;
+            donut::log::info("Created the specialized pipeline for %s in %.1f ms", key.c_str(), specialized->builder.GetLastBuildMs());
+        }
+        else if (status == AsyncPipelineStatus::Failed)
+        {
+            // Keeps using the generic pass for these settings, a shader reload retries
+            specialized->failed = true;
+            donut::log::warning("Failed to create the specialized pipeline for %s", key.c_str());
+        }
+    }
+
+    return specialized->ready ? specialized->pass : genericPass;
+}
+
+bool LightingPasses::CommitPipelines()
+{
+    // A failed background build is dropped, the previous pipelines stay in use
+    const AsyncPipelineStatus status = m_pipelineBuilder.Commit(m_pipelines);
+    if (status == AsyncPipelineStatus::Idle || status == AsyncPipelineStatus::Building)
+        return false;
+
+    LogPipelineBuild();
+    return status == AsyncPipelineStatus::Committed;
+}
+
+void LightingPasses::LogPipelineBuild() const
+{
+    // In job order, so the log doesn't depend on which thread finished first
+    for (const std::string& failure : m_pipelineBuilder.GetLastFailures())
+        donut::log::warning("Failed to create the pipeline for %s", failure.c_str());
+
+    donut::log::info("Created %zu lighting pipelines in %.1f ms", m_pipelineBuilder.GetLastJobCount(), m_pipelineBuilder.GetLastBuildMs());
+}
+
+bool LightingPasses::IsCreatingPipelines() const
+{
+    return m_pipelineBuilder.IsBuilding();
+}
+
+void LightingPasses::SetExecutor(tf::Executor* executor)
+{
+    m_executor = executor;
 }
 
 void FillReSTIRDIConstants(ReSTIRDI_Parameters& params, const rtxdi::ReSTIRDIContext& restirDIContext, const RTXDI_LightBufferParameters& lightBufferParameters)
@@ -326,6 +537,26 @@ void FillReSTIRGIConstants(ReSTIRGI_Parameters& constants, const rtxdi::ReSTIRGI
     constants.finalShadingParams = restirGIContext.GetFinalShadingParameters();
 }
 
+static ResamplingStaticSettings GetResamplingStaticSettings(const rtxdi::ReSTIRDIContext& restirDIContext)
+{
+    ResamplingStaticSettings settings;
+    settings.diLocalLightSamplingMode = uint32_t(restirDIContext.GetInitialSamplingParameters().localLightSamplingMode);
+    settings.diTemporalBiasCorrection = uint32_t(restirDIContext.GetTemporalResamplingParameters().temporalBiasCorrection);
+    settings.diBoilingFilter = uint32_t(restirDIContext.GetTemporalResamplingParameters().enableBoilingFilter);
+    settings.diDiscardInvisibleSamples = uint32_t(restirDIContext.GetTemporalResamplingParameters().discardInvisibleSamples);
+    settings.diSpatialBiasCorrection = uint32_t(restirDIContext.GetSpatialResamplingParameters().spatialBiasCorrection);
+    return settings;
+}
+
+static ResamplingStaticSettings GetResamplingStaticSettings(const rtxdi::ReSTIRDIContext& restirDIContext, const rtxdi::ReSTIRGIContext& restirGIContext)
+{
+    ResamplingStaticSettings settings = GetResamplingStaticSettings(restirDIContext);
+    settings.giTemporalBiasCorrection = uint32_t(restirGIContext.GetTemporalResamplingParameters().temporalBiasCorrectionMode);
+    settings.giBoilingFilter = uint32_t(restirGIContext.GetTemporalResamplingParameters().enableBoilingFilter);
+    settings.giSpatialBiasCorrection = uint32_t(restirGIContext.GetSpatialResamplingParameters().spatialBiasCorrectionMode);
+    return settings;
+}
+
 void FillBRDFPTConstants(BRDFPathTracing_Parameters& constants, const GBufferSettings& gbufferSettings, const LightingPasses::RenderSettings& lightingSettings, const RTXDI_LightBufferParameters& lightBufferParameters)
 {
     constants = lightingSettings.brdfptParams;
@@ -396,7 +627,7 @@ void LightingPasses::PrepareForLightSampling(
             int(isContext.GetLocalLightRISBufferSegmentParams().tileCount)
         };
 
-        ExecuteComputePass(commandList, m_presampleLightsPass, "PresampleLights", presampleDispatchSize, ProfilerSection::PresampleLights);
+        ExecuteComputePass(commandList, m_pipelines.PresampleLights, "PresampleLights", presampleDispatchSize, ProfilerSection::PresampleLights);
     }
 
     if (lightBufferParams.environmentLightParams.lightPresent)
@@ -406,7 +637,7 @@ void LightingPasses::PrepareForLightSampling(
             int(isContext.GetEnvironmentLightRISBufferSegmentParams().tileCount)
         };
 
-        ExecuteComputePass(commandList, m_presampleEnvironmentMapPass, "PresampleEnvironmentMap", presampleDispatchSize, ProfilerSection::PresampleEnvMap);
+        ExecuteComputePass(commandList, m_pipelines.PresampleEnvironmentMap, "PresampleEnvironmentMap", presampleDispatchSize, ProfilerSection::PresampleEnvMap);
     }
 }
 
@@ -426,45 +657,102 @@ void LightingPasses::RenderDirectLighting(
 
     // Run the lighting passes in the necessary sequence: one fused kernel or multiple separate passes.
     //
-    // Note: the below code places explicit UAV barriers between subsequent passes
-    // because NVRHI misses them, as the binding sets are exactly the same between these passes.
-    // That equality makes NVRHI take a shortcut for performance and it doesn't look at bindings at all.
+    // The passes share one binding set, so NVRHI doesn't place the barriers between them: the render graph
+    // places them from the declared accesses. The ray count buffers are only incremented atomically
+    // and are not declared. The RIS buffers were written by the presampling passes, and the gradients
+    // texture was cleared before this call.
+
+    const ResamplingStaticSettings staticSettings = GetResamplingStaticSettings(context);
+    const bool enableRayCounts = localSettings.enableRayCounts;
+
+    RenderGraphExecutor graph;
+    const RenderGraphResource gbuffer = graph.AddReadOnlyResource("GBuffer");
+    const RenderGraphResource prevGBuffer = graph.AddReadOnlyResource("PrevGBuffer");
+    const RenderGraphResource risBuffer = graph.AddBuffer("RisBuffer", m_risBuffer, RenderGraphAccess::UnorderedWrite);
+    const RenderGraphResource risLightDataBuffer = graph.AddBuffer("RisLightDataBuffer", m_risLightDataBuffer, RenderGraphAccess::UnorderedWrite);
+    const RenderGraphResource lightReservoirs = graph.AddBuffer("LightReservoirs", m_lightReservoirBuffer, RenderGraphAccess::None, true);
+    const RenderGraphResource temporalSamplePositions = graph.AddTexture("TemporalSamplePositions", m_temporalSamplePositions, RenderGraphAccess::None, true);
+    const RenderGraphResource diffuseLighting = graph.AddTexture("DiffuseLighting", m_diffuseLighting, RenderGraphAccess::None, true);
+    const RenderGraphResource specularLighting = graph.AddTexture("SpecularLighting", m_specularLighting, RenderGraphAccess::None, true);
+    const RenderGraphResource restirLuminance = graph.AddTexture("RestirLuminance", m_restirLuminance, RenderGraphAccess::None, true);
+    const RenderGraphResource gradients = graph.AddTexture("Gradients", m_gradients, RenderGraphAccess::UnorderedWrite, localSettings.enableGradients);
+
+    const std::vector<RenderGraphUse> shadingUses = {
+        { lightReservoirs, RenderGraphAccess::UnorderedReadWrite },
+        { diffuseLighting, RenderGraphAccess::UnorderedReadWrite },
+        { specularLighting, RenderGraphAccess::UnorderedReadWrite },
+        { restirLuminance, RenderGraphAccess::UnorderedWrite }
+    };
 
     if (context.GetResamplingMode() == rtxdi::ReSTIRDI_ResamplingMode::FusedSpatiotemporal)
     {
-        nvrhi::utils::BufferUavBarrier(commandList, m_lightReservoirBuffer);
-
-        ExecuteRayTracingPass(commandList, m_fusedResamplingPass, localSettings.enableRayCounts, "DIFusedResampling", dispatchSize, ProfilerSection::Shading);
+        std::vector<RenderGraphUse> uses = shadingUses;
+        uses.insert(uses.end(), {
+            { gbuffer, RenderGraphAccess::ShaderRead },
+            { prevGBuffer, RenderGraphAccess::ShaderRead },
+            { risBuffer, RenderGraphAccess::UnorderedRead },
+            { risLightDataBuffer, RenderGraphAccess::UnorderedRead },
+            { temporalSamplePositions, RenderGraphAccess::UnorderedWrite } });
+
+        graph.AddPass("DIFusedResampling", uses, [&]()
+        {
+            ExecuteRayTracingPass(commandList, GetResamplingPass(ResamplingShader::DIFusedResampling, m_pipelines.FusedResampling, localSettings, staticSettings), enableRayCounts, "DIFusedResampling", dispatchSize, ProfilerSection::Shading);
+        });
     }
     else
     {
-        ExecuteRayTracingPass(commandList, m_generateInitialSamplesPass, localSettings.enableRayCounts, "DIGenerateInitialSamples", dispatchSize, ProfilerSection::InitialSamples);
+        graph.AddPass("DIGenerateInitialSamples", {
+            { gbuffer, RenderGraphAccess::ShaderRead },
+            { risBuffer, RenderGraphAccess::UnorderedRead },
+            { risLightDataBuffer, RenderGraphAccess::UnorderedRead },
+            { lightReservoirs, RenderGraphAccess::UnorderedReadWrite } }, [&]()
+        {
+            ExecuteRayTracingPass(commandList, GetResamplingPass(ResamplingShader::DIGenerateInitialSamples, m_pipelines.GenerateInitialSamples, localSettings, staticSettings), enableRayCounts, "DIGenerateInitialSamples", dispatchSize, ProfilerSection::InitialSamples);
+        });
 
         if (context.GetResamplingMode() == rtxdi::ReSTIRDI_ResamplingMode::Temporal || context.GetResamplingMode() == rtxdi::ReSTIRDI_ResamplingMode::TemporalAndSpatial)
         {
-            nvrhi::utils::BufferUavBarrier(commandList, m_lightReservoirBuffer);
-
-            ExecuteRayTracingPass(commandList, m_temporalResamplingPass, localSettings.enableRayCounts, "DITemporalResampling", dispatchSize, ProfilerSection::TemporalResampling);
+            graph.AddPass("DITemporalResampling", {
+                { gbuffer, RenderGraphAccess::ShaderRead },
+                { prevGBuffer, RenderGraphAccess::ShaderRead },
+                { lightReservoirs, RenderGraphAccess::UnorderedReadWrite },
+                { temporalSamplePositions, RenderGraphAccess::UnorderedWrite } }, [&]()
+            {
+                ExecuteRayTracingPass(commandList, GetResamplingPass(ResamplingShader::DITemporalResampling, m_pipelines.TemporalResampling, localSettings, staticSettings), enableRayCounts, "DITemporalResampling", dispatchSize, ProfilerSection::TemporalResampling);
+            });
         }
 
         if (context.GetResamplingMode() == rtxdi::ReSTIRDI_ResamplingMode::Spatial || context.GetResamplingMode() == rtxdi::ReSTIRDI_ResamplingMode::TemporalAndSpatial)
         {
-            nvrhi::utils::BufferUavBarrier(commandList, m_lightReservoirBuffer);
-
-            ExecuteRayTracingPass(commandList, m_spatialResamplingPass, localSettings.enableRayCounts, "DISpatialResampling", dispatchSize, ProfilerSection::SpatialResampling);
+            graph.AddPass("DISpatialResampling", {
+                { gbuffer, RenderGraphAccess::ShaderRead },
+                { lightReservoirs, RenderGraphAccess::UnorderedReadWrite } }, [&]()
+            {
+                ExecuteRayTracingPass(commandList, GetResamplingPass(ResamplingShader::DISpatialResampling, m_pipelines.SpatialResampling, localSettings, staticSettings), enableRayCounts, "DISpatialResampling", dispatchSize, ProfilerSection::SpatialResampling);
+            });
         }
 
-        nvrhi::utils::BufferUavBarrier(commandList, m_lightReservoirBuffer);
+        std::vector<RenderGraphUse> uses = shadingUses;
+        uses.push_back({ gbuffer, RenderGraphAccess::ShaderRead });
 
-        ExecuteRayTracingPass(commandList, m_shadeSamplesPass, localSettings.enableRayCounts, "DIShadeSamples", dispatchSize, ProfilerSection::Shading);
+        graph.AddPass("DIShadeSamples", uses, [&]()
+        {
+            ExecuteRayTracingPass(commandList, m_pipelines.ShadeSamples, enableRayCounts, "DIShadeSamples", dispatchSize, ProfilerSection::Shading);
+        });
     }
-    
-    if (localSettings.enableGradients)
+
+    // Culled when the gradients are not used
+    graph.AddPass("DIGradients", {
+        { gbuffer, RenderGraphAccess::ShaderRead },
+        { prevGBuffer, RenderGraphAccess::ShaderRead },
+        { lightReservoirs, RenderGraphAccess::UnorderedRead },
+        { temporalSamplePositions, RenderGraphAccess::UnorderedRead },
+        { gradients, RenderGraphAccess::UnorderedWrite } }, [&]()
     {
-        nvrhi::utils::BufferUavBarrier(commandList, m_lightReservoirBuffer);
+        ExecuteRayTracingPass(commandList, m_pipelines.Gradients, enableRayCounts, "DIGradients", (dispatchSize + RTXDI_GRAD_FACTOR - 1) / RTXDI_GRAD_FACTOR, ProfilerSection::Gradients);
+    });
 
-        ExecuteRayTracingPass(commandList, m_gradientsPass, localSettings.enableRayCounts, "DIGradients", (dispatchSize + RTXDI_GRAD_FACTOR - 1) / RTXDI_GRAD_FACTOR, ProfilerSection::Gradients);
-    }
+    graph.Execute(commandList);
 }
 
 void LightingPasses::RenderBrdfRays(
@@ -516,53 +804,99 @@ void LightingPasses::RenderBrdfRays(
     if (restirDIContext.GetStaticParameters().CheckerboardSamplingMode != rtxdi::CheckerboardMode::Off)
         dispatchSize.x /= 2;
 
-    ExecuteRayTracingPass(commandList, m_brdfRayTracingPass, localSettings.enableRayCounts, "BrdfRayTracingPass", dispatchSize, ProfilerSection::BrdfRays);
+    // The lighting outputs were written by the direct lighting passes, and the passes here add to them.
+    // See the note on barriers in RenderDirectLighting(...)
+
+    const bool enableRayCounts = localSettings.enableRayCounts;
+
+    RenderGraphExecutor graph;
+    const RenderGraphResource gbuffer = graph.AddReadOnlyResource("GBuffer");
+    const RenderGraphResource prevGBuffer = graph.AddReadOnlyResource("PrevGBuffer");
+    const RenderGraphResource secondaryGBuffer = graph.AddBuffer("SecondaryGBuffer", m_secondarySurfaceBuffer);
+    const RenderGraphResource giReservoirs = graph.AddBuffer("GIReservoirs", m_GIReservoirBuffer, RenderGraphAccess::None, true);
+    const RenderGraphResource diffuseLighting = graph.AddTexture("DiffuseLighting", m_diffuseLighting, RenderGraphAccess::UnorderedReadWrite, true);
+    const RenderGraphResource specularLighting = graph.AddTexture("SpecularLighting", m_specularLighting, RenderGraphAccess::UnorderedReadWrite, true);
+
+    graph.AddPass("BrdfRayTracingPass", {
+        { gbuffer, RenderGraphAccess::ShaderRead },
+        { secondaryGBuffer, RenderGraphAccess::UnorderedWrite },
+        { diffuseLighting, RenderGraphAccess::UnorderedReadWrite },
+        { specularLighting, RenderGraphAccess::UnorderedReadWrite } }, [&]()
+    {
+        ExecuteRayTracingPass(commandList, m_pipelines.BrdfRayTracing, enableRayCounts, "BrdfRayTracingPass", dispatchSize, ProfilerSection::BrdfRays);
+    });
 
     if (enableIndirect)
     {
-        // Place an explicit UAV barrier between the passes. See the note on barriers in RenderDirectLighting(...)
-        nvrhi::utils::BufferUavBarrier(commandList, m_secondarySurfaceBuffer);
+        graph.AddPass("ShadeSecondarySurfaces", {
+            { gbuffer, RenderGraphAccess::ShaderRead },
+            { secondaryGBuffer, RenderGraphAccess::UnorderedReadWrite },
+            { giReservoirs, RenderGraphAccess::UnorderedReadWrite },
+            { diffuseLighting, RenderGraphAccess::UnorderedReadWrite },
+            { specularLighting, RenderGraphAccess::UnorderedReadWrite } }, [&]()
+        {
+            ExecuteRayTracingPass(commandList, m_pipelines.ShadeSecondarySurfaces, enableRayCounts, "ShadeSecondarySurfaces", dispatchSize, ProfilerSection::ShadeSecondary, nullptr);
+        });
 
-        ExecuteRayTracingPass(commandList, m_shadeSecondarySurfacesPass, localSettings.enableRayCounts, "ShadeSecondarySurfaces", dispatchSize, ProfilerSection::ShadeSecondary, nullptr);
-        
         if (enableReSTIRGI)
         {
+            const ResamplingStaticSettings staticSettings = GetResamplingStaticSettings(restirDIContext, restirGIContext);
             rtxdi::ReSTIRGI_ResamplingMode resamplingMode = restirGIContext.GetResamplingMode();
             if (resamplingMode == rtxdi::ReSTIRGI_ResamplingMode::FusedSpatiotemporal)
             {
-                nvrhi::utils::BufferUavBarrier(commandList, m_GIReservoirBuffer);
-
-                ExecuteRayTracingPass(commandList, m_GIFusedResamplingPass, localSettings.enableRayCounts, "GIFusedResampling", dispatchSize, ProfilerSection::GIFusedResampling, nullptr);
+                graph.AddPass("GIFusedResampling", {
+                    { gbuffer, RenderGraphAccess::ShaderRead },
+                    { prevGBuffer, RenderGraphAccess::ShaderRead },
+                    { giReservoirs, RenderGraphAccess::UnorderedReadWrite } }, [&]()
+                {
+                    ExecuteRayTracingPass(commandList, GetResamplingPass(ResamplingShader::GIFusedResampling, m_pipelines.GIFusedResampling, localSettings, staticSettings), enableRayCounts, "GIFusedResampling", dispatchSize, ProfilerSection::GIFusedResampling, nullptr);
+                });
             }
             else
             {
                 if (resamplingMode == rtxdi::ReSTIRGI_ResamplingMode::Temporal ||
                     resamplingMode == rtxdi::ReSTIRGI_ResamplingMode::TemporalAndSpatial)
                 {
-                    nvrhi::utils::BufferUavBarrier(commandList, m_GIReservoirBuffer);
-
-                    ExecuteRayTracingPass(commandList, m_GITemporalResamplingPass, localSettings.enableRayCounts, "GITemporalResampling", dispatchSize, ProfilerSection::GITemporalResampling, nullptr);
+                    graph.AddPass("GITemporalResampling", {
+                        { gbuffer, RenderGraphAccess::ShaderRead },
+                        { prevGBuffer, RenderGraphAccess::ShaderRead },
+                        { giReservoirs, RenderGraphAccess::UnorderedReadWrite } }, [&]()
+                    {
+                        ExecuteRayTracingPass(commandList, GetResamplingPass(ResamplingShader::GITemporalResampling, m_pipelines.GITemporalResampling, localSettings, staticSettings), enableRayCounts, "GITemporalResampling", dispatchSize, ProfilerSection::GITemporalResampling, nullptr);
+                    });
                 }
 
                 if (resamplingMode == rtxdi::ReSTIRGI_ResamplingMode::Spatial ||
                     resamplingMode == rtxdi::ReSTIRGI_ResamplingMode::TemporalAndSpatial)
                 {
-                    nvrhi::utils::BufferUavBarrier(commandList, m_GIReservoirBuffer);
-
-                    ExecuteRayTracingPass(commandList, m_GISpatialResamplingPass, localSettings.enableRayCounts, "GISpatialResampling", dispatchSize, ProfilerSection::GISpatialResampling, nullptr);
+                    graph.AddPass("GISpatialResampling", {
+                        { gbuffer, RenderGraphAccess::ShaderRead },
+                        { giReservoirs, RenderGraphAccess::UnorderedReadWrite } }, [&]()
+                    {
+                        ExecuteRayTracingPass(commandList, GetResamplingPass(ResamplingShader::GISpatialResampling, m_pipelines.GISpatialResampling, localSettings, staticSettings), enableRayCounts, "GISpatialResampling", dispatchSize, ProfilerSection::GISpatialResampling, nullptr);
+                    });
                 }
             }
 
-            nvrhi::utils::BufferUavBarrier(commandList, m_GIReservoirBuffer);
-
-            ExecuteRayTracingPass(commandList, m_GIFinalShadingPass, localSettings.enableRayCounts, "GIFinalShading", dispatchSize, ProfilerSection::GIFinalShading, nullptr);
+            graph.AddPass("GIFinalShading", {
+                { gbuffer, RenderGraphAccess::ShaderRead },
+                { secondaryGBuffer, RenderGraphAccess::UnorderedRead },
+                { giReservoirs, RenderGraphAccess::UnorderedReadWrite },
+                { diffuseLighting, RenderGraphAccess::UnorderedReadWrite },
+                { specularLighting, RenderGraphAccess::UnorderedReadWrite } }, [&]()
+            {
+                ExecuteRayTracingPass(commandList, m_pipelines.GIFinalShading, enableRayCounts, "GIFinalShading", dispatchSize, ProfilerSection::GIFinalShading, nullptr);
+            });
         }
     }
+
+    graph.Execute(commandList);
 }
 
 void LightingPasses::NextFrame()
 {
     std::swap(m_bindingSet, m_prevBindingSet);
+    std::swap(m_restirLuminance, m_prevRestirLuminance);
     m_lastFrameOutputReservoir = m_currentFrameOutputReservoir;
 }
 
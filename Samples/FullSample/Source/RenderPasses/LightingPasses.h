@@ -11,11 +11,16 @@
 #pragma once
 
 #include "RayTracingPass.h"
+#include "../AsyncPipelineSet.h"
 #include "../ProfilerSections.h"
+#include "../ResamplingSpecialization.h"
 
 #include <donut/core/math/math.h>
 #include <nvrhi/nvrhi.h>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <Rtxdi/DI/ReSTIRDIParameters.h>
 #include <Rtxdi/GI/ReSTIRGIParameters.h>
@@ -26,7 +31,6 @@ namespace donut::engine
     class Scene;
     class CommonRenderPasses;
     class IView;
-    class ShaderFactory;
     struct ShaderMacro;
 }
 
@@ -36,9 +40,16 @@ namespace rtxdi
     class ImportanceSamplingContext;
 }
 
+namespace tf
+{
+    class Executor;
+}
+
 class RenderTargets;
 class RtxdiResources;
 class Profiler;
+class CachedBindingSetFactory;
+class CachedShaderFactory;
 class EnvironmentLight;
 struct ResamplingConstants;
 struct GBufferSettings;
@@ -71,18 +82,39 @@ public:
         float gradientSensitivity = 8.f;
         float confidenceHistoryLength = 0.75f;
 
+        // Use the resampling kernels compiled for the current ReSTIR DI and GI settings, see ResamplingSpecialization.h
+        ibool enableSpecializedResampling = false;
+
         BRDFPathTracing_Parameters brdfptParams = GetDefaultBRDFPathTracingParams();
     };
 
     LightingPasses(
         nvrhi::IDevice* device,
-        std::shared_ptr<donut::engine::ShaderFactory> shaderFactory,
+        std::shared_ptr<CachedShaderFactory> shaderFactory,
+        std::shared_ptr<CachedBindingSetFactory> bindingSetFactory,
         std::shared_ptr<donut::engine::CommonRenderPasses> commonPasses,
         std::shared_ptr<donut::engine::Scene> scene,
         std::shared_ptr<Profiler> profiler,
         nvrhi::IBindingLayout* bindlessLayout);
 
-    void CreatePipelines(bool useRayQuery);
+    // Loads the shaders and creates the pipelines of all passes. The passes are independent jobs that
+    // run on the executor when one is set, see PipelineJobList.h.
+    // With async, the pipelines are created in the background when there are pipelines to render with
+    // in the meantime, and CommitPipelines makes them live once all of them are ready.
+    void CreatePipelines(bool useRayQuery, bool async = false);
+
+    // Like CreatePipelines, but only for the passes that use one of the shaders, the other passes keep
+    // their pipelines. Creates all pipelines when useRayQuery changed or a build is still running.
+    void ReloadPipelines(const std::unordered_set<std::string>& shaderNames, bool useRayQuery, bool async = false);
+
+    // Swaps in the pipelines of the last CreatePipelines call if they are ready, call between frames.
+    // Returns true if the pipelines changed.
+    bool CommitPipelines();
+
+    [[nodiscard]] bool IsCreatingPipelines() const;
+
+    // Executor used to create the pipelines in parallel, may be null
+    void SetExecutor(tf::Executor* executor);
 
     void CreateBindingSet(
         nvrhi::rt::IAccelStruct* topLevelAS,
@@ -132,36 +164,54 @@ private:
         const RenderSettings& lightingSettings,
         const rtxdi::ImportanceSamplingContext& isContext);
 
-    void CreatePresamplingPipelines();
-    void CreateReSTIRDIPipelines(bool useRayQuery);
-    void CreateReSTIRGIPipelines(bool useRayQuery);
-
     struct ComputePass
     {
         nvrhi::ShaderHandle Shader;
         nvrhi::ComputePipelineHandle Pipeline;
     };
 
-    void CreateComputePass(ComputePass& pass, const char* shaderName, const std::vector<donut::engine::ShaderMacro>& macros);
+    // All pipelines of the lighting passes, replaced as a whole by CommitPipelines
+    struct Pipelines
+    {
+        ComputePass PresampleLights;
+        ComputePass PresampleEnvironmentMap;
+        RayTracingPass GenerateInitialSamples;
+        RayTracingPass TemporalResampling;
+        RayTracingPass SpatialResampling;
+        RayTracingPass ShadeSamples;
+        RayTracingPass BrdfRayTracing;
+        RayTracingPass ShadeSecondarySurfaces;
+        RayTracingPass FusedResampling;
+        RayTracingPass Gradients;
+        RayTracingPass GITemporalResampling;
+        RayTracingPass GISpatialResampling;
+        RayTracingPass GIFusedResampling;
+        RayTracingPass GIFinalShading;
+    };
+
+    // Shaders of the passes to create, all passes when null
+    using ShaderFilter = const std::unordered_set<std::string>*;
+
+    void BuildPipelines(bool useRayQuery, bool async, ShaderFilter filter);
+    void CreatePresamplingPipelines(Pipelines& pipelines, PipelineJobList& jobs, ShaderFilter filter);
+    void CreateReSTIRDIPipelines(Pipelines& pipelines, PipelineJobList& jobs, bool useRayQuery, ShaderFilter filter);
+    void CreateReSTIRGIPipelines(Pipelines& pipelines, PipelineJobList& jobs, bool useRayQuery, ShaderFilter filter);
+    void LogPipelineBuild() const;
+
+    void CreateComputePass(PipelineJobList& jobs, ComputePass& pass, const char* shaderName, const std::vector<donut::engine::ShaderMacro>& macros, ShaderFilter filter);
+    void CreateRayTracingPass(PipelineJobList& jobs, RayTracingPass& pass, const char* shaderName, const std::vector<donut::engine::ShaderMacro>& macros, bool useRayQuery, ShaderFilter filter);
+    [[nodiscard]] PipelineJobLauncher GetPipelineJobLauncher();
+
+    // Returns the specialized pass for the settings once its pipeline is ready, and the generic pass until then.
+    // The first request for a specialization starts creating its pipeline in the background.
+    RayTracingPass& GetResamplingPass(ResamplingShader shader, RayTracingPass& genericPass, const RenderSettings& localSettings, const ResamplingStaticSettings& staticSettings);
+
     void ExecuteComputePass(nvrhi::ICommandList* commandList, ComputePass& pass, const char* passName, dm::int2 dispatchSize, ProfilerSection::Enum profilerSection);
     void ExecuteRayTracingPass(nvrhi::ICommandList* commandList, RayTracingPass& pass, bool enableRayCounts, const char* passName, dm::int2 dispatchSize, ProfilerSection::Enum profilerSection, nvrhi::IBindingSet* extraBindingSet = nullptr);
 
     nvrhi::DeviceHandle m_device;
 
-    ComputePass m_presampleLightsPass;
-    ComputePass m_presampleEnvironmentMapPass;
-    RayTracingPass m_generateInitialSamplesPass;
-    RayTracingPass m_temporalResamplingPass;
-    RayTracingPass m_spatialResamplingPass;
-    RayTracingPass m_shadeSamplesPass;
-    RayTracingPass m_brdfRayTracingPass;
-    RayTracingPass m_shadeSecondarySurfacesPass;
-    RayTracingPass m_fusedResamplingPass;
-    RayTracingPass m_gradientsPass;
-    RayTracingPass m_GITemporalResamplingPass;
-    RayTracingPass m_GISpatialResamplingPass;
-    RayTracingPass m_GIFusedResamplingPass;
-    RayTracingPass m_GIFinalShadingPass;
+    Pipelines m_pipelines;
     nvrhi::BindingLayoutHandle m_bindingLayout;
     nvrhi::BindingLayoutHandle m_bindlessLayout;
     nvrhi::BindingSetHandle m_bindingSet;
@@ -170,6 +220,14 @@ private:
     nvrhi::BufferHandle m_lightReservoirBuffer;
     nvrhi::BufferHandle m_secondarySurfaceBuffer;
     nvrhi::BufferHandle m_GIReservoirBuffer;
+    nvrhi::BufferHandle m_risBuffer;
+    nvrhi::BufferHandle m_risLightDataBuffer;
+    nvrhi::TextureHandle m_diffuseLighting;
+    nvrhi::TextureHandle m_specularLighting;
+    nvrhi::TextureHandle m_temporalSamplePositions;
+    nvrhi::TextureHandle m_gradients;
+    nvrhi::TextureHandle m_restirLuminance;         // bound to m_bindingSet, swapped with it
+    nvrhi::TextureHandle m_prevRestirLuminance;
 
     dm::uint2 m_environmentPdfTextureSize;
     dm::uint2 m_localLightPdfTextureSize;
@@ -178,8 +236,27 @@ private:
     uint32_t m_currentFrameOutputReservoir = 0;
     uint32_t m_currentFrameGIOutputReservoir = 0;
 
-    std::shared_ptr<donut::engine::ShaderFactory> m_shaderFactory;
+    std::shared_ptr<CachedShaderFactory> m_shaderFactory;
+    std::shared_ptr<CachedBindingSetFactory> m_bindingSetFactory;
     std::shared_ptr<donut::engine::CommonRenderPasses> m_commonPasses;
     std::shared_ptr<donut::engine::Scene> m_scene;
     std::shared_ptr<Profiler> m_profiler;
+
+    tf::Executor* m_executor = nullptr;
+    bool m_useRayQuery = false;     // of the last CreatePipelines or ReloadPipelines call
+
+    struct SpecializedPass
+    {
+        const char* shaderName = nullptr;
+        RayTracingPass pass;
+        AsyncPipelineSet<RayTracingPass> builder;
+        bool ready = false;
+        bool failed = false;
+    };
+
+    // By specialization key, the pipeline jobs use the other members, so these are destroyed first as well
+    std::unordered_map<std::string, std::unique_ptr<SpecializedPass>> m_specializedPasses;
+
+    // Last, so that it waits for the running pipeline jobs before the objects they use are destroyed
+    AsyncPipelineSet<Pipelines> m_pipelineBuilder;
 };
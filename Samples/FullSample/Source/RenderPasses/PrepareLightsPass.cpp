@@ -9,16 +9,18 @@
  **************************************************************************/
 
 #include "PrepareLightsPass.h"
+#include "../CachedBindingSetFactory.h"
+#include "../CachedShaderFactory.h"
 #include "../RtxdiResources.h"
 #include "../SampleScene.h"
 
-#include <donut/engine/ShaderFactory.h>
 #include <donut/engine/CommonRenderPasses.h>
 #include <donut/core/log.h>
 #include <nvrhi/utils.h>
 #include <Rtxdi/DI/ReSTIRDI.h>
 
 #include <algorithm>
+#include <unordered_set>
 #include <utility>
 
 using namespace donut::math;
@@ -29,13 +31,15 @@ using namespace donut::engine;
 
 PrepareLightsPass::PrepareLightsPass(
     nvrhi::IDevice* device, 
-    std::shared_ptr<ShaderFactory> shaderFactory, 
+    std::shared_ptr<CachedShaderFactory> shaderFactory, 
+    std::shared_ptr<CachedBindingSetFactory> bindingSetFactory,
     std::shared_ptr<CommonRenderPasses> commonPasses,
     std::shared_ptr<donut::engine::Scene> scene,
     nvrhi::IBindingLayout* bindlessLayout)
     : m_device(device)
     , m_bindlessLayout(bindlessLayout)
     , m_shaderFactory(std::move(shaderFactory))
+    , m_bindingSetFactory(std::move(bindingSetFactory))
     , m_commonPasses(std::move(commonPasses))
     , m_scene(std::move(scene))
 {
@@ -46,6 +50,8 @@ PrepareLightsPass::PrepareLightsPass(
         nvrhi::BindingLayoutItem::StructuredBuffer_UAV(0),
         nvrhi::BindingLayoutItem::TypedBuffer_UAV(1),
         nvrhi::BindingLayoutItem::Texture_UAV(2),
+        nvrhi::BindingLayoutItem::StructuredBuffer_UAV(3),
+        nvrhi::BindingLayoutItem::TypedBuffer_UAV(4),
         nvrhi::BindingLayoutItem::StructuredBuffer_SRV(0),
         nvrhi::BindingLayoutItem::StructuredBuffer_SRV(1),
         nvrhi::BindingLayoutItem::StructuredBuffer_SRV(2),
@@ -77,6 +83,8 @@ void PrepareLightsPass::CreateBindingSet(RtxdiResources& resources)
         nvrhi::BindingSetItem::StructuredBuffer_UAV(0, resources.LightDataBuffer),
         nvrhi::BindingSetItem::TypedBuffer_UAV(1, resources.LightIndexMappingBuffer),
         nvrhi::BindingSetItem::Texture_UAV(2, resources.LocalLightPdfTexture),
+        nvrhi::BindingSetItem::StructuredBuffer_UAV(3, resources.InstancedLightRecordBuffer),
+        nvrhi::BindingSetItem::TypedBuffer_UAV(4, resources.LightRecordIndexBuffer),
         nvrhi::BindingSetItem::StructuredBuffer_SRV(0, resources.TaskBuffer),
         nvrhi::BindingSetItem::StructuredBuffer_SRV(1, resources.PrimitiveLightBuffer),
         nvrhi::BindingSetItem::StructuredBuffer_SRV(2, m_scene->GetInstanceBuffer()),
@@ -85,19 +93,24 @@ void PrepareLightsPass::CreateBindingSet(RtxdiResources& resources)
         nvrhi::BindingSetItem::Sampler(0, m_commonPasses->m_AnisotropicWrapSampler)
     };
 
-    m_bindingSet = m_device->createBindingSet(bindingSetDesc, m_bindingLayout);
+    m_bindingSet = m_bindingSetFactory->CreateBindingSet("PrepareLights", bindingSetDesc, m_bindingLayout);
     m_taskBuffer = resources.TaskBuffer;
     m_primitiveLightBuffer = resources.PrimitiveLightBuffer;
     m_lightIndexMappingBuffer = resources.LightIndexMappingBuffer;
     m_geometryInstanceToLightBuffer = resources.GeometryInstanceToLightBuffer;
     m_localLightPdfTexture = resources.LocalLightPdfTexture;
-    m_maxLightsInBuffer = uint32_t(resources.LightDataBuffer->getDesc().byteSize / (sizeof(PolymorphicLightInfo) * 2));
+    m_maxLightsInBuffer = uint32_t(resources.LightIndexMappingBuffer->getDesc().byteSize / (sizeof(uint32_t) * 2));
+    m_maxStoredLightsInBuffer = uint32_t(resources.LightDataBuffer->getDesc().byteSize / (sizeof(PolymorphicLightInfo) * 2));
+    m_maxRecordsInBuffer = uint32_t(resources.InstancedLightRecordBuffer->getDesc().byteSize / (sizeof(InstancedLightRecord) * 2));
 }
 
-void PrepareLightsPass::CountLightsInScene(uint32_t& numEmissiveMeshes, uint32_t& numEmissiveTriangles)
+void PrepareLightsPass::CountLightsInScene(uint32_t& numEmissiveMeshes, uint32_t& numEmissiveTriangles, uint32_t& numStoredEmissiveTriangles)
 {
     numEmissiveMeshes = 0;
     numEmissiveTriangles = 0;
+    numStoredEmissiveTriangles = 0;
+
+    std::unordered_set<const donut::engine::MeshGeometry*> storedGeometries;
 
     const auto& instances = m_scene->GetSceneGraph()->GetMeshInstances();
     for (const auto& instance : instances)
@@ -108,6 +121,9 @@ void PrepareLightsPass::CountLightsInScene(uint32_t& numEmissiveMeshes, uint32_t
             {
                 numEmissiveMeshes += 1;
                 numEmissiveTriangles += geometry->numIndices / 3;
+
+                if (storedGeometries.insert(geometry.get()).second)
+                    numStoredEmissiveTriangles += geometry->numIndices / 3;
             }
         }
     }
@@ -353,6 +369,8 @@ RTXDI_LightBufferParameters PrepareLightsPass::Process(
     std::vector<PrepareLightsTask> tasks;
     std::vector<PolymorphicLightInfo> primitiveLightInfos;
     uint32_t lightBufferOffset = 0;
+    uint32_t storedLightOffset = 0;
+    std::unordered_map<const donut::engine::MeshGeometry*, uint32_t> geometryStoredLightOffsets; // same keys as CountLightsInScene
     std::vector<uint32_t> geometryInstanceToLight(m_scene->GetSceneGraph()->GetGeometryInstancesCount(), RTXDI_INVALID_LIGHT_INDEX);
 
     const auto& instances = m_scene->GetSceneGraph()->GetMeshInstances();
@@ -385,12 +403,19 @@ RTXDI_LightBufferParameters PrepareLightsPass::Process(
 
             assert(geometryIndex < 0xfff);
 
-            PrepareLightsTask task;
+            PrepareLightsTask task = {};
             task.instanceAndGeometryIndex = (instance->GetInstanceIndex() << 12) | uint32_t(geometryIndex & 0xfff);
             task.lightBufferOffset = lightBufferOffset;
             task.triangleCount = geometry->numIndices / 3;
             task.previousLightBufferOffset = (pOffset != m_instanceLightBufferOffsets.end()) ? int(pOffset->second) : -1;
 
+            // the triangles of a geometry are stored once, by its first instance, and shared by the other ones
+            auto [storedOffset, firstInstance] = geometryStoredLightOffsets.try_emplace(geometry.get(), storedLightOffset);
+            task.storedLightOffset = storedOffset->second;
+            task.storeLights = firstInstance;
+            if (firstInstance)
+                storedLightOffset += task.triangleCount;
+
             // record the current offset of this instance for use on the next frame
             m_instanceLightBufferOffsets[instanceHash] = lightBufferOffset;
 
@@ -423,16 +448,19 @@ RTXDI_LightBufferParameters PrepareLightsPass::Process(
         // find the previous offset of this instance in the light buffer
         auto pOffset = m_primitiveLightBufferOffsets.find(pLight.get());
 
-        PrepareLightsTask task;
+        PrepareLightsTask task = {};
         task.instanceAndGeometryIndex = TASK_PRIMITIVE_LIGHT_BIT | uint32_t(primitiveLightInfos.size());
         task.lightBufferOffset = lightBufferOffset;
         task.triangleCount = 1; // technically zero, but we need to allocate 1 thread in the grid to process this light
         task.previousLightBufferOffset = (pOffset != m_primitiveLightBufferOffsets.end()) ? pOffset->second : -1;
+        task.storedLightOffset = storedLightOffset;
+        task.storeLights = 1;
 
         // record the current offset of this instance for use on the next frame
         m_primitiveLightBufferOffsets[pLight.get()] = lightBufferOffset;
 
         lightBufferOffset += task.triangleCount;
+        storedLightOffset += task.triangleCount;
 
         tasks.push_back(task);
         primitiveLightInfos.push_back(polymorphicLight);
@@ -446,6 +474,9 @@ RTXDI_LightBufferParameters PrepareLightsPass::Process(
     }
 
     assert(numImportanceSampledEnvironmentLights <= 1);
+    assert(lightBufferOffset <= m_maxLightsInBuffer);
+    assert(storedLightOffset <= m_maxStoredLightsInBuffer);
+    assert(tasks.size() <= m_maxRecordsInBuffer);
     
     outLightBufferParams.localLightBufferRegion.numLights += numFinitePrimLights;
     outLightBufferParams.infiniteLightBufferRegion.firstLightIndex = outLightBufferParams.localLightBufferRegion.numLights;
@@ -477,6 +508,8 @@ RTXDI_LightBufferParameters PrepareLightsPass::Process(
     constants.numTasks = uint32_t(tasks.size());
     constants.currentFrameLightOffset = m_maxLightsInBuffer * m_oddFrame;
     constants.previousFrameLightOffset = m_maxLightsInBuffer * !m_oddFrame;
+    constants.currentFrameStoredLightOffset = m_maxStoredLightsInBuffer * m_oddFrame;
+    constants.currentFrameRecordOffset = m_maxRecordsInBuffer * m_oddFrame;
     commandList->setPushConstants(&constants, sizeof(constants));
 
     commandList->dispatch(dm::div_ceil(lightBufferOffset, 256));
@@ -16,15 +16,15 @@
 #include <memory>
 #include <unordered_map>
 
-
 namespace donut::engine
 {
     class CommonRenderPasses;
-    class ShaderFactory;
     class Scene;
     class Light;
 }
 
+class CachedBindingSetFactory;
+class CachedShaderFactory;
 class RtxdiResources;
 
 class PrepareLightsPass
@@ -32,15 +32,23 @@ class PrepareLightsPass
 public:
     PrepareLightsPass(
         nvrhi::IDevice* device,
-        std::shared_ptr<donut::engine::ShaderFactory> shaderFactory,
+        std::shared_ptr<CachedShaderFactory> shaderFactory,
+        std::shared_ptr<CachedBindingSetFactory> bindingSetFactory,
         std::shared_ptr<donut::engine::CommonRenderPasses> commonPasses,
         std::shared_ptr<donut::engine::Scene> scene,
         nvrhi::IBindingLayout* bindlessLayout);
 
     void CreatePipeline();
     void CreateBindingSet(RtxdiResources& resources);
-    void CountLightsInScene(uint32_t& numEmissiveMeshes, uint32_t& numEmissiveTriangles);
-    
+    // numStoredEmissiveTriangles counts the triangles of every emissive geometry once, however many instances it has
+    void CountLightsInScene(uint32_t& numEmissiveMeshes, uint32_t& numEmissiveTriangles, uint32_t& numStoredEmissiveTriangles);
+
+    // Fills the light buffers for the current frame. Every instance triangle has its own light index, as in a flat
+    // light buffer, but the object-space triangles of an emissive geometry are only stored once, by its first instance.
+    // The other instances share them through an InstancedLightRecord with their transform, and RAB_LoadLightInfo moves
+    // the stored triangle into world space. Only the storage is instanced: the local light PDF texture still has one
+    // texel per light index with the world-space flux of that triangle, and there is no two-level (instance, then
+    // triangle) light sampling on the GPU.
     RTXDI_LightBufferParameters Process(
         nvrhi::ICommandList* commandList, 
         const rtxdi::ReSTIRDIContext& context, 
@@ -63,9 +71,12 @@ private:
     nvrhi::TextureHandle m_localLightPdfTexture;
 
     uint32_t m_maxLightsInBuffer;
+    uint32_t m_maxStoredLightsInBuffer;
+    uint32_t m_maxRecordsInBuffer;
     bool m_oddFrame = false;
 
-    std::shared_ptr<donut::engine::ShaderFactory> m_shaderFactory;
+    std::shared_ptr<CachedShaderFactory> m_shaderFactory;
+    std::shared_ptr<CachedBindingSetFactory> m_bindingSetFactory;
     std::shared_ptr<donut::engine::CommonRenderPasses> m_commonPasses;
     std::shared_ptr<donut::engine::Scene> m_scene;
 
@@ -9,6 +9,7 @@
  **************************************************************************/
 
 #include "RayTracingPass.h"
+#include "../CachedShaderFactory.h"
 
 #include <donut/engine/ShaderFactory.h>
 #include <donut/core/math/math.h>
@@ -28,9 +29,25 @@ bool RayTracingPass::Init(
     nvrhi::IBindingLayout* bindingLayout,
     nvrhi::IBindingLayout* extraBindingLayout,
     nvrhi::IBindingLayout* bindlessLayout)
+{
+    CachedShaderFactory uncachedShaderFactory(device, shaderFactory, nullptr, {});
+    if (!LoadShaders(uncachedShaderFactory, shaderName, extraMacros, useRayQuery, computeGroupSize))
+        return false;
+
+    return CreatePipeline(device, bindingLayout, extraBindingLayout, bindlessLayout);
+}
+
+bool RayTracingPass::LoadShaders(
+    CachedShaderFactory& shaderFactory,
+    const char* shaderName,
+    const std::vector<donut::engine::ShaderMacro>& extraMacros,
+    bool useRayQuery,
+    uint32_t computeGroupSize)
 {
     donut::log::debug("Initializing RayTracingPass %s...", shaderName);
 
+    // Drop the objects of the other variant, Execute picks the variant by which pipeline exists
+    *this = RayTracingPass();
     ComputeGroupSize = computeGroupSize;
 
     std::vector<donut::engine::ShaderMacro> macros = { { "USE_RAY_QUERY", "1" } };
@@ -40,9 +57,22 @@ bool RayTracingPass::Init(
     if (useRayQuery)
     {
         ComputeShader = shaderFactory.CreateShader(shaderName, "main", &macros, nvrhi::ShaderType::Compute);
-        if (!ComputeShader)
-            return false;
+        return ComputeShader != nullptr;
+    }
+
+    macros[0].definition = "0"; // USE_RAY_QUERY
+    ShaderLibrary = shaderFactory.CreateShaderLibrary(shaderName, &macros);
+    return ShaderLibrary != nullptr;
+}
 
+bool RayTracingPass::CreatePipeline(
+    nvrhi::IDevice* device,
+    nvrhi::IBindingLayout* bindingLayout,
+    nvrhi::IBindingLayout* extraBindingLayout,
+    nvrhi::IBindingLayout* bindlessLayout)
+{
+    if (ComputeShader)
+    {
         nvrhi::ComputePipelineDesc pipelineDesc;
         pipelineDesc.bindingLayouts = { bindingLayout };
         if (bindlessLayout)
@@ -58,8 +88,6 @@ bool RayTracingPass::Init(
         return true;
     }
 
-    macros[0].definition = "0"; // USE_RAY_QUERY
-    ShaderLibrary = shaderFactory.CreateShaderLibrary(shaderName, &macros);
     if (!ShaderLibrary)
         return false;
 
@@ -18,6 +18,8 @@ namespace donut::engine
     struct ShaderMacro;
 }
 
+class CachedShaderFactory;
+
 
 struct RayTracingPass
 {
@@ -41,6 +43,21 @@ struct RayTracingPass
         nvrhi::IBindingLayout* extraBindingLayout,
         nvrhi::IBindingLayout* bindlessLayout);
 
+    // The two stages of Init. Shader loading goes through the shader factory, pipeline creation only
+    // through the device, so the second stage of several passes can run on different threads.
+    bool LoadShaders(
+        CachedShaderFactory& shaderFactory,
+        const char* shaderName,
+        const std::vector<donut::engine::ShaderMacro>& extraMacros,
+        bool useRayQuery,
+        uint32_t computeGroupSize);
+
+    bool CreatePipeline(
+        nvrhi::IDevice* device,
+        nvrhi::IBindingLayout* bindingLayout,
+        nvrhi::IBindingLayout* extraBindingLayout,
+        nvrhi::IBindingLayout* bindlessLayout);
+
     void Execute(
         nvrhi::ICommandList* commandList,
         int width,
@@ -9,7 +9,7 @@
  **************************************************************************/
 
 #include "RenderEnvironmentMapPass.h"
-#include <donut/engine/ShaderFactory.h>
+#include "../CachedShaderFactory.h"
 #include <nvrhi/utils.h>
 
 #include <donut/core/math/math.h>
@@ -25,7 +25,7 @@ using namespace donut::math;
 
 RenderEnvironmentMapPass::RenderEnvironmentMapPass(
     nvrhi::IDevice* device,
-    std::shared_ptr<donut::engine::ShaderFactory> shaderFactory,
+    std::shared_ptr<CachedShaderFactory> shaderFactory,
     std::shared_ptr<donut::engine::DescriptorTableManager> descriptorTable,
     uint32_t textureWidth)
     : m_descriptorTable(std::move(descriptorTable))
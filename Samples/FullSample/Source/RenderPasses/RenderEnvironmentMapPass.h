@@ -18,7 +18,6 @@ namespace donut::engine
 {
     class DirectionalLight;
     class DescriptorTableManager;
-    class ShaderFactory;
 }
 
 namespace donut::render
@@ -26,12 +25,14 @@ namespace donut::render
     struct SkyParameters;
 }
 
+class CachedShaderFactory;
+
 class RenderEnvironmentMapPass
 {
 public:
     RenderEnvironmentMapPass(
         nvrhi::IDevice* device,
-        std::shared_ptr<donut::engine::ShaderFactory> shaderFactory,
+        std::shared_ptr<CachedShaderFactory> shaderFactory,
         std::shared_ptr<donut::engine::DescriptorTableManager> descriptorTable,
         uint32_t textureWidth);
 
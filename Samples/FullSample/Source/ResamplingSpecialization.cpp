@@ -0,0 +1,179 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "ResamplingSpecialization.h"
+
+#include <algorithm>
+
+namespace
+{
+    enum class SpecializedSetting
+    {
+        DILocalLightSamplingMode,
+        DITemporalBiasCorrection,
+        DISpatialBiasCorrection,
+        DIBoilingFilter,
+        DIDiscardInvisibleSamples,
+        GITemporalBiasCorrection,
+        GISpatialBiasCorrection,
+        GIBoilingFilter
+    };
+
+    struct SpecializedSettingInfo
+    {
+        const char* macro;
+        std::vector<uint32_t> values;   // the values compiled by Shaders.cfg
+    };
+
+    // Uniform, Power RIS, ReGIR RIS
+    const std::vector<uint32_t> c_LocalLightSamplingModes = { 0, 1, 2 };
+    // Off, basic, pairwise, ray traced
+    const std::vector<uint32_t> c_DIBiasCorrectionModes = { 0, 1, 2, 3 };
+    // GI has no pairwise mode
+    const std::vector<uint32_t> c_GIBiasCorrectionModes = { 0, 1, 3 };
+    const std::vector<uint32_t> c_Booleans = { 0, 1 };
+
+    const SpecializedSettingInfo& GetSettingInfo(SpecializedSetting setting)
+    {
+        static const SpecializedSettingInfo c_Settings[] = {
+            { "SPECIALIZE_DI_LOCAL_LIGHT_SAMPLING_MODE", c_LocalLightSamplingModes },
+            { "SPECIALIZE_DI_TEMPORAL_BIAS_CORRECTION", c_DIBiasCorrectionModes },
+            { "SPECIALIZE_DI_SPATIAL_BIAS_CORRECTION", c_DIBiasCorrectionModes },
+            { "SPECIALIZE_DI_BOILING_FILTER", c_Booleans },
+            { "SPECIALIZE_DI_DISCARD_INVISIBLE_SAMPLES", c_Booleans },
+            { "SPECIALIZE_GI_TEMPORAL_BIAS_CORRECTION", c_GIBiasCorrectionModes },
+            { "SPECIALIZE_GI_SPATIAL_BIAS_CORRECTION", c_GIBiasCorrectionModes },
+            { "SPECIALIZE_GI_BOILING_FILTER", c_Booleans }
+        };
+
+        return c_Settings[uint32_t(setting)];
+    }
+
+    uint32_t GetSettingValue(SpecializedSetting setting, const ResamplingStaticSettings& settings)
+    {
+        switch (setting)
+        {
+        case SpecializedSetting::DILocalLightSamplingMode: return settings.diLocalLightSamplingMode;
+        case SpecializedSetting::DITemporalBiasCorrection: return settings.diTemporalBiasCorrection;
+        case SpecializedSetting::DISpatialBiasCorrection: return settings.diSpatialBiasCorrection;
+        case SpecializedSetting::DIBoilingFilter: return settings.diBoilingFilter;
+        case SpecializedSetting::DIDiscardInvisibleSamples: return settings.diDiscardInvisibleSamples;
+        case SpecializedSetting::GITemporalBiasCorrection: return settings.giTemporalBiasCorrection;
+        case SpecializedSetting::GISpatialBiasCorrection: return settings.giSpatialBiasCorrection;
+        case SpecializedSetting::GIBoilingFilter: return settings.giBoilingFilter;
+        }
+        return 0;
+    }
+
+    void SetSettingValue(SpecializedSetting setting, uint32_t value, ResamplingStaticSettings& settings)
+    {
+        switch (setting)
+        {
+        case SpecializedSetting::DILocalLightSamplingMode: settings.diLocalLightSamplingMode = value; break;
+        case SpecializedSetting::DITemporalBiasCorrection: settings.diTemporalBiasCorrection = value; break;
+        case SpecializedSetting::DISpatialBiasCorrection: settings.diSpatialBiasCorrection = value; break;
+        case SpecializedSetting::DIBoilingFilter: settings.diBoilingFilter = value; break;
+        case SpecializedSetting::DIDiscardInvisibleSamples: settings.diDiscardInvisibleSamples = value; break;
+        case SpecializedSetting::GITemporalBiasCorrection: settings.giTemporalBiasCorrection = value; break;
+        case SpecializedSetting::GISpatialBiasCorrection: settings.giSpatialBiasCorrection = value; break;
+        case SpecializedSetting::GIBoilingFilter: settings.giBoilingFilter = value; break;
+        }
+    }
+
+    struct ResamplingShaderInfo
+    {
+        const char* name;
+        bool regirDisabled;     // compiled with RTXDI_REGIR_MODE=RTXDI_REGIR_DISABLED, like the generic permutation
+        std::vector<SpecializedSetting> settings;
+    };
+
+    // The settings each shader reads through ResamplingSpecialization.hlsli
+    const ResamplingShaderInfo& GetShaderInfo(ResamplingShader shader)
+    {
+        static const ResamplingShaderInfo c_Shaders[] = {
+            { "app/LightingPasses/DI/GenerateInitialSamples.hlsl", true,
+                { SpecializedSetting::DILocalLightSamplingMode } },
+            { "app/LightingPasses/DI/TemporalResampling.hlsl", false,
+                { SpecializedSetting::DITemporalBiasCorrection, SpecializedSetting::DIBoilingFilter, SpecializedSetting::DIDiscardInvisibleSamples } },
+            { "app/LightingPasses/DI/SpatialResampling.hlsl", false,
+                { SpecializedSetting::DISpatialBiasCorrection } },
+            { "app/LightingPasses/DI/FusedResampling.hlsl", true,
+                { SpecializedSetting::DILocalLightSamplingMode, SpecializedSetting::DITemporalBiasCorrection, SpecializedSetting::DIBoilingFilter } },
+            { "app/LightingPasses/GI/TemporalResampling.hlsl", false,
+                { SpecializedSetting::GITemporalBiasCorrection, SpecializedSetting::GIBoilingFilter } },
+            { "app/LightingPasses/GI/SpatialResampling.hlsl", false,
+                { SpecializedSetting::GISpatialBiasCorrection } },
+            { "app/LightingPasses/GI/FusedResampling.hlsl", false,
+                { SpecializedSetting::GITemporalBiasCorrection, SpecializedSetting::GIBoilingFilter } }
+        };
+
+        return c_Shaders[uint32_t(shader)];
+    }
+}
+
+const char* GetResamplingShaderName(ResamplingShader shader)
+{
+    return GetShaderInfo(shader).name;
+}
+
+std::vector<ShaderPermutationMacro> GetResamplingSpecializationMacros(ResamplingShader shader, const ResamplingStaticSettings& settings)
+{
+    const ResamplingShaderInfo& info = GetShaderInfo(shader);
+
+    std::vector<ShaderPermutationMacro> macros;
+    if (info.regirDisabled)
+        macros.push_back({ "RTXDI_REGIR_MODE", "RTXDI_REGIR_DISABLED" });
+
+    for (SpecializedSetting setting : info.settings)
+    {
+        const SpecializedSettingInfo& settingInfo = GetSettingInfo(setting);
+        const uint32_t value = GetSettingValue(setting, settings);
+        if (std::find(settingInfo.values.begin(), settingInfo.values.end(), value) == settingInfo.values.end())
+            return {};
+
+        macros.push_back({ settingInfo.macro, std::to_string(value) });
+    }
+
+    std::sort(macros.begin(), macros.end(), [](const ShaderPermutationMacro& a, const ShaderPermutationMacro& b)
+    {
+        return a.name < b.name;
+    });
+    return macros;
+}
+
+std::string GetResamplingSpecializationKey(ResamplingShader shader, const ResamplingStaticSettings& settings)
+{
+    std::vector<ShaderPermutationMacro> macros = GetResamplingSpecializationMacros(shader, settings);
+    if (macros.empty())
+        return std::string();
+
+    macros.push_back({ "USE_RAY_QUERY", "1" });
+    return MakeShaderPermutationKey(GetResamplingShaderName(shader), "main", std::move(macros), 0).GetCanonicalString();
+}
+
+std::vector<ResamplingStaticSettings> EnumerateResamplingSpecializations(ResamplingShader shader)
+{
+    std::vector<ResamplingStaticSettings> combinations = { ResamplingStaticSettings() };
+    for (SpecializedSetting setting : GetShaderInfo(shader).settings)
+    {
+        std::vector<ResamplingStaticSettings> expanded;
+        for (const ResamplingStaticSettings& combination : combinations)
+        {
+            for (uint32_t value : GetSettingInfo(setting).values)
+            {
+                ResamplingStaticSettings settings = combination;
+                SetSettingValue(setting, value, settings);
+                expanded.push_back(settings);
+            }
+        }
+        combinations = std::move(expanded);
+    }
+    return combinations;
+}
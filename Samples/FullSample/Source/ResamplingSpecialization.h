@@ -0,0 +1,70 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include "ShaderPermutationCache.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Specialization of the ReSTIR DI and GI resampling shaders on the settings that select code paths.
+//
+// The resampling shaders read these settings through the accessors of ResamplingSpecialization.hlsli.
+// A specialized permutation defines every setting its shader reads as a SPECIALIZE_* macro, so the
+// compiler removes the branches on them; the generic permutation reads them from the constant buffer.
+// Only the settings a shader reads are part of its macros, so changing the other settings selects the
+// same permutation. Specialized permutations exist for the compute (ray query) variants only, and only
+// for the values that Shaders.cfg compiles: settings with other values use the generic kernel.
+//
+// The macros of a specialization and its key are pure functions of the settings, and the key is the
+// canonical ShaderPermutationKey of the compute permutation, so it stays valid across runs.
+//
+// The module has no dependencies on the renderer.
+
+enum class ResamplingShader : uint32_t
+{
+    DIGenerateInitialSamples,
+    DITemporalResampling,
+    DISpatialResampling,
+    DIFusedResampling,
+    GITemporalResampling,
+    GISpatialResampling,
+    GIFusedResampling,
+
+    Count
+};
+
+// Copies of the ReSTIR DI and GI parameters that have specialized values, as their numeric values
+struct ResamplingStaticSettings
+{
+    uint32_t diLocalLightSamplingMode = 0;
+    uint32_t diTemporalBiasCorrection = 0;
+    uint32_t diSpatialBiasCorrection = 0;
+    uint32_t diBoilingFilter = 0;
+    uint32_t diDiscardInvisibleSamples = 0;
+    uint32_t giTemporalBiasCorrection = 0;
+    uint32_t giSpatialBiasCorrection = 0;
+    uint32_t giBoilingFilter = 0;
+};
+
+// Shader name for the application shader factory, like "app/LightingPasses/DI/TemporalResampling.hlsl"
+const char* GetResamplingShaderName(ResamplingShader shader);
+
+// Macros of the specialized permutation besides USE_RAY_QUERY, sorted by name.
+// Empty when the permutation for the settings is not compiled.
+std::vector<ShaderPermutationMacro> GetResamplingSpecializationMacros(ResamplingShader shader, const ResamplingStaticSettings& settings);
+
+// Canonical key of the specialized compute permutation, empty when it is not compiled
+std::string GetResamplingSpecializationKey(ResamplingShader shader, const ResamplingStaticSettings& settings);
+
+// Every combination of the compiled values of the settings the shader reads, with the other settings at 0
+std::vector<ResamplingStaticSettings> EnumerateResamplingSpecializations(ResamplingShader shader);
@@ -24,12 +24,14 @@ RtxdiResources::RtxdiResources(
     const rtxdi::RISBufferSegmentAllocator& risBufferSegmentAllocator,
     uint32_t maxEmissiveMeshes,
     uint32_t maxEmissiveTriangles,
+    uint32_t maxStoredEmissiveTriangles,
     uint32_t maxPrimitiveLights,
     uint32_t maxGeometryInstances,
     uint32_t environmentMapWidth,
     uint32_t environmentMapHeight)
     : m_maxEmissiveMeshes(maxEmissiveMeshes)
     , m_maxEmissiveTriangles(maxEmissiveTriangles)
+    , m_maxStoredEmissiveTriangles(maxStoredEmissiveTriangles)
     , m_maxPrimitiveLights(maxPrimitiveLights)
     , m_maxGeometryInstances(maxGeometryInstances)
 {
@@ -72,8 +74,10 @@ RtxdiResources::RtxdiResources(
     uint32_t maxLocalLights = maxEmissiveTriangles + maxPrimitiveLights;
     uint32_t lightBufferElements = maxLocalLights * 2;
 
+    // The light indices cover every instance triangle, but the triangles are only stored once per geometry,
+    // see PrepareLightsPass::Process
     nvrhi::BufferDesc lightBufferDesc;
-    lightBufferDesc.byteSize = sizeof(PolymorphicLightInfo) * lightBufferElements;
+    lightBufferDesc.byteSize = sizeof(PolymorphicLightInfo) * (maxStoredEmissiveTriangles + maxPrimitiveLights) * 2;
     lightBufferDesc.structStride = sizeof(PolymorphicLightInfo);
     lightBufferDesc.initialState = nvrhi::ResourceStates::ShaderResource;
     lightBufferDesc.keepInitialState = true;
@@ -82,6 +86,27 @@ RtxdiResources::RtxdiResources(
     LightDataBuffer = device->createBuffer(lightBufferDesc);
 
 
+    nvrhi::BufferDesc instancedLightRecordBufferDesc;
+    instancedLightRecordBufferDesc.byteSize = sizeof(InstancedLightRecord) * (maxEmissiveMeshes + maxPrimitiveLights) * 2;
+    instancedLightRecordBufferDesc.structStride = sizeof(InstancedLightRecord);
+    instancedLightRecordBufferDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+    instancedLightRecordBufferDesc.keepInitialState = true;
+    instancedLightRecordBufferDesc.debugName = "InstancedLightRecordBuffer";
+    instancedLightRecordBufferDesc.canHaveUAVs = true;
+    InstancedLightRecordBuffer = device->createBuffer(instancedLightRecordBufferDesc);
+
+
+    nvrhi::BufferDesc lightRecordIndexBufferDesc;
+    lightRecordIndexBufferDesc.byteSize = sizeof(uint32_t) * 2 * lightBufferElements;
+    lightRecordIndexBufferDesc.format = nvrhi::Format::RG32_UINT;
+    lightRecordIndexBufferDesc.canHaveTypedViews = true;
+    lightRecordIndexBufferDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+    lightRecordIndexBufferDesc.keepInitialState = true;
+    lightRecordIndexBufferDesc.debugName = "LightRecordIndexBuffer";
+    lightRecordIndexBufferDesc.canHaveUAVs = true;
+    LightRecordIndexBuffer = device->createBuffer(lightRecordIndexBufferDesc);
+
+
     nvrhi::BufferDesc geometryInstanceToLightBufferDesc;
     geometryInstanceToLightBufferDesc.byteSize = sizeof(uint32_t) * maxGeometryInstances;
     geometryInstanceToLightBufferDesc.structStride = sizeof(uint32_t);
@@ -188,6 +213,11 @@ uint32_t RtxdiResources::GetMaxEmissiveTriangles() const
     return m_maxEmissiveTriangles;
 }
 
+uint32_t RtxdiResources::GetMaxStoredEmissiveTriangles() const
+{
+    return m_maxStoredEmissiveTriangles;
+}
+
 uint32_t RtxdiResources::GetMaxPrimitiveLights() const
 {
     return m_maxPrimitiveLights;
@@ -25,6 +25,8 @@ public:
     nvrhi::BufferHandle TaskBuffer;
     nvrhi::BufferHandle PrimitiveLightBuffer;
     nvrhi::BufferHandle LightDataBuffer;
+    nvrhi::BufferHandle InstancedLightRecordBuffer;
+    nvrhi::BufferHandle LightRecordIndexBuffer;
     nvrhi::BufferHandle GeometryInstanceToLightBuffer;
     nvrhi::BufferHandle LightIndexMappingBuffer;
     nvrhi::BufferHandle RisBuffer;
@@ -42,6 +44,7 @@ public:
         const rtxdi::RISBufferSegmentAllocator& risBufferSegmentAllocator,
         uint32_t maxEmissiveMeshes,
         uint32_t maxEmissiveTriangles,
+        uint32_t maxStoredEmissiveTriangles,
         uint32_t maxPrimitiveLights,
         uint32_t maxGeometryInstances,
         uint32_t environmentMapWidth,
@@ -51,6 +54,7 @@ public:
 
     uint32_t GetMaxEmissiveMeshes() const;
     uint32_t GetMaxEmissiveTriangles() const;
+    uint32_t GetMaxStoredEmissiveTriangles() const;
     uint32_t GetMaxPrimitiveLights() const;
     uint32_t GetMaxGeometryInstances() const;
 
@@ -58,6 +62,7 @@ private:
     bool m_neighborOffsetsInitialized = false;
     uint32_t m_maxEmissiveMeshes = 0;
     uint32_t m_maxEmissiveTriangles = 0;
+    uint32_t m_maxStoredEmissiveTriangles = 0;
     uint32_t m_maxPrimitiveLights = 0;
     uint32_t m_maxGeometryInstances = 0;
 };
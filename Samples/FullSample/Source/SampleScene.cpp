@@ -10,12 +10,23 @@
 
 #include "SampleScene.h"
 #include <donut/core/json.h>
+#include <donut/core/log.h>
 #include <donut/core/vfs/VFS.h>
+#include <json/reader.h>
 #include <json/value.h>
 #include <nvrhi/utils.h>
 #include <nvrhi/common/misc.h>
 
 #include "donut/engine/TextureCache.h"
+#ifdef DONUT_WITH_TASKFLOW
+#include <taskflow/taskflow.hpp>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
 
 
 using namespace donut;
@@ -193,8 +204,31 @@ std::shared_ptr<donut::engine::MeshInfo> SampleSceneTypeFactory::CreateMesh()
 
 bool SampleScene::LoadWithExecutor(const std::filesystem::path& jsonFileName, tf::Executor* executor)
 {
-    if (!Scene::LoadWithExecutor(jsonFileName, executor))
-        return false;
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    m_loadedFromCache = false;
+    m_animationEvaluatorValid = false;
+    std::filesystem::path cacheFileName;
+    uint64_t sourceHash = 0;
+
+    if (!m_sceneCacheDirectory.empty())
+    {
+        cacheFileName = m_sceneCacheDirectory / (jsonFileName.filename().string() + ".cache");
+        sourceHash = HashSceneSources(jsonFileName);
+        m_loadedFromCache = LoadSceneCache(cacheFileName, sourceHash);
+    }
+
+    if (!m_loadedFromCache)
+    {
+        if (!Scene::LoadWithExecutor(jsonFileName, executor))
+            return false;
+
+        if (!cacheFileName.empty())
+            WriteSceneCache(cacheFileName, sourceHash);
+    }
+
+    const auto loadTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    log::info("Loaded %s %sin %.3f s", jsonFileName.generic_string().c_str(), m_loadedFromCache ? "from the scene cache " : "", loadTime);
     
     for (const auto& animation : GetSceneGraph()->GetAnimations())
     {
@@ -244,21 +278,33 @@ const donut::engine::PerspectiveCamera* SampleScene::GetBenchmarkCamera() const
     return m_benchmarkCamera.get();
 }
 
-inline uint64_t AdvanceHeapPtr(uint64_t& heapPtr, const nvrhi::MemoryRequirements& memReq)
+static void RecordBlasBuild(nvrhi::ICommandList* commandList, engine::MeshInfo& mesh, nvrhi::rt::IAccelStruct* as)
 {
-    heapPtr = nvrhi::align(heapPtr, memReq.alignment);
-    uint64_t current = heapPtr;
-
-    heapPtr += memReq.size;
+    // Get the desc from the AS, restore the buffer pointers because they're erased by nvrhi
+    nvrhi::rt::AccelStructDesc blasDesc = as->getDesc();
+    for (auto& geometryDesc : blasDesc.bottomLevelGeometries)
+    {
+        geometryDesc.geometryData.triangles.indexBuffer = mesh.buffers->indexBuffer;
+        geometryDesc.geometryData.triangles.vertexBuffer = mesh.buffers->vertexBuffer;
+    }
 
-    return current;
+    nvrhi::utils::BuildBottomLevelAccelStruct(commandList, as, blasDesc);
 }
 
-void SampleScene::BuildMeshBLASes(nvrhi::IDevice* device)
+void SampleScene::BuildMeshBLASes(nvrhi::IDevice* device, const BlasBuildPlannerSettings& buildSettings, bool compactStaticBLASes)
 {
     assert(device->queryFeatureSupport(nvrhi::Feature::VirtualResources));
 
-    uint64_t heapSize = 0;
+    // Acceleration structures that are placed in the shared heap
+    std::vector<nvrhi::rt::IAccelStruct*> heapAccelStructs;
+
+    m_staticBlasMemory = 0;
+    m_compactStaticBLASes = compactStaticBLASes;
+    m_uncompactedBlasMeshes.clear();
+
+    std::vector<PendingBlas> skinnedBlases;
+    std::vector<PendingBlas> staticBlases;
+    std::vector<BlasBuildRequest> staticBuildRequests;
 
     for (const auto& mesh : GetSceneGraph()->GetMeshes())
     {
@@ -267,7 +313,11 @@ void SampleScene::BuildMeshBLASes(nvrhi::IDevice* device)
 
         nvrhi::rt::AccelStructDesc blasDesc;
         blasDesc.isTopLevel = false;
-        blasDesc.isVirtual = true;
+
+        // Compacted BLAS'es get a new buffer from nvrhi, so they can't live in the shared heap
+        blasDesc.isVirtual = mesh->skinPrototype || !compactStaticBLASes;
+
+        uint64_t triangleCount = 0;
 
         for (const auto& geometry : mesh->geometries)
         {
@@ -287,6 +337,8 @@ void SampleScene::BuildMeshBLASes(nvrhi::IDevice* device)
                 ? nvrhi::rt::GeometryFlags::Opaque
                 : nvrhi::rt::GeometryFlags::None;
             blasDesc.bottomLevelGeometries.push_back(geometryDesc);
+
+            triangleCount += geometry->numIndices / 3;
         }
 
         blasDesc.buildFlags = nvrhi::rt::AccelStructBuildFlags::PreferFastTrace;
@@ -295,13 +347,21 @@ void SampleScene::BuildMeshBLASes(nvrhi::IDevice* device)
             // Only allow compaction on non-skinned, static meshes.
             blasDesc.buildFlags = blasDesc.buildFlags | nvrhi::rt::AccelStructBuildFlags::AllowCompaction;
         }
+        else
+        {
+            // Skinned meshes can be refit instead of rebuilt, see SkinnedBlasRefitPolicy.
+            blasDesc.buildFlags = blasDesc.buildFlags | nvrhi::rt::AccelStructBuildFlags::AllowUpdate;
+        }
 
         blasDesc.trackLiveness = false;
         blasDesc.debugName = mesh->name;
 
         nvrhi::rt::AccelStructHandle as = device->createAccelStruct(blasDesc);
         
-        AdvanceHeapPtr(heapSize, device->getAccelStructMemoryRequirements(as));
+        const nvrhi::MemoryRequirements memReq = device->getAccelStructMemoryRequirements(as);
+
+        if (blasDesc.isVirtual)
+            heapAccelStructs.push_back(as);
 
         // If this is a skinned mesh, create a second BLAS to toggle with the first one on every frame.
         // RTXDI needs access to the previous frame geometry in order to be unbiased.
@@ -310,11 +370,25 @@ void SampleScene::BuildMeshBLASes(nvrhi::IDevice* device)
             auto sampleMesh = dynamic_cast<SampleMesh*>(mesh.get());
             assert(sampleMesh);
             sampleMesh->prevAccelStruct = device->createAccelStruct(blasDesc);
-            AdvanceHeapPtr(heapSize, device->getAccelStructMemoryRequirements(as));
+            heapAccelStructs.push_back(sampleMesh->prevAccelStruct);
+
+            // Skinned BLAS'es are swapped and rebuilt every frame, so they must exist from the start
+            mesh->accelStruct = as;
+            skinnedBlases.push_back({ mesh.get(), as });
         }
+        else
+        {
+            // nvrhi doesn't report the scratch size of a build, use the size of the result as an estimate
+            BlasBuildRequest& request = staticBuildRequests.emplace_back();
+            request.scratchSize = memReq.size;
+            request.cost = triangleCount;
 
-        mesh->accelStruct = as;
+            staticBlases.push_back({ mesh.get(), as });
+            m_staticBlasMemory += memReq.size;
+        }
     }
+
+    m_tlasInstanceCacheValid = false;
     
     nvrhi::rt::AccelStructDesc tlasDesc;
     tlasDesc.isTopLevel = true;
@@ -324,84 +398,175 @@ void SampleScene::BuildMeshBLASes(nvrhi::IDevice* device)
     tlasDesc.buildFlags = nvrhi::rt::AccelStructBuildFlags::AllowUpdate;
 
     m_topLevelAS = device->createAccelStruct(tlasDesc);
-
-    AdvanceHeapPtr(heapSize, device->getAccelStructMemoryRequirements(m_topLevelAS));
+    heapAccelStructs.push_back(m_topLevelAS);
         
     tlasDesc.debugName = "PrevTopLevelAS";
 
     m_prevTopLevelAS = device->createAccelStruct(tlasDesc);
+    heapAccelStructs.push_back(m_prevTopLevelAS);
 
-    AdvanceHeapPtr(heapSize, device->getAccelStructMemoryRequirements(m_prevTopLevelAS));
+    std::vector<HeapLayoutRequest> heapRequests;
+    for (nvrhi::rt::IAccelStruct* as : heapAccelStructs)
+    {
+        const nvrhi::MemoryRequirements memReq = device->getAccelStructMemoryRequirements(as);
+        heapRequests.push_back({ memReq.size, memReq.alignment });
+    }
 
+    const HeapLayout heapLayout = PlanHeapLayout(heapRequests);
+    m_accelStructHeapSize = heapLayout.size;
 
     nvrhi::HeapDesc heapDecs;
     heapDecs.type = nvrhi::HeapType::DeviceLocal;
-    heapDecs.capacity = heapSize;
+    heapDecs.capacity = heapLayout.size;
     heapDecs.debugName = "AccelStructHeap";
 
     nvrhi::HeapHandle heap = device->createHeap(heapDecs);
 
-    heapSize = 0;
+    for (size_t index = 0; index < heapAccelStructs.size(); index++)
+        device->bindAccelStructMemory(heapAccelStructs[index], heap, heapLayout.offsets[index]);
 
-    for (const auto& mesh : GetSceneGraph()->GetMeshes())
+
+    // Plan the static builds so that no batch needs more scratch memory than the budget
+    m_pendingBlasBatches.clear();
+    m_nextBlasBatch = 0;
+    for (const BlasBuildBatch& batch : PlanBlasBuildBatches(staticBuildRequests, buildSettings))
     {
-        if (!mesh->accelStruct)
-            continue;
+        std::vector<PendingBlas>& pendingBatch = m_pendingBlasBatches.emplace_back();
+        for (uint32_t request : batch.requests)
+            pendingBatch.push_back(staticBlases[request]);
+    }
 
-        uint64_t heapOffset = AdvanceHeapPtr(heapSize, device->getAccelStructMemoryRequirements(mesh->accelStruct));
+    nvrhi::CommandListParameters clparams;
+    // One chunk covers a whole batch. The limit stays at the default because the scratch sizes are only estimates.
+    clparams.scratchChunkSize = std::min(size_t(buildSettings.scratchBudget), clparams.scratchMaxMemory);
 
-        device->bindAccelStructMemory(mesh->accelStruct, heap, heapOffset);
+    nvrhi::CommandListHandle commandList = device->createCommandList(clparams);
+    commandList->open();
 
-        // Bind memory for the second BLAS for skinned meshes.
-        if (mesh->skinPrototype)
+    for (const PendingBlas& blas : skinnedBlases)
+        RecordBlasBuild(commandList, *blas.mesh, blas.accelStruct);
+
+    commandList->close();
+    device->executeCommandList(commandList);
+
+    if (!buildSettings.progressive)
+    {
+        // Build the batches one at a time, waiting in between so that the scratch memory is recycled
+        while (GetPendingBLASBatchCount() > 0)
         {
-            auto sampleMesh = dynamic_cast<SampleMesh*>(mesh.get());
-            assert(sampleMesh);
+            device->waitForIdle();
 
-            heapOffset = AdvanceHeapPtr(heapSize, device->getAccelStructMemoryRequirements(sampleMesh->prevAccelStruct));
-            device->bindAccelStructMemory(sampleMesh->prevAccelStruct, heap, heapOffset);
+            commandList->open();
+            BuildPendingBLASes(commandList);
+            commandList->close();
+            device->executeCommandList(commandList);
         }
     }
 
-    uint64_t heapOffset = AdvanceHeapPtr(heapSize, device->getAccelStructMemoryRequirements(m_topLevelAS));
+    device->waitForIdle();
+    device->runGarbageCollection();
+}
 
-    device->bindAccelStructMemory(m_topLevelAS, heap, heapOffset);
+bool SampleScene::BuildPendingBLASes(nvrhi::ICommandList* commandList)
+{
+    if (m_nextBlasBatch >= m_pendingBlasBatches.size())
+        return false;
 
-    heapOffset = AdvanceHeapPtr(heapSize, device->getAccelStructMemoryRequirements(m_prevTopLevelAS));
+    commandList->beginMarker("Progressive BLAS Builds");
 
-    device->bindAccelStructMemory(m_prevTopLevelAS, heap, heapOffset);
+    for (const PendingBlas& blas : m_pendingBlasBatches[m_nextBlasBatch])
+    {
+        RecordBlasBuild(commandList, *blas.mesh, blas.accelStruct);
 
+        // The TLAS picks the mesh up from here on
+        blas.mesh->accelStruct = blas.accelStruct;
 
-    nvrhi::CommandListParameters clparams;
-    clparams.scratchChunkSize = clparams.scratchMaxMemory;
+        if (m_compactStaticBLASes)
+            m_uncompactedBlasMeshes.push_back(blas.mesh);
+    }
 
-    nvrhi::CommandListHandle commandList = device->createCommandList(clparams);
-    commandList->open();
+    commandList->endMarker();
+
+    m_nextBlasBatch++;
+    if (m_nextBlasBatch == m_pendingBlasBatches.size())
+    {
+        m_pendingBlasBatches.clear();
+        m_nextBlasBatch = 0;
+    }
+
+    m_tlasInstanceCacheValid = false;
+    return true;
+}
+
+size_t SampleScene::GetPendingBLASBatchCount() const
+{
+    return m_pendingBlasBatches.size() - m_nextBlasBatch;
+}
+
+bool SampleScene::UpdateCompactedBLASes()
+{
+    const size_t uncompactedCount = m_uncompactedBlasMeshes.size();
+    m_uncompactedBlasMeshes.erase(std::remove_if(m_uncompactedBlasMeshes.begin(), m_uncompactedBlasMeshes.end(),
+        [](const engine::MeshInfo* mesh) { return mesh->accelStruct->isCompacted(); }), m_uncompactedBlasMeshes.end());
+
+    if (m_uncompactedBlasMeshes.size() == uncompactedCount)
+        return false;
+
+    // The instances keep pointing at the same objects, but their device addresses changed
+    m_canUpdateTLAS = false;
+    m_canUpdatePrevTLAS = false;
+    return true;
+}
+
+BlasMemoryStats SampleScene::GetBlasMemoryStats() const
+{
+    BlasMemoryStats stats;
+    stats.accelStructHeapSize = m_accelStructHeapSize;
+    stats.staticBlasMemory = m_staticBlasMemory;
 
     for (const auto& mesh : GetSceneGraph()->GetMeshes())
     {
-        if (!mesh->accelStruct)
+        if (mesh->skinPrototype || !mesh->accelStruct)
             continue;
 
-        // Get the desc from the AS, restore the buffer pointers because they're erased by nvrhi
-        nvrhi::rt::AccelStructDesc blasDesc = mesh->accelStruct->getDesc();
-        for (auto& geometryDesc : blasDesc.bottomLevelGeometries)
-        {
-            geometryDesc.geometryData.triangles.indexBuffer = mesh->buffers->indexBuffer;
-            geometryDesc.geometryData.triangles.vertexBuffer = mesh->buffers->vertexBuffer;
-        }
+        stats.builtStaticBlases++;
+        if (mesh->accelStruct->isCompacted())
+            stats.compactedStaticBlases++;
+    }
+
+    for (const auto& batch : m_pendingBlasBatches)
+        stats.pendingStaticBlases += batch.size();
+
+    return stats;
+}
+
+static SkinnedBlasBounds GetSkinnedInstanceBounds(const engine::SkinnedMeshInstance& skinnedInstance)
+{
+    // The joint positions in the space of the instance are a cheap estimate of the skinned vertex bounds
+    affine3 worldToInstance = affine3::identity();
+    if (skinnedInstance.GetNode())
+        worldToInstance = inverse(skinnedInstance.GetNode()->GetLocalToWorldTransformFloat());
 
-        nvrhi::utils::BuildBottomLevelAccelStruct(commandList, mesh->accelStruct, blasDesc);
+    box3 bounds = box3::empty();
+    for (const auto& joint : skinnedInstance.joints)
+    {
+        if (joint.node)
+            bounds |= worldToInstance.transformPoint(joint.node->GetLocalToWorldTransformFloat().m_translation);
     }
 
-    commandList->close();
-    device->executeCommandList(commandList);
+    SkinnedBlasBounds result;
+    if (bounds.isempty())
+        return result;
 
-    device->waitForIdle();
-    device->runGarbageCollection();
+    for (int axis = 0; axis < 3; axis++)
+    {
+        result.minimum[axis] = bounds.m_mins[axis];
+        result.maximum[axis] = bounds.m_maxs[axis];
+    }
+    return result;
 }
 
-void SampleScene::UpdateSkinnedMeshBLASes(nvrhi::ICommandList* commandList, uint32_t frameIndex)
+void SampleScene::UpdateSkinnedMeshBLASes(nvrhi::ICommandList* commandList, uint32_t frameIndex, const SkinnedBlasRefitSettings& refitSettings)
 {
     commandList->beginMarker("Skinned BLAS Updates");
 
@@ -415,49 +580,82 @@ void SampleScene::UpdateSkinnedMeshBLASes(nvrhi::ICommandList* commandList, uint
         assert(sampleMesh);
         assert(sampleMesh->prevAccelStruct);
         std::swap(sampleMesh->accelStruct, sampleMesh->prevAccelStruct);
+        sampleMesh->accelStructSlot ^= 1;
 
         commandList->setAccelStructState(skinnedInstance->GetMesh()->accelStruct, nvrhi::ResourceStates::AccelStructWrite);
         commandList->setBufferState(skinnedInstance->GetMesh()->buffers->vertexBuffer, nvrhi::ResourceStates::AccelStructBuildInput);
     }
     commandList->commitBarriers();
 
-    // Now build the BLAS'es
+    // Now build or refit the BLAS'es. A refit updates the BLAS in place from the pose it had two frames ago.
     for (const auto& skinnedInstance : GetSceneGraph()->GetSkinnedMeshInstances())
     {
         if (skinnedInstance->GetLastUpdateFrameIndex() < frameIndex)
             continue;
 
-        const auto& mesh = skinnedInstance->GetMesh();
-        nvrhi::rt::AccelStructDesc blasDesc = mesh->accelStruct->getDesc();
+        auto sampleMesh = static_cast<SampleMesh*>(skinnedInstance->GetMesh().get());
+        SkinnedBlasRefitPolicy& refitPolicy = sampleMesh->refitPolicies[sampleMesh->accelStructSlot];
+
+        nvrhi::rt::AccelStructDesc blasDesc = sampleMesh->accelStruct->getDesc();
         for (auto& geometryDesc : blasDesc.bottomLevelGeometries)
         {
-            geometryDesc.geometryData.triangles.indexBuffer = mesh->buffers->indexBuffer;
-            geometryDesc.geometryData.triangles.vertexBuffer = mesh->buffers->vertexBuffer;
+            geometryDesc.geometryData.triangles.indexBuffer = sampleMesh->buffers->indexBuffer;
+            geometryDesc.geometryData.triangles.vertexBuffer = sampleMesh->buffers->vertexBuffer;
         }
 
-        nvrhi::utils::BuildBottomLevelAccelStruct(commandList, mesh->accelStruct, blasDesc);
+        if (refitPolicy.Update(GetSkinnedInstanceBounds(*skinnedInstance), refitSettings) == SkinnedBlasUpdate::Refit)
+            blasDesc.buildFlags = blasDesc.buildFlags | nvrhi::rt::AccelStructBuildFlags::PerformUpdate;
+
+        commandList->buildBottomLevelAccelStruct(sampleMesh->accelStruct, blasDesc.bottomLevelGeometries.data(),
+            blasDesc.bottomLevelGeometries.size(), blasDesc.buildFlags);
     }
     commandList->endMarker();
 }
 
-void SampleScene::BuildTopLevelAccelStruct(nvrhi::ICommandList* commandList)
+void SampleScene::GetSkinnedBlasStats(std::vector<SkinnedBlasStats>& stats) const
 {
-    m_tlasInstances.resize(GetSceneGraph()->GetMeshInstances().size());
+    stats.clear();
 
-    nvrhi::rt::AccelStructBuildFlags buildFlags = m_canUpdateTLAS
-        ? nvrhi::rt::AccelStructBuildFlags::PerformUpdate
-        : nvrhi::rt::AccelStructBuildFlags::None;
-    
-    uint32_t index = 0;
+    for (const auto& skinnedInstance : GetSceneGraph()->GetSkinnedMeshInstances())
+    {
+        auto sampleMesh = dynamic_cast<const SampleMesh*>(skinnedInstance->GetMesh().get());
+        if (!sampleMesh)
+            continue;
+
+        SkinnedBlasStats& meshStats = stats.emplace_back();
+        meshStats.name = sampleMesh->name;
+
+        for (const SkinnedBlasRefitPolicy& refitPolicy : sampleMesh->refitPolicies)
+        {
+            meshStats.refits += refitPolicy.GetRefitCount();
+            meshStats.rebuilds += refitPolicy.GetRebuildCount();
+            meshStats.boundsGrowth = std::max(meshStats.boundsGrowth, refitPolicy.GetBoundsGrowth());
+        }
+    }
+}
+
+void SampleScene::SetExecutor(tf::Executor* executor)
+{
+    m_executor = executor;
+}
+
+void SampleScene::BuildTlasInstanceCache()
+{
+    const auto& meshInstances = GetSceneGraph()->GetMeshInstances();
 
-    for (const auto& instance : GetSceneGraph()->GetMeshInstances())
+    m_tlasInstances.clear();
+    m_tlasInstances.reserve(meshInstances.size());
+    m_tlasInstanceSources.clear();
+    m_tlasInstanceSources.reserve(meshInstances.size());
+
+    for (const auto& instance : meshInstances)
     {
         const auto& mesh = instance->GetMesh();
         
         if (!mesh->accelStruct)
             continue;
 
-        nvrhi::rt::InstanceDesc& instanceDesc = m_tlasInstances[index++];
+        nvrhi::rt::InstanceDesc& instanceDesc = m_tlasInstances.emplace_back();
 
         instanceDesc.instanceMask = 0;
         engine::SceneContentFlags contentFlags = instance->GetContentFlags();
@@ -484,8 +682,120 @@ void SampleScene::BuildTopLevelAccelStruct(nvrhi::ICommandList* commandList)
             dm::affineToColumnMajor(node->GetLocalToWorldTransformFloat(), instanceDesc.transform);
 
         instanceDesc.instanceID = uint(instance->GetInstanceIndex());
+
+        m_tlasInstanceSources.push_back(instance.get());
+    }
+
+    m_tlasInstanceCacheSourceCount = meshInstances.size();
+    m_tlasInstanceCacheValid = true;
+
+    // The instance list changed, so neither TLAS can be updated in place
+    m_canUpdateTLAS = false;
+    m_canUpdatePrevTLAS = false;
+}
+
+// Any node can move after loading, through an animation channel or a direct SetTransform, so the transform
+// and BLAS of every cached descriptor are rewritten from the scene graph. The mask, flags and instance ID
+// are kept from BuildTlasInstanceCache.
+void SampleScene::UpdateTlasInstances()
+{
+    auto updateRange = [this](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const engine::MeshInstance* instance = m_tlasInstanceSources[i];
+            nvrhi::rt::InstanceDesc& instanceDesc = m_tlasInstances[i];
+
+            instanceDesc.bottomLevelAS = instance->GetMesh()->accelStruct;
+
+            auto node = instance->GetNode();
+            if (node)
+                dm::affineToColumnMajor(node->GetLocalToWorldTransformFloat(), instanceDesc.transform);
+        }
+    };
+
+    const size_t count = m_tlasInstances.size();
+
+#ifdef DONUT_WITH_TASKFLOW
+    // Small batches are not worth the scheduling overhead
+    constexpr size_t chunkSize = 2048;
+    if (m_executor && count > chunkSize)
+    {
+        const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+        tf::Taskflow taskflow;
+        taskflow.for_each_index(size_t(0), chunkCount, size_t(1), [&updateRange, count](size_t chunk)
+        {
+            updateRange(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+        });
+        m_executor->run(taskflow).wait();
+        return;
+    }
+#endif
+
+    updateRange(0, count);
+}
+
+static InstanceBounds GetInstanceBounds(const engine::MeshInstance& instance)
+{
+    const auto node = instance.GetNode();
+    if (!node)
+        return InstanceBounds::Empty();
+
+    const box3 bounds = node->GetGlobalBoundingBox();
+    if (bounds.isempty())
+        return InstanceBounds::Empty();
+
+    InstanceBounds result;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        result.minimum[axis] = bounds.m_mins[axis];
+        result.maximum[axis] = bounds.m_maxs[axis];
+    }
+    return result;
+}
+
+void SampleScene::UpdateInstanceBvh()
+{
+    const auto& meshInstances = GetSceneGraph()->GetMeshInstances();
+
+    if (!m_instanceBvhValid || m_instanceBvh.GetInstanceCount() != meshInstances.size())
+    {
+        std::vector<InstanceBounds> bounds;
+        bounds.reserve(meshInstances.size());
+
+        for (const auto& instance : meshInstances)
+            bounds.push_back(GetInstanceBounds(*instance));
+
+        m_instanceBvh.Build(bounds);
+        m_instanceBvhValid = true;
+        return;
     }
 
+    // Every instance is checked for the same reason as in UpdateTlasInstances. SetInstanceBounds only marks
+    // the boxes that moved, and Refit does nothing when none did.
+    for (uint32_t index = 0; index < uint32_t(meshInstances.size()); index++)
+        m_instanceBvh.SetInstanceBounds(index, GetInstanceBounds(*meshInstances[index]));
+
+    m_instanceBvh.Refit();
+}
+
+const SceneInstanceBvh& SampleScene::GetInstanceBvh() const
+{
+    return m_instanceBvh;
+}
+
+void SampleScene::BuildTopLevelAccelStruct(nvrhi::ICommandList* commandList)
+{
+    if (!m_tlasInstanceCacheValid || m_tlasInstanceCacheSourceCount != GetSceneGraph()->GetMeshInstances().size())
+        BuildTlasInstanceCache();
+    else
+        UpdateTlasInstances();
+
+    nvrhi::rt::AccelStructBuildFlags buildFlags = m_canUpdateTLAS
+        ? nvrhi::rt::AccelStructBuildFlags::PerformUpdate
+        : nvrhi::rt::AccelStructBuildFlags::None;
+
     commandList->buildTopLevelAccelStruct(m_topLevelAS, m_tlasInstances.data(), m_tlasInstances.size(), buildFlags);
     m_canUpdateTLAS = true;
 }
@@ -498,18 +808,137 @@ void SampleScene::NextFrame()
 
 void SampleScene::Animate(float fElapsedTimeSeconds)
 {
-    m_wallclockTime += fElapsedTimeSeconds;
-    
+    SetAnimationTime(m_wallclockTime + fElapsedTimeSeconds);
+}
+
+double SampleScene::GetAnimationTime() const
+{
+    return m_wallclockTime;
+}
+
+void SampleScene::BuildAnimationEvaluator()
+{
+    m_animatedChannels.clear();
+    m_animationClocks.clear();
+    m_otherAnimationChannels.clear();
+
+    // Pre-order node numbers, so that the targets of one task form contiguous subtrees
+    std::unordered_map<const engine::SceneGraphNode*, uint32_t> nodeOrder;
+    for (engine::SceneGraphWalker walker(m_SceneGraph->GetRootNode().get()); walker; walker.Next(true))
+        nodeOrder.emplace(walker.Get(), uint32_t(nodeOrder.size()));
+
+    std::vector<AnimationTrack> tracks;
+    std::vector<AnimationKeyframe> keyframes;
+
     for (const auto& animation : m_SceneGraph->GetAnimations())
     {
         if (animation == m_benchmarkAnimation)
             continue;
 
-        float duration = animation->GetDuration();
+        const uint32_t clock = uint32_t(m_animationClocks.size());
+        m_animationClocks.push_back(animation.get());
+
+        for (const auto& channel : animation->GetChannels())
+        {
+            const auto targetNode = channel->GetTargetNode();
+            const engine::AnimationAttribute attribute = channel->GetAttribute();
+            const bool isTransform = attribute == engine::AnimationAttribute::Translation
+                || attribute == engine::AnimationAttribute::Rotation
+                || attribute == engine::AnimationAttribute::Scaling;
+
+            if (!targetNode || !isTransform)
+            {
+                m_otherAnimationChannels.emplace_back(clock, channel.get());
+                continue;
+            }
+
+            const auto& sampler = channel->GetSampler();
+
+            AnimationTrack track;
+            track.firstKeyframe = uint32_t(keyframes.size());
+            track.keyframeCount = uint32_t(sampler->GetKeyframes().size());
+            track.interpolation = AnimationInterpolation(sampler->GetInterpolationMode());
+            track.clock = clock;
+            track.target = nodeOrder.at(targetNode.get());
+            tracks.push_back(track);
+
+            for (const auto& keyframe : sampler->GetKeyframes())
+            {
+                AnimationKeyframe& copy = keyframes.emplace_back();
+                copy.time = keyframe.time;
+                for (int component = 0; component < 4; component++)
+                {
+                    copy.value[component] = keyframe.value[component];
+                    copy.inTangent[component] = keyframe.inTangent[component];
+                    copy.outTangent[component] = keyframe.outTangent[component];
+                }
+            }
+
+            m_animatedChannels.push_back({ targetNode.get(), attribute });
+        }
+    }
+
+    m_animationEvaluator.Build(std::move(tracks), std::move(keyframes));
+    m_animationClockTimes.resize(m_animationClocks.size());
+    m_animationEvaluatorValid = true;
+}
+
+void SampleScene::SetAnimationTime(double time)
+{
+    m_wallclockTime = time;
+
+    if (!m_animationEvaluatorValid)
+        BuildAnimationEvaluator();
+
+    for (size_t clock = 0; clock < m_animationClocks.size(); clock++)
+    {
+        float duration = m_animationClocks[clock]->GetDuration();
         double integral;
-        float animationTime = float(std::modf(m_wallclockTime / double(duration), &integral)) * duration;
-        (void)animation->Apply(animationTime);
+        m_animationClockTimes[clock] = float(std::modf(m_wallclockTime / double(duration), &integral)) * duration;
     }
+
+    AnimationParallelFor parallelFor;
+#ifdef DONUT_WITH_TASKFLOW
+    if (m_executor)
+    {
+        parallelFor = [this](size_t taskCount, const std::function<void(size_t task)>& task)
+        {
+            tf::Taskflow taskflow;
+            taskflow.for_each_index(size_t(0), taskCount, size_t(1), task);
+            m_executor->run(taskflow).wait();
+        };
+    }
+#endif
+
+    m_animationEvaluator.Evaluate(m_animationClockTimes.data(), parallelFor);
+
+    // Setting a transform marks the ancestors dirty, so the nodes are written from this thread only
+    const std::vector<AnimationSample>& samples = m_animationEvaluator.GetResults();
+    for (size_t index = 0; index < m_animatedChannels.size(); index++)
+    {
+        const AnimatedChannel& channel = m_animatedChannels[index];
+        const float* value = samples[index].value;
+
+        switch (channel.attribute)
+        {
+        case engine::AnimationAttribute::Translation:
+            channel.node->SetTranslation(double3(value[0], value[1], value[2]));
+            break;
+        case engine::AnimationAttribute::Scaling:
+            channel.node->SetScaling(double3(value[0], value[1], value[2]));
+            break;
+        case engine::AnimationAttribute::Rotation: {
+            const double4 rotation = normalize(double4(value[0], value[1], value[2], value[3]));
+            channel.node->SetRotation(dquat::fromXYZW(rotation));
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    for (const auto& [clock, channel] : m_otherAnimationChannels)
+        (void)channel->Apply(m_animationClockTimes[clock]);
 }
 
 nvrhi::rt::IAccelStruct* SampleScene::GetTopLevelAS() const
@@ -525,4 +954,818 @@ nvrhi::rt::IAccelStruct* SampleScene::GetPrevTopLevelAS() const
 std::vector<std::string>& SampleScene::GetEnvironmentMaps()
 {
     return m_environmentMaps;
-}
\ No newline at end of file
+}
+void SampleScene::SetSceneCacheDirectory(const std::filesystem::path& directory)
+{
+    m_sceneCacheDirectory = directory;
+}
+
+bool SampleScene::WasLoadedFromCache() const
+{
+    return m_loadedFromCache;
+}
+
+// Returns the JSON text of a .gltf file, or of the JSON chunk of a .glb file
+static bool GetGltfJson(const vfs::IBlob& blob, const char*& jsonBegin, const char*& jsonEnd)
+{
+    const char* data = static_cast<const char*>(blob.data());
+    const size_t size = blob.size();
+
+    constexpr uint32_t glbMagic = 0x46546C67; // "glTF"
+    constexpr uint32_t glbJsonChunk = 0x4E4F534A; // "JSON"
+    constexpr size_t glbHeaderSize = 12;
+    constexpr size_t glbChunkHeaderSize = 8;
+
+    uint32_t magic = 0;
+    if (size >= sizeof(magic))
+        memcpy(&magic, data, sizeof(magic));
+
+    if (magic != glbMagic)
+    {
+        jsonBegin = data;
+        jsonEnd = data + size;
+        return true;
+    }
+
+    uint32_t chunkHeader[2];
+    if (size < glbHeaderSize + glbChunkHeaderSize)
+        return false;
+    memcpy(chunkHeader, data + glbHeaderSize, sizeof(chunkHeader));
+
+    if (chunkHeader[1] != glbJsonChunk || chunkHeader[0] > size - glbHeaderSize - glbChunkHeaderSize)
+        return false;
+
+    jsonBegin = data + glbHeaderSize + glbChunkHeaderSize;
+    jsonEnd = jsonBegin + chunkHeader[0];
+    return true;
+}
+
+// Decodes the %XX escapes of a relative glTF URI
+static std::string DecodeGltfUri(const std::string& uri)
+{
+    std::string decoded;
+    for (size_t i = 0; i < uri.size(); i++)
+    {
+        if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(uint8_t(uri[i + 1])) && isxdigit(uint8_t(uri[i + 2])))
+        {
+            decoded += char(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else
+            decoded += uri[i];
+    }
+    return decoded;
+}
+
+// Returns the external buffer files of a glTF model, relative to the model. Embedded data: URIs
+// and the binary chunk of .glb files are already covered by the hash of the model file.
+static std::vector<std::string> GetGltfBufferFiles(const vfs::IBlob& modelBlob)
+{
+    std::vector<std::string> files;
+
+    const char* jsonBegin;
+    const char* jsonEnd;
+    if (!GetGltfJson(modelBlob, jsonBegin, jsonEnd))
+        return files;
+
+    Json::Value gltfRoot;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    if (!reader->parse(jsonBegin, jsonEnd, &gltfRoot, nullptr))
+        return files;
+
+    for (const auto& buffer : gltfRoot["buffers"])
+    {
+        const Json::Value& uri = buffer["uri"];
+        if (uri.isString() && uri.asString().compare(0, 5, "data:") != 0)
+            files.push_back(DecodeGltfUri(uri.asString()));
+    }
+
+    return files;
+}
+
+uint64_t SampleScene::HashSceneSources(const std::filesystem::path& jsonFileName) const
+{
+    SceneCacheHasher hasher;
+
+    auto jsonBlob = m_fs->readFile(jsonFileName);
+    if (!jsonBlob)
+        return 0;
+
+    hasher.Update(jsonBlob->data(), jsonBlob->size());
+
+    // The models are referenced relative to the scene file, and their external buffers relative to the model.
+    // The buffers are hashed by content, there are no modification times in the virtual file system.
+    Json::Value documentRoot;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    const char* jsonText = static_cast<const char*>(jsonBlob->data());
+    if (!reader->parse(jsonText, jsonText + jsonBlob->size(), &documentRoot, nullptr))
+        return hasher.GetHash();
+
+    for (const auto& model : documentRoot["models"])
+    {
+        if (!model.isString())
+            continue;
+
+        const std::filesystem::path modelFileName = jsonFileName.parent_path() / model.asString();
+        auto modelBlob = m_fs->readFile(modelFileName);
+        if (!modelBlob)
+            continue;
+
+        hasher.Update(modelBlob->data(), modelBlob->size());
+
+        for (const std::string& bufferFile : GetGltfBufferFiles(*modelBlob))
+        {
+            // A missing buffer still changes the hash, so that the cache is rebuilt once it appears
+            hasher.Update(bufferFile.data(), bufferFile.size());
+
+            auto bufferBlob = m_fs->readFile(modelFileName.parent_path() / bufferFile);
+            if (bufferBlob)
+                hasher.Update(bufferBlob->data(), bufferBlob->size());
+        }
+    }
+
+    return hasher.GetHash();
+}
+
+// Light parameters in SceneCacheLight::parameters, by light type:
+//   Directional: irradiance, angularSize
+//   Spot: intensity, radius, range, innerAngle, outerAngle
+//   Point: intensity, radius, range
+//   Environment: radianceScale.xyz, rotation
+//   Cylinder: length, radius, flux
+//   Disk: radius, flux
+//   Rect: width, height, flux
+static bool StoreCachedLight(const engine::Light& light, SceneCacheStringTable& strings, SceneCacheLight& cached)
+{
+    cached.lightType = light.GetLightType();
+    cached.color[0] = light.color.x;
+    cached.color[1] = light.color.y;
+    cached.color[2] = light.color.z;
+    float* params = cached.parameters;
+
+    switch (cached.lightType)
+    {
+    case LightType_Directional: {
+        const auto& directional = static_cast<const engine::DirectionalLight&>(light);
+        params[0] = directional.irradiance;
+        params[1] = directional.angularSize;
+        return true;
+    }
+    case LightType_Spot: {
+        const auto& spot = static_cast<const engine::SpotLight&>(light);
+        params[0] = spot.intensity;
+        params[1] = spot.radius;
+        params[2] = spot.range;
+        params[3] = spot.innerAngle;
+        params[4] = spot.outerAngle;
+        if (const auto* spotWithProfile = dynamic_cast<const SpotLightWithProfile*>(&light))
+        {
+            if (!spotWithProfile->profileName.empty())
+                cached.profileName = strings.Add(spotWithProfile->profileName);
+        }
+        return true;
+    }
+    case LightType_Point: {
+        const auto& point = static_cast<const engine::PointLight&>(light);
+        params[0] = point.intensity;
+        params[1] = point.radius;
+        params[2] = point.range;
+        return true;
+    }
+    case LightType_Environment: {
+        const auto& environment = static_cast<const EnvironmentLight&>(light);
+        params[0] = environment.radianceScale.x;
+        params[1] = environment.radianceScale.y;
+        params[2] = environment.radianceScale.z;
+        params[3] = environment.rotation;
+        return true;
+    }
+    case LightType_Cylinder: {
+        const auto& cylinder = static_cast<const CylinderLight&>(light);
+        params[0] = cylinder.length;
+        params[1] = cylinder.radius;
+        params[2] = cylinder.flux;
+        return true;
+    }
+    case LightType_Disk: {
+        const auto& disk = static_cast<const DiskLight&>(light);
+        params[0] = disk.radius;
+        params[1] = disk.flux;
+        return true;
+    }
+    case LightType_Rect: {
+        const auto& rect = static_cast<const RectLight&>(light);
+        params[0] = rect.width;
+        params[1] = rect.height;
+        params[2] = rect.flux;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static std::shared_ptr<engine::Light> CreateCachedLight(const SceneCacheLight& cached, const SceneCacheFile& file)
+{
+    std::shared_ptr<engine::Light> light;
+    const float* params = cached.parameters;
+
+    switch (cached.lightType)
+    {
+    case LightType_Directional: {
+        auto directional = std::make_shared<engine::DirectionalLight>();
+        directional->irradiance = params[0];
+        directional->angularSize = params[1];
+        light = directional;
+        break;
+    }
+    case LightType_Spot: {
+        auto spot = std::make_shared<SpotLightWithProfile>();
+        spot->intensity = params[0];
+        spot->radius = params[1];
+        spot->range = params[2];
+        spot->innerAngle = params[3];
+        spot->outerAngle = params[4];
+        if (const char* profileName = file.GetString(cached.profileName))
+            spot->profileName = profileName;
+        light = spot;
+        break;
+    }
+    case LightType_Point: {
+        auto point = std::make_shared<engine::PointLight>();
+        point->intensity = params[0];
+        point->radius = params[1];
+        point->range = params[2];
+        light = point;
+        break;
+    }
+    case LightType_Environment: {
+        auto environment = std::make_shared<EnvironmentLight>();
+        environment->radianceScale = float3(params[0], params[1], params[2]);
+        environment->rotation = params[3];
+        light = environment;
+        break;
+    }
+    case LightType_Cylinder: {
+        auto cylinder = std::make_shared<CylinderLight>();
+        cylinder->length = params[0];
+        cylinder->radius = params[1];
+        cylinder->flux = params[2];
+        light = cylinder;
+        break;
+    }
+    case LightType_Disk: {
+        auto disk = std::make_shared<DiskLight>();
+        disk->radius = params[0];
+        disk->flux = params[1];
+        light = disk;
+        break;
+    }
+    case LightType_Rect: {
+        auto rect = std::make_shared<RectLight>();
+        rect->width = params[0];
+        rect->height = params[1];
+        rect->flux = params[2];
+        light = rect;
+        break;
+    }
+    default:
+        return nullptr;
+    }
+
+    light->color = float3(cached.color[0], cached.color[1], cached.color[2]);
+    return light;
+}
+
+static void StoreCachedBounds(const box3& bounds, float* boundsMin, float* boundsMax)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        boundsMin[axis] = bounds.m_mins[axis];
+        boundsMax[axis] = bounds.m_maxs[axis];
+    }
+}
+
+static box3 LoadCachedBounds(const float* boundsMin, const float* boundsMax)
+{
+    return box3(float3(boundsMin[0], boundsMin[1], boundsMin[2]), float3(boundsMax[0], boundsMax[1], boundsMax[2]));
+}
+
+static std::shared_ptr<engine::LoadedTexture> engine::Material::* const c_CachedMaterialTextures[] = {
+    &engine::Material::baseOrDiffuseTexture,
+    &engine::Material::metalRoughOrSpecularTexture,
+    &engine::Material::normalTexture,
+    &engine::Material::emissiveTexture,
+    &engine::Material::occlusionTexture,
+    &engine::Material::transmissionTexture
+};
+
+static_assert(std::size(c_CachedMaterialTextures) == size_t(SceneCacheTexture::Count));
+
+bool SampleScene::WriteSceneCache(const std::filesystem::path& cacheFileName, uint64_t sourceHash) const
+{
+    SceneCacheStringTable strings;
+    std::vector<SceneCacheNode> nodes;
+    std::vector<SceneCacheBufferGroup> bufferGroups;
+    std::vector<SceneCacheMesh> meshes;
+    std::vector<SceneCacheGeometry> geometries;
+    std::vector<SceneCacheMaterial> materials;
+    std::vector<SceneCacheLight> lights;
+    std::vector<SceneCacheCamera> cameras;
+    std::vector<SceneCacheAnimation> animations;
+    std::vector<SceneCacheAnimationChannel> channels;
+    std::vector<SceneCacheKeyframe> keyframes;
+    std::vector<uint8_t> vertexData;
+
+    std::unordered_map<const engine::SceneGraphNode*, uint32_t> nodeIndices;
+    std::unordered_map<const engine::BufferGroup*, uint32_t> bufferGroupIndices;
+    std::unordered_map<const engine::MeshInfo*, uint32_t> meshIndices;
+    std::unordered_map<const engine::Material*, uint32_t> materialIndices;
+    std::vector<engine::SceneGraphAnimation*> animationLeaves;
+
+    auto fail = [&cacheFileName](const char* reason)
+    {
+        log::info("Not writing the scene cache %s: %s", cacheFileName.generic_string().c_str(), reason);
+        return false;
+    };
+
+    auto addMaterial = [&](const engine::Material& material)
+    {
+        auto [it, inserted] = materialIndices.try_emplace(&material, uint32_t(materials.size()));
+        if (!inserted)
+            return it->second;
+
+        SceneCacheMaterial& cached = materials.emplace_back();
+        cached.name = strings.Add(material.name);
+        cached.domain = uint32_t(material.domain);
+        cached.flags = (material.doubleSided ? SceneCacheMaterialFlags_DoubleSided : 0)
+            | (material.useSpecularGlossModel ? SceneCacheMaterialFlags_UseSpecularGlossModel : 0);
+
+        for (size_t slot = 0; slot < std::size(c_CachedMaterialTextures); slot++)
+        {
+            const auto& texture = material.*c_CachedMaterialTextures[slot];
+            if (texture && !texture->path.empty())
+                cached.textures[slot] = strings.Add(texture->path);
+        }
+
+        for (int channel = 0; channel < 3; channel++)
+        {
+            cached.baseOrDiffuseColor[channel] = material.baseOrDiffuseColor[channel];
+            cached.specularColor[channel] = material.specularColor[channel];
+            cached.emissiveColor[channel] = material.emissiveColor[channel];
+        }
+        cached.emissiveIntensity = material.emissiveIntensity;
+        cached.metalness = material.metalness;
+        cached.roughness = material.roughness;
+        cached.opacity = material.opacity;
+        cached.alphaCutoff = material.alphaCutoff;
+        cached.transmissionFactor = material.transmissionFactor;
+        cached.normalTextureScale = material.normalTextureScale;
+        cached.occlusionStrength = material.occlusionStrength;
+        return it->second;
+    };
+
+    auto addBufferGroup = [&](const engine::BufferGroup& buffers)
+    {
+        auto [it, inserted] = bufferGroupIndices.try_emplace(&buffers, uint32_t(bufferGroups.size()));
+        if (!inserted)
+            return it->second;
+
+        SceneCacheBufferGroup& cached = bufferGroups.emplace_back();
+        cached.indexCount = uint32_t(buffers.indexData.size());
+        cached.vertexCount = uint32_t(buffers.positionData.size());
+        cached.indexData = AppendSceneCacheData(vertexData, buffers.indexData.data(), buffers.indexData.size() * sizeof(uint32_t));
+        cached.positionData = AppendSceneCacheData(vertexData, buffers.positionData.data(), buffers.positionData.size() * sizeof(float3));
+        cached.texcoord1Data = AppendSceneCacheData(vertexData, buffers.texcoord1Data.data(), buffers.texcoord1Data.size() * sizeof(float2));
+        cached.normalData = AppendSceneCacheData(vertexData, buffers.normalData.data(), buffers.normalData.size() * sizeof(uint32_t));
+        cached.tangentData = AppendSceneCacheData(vertexData, buffers.tangentData.data(), buffers.tangentData.size() * sizeof(uint32_t));
+        return it->second;
+    };
+
+    auto addMesh = [&](const engine::MeshInfo& mesh)
+    {
+        auto [it, inserted] = meshIndices.try_emplace(&mesh, uint32_t(meshes.size()));
+        if (!inserted)
+            return it->second;
+
+        SceneCacheMesh cachedMesh;
+        cachedMesh.name = strings.Add(mesh.name);
+        cachedMesh.bufferGroup = addBufferGroup(*mesh.buffers);
+        cachedMesh.firstGeometry = uint32_t(geometries.size());
+        cachedMesh.geometryCount = uint32_t(mesh.geometries.size());
+        cachedMesh.indexOffset = mesh.indexOffset;
+        cachedMesh.vertexOffset = mesh.vertexOffset;
+        cachedMesh.totalIndices = mesh.totalIndices;
+        cachedMesh.totalVertices = mesh.totalVertices;
+        StoreCachedBounds(mesh.objectSpaceBounds, cachedMesh.boundsMin, cachedMesh.boundsMax);
+
+        for (const auto& geometry : mesh.geometries)
+        {
+            SceneCacheGeometry cachedGeometry;
+            cachedGeometry.material = geometry->material ? addMaterial(*geometry->material) : c_SceneCacheNone;
+            cachedGeometry.indexOffsetInMesh = geometry->indexOffsetInMesh;
+            cachedGeometry.vertexOffsetInMesh = geometry->vertexOffsetInMesh;
+            cachedGeometry.numIndices = geometry->numIndices;
+            cachedGeometry.numVertices = geometry->numVertices;
+            StoreCachedBounds(geometry->objectSpaceBounds, cachedGeometry.boundsMin, cachedGeometry.boundsMax);
+            geometries.push_back(cachedGeometry);
+        }
+
+        meshes.push_back(cachedMesh);
+        return it->second;
+    };
+
+    // Pre-order walk, so that parents come before their children
+    for (engine::SceneGraphWalker walker(m_SceneGraph->GetRootNode().get()); walker; walker.Next(true))
+    {
+        engine::SceneGraphNode* node = walker.Get();
+        nodeIndices[node] = uint32_t(nodes.size());
+
+        SceneCacheNode cachedNode;
+        cachedNode.name = strings.Add(node->GetName());
+        if (node->GetParent())
+            cachedNode.parent = nodeIndices.at(node->GetParent());
+
+        const dm::double3 translation = node->GetTranslation();
+        const dm::dquat rotation = node->GetRotation();
+        const dm::double3 scaling = node->GetScaling();
+        for (int axis = 0; axis < 3; axis++)
+        {
+            cachedNode.translation[axis] = translation[axis];
+            cachedNode.scaling[axis] = scaling[axis];
+        }
+        cachedNode.rotation[0] = rotation.x;
+        cachedNode.rotation[1] = rotation.y;
+        cachedNode.rotation[2] = rotation.z;
+        cachedNode.rotation[3] = rotation.w;
+
+        const auto& leaf = node->GetLeaf();
+        if (leaf)
+        {
+            if (auto meshInstance = std::dynamic_pointer_cast<engine::MeshInstance>(leaf))
+            {
+                const auto& mesh = meshInstance->GetMesh();
+                if (std::dynamic_pointer_cast<engine::SkinnedMeshInstance>(leaf) || mesh->skinPrototype)
+                    return fail("skinned meshes are not supported");
+
+                if (!mesh->buffers->texcoord2Data.empty() || !mesh->buffers->jointData.empty() || !mesh->buffers->weightData.empty())
+                    return fail("unsupported vertex attributes");
+
+                cachedNode.leafType = SceneCacheLeafType::MeshInstance;
+                cachedNode.leafIndex = addMesh(*mesh);
+            }
+            else if (auto light = std::dynamic_pointer_cast<engine::Light>(leaf))
+            {
+                SceneCacheLight cachedLight;
+                if (!StoreCachedLight(*light, strings, cachedLight))
+                    return fail("unsupported light type");
+
+                cachedNode.leafType = SceneCacheLeafType::Light;
+                cachedNode.leafIndex = uint32_t(lights.size());
+                lights.push_back(cachedLight);
+            }
+            else if (auto camera = std::dynamic_pointer_cast<engine::PerspectiveCamera>(leaf))
+            {
+                SceneCacheCamera cachedCamera;
+                cachedCamera.zNear = camera->zNear;
+                cachedCamera.zFar = camera->zFar.value_or(0.f);
+                cachedCamera.verticalFov = camera->verticalFov;
+                cachedCamera.aspectRatio = camera->aspectRatio.value_or(0.f);
+
+                cachedNode.leafType = SceneCacheLeafType::Camera;
+                cachedNode.leafIndex = uint32_t(cameras.size());
+                cameras.push_back(cachedCamera);
+            }
+            else if (auto animation = std::dynamic_pointer_cast<engine::SceneGraphAnimation>(leaf))
+            {
+                // The channels reference nodes that may come later in the walk, store them afterwards
+                cachedNode.leafType = SceneCacheLeafType::Animation;
+                cachedNode.leafIndex = uint32_t(animationLeaves.size());
+                animationLeaves.push_back(animation.get());
+            }
+            else
+                return fail("unsupported scene graph leaf type");
+        }
+
+        nodes.push_back(cachedNode);
+    }
+
+    for (const engine::SceneGraphAnimation* animation : animationLeaves)
+    {
+        SceneCacheAnimation& cachedAnimation = animations.emplace_back();
+        cachedAnimation.name = strings.Add(animation->GetName());
+        cachedAnimation.firstChannel = uint32_t(channels.size());
+        cachedAnimation.channelCount = uint32_t(animation->GetChannels().size());
+
+        for (const auto& channel : animation->GetChannels())
+        {
+            const auto targetNode = channel->GetTargetNode();
+            if (!targetNode || channel->GetAttribute() == engine::AnimationAttribute::LeafProperty)
+                return fail("unsupported animation channel");
+
+            const auto& sampler = channel->GetSampler();
+            const auto& samplerKeyframes = sampler->GetKeyframes();
+
+            SceneCacheAnimationChannel& cachedChannel = channels.emplace_back();
+            cachedChannel.targetNode = nodeIndices.at(targetNode.get());
+            cachedChannel.attribute = uint32_t(channel->GetAttribute());
+            cachedChannel.interpolation = uint32_t(sampler->GetInterpolationMode());
+            cachedChannel.firstKeyframe = uint32_t(keyframes.size());
+            cachedChannel.keyframeCount = uint32_t(samplerKeyframes.size());
+
+            for (const auto& keyframe : samplerKeyframes)
+            {
+                SceneCacheKeyframe& cachedKeyframe = keyframes.emplace_back();
+                cachedKeyframe.time = keyframe.time;
+                for (int component = 0; component < 4; component++)
+                {
+                    cachedKeyframe.value[component] = keyframe.value[component];
+                    cachedKeyframe.inTangent[component] = keyframe.inTangent[component];
+                    cachedKeyframe.outTangent[component] = keyframe.outTangent[component];
+                }
+            }
+        }
+    }
+
+    SceneCacheWriter writer;
+    writer.AddSection(SceneCacheSectionId::Strings, strings.GetData());
+    writer.AddSection(SceneCacheSectionId::Nodes, nodes);
+    writer.AddSection(SceneCacheSectionId::BufferGroups, bufferGroups);
+    writer.AddSection(SceneCacheSectionId::Meshes, meshes);
+    writer.AddSection(SceneCacheSectionId::Geometries, geometries);
+    writer.AddSection(SceneCacheSectionId::Materials, materials);
+    writer.AddSection(SceneCacheSectionId::Lights, lights);
+    writer.AddSection(SceneCacheSectionId::Cameras, cameras);
+    writer.AddSection(SceneCacheSectionId::Animations, animations);
+    writer.AddSection(SceneCacheSectionId::AnimationChannels, channels);
+    writer.AddSection(SceneCacheSectionId::Keyframes, keyframes);
+    writer.AddSection(SceneCacheSectionId::VertexData, vertexData);
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheFileName.parent_path(), error);
+
+    if (!writer.Write(cacheFileName, sourceHash))
+    {
+        log::warning("Cannot write the scene cache %s", cacheFileName.generic_string().c_str());
+        return false;
+    }
+
+    log::info("Wrote the scene cache %s", cacheFileName.generic_string().c_str());
+    return true;
+}
+
+template<typename T>
+static bool CopyCachedVertexData(const SceneCacheFile& file, uint64_t offset, size_t count, std::vector<T>& data)
+{
+    data.clear();
+    if (offset == c_SceneCacheNoData)
+        return true;
+
+    const void* source = file.GetVertexData(offset, count * sizeof(T));
+    if (!source)
+        return false;
+
+    data.resize(count);
+    memcpy(data.data(), source, count * sizeof(T));
+    return true;
+}
+
+bool SampleScene::LoadSceneCache(const std::filesystem::path& cacheFileName, uint64_t sourceHash)
+{
+    SceneCacheFile file;
+    if (!file.Open(cacheFileName, sourceHash))
+    {
+        log::info("Not using the scene cache %s: %s", cacheFileName.generic_string().c_str(), file.GetError().c_str());
+        return false;
+    }
+
+    const auto nodes = file.GetSection<SceneCacheNode>(SceneCacheSectionId::Nodes);
+    const auto bufferGroups = file.GetSection<SceneCacheBufferGroup>(SceneCacheSectionId::BufferGroups);
+    const auto meshes = file.GetSection<SceneCacheMesh>(SceneCacheSectionId::Meshes);
+    const auto geometries = file.GetSection<SceneCacheGeometry>(SceneCacheSectionId::Geometries);
+    const auto materials = file.GetSection<SceneCacheMaterial>(SceneCacheSectionId::Materials);
+    const auto lights = file.GetSection<SceneCacheLight>(SceneCacheSectionId::Lights);
+    const auto cameras = file.GetSection<SceneCacheCamera>(SceneCacheSectionId::Cameras);
+    const auto animations = file.GetSection<SceneCacheAnimation>(SceneCacheSectionId::Animations);
+    const auto channels = file.GetSection<SceneCacheAnimationChannel>(SceneCacheSectionId::AnimationChannels);
+    const auto keyframes = file.GetSection<SceneCacheKeyframe>(SceneCacheSectionId::Keyframes);
+
+    auto fail = [&cacheFileName](const char* reason)
+    {
+        log::warning("Invalid scene cache %s: %s", cacheFileName.generic_string().c_str(), reason);
+        return false;
+    };
+
+    auto getString = [&file](uint32_t offset)
+    {
+        const char* string = file.GetString(offset);
+        return std::string(string ? string : "");
+    };
+
+    if (nodes.empty())
+        return fail("no nodes");
+
+    std::vector<std::shared_ptr<engine::Material>> sceneMaterials;
+    sceneMaterials.reserve(materials.size());
+    for (const SceneCacheMaterial& cached : materials)
+    {
+        auto material = m_SceneTypeFactory->CreateMaterial();
+        material->name = getString(cached.name);
+        material->domain = engine::MaterialDomain(cached.domain);
+        material->doubleSided = (cached.flags & SceneCacheMaterialFlags_DoubleSided) != 0;
+        material->useSpecularGlossModel = (cached.flags & SceneCacheMaterialFlags_UseSpecularGlossModel) != 0;
+
+        for (size_t slot = 0; slot < std::size(c_CachedMaterialTextures); slot++)
+        {
+            if (cached.textures[slot] == c_SceneCacheNone)
+                continue;
+
+            // Only the color textures are sRGB, same as in the glTF importer
+            const bool sRGB = slot == size_t(SceneCacheTexture::BaseOrDiffuse) || slot == size_t(SceneCacheTexture::Emissive);
+            material.get()->*c_CachedMaterialTextures[slot] = m_TextureCache->LoadTextureFromFileDeferred(getString(cached.textures[slot]), sRGB);
+        }
+
+        material->baseOrDiffuseColor = float3(cached.baseOrDiffuseColor[0], cached.baseOrDiffuseColor[1], cached.baseOrDiffuseColor[2]);
+        material->specularColor = float3(cached.specularColor[0], cached.specularColor[1], cached.specularColor[2]);
+        material->emissiveColor = float3(cached.emissiveColor[0], cached.emissiveColor[1], cached.emissiveColor[2]);
+        material->emissiveIntensity = cached.emissiveIntensity;
+        material->metalness = cached.metalness;
+        material->roughness = cached.roughness;
+        material->opacity = cached.opacity;
+        material->alphaCutoff = cached.alphaCutoff;
+        material->transmissionFactor = cached.transmissionFactor;
+        material->normalTextureScale = cached.normalTextureScale;
+        material->occlusionStrength = cached.occlusionStrength;
+        sceneMaterials.push_back(material);
+    }
+
+    // The vertex arrays are copied out of the mapping once, BufferGroup owns its CPU-side data
+    std::vector<std::shared_ptr<engine::BufferGroup>> sceneBufferGroups;
+    sceneBufferGroups.reserve(bufferGroups.size());
+    for (const SceneCacheBufferGroup& cached : bufferGroups)
+    {
+        auto buffers = std::make_shared<engine::BufferGroup>();
+        if (!CopyCachedVertexData(file, cached.indexData, cached.indexCount, buffers->indexData) ||
+            !CopyCachedVertexData(file, cached.positionData, cached.vertexCount, buffers->positionData) ||
+            !CopyCachedVertexData(file, cached.texcoord1Data, cached.vertexCount, buffers->texcoord1Data) ||
+            !CopyCachedVertexData(file, cached.normalData, cached.vertexCount, buffers->normalData) ||
+            !CopyCachedVertexData(file, cached.tangentData, cached.vertexCount, buffers->tangentData))
+            return fail("vertex data out of bounds");
+
+        sceneBufferGroups.push_back(buffers);
+    }
+
+    std::vector<std::shared_ptr<engine::MeshInfo>> sceneMeshes;
+    sceneMeshes.reserve(meshes.size());
+    for (const SceneCacheMesh& cached : meshes)
+    {
+        if (cached.bufferGroup >= sceneBufferGroups.size() || uint64_t(cached.firstGeometry) + cached.geometryCount > geometries.size())
+            return fail("mesh references out of bounds");
+
+        auto mesh = m_SceneTypeFactory->CreateMesh();
+        mesh->name = getString(cached.name);
+        mesh->buffers = sceneBufferGroups[cached.bufferGroup];
+        mesh->indexOffset = cached.indexOffset;
+        mesh->vertexOffset = cached.vertexOffset;
+        mesh->totalIndices = cached.totalIndices;
+        mesh->totalVertices = cached.totalVertices;
+        mesh->objectSpaceBounds = LoadCachedBounds(cached.boundsMin, cached.boundsMax);
+
+        for (uint32_t index = cached.firstGeometry; index < cached.firstGeometry + cached.geometryCount; index++)
+        {
+            const SceneCacheGeometry& cachedGeometry = geometries[index];
+            if (cachedGeometry.material != c_SceneCacheNone && cachedGeometry.material >= sceneMaterials.size())
+                return fail("geometry material out of bounds");
+
+            auto geometry = std::make_shared<engine::MeshGeometry>();
+            if (cachedGeometry.material != c_SceneCacheNone)
+                geometry->material = sceneMaterials[cachedGeometry.material];
+            geometry->indexOffsetInMesh = cachedGeometry.indexOffsetInMesh;
+            geometry->vertexOffsetInMesh = cachedGeometry.vertexOffsetInMesh;
+            geometry->numIndices = cachedGeometry.numIndices;
+            geometry->numVertices = cachedGeometry.numVertices;
+            geometry->objectSpaceBounds = LoadCachedBounds(cachedGeometry.boundsMin, cachedGeometry.boundsMax);
+            mesh->geometries.push_back(geometry);
+        }
+
+        sceneMeshes.push_back(mesh);
+    }
+
+    auto sceneGraph = std::make_shared<engine::SceneGraph>();
+    std::vector<std::shared_ptr<engine::SceneGraphNode>> sceneNodes;
+    sceneNodes.reserve(nodes.size());
+
+    for (const SceneCacheNode& cached : nodes)
+    {
+        auto node = std::make_shared<engine::SceneGraphNode>();
+        node->SetName(getString(cached.name));
+
+        const double3 translation(cached.translation[0], cached.translation[1], cached.translation[2]);
+        const double3 scaling(cached.scaling[0], cached.scaling[1], cached.scaling[2]);
+        dquat rotation;
+        rotation.x = cached.rotation[0];
+        rotation.y = cached.rotation[1];
+        rotation.z = cached.rotation[2];
+        rotation.w = cached.rotation[3];
+        node->SetTransform(&translation, &rotation, &scaling);
+
+        switch (cached.leafType)
+        {
+        case SceneCacheLeafType::None:
+        case SceneCacheLeafType::Animation:
+            break;
+        case SceneCacheLeafType::MeshInstance:
+            if (cached.leafIndex >= sceneMeshes.size())
+                return fail("mesh instance out of bounds");
+            node->SetLeaf(std::make_shared<engine::MeshInstance>(sceneMeshes[cached.leafIndex]));
+            break;
+        case SceneCacheLeafType::Light: {
+            if (cached.leafIndex >= lights.size())
+                return fail("light out of bounds");
+            auto light = CreateCachedLight(lights[cached.leafIndex], file);
+            if (!light)
+                return fail("unknown light type");
+            node->SetLeaf(light);
+            break;
+        }
+        case SceneCacheLeafType::Camera: {
+            if (cached.leafIndex >= cameras.size())
+                return fail("camera out of bounds");
+            const SceneCacheCamera& cachedCamera = cameras[cached.leafIndex];
+            auto camera = std::make_shared<engine::PerspectiveCamera>();
+            camera->zNear = cachedCamera.zNear;
+            if (cachedCamera.zFar > 0.f)
+                camera->zFar = cachedCamera.zFar;
+            camera->verticalFov = cachedCamera.verticalFov;
+            if (cachedCamera.aspectRatio > 0.f)
+                camera->aspectRatio = cachedCamera.aspectRatio;
+            node->SetLeaf(camera);
+            break;
+        }
+        default:
+            return fail("unknown leaf type");
+        }
+
+        if (cached.parent == c_SceneCacheNone)
+        {
+            if (!sceneNodes.empty())
+                return fail("more than one root node");
+            sceneGraph->SetRootNode(node);
+        }
+        else
+        {
+            if (cached.parent >= sceneNodes.size())
+                return fail("parent node out of order");
+            node = sceneGraph->Attach(sceneNodes[cached.parent], node);
+        }
+
+        sceneNodes.push_back(node);
+    }
+
+    // Animations go last, their channels can target any node
+    for (size_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++)
+    {
+        const SceneCacheNode& cached = nodes[nodeIndex];
+        if (cached.leafType != SceneCacheLeafType::Animation)
+            continue;
+
+        if (cached.leafIndex >= animations.size())
+            return fail("animation out of bounds");
+
+        const SceneCacheAnimation& cachedAnimation = animations[cached.leafIndex];
+        if (uint64_t(cachedAnimation.firstChannel) + cachedAnimation.channelCount > channels.size())
+            return fail("animation channels out of bounds");
+
+        auto animation = std::make_shared<engine::SceneGraphAnimation>();
+        for (uint32_t channelIndex = cachedAnimation.firstChannel; channelIndex < cachedAnimation.firstChannel + cachedAnimation.channelCount; channelIndex++)
+        {
+            const SceneCacheAnimationChannel& cachedChannel = channels[channelIndex];
+            if (cachedChannel.targetNode >= sceneNodes.size() || uint64_t(cachedChannel.firstKeyframe) + cachedChannel.keyframeCount > keyframes.size())
+                return fail("animation channel out of bounds");
+
+            auto sampler = std::make_shared<engine::animation::Sampler>();
+            sampler->SetInterpolationMode(engine::animation::InterpolationMode(cachedChannel.interpolation));
+
+            for (uint32_t keyframeIndex = cachedChannel.firstKeyframe; keyframeIndex < cachedChannel.firstKeyframe + cachedChannel.keyframeCount; keyframeIndex++)
+            {
+                const SceneCacheKeyframe& cachedKeyframe = keyframes[keyframeIndex];
+                engine::animation::Keyframe keyframe;
+                keyframe.time = cachedKeyframe.time;
+                keyframe.value = float4(cachedKeyframe.value[0], cachedKeyframe.value[1], cachedKeyframe.value[2], cachedKeyframe.value[3]);
+                keyframe.inTangent = float4(cachedKeyframe.inTangent[0], cachedKeyframe.inTangent[1], cachedKeyframe.inTangent[2], cachedKeyframe.inTangent[3]);
+                keyframe.outTangent = float4(cachedKeyframe.outTangent[0], cachedKeyframe.outTangent[1], cachedKeyframe.outTangent[2], cachedKeyframe.outTangent[3]);
+                sampler->AddKeyframe(keyframe);
+            }
+
+            animation->AddChannel(std::make_shared<engine::SceneGraphAnimationChannel>(sampler, sceneNodes[cachedChannel.targetNode],
+                engine::AnimationAttribute(cachedChannel.attribute)));
+        }
+
+        sceneNodes[nodeIndex]->SetLeaf(animation);
+    }
+
+    m_SceneGraph = sceneGraph;
+    return true;
+}
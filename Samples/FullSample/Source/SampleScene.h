@@ -13,6 +13,12 @@
 #include <donut/engine/Scene.h>
 #include <donut/engine/KeyframeAnimation.h>
 
+#include "AnimationEvaluator.h"
+#include "BlasBuildPlanner.h"
+#include "SceneCache.h"
+#include "SceneInstanceBvh.h"
+#include "SkinnedBlasRefitPolicy.h"
+
 constexpr int LightType_Environment = 1000;
 constexpr int LightType_Cylinder = 1001;
 constexpr int LightType_Disk = 1002;
@@ -85,6 +91,11 @@ public:
     using MeshInfo::MeshInfo;
 
     nvrhi::rt::AccelStructHandle prevAccelStruct;
+
+    // Skinned meshes only: accelStruct and prevAccelStruct swap every frame, each of them has its own
+    // refit history. accelStructSlot tells which policy belongs to accelStruct.
+    SkinnedBlasRefitPolicy refitPolicies[2];
+    uint32_t accelStructSlot = 0;
 };
 
 class SampleSceneTypeFactory : public donut::engine::SceneTypeFactory
@@ -94,6 +105,23 @@ public:
     std::shared_ptr<donut::engine::MeshInfo> CreateMesh() override;
 };
 
+struct SkinnedBlasStats
+{
+    std::string name;
+    uint32_t refits = 0;
+    uint32_t rebuilds = 0;
+    float boundsGrowth = 0.f;       // largest bounds growth of the two BLAS'es since their last rebuild
+};
+
+struct BlasMemoryStats
+{
+    uint64_t accelStructHeapSize = 0;   // shared heap with the skinned and uncompacted BLAS'es and the TLAS'es
+    uint64_t staticBlasMemory = 0;      // static BLAS'es before compaction
+    size_t builtStaticBlases = 0;
+    size_t compactedStaticBlases = 0;
+    size_t pendingStaticBlases = 0;
+};
+
 class SampleScene : public donut::engine::Scene
 {
 public:
@@ -101,24 +129,102 @@ public:
 
     bool LoadWithExecutor(const std::filesystem::path& jsonFileName, tf::Executor* executor) override;
 
+    // Native directory where the binary scene caches are kept, see SceneCache.h. When set, the scene is
+    // loaded from the cache if the source files didn't change, and the cache is written after a regular load.
+    void SetSceneCacheDirectory(const std::filesystem::path& directory);
+    [[nodiscard]] bool WasLoadedFromCache() const;
+
     const donut::engine::SceneGraphAnimation* GetBenchmarkAnimation() const;
     const donut::engine::PerspectiveCamera* GetBenchmarkCamera() const;
     
-    void BuildMeshBLASes(nvrhi::IDevice* device);
-    void UpdateSkinnedMeshBLASes(nvrhi::ICommandList* commandList, uint32_t frameIndex);
+    // Creates the BLAS'es and builds the skinned ones. Static BLAS'es are built in batches that fit into
+    // the scratch budget, either right away or progressively through BuildPendingBLASes.
+    // Compacted static BLAS'es own their memory, nvrhi replaces it with a smaller buffer after the build
+    // when compactBottomLevelAccelStructs is called. Everything else lives in one shared heap.
+    void BuildMeshBLASes(nvrhi::IDevice* device, const BlasBuildPlannerSettings& buildSettings = BlasBuildPlannerSettings(),
+        bool compactStaticBLASes = true);
+
+    // Records the next batch of progressive BLAS builds. Returns true if more meshes became available to the TLAS.
+    bool BuildPendingBLASes(nvrhi::ICommandList* commandList);
+    [[nodiscard]] size_t GetPendingBLASBatchCount() const;
+
+    // Call after compactBottomLevelAccelStructs. Returns true if static BLAS'es were compacted since the last
+    // call, which moves them to new memory: both TLAS'es then have to be rebuilt before the old memory is freed.
+    bool UpdateCompactedBLASes();
+    [[nodiscard]] BlasMemoryStats GetBlasMemoryStats() const;
+    void UpdateSkinnedMeshBLASes(nvrhi::ICommandList* commandList, uint32_t frameIndex, const SkinnedBlasRefitSettings& refitSettings);
+    void GetSkinnedBlasStats(std::vector<SkinnedBlasStats>& stats) const;
     void BuildTopLevelAccelStruct(nvrhi::ICommandList* commandList);
+
+    // Builds or refits the hierarchy over the mesh instance bounds, call after RefreshSceneGraph.
+    // The instances in the hierarchy are indexed like GetSceneGraph()->GetMeshInstances().
+    void UpdateInstanceBvh();
+    [[nodiscard]] const SceneInstanceBvh& GetInstanceBvh() const;
+
+    // Executor used to update the TLAS instances in parallel, may be null
+    void SetExecutor(tf::Executor* executor);
     void NextFrame();
     void Animate(float  fElapsedTimeSeconds);
 
+    // Absolute animation clock, used to replay recorded frames. The animations except the benchmark one are
+    // sampled in parallel by AnimationEvaluator and written to the nodes in channel order.
+    [[nodiscard]] double GetAnimationTime() const;
+    void SetAnimationTime(double time);
+
     nvrhi::rt::IAccelStruct* GetTopLevelAS() const;
     nvrhi::rt::IAccelStruct* GetPrevTopLevelAS() const;
 
     std::vector<std::string>& GetEnvironmentMaps();
 
 private:
+    uint64_t HashSceneSources(const std::filesystem::path& jsonFileName) const;
+    bool LoadSceneCache(const std::filesystem::path& cacheFileName, uint64_t sourceHash);
+    bool WriteSceneCache(const std::filesystem::path& cacheFileName, uint64_t sourceHash) const;
+
+    void BuildAnimationEvaluator();
+    void BuildTlasInstanceCache();
+    void UpdateTlasInstances();
+
+    // Static BLAS'es that are created but not built yet, the mesh gets its accelStruct once the build is recorded
+    struct PendingBlas
+    {
+        donut::engine::MeshInfo* mesh = nullptr;
+        nvrhi::rt::AccelStructHandle accelStruct;
+    };
+
     nvrhi::rt::AccelStructHandle m_topLevelAS;
     nvrhi::rt::AccelStructHandle m_prevTopLevelAS;
     std::vector<nvrhi::rt::InstanceDesc> m_tlasInstances;
+    std::vector<const donut::engine::MeshInstance*> m_tlasInstanceSources;  // mesh instance of each descriptor
+    size_t m_tlasInstanceCacheSourceCount = 0;
+    bool m_tlasInstanceCacheValid = false;
+    tf::Executor* m_executor = nullptr;
+
+    std::vector<std::vector<PendingBlas>> m_pendingBlasBatches;
+    size_t m_nextBlasBatch = 0;
+    std::vector<donut::engine::MeshInfo*> m_uncompactedBlasMeshes;  // built static BLAS'es that compaction will move
+    bool m_compactStaticBLASes = false;
+    uint64_t m_accelStructHeapSize = 0;
+
+    SceneInstanceBvh m_instanceBvh;
+    bool m_instanceBvhValid = false;
+    uint64_t m_staticBlasMemory = 0;
+
+    // Channel that drives one track of m_animationEvaluator, indexed like the tracks
+    struct AnimatedChannel
+    {
+        donut::engine::SceneGraphNode* node = nullptr;
+        donut::engine::AnimationAttribute attribute = donut::engine::AnimationAttribute::Undefined;
+    };
+
+    AnimationEvaluator m_animationEvaluator;
+    std::vector<AnimatedChannel> m_animatedChannels;
+    std::vector<donut::engine::SceneGraphAnimation*> m_animationClocks;   // one clock per animation
+    std::vector<float> m_animationClockTimes;
+    // Channels that don't animate a transform, applied by donut after the evaluated ones: (clock, channel)
+    std::vector<std::pair<uint32_t, const donut::engine::SceneGraphAnimationChannel*>> m_otherAnimationChannels;
+    bool m_animationEvaluatorValid = false;
+
     std::shared_ptr<donut::engine::SceneGraphAnimation> m_benchmarkAnimation;
     std::shared_ptr<donut::engine::PerspectiveCamera> m_benchmarkCamera;
 
@@ -128,4 +234,7 @@ private:
     double m_wallclockTime = 0;
 
     std::vector<std::string> m_environmentMaps;
+
+    std::filesystem::path m_sceneCacheDirectory;
+    bool m_loadedFromCache = false;
 };
@@ -0,0 +1,387 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "SceneCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr uint32_t c_Magic = 0x43534452; // "RDSC"
+static constexpr uint64_t c_SectionAlignment = 64;
+static constexpr uint64_t c_VertexDataAlignment = 16;
+
+static constexpr uint64_t c_Prime1 = 0x9e3779b185ebca87ull;
+static constexpr uint64_t c_Prime2 = 0xc2b2ae3d27d4eb4full;
+static constexpr uint64_t c_Prime3 = 0x165667b19e3779f9ull;
+
+struct FileHeader
+{
+    uint32_t magic = c_Magic;
+    uint32_t version = SceneCacheWriter::Version;
+    uint64_t sourceHash = 0;
+    uint64_t fileSize = 0;
+    uint32_t sectionCount = 0;
+    uint32_t reserved = 0;
+};
+
+struct FileSection
+{
+    uint32_t id = 0;
+    uint32_t elementSize = 1;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+static constexpr uint64_t c_SectionCount = uint64_t(SceneCacheSectionId::Count);
+static constexpr uint64_t c_TableSize = sizeof(FileHeader) + sizeof(FileSection) * c_SectionCount;
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t RotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t MixLane(uint64_t lane, uint64_t word)
+{
+    return RotateLeft(lane + word * c_Prime2, 31) * c_Prime1;
+}
+
+void SceneCacheHasher::Update(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    m_totalSize += size;
+
+    // Complete the stripe that the previous call left unfinished
+    if (m_tailSize > 0)
+    {
+        const size_t copySize = std::min(size, sizeof(m_tail) - m_tailSize);
+        memcpy(m_tail + m_tailSize, bytes, copySize);
+        m_tailSize += copySize;
+        bytes += copySize;
+        size -= copySize;
+
+        if (m_tailSize < sizeof(m_tail))
+            return;
+
+        for (int lane = 0; lane < 4; lane++)
+        {
+            uint64_t word;
+            memcpy(&word, m_tail + lane * 8, 8);
+            m_lanes[lane] = MixLane(m_lanes[lane], word);
+        }
+        m_tailSize = 0;
+    }
+
+    // Four independent lanes over 32-byte stripes
+    while (size >= sizeof(m_tail))
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + lane * 8, 8);
+            m_lanes[lane] = MixLane(m_lanes[lane], word);
+        }
+        bytes += sizeof(m_tail);
+        size -= sizeof(m_tail);
+    }
+
+    memcpy(m_tail, bytes, size);
+    m_tailSize = size;
+}
+
+uint64_t SceneCacheHasher::GetHash() const
+{
+    uint64_t hash = RotateLeft(m_lanes[0], 1) + RotateLeft(m_lanes[1], 7) + RotateLeft(m_lanes[2], 12) + RotateLeft(m_lanes[3], 18);
+    hash ^= m_totalSize * c_Prime3;
+
+    for (size_t index = 0; index < m_tailSize; index++)
+        hash = RotateLeft(hash ^ (m_tail[index] * c_Prime3), 11) * c_Prime1;
+
+    hash ^= hash >> 33;
+    hash *= c_Prime2;
+    hash ^= hash >> 29;
+    hash *= c_Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint32_t SceneCacheStringTable::Add(const std::string& string)
+{
+    auto found = m_offsets.find(string);
+    if (found != m_offsets.end())
+        return found->second;
+
+    const uint32_t offset = uint32_t(m_data.size());
+    m_data.insert(m_data.end(), string.begin(), string.end());
+    m_data.push_back(0);
+    m_offsets[string] = offset;
+    return offset;
+}
+
+const std::vector<char>& SceneCacheStringTable::GetData() const
+{
+    return m_data;
+}
+
+uint64_t AppendSceneCacheData(std::vector<uint8_t>& vertexData, const void* data, size_t size)
+{
+    if (size == 0)
+        return c_SceneCacheNoData;
+
+    const uint64_t offset = AlignUp(vertexData.size(), c_VertexDataAlignment);
+    vertexData.resize(offset + size);
+    memcpy(vertexData.data() + offset, data, size);
+    return offset;
+}
+
+void SceneCacheWriter::AddSection(SceneCacheSectionId id, const void* data, size_t size, uint32_t elementSize)
+{
+    Section& section = m_sections[uint32_t(id)];
+    section.data = data;
+    section.size = size;
+    section.elementSize = elementSize;
+}
+
+bool SceneCacheWriter::Write(const std::filesystem::path& path, uint64_t sourceHash) const
+{
+    FileSection table[c_SectionCount];
+    uint64_t offset = AlignUp(c_TableSize, c_SectionAlignment);
+
+    for (uint32_t id = 0; id < c_SectionCount; id++)
+    {
+        table[id].id = id;
+        table[id].elementSize = m_sections[id].elementSize;
+        table[id].offset = offset;
+        table[id].size = m_sections[id].size;
+        offset = AlignUp(offset + m_sections[id].size, c_SectionAlignment);
+    }
+
+    FileHeader header;
+    header.sourceHash = sourceHash;
+    header.fileSize = offset;
+    header.sectionCount = uint32_t(c_SectionCount);
+
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream)
+            return false;
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(table), sizeof(table));
+
+        static const char padding[c_SectionAlignment] = {};
+        uint64_t position = c_TableSize;
+
+        for (uint32_t id = 0; id < c_SectionCount; id++)
+        {
+            stream.write(padding, std::streamsize(table[id].offset - position));
+            if (m_sections[id].size)
+                stream.write(static_cast<const char*>(m_sections[id].data), std::streamsize(m_sections[id].size));
+            position = table[id].offset + table[id].size;
+        }
+
+        stream.write(padding, std::streamsize(header.fileSize - position));
+
+        if (!stream)
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+SceneCacheFile::~SceneCacheFile()
+{
+    Close();
+}
+
+bool SceneCacheFile::Fail(const std::string& error)
+{
+    Close();
+    m_error = error;
+    return false;
+}
+
+bool SceneCacheFile::Open(const std::filesystem::path& path, uint64_t expectedSourceHash)
+{
+    Close();
+    m_error.clear();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return Fail("cannot open the file");
+    m_fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < LONGLONG(c_TableSize))
+        return Fail("the file is too small");
+    m_size = size_t(fileSize.QuadPart);
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+        return Fail("cannot map the file");
+    m_mappingHandle = mapping;
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data)
+        return Fail("cannot map the file");
+#else
+    m_fileDescriptor = open(path.c_str(), O_RDONLY);
+    if (m_fileDescriptor < 0)
+        return Fail("cannot open the file");
+
+    struct stat fileStat;
+    if (fstat(m_fileDescriptor, &fileStat) != 0 || uint64_t(fileStat.st_size) < c_TableSize)
+        return Fail("the file is too small");
+    m_size = size_t(fileStat.st_size);
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+    if (data == MAP_FAILED)
+        return Fail("cannot map the file");
+    m_data = static_cast<const uint8_t*>(data);
+#endif
+
+    FileHeader header;
+    memcpy(&header, m_data, sizeof(header));
+
+    if (header.magic != c_Magic)
+        return Fail("not a scene cache file");
+
+    if (header.version != SceneCacheWriter::Version)
+        return Fail("the file was written by a different version");
+
+    if (header.sourceHash != expectedSourceHash)
+        return Fail("the scene source files have changed");
+
+    if (header.fileSize != m_size || header.sectionCount != c_SectionCount)
+        return Fail("the file is truncated or corrupt");
+
+    const FileSection* table = reinterpret_cast<const FileSection*>(m_data + sizeof(FileHeader));
+    for (uint32_t id = 0; id < c_SectionCount; id++)
+    {
+        const FileSection& section = table[id];
+        const bool valid = section.id == id
+            && section.elementSize != 0
+            && section.offset % c_SectionAlignment == 0
+            && section.offset >= c_TableSize
+            && section.offset <= m_size
+            && section.size <= m_size - section.offset
+            && section.size % section.elementSize == 0;
+
+        if (!valid)
+            return Fail("the section table is corrupt");
+    }
+
+    // The strings are read as C strings, the last one must be terminated
+    size_t stringsSize = 0;
+    const char* strings = static_cast<const char*>(GetSectionData(SceneCacheSectionId::Strings, 1, stringsSize));
+    if (stringsSize != 0 && strings[stringsSize - 1] != 0)
+        return Fail("the string section is corrupt");
+
+    return true;
+}
+
+void SceneCacheFile::Close()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mappingHandle)
+        CloseHandle(m_mappingHandle);
+    if (m_fileHandle)
+        CloseHandle(m_fileHandle);
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    if (m_data)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    if (m_fileDescriptor >= 0)
+        close(m_fileDescriptor);
+    m_fileDescriptor = -1;
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool SceneCacheFile::IsOpen() const
+{
+    return m_data != nullptr;
+}
+
+const void* SceneCacheFile::GetSectionData(SceneCacheSectionId id, uint32_t elementSize, size_t& size) const
+{
+    size = 0;
+    if (!m_data || uint32_t(id) >= c_SectionCount)
+        return nullptr;
+
+    const FileSection& section = reinterpret_cast<const FileSection*>(m_data + sizeof(FileHeader))[uint32_t(id)];
+    if (section.elementSize != elementSize)
+        return nullptr;
+
+    size = size_t(section.size);
+    return m_data + section.offset;
+}
+
+const char* SceneCacheFile::GetString(uint32_t offset) const
+{
+    size_t size = 0;
+    const char* strings = static_cast<const char*>(GetSectionData(SceneCacheSectionId::Strings, 1, size));
+    if (!strings || offset >= size)
+        return nullptr;
+
+    return strings + offset;
+}
+
+const void* SceneCacheFile::GetVertexData(uint64_t offset, size_t size) const
+{
+    size_t sectionSize = 0;
+    const uint8_t* vertexData = static_cast<const uint8_t*>(GetSectionData(SceneCacheSectionId::VertexData, 1, sectionSize));
+    if (!vertexData || offset > sectionSize || size > sectionSize - offset)
+        return nullptr;
+
+    return vertexData + offset;
+}
+
+const std::string& SceneCacheFile::GetError() const
+{
+    return m_error;
+}
@@ -0,0 +1,307 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Preprocessed binary form of a loaded scene, used to skip the JSON and glTF parsing at startup.
+//
+// The file is a header, a table of sections, and the section payloads. Every section is an array of
+// fixed-size records, or raw bytes, starting at a 64-byte aligned offset, so the file can be memory
+// mapped and the records and vertex arrays used in place, without any parsing. Records reference
+// other records by index, strings by their offset in the string section, and vertex arrays by their
+// offset in the vertex data section, which is laid out the way the vertex buffers are uploaded.
+// The header stores a hash of the source files; a cache with a different hash is ignored.
+//
+// This module only deals with the file format. SampleScene maps the records to and from the scene graph.
+
+constexpr uint32_t c_SceneCacheNone = ~0u;
+
+enum class SceneCacheSectionId : uint32_t
+{
+    Strings,
+    Nodes,
+    BufferGroups,
+    Meshes,
+    Geometries,
+    Materials,
+    Lights,
+    Cameras,
+    Animations,
+    AnimationChannels,
+    Keyframes,
+    VertexData,
+
+    Count
+};
+
+enum class SceneCacheLeafType : uint32_t
+{
+    None,
+    MeshInstance,
+    Light,
+    Camera,
+    Animation
+};
+
+struct SceneCacheNode
+{
+    uint32_t name = c_SceneCacheNone;       // string offset
+    uint32_t parent = c_SceneCacheNone;     // node index, parents come before their children
+    SceneCacheLeafType leafType = SceneCacheLeafType::None;
+    uint32_t leafIndex = c_SceneCacheNone;  // index into the section of the leaf type
+    double translation[3] = { 0.0, 0.0, 0.0 };
+    double rotation[4] = { 0.0, 0.0, 0.0, 1.0 };    // x, y, z, w
+    double scaling[3] = { 1.0, 1.0, 1.0 };
+};
+
+// Offsets into the vertex data section, c_SceneCacheNoData for missing attributes
+constexpr uint64_t c_SceneCacheNoData = ~0ull;
+
+struct SceneCacheBufferGroup
+{
+    uint64_t indexData = c_SceneCacheNoData;        // uint32_t per index
+    uint64_t positionData = c_SceneCacheNoData;     // float3 per vertex
+    uint64_t texcoord1Data = c_SceneCacheNoData;    // float2 per vertex
+    uint64_t normalData = c_SceneCacheNoData;       // packed uint32_t per vertex
+    uint64_t tangentData = c_SceneCacheNoData;      // packed uint32_t per vertex
+    uint32_t indexCount = 0;
+    uint32_t vertexCount = 0;
+};
+
+struct SceneCacheMesh
+{
+    uint32_t name = c_SceneCacheNone;
+    uint32_t bufferGroup = c_SceneCacheNone;
+    uint32_t firstGeometry = 0;
+    uint32_t geometryCount = 0;
+    uint32_t indexOffset = 0;
+    uint32_t vertexOffset = 0;
+    uint32_t totalIndices = 0;
+    uint32_t totalVertices = 0;
+    float boundsMin[3] = { 0.f, 0.f, 0.f };
+    float boundsMax[3] = { 0.f, 0.f, 0.f };
+};
+
+struct SceneCacheGeometry
+{
+    uint32_t material = c_SceneCacheNone;
+    uint32_t indexOffsetInMesh = 0;
+    uint32_t vertexOffsetInMesh = 0;
+    uint32_t numIndices = 0;
+    uint32_t numVertices = 0;
+    float boundsMin[3] = { 0.f, 0.f, 0.f };
+    float boundsMax[3] = { 0.f, 0.f, 0.f };
+};
+
+enum class SceneCacheTexture : uint32_t
+{
+    BaseOrDiffuse,
+    MetalRoughOrSpecular,
+    Normal,
+    Emissive,
+    Occlusion,
+    Transmission,
+
+    Count
+};
+
+constexpr uint32_t SceneCacheMaterialFlags_DoubleSided = 0x01;
+constexpr uint32_t SceneCacheMaterialFlags_UseSpecularGlossModel = 0x02;
+
+struct SceneCacheMaterial
+{
+    uint32_t name = c_SceneCacheNone;
+    uint32_t domain = 0;
+    uint32_t flags = 0;
+    uint32_t textures[uint32_t(SceneCacheTexture::Count)] = {   // string offsets of the texture paths
+        c_SceneCacheNone, c_SceneCacheNone, c_SceneCacheNone, c_SceneCacheNone, c_SceneCacheNone, c_SceneCacheNone };
+    float baseOrDiffuseColor[3] = { 1.f, 1.f, 1.f };
+    float specularColor[3] = { 0.f, 0.f, 0.f };
+    float emissiveColor[3] = { 0.f, 0.f, 0.f };
+    float emissiveIntensity = 1.f;
+    float metalness = 0.f;
+    float roughness = 0.f;
+    float opacity = 1.f;
+    float alphaCutoff = 0.5f;
+    float transmissionFactor = 0.f;
+    float normalTextureScale = 1.f;
+    float occlusionStrength = 1.f;
+};
+
+// The meaning of the parameters depends on the light type, see SampleScene.cpp
+struct SceneCacheLight
+{
+    int32_t lightType = 0;
+    uint32_t profileName = c_SceneCacheNone;
+    float color[3] = { 1.f, 1.f, 1.f };
+    float parameters[8] = {};
+};
+
+struct SceneCacheCamera
+{
+    float zNear = 1.f;
+    float zFar = 0.f;           // 0 for an infinite far plane
+    float verticalFov = 1.f;
+    float aspectRatio = 0.f;    // 0 for the aspect ratio of the viewport
+};
+
+struct SceneCacheAnimation
+{
+    uint32_t name = c_SceneCacheNone;
+    uint32_t firstChannel = 0;
+    uint32_t channelCount = 0;
+};
+
+struct SceneCacheAnimationChannel
+{
+    uint32_t targetNode = c_SceneCacheNone;
+    uint32_t attribute = 0;
+    uint32_t interpolation = 0;
+    uint32_t firstKeyframe = 0;
+    uint32_t keyframeCount = 0;
+};
+
+struct SceneCacheKeyframe
+{
+    float time = 0.f;
+    float value[4] = {};
+    float inTangent[4] = {};
+    float outTangent[4] = {};
+};
+
+// Read-only view of the records of one section
+template<typename T>
+struct SceneCacheArray
+{
+    const T* data = nullptr;
+    size_t count = 0;
+
+    [[nodiscard]] const T* begin() const { return data; }
+    [[nodiscard]] const T* end() const { return data + count; }
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+    const T& operator[](size_t index) const { return data[index]; }
+};
+
+// Incremental 64-bit hash of the scene source files
+class SceneCacheHasher
+{
+public:
+    void Update(const void* data, size_t size);
+    [[nodiscard]] uint64_t GetHash() const;
+
+private:
+    uint64_t m_lanes[4] = { 0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull };
+    uint8_t m_tail[32] = {};
+    size_t m_tailSize = 0;
+    uint64_t m_totalSize = 0;
+};
+
+// Deduplicating builder of the string section
+class SceneCacheStringTable
+{
+public:
+    uint32_t Add(const std::string& string);
+    [[nodiscard]] const std::vector<char>& GetData() const;
+
+private:
+    std::vector<char> m_data;
+    std::unordered_map<std::string, uint32_t> m_offsets;
+};
+
+// Appends an array to the vertex data section at a 16-byte aligned offset and returns the offset,
+// or c_SceneCacheNoData if the array is empty.
+uint64_t AppendSceneCacheData(std::vector<uint8_t>& vertexData, const void* data, size_t size);
+
+class SceneCacheWriter
+{
+public:
+    static constexpr uint32_t Version = 1;
+
+    void AddSection(SceneCacheSectionId id, const void* data, size_t size, uint32_t elementSize);
+
+    template<typename T>
+    void AddSection(SceneCacheSectionId id, const std::vector<T>& elements)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Scene cache records must be trivially copyable");
+        AddSection(id, elements.data(), elements.size() * sizeof(T), uint32_t(sizeof(T)));
+    }
+
+    // Writes the file through a temporary file that replaces the destination when it's complete.
+    bool Write(const std::filesystem::path& path, uint64_t sourceHash) const;
+
+private:
+    struct Section
+    {
+        const void* data = nullptr;
+        size_t size = 0;
+        uint32_t elementSize = 1;
+    };
+
+    Section m_sections[uint32_t(SceneCacheSectionId::Count)];
+};
+
+// Memory-mapped cache file. The sections stay valid while the file is open.
+class SceneCacheFile
+{
+public:
+    SceneCacheFile() = default;
+    ~SceneCacheFile();
+
+    SceneCacheFile(const SceneCacheFile&) = delete;
+    SceneCacheFile& operator=(const SceneCacheFile&) = delete;
+
+    // Maps the file and validates the header and the section table. Fails if the file was written
+    // by a different version or from different source files.
+    bool Open(const std::filesystem::path& path, uint64_t expectedSourceHash);
+    void Close();
+
+    [[nodiscard]] bool IsOpen() const;
+
+    template<typename T>
+    [[nodiscard]] SceneCacheArray<T> GetSection(SceneCacheSectionId id) const
+    {
+        size_t size = 0;
+        const void* data = GetSectionData(id, uint32_t(sizeof(T)), size);
+        return { static_cast<const T*>(data), size / sizeof(T) };
+    }
+
+    // Returns nullptr if the offset is not inside the string section
+    [[nodiscard]] const char* GetString(uint32_t offset) const;
+
+    // Returns nullptr if the range is not inside the vertex data section
+    [[nodiscard]] const void* GetVertexData(uint64_t offset, size_t size) const;
+
+    // Why the last Open call failed
+    [[nodiscard]] const std::string& GetError() const;
+
+private:
+    const void* GetSectionData(SceneCacheSectionId id, uint32_t elementSize, size_t& size) const;
+    bool Fail(const std::string& error);
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_error;
+
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#else
+    int m_fileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,515 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "SceneInstanceBvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <numeric>
+#include <random>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE__)
+#include <xmmintrin.h>
+#define INSTANCE_BVH_SSE 1
+#else
+#define INSTANCE_BVH_SSE 0
+#endif
+
+InstanceBounds InstanceBounds::Empty()
+{
+    // Finite values keep the plane distances finite, so an empty box is outside of every plane
+    InstanceBounds bounds;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        bounds.minimum[axis] = FLT_MAX;
+        bounds.maximum[axis] = -FLT_MAX;
+    }
+    return bounds;
+}
+
+void SceneInstanceBvh::Build(const std::vector<InstanceBounds>& bounds)
+{
+    m_bounds = bounds;
+    m_nodes.clear();
+    m_parents.clear();
+    m_dirtyNodes.clear();
+
+    m_primitives.resize(bounds.size());
+    std::iota(m_primitives.begin(), m_primitives.end(), 0u);
+    m_leafSlots.assign(bounds.size(), 0);
+
+    if (bounds.empty())
+        return;
+
+    // Centroids of empty boxes are meaningless, put them at the origin
+    std::vector<float> centroids(bounds.size() * 3);
+    for (size_t index = 0; index < bounds.size(); index++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const bool empty = bounds[index].minimum[axis] > bounds[index].maximum[axis];
+            centroids[index * 3 + axis] = empty ? 0.f : (bounds[index].minimum[axis] + bounds[index].maximum[axis]) * 0.5f;
+        }
+    }
+
+    m_nodes.reserve(bounds.size() / 2 + 1);
+    m_parents.reserve(bounds.size() / 2 + 1);
+    m_parents.push_back(c_NoParent);
+    BuildNode(0, uint32_t(bounds.size()), centroids);
+
+    // Children are always stored after their parents, so the boxes can be computed in reverse order
+    for (size_t nodeIndex = m_nodes.size(); nodeIndex-- > 0; )
+    {
+        Node& node = m_nodes[nodeIndex];
+        for (uint32_t slot = 0; slot < c_Width; slot++)
+        {
+            SetChildBounds(node, slot, node.first[slot], node.count[slot]);
+
+            if (node.child[slot] != c_LeafChild)
+                continue;
+
+            for (uint32_t index = node.first[slot]; index < node.first[slot] + node.count[slot]; index++)
+                m_leafSlots[m_primitives[index]] = uint32_t(nodeIndex) * c_Width + slot;
+        }
+    }
+
+    m_dirtySlots.assign(m_nodes.size(), 0);
+}
+
+uint32_t SceneInstanceBvh::BuildNode(uint32_t begin, uint32_t end, std::vector<float>& centroids)
+{
+    const uint32_t nodeIndex = uint32_t(m_nodes.size());
+    m_nodes.emplace_back();
+
+    // Split the range in two, then split both halves again, at the centroid median of the longest axis
+    uint32_t bounds[c_Width + 1] = { begin, 0, (begin + end) / 2, 0, end };
+
+    auto split = [this, &centroids](uint32_t splitBegin, uint32_t splitEnd)
+    {
+        const uint32_t middle = (splitBegin + splitEnd) / 2;
+        if (splitEnd - splitBegin < 2)
+            return middle;
+
+        float lower[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float upper[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (uint32_t index = splitBegin; index < splitEnd; index++)
+        {
+            const float* centroid = &centroids[m_primitives[index] * 3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                lower[axis] = std::min(lower[axis], centroid[axis]);
+                upper[axis] = std::max(upper[axis], centroid[axis]);
+            }
+        }
+
+        int axis = 0;
+        if (upper[1] - lower[1] > upper[axis] - lower[axis]) axis = 1;
+        if (upper[2] - lower[2] > upper[axis] - lower[axis]) axis = 2;
+
+        std::nth_element(m_primitives.begin() + splitBegin, m_primitives.begin() + middle, m_primitives.begin() + splitEnd,
+            [&centroids, axis](uint32_t a, uint32_t b) { return centroids[a * 3 + axis] < centroids[b * 3 + axis]; });
+
+        return middle;
+    };
+
+    bounds[2] = split(bounds[0], bounds[4]);
+    bounds[1] = split(bounds[0], bounds[2]);
+    bounds[3] = split(bounds[2], bounds[4]);
+
+    for (uint32_t slot = 0; slot < c_Width; slot++)
+    {
+        const uint32_t first = bounds[slot];
+        const uint32_t count = bounds[slot + 1] - first;
+
+        uint32_t child = c_LeafChild;
+        if (count > c_MaxLeafSize)
+        {
+            m_parents.push_back(nodeIndex * c_Width + slot);
+            child = BuildNode(first, first + count, centroids);
+        }
+
+        // m_nodes may have been reallocated by the recursion
+        Node& node = m_nodes[nodeIndex];
+        node.child[slot] = child;
+        node.first[slot] = first;
+        node.count[slot] = count;
+    }
+
+    return nodeIndex;
+}
+
+void SceneInstanceBvh::SetChildBounds(Node& node, uint32_t slot, uint32_t first, uint32_t count) const
+{
+    InstanceBounds merged = InstanceBounds::Empty();
+
+    if (node.child[slot] == c_LeafChild)
+    {
+        for (uint32_t index = first; index < first + count; index++)
+        {
+            const InstanceBounds& bounds = m_bounds[m_primitives[index]];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                merged.minimum[axis] = std::min(merged.minimum[axis], bounds.minimum[axis]);
+                merged.maximum[axis] = std::max(merged.maximum[axis], bounds.maximum[axis]);
+            }
+        }
+    }
+    else
+    {
+        const Node& child = m_nodes[node.child[slot]];
+        for (uint32_t childSlot = 0; childSlot < c_Width; childSlot++)
+        {
+            merged.minimum[0] = std::min(merged.minimum[0], child.minX[childSlot]);
+            merged.minimum[1] = std::min(merged.minimum[1], child.minY[childSlot]);
+            merged.minimum[2] = std::min(merged.minimum[2], child.minZ[childSlot]);
+            merged.maximum[0] = std::max(merged.maximum[0], child.maxX[childSlot]);
+            merged.maximum[1] = std::max(merged.maximum[1], child.maxY[childSlot]);
+            merged.maximum[2] = std::max(merged.maximum[2], child.maxZ[childSlot]);
+        }
+    }
+
+    node.minX[slot] = merged.minimum[0];
+    node.minY[slot] = merged.minimum[1];
+    node.minZ[slot] = merged.minimum[2];
+    node.maxX[slot] = merged.maximum[0];
+    node.maxY[slot] = merged.maximum[1];
+    node.maxZ[slot] = merged.maximum[2];
+}
+
+void SceneInstanceBvh::SetInstanceBounds(uint32_t instance, const InstanceBounds& bounds)
+{
+    if (instance >= m_bounds.size())
+        return;
+
+    InstanceBounds& current = m_bounds[instance];
+    if (std::equal(bounds.minimum, bounds.minimum + 3, current.minimum) && std::equal(bounds.maximum, bounds.maximum + 3, current.maximum))
+        return;
+
+    current = bounds;
+    MarkDirty(m_leafSlots[instance]);
+}
+
+void SceneInstanceBvh::MarkDirty(uint32_t nodeSlot)
+{
+    // Stops at the first slot that is already marked, its ancestors are marked too
+    while (nodeSlot != c_NoParent)
+    {
+        const uint32_t nodeIndex = nodeSlot / c_Width;
+        const uint8_t slotMask = uint8_t(1u << (nodeSlot % c_Width));
+
+        uint8_t& dirtySlots = m_dirtySlots[nodeIndex];
+        if (dirtySlots & slotMask)
+            return;
+
+        if (dirtySlots == 0)
+            m_dirtyNodes.push_back(nodeIndex);
+        dirtySlots |= slotMask;
+
+        nodeSlot = m_parents[nodeIndex];
+    }
+}
+
+void SceneInstanceBvh::Refit()
+{
+    if (m_dirtyNodes.empty())
+        return;
+
+    auto refitNode = [this](uint32_t nodeIndex)
+    {
+        Node& node = m_nodes[nodeIndex];
+        for (uint32_t slot = 0; slot < c_Width; slot++)
+        {
+            if (m_dirtySlots[nodeIndex] & (1u << slot))
+                SetChildBounds(node, slot, node.first[slot], node.count[slot]);
+        }
+        m_dirtySlots[nodeIndex] = 0;
+    };
+
+    // Children are always stored after their parents, so refitting in decreasing node order
+    // computes the boxes of the children before the boxes of their parents. When a large part
+    // of the tree moved, scanning all nodes is cheaper than sorting the dirty ones.
+    if (m_dirtyNodes.size() > m_nodes.size() / 8)
+    {
+        for (size_t nodeIndex = m_nodes.size(); nodeIndex-- > 0; )
+        {
+            if (m_dirtySlots[nodeIndex])
+                refitNode(uint32_t(nodeIndex));
+        }
+    }
+    else
+    {
+        std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end(), std::greater<uint32_t>());
+        for (uint32_t nodeIndex : m_dirtyNodes)
+            refitNode(nodeIndex);
+    }
+
+    m_dirtyNodes.clear();
+}
+
+static bool IntersectsPlanes(const InstanceBounds& bounds, const CullingPlane* planes, uint32_t planeCount)
+{
+    for (uint32_t planeIndex = 0; planeIndex < planeCount; planeIndex++)
+    {
+        const CullingPlane& plane = planes[planeIndex];
+
+        float nearDistance = 0.f;
+        for (int axis = 0; axis < 3; axis++)
+            nearDistance += plane.normal[axis] * ((plane.normal[axis] > 0.f) ? bounds.minimum[axis] : bounds.maximum[axis]);
+
+        if (nearDistance > plane.distance)
+            return false;
+    }
+    return true;
+}
+
+void SceneInstanceBvh::Cull(const CullingPlane* planes, uint32_t planeCount, std::vector<uint32_t>& visibleInstances) const
+{
+    if (m_nodes.empty())
+        return;
+
+    // For every plane, the box corner closest to the inside is picked per axis with the sign of the normal.
+    // The same choice is made for all children, so it is done once per plane and query.
+    struct PlaneSetup
+    {
+        float normal[3];
+        float distance;
+        size_t nearOffset[3];   // offset of the min or max array in a node
+        size_t farOffset[3];
+    };
+
+    PlaneSetup localSetups[c_MaxLocalPlanes];
+    std::vector<PlaneSetup> allocatedSetups;
+    PlaneSetup* setups = localSetups;
+    if (planeCount > c_MaxLocalPlanes)
+    {
+        allocatedSetups.resize(planeCount);
+        setups = allocatedSetups.data();
+    }
+
+    const size_t minOffsets[3] = { offsetof(Node, minX), offsetof(Node, minY), offsetof(Node, minZ) };
+    const size_t maxOffsets[3] = { offsetof(Node, maxX), offsetof(Node, maxY), offsetof(Node, maxZ) };
+
+    for (uint32_t planeIndex = 0; planeIndex < planeCount; planeIndex++)
+    {
+        PlaneSetup& setup = setups[planeIndex];
+        setup.distance = planes[planeIndex].distance;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float normal = planes[planeIndex].normal[axis];
+            setup.normal[axis] = normal;
+            setup.nearOffset[axis] = (normal > 0.f) ? minOffsets[axis] : maxOffsets[axis];
+            setup.farOffset[axis] = (normal > 0.f) ? maxOffsets[axis] : minOffsets[axis];
+        }
+    }
+
+    // Empty boxes don't grow the node boxes, so they can be inside of a node that is entirely visible
+    auto emitRange = [this, &visibleInstances](uint32_t first, uint32_t count)
+    {
+        for (uint32_t index = first; index < first + count; index++)
+        {
+            const uint32_t instance = m_primitives[index];
+            if (m_bounds[instance].minimum[0] <= m_bounds[instance].maximum[0])
+                visibleInstances.push_back(instance);
+        }
+    };
+
+    // Every node pushes at most 3 more entries than it pops, which fits the depth of a 4-wide tree over 2^32 instances
+    uint32_t stack[64];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node = m_nodes[stack[--stackSize]];
+        const char* nodeData = reinterpret_cast<const char*>(&node);
+
+        auto lane = [nodeData](size_t offset) { return reinterpret_cast<const float*>(nodeData + offset); };
+
+        int outsideMask = 0;
+        int insideMask = (1 << c_Width) - 1;
+
+#if INSTANCE_BVH_SSE
+        for (uint32_t planeIndex = 0; planeIndex < planeCount && outsideMask != 0xf; planeIndex++)
+        {
+            const PlaneSetup& setup = setups[planeIndex];
+            const __m128 nx = _mm_set1_ps(setup.normal[0]);
+            const __m128 ny = _mm_set1_ps(setup.normal[1]);
+            const __m128 nz = _mm_set1_ps(setup.normal[2]);
+            const __m128 distance = _mm_set1_ps(setup.distance);
+
+            const __m128 nearDistance = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(nx, _mm_loadu_ps(lane(setup.nearOffset[0]))),
+                _mm_mul_ps(ny, _mm_loadu_ps(lane(setup.nearOffset[1])))),
+                _mm_mul_ps(nz, _mm_loadu_ps(lane(setup.nearOffset[2]))));
+
+            const __m128 farDistance = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(nx, _mm_loadu_ps(lane(setup.farOffset[0]))),
+                _mm_mul_ps(ny, _mm_loadu_ps(lane(setup.farOffset[1])))),
+                _mm_mul_ps(nz, _mm_loadu_ps(lane(setup.farOffset[2]))));
+
+            outsideMask |= _mm_movemask_ps(_mm_cmpgt_ps(nearDistance, distance));
+            insideMask &= _mm_movemask_ps(_mm_cmple_ps(farDistance, distance));
+        }
+#else
+        for (uint32_t planeIndex = 0; planeIndex < planeCount && outsideMask != 0xf; planeIndex++)
+        {
+            const PlaneSetup& setup = setups[planeIndex];
+            for (uint32_t slot = 0; slot < c_Width; slot++)
+            {
+                float nearDistance = 0.f;
+                float farDistance = 0.f;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    nearDistance += setup.normal[axis] * lane(setup.nearOffset[axis])[slot];
+                    farDistance += setup.normal[axis] * lane(setup.farOffset[axis])[slot];
+                }
+
+                if (nearDistance > setup.distance)
+                    outsideMask |= 1 << slot;
+                if (!(farDistance <= setup.distance))
+                    insideMask &= ~(1 << slot);
+            }
+        }
+#endif
+
+        for (uint32_t slot = 0; slot < c_Width; slot++)
+        {
+            if (node.count[slot] == 0 || (outsideMask & (1 << slot)))
+                continue;
+
+            if (insideMask & (1 << slot))
+            {
+                emitRange(node.first[slot], node.count[slot]);
+            }
+            else if (node.child[slot] == c_LeafChild)
+            {
+                // Partially visible leaf, test the instances to get the same result as a linear loop
+                for (uint32_t index = node.first[slot]; index < node.first[slot] + node.count[slot]; index++)
+                {
+                    if (IntersectsPlanes(m_bounds[m_primitives[index]], planes, planeCount))
+                        visibleInstances.push_back(m_primitives[index]);
+                }
+            }
+            else
+            {
+                stack[stackSize++] = node.child[slot];
+            }
+        }
+    }
+}
+
+uint32_t SceneInstanceBvh::GetInstanceCount() const
+{
+    return uint32_t(m_bounds.size());
+}
+
+uint32_t SceneInstanceBvh::GetNodeCount() const
+{
+    return uint32_t(m_nodes.size());
+}
+
+InstanceCullingBenchmarkResult BenchmarkInstanceCulling(uint32_t instanceCount, uint32_t iterations)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+    InstanceCullingBenchmarkResult result;
+    result.instanceCount = instanceCount;
+    iterations = std::max(iterations, 1u);
+
+    // Small boxes scattered over a square city block, viewed from the middle with a 90 degree frustum
+    std::mt19937 rng(1);
+    const float extent = 10.f * std::sqrt(float(instanceCount));
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> size(0.5f, 4.f);
+
+    std::vector<InstanceBounds> bounds(instanceCount);
+    for (InstanceBounds& box : bounds)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float center = (axis == 1) ? size(rng) * 4.f : position(rng);
+            const float halfSize = size(rng);
+            box.minimum[axis] = center - halfSize;
+            box.maximum[axis] = center + halfSize;
+        }
+    }
+
+    // Looking down +Z: left, right, bottom, top, near, far
+    const float s = std::sqrt(0.5f);
+    const CullingPlane planes[6] = {
+        { { -s, 0.f, -s }, 0.f },
+        { { s, 0.f, -s }, 0.f },
+        { { 0.f, -s, -s }, 0.f },
+        { { 0.f, s, -s }, 0.f },
+        { { 0.f, 0.f, -1.f }, -0.1f },
+        { { 0.f, 0.f, 1.f }, extent * 0.5f },
+    };
+
+    std::vector<uint32_t> visible;
+    visible.reserve(instanceCount);
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        visible.clear();
+        for (uint32_t instance = 0; instance < instanceCount; instance++)
+        {
+            if (IntersectsPlanes(bounds[instance], planes, 6))
+                visible.push_back(instance);
+        }
+    }
+    result.linearMs = elapsedMs(start) / iterations;
+    result.visibleCount = uint32_t(visible.size());
+
+    SceneInstanceBvh bvh;
+    start = Clock::now();
+    bvh.Build(bounds);
+    result.buildMs = elapsedMs(start);
+
+    start = Clock::now();
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        visible.clear();
+        bvh.Cull(planes, 6, visible);
+    }
+    result.bvhMs = elapsedMs(start) / iterations;
+
+    // Move a tenth of the instances, as an animated scene would
+    for (uint32_t instance = 0; instance < instanceCount; instance += 10)
+    {
+        InstanceBounds box = bounds[instance];
+        box.minimum[1] += 1.f;
+        box.maximum[1] += 1.f;
+        bvh.SetInstanceBounds(instance, box);
+    }
+
+    start = Clock::now();
+    bvh.Refit();
+    result.refitMs = elapsedMs(start);
+
+    for (uint32_t instance = 0; instance < std::min(instanceCount, 100u); instance++)
+    {
+        InstanceBounds box = bounds[instance];
+        box.minimum[1] += 2.f;
+        box.maximum[1] += 2.f;
+        bvh.SetInstanceBounds(instance, box);
+    }
+
+    start = Clock::now();
+    bvh.Refit();
+    result.refitFewMs = elapsedMs(start);
+
+    return result;
+}
@@ -0,0 +1,109 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// 4-wide bounding volume hierarchy over the world-space bounds of the mesh instances, used to find the
+// instances that intersect a view frustum without testing every instance. Every node stores the boxes
+// of its 4 children in SoA layout so that one plane is tested against all children at once with SSE.
+// The primitives of every subtree are contiguous, so subtrees that are entirely inside the frustum are
+// emitted without visiting them. When instances move, the boxes are refit and the topology is kept:
+// only the nodes on the paths from the moved instances to the root are recomputed.
+
+struct InstanceBounds
+{
+    float minimum[3] = { 0.f, 0.f, 0.f };
+    float maximum[3] = { 0.f, 0.f, 0.f };
+
+    // A box that is never visible, for instances without geometry
+    static InstanceBounds Empty();
+};
+
+// A point is outside of the plane when dot(normal, point) > distance, same as in donut::math::frustum
+struct CullingPlane
+{
+    float normal[3] = { 0.f, 0.f, 0.f };
+    float distance = 0.f;
+};
+
+class SceneInstanceBvh
+{
+public:
+    // Planes that Cull handles without allocating, enough for a frustum and two clip planes
+    static constexpr uint32_t c_MaxLocalPlanes = 8;
+
+    // Builds the hierarchy over the given boxes, indexed by instance.
+    void Build(const std::vector<InstanceBounds>& bounds);
+
+    // Replaces the box of one instance and marks the nodes above it for the next Refit, unless the box
+    // didn't change.
+    void SetInstanceBounds(uint32_t instance, const InstanceBounds& bounds);
+
+    // Recomputes the boxes of the marked nodes, bottom-up. The cost grows with the number of moved instances
+    // and the depth of the tree, not with the size of the scene.
+    void Refit();
+
+    // Appends the indices of the instances whose boxes intersect all planes to visibleInstances.
+    // The result is conservative in the same way as a box-frustum test with the same planes.
+    void Cull(const CullingPlane* planes, uint32_t planeCount, std::vector<uint32_t>& visibleInstances) const;
+
+    [[nodiscard]] uint32_t GetInstanceCount() const;
+    [[nodiscard]] uint32_t GetNodeCount() const;
+
+private:
+    static constexpr uint32_t c_Width = 4;
+    static constexpr uint32_t c_MaxLeafSize = 4;
+    static constexpr uint32_t c_LeafChild = ~0u;
+
+    struct Node
+    {
+        float minX[c_Width];
+        float minY[c_Width];
+        float minZ[c_Width];
+        float maxX[c_Width];
+        float maxY[c_Width];
+        float maxZ[c_Width];
+        uint32_t child[c_Width];    // node index, or c_LeafChild if the child is a leaf
+        uint32_t first[c_Width];    // first primitive of the child's subtree
+        uint32_t count[c_Width];    // number of primitives in the child's subtree, 0 for unused slots
+    };
+
+    uint32_t BuildNode(uint32_t begin, uint32_t end, std::vector<float>& centroids);
+    void SetChildBounds(Node& node, uint32_t slot, uint32_t first, uint32_t count) const;
+    void MarkDirty(uint32_t nodeSlot);
+
+    // Child slots are encoded as node * c_Width + slot
+    static constexpr uint32_t c_NoParent = ~0u;
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_parents;        // slot of the parent that points to the node, by node
+    std::vector<uint8_t> m_dirtySlots;      // mask of the child slots to refit, by node
+    std::vector<uint32_t> m_dirtyNodes;     // nodes with dirty slots
+    std::vector<uint32_t> m_primitives;     // instance indices, in subtree order
+    std::vector<uint32_t> m_leafSlots;      // leaf slot that contains the instance, by instance
+    std::vector<InstanceBounds> m_bounds;   // indexed by instance
+};
+
+struct InstanceCullingBenchmarkResult
+{
+    uint32_t instanceCount = 0;
+    uint32_t visibleCount = 0;
+    double linearMs = 0.0;      // one box-frustum test per instance
+    double bvhMs = 0.0;
+    double buildMs = 0.0;
+    double refitMs = 0.0;       // after moving a tenth of the instances
+    double refitFewMs = 0.0;    // after moving 100 instances, as a scene with a few animated objects would
+};
+
+// Compares the hierarchy with a linear loop on a synthetic scene with the given number of instances.
+InstanceCullingBenchmarkResult BenchmarkInstanceCulling(uint32_t instanceCount, uint32_t iterations);
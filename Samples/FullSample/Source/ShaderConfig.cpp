@@ -0,0 +1,416 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "ShaderConfig.h"
+
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+
+static bool IsLibraryTarget(const std::string& target)
+{
+    return target.compare(0, 3, "lib") == 0;
+}
+
+static std::string Trim(const std::string& text)
+{
+    const size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+        return std::string();
+    const size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string ShaderConfigPermutation::GetKey() const
+{
+    return target + "|" + MakeShaderPermutationKey(source, entryPoint, macros, 0).GetCanonicalString();
+}
+
+ShaderConfigPermutation MakeShaderConfigPermutation(const std::string& source, const std::string& target,
+    const std::string& entryPoint, std::vector<ShaderPermutationMacro> macros)
+{
+    // Libraries export all their entry points, the -E option doesn't select anything
+    const std::string effectiveEntryPoint = IsLibraryTarget(target) ? std::string() : entryPoint.empty() ? std::string("main") : entryPoint;
+    ShaderPermutationKey key = MakeShaderPermutationKey(source, effectiveEntryPoint, std::move(macros), 0);
+
+    ShaderConfigPermutation permutation;
+    permutation.source = std::move(key.shaderPath);
+    permutation.target = target;
+    permutation.entryPoint = std::move(key.entryName);
+    permutation.macros = std::move(key.macros);
+    return permutation;
+}
+
+// Parses "NAME", "NAME=value" or "NAME={a,b}", returns an error message or an empty string
+static std::string ParseDefine(const std::string& text, ShaderConfigDefine& define)
+{
+    const size_t equals = text.find('=');
+    define.name = text.substr(0, equals);
+    define.values.clear();
+
+    if (define.name.empty())
+        return "a define has no name";
+
+    if (equals == std::string::npos)
+    {
+        define.values.push_back(std::string());
+        return std::string();
+    }
+
+    const std::string value = text.substr(equals + 1);
+    if (value.empty())
+        return "define " + define.name + " has an empty value";
+
+    if (value[0] != '{')
+    {
+        define.values.push_back(value);
+        return std::string();
+    }
+
+    if (value.back() != '}')
+        return "define " + define.name + " has an unterminated value set";
+
+    std::stringstream values(value.substr(1, value.size() - 2));
+    std::string item;
+    while (std::getline(values, item, ','))
+    {
+        item = Trim(item);
+        if (item.empty())
+            return "define " + define.name + " has an empty value in its set";
+        if (std::find(define.values.begin(), define.values.end(), item) != define.values.end())
+            return "define " + define.name + " has the value " + item + " twice";
+        define.values.push_back(item);
+    }
+
+    if (define.values.empty() || value[value.size() - 2] == ',')
+        return "define " + define.name + " has an empty value in its set";
+
+    return std::string();
+}
+
+// Returns an error message or an empty string
+static std::string ParseEntry(const std::vector<std::string>& tokens, ShaderConfigEntry& entry)
+{
+    entry.source = tokens[0];
+
+    for (size_t index = 1; index < tokens.size(); index++)
+    {
+        const std::string& token = tokens[index];
+        const bool hasValue = index + 1 < tokens.size();
+
+        if (token == "-T" || token == "-E")
+        {
+            if (!hasValue)
+                return token + " has no value";
+
+            (token == "-T" ? entry.target : entry.entryPoint) = tokens[++index];
+        }
+        else if (token == "-D")
+        {
+            if (!hasValue)
+                return "-D has no value";
+
+            // A value set with spaces after the commas spans several tokens
+            std::string text = tokens[++index];
+            while (text.find('{') != std::string::npos && text.back() != '}' && index + 1 < tokens.size())
+                text += tokens[++index];
+
+            ShaderConfigDefine define;
+            const std::string error = ParseDefine(text, define);
+            if (!error.empty())
+                return error;
+
+            for (const ShaderConfigDefine& existing : entry.defines)
+            {
+                if (existing.name == define.name)
+                    return "define " + define.name + " is given twice";
+            }
+
+            entry.defines.push_back(std::move(define));
+        }
+        else
+        {
+            entry.otherOptions.push_back(token);
+        }
+    }
+
+    if (entry.target.empty())
+        return "the line has no target profile";
+
+    return std::string();
+}
+
+ShaderConfig ParseShaderConfig(const std::string& text)
+{
+    ShaderConfig config;
+
+    std::stringstream lines(text);
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        lineNumber++;
+        line = Trim(line);
+        if (line.empty() || line.compare(0, 2, "//") == 0)
+            continue;
+
+        if (line[0] == '#')
+        {
+            config.errors.push_back("line " + std::to_string(lineNumber) + ": preprocessor lines are not supported");
+            continue;
+        }
+
+        std::vector<std::string> tokens;
+        std::stringstream lineStream(line);
+        std::string token;
+        while (lineStream >> token)
+            tokens.push_back(token);
+
+        ShaderConfigEntry entry;
+        entry.lineNumber = lineNumber;
+        const std::string error = ParseEntry(tokens, entry);
+        if (!error.empty())
+        {
+            config.errors.push_back("line " + std::to_string(lineNumber) + ": " + error);
+            continue;
+        }
+
+        config.entries.push_back(std::move(entry));
+    }
+
+    return config;
+}
+
+std::string WriteShaderConfig(const ShaderConfig& config)
+{
+    std::string text;
+    uint32_t previousLineNumber = 0;
+
+    for (const ShaderConfigEntry& entry : config.entries)
+    {
+        // Keep the groups of lines that were separated in the original file apart
+        if (previousLineNumber != 0 && entry.lineNumber > previousLineNumber + 1)
+            text += '\n';
+        previousLineNumber = entry.lineNumber;
+
+        text += entry.source + " -T " + entry.target;
+        if (!entry.entryPoint.empty())
+            text += " -E " + entry.entryPoint;
+
+        for (const std::string& option : entry.otherOptions)
+            text += " " + option;
+
+        for (const ShaderConfigDefine& define : entry.defines)
+        {
+            text += " -D " + define.name;
+            if (define.values.size() == 1 && define.values[0].empty())
+                continue;
+
+            text += '=';
+            if (define.values.size() == 1)
+            {
+                text += define.values[0];
+                continue;
+            }
+
+            text += '{';
+            for (size_t index = 0; index < define.values.size(); index++)
+                text += (index > 0 ? "," : "") + define.values[index];
+            text += '}';
+        }
+
+        text += '\n';
+    }
+
+    return text;
+}
+
+// Calls visit with the value index of every define, for every combination, the last define varies fastest
+template<typename Visitor>
+static void ForEachCombination(const ShaderConfigEntry& entry, Visitor visit)
+{
+    for (const ShaderConfigDefine& define : entry.defines)
+    {
+        if (define.values.empty())
+            return;
+    }
+
+    std::vector<size_t> indices(entry.defines.size(), 0);
+    while (true)
+    {
+        visit(indices);
+
+        size_t define = indices.size();
+        while (define > 0)
+        {
+            define--;
+            if (++indices[define] < entry.defines[define].values.size())
+                break;
+            indices[define] = 0;
+            if (define == 0)
+                return;
+        }
+
+        if (indices.empty())
+            return;
+    }
+}
+
+static ShaderConfigPermutation MakeEntryPermutation(const ShaderConfigEntry& entry, const std::vector<size_t>& indices)
+{
+    std::vector<ShaderPermutationMacro> macros;
+    for (size_t define = 0; define < entry.defines.size(); define++)
+        macros.push_back({ entry.defines[define].name, entry.defines[define].values[indices[define]] });
+
+    return MakeShaderConfigPermutation(entry.source, entry.target, entry.entryPoint, std::move(macros));
+}
+
+std::vector<ShaderConfigPermutation> ExpandShaderConfigEntry(const ShaderConfigEntry& entry)
+{
+    std::vector<ShaderConfigPermutation> permutations;
+    ForEachCombination(entry, [&entry, &permutations](const std::vector<size_t>& indices)
+    {
+        permutations.push_back(MakeEntryPermutation(entry, indices));
+    });
+    return permutations;
+}
+
+// Appends lines that compile exactly the given combinations, which are distinct and use only the
+// values of the entry. A combination holds one value per define, in the order of the defines.
+static void CoverCombinations(const ShaderConfigEntry& entry, const std::vector<std::vector<std::string>>& combinations,
+    std::vector<ShaderConfigEntry>& lines)
+{
+    if (combinations.empty())
+        return;
+
+    // Reduce every value set to the used values, in their original order
+    ShaderConfigEntry reduced = entry;
+    size_t combinationCount = 1;
+    size_t splitDefine = entry.defines.size();
+    for (size_t define = 0; define < entry.defines.size(); define++)
+    {
+        std::vector<std::string>& values = reduced.defines[define].values;
+        values.erase(std::remove_if(values.begin(), values.end(), [&combinations, define](const std::string& value)
+        {
+            return std::none_of(combinations.begin(), combinations.end(), [&value, define](const std::vector<std::string>& combination)
+            {
+                return combination[define] == value;
+            });
+        }), values.end());
+
+        combinationCount *= values.size();
+        if (values.size() > 1 && splitDefine == entry.defines.size())
+            splitDefine = define;
+    }
+
+    if (combinationCount == combinations.size())
+    {
+        lines.push_back(std::move(reduced));
+        return;
+    }
+
+    // Some reduced combinations are unused: one line per value of the first define that still has several
+    for (const std::string& value : reduced.defines[splitDefine].values)
+    {
+        ShaderConfigEntry part = reduced;
+        part.defines[splitDefine].values = { value };
+
+        std::vector<std::vector<std::string>> partCombinations;
+        for (const std::vector<std::string>& combination : combinations)
+        {
+            if (combination[splitDefine] == value)
+                partCombinations.push_back(combination);
+        }
+
+        CoverCombinations(part, partCombinations, lines);
+    }
+}
+
+ShaderConfigPruneResult PruneShaderConfig(const ShaderConfig& config, const std::vector<ShaderConfigPermutation>& used)
+{
+    ShaderConfigPruneResult result;
+    result.config.errors = config.errors;
+
+    std::unordered_map<std::string, bool> usedKeys; // key -> matched by a line
+    for (const ShaderConfigPermutation& permutation : used)
+        usedKeys.emplace(permutation.GetKey(), false);
+
+    for (const ShaderConfigEntry& entry : config.entries)
+    {
+        std::vector<std::vector<std::string>> combinations;
+        ForEachCombination(entry, [&](const std::vector<size_t>& indices)
+        {
+            auto found = usedKeys.find(MakeEntryPermutation(entry, indices).GetKey());
+            if (found == usedKeys.end())
+            {
+                result.removedPermutations++;
+                return;
+            }
+
+            found->second = true;
+            result.keptPermutations++;
+
+            std::vector<std::string>& combination = combinations.emplace_back();
+            for (size_t define = 0; define < entry.defines.size(); define++)
+                combination.push_back(entry.defines[define].values[indices[define]]);
+        });
+
+        CoverCombinations(entry, combinations, result.config.entries);
+    }
+
+    for (const ShaderConfigPermutation& permutation : used)
+    {
+        auto found = usedKeys.find(permutation.GetKey());
+        if (!found->second)
+        {
+            result.unmatched.push_back(permutation);
+            found->second = true; // report every permutation once
+        }
+    }
+
+    return result;
+}
+
+void ShaderUsageRecorder::Record(ShaderConfigPermutation permutation)
+{
+    if (m_keys.insert(permutation.GetKey()).second)
+        m_permutations.push_back(std::move(permutation));
+}
+
+void ShaderUsageRecorder::Merge(const ShaderConfig& usage)
+{
+    for (const ShaderConfigEntry& entry : usage.entries)
+    {
+        for (ShaderConfigPermutation& permutation : ExpandShaderConfigEntry(entry))
+            Record(std::move(permutation));
+    }
+}
+
+const std::vector<ShaderConfigPermutation>& ShaderUsageRecorder::GetPermutations() const
+{
+    return m_permutations;
+}
+
+ShaderConfig ShaderUsageRecorder::GetUsage() const
+{
+    ShaderConfig usage;
+    for (const ShaderConfigPermutation& permutation : m_permutations)
+    {
+        ShaderConfigEntry& entry = usage.entries.emplace_back();
+        entry.source = permutation.source;
+        entry.target = permutation.target;
+        entry.entryPoint = permutation.entryPoint;
+        entry.lineNumber = uint32_t(usage.entries.size());
+
+        for (const ShaderPermutationMacro& macro : permutation.macros)
+            entry.defines.push_back({ macro.name, { macro.definition } });
+    }
+    return usage;
+}
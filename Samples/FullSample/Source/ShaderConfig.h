@@ -0,0 +1,106 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include "ShaderPermutationCache.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Reader and writer of ShaderMake configuration files (Shaders.cfg), and the pruning of a configuration
+// down to the shader permutations that the application has actually requested.
+//
+// Every line of a configuration names a source file, a target profile (-T), an optional entry point
+// (-E) and any number of defines (-D). A define either has one value, "-D NAME=value", or a set of
+// values, "-D NAME={a,b,c}", and a line stands for every combination of the values of its defines.
+// Lines starting with "//" and blank lines are skipped, other options are kept as they are.
+//
+// Pruning keeps the defines in their original order and covers the used permutations of every line
+// exactly: the value sets are reduced to the used values, and a line whose reduced combinations
+// include unused ones is split by the values of one of its defines until none do. Lines without used
+// permutations are dropped.
+//
+// The module has no dependencies on the renderer.
+
+struct ShaderConfigDefine
+{
+    std::string name;
+    std::vector<std::string> values;    // one empty value for a define without "="
+};
+
+struct ShaderConfigEntry
+{
+    std::string source;
+    std::string target;
+    std::string entryPoint;             // empty when the line has no -E
+    std::vector<ShaderConfigDefine> defines;
+    std::vector<std::string> otherOptions;
+    uint32_t lineNumber = 0;
+};
+
+struct ShaderConfig
+{
+    std::vector<ShaderConfigEntry> entries;
+    std::vector<std::string> errors;    // "line N: message", lines with errors are not in the entries
+};
+
+// One combination of define values of a configuration line, or one shader requested by the application
+struct ShaderConfigPermutation
+{
+    std::string source;                 // relative to the shader directory, normalized
+    std::string target;
+    std::string entryPoint;             // "main" when not given, empty for libraries
+    std::vector<ShaderPermutationMacro> macros; // sorted by name
+
+    // Equal for permutations that select the same compiled shader
+    [[nodiscard]] std::string GetKey() const;
+};
+
+ShaderConfigPermutation MakeShaderConfigPermutation(const std::string& source, const std::string& target,
+    const std::string& entryPoint, std::vector<ShaderPermutationMacro> macros);
+
+ShaderConfig ParseShaderConfig(const std::string& text);
+std::string WriteShaderConfig(const ShaderConfig& config);
+
+// All permutations of a line, the last define varies fastest
+std::vector<ShaderConfigPermutation> ExpandShaderConfigEntry(const ShaderConfigEntry& entry);
+
+struct ShaderConfigPruneResult
+{
+    ShaderConfig config;
+    uint32_t keptPermutations = 0;
+    uint32_t removedPermutations = 0;
+    std::vector<ShaderConfigPermutation> unmatched;    // used permutations that no line compiles
+};
+
+ShaderConfigPruneResult PruneShaderConfig(const ShaderConfig& config, const std::vector<ShaderConfigPermutation>& used);
+
+// Collects the distinct permutations requested by the application, in the order of their first request.
+// Not thread-safe, like the shader factories that report to it.
+class ShaderUsageRecorder
+{
+public:
+    void Record(ShaderConfigPermutation permutation);
+
+    // Adds the permutations of a usage file written by an earlier run
+    void Merge(const ShaderConfig& usage);
+
+    [[nodiscard]] const std::vector<ShaderConfigPermutation>& GetPermutations() const;
+
+    // The permutations as a configuration with one line per permutation
+    [[nodiscard]] ShaderConfig GetUsage() const;
+
+private:
+    std::vector<ShaderConfigPermutation> m_permutations;
+    std::unordered_set<std::string> m_keys;
+};
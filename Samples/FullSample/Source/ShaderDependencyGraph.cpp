@@ -0,0 +1,465 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "ShaderDependencyGraph.h"
+#include "SceneCache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+
+static bool IsShaderFile(const std::filesystem::path& path)
+{
+    const std::string extension = path.extension().string();
+    return extension == ".hlsl" || extension == ".hlsli" || extension == ".h";
+}
+
+static bool ReadShaderFile(const std::filesystem::path& path, std::string& text)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+static uint64_t HashText(const std::string& text)
+{
+    SceneCacheHasher hasher;
+    const uint64_t size = text.size();
+    hasher.Update(&size, sizeof(size));
+    if (!text.empty())
+        hasher.Update(text.data(), text.size());
+    return hasher.GetHash();
+}
+
+// Returns true if the path is inside the directory, both normalized
+static bool GetRelativePath(const std::filesystem::path& path, const std::filesystem::path& directory, std::string& relative)
+{
+    const std::filesystem::path relativePath = path.lexically_relative(directory);
+    if (relativePath.empty() || *relativePath.begin() == "..")
+        return false;
+
+    relative = relativePath.generic_string();
+    return true;
+}
+
+std::vector<ShaderInclude> ScanShaderIncludes(const std::string& text)
+{
+    // Replace the comments with spaces, as the preprocessor does, but keep the line breaks.
+    // String literals are copied as they are, so that "//" inside of one doesn't start a comment.
+    enum class State { Code, LineComment, BlockComment, String };
+
+    std::string code;
+    code.reserve(text.size());
+    State state = State::Code;
+
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        const char c = text[i];
+        const char next = (i + 1 < text.size()) ? text[i + 1] : '\0';
+
+        switch (state)
+        {
+        case State::Code:
+            if (c == '/' && next == '/')
+            {
+                state = State::LineComment;
+                code += ' ';
+                i++;
+            }
+            else if (c == '/' && next == '*')
+            {
+                state = State::BlockComment;
+                code += ' ';
+                i++;
+            }
+            else
+            {
+                if (c == '"')
+                    state = State::String;
+                code += c;
+            }
+            break;
+
+        case State::LineComment:
+            if (c == '\n')
+            {
+                state = State::Code;
+                code += c;
+            }
+            break;
+
+        case State::BlockComment:
+            if (c == '*' && next == '/')
+            {
+                state = State::Code;
+                i++;
+            }
+            else if (c == '\n')
+                code += c;
+            break;
+
+        case State::String:
+            code += c;
+            if (c == '\\' && next != '\0' && next != '\n')
+            {
+                code += next;
+                i++;
+            }
+            else if (c == '"' || c == '\n')
+                state = State::Code;
+            break;
+        }
+    }
+
+    std::vector<ShaderInclude> includes;
+    uint32_t lineNumber = 0;
+    size_t lineStart = 0;
+
+    while (lineStart < code.size())
+    {
+        size_t lineEnd = code.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = code.size();
+        lineNumber++;
+
+        auto skipSpaces = [&code, lineEnd](size_t position)
+        {
+            while (position < lineEnd && (code[position] == ' ' || code[position] == '\t' || code[position] == '\r'))
+                position++;
+            return position;
+        };
+
+        size_t position = skipSpaces(lineStart);
+        if (position < lineEnd && code[position] == '#')
+        {
+            position = skipSpaces(position + 1);
+
+            static const char c_Include[] = "include";
+            const size_t directiveLength = sizeof(c_Include) - 1;
+            if (code.compare(position, directiveLength, c_Include) == 0)
+            {
+                position = skipSpaces(position + directiveLength);
+
+                if (position < lineEnd && (code[position] == '"' || code[position] == '<'))
+                {
+                    const bool angled = code[position] == '<';
+                    const size_t pathEnd = code.find(angled ? '>' : '"', position + 1);
+                    if (pathEnd != std::string::npos && pathEnd < lineEnd && pathEnd > position + 1)
+                    {
+                        ShaderInclude include;
+                        include.path = code.substr(position + 1, pathEnd - position - 1);
+                        include.angled = angled;
+                        include.lineNumber = lineNumber;
+                        includes.push_back(std::move(include));
+                    }
+                }
+            }
+        }
+
+        lineStart = lineEnd + 1;
+    }
+
+    return includes;
+}
+
+bool ShaderDependencyGraph::Build(const std::filesystem::path& sourceDirectory, const std::vector<std::filesystem::path>& includeDirectories)
+{
+    *this = ShaderDependencyGraph();
+
+    std::error_code error;
+    m_sourceDirectory = std::filesystem::absolute(sourceDirectory, error).lexically_normal();
+    if (error || !std::filesystem::is_directory(m_sourceDirectory, error))
+        return false;
+
+    for (const std::filesystem::path& directory : includeDirectories)
+    {
+        const std::filesystem::path absolute = std::filesystem::absolute(directory, error).lexically_normal();
+        if (!error)
+            m_includeDirectories.push_back(absolute);
+    }
+
+    std::vector<std::filesystem::path> paths;
+    for (std::filesystem::recursive_directory_iterator it(m_sourceDirectory, error), end; !error && it != end; it.increment(error))
+    {
+        std::error_code fileError;
+        if (it->is_regular_file(fileError) && IsShaderFile(it->path()))
+            paths.push_back(it->path().lexically_normal());
+    }
+    if (error)
+        return false;
+
+    // Directory iteration order is unspecified, the file order shouldn't be
+    std::sort(paths.begin(), paths.end(), [](const std::filesystem::path& a, const std::filesystem::path& b)
+    {
+        return a.generic_string() < b.generic_string();
+    });
+
+    for (const std::filesystem::path& path : paths)
+        AddFile(path);
+
+    // Files found through includes are appended and scanned by the same loop
+    for (uint32_t index = 0; index < uint32_t(m_files.size()); index++)
+    {
+        std::string text;
+        const bool read = ReadShaderFile(m_files[index].path, text);
+        m_files[index].contentHash = read ? HashText(text) : 0;
+
+        for (const ShaderInclude& include : ScanShaderIncludes(text))
+        {
+            std::filesystem::path resolved;
+            if (!ResolveInclude(m_files[index], include, resolved))
+            {
+                m_unresolvedIncludes.push_back({ m_files[index].name, include });
+                continue;
+            }
+
+            const uint32_t includedIndex = AddFile(resolved);
+            std::vector<uint32_t>& includes = m_files[index].includes;
+            if (std::find(includes.begin(), includes.end(), includedIndex) == includes.end())
+                includes.push_back(includedIndex);
+        }
+    }
+
+    return true;
+}
+
+uint32_t ShaderDependencyGraph::AddFile(const std::filesystem::path& path)
+{
+    const std::string key = path.generic_string();
+    auto existing = m_pathIndices.find(key);
+    if (existing != m_pathIndices.end())
+        return existing->second;
+
+    File file;
+    file.path = path;
+    file.name = GetFileName(path);
+    // The same relative name in two directories, keep the names unique
+    if (m_fileIndices.count(file.name))
+        file.name = key;
+
+    std::string relative;
+    file.source = path.extension() == ".hlsl" && GetRelativePath(path, m_sourceDirectory, relative);
+
+    const uint32_t index = uint32_t(m_files.size());
+    m_pathIndices[key] = index;
+    m_fileIndices[file.name] = index;
+    m_files.push_back(std::move(file));
+    return index;
+}
+
+std::string ShaderDependencyGraph::GetFileName(const std::filesystem::path& path) const
+{
+    std::string relative;
+    if (GetRelativePath(path, m_sourceDirectory, relative))
+        return relative;
+
+    for (const std::filesystem::path& directory : m_includeDirectories)
+    {
+        if (GetRelativePath(path, directory, relative))
+            return relative;
+    }
+
+    return path.generic_string();
+}
+
+bool ShaderDependencyGraph::ResolveInclude(const File& file, const ShaderInclude& include, std::filesystem::path& resolved) const
+{
+    std::vector<std::filesystem::path> candidates;
+    if (!include.angled)
+        candidates.push_back(file.path.parent_path() / include.path);
+    for (const std::filesystem::path& directory : m_includeDirectories)
+        candidates.push_back(directory / include.path);
+
+    for (const std::filesystem::path& candidate : candidates)
+    {
+        std::error_code error;
+        if (std::filesystem::is_regular_file(candidate, error))
+        {
+            resolved = candidate.lexically_normal();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t ShaderDependencyGraph::GetFileCount() const
+{
+    return m_files.size();
+}
+
+bool ShaderDependencyGraph::HasFile(const std::string& name) const
+{
+    return m_fileIndices.count(name) != 0;
+}
+
+std::vector<std::string> ShaderDependencyGraph::GetSources() const
+{
+    std::vector<std::string> sources;
+    for (const File& file : m_files)
+    {
+        if (file.source)
+            sources.push_back(file.name);
+    }
+
+    std::sort(sources.begin(), sources.end());
+    return sources;
+}
+
+std::vector<std::string> ShaderDependencyGraph::GetDependencies(const std::string& name) const
+{
+    auto root = m_fileIndices.find(name);
+    if (root == m_fileIndices.end())
+        return {};
+
+    // Include guards allow cycles, every file is visited once
+    std::vector<bool> visited(m_files.size(), false);
+    std::vector<uint32_t> stack = { root->second };
+    visited[root->second] = true;
+    std::vector<std::string> dependencies;
+
+    while (!stack.empty())
+    {
+        const uint32_t index = stack.back();
+        stack.pop_back();
+
+        for (uint32_t includedIndex : m_files[index].includes)
+        {
+            if (visited[includedIndex])
+                continue;
+
+            visited[includedIndex] = true;
+            dependencies.push_back(m_files[includedIndex].name);
+            stack.push_back(includedIndex);
+        }
+    }
+
+    std::sort(dependencies.begin(), dependencies.end());
+    return dependencies;
+}
+
+std::vector<std::string> ShaderDependencyGraph::GetAffectedSources(const std::vector<std::string>& files) const
+{
+    const std::unordered_set<std::string> changed(files.begin(), files.end());
+    std::vector<std::string> affected;
+
+    for (const std::string& source : GetSources())
+    {
+        bool isAffected = changed.count(source) != 0;
+        if (!isAffected)
+        {
+            for (const std::string& dependency : GetDependencies(source))
+            {
+                if (changed.count(dependency))
+                {
+                    isAffected = true;
+                    break;
+                }
+            }
+        }
+
+        if (isAffected)
+            affected.push_back(source);
+    }
+
+    return affected;
+}
+
+std::vector<std::string> ShaderDependencyGraph::GetChangedFiles(const ShaderDependencyGraph& previous) const
+{
+    std::vector<std::string> changed;
+
+    for (const File& file : m_files)
+    {
+        auto previousFile = previous.m_fileIndices.find(file.name);
+        if (previousFile == previous.m_fileIndices.end() || previous.m_files[previousFile->second].contentHash != file.contentHash)
+            changed.push_back(file.name);
+    }
+
+    for (const File& file : previous.m_files)
+    {
+        if (!HasFile(file.name))
+            changed.push_back(file.name);
+    }
+
+    std::sort(changed.begin(), changed.end());
+    return changed;
+}
+
+const std::vector<ShaderUnresolvedInclude>& ShaderDependencyGraph::GetUnresolvedIncludes() const
+{
+    return m_unresolvedIncludes;
+}
+
+bool ShaderSourceWatcher::Start(const std::filesystem::path& sourceDirectory, std::vector<std::filesystem::path> includeDirectories)
+{
+    m_sourceDirectory = sourceDirectory;
+    m_includeDirectories = std::move(includeDirectories);
+    m_started = m_graph.Build(m_sourceDirectory, m_includeDirectories);
+    m_configHash = HashConfig();
+    return m_started;
+}
+
+bool ShaderSourceWatcher::IsStarted() const
+{
+    return m_started;
+}
+
+ShaderSourceChanges ShaderSourceWatcher::Poll()
+{
+    ShaderSourceChanges changes;
+
+    ShaderDependencyGraph graph;
+    if (!m_started || !graph.Build(m_sourceDirectory, m_includeDirectories))
+    {
+        changes.reloadAll = true;
+        return changes;
+    }
+
+    changes.changedFiles = graph.GetChangedFiles(m_graph);
+
+    // The previous graph still knows the includers of deleted files
+    std::vector<std::string> affected = graph.GetAffectedSources(changes.changedFiles);
+    for (const std::string& source : m_graph.GetAffectedSources(changes.changedFiles))
+    {
+        if (graph.HasFile(source))
+            affected.push_back(source);
+    }
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+    changes.affectedSources = std::move(affected);
+
+    // The configuration selects the permutations of every source
+    const uint64_t configHash = HashConfig();
+    if (configHash != m_configHash)
+    {
+        changes.changedFiles.push_back("Shaders.cfg");
+        changes.reloadAll = true;
+    }
+
+    m_graph = std::move(graph);
+    m_configHash = configHash;
+    return changes;
+}
+
+const ShaderDependencyGraph& ShaderSourceWatcher::GetGraph() const
+{
+    return m_graph;
+}
+
+uint64_t ShaderSourceWatcher::HashConfig() const
+{
+    std::string text;
+    return ReadShaderFile(m_sourceDirectory / "Shaders.cfg", text) ? HashText(text) : 0;
+}
@@ -0,0 +1,125 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// #include graph of the application shader sources, used to reload only the shaders affected by an edit.
+//
+// The graph covers every .hlsl, .hlsli and .h file under the source directory, and the files they
+// include from the include directories. Quoted includes are resolved relative to the including file
+// first, then in the include directories, angled includes only in the include directories, like DXC
+// does with -I. Comments are skipped, but conditional compilation is not evaluated, so an include in an
+// inactive #if branch still counts as a dependency, which can only cause extra reloads.
+//
+// Files are named by their path relative to the source directory, or relative to the include directory
+// they were found in, with forward slashes. The sources are the .hlsl files under the source directory,
+// they match the source names in Shaders.cfg. Every file is fingerprinted by its content, so saving a
+// file without changing it doesn't count as a change.
+//
+// The module has no dependencies on the renderer.
+
+struct ShaderInclude
+{
+    std::string path;           // as written in the directive
+    bool angled = false;        // #include <path>
+    uint32_t lineNumber = 0;
+};
+
+// Finds the #include directives of a shader file, in order
+std::vector<ShaderInclude> ScanShaderIncludes(const std::string& text);
+
+struct ShaderUnresolvedInclude
+{
+    std::string file;           // name of the including file
+    ShaderInclude include;
+};
+
+class ShaderDependencyGraph
+{
+public:
+    // Scans the sources and everything they include. Returns false if the source directory can't be read.
+    bool Build(const std::filesystem::path& sourceDirectory, const std::vector<std::filesystem::path>& includeDirectories);
+
+    [[nodiscard]] size_t GetFileCount() const;
+    [[nodiscard]] bool HasFile(const std::string& name) const;
+
+    // Sorted by name
+    [[nodiscard]] std::vector<std::string> GetSources() const;
+
+    // Files included by the file directly or indirectly, sorted by name
+    [[nodiscard]] std::vector<std::string> GetDependencies(const std::string& name) const;
+
+    // Sources that are one of the files or include one of them, sorted by name
+    [[nodiscard]] std::vector<std::string> GetAffectedSources(const std::vector<std::string>& files) const;
+
+    // Files whose content differs from the previous graph, or that are only in one of the graphs, sorted by name
+    [[nodiscard]] std::vector<std::string> GetChangedFiles(const ShaderDependencyGraph& previous) const;
+
+    // Includes of the scanned files that were not found, like the donut shader headers without their include directory
+    [[nodiscard]] const std::vector<ShaderUnresolvedInclude>& GetUnresolvedIncludes() const;
+
+private:
+    struct File
+    {
+        std::string name;
+        std::filesystem::path path;
+        uint64_t contentHash = 0;
+        bool source = false;
+        std::vector<uint32_t> includes;
+    };
+
+    uint32_t AddFile(const std::filesystem::path& path);
+    [[nodiscard]] std::string GetFileName(const std::filesystem::path& path) const;
+    [[nodiscard]] bool ResolveInclude(const File& file, const ShaderInclude& include, std::filesystem::path& resolved) const;
+
+    std::filesystem::path m_sourceDirectory;
+    std::vector<std::filesystem::path> m_includeDirectories;
+    std::vector<File> m_files;
+    std::unordered_map<std::string, uint32_t> m_fileIndices;        // by name
+    std::unordered_map<std::string, uint32_t> m_pathIndices;        // by normalized path
+    std::vector<ShaderUnresolvedInclude> m_unresolvedIncludes;
+};
+
+struct ShaderSourceChanges
+{
+    std::vector<std::string> changedFiles;
+    std::vector<std::string> affectedSources;   // sources to reload, a subset of the current sources
+    bool reloadAll = false;                     // Shaders.cfg changed, or the sources could not be scanned
+};
+
+// Snapshots of the shader sources, compared on request
+class ShaderSourceWatcher
+{
+public:
+    // Takes the first snapshot. Returns false if the source directory can't be read.
+    bool Start(const std::filesystem::path& sourceDirectory, std::vector<std::filesystem::path> includeDirectories);
+
+    [[nodiscard]] bool IsStarted() const;
+
+    // Takes a new snapshot and returns the changes since the previous one
+    ShaderSourceChanges Poll();
+
+    [[nodiscard]] const ShaderDependencyGraph& GetGraph() const;
+
+private:
+    [[nodiscard]] uint64_t HashConfig() const;
+
+    std::filesystem::path m_sourceDirectory;
+    std::vector<std::filesystem::path> m_includeDirectories;
+    ShaderDependencyGraph m_graph;
+    uint64_t m_configHash = 0;
+    bool m_started = false;
+};
@@ -0,0 +1,628 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "ShaderPermutationCache.h"
+#include "SceneCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr uint32_t c_Magic = 0x50534452; // "RDSP"
+static constexpr uint64_t c_DataAlignment = 64;
+
+struct FileHeader
+{
+    uint32_t magic = c_Magic;
+    uint32_t version = ShaderPermutationCache::Version;
+    uint64_t fileSize = 0;
+    uint64_t keysOffset = 0;
+    uint64_t keysSize = 0;
+    uint32_t entryCount = 0;
+    uint32_t session = 0;
+    uint64_t checksum = 0;      // of the header with this field set to 0, the table and the keys
+};
+
+struct FileEntry
+{
+    uint64_t keyOffset = 0;     // relative to the keys
+    uint64_t dataOffset = 0;
+    uint64_t dataSize = 0;
+    uint64_t dataChecksum = 0;
+    uint32_t keySize = 0;
+    uint32_t lastUsedSession = 0;
+};
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t HashBytes(const void* data, size_t size)
+{
+    SceneCacheHasher hasher;
+    if (size)
+        hasher.Update(data, size);
+    return hasher.GetHash();
+}
+
+static void AppendField(std::string& result, char tag, const std::string& value)
+{
+    result += tag;
+    result += std::to_string(value.size());
+    result += ':';
+    result += value;
+}
+
+std::string ShaderPermutationKey::GetCanonicalString() const
+{
+    // Length-prefixed fields, so no name or value can be confused with a separator
+    std::string result;
+    AppendField(result, 'P', shaderPath);
+    AppendField(result, 'E', entryName);
+    for (const ShaderPermutationMacro& macro : macros)
+    {
+        AppendField(result, 'M', macro.name);
+        AppendField(result, '=', macro.definition);
+    }
+
+    static const char digits[] = "0123456789abcdef";
+    result += 'B';
+    for (int shift = 60; shift >= 0; shift -= 4)
+        result += digits[(binaryHash >> shift) & 0xf];
+
+    return result;
+}
+
+std::string NormalizeShaderPath(const std::string& path)
+{
+    std::string slashed = path;
+    std::replace(slashed.begin(), slashed.end(), '\\', '/');
+
+    const bool absolute = !slashed.empty() && slashed[0] == '/';
+    std::vector<std::string> segments;
+
+    size_t begin = 0;
+    while (begin <= slashed.size())
+    {
+        size_t end = slashed.find('/', begin);
+        if (end == std::string::npos)
+            end = slashed.size();
+
+        const std::string segment = slashed.substr(begin, end - begin);
+        if (segment == "..")
+        {
+            if (!segments.empty() && segments.back() != "..")
+                segments.pop_back();
+            else if (!absolute)
+                segments.push_back(segment);
+        }
+        else if (!segment.empty() && segment != ".")
+        {
+            segments.push_back(segment);
+        }
+
+        begin = end + 1;
+    }
+
+    std::string result = absolute ? "/" : "";
+    for (size_t index = 0; index < segments.size(); index++)
+    {
+        if (index > 0)
+            result += '/';
+        result += segments[index];
+    }
+    return result;
+}
+
+ShaderPermutationKey MakeShaderPermutationKey(const std::string& shaderPath, const std::string& entryName,
+    std::vector<ShaderPermutationMacro> macros, uint64_t binaryHash)
+{
+    ShaderPermutationKey key;
+    key.shaderPath = NormalizeShaderPath(shaderPath);
+    key.entryName = entryName;
+    key.binaryHash = binaryHash;
+
+    // Stable, so that among equal names the last definition ends up last
+    std::stable_sort(macros.begin(), macros.end(), [](const ShaderPermutationMacro& a, const ShaderPermutationMacro& b)
+    {
+        return a.name < b.name;
+    });
+
+    for (ShaderPermutationMacro& macro : macros)
+    {
+        if (!key.macros.empty() && key.macros.back().name == macro.name)
+            key.macros.back() = std::move(macro);
+        else
+            key.macros.push_back(std::move(macro));
+    }
+
+    return key;
+}
+
+bool HashShaderBinaryFile(const std::filesystem::path& path, uint64_t& binaryHash)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+
+    SceneCacheHasher hasher;
+    char buffer[64 * 1024];
+    while (stream)
+    {
+        stream.read(buffer, sizeof(buffer));
+        if (stream.gcount() > 0)
+            hasher.Update(buffer, size_t(stream.gcount()));
+    }
+
+    if (stream.bad())
+        return false;
+
+    binaryHash = hasher.GetHash();
+    return true;
+}
+
+static std::string GetEntryKey(const ShaderPermutationKey& key, ShaderCacheBlobType type)
+{
+    return std::to_string(uint32_t(type)) + ":" + key.GetCanonicalString();
+}
+
+ShaderPermutationCache::~ShaderPermutationCache()
+{
+    Close();
+}
+
+bool ShaderPermutationCache::Open(const std::filesystem::path& path, const ShaderPermutationCacheSettings& settings)
+{
+    Close();
+    m_path = path;
+    m_settings = settings;
+    m_stats = ShaderPermutationCacheStats();
+    m_error.clear();
+    m_session = 1;
+
+    std::error_code error;
+    if (!std::filesystem::exists(path, error))
+        return true;
+
+    uint32_t fileSession = 0;
+    if (!Map() || !Parse(fileSession))
+    {
+        // Rewrite the file on the next Write, even if nothing else changes
+        Close();
+        m_dirty = true;
+        return false;
+    }
+
+    m_session = fileSession + 1;
+    return true;
+}
+
+void ShaderPermutationCache::Close()
+{
+    Unmap();
+    m_entries.clear();
+    m_entryIndex.clear();
+    m_dirty = false;
+}
+
+bool ShaderPermutationCache::Map()
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileW(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        m_error = "cannot open the file";
+        return false;
+    }
+    m_fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < LONGLONG(sizeof(FileHeader)))
+    {
+        m_error = "the file is too small";
+        return false;
+    }
+    m_size = size_t(fileSize.QuadPart);
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        m_error = "cannot map the file";
+        return false;
+    }
+    m_mappingHandle = mapping;
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    m_fileDescriptor = open(m_path.c_str(), O_RDONLY);
+    if (m_fileDescriptor < 0)
+    {
+        m_error = "cannot open the file";
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(m_fileDescriptor, &fileStat) != 0 || uint64_t(fileStat.st_size) < sizeof(FileHeader))
+    {
+        m_error = "the file is too small";
+        return false;
+    }
+    m_size = size_t(fileStat.st_size);
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+    m_data = (data == MAP_FAILED) ? nullptr : static_cast<const uint8_t*>(data);
+#endif
+
+    if (!m_data)
+    {
+        m_error = "cannot map the file";
+        return false;
+    }
+
+    return true;
+}
+
+void ShaderPermutationCache::Unmap()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mappingHandle)
+        CloseHandle(m_mappingHandle);
+    if (m_fileHandle)
+        CloseHandle(m_fileHandle);
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    if (m_data)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    if (m_fileDescriptor >= 0)
+        close(m_fileDescriptor);
+    m_fileDescriptor = -1;
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool ShaderPermutationCache::Parse(uint32_t& fileSession)
+{
+    FileHeader header;
+    memcpy(&header, m_data, sizeof(header));
+
+    if (header.magic != c_Magic)
+    {
+        m_error = "not a shader cache file";
+        return false;
+    }
+
+    if (header.version != Version)
+    {
+        m_error = "the file was written by a different version";
+        return false;
+    }
+
+    const uint64_t tableSize = uint64_t(header.entryCount) * sizeof(FileEntry);
+    const bool layoutValid = header.fileSize == m_size
+        && tableSize <= m_size - sizeof(FileHeader)
+        && header.keysOffset == sizeof(FileHeader) + tableSize
+        && header.keysSize <= m_size - header.keysOffset;
+
+    if (!layoutValid)
+    {
+        m_error = "the file is truncated or corrupt";
+        return false;
+    }
+
+    SceneCacheHasher hasher;
+    FileHeader checksumHeader = header;
+    checksumHeader.checksum = 0;
+    hasher.Update(&checksumHeader, sizeof(checksumHeader));
+    hasher.Update(m_data + sizeof(FileHeader), size_t(header.keysOffset + header.keysSize - sizeof(FileHeader)));
+    if (hasher.GetHash() != header.checksum)
+    {
+        m_error = "the entry table is corrupt";
+        return false;
+    }
+
+    const uint64_t dataBegin = header.keysOffset + header.keysSize;
+    const char* keys = reinterpret_cast<const char*>(m_data + header.keysOffset);
+
+    std::vector<Entry> entries(header.entryCount);
+    for (uint32_t index = 0; index < header.entryCount; index++)
+    {
+        FileEntry fileEntry;
+        memcpy(&fileEntry, m_data + sizeof(FileHeader) + index * sizeof(FileEntry), sizeof(fileEntry));
+
+        const bool entryValid = fileEntry.keyOffset <= header.keysSize
+            && fileEntry.keySize <= header.keysSize - fileEntry.keyOffset
+            && fileEntry.dataOffset % c_DataAlignment == 0
+            && fileEntry.dataOffset >= dataBegin
+            && fileEntry.dataOffset <= m_size
+            && fileEntry.dataSize <= m_size - fileEntry.dataOffset;
+
+        if (!entryValid)
+        {
+            m_error = "the entry table is corrupt";
+            return false;
+        }
+
+        Entry& entry = entries[index];
+        entry.key.assign(keys + fileEntry.keyOffset, fileEntry.keySize);
+        entry.mappedData = m_data + fileEntry.dataOffset;
+        entry.size = fileEntry.dataSize;
+        entry.checksum = fileEntry.dataChecksum;
+        entry.lastUsedSession = fileEntry.lastUsedSession;
+    }
+
+    m_entries = std::move(entries);
+    m_entryIndex.clear();
+    for (size_t index = 0; index < m_entries.size(); index++)
+        m_entryIndex[m_entries[index].key] = index;
+
+    fileSession = header.session;
+    return true;
+}
+
+const uint8_t* ShaderPermutationCache::GetEntryData(const Entry& entry) const
+{
+    // Never null, so that an empty blob isn't mistaken for a miss
+    static const uint8_t empty = 0;
+    if (entry.mappedData)
+        return entry.mappedData;
+    return entry.storedData.empty() ? &empty : entry.storedData.data();
+}
+
+const void* ShaderPermutationCache::Find(const ShaderPermutationKey& key, ShaderCacheBlobType type, size_t& size)
+{
+    size = 0;
+
+    auto it = m_entryIndex.find(GetEntryKey(key, type));
+    if (it == m_entryIndex.end())
+    {
+        m_stats.misses++;
+        return nullptr;
+    }
+
+    Entry& entry = m_entries[it->second];
+    if (entry.state == EntryState::Unverified)
+    {
+        const bool valid = HashBytes(GetEntryData(entry), size_t(entry.size)) == entry.checksum;
+        entry.state = valid ? EntryState::Valid : EntryState::Corrupt;
+        if (!valid)
+        {
+            m_stats.corruptEntries++;
+            m_dirty = true;
+        }
+    }
+
+    if (entry.state == EntryState::Corrupt)
+    {
+        m_stats.misses++;
+        return nullptr;
+    }
+
+    if (entry.lastUsedSession != m_session)
+    {
+        entry.lastUsedSession = m_session;
+        m_dirty = true;
+    }
+
+    m_stats.hits++;
+    size = size_t(entry.size);
+    return GetEntryData(entry);
+}
+
+void ShaderPermutationCache::Store(const ShaderPermutationKey& key, ShaderCacheBlobType type, const void* data, size_t size)
+{
+    const std::string entryKey = GetEntryKey(key, type);
+
+    auto [it, inserted] = m_entryIndex.try_emplace(entryKey, m_entries.size());
+    if (inserted)
+        m_entries.emplace_back();
+
+    Entry& entry = m_entries[it->second];
+    entry.key = entryKey;
+    entry.mappedData = nullptr;
+    entry.storedData.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    entry.size = size;
+    entry.checksum = HashBytes(data, size);
+    entry.lastUsedSession = m_session;
+    entry.state = EntryState::Valid;
+
+    m_stats.stores++;
+    m_dirty = true;
+}
+
+bool ShaderPermutationCache::Write()
+{
+    if (!m_dirty)
+        return true;
+
+    if (m_path.empty())
+        return false;
+
+    // Most recently used first, then by key, so that the file doesn't depend on the lookup order
+    std::vector<size_t> order;
+    m_stats.evictedEntries = 0;
+    for (size_t index = 0; index < m_entries.size(); index++)
+    {
+        const Entry& entry = m_entries[index];
+        if (entry.state == EntryState::Corrupt || m_session - entry.lastUsedSession > m_settings.maxUnusedSessions)
+            m_stats.evictedEntries++;
+        else
+            order.push_back(index);
+    }
+
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+        if (m_entries[a].lastUsedSession != m_entries[b].lastUsedSession)
+            return m_entries[a].lastUsedSession > m_entries[b].lastUsedSession;
+        return m_entries[a].key < m_entries[b].key;
+    });
+
+    std::vector<size_t> kept;
+    uint64_t dataSize = 0;
+    for (size_t index : order)
+    {
+        if (dataSize + m_entries[index].size > m_settings.maxDataSize)
+        {
+            m_stats.evictedEntries++;
+            continue;
+        }
+
+        dataSize += m_entries[index].size;
+        kept.push_back(index);
+    }
+
+    // Lay out the file in memory
+    FileHeader header;
+    header.entryCount = uint32_t(kept.size());
+    header.session = m_session;
+    header.keysOffset = sizeof(FileHeader) + kept.size() * sizeof(FileEntry);
+
+    std::vector<FileEntry> table(kept.size());
+    for (size_t slot = 0; slot < kept.size(); slot++)
+    {
+        table[slot].keyOffset = header.keysSize;
+        table[slot].keySize = uint32_t(m_entries[kept[slot]].key.size());
+        header.keysSize += table[slot].keySize;
+    }
+
+    uint64_t position = header.keysOffset + header.keysSize;
+    for (size_t slot = 0; slot < kept.size(); slot++)
+    {
+        const Entry& entry = m_entries[kept[slot]];
+        position = AlignUp(position, c_DataAlignment);
+        table[slot].dataOffset = position;
+        table[slot].dataSize = entry.size;
+        table[slot].dataChecksum = entry.checksum;
+        table[slot].lastUsedSession = entry.lastUsedSession;
+        position += entry.size;
+    }
+    header.fileSize = position;
+
+    std::vector<uint8_t> file(size_t(header.fileSize), 0);
+    memcpy(file.data() + sizeof(FileHeader), table.data(), table.size() * sizeof(FileEntry));
+    for (size_t slot = 0; slot < kept.size(); slot++)
+    {
+        const Entry& entry = m_entries[kept[slot]];
+        memcpy(file.data() + header.keysOffset + table[slot].keyOffset, entry.key.data(), entry.key.size());
+        if (entry.size)
+            memcpy(file.data() + table[slot].dataOffset, GetEntryData(entry), size_t(entry.size));
+    }
+
+    SceneCacheHasher hasher;
+    hasher.Update(&header, sizeof(header));
+    hasher.Update(file.data() + sizeof(FileHeader), size_t(header.keysOffset + header.keysSize - sizeof(FileHeader)));
+    header.checksum = hasher.GetHash();
+    memcpy(file.data(), &header, sizeof(header));
+
+    // The mapping has to go before the file can be replaced on Windows
+    Unmap();
+    m_entries.clear();
+    m_entryIndex.clear();
+
+    const std::filesystem::path temporaryPath = m_path.string() + ".tmp";
+    bool written = false;
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (stream)
+        {
+            stream.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+            written = bool(stream);
+        }
+    }
+
+    std::error_code error;
+    if (written)
+    {
+        std::filesystem::rename(temporaryPath, m_path, error);
+        written = !error;
+    }
+    if (!written)
+        std::filesystem::remove(temporaryPath, error);
+
+    // Serve the lookups from the new file, or from the copy in memory if it can't be mapped.
+    // The session doesn't change, the file was written in this one.
+    uint32_t fileSession = 0;
+    if (!written || !Map() || !Parse(fileSession))
+    {
+        Unmap();
+        m_entries.resize(kept.size());
+        for (size_t slot = 0; slot < kept.size(); slot++)
+        {
+            Entry& entry = m_entries[slot];
+            entry.key.assign(reinterpret_cast<const char*>(file.data() + header.keysOffset + table[slot].keyOffset), table[slot].keySize);
+            entry.storedData.assign(file.data() + table[slot].dataOffset, file.data() + table[slot].dataOffset + table[slot].dataSize);
+            entry.size = table[slot].dataSize;
+            entry.checksum = table[slot].dataChecksum;
+            entry.lastUsedSession = table[slot].lastUsedSession;
+            entry.state = EntryState::Valid;
+            m_entryIndex[entry.key] = slot;
+        }
+
+        if (!written)
+        {
+            m_error = "cannot write the file";
+            return false;
+        }
+    }
+    else
+    {
+        // Everything in the new file was either verified or stored in this session
+        for (Entry& entry : m_entries)
+            entry.state = EntryState::Valid;
+    }
+
+    m_dirty = false;
+    return true;
+}
+
+bool ShaderPermutationCache::IsDirty() const
+{
+    return m_dirty;
+}
+
+size_t ShaderPermutationCache::GetEntryCount() const
+{
+    return m_entries.size();
+}
+
+uint32_t ShaderPermutationCache::GetSession() const
+{
+    return m_session;
+}
+
+const ShaderPermutationCacheStats& ShaderPermutationCache::GetStats() const
+{
+    return m_stats;
+}
+
+const std::string& ShaderPermutationCache::GetError() const
+{
+    return m_error;
+}
@@ -0,0 +1,162 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Persistent cache of shader permutation binaries, kept in one memory-mapped file.
+//
+// An entry is identified by a canonical key: the shader path with normalized separators and no "." or
+// ".." segments, the entry point, the macros sorted by name, and a hash of the compiled shader binary
+// the permutation was taken from, so a rebuilt binary never matches an old entry. Entries also carry a
+// blob type, which keeps shader binaries apart from other per-permutation data such as driver pipeline
+// caches.
+//
+// The file is a header, a table of entries, the key strings, and the blobs at 64-byte aligned offsets.
+// The header and the table are covered by a checksum that is verified when the file is opened; if it
+// doesn't match, the whole file is ignored. Every blob has its own checksum, verified the first time the
+// entry is looked up, so opening the cache doesn't read the blobs; a corrupt entry is a miss and is
+// dropped on the next write. Every Open starts a new session. Write keeps the entries used in the last
+// few sessions, most recently used first, up to a size budget, and replaces the file through a
+// temporary file.
+//
+// The cache is not thread-safe. The module has no dependencies on the renderer.
+
+struct ShaderPermutationMacro
+{
+    std::string name;
+    std::string definition;
+};
+
+struct ShaderPermutationKey
+{
+    std::string shaderPath;
+    std::string entryName;
+    std::vector<ShaderPermutationMacro> macros;     // sorted by name, every name once
+    uint64_t binaryHash = 0;
+
+    // Unambiguous text form, equal for equal keys
+    [[nodiscard]] std::string GetCanonicalString() const;
+};
+
+// Converts backslashes to slashes, merges repeated slashes and resolves "." and ".." segments.
+// Leading ".." segments of a relative path are kept.
+std::string NormalizeShaderPath(const std::string& path);
+
+// Normalizes the path and sorts the macros by name. A macro that is defined more than once keeps its
+// last definition, which is the one the compiler sees.
+ShaderPermutationKey MakeShaderPermutationKey(const std::string& shaderPath, const std::string& entryName,
+    std::vector<ShaderPermutationMacro> macros, uint64_t binaryHash);
+
+// Hashes the contents of a compiled shader file, for the binary hash of its keys.
+// Returns false if the file can't be read.
+bool HashShaderBinaryFile(const std::filesystem::path& path, uint64_t& binaryHash);
+
+enum class ShaderCacheBlobType : uint32_t
+{
+    ShaderBinary,
+    PipelineCache
+};
+
+struct ShaderPermutationCacheSettings
+{
+    uint64_t maxDataSize = 256ull << 20;    // blob bytes kept by Write
+    uint32_t maxUnusedSessions = 8;         // entries not used for more sessions are evicted
+};
+
+struct ShaderPermutationCacheStats
+{
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t stores = 0;
+    uint32_t corruptEntries = 0;    // found by Find since Open
+    uint32_t evictedEntries = 0;    // by the last Write
+};
+
+class ShaderPermutationCache
+{
+public:
+    static constexpr uint32_t Version = 1;
+
+    ShaderPermutationCache() = default;
+    ~ShaderPermutationCache();
+
+    ShaderPermutationCache(const ShaderPermutationCache&) = delete;
+    ShaderPermutationCache& operator=(const ShaderPermutationCache&) = delete;
+
+    // Maps the file and starts a new session. A missing file gives an empty cache and returns true,
+    // a file with a bad header or table is ignored and returns false with GetError set; either way the
+    // cache can be used and written.
+    bool Open(const std::filesystem::path& path, const ShaderPermutationCacheSettings& settings = ShaderPermutationCacheSettings());
+    void Close();
+
+    // Returns the blob, or nullptr on a miss. The data stays valid until the next Write or Close.
+    const void* Find(const ShaderPermutationKey& key, ShaderCacheBlobType type, size_t& size);
+
+    // Adds or replaces an entry, the data is copied.
+    void Store(const ShaderPermutationKey& key, ShaderCacheBlobType type, const void* data, size_t size);
+
+    // Writes the entries that survive eviction and maps the new file. Does nothing if nothing changed.
+    bool Write();
+
+    [[nodiscard]] bool IsDirty() const;
+    [[nodiscard]] size_t GetEntryCount() const;
+    [[nodiscard]] uint32_t GetSession() const;
+    [[nodiscard]] const ShaderPermutationCacheStats& GetStats() const;
+    [[nodiscard]] const std::string& GetError() const;
+
+private:
+    enum class EntryState : uint8_t
+    {
+        Unverified,
+        Valid,
+        Corrupt
+    };
+
+    struct Entry
+    {
+        std::string key;                // type prefix and canonical key
+        const uint8_t* mappedData = nullptr;
+        std::vector<uint8_t> storedData;    // used when mappedData is null
+        uint64_t size = 0;
+        uint64_t checksum = 0;
+        uint32_t lastUsedSession = 0;
+        EntryState state = EntryState::Unverified;
+    };
+
+    bool Map();
+    void Unmap();
+    bool Parse(uint32_t& fileSession);
+    [[nodiscard]] const uint8_t* GetEntryData(const Entry& entry) const;
+
+    std::filesystem::path m_path;
+    ShaderPermutationCacheSettings m_settings;
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, size_t> m_entryIndex;
+    uint32_t m_session = 0;
+    bool m_dirty = false;
+    ShaderPermutationCacheStats m_stats;
+    std::string m_error;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#else
+    int m_fileDescriptor = -1;
+#endif
+};
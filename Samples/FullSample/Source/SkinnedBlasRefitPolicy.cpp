@@ -0,0 +1,97 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "SkinnedBlasRefitPolicy.h"
+
+#include <algorithm>
+#include <limits>
+
+static float GetSurfaceArea(const SkinnedBlasBounds& bounds)
+{
+    const float x = std::max(bounds.maximum[0] - bounds.minimum[0], 0.f);
+    const float y = std::max(bounds.maximum[1] - bounds.minimum[1], 0.f);
+    const float z = std::max(bounds.maximum[2] - bounds.minimum[2], 0.f);
+
+    return 2.f * (x * y + y * z + z * x);
+}
+
+float GetSkinnedBlasBoundsGrowth(const SkinnedBlasBounds& reference, const SkinnedBlasBounds& bounds)
+{
+    SkinnedBlasBounds merged;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        merged.minimum[axis] = std::min(reference.minimum[axis], bounds.minimum[axis]);
+        merged.maximum[axis] = std::max(reference.maximum[axis], bounds.maximum[axis]);
+    }
+
+    const float referenceArea = GetSurfaceArea(reference);
+    const float mergedArea = GetSurfaceArea(merged);
+
+    if (referenceArea <= 0.f)
+        return (mergedArea <= 0.f) ? 0.f : std::numeric_limits<float>::infinity();
+
+    return mergedArea / referenceArea - 1.f;
+}
+
+SkinnedBlasUpdate SkinnedBlasRefitPolicy::Update(const SkinnedBlasBounds& bounds, const SkinnedBlasRefitSettings& settings)
+{
+    bool rebuild = !m_valid || !settings.enableRefit;
+
+    float growth = 0.f;
+    if (!rebuild)
+    {
+        growth = GetSkinnedBlasBoundsGrowth(m_rebuildBounds, bounds);
+
+        if (growth > settings.maxBoundsGrowth)
+            rebuild = true;
+        else if (settings.rebuildInterval != 0 && m_refitsSinceRebuild >= settings.rebuildInterval)
+            rebuild = true;
+    }
+
+    if (rebuild)
+    {
+        m_rebuildBounds = bounds;
+        m_valid = true;
+        m_refitsSinceRebuild = 0;
+        m_rebuildCount++;
+        m_boundsGrowth = 0.f;
+        return SkinnedBlasUpdate::Rebuild;
+    }
+
+    m_refitsSinceRebuild++;
+    m_refitCount++;
+    m_boundsGrowth = growth;
+    return SkinnedBlasUpdate::Refit;
+}
+
+void SkinnedBlasRefitPolicy::Invalidate()
+{
+    m_valid = false;
+}
+
+uint32_t SkinnedBlasRefitPolicy::GetRefitsSinceRebuild() const
+{
+    return m_refitsSinceRebuild;
+}
+
+uint32_t SkinnedBlasRefitPolicy::GetRefitCount() const
+{
+    return m_refitCount;
+}
+
+uint32_t SkinnedBlasRefitPolicy::GetRebuildCount() const
+{
+    return m_rebuildCount;
+}
+
+float SkinnedBlasRefitPolicy::GetBoundsGrowth() const
+{
+    return m_boundsGrowth;
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+// Decides whether a skinned BLAS is refit or rebuilt. Refitting keeps the tree topology of the last
+// rebuild and only moves the node bounds, which is much cheaper but degrades trace performance as the
+// pose drifts away from the rebuilt one. The policy rebuilds after a fixed number of refits, or when the
+// bounding box of the current pose, merged with the box at the last rebuild, has grown by more than
+// a threshold: that growth is a cheap proxy for how much the node bounds of a refit tree get inflated.
+// The policy only works with boxes and counters and has no dependencies on the renderer.
+
+struct SkinnedBlasBounds
+{
+    float minimum[3] = { 0.f, 0.f, 0.f };
+    float maximum[3] = { 0.f, 0.f, 0.f };
+};
+
+enum class SkinnedBlasUpdate
+{
+    Rebuild,
+    Refit
+};
+
+struct SkinnedBlasRefitSettings
+{
+    bool enableRefit = true;
+    uint32_t rebuildInterval = 16;      // maximum number of refits between two rebuilds, 0 for no limit
+    float maxBoundsGrowth = 0.25f;      // relative growth of the bounding box surface area since the last rebuild
+};
+
+// Surface area of the box merged with the reference box, relative to the reference box, minus one
+float GetSkinnedBlasBoundsGrowth(const SkinnedBlasBounds& reference, const SkinnedBlasBounds& bounds);
+
+class SkinnedBlasRefitPolicy
+{
+public:
+    // Decides how the BLAS is built with the given bounds and records the decision.
+    SkinnedBlasUpdate Update(const SkinnedBlasBounds& bounds, const SkinnedBlasRefitSettings& settings);
+
+    // Forces the next update to be a rebuild, e.g. when the BLAS contents are no longer valid.
+    void Invalidate();
+
+    [[nodiscard]] uint32_t GetRefitsSinceRebuild() const;
+    [[nodiscard]] uint32_t GetRefitCount() const;
+    [[nodiscard]] uint32_t GetRebuildCount() const;
+    [[nodiscard]] float GetBoundsGrowth() const;    // at the last update, 0 after a rebuild
+
+private:
+    SkinnedBlasBounds m_rebuildBounds;
+    bool m_valid = false;
+    uint32_t m_refitsSinceRebuild = 0;
+    uint32_t m_refitCount = 0;
+    uint32_t m_rebuildCount = 0;
+    float m_boundsGrowth = 0.f;
+};
@@ -0,0 +1,363 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "SortedDrawList.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <utility>
+
+static constexpr uint32_t c_DepthBucketBits = 16;
+static constexpr uint32_t c_MaterialBits = 23;
+static constexpr uint32_t c_PipelineBits = 8;
+
+static constexpr uint32_t c_DepthBucketShift = 0;
+static constexpr uint32_t c_MaterialShift = c_DepthBucketShift + c_DepthBucketBits;
+static constexpr uint32_t c_AlphaTestedShift = c_MaterialShift + c_MaterialBits;
+static constexpr uint32_t c_PipelineShift = c_AlphaTestedShift + 1;
+
+static constexpr uint64_t c_DepthBucketMask = (1ull << c_DepthBucketBits) - 1;
+static constexpr uint64_t c_MaterialMask = (1ull << c_MaterialBits) - 1;
+static constexpr uint64_t c_PipelineMask = (1ull << c_PipelineBits) - 1;
+
+static constexpr float c_DepthBucketsPerOctave = 64.f;
+
+static constexpr uint32_t c_RadixBits = 8;
+static constexpr uint32_t c_RadixSize = 1 << c_RadixBits;
+static constexpr uint32_t c_RadixDigits = 64 / c_RadixBits;
+
+uint64_t PackDrawSortKey(const DrawSortKeyFields& fields)
+{
+    return ((uint64_t(fields.pipeline) & c_PipelineMask) << c_PipelineShift)
+        | (uint64_t(fields.alphaTested ? 1 : 0) << c_AlphaTestedShift)
+        | ((uint64_t(fields.material) & c_MaterialMask) << c_MaterialShift)
+        | ((uint64_t(fields.depthBucket) & c_DepthBucketMask) << c_DepthBucketShift);
+}
+
+DrawSortKeyFields UnpackDrawSortKey(uint64_t key)
+{
+    DrawSortKeyFields fields;
+    fields.pipeline = uint32_t((key >> c_PipelineShift) & c_PipelineMask);
+    fields.alphaTested = ((key >> c_AlphaTestedShift) & 1) != 0;
+    fields.material = uint32_t((key >> c_MaterialShift) & c_MaterialMask);
+    fields.depthBucket = uint32_t((key >> c_DepthBucketShift) & c_DepthBucketMask);
+    return fields;
+}
+
+uint32_t GetDrawDepthBucket(float viewDepth)
+{
+    // Also catches NaN
+    if (!(viewDepth > 0.f))
+        return 0;
+
+    const float bucket = std::log2(1.f + viewDepth) * c_DepthBucketsPerOctave;
+    return uint32_t(std::min(bucket, float(c_DepthBucketMask)));
+}
+
+bool IsSameDrawPipeline(uint64_t a, uint64_t b)
+{
+    return (a >> c_AlphaTestedShift) == (b >> c_AlphaTestedShift);
+}
+
+bool IsSameDrawMaterial(uint64_t a, uint64_t b)
+{
+    return ((a >> c_MaterialShift) & c_MaterialMask) == ((b >> c_MaterialShift) & c_MaterialMask);
+}
+
+void RadixSortDrawKeys(
+    std::vector<uint64_t>& keys,
+    std::vector<uint32_t>& values,
+    std::vector<uint64_t>& scratchKeys,
+    std::vector<uint32_t>& scratchValues)
+{
+    const size_t count = keys.size();
+    if (count < 2)
+        return;
+
+    scratchKeys.resize(count);
+    scratchValues.resize(count);
+
+    // All digit histograms in one pass over the keys
+    uint32_t histograms[c_RadixDigits][c_RadixSize] = {};
+    for (uint64_t key : keys)
+    {
+        for (uint32_t digit = 0; digit < c_RadixDigits; digit++)
+            histograms[digit][(key >> (digit * c_RadixBits)) & (c_RadixSize - 1)]++;
+    }
+
+    for (uint32_t digit = 0; digit < c_RadixDigits; digit++)
+    {
+        uint32_t* histogram = histograms[digit];
+        const uint32_t shift = digit * c_RadixBits;
+
+        // Skip the digits that are the same in all keys, e.g. the unused high bits
+        if (histogram[(keys[0] >> shift) & (c_RadixSize - 1)] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < c_RadixSize; bucket++)
+        {
+            const uint32_t bucketSize = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketSize;
+        }
+
+        for (size_t index = 0; index < count; index++)
+        {
+            const uint64_t key = keys[index];
+            const uint32_t destination = histogram[(key >> shift) & (c_RadixSize - 1)]++;
+            scratchKeys[destination] = key;
+            scratchValues[destination] = values[index];
+        }
+
+        std::swap(keys, scratchKeys);
+        std::swap(values, scratchValues);
+    }
+}
+
+void SortedDrawList::Build(const std::vector<uint64_t>& keys)
+{
+    m_keys = keys;
+    m_changed.assign(keys.size(), 0);
+    m_changedDraws.clear();
+
+    SortAll();
+}
+
+void SortedDrawList::SetKey(uint32_t draw, uint64_t key)
+{
+    if (m_keys[draw] == key)
+        return;
+
+    m_keys[draw] = key;
+
+    if (!m_changed[draw])
+    {
+        m_changed[draw] = 1;
+        m_changedDraws.push_back(draw);
+    }
+}
+
+void SortedDrawList::SortAll()
+{
+    m_sortedKeys = m_keys;
+    m_sortedDraws.resize(m_keys.size());
+    std::iota(m_sortedDraws.begin(), m_sortedDraws.end(), 0u);
+
+    RadixSortDrawKeys(m_sortedKeys, m_sortedDraws, m_scratchKeys, m_scratchDraws);
+
+    m_lastSortedCount = uint32_t(m_keys.size());
+    m_fullSorts++;
+}
+
+void SortedDrawList::Sort()
+{
+    const size_t changedCount = m_changedDraws.size();
+    if (changedCount == 0)
+    {
+        m_lastSortedCount = 0;
+        return;
+    }
+
+    if (changedCount * 2 > m_keys.size())
+    {
+        SortAll();
+    }
+    else
+    {
+        m_scratchKeys.resize(changedCount);
+        m_scratchDraws.resize(changedCount);
+        for (size_t index = 0; index < changedCount; index++)
+        {
+            m_scratchKeys[index] = m_keys[m_changedDraws[index]];
+            m_scratchDraws[index] = m_changedDraws[index];
+        }
+
+        RadixSortDrawKeys(m_scratchKeys, m_scratchDraws, m_mergeKeys, m_mergeDraws);
+
+        // Merge the sorted changed draws into the unchanged ones, which are still in order
+        m_mergeKeys.clear();
+        m_mergeDraws.clear();
+        m_mergeKeys.reserve(m_keys.size());
+        m_mergeDraws.reserve(m_keys.size());
+
+        size_t changedIndex = 0;
+        for (size_t index = 0; index < m_sortedKeys.size(); index++)
+        {
+            const uint32_t draw = m_sortedDraws[index];
+            if (m_changed[draw])
+                continue;
+
+            const uint64_t key = m_sortedKeys[index];
+            while (changedIndex < changedCount && m_scratchKeys[changedIndex] < key)
+            {
+                m_mergeKeys.push_back(m_scratchKeys[changedIndex]);
+                m_mergeDraws.push_back(m_scratchDraws[changedIndex]);
+                changedIndex++;
+            }
+
+            m_mergeKeys.push_back(key);
+            m_mergeDraws.push_back(draw);
+        }
+
+        m_mergeKeys.insert(m_mergeKeys.end(), m_scratchKeys.begin() + changedIndex, m_scratchKeys.end());
+        m_mergeDraws.insert(m_mergeDraws.end(), m_scratchDraws.begin() + changedIndex, m_scratchDraws.end());
+
+        std::swap(m_sortedKeys, m_mergeKeys);
+        std::swap(m_sortedDraws, m_mergeDraws);
+
+        m_lastSortedCount = uint32_t(changedCount);
+        m_incrementalSorts++;
+    }
+
+    for (uint32_t draw : m_changedDraws)
+        m_changed[draw] = 0;
+    m_changedDraws.clear();
+}
+
+uint32_t SortedDrawList::GetDrawCount() const
+{
+    return uint32_t(m_keys.size());
+}
+
+uint64_t SortedDrawList::GetKey(uint32_t draw) const
+{
+    return m_keys[draw];
+}
+
+const std::vector<uint32_t>& SortedDrawList::GetSortedDraws() const
+{
+    return m_sortedDraws;
+}
+
+const std::vector<uint64_t>& SortedDrawList::GetSortedKeys() const
+{
+    return m_sortedKeys;
+}
+
+uint32_t SortedDrawList::GetLastSortedCount() const
+{
+    return m_lastSortedCount;
+}
+
+uint64_t SortedDrawList::GetFullSortCount() const
+{
+    return m_fullSorts;
+}
+
+uint64_t SortedDrawList::GetIncrementalSortCount() const
+{
+    return m_incrementalSorts;
+}
+
+void DrawStateCounter::AddDraw(uint64_t key)
+{
+    const bool first = m_statistics.draws == 0;
+
+    if (first || !IsSameDrawPipeline(key, m_previousKey))
+        m_statistics.pipelineChanges++;
+
+    if (first || !IsSameDrawMaterial(key, m_previousKey))
+        m_statistics.materialChanges++;
+
+    m_statistics.draws++;
+    m_previousKey = key;
+}
+
+const DrawStateStatistics& DrawStateCounter::GetStatistics() const
+{
+    return m_statistics;
+}
+
+DrawSortingBenchmarkResult BenchmarkDrawSorting(uint32_t drawCount, uint32_t iterations)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+    DrawSortingBenchmarkResult result;
+    result.drawCount = drawCount;
+    iterations = std::max(iterations, 1u);
+
+    // Mostly opaque draws with a few thousand materials, spread over a large depth range
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> material(0, std::max(drawCount / 16, 1u));
+    std::uniform_real_distribution<float> depth(0.1f, 2000.f);
+    std::uniform_int_distribution<uint32_t> alphaTested(0, 9);
+
+    std::vector<DrawSortKeyFields> fields(drawCount);
+    for (DrawSortKeyFields& draw : fields)
+    {
+        draw.alphaTested = alphaTested(rng) == 0;
+        draw.pipeline = draw.alphaTested ? 1 : 0;
+        draw.material = material(rng);
+        draw.depthBucket = GetDrawDepthBucket(depth(rng));
+    }
+
+    std::vector<uint64_t> keys(drawCount);
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        for (uint32_t draw = 0; draw < drawCount; draw++)
+            keys[draw] = PackDrawSortKey(fields[draw]);
+    }
+    result.packMs = elapsedMs(start) / iterations;
+
+    std::vector<uint64_t> sortedKeys;
+    std::vector<uint32_t> sortedDraws;
+    std::vector<uint64_t> scratchKeys;
+    std::vector<uint32_t> scratchDraws;
+
+    start = Clock::now();
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        sortedKeys = keys;
+        sortedDraws.resize(drawCount);
+        std::iota(sortedDraws.begin(), sortedDraws.end(), 0u);
+        RadixSortDrawKeys(sortedKeys, sortedDraws, scratchKeys, scratchDraws);
+    }
+    result.radixSortMs = elapsedMs(start) / iterations;
+
+    std::vector<std::pair<uint64_t, uint32_t>> pairs(drawCount);
+    start = Clock::now();
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        for (uint32_t draw = 0; draw < drawCount; draw++)
+            pairs[draw] = { keys[draw], draw };
+        std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    }
+    result.stdSortMs = elapsedMs(start) / iterations;
+
+    // Move 1% of the draws to a different depth bucket per frame
+    SortedDrawList list;
+    list.Build(keys);
+
+    std::uniform_int_distribution<uint32_t> drawIndex(0, std::max(drawCount, 1u) - 1);
+    const uint32_t changesPerIteration = std::max(drawCount / 100, 1u);
+
+    start = Clock::now();
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        for (uint32_t change = 0; change < changesPerIteration && drawCount > 0; change++)
+        {
+            const uint32_t draw = drawIndex(rng);
+            DrawSortKeyFields changed = fields[draw];
+            changed.depthBucket = GetDrawDepthBucket(depth(rng));
+            list.SetKey(draw, PackDrawSortKey(changed));
+        }
+        list.Sort();
+    }
+    result.incrementalSortMs = elapsedMs(start) / iterations;
+
+    return result;
+}
@@ -0,0 +1,127 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Draw ordering by 64-bit sort keys. The most significant fields of a key are the states that are the most
+// expensive to change: pipeline, then the alpha-tested flag, then the material, and finally a coarse
+// logarithmic depth bucket so that draws with the same state go front to back.
+// The keys are sorted with an LSD radix sort that skips the digits that are the same in all keys.
+// SortedDrawList keeps the sorted order between frames and only sorts the draws whose keys changed,
+// merging them back into the rest, which is cheap when only a few instances move.
+
+struct DrawSortKeyFields
+{
+    uint32_t pipeline = 0;      // 8 bits
+    bool alphaTested = false;
+    uint32_t material = 0;      // 23 bits
+    uint32_t depthBucket = 0;   // 16 bits, see GetDrawDepthBucket
+};
+
+uint64_t PackDrawSortKey(const DrawSortKeyFields& fields);
+DrawSortKeyFields UnpackDrawSortKey(uint64_t key);
+
+// Maps a view depth to a bucket with a fixed number of buckets per doubling of the depth.
+// The buckets are coarse enough that small camera movements leave most keys unchanged.
+uint32_t GetDrawDepthBucket(float viewDepth);
+
+// Keys with the same pipeline and alpha-tested flag can be drawn without changing the pipeline.
+bool IsSameDrawPipeline(uint64_t a, uint64_t b);
+bool IsSameDrawMaterial(uint64_t a, uint64_t b);
+
+// Stable sort of keys and their values, using scratch arrays of the same size.
+void RadixSortDrawKeys(
+    std::vector<uint64_t>& keys,
+    std::vector<uint32_t>& values,
+    std::vector<uint64_t>& scratchKeys,
+    std::vector<uint32_t>& scratchValues);
+
+class SortedDrawList
+{
+public:
+    // Replaces all keys and sorts them. The draw index of a key is its position in the array.
+    void Build(const std::vector<uint64_t>& keys);
+
+    // Changes the key of one draw. The order is restored by the next Sort call.
+    void SetKey(uint32_t draw, uint64_t key);
+
+    // Restores the key order after SetKey. Only the changed draws are sorted and merged into the
+    // unchanged ones, unless so many have changed that a full sort is faster.
+    void Sort();
+
+    [[nodiscard]] uint32_t GetDrawCount() const;
+    [[nodiscard]] uint64_t GetKey(uint32_t draw) const;
+
+    // Draw indices and their keys in key order
+    [[nodiscard]] const std::vector<uint32_t>& GetSortedDraws() const;
+    [[nodiscard]] const std::vector<uint64_t>& GetSortedKeys() const;
+
+    [[nodiscard]] uint32_t GetLastSortedCount() const;  // draws sorted by the last Sort or Build
+    [[nodiscard]] uint64_t GetFullSortCount() const;
+    [[nodiscard]] uint64_t GetIncrementalSortCount() const;
+
+private:
+    void SortAll();
+
+    std::vector<uint64_t> m_keys;           // indexed by draw
+    std::vector<uint8_t> m_changed;         // indexed by draw
+    std::vector<uint32_t> m_changedDraws;
+
+    std::vector<uint64_t> m_sortedKeys;
+    std::vector<uint32_t> m_sortedDraws;
+
+    std::vector<uint64_t> m_scratchKeys;
+    std::vector<uint32_t> m_scratchDraws;
+    std::vector<uint64_t> m_mergeKeys;
+    std::vector<uint32_t> m_mergeDraws;
+
+    uint32_t m_lastSortedCount = 0;
+    uint64_t m_fullSorts = 0;
+    uint64_t m_incrementalSorts = 0;
+};
+
+// State changes that a sequence of draws causes. A pipeline or material bind is redundant when
+// the previous draw already used it; sorting turns binds into redundant ones that can be skipped.
+struct DrawStateStatistics
+{
+    uint32_t draws = 0;
+    uint32_t pipelineChanges = 0;
+    uint32_t materialChanges = 0;
+
+    [[nodiscard]] uint32_t GetRedundantPipelineBinds() const { return draws - pipelineChanges; }
+    [[nodiscard]] uint32_t GetRedundantMaterialBinds() const { return draws - materialChanges; }
+};
+
+class DrawStateCounter
+{
+public:
+    void AddDraw(uint64_t key);
+
+    [[nodiscard]] const DrawStateStatistics& GetStatistics() const;
+
+private:
+    DrawStateStatistics m_statistics;
+    uint64_t m_previousKey = 0;
+};
+
+struct DrawSortingBenchmarkResult
+{
+    uint32_t drawCount = 0;
+    double radixSortMs = 0.0;
+    double stdSortMs = 0.0;
+    double incrementalSortMs = 0.0;     // after changing the keys of 1% of the draws
+    double packMs = 0.0;
+};
+
+// Sorts a synthetic set of draws with the given count and reports the average times.
+DrawSortingBenchmarkResult BenchmarkDrawSorting(uint32_t drawCount, uint32_t iterations);
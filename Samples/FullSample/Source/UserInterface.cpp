@@ -33,16 +33,23 @@
  */
 
 #include "UserInterface.h"
+#include "AllocationTracker.h"
 #include "Profiler.h"
+#include "RayCountHeatmap.h"
 #include "SampleScene.h"
+#include "SceneCache.h"
 
 #include <donut/engine/IesProfile.h>
 #include <donut/app/Camera.h>
 #include <donut/app/UserInterfaceUtils.h>
 #include <donut/core/json.h>
+#include <donut/core/log.h>
 
 #include <json/writer.h>
 
+#include <cstring>
+#include <type_traits>
+
 using namespace donut;
 
 UIData::UIData()
@@ -196,6 +203,258 @@ void UIData::ApplyPreset()
     }
 }
 
+bool UIData::ApplySweepParameter(const std::string& name, float value)
+{
+    const uint32_t count = uint32_t(dm::max(value, 0.f));
+    const bool enable = (value != 0.f);
+
+    if (name == "numPrimaryLocalLightSamples")
+    {
+        // The sample count that is actually used depends on the local light sampling mode, set all of them
+        restirDI.numLocalLightUniformSamples = count;
+        restirDI.numLocalLightPowerRISSamples = count;
+        restirDI.numLocalLightReGIRRISSamples = count;
+        restirDI.initialSamplingParams.numPrimaryLocalLightSamples = count;
+    }
+    else if (name == "numPrimaryBrdfSamples")
+        restirDI.initialSamplingParams.numPrimaryBrdfSamples = count;
+    else if (name == "numPrimaryInfiniteLightSamples")
+        restirDI.initialSamplingParams.numPrimaryInfiniteLightSamples = count;
+    else if (name == "localLightSamplingMode")
+        restirDI.initialSamplingParams.localLightSamplingMode = static_cast<ReSTIRDI_LocalLightSamplingMode>(count);
+    else if (name == "resamplingMode")
+        restirDI.resamplingMode = static_cast<rtxdi::ReSTIRDI_ResamplingMode>(count);
+    else if (name == "temporalBiasCorrection")
+        restirDI.temporalResamplingParams.temporalBiasCorrection = static_cast<ReSTIRDI_TemporalBiasCorrectionMode>(count);
+    else if (name == "boilingFilter")
+        restirDI.temporalResamplingParams.enableBoilingFilter = enable;
+    else if (name == "numSpatialSamples")
+        restirDI.spatialResamplingParams.numSpatialSamples = count;
+    else if (name == "numDisocclusionBoostSamples")
+        restirDI.spatialResamplingParams.numDisocclusionBoostSamples = count;
+    else if (name == "spatialSamplingRadius")
+        restirDI.spatialResamplingParams.spatialSamplingRadius = value;
+    else if (name == "spatialBiasCorrection")
+        restirDI.spatialResamplingParams.spatialBiasCorrection = static_cast<ReSTIRDI_SpatialBiasCorrectionMode>(count);
+    else if (name == "reuseFinalVisibility")
+        restirDI.shadingParams.reuseFinalVisibility = enable;
+    else if (name == "resolutionScale")
+        resolutionScale = dm::clamp(value, 0.5f, 1.0f);
+    else if (name == "checkerboard")
+    {
+        rtxdi::CheckerboardMode newCheckerboardMode = enable ? rtxdi::CheckerboardMode::Black : rtxdi::CheckerboardMode::Off;
+        if (newCheckerboardMode != restirDIStaticParams.CheckerboardSamplingMode)
+        {
+            restirDIStaticParams.CheckerboardSamplingMode = newCheckerboardMode;
+            resetISContext = true;
+        }
+    }
+    else
+        return false;
+
+    preset = QualityPreset::Custom;
+    return true;
+}
+
+// Visits the settings that are stored in frame recordings, in a fixed order. Every setting is visited as a
+// scalar, so the snapshot has no struct padding, and enums are visited with their last valid value.
+// The members of the RTXDI parameter structs that the sample never changes keep their defaults and aren't stored.
+template<typename TData, typename TVisitor>
+static void VisitRecordedSettings(TData& ui, TVisitor&& visit)
+{
+#define RECORDED_SETTING(field) visit(#field, ui.field)
+#define RECORDED_ENUM(field, last) visit(#field, ui.field, last)
+    RECORDED_SETTING(enableTextures);
+    RECORDED_SETTING(framesToAccumulate);
+    RECORDED_SETTING(enableToneMapping);
+    RECORDED_SETTING(enablePixelJitter);
+    RECORDED_SETTING(exposureBias);
+    RECORDED_SETTING(verticalFov);
+    RECORDED_ENUM(preset, QualityPreset::Reference);
+    RECORDED_ENUM(aaMode, AntiAliasingMode::None);
+    RECORDED_ENUM(directLightingMode, DirectLightingMode::ReStir);
+    RECORDED_ENUM(indirectLightingMode, IndirectLightingMode::ReStirGI);
+    RECORDED_SETTING(enableAnimations);
+    RECORDED_SETTING(animationSpeed);
+    RECORDED_SETTING(environmentMapImportanceSampling);
+    RECORDED_SETTING(environmentIntensityBias);
+    RECORDED_SETTING(environmentRotation);
+    RECORDED_SETTING(noiseMix);
+    RECORDED_SETTING(noiseClampLow);
+    RECORDED_SETTING(noiseClampHigh);
+    RECORDED_SETTING(resolutionScale);
+    RECORDED_ENUM(restirDIStaticParams.CheckerboardSamplingMode, rtxdi::CheckerboardMode::White);
+    RECORDED_SETTING(freezeRegirPosition);
+    RECORDED_ENUM(debugRenderOutputBuffer, uint32_t(DebugRenderOutput::MotionVectors));
+
+    RECORDED_SETTING(gbufferSettings.roughnessOverride);
+    RECORDED_SETTING(gbufferSettings.metalnessOverride);
+    RECORDED_SETTING(gbufferSettings.enableRoughnessOverride);
+    RECORDED_SETTING(gbufferSettings.enableMetalnessOverride);
+    RECORDED_SETTING(gbufferSettings.normalMapScale);
+    RECORDED_SETTING(gbufferSettings.enableAlphaTestedGeometry);
+    RECORDED_SETTING(gbufferSettings.textureLodBias);
+    RECORDED_SETTING(gbufferSettings.enableGpuCulling);
+    RECORDED_SETTING(gbufferSettings.sortDraws);
+
+    RECORDED_SETTING(lightingSettings.denoiserMode);
+    RECORDED_SETTING(lightingSettings.enablePreviousTLAS);
+    RECORDED_SETTING(lightingSettings.enableAlphaTestedGeometry);
+    RECORDED_SETTING(lightingSettings.enableRayCounts);
+    RECORDED_SETTING(lightingSettings.enableGradients);
+    RECORDED_SETTING(lightingSettings.gradientLogDarknessBias);
+    RECORDED_SETTING(lightingSettings.gradientSensitivity);
+    RECORDED_SETTING(lightingSettings.confidenceHistoryLength);
+    RECORDED_SETTING(lightingSettings.enableSpecializedResampling);
+    RECORDED_SETTING(lightingSettings.brdfptParams.enableIndirectEmissiveSurfaces);
+    RECORDED_SETTING(lightingSettings.brdfptParams.enableSecondaryResampling);
+    RECORDED_SETTING(lightingSettings.brdfptParams.enableReSTIRGI);
+    RECORDED_SETTING(lightingSettings.brdfptParams.materialOverrideParams.roughnessOverride);
+    RECORDED_SETTING(lightingSettings.brdfptParams.materialOverrideParams.metalnessOverride);
+    RECORDED_SETTING(lightingSettings.brdfptParams.materialOverrideParams.minSecondaryRoughness);
+    RECORDED_SETTING(lightingSettings.brdfptParams.secondarySurfaceReSTIRDIParams.initialSamplingParams.numPrimaryLocalLightSamples);
+    RECORDED_SETTING(lightingSettings.brdfptParams.secondarySurfaceReSTIRDIParams.initialSamplingParams.numPrimaryInfiniteLightSamples);
+    RECORDED_SETTING(lightingSettings.brdfptParams.secondarySurfaceReSTIRDIParams.initialSamplingParams.numPrimaryEnvironmentSamples);
+    RECORDED_SETTING(lightingSettings.brdfptParams.secondarySurfaceReSTIRDIParams.spatialResamplingParams.numSpatialSamples);
+    RECORDED_ENUM(lightingSettings.brdfptParams.secondarySurfaceReSTIRDIParams.spatialResamplingParams.spatialBiasCorrection, ReSTIRDI_SpatialBiasCorrectionMode::Raytraced);
+    RECORDED_SETTING(lightingSettings.brdfptParams.secondarySurfaceReSTIRDIParams.spatialResamplingParams.spatialDepthThreshold);
+    RECORDED_SETTING(lightingSettings.brdfptParams.secondarySurfaceReSTIRDIParams.spatialResamplingParams.spatialNormalThreshold);
+    RECORDED_SETTING(lightingSettings.brdfptParams.secondarySurfaceReSTIRDIParams.spatialResamplingParams.spatialSamplingRadius);
+
+    RECORDED_SETTING(restirDI.numLocalLightUniformSamples);
+    RECORDED_SETTING(restirDI.numLocalLightPowerRISSamples);
+    RECORDED_SETTING(restirDI.numLocalLightReGIRRISSamples);
+    RECORDED_ENUM(restirDI.resamplingMode, rtxdi::ReSTIRDI_ResamplingMode::FusedSpatiotemporal);
+    RECORDED_SETTING(restirDI.initialSamplingParams.numPrimaryLocalLightSamples);
+    RECORDED_SETTING(restirDI.initialSamplingParams.numPrimaryInfiniteLightSamples);
+    RECORDED_SETTING(restirDI.initialSamplingParams.numPrimaryEnvironmentSamples);
+    RECORDED_SETTING(restirDI.initialSamplingParams.numPrimaryBrdfSamples);
+    RECORDED_SETTING(restirDI.initialSamplingParams.brdfCutoff);
+    RECORDED_SETTING(restirDI.initialSamplingParams.enableInitialVisibility);
+    RECORDED_SETTING(restirDI.initialSamplingParams.environmentMapImportanceSampling);
+    RECORDED_ENUM(restirDI.initialSamplingParams.localLightSamplingMode, ReSTIRDI_LocalLightSamplingMode::ReGIR_RIS);
+    RECORDED_SETTING(restirDI.temporalResamplingParams.temporalDepthThreshold);
+    RECORDED_SETTING(restirDI.temporalResamplingParams.temporalNormalThreshold);
+    RECORDED_SETTING(restirDI.temporalResamplingParams.maxHistoryLength);
+    RECORDED_ENUM(restirDI.temporalResamplingParams.temporalBiasCorrection, ReSTIRDI_TemporalBiasCorrectionMode::Raytraced);
+    RECORDED_SETTING(restirDI.temporalResamplingParams.enablePermutationSampling);
+    RECORDED_SETTING(restirDI.temporalResamplingParams.permutationSamplingThreshold);
+    RECORDED_SETTING(restirDI.temporalResamplingParams.enableBoilingFilter);
+    RECORDED_SETTING(restirDI.temporalResamplingParams.boilingFilterStrength);
+    RECORDED_SETTING(restirDI.temporalResamplingParams.discardInvisibleSamples);
+    RECORDED_SETTING(restirDI.spatialResamplingParams.numSpatialSamples);
+    RECORDED_SETTING(restirDI.spatialResamplingParams.numDisocclusionBoostSamples);
+    RECORDED_ENUM(restirDI.spatialResamplingParams.spatialBiasCorrection, ReSTIRDI_SpatialBiasCorrectionMode::Raytraced);
+    RECORDED_SETTING(restirDI.spatialResamplingParams.spatialDepthThreshold);
+    RECORDED_SETTING(restirDI.spatialResamplingParams.spatialNormalThreshold);
+    RECORDED_SETTING(restirDI.spatialResamplingParams.spatialSamplingRadius);
+    RECORDED_SETTING(restirDI.spatialResamplingParams.discountNaiveSamples);
+    RECORDED_SETTING(restirDI.shadingParams.enableFinalVisibility);
+    RECORDED_SETTING(restirDI.shadingParams.reuseFinalVisibility);
+    RECORDED_SETTING(restirDI.shadingParams.finalVisibilityMaxAge);
+    RECORDED_SETTING(restirDI.shadingParams.finalVisibilityMaxDistance);
+
+    RECORDED_ENUM(restirGI.resamplingMode, rtxdi::ReSTIRGI_ResamplingMode::FusedSpatiotemporal);
+    RECORDED_SETTING(restirGI.temporalResamplingParams.depthThreshold);
+    RECORDED_SETTING(restirGI.temporalResamplingParams.normalThreshold);
+    RECORDED_SETTING(restirGI.temporalResamplingParams.maxHistoryLength);
+    RECORDED_SETTING(restirGI.temporalResamplingParams.maxReservoirAge);
+    RECORDED_ENUM(restirGI.temporalResamplingParams.temporalBiasCorrectionMode, ResTIRGI_TemporalBiasCorrectionMode::Raytraced);
+    RECORDED_SETTING(restirGI.temporalResamplingParams.enablePermutationSampling);
+    RECORDED_SETTING(restirGI.temporalResamplingParams.enableFallbackSampling);
+    RECORDED_SETTING(restirGI.temporalResamplingParams.enableBoilingFilter);
+    RECORDED_SETTING(restirGI.temporalResamplingParams.boilingFilterStrength);
+    RECORDED_SETTING(restirGI.spatialResamplingParams.numSpatialSamples);
+    RECORDED_ENUM(restirGI.spatialResamplingParams.spatialBiasCorrectionMode, ResTIRGI_SpatialBiasCorrectionMode::Raytraced);
+    RECORDED_SETTING(restirGI.spatialResamplingParams.spatialDepthThreshold);
+    RECORDED_SETTING(restirGI.spatialResamplingParams.spatialNormalThreshold);
+    RECORDED_SETTING(restirGI.spatialResamplingParams.spatialSamplingRadius);
+    RECORDED_SETTING(restirGI.finalShadingParams.enableFinalVisibility);
+    RECORDED_SETTING(restirGI.finalShadingParams.enableFinalMIS);
+
+    RECORDED_ENUM(temporalJitter, donut::render::TemporalAntiAliasingJitter::WhiteNoise);
+#undef RECORDED_SETTING
+#undef RECORDED_ENUM
+}
+
+// Checks a recorded setting before it is assigned: bools must be 0 or 1, and enums can't be past their last value
+template<typename T, typename... TLast>
+static bool IsRecordedSettingValid(const uint8_t* bytes, const T&, TLast... last)
+{
+    if constexpr (std::is_same_v<T, bool>)
+        return *bytes <= 1;
+    else if constexpr (sizeof...(last) != 0)
+    {
+        using TInteger = typename std::conditional_t<std::is_enum_v<T>, std::underlying_type<T>, std::common_type<T>>::type;
+        TInteger value;
+        memcpy(&value, bytes, sizeof(value));
+        if constexpr (std::is_signed_v<TInteger>)
+        {
+            if (value < 0)
+                return false;
+        }
+        return value <= TInteger((last, ...));
+    }
+    else
+        return true;
+}
+
+void UIData::SaveRecordedSettings(std::vector<uint8_t>& data) const
+{
+    data.clear();
+    VisitRecordedSettings(*this, [&data](const char*, const auto& value, auto...)
+    {
+        static_assert(std::is_arithmetic_v<std::decay_t<decltype(value)>> || std::is_enum_v<std::decay_t<decltype(value)>>);
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(value));
+    });
+}
+
+bool UIData::LoadRecordedSettings(const std::vector<uint8_t>& data)
+{
+    // Validate the whole snapshot first, so that a bad recording doesn't leave the settings half-loaded
+    size_t expectedSize = 0;
+    bool valid = true;
+    VisitRecordedSettings(*this, [&data, &expectedSize, &valid](const char*, const auto& value, auto... last)
+    {
+        if (expectedSize + sizeof(value) <= data.size())
+            valid = valid && IsRecordedSettingValid(data.data() + expectedSize, value, last...);
+        expectedSize += sizeof(value);
+    });
+
+    if (!valid || data.size() != expectedSize)
+        return false;
+
+    const rtxdi::CheckerboardMode oldCheckerboardMode = restirDIStaticParams.CheckerboardSamplingMode;
+
+    size_t offset = 0;
+    VisitRecordedSettings(*this, [&data, &offset](const char*, auto& value, auto...)
+    {
+        memcpy(&value, data.data() + offset, sizeof(value));
+        offset += sizeof(value);
+    });
+
+    // The static parameters are baked into the importance sampling context
+    if (restirDIStaticParams.CheckerboardSamplingMode != oldCheckerboardMode)
+        resetISContext = true;
+
+    return true;
+}
+
+uint64_t UIData::GetRecordedSettingsLayout() const
+{
+    // The names, sizes and order of the settings, so that any change to the list changes the layout
+    SceneCacheHasher hasher;
+    VisitRecordedSettings(*this, [&hasher](const char* name, const auto& value, auto...)
+    {
+        const uint32_t size = uint32_t(sizeof(value));
+        hasher.Update(name, strlen(name) + 1);
+        hasher.Update(&size, sizeof(size));
+    });
+
+    return hasher.GetHash();
+}
+
 UserInterface::UserInterface(app::DeviceManager* deviceManager, vfs::IFileSystem& rootFS, UIData& ui) :
     ImGui_Renderer(deviceManager),
     m_ui(ui),
@@ -220,6 +479,65 @@ static void ShowHelpMarker(const char* desc)
     }
 }
 
+void UserInterface::RayCountTilesUI()
+{
+    Profiler& profiler = *m_ui.resources->profiler;
+
+    bool enableTiles = profiler.IsTileRayCountsEnabled();
+    ImGui::Checkbox("Per-Tile Counters", &enableTiles);
+    profiler.EnableTileRayCounts(enableTiles);
+
+    if (!enableTiles)
+    {
+        ImGui::TreePop();
+        return;
+    }
+
+    int section = profiler.GetTileRayCountSection();
+    if (ImGui::BeginCombo("Pass", section < 0 ? "All" : Profiler::GetSectionName(ProfilerSection::Enum(section))))
+    {
+        if (ImGui::Selectable("All", section < 0))
+            section = -1;
+
+        for (int index = 0; index < ProfilerSection::Count; index++)
+        {
+            if (ImGui::Selectable(Profiler::GetSectionName(ProfilerSection::Enum(index)), section == index))
+                section = index;
+        }
+        ImGui::EndCombo();
+    }
+    profiler.SetTileRayCountSection(section);
+
+    bool accumulate = profiler.IsTileRayCountAccumulationEnabled();
+    ImGui::Checkbox("Accumulate", &accumulate);
+    profiler.EnableTileRayCountAccumulation(accumulate);
+    ImGui::SameLine();
+    if (ImGui::Button("Reset"))
+        profiler.ResetTileRayCounts();
+
+    const RayCountTileGrid& tiles = profiler.GetRayCountTiles();
+    const RayCountSummary summary = SummarizeRayCounts(tiles);
+    ImGui::Text("%ux%u tiles, %u frame(s)", tiles.gridWidth, tiles.gridHeight, tiles.frameCount);
+    ImGui::Text("Rays/pixel: %.3f mean, %.3f max", summary.meanRaysPerPixel, summary.maxRaysPerPixel);
+
+    ImGui::TextUnformatted("Hottest tiles:");
+    for (const RayCountTile& tile : FindHottestTiles(tiles, 5))
+    {
+        ImGui::Text("  (%u, %u): %.3f rays/pixel, %.1f%% hits", tile.x * tiles.tileSize, tile.y * tiles.tileSize,
+            tile.raysPerPixel, tile.traced ? 100.0 * double(tile.hits) / double(tile.traced) : 0.0);
+    }
+
+    if (ImGui::Button("Export"))
+    {
+        if (ExportRayCountTiles(tiles, "RayCount"))
+            log::info("Saved the ray count heatmap to RayCountHeatmap.bmp, RayCountTiles.csv and RayCountHistogram.csv");
+        else
+            log::warning("Failed to export the ray count tiles");
+    }
+
+    ImGui::TreePop();
+}
+
 void UserInterface::PerformanceWindow()
 {
     double frameTime = GetDeviceManager()->GetAverageFrameTimeSeconds();
@@ -235,6 +553,115 @@ void UserInterface::PerformanceWindow()
         ImGui::Checkbox("Count Rays", (bool*)&m_ui.lightingSettings.enableRayCounts);
 
         m_ui.resources->profiler->BuildUI(m_ui.lightingSettings.enableRayCounts);
+
+        if (m_ui.lightingSettings.enableRayCounts && ImGui::TreeNode("Ray Count Tiles"))
+            RayCountTilesUI();
+    }
+
+    if (m_ui.resources->scene && ImGui::TreeNode("BLAS Memory"))
+    {
+        const BlasMemoryStats stats = m_ui.resources->scene->GetBlasMemoryStats();
+        ImGui::Text("Shared heap: %.1f MB", double(stats.accelStructHeapSize) / double(1 << 20));
+        ImGui::Text("Static BLAS'es before compaction: %.1f MB", double(stats.staticBlasMemory) / double(1 << 20));
+        ImGui::Text("Compacted: %zu / %zu", stats.compactedStaticBlases, stats.builtStaticBlases + stats.pendingStaticBlases);
+        if (stats.pendingStaticBlases)
+            ImGui::Text("Waiting to be built: %zu", stats.pendingStaticBlases);
+
+        ImGui::TreePop();
+    }
+
+    if (m_ui.resources->scene && ImGui::TreeNode("Skinned BLAS Updates"))
+    {
+        std::vector<SkinnedBlasStats> skinnedBlasStats;
+        m_ui.resources->scene->GetSkinnedBlasStats(skinnedBlasStats);
+
+        uint64_t totalRefits = 0;
+        uint64_t totalRebuilds = 0;
+        for (const SkinnedBlasStats& meshStats : skinnedBlasStats)
+        {
+            totalRefits += meshStats.refits;
+            totalRebuilds += meshStats.rebuilds;
+        }
+
+        ImGui::Text("%zu meshes, %llu refits, %llu rebuilds", skinnedBlasStats.size(),
+            (unsigned long long)totalRefits, (unsigned long long)totalRebuilds);
+
+        if (!skinnedBlasStats.empty() && ImGui::BeginTable("SkinnedBlasStats", 4, ImGuiTableFlags_ScrollY, ImVec2(0.f, 200.f)))
+        {
+            ImGui::TableSetupColumn(" Mesh");
+            ImGui::TableSetupColumn(" Refits");
+            ImGui::TableSetupColumn(" Rebuilds");
+            ImGui::TableSetupColumn(" Growth");
+            ImGui::TableHeadersRow();
+
+            for (const SkinnedBlasStats& meshStats : skinnedBlasStats)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%s", meshStats.name.c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%u", meshStats.refits);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%u", meshStats.rebuilds);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%.1f%%", meshStats.boundsGrowth * 100.f);
+            }
+
+            ImGui::EndTable();
+        }
+
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("G-Buffer Draw Order"))
+    {
+        const auto& drawOrder = m_ui.gbufferDrawOrder;
+        ImGui::Text("Submitted: %u draws, %u pipeline changes, %u material changes", drawOrder.submitted.draws,
+            drawOrder.submitted.pipelineChanges, drawOrder.submitted.materialChanges);
+        ImGui::Text("Scene order: %u draws, %u pipeline changes, %u material changes", drawOrder.sceneOrder.draws,
+            drawOrder.sceneOrder.pipelineChanges, drawOrder.sceneOrder.materialChanges);
+        ImGui::Text("Re-sorted this frame: %u", drawOrder.resortedDraws);
+
+        ImGui::TreePop();
+    }
+
+    if (AllocationTracker::IsAvailable() && ImGui::TreeNode("CPU Allocations"))
+    {
+        const AllocationFrameStats& stats = AllocationTracker::GetLastFrameStats();
+
+        ImGui::BeginTable("Allocations", 3);
+        ImGui::TableSetupColumn(" Scope");
+        ImGui::TableSetupColumn("Allocs", ImGuiTableColumnFlags_WidthFixed, 50.f);
+        ImGui::TableSetupColumn("Bytes", ImGuiTableColumnFlags_WidthFixed, 70.f);
+        ImGui::TableHeadersRow();
+
+        for (uint32_t scope = 0; scope < stats.scopes.size(); scope++)
+        {
+            const AllocationStats& scopeStats = stats.scopes[scope];
+            if (scopeStats.allocations == 0)
+                continue;
+
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s", (scope == AllocationFrameStats::OtherScope) ? "Other" : Profiler::GetSectionName(ProfilerSection::Enum(scope)));
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%llu", (unsigned long long)scopeStats.allocations);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%llu", (unsigned long long)scopeStats.bytes);
+        }
+
+        ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(0xff, 0xff, 0x40, 0xff));
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::Text("Total");
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%llu", (unsigned long long)stats.total.allocations);
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%llu", (unsigned long long)stats.total.bytes);
+        ImGui::PopStyleColor();
+
+        ImGui::EndTable();
+        ImGui::TreePop();
     }
 }
 
@@ -277,11 +704,45 @@ void UserInterface::GeneralRenderingSettings()
             m_ui.useRayQuery = false;
         }
 
+        ImGui::Checkbox("Create Pipelines in Background", (bool*)&m_ui.asyncPipelineCreation);
+        if (m_ui.creatingPipelines)
+        {
+            ImGui::SameLine();
+            ImGui::TextUnformatted("(compiling...)");
+        }
+
+        ImGui::Checkbox("Specialized Resampling Shaders", (bool*)&m_ui.lightingSettings.enableSpecializedResampling);
+        ShowHelpMarker(
+            "Uses resampling shaders compiled for the current bias correction, boiling filter and local light sampling "
+            "settings. The generic shaders are used while the specialized pipelines are being created. RayQuery only.");
+
+        ImGui::Checkbox("Prepare Lights on Compute Queue", (bool*)&m_ui.asyncComputeLightPreparation);
+        ShowHelpMarker(
+            "Runs the light preparation and the local light PDF mipmap generation on the compute queue, "
+            "overlapping the G-buffer rendering. Needs a device with a compute queue.");
+
+        ImGui::Checkbox("Parallel Command Recording", (bool*)&m_ui.parallelCommandRecording);
+        ShowHelpMarker(
+            "Records the G-buffer draws on worker threads, and the G-buffer and the light preparation "
+            "concurrently, each into command lists of their own.");
+
         int resolutionScalePercents = int(m_ui.resolutionScale * 100.f);
         ImGui::SliderInt("Resolution Scale (%)", &resolutionScalePercents, 50, 100);
         m_ui.resolutionScale = float(resolutionScalePercents) * 0.01f;
         m_ui.resolutionScale = dm::clamp(m_ui.resolutionScale, 0.5f, 1.0f);
 
+        ImGui::Checkbox("Frame Time Budget", (bool*)&m_ui.frameTimeBudget.enabled);
+        ShowHelpMarker(
+            "Adjusts the resolution scale, checkerboard sampling and the local light, spatial and BRDF sample counts "
+            "to hold the target frame time. Uses the GPU frame time when the profiler is enabled. "
+            "Inactive during benchmarks, parameter sweeps and frame playback.");
+        if (m_ui.frameTimeBudget.enabled)
+        {
+            ImGui::SliderFloat("Target Frame Time (ms)", &m_ui.frameTimeBudget.targetFrameTimeMs, 4.f, 50.f);
+            ImGui::Text("Quality level %d / %d, %.2f ms", m_ui.frameTimeBudget.level + 1, m_ui.frameTimeBudget.levelCount,
+                m_ui.frameTimeBudget.filteredFrameTimeMs);
+        }
+
         ImGui::Checkbox("##enableFpsLimit", &m_ui.enableFpsLimit);
         ImGui::SameLine();
         ImGui::PushItemWidth(69.f);
@@ -808,6 +1269,19 @@ void UserInterface::SceneSettings()
         ImGui::PopItemWidth();
 
         m_ui.resetAccumulation |= ImGui::Checkbox("Alpha-Tested Geometry", (bool*)&m_ui.gbufferSettings.enableAlphaTestedGeometry);
+        ImGui::Checkbox("GPU G-Buffer Culling", &m_ui.gbufferSettings.enableGpuCulling);
+        ImGui::Checkbox("Sort G-Buffer Draws", &m_ui.gbufferSettings.sortDraws);
+
+        ImGui::Checkbox("Refit Skinned BLAS'es", &m_ui.skinnedBlasRefit.enableRefit);
+        if (m_ui.skinnedBlasRefit.enableRefit)
+        {
+            ImGui::PushItemWidth(89.f);
+            int rebuildInterval = int(m_ui.skinnedBlasRefit.rebuildInterval);
+            if (ImGui::SliderInt("Refits Between Rebuilds", &rebuildInterval, 0, 64))
+                m_ui.skinnedBlasRefit.rebuildInterval = uint32_t(rebuildInterval);
+            ImGui::SliderFloat("Max Bounds Growth", &m_ui.skinnedBlasRefit.maxBoundsGrowth, 0.f, 1.f);
+            ImGui::PopItemWidth();
+        }
 
         const auto& environmentMaps = m_ui.resources->scene->GetEnvironmentMaps();
 
@@ -1103,6 +1577,92 @@ void UserInterface::SceneSettings()
             }
         }
 
+        ImGui::Separator();
+        ImGui::TextUnformatted("Parameter Sweep");
+        ShowHelpMarker(
+            "Renders every combination of the listed settings along the benchmark camera path, "
+            "measures the frame time and the image error against a reference rendering, "
+            "and reports the Pareto front of cost versus error.\n"
+            "Grid syntax: name=v1,v2,...; name=...\n"
+            "Parameters: numPrimaryLocalLightSamples, numPrimaryBrdfSamples, numPrimaryInfiniteLightSamples, "
+            "localLightSamplingMode, resamplingMode, temporalBiasCorrection, boilingFilter, "
+            "numSpatialSamples, numDisocclusionBoostSamples, spatialSamplingRadius, spatialBiasCorrection, "
+            "reuseFinalVisibility, resolutionScale, checkerboard");
+
+        if (m_ui.parameterSweep.running)
+        {
+            if (ImGui::Button("Stop Sweep"))
+            {
+                m_ui.parameterSweep.stop = true;
+            }
+            ImGui::SameLine();
+            ImGui::Text("Configuration %d / %d", m_ui.parameterSweep.completedPoints + 1, m_ui.parameterSweep.totalPoints);
+        }
+        else
+        {
+            ImGui::PushItemWidth(300.f);
+            ImGui::InputText("Grid", m_ui.parameterSweep.grid, sizeof(m_ui.parameterSweep.grid));
+            ImGui::PopItemWidth();
+
+            ParameterSweepSettings& sweepSettings = m_ui.parameterSweep.settings;
+            ImGui::SliderInt("Warmup Frames", (int*)&sweepSettings.warmupFrames, 0, 240);
+            ImGui::SliderInt("Measured Frames", (int*)&sweepSettings.measuredFrames, 1, 960);
+            ImGui::Checkbox("Measure Image Error", &sweepSettings.captureReference);
+            if (sweepSettings.captureReference)
+            {
+                ImGui::SliderInt("Reference Frames", (int*)&sweepSettings.referenceFrames, 1, 256);
+                ImGui::Combo("Error Metric", (int*)&sweepSettings.errorMetric, "RMSE\0RelMSE\0");
+            }
+
+            if (ImGui::Button("Start Sweep"))
+            {
+                m_ui.parameterSweep.start = true;
+            }
+        }
+
+        if (!m_ui.parameterSweep.errorMessage.empty())
+        {
+            ImGui::TextColored(ImVec4(1.f, 0.25f, 0.25f, 1.f), "%s", m_ui.parameterSweep.errorMessage.c_str());
+        }
+
+        ImGui::Separator();
+        ImGui::TextUnformatted("Frame Recording");
+        ShowHelpMarker(
+            "Records the camera, render settings, animation time, environment map and frame index of every frame "
+            "into a file, and replays them later without using the keyboard or mouse. "
+            "Recordings only replay on the same build of the sample.");
+
+        if (m_ui.frameRecording.recording || m_ui.frameRecording.playing)
+        {
+            if (ImGui::Button(m_ui.frameRecording.recording ? "Stop Recording" : "Stop Playback"))
+            {
+                m_ui.frameRecording.stop = true;
+            }
+            ImGui::SameLine();
+            ImGui::Text("Frame %d", m_ui.frameRecording.frames);
+        }
+        else
+        {
+            ImGui::PushItemWidth(300.f);
+            ImGui::InputText("File", m_ui.frameRecording.fileName, sizeof(m_ui.frameRecording.fileName));
+            ImGui::PopItemWidth();
+
+            if (ImGui::Button("Record"))
+            {
+                m_ui.frameRecording.startRecording = true;
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Replay"))
+            {
+                m_ui.frameRecording.startPlayback = true;
+            }
+        }
+
+        if (!m_ui.frameRecording.errorMessage.empty())
+        {
+            ImGui::TextColored(ImVec4(1.f, 0.25f, 0.25f, 1.f), "%s", m_ui.frameRecording.errorMessage.c_str());
+        }
+
         ImGui::TreePop();
     }
 
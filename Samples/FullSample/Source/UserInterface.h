@@ -22,9 +22,12 @@
 #include <donut/app/imgui_renderer.h>
 #include "RenderPasses/GBufferPass.h"
 #include "RenderPasses/LightingPasses.h"
+#include "ParameterSweep.h"
+#include "SkinnedBlasRefitPolicy.h"
 
 #include <optional>
 #include <string>
+#include <vector>
 
 
 class SampleScene;
@@ -108,6 +111,10 @@ struct UIData
     ibool enableToneMapping = true;
     ibool enablePixelJitter = true;
     ibool useRayQuery = true;
+    ibool asyncPipelineCreation = true;
+    ibool asyncComputeLightPreparation = false;
+    ibool parallelCommandRecording = false;
+    bool creatingPipelines = false;
     float exposureBias = -1.0f;
     float verticalFov = 60.f;
 
@@ -121,6 +128,7 @@ struct UIData
     IndirectLightingMode indirectLightingMode = IndirectLightingMode::ReStirGI;
     ibool enableAnimations = true;
     float animationSpeed = 1.f;
+    SkinnedBlasRefitSettings skinnedBlasRefit;
     int environmentMapDirty = 0; // 1 -> needs to be rendered; 2 -> passes/textures need to be created
     int environmentMapIndex = -1;
     bool environmentMapImportanceSampling = true;
@@ -143,6 +151,46 @@ struct UIData
     std::optional<int> animationFrame;
     std::string benchmarkResults;
 
+    struct
+    {
+        char grid[512] = "numPrimaryLocalLightSamples=2,4,8; numSpatialSamples=1,2,4; temporalBiasCorrection=0,3; checkerboard=0,1";
+        ParameterSweepSettings settings;
+        bool start = false;
+        bool stop = false;
+        bool running = false;
+        uint32_t completedPoints = 0;
+        uint32_t totalPoints = 0;
+        std::string errorMessage;
+    } parameterSweep;
+
+    struct
+    {
+        char fileName[256] = "FrameRecording.rtxrec";
+        bool startRecording = false;
+        bool startPlayback = false;
+        bool stop = false;
+        bool recording = false;
+        bool playing = false;
+        uint32_t frames = 0;
+        std::string errorMessage;
+    } frameRecording;
+
+    struct
+    {
+        ibool enabled = false;
+        float targetFrameTimeMs = 16.6f;
+        uint32_t level = 0;
+        uint32_t levelCount = 0;
+        float filteredFrameTimeMs = 0.f;
+    } frameTimeBudget;
+
+    struct
+    {
+        DrawStateStatistics submitted;
+        DrawStateStatistics sceneOrder;
+        uint32_t resortedDraws = 0;
+    } gbufferDrawOrder;
+
     uint32_t debugRenderOutputBuffer = 0; // See DebugRenderOutput enum above
 
     bool storeReferenceImage = false;
@@ -179,6 +227,17 @@ struct UIData
     UIData();
 
     void ApplyPreset();
+
+    // Sets one of the named settings that can be used as a parameter sweep axis.
+    // Returns false if the name is not recognized.
+    bool ApplySweepParameter(const std::string& name, float value);
+
+    // Snapshot of the settings that affect rendering, stored in frame recordings field by field.
+    // LoadRecordedSettings rejects snapshots of the wrong size or with out-of-range values and then
+    // leaves the settings unchanged. Recordings store GetRecordedSettingsLayout to reject other builds.
+    void SaveRecordedSettings(std::vector<uint8_t>& data) const;
+    bool LoadRecordedSettings(const std::vector<uint8_t>& data);
+    [[nodiscard]] uint64_t GetRecordedSettingsLayout() const;
 };
 
 
@@ -195,6 +254,7 @@ private:
     void CopyCamera() const;
 
     void PerformanceWindow();
+    void RayCountTilesUI();
     void SceneSettings();
     void GeneralRenderingSettings();
     void SamplingSettings();
@@ -39,12 +39,32 @@
 #include "RenderPasses/LightingPasses.h"
 #include "RenderPasses/PrepareLightsPass.h"
 #include "RenderPasses/RenderEnvironmentMapPass.h"
+#include "AllocationTracker.h"
+#include "AsyncComputeSchedule.h"
+#include "BindingSetCache.h"
+#include "CachedBindingSetFactory.h"
+#include "CachedShaderFactory.h"
+#include "FrameRecording.h"
+#include "FrameTimeController.h"
+#include "ParallelRecording.h"
+#include "ParameterSweep.h"
 #include "Profiler.h"
+#include "RenderGraph.h"
 #include "RenderTargets.h"
 #include "RtxdiResources.h"
 #include "SampleScene.h"
+#include "ShaderConfig.h"
+#include "ShaderDependencyGraph.h"
+#include "ShaderPermutationCache.h"
 #include "UserInterface.h"
 
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_set>
+
 #ifndef _WIN32
 #include <unistd.h>
 #else
@@ -61,6 +81,136 @@ using namespace std::chrono;
 
 static int g_ExitCode = 0;
 
+// Set from the command line to run the allocation budget test
+static std::optional<AllocationBudgetSettings> g_AllocationBudget;
+
+// Set from the command line to record frames into a file, or to replay them and exit
+static std::string g_RecordFramesFile;
+static std::string g_ReplayFramesFile;
+
+// Scratch memory budget and mode for the static BLAS builds, see BlasBuildPlanner.h
+static BlasBuildPlannerSettings g_BlasBuildSettings;
+static bool g_CompactStaticBLASes = true;
+
+// Directory for the binary scene cache, see SceneCache.h. The cache is not used when empty.
+static std::filesystem::path g_SceneCacheDirectory;
+
+// Directory for the shader permutation cache, see ShaderPermutationCache.h. The cache is not used when empty.
+static std::filesystem::path g_ShaderCacheDirectory;
+
+// Usage file that collects the shader permutations requested by the application, see ShaderConfig.h,
+// and the Shaders.cfg to prune down to the permutations in it
+static std::filesystem::path g_ShaderUsageFile;
+static std::filesystem::path g_PruneShaderConfigFile;
+
+// Directory of the shader sources, see ShaderDependencyGraph.h. Found next to the executable when empty.
+static std::filesystem::path g_ShaderSourceDirectory;
+
+static bool ReadTextFile(const std::filesystem::path& path, std::string& text)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    text = stream.str();
+    return true;
+}
+
+// Finds the application shader sources and the RTXDI include directory they are compiled with
+static bool FindShaderSources(std::filesystem::path& sourceDirectory, std::vector<std::filesystem::path>& includeDirectories)
+{
+    sourceDirectory = g_ShaderSourceDirectory;
+    if (sourceDirectory.empty())
+    {
+        for (const std::filesystem::path& root : { app::GetDirectoryWithExecutable().parent_path(), app::GetDirectoryWithExecutable().parent_path().parent_path() })
+        {
+            if (std::filesystem::exists(root / "Samples/FullSample/Shaders/Shaders.cfg"))
+            {
+                sourceDirectory = root / "Samples/FullSample/Shaders";
+                break;
+            }
+        }
+    }
+
+    if (sourceDirectory.empty() || !std::filesystem::is_directory(sourceDirectory))
+        return false;
+
+    includeDirectories = { sourceDirectory.parent_path().parent_path().parent_path() / "Libraries/Rtxdi/Include" };
+    return true;
+}
+
+// Writes the permutations of the configuration that appear in the usage file to <name>.pruned.cfg
+static void PruneShaderConfigFile()
+{
+    std::string configText;
+    std::string usageText;
+    if (!ReadTextFile(g_PruneShaderConfigFile, configText) || !ReadTextFile(g_ShaderUsageFile, usageText))
+    {
+        log::error("Cannot read %s or the shader usage file %s", g_PruneShaderConfigFile.string().c_str(), g_ShaderUsageFile.string().c_str());
+        g_ExitCode = 1;
+        return;
+    }
+
+    const ShaderConfig config = ParseShaderConfig(configText);
+    ShaderUsageRecorder usage;
+    usage.Merge(ParseShaderConfig(usageText));
+
+    for (const std::string& error : config.errors)
+        log::warning("%s: %s", g_PruneShaderConfigFile.string().c_str(), error.c_str());
+
+    const ShaderConfigPruneResult result = PruneShaderConfig(config, usage.GetPermutations());
+    for (const ShaderConfigPermutation& permutation : result.unmatched)
+        log::warning("Used shader %s -T %s is not compiled by %s", permutation.source.c_str(), permutation.target.c_str(), g_PruneShaderConfigFile.string().c_str());
+
+    std::filesystem::path outputPath = g_PruneShaderConfigFile;
+    outputPath.replace_extension(".pruned.cfg");
+    std::ofstream output(outputPath);
+    output << WriteShaderConfig(result.config);
+    if (!output)
+    {
+        log::error("Cannot write %s", outputPath.string().c_str());
+        g_ExitCode = 1;
+        return;
+    }
+
+    log::info("Wrote %s: %u of %u permutations on %u lines, %u used permutations not compiled",
+        outputPath.string().c_str(), result.keptPermutations, result.keptPermutations + result.removedPermutations,
+        uint32_t(result.config.entries.size()), uint32_t(result.unmatched.size()));
+}
+
+static RecordedView MakeRecordedView(const affine3& worldToView, float verticalFov, float zNear)
+{
+    const float3 rows[3] = { worldToView.m_linear.row0, worldToView.m_linear.row1, worldToView.m_linear.row2 };
+
+    RecordedView view;
+    for (int row = 0; row < 3; row++)
+    {
+        view.worldToView[row * 3 + 0] = rows[row].x;
+        view.worldToView[row * 3 + 1] = rows[row].y;
+        view.worldToView[row * 3 + 2] = rows[row].z;
+    }
+    view.worldToView[9] = worldToView.m_translation.x;
+    view.worldToView[10] = worldToView.m_translation.y;
+    view.worldToView[11] = worldToView.m_translation.z;
+    view.verticalFov = verticalFov;
+    view.zNear = zNear;
+    return view;
+}
+
+static affine3 GetRecordedWorldToView(const RecordedView& view)
+{
+    const auto& m = view.worldToView;
+
+    affine3 worldToView;
+    worldToView.m_linear.row0 = float3(m[0], m[1], m[2]);
+    worldToView.m_linear.row1 = float3(m[3], m[4], m[5]);
+    worldToView.m_linear.row2 = float3(m[6], m[7], m[8]);
+    worldToView.m_translation = float3(m[9], m[10], m[11]);
+    return worldToView;
+}
+
 class SceneRenderer : public app::ApplicationBase
 {
 public:
@@ -70,6 +220,21 @@ public:
         , m_ui(ui)
     { 
         m_ui.resources->camera = &m_camera;
+
+        if (g_AllocationBudget.has_value())
+            m_allocationBudgetTest = std::make_unique<AllocationBudgetTest>(*g_AllocationBudget);
+
+        if (!g_ReplayFramesFile.empty())
+        {
+            strncpy(m_ui.frameRecording.fileName, g_ReplayFramesFile.c_str(), sizeof(m_ui.frameRecording.fileName) - 1);
+            m_ui.frameRecording.startPlayback = true;
+            m_exitAfterPlayback = true;
+        }
+        else if (!g_RecordFramesFile.empty())
+        {
+            strncpy(m_ui.frameRecording.fileName, g_RecordFramesFile.c_str(), sizeof(m_ui.frameRecording.fileName) - 1);
+            m_ui.frameRecording.startRecording = true;
+        }
     }
 
     [[nodiscard]] std::shared_ptr<engine::ShaderFactory> GetShaderFactory() const
@@ -77,6 +242,19 @@ public:
         return m_shaderFactory;
     }
 
+    void SaveShaderUsage() const
+    {
+        if (g_ShaderUsageFile.empty())
+            return;
+
+        std::ofstream file(g_ShaderUsageFile);
+        file << WriteShaderConfig(m_shaderUsage.GetUsage());
+        if (file)
+            log::info("Wrote %u shader permutations to %s", uint32_t(m_shaderUsage.GetPermutations().size()), g_ShaderUsageFile.string().c_str());
+        else
+            log::warning("Cannot write the shader usage file %s", g_ShaderUsageFile.string().c_str());
+    }
+
     [[nodiscard]] std::shared_ptr<vfs::IFileSystem> GetRootFs() const
     {
         return m_rootFs;
@@ -108,6 +286,38 @@ public:
         m_rootFs->mount("/shaders/app", appShaderPath);
 
         m_shaderFactory = std::make_shared<engine::ShaderFactory>(GetDevice(), m_rootFs, "/shaders");
+
+        if (!g_ShaderCacheDirectory.empty())
+        {
+            const std::filesystem::path cachePath = g_ShaderCacheDirectory / (std::string("ShaderPermutations-") + app::GetShaderTypeName(GetDevice()->getGraphicsAPI()) + ".cache");
+
+            std::error_code error;
+            std::filesystem::create_directories(g_ShaderCacheDirectory, error);
+
+            m_shaderCache = std::make_unique<ShaderPermutationCache>();
+            if (!m_shaderCache->Open(cachePath))
+                log::warning("Ignoring the shader cache %s: %s", cachePath.string().c_str(), m_shaderCache->GetError().c_str());
+        }
+
+        m_appShaderFactory = std::make_shared<CachedShaderFactory>(GetDevice(), *m_shaderFactory, m_shaderCache.get(), appShaderPath);
+        m_bindingSetFactory = std::make_shared<CachedBindingSetFactory>(GetDevice());
+
+        if (!g_ShaderUsageFile.empty())
+        {
+            // Accumulate the permutations of several runs
+            std::string usageText;
+            if (ReadTextFile(g_ShaderUsageFile, usageText))
+                m_shaderUsage.Merge(ParseShaderConfig(usageText));
+
+            m_appShaderFactory->SetUsageRecorder(&m_shaderUsage);
+        }
+
+        // Snapshot of the sources of the loaded shaders, compared on reload
+        std::filesystem::path shaderSourceDirectory;
+        std::vector<std::filesystem::path> shaderIncludeDirectories;
+        if (!FindShaderSources(shaderSourceDirectory, shaderIncludeDirectories) || !m_shaderWatcher.Start(shaderSourceDirectory, shaderIncludeDirectories))
+            log::info("Shader sources not found, reloading shaders will recreate all pipelines");
+
         m_CommonPasses = std::make_shared<engine::CommonRenderPasses>(GetDevice(), m_shaderFactory);
 
         {
@@ -135,6 +345,12 @@ public:
         auto sceneTypeFactory = std::make_shared<SampleSceneTypeFactory>();
         m_scene = std::make_shared<SampleScene>(GetDevice(), *m_shaderFactory, m_rootFs, m_TextureCache, m_descriptorTableManager, sceneTypeFactory);
         m_ui.resources->scene = m_scene;
+        m_scene->SetSceneCacheDirectory(g_SceneCacheDirectory);
+
+#ifdef DONUT_WITH_TASKFLOW
+        m_executor = std::make_unique<tf::Executor>();
+        m_scene->SetExecutor(m_executor.get());
+#endif
 
         SetAsynchronousLoadingEnabled(true);
         BeginLoadingScene(m_rootFs, scenePath);
@@ -146,11 +362,15 @@ public:
         m_profiler = std::make_shared<Profiler>(*GetDeviceManager());
         m_ui.resources->profiler = m_profiler;
 
-        m_compositingPass = std::make_unique<CompositingPass>(GetDevice(), m_shaderFactory, m_CommonPasses, m_scene, m_bindlessLayout);
-        m_rasterizedGBufferPass = std::make_unique<RasterizedGBufferPass>(GetDevice(), m_shaderFactory, m_CommonPasses, m_scene, m_profiler, m_bindlessLayout);
-        m_postprocessGBufferPass = std::make_unique<PostprocessGBufferPass>(GetDevice(), m_shaderFactory);
-        m_prepareLightsPass = std::make_unique<PrepareLightsPass>(GetDevice(), m_shaderFactory, m_CommonPasses, m_scene, m_bindlessLayout);
-        m_lightingPasses = std::make_unique<LightingPasses>(GetDevice(), m_shaderFactory, m_CommonPasses, m_scene, m_profiler, m_bindlessLayout);
+        m_compositingPass = std::make_unique<CompositingPass>(GetDevice(), m_appShaderFactory, m_bindingSetFactory, m_CommonPasses, m_scene, m_bindlessLayout);
+        m_rasterizedGBufferPass = std::make_unique<RasterizedGBufferPass>(GetDevice(), m_appShaderFactory, m_CommonPasses, m_scene, m_profiler, m_bindlessLayout);
+        m_postprocessGBufferPass = std::make_unique<PostprocessGBufferPass>(GetDevice(), m_appShaderFactory, m_bindingSetFactory);
+        m_prepareLightsPass = std::make_unique<PrepareLightsPass>(GetDevice(), m_appShaderFactory, m_bindingSetFactory, m_CommonPasses, m_scene, m_bindlessLayout);
+        m_lightingPasses = std::make_unique<LightingPasses>(GetDevice(), m_appShaderFactory, m_bindingSetFactory, m_CommonPasses, m_scene, m_profiler, m_bindlessLayout);
+#ifdef DONUT_WITH_TASKFLOW
+        m_rasterizedGBufferPass->SetExecutor(m_executor.get());
+        m_lightingPasses->SetExecutor(m_executor.get());
+#endif
 
         LoadShaders();
 
@@ -242,7 +462,12 @@ public:
         
         m_rasterizedGBufferPass->CreateBindingSet();
 
-        m_scene->BuildMeshBLASes(GetDevice());
+        // Replays must see the whole scene from the first frame to be deterministic
+        BlasBuildPlannerSettings blasBuildSettings = g_BlasBuildSettings;
+        if (!g_ReplayFramesFile.empty())
+            blasBuildSettings.progressive = false;
+
+        m_scene->BuildMeshBLASes(GetDevice(), blasBuildSettings, g_CompactStaticBLASes);
 
         GetDeviceManager()->SetVsyncEnabled(false);
 
@@ -256,6 +481,34 @@ public:
         m_prepareLightsPass->CreatePipeline();
     }
 
+    // Recreates the pipelines of the passes outside of LightingPasses that use one of the shaders
+    void ReloadShaders(const std::unordered_set<std::string>& shaderNames)
+    {
+        auto reloaded = [&shaderNames](const char* shaderName) { return shaderNames.count(shaderName) != 0; };
+
+        if (reloaded("app/CompositingPass.hlsl"))
+            m_compositingPass->CreatePipeline();
+        if (reloaded("app/PostprocessGBuffer.hlsl"))
+            m_postprocessGBufferPass->CreatePipeline();
+        if (reloaded("app/PrepareLights.hlsl"))
+            m_prepareLightsPass->CreatePipeline();
+        if ((reloaded("app/RasterizedGBuffer.hlsl") || reloaded("app/GBufferCulling.hlsl")) && m_renderTargets)
+            m_rasterizedGBufferPass->CreatePipeline(*m_renderTargets);
+
+        if (reloaded("app/RenderEnvironmentMap.hlsl"))
+        {
+            m_renderEnvironmentMapPass = nullptr;
+            m_ui.environmentMapDirty = 1;
+        }
+
+        if (reloaded("app/PreprocessEnvironmentMap.hlsl"))
+        {
+            m_environmentMapPdfMipmapPass = nullptr;
+            m_localLightPdfMipmapPass = nullptr;
+            m_ui.environmentMapDirty = 1;
+        }
+    }
+
     virtual bool LoadScene(std::shared_ptr<vfs::IFileSystem> fs, const std::filesystem::path& sceneFileName) override 
     {
         if (m_scene->Load(sceneFileName))
@@ -344,6 +597,12 @@ public:
         if (m_ui.isLoading)
             return;
 
+        m_lastElapsedTime = fElapsedTimeSeconds;
+
+        // During playback, the camera, the scene animation and the exposure adaptation follow the recording
+        if (m_framePlayer)
+            return;
+
         m_camera.Animate(fElapsedTimeSeconds);
 
         if (m_ui.enableAnimations)
@@ -402,7 +661,7 @@ public:
         }
     }
 
-    void SetupView(uint32_t renderWidth, uint32_t renderHeight, const engine::PerspectiveCamera* activeCamera)
+    void SetupView(uint32_t renderWidth, uint32_t renderHeight, const engine::PerspectiveCamera* activeCamera, const RecordedView* recordedView)
     {
         nvrhi::Viewport windowViewport((float)renderWidth, (float)renderHeight);
 
@@ -416,7 +675,9 @@ public:
         }
 
         const float aspectRatio = windowViewport.width() / windowViewport.height();
-        if (activeCamera)
+        if (recordedView)
+            m_view.SetMatrices(GetRecordedWorldToView(*recordedView), perspProjD3DStyleReverse(recordedView->verticalFov, aspectRatio, recordedView->zNear));
+        else if (activeCamera)
             m_view.SetMatrices(activeCamera->GetWorldToViewMatrix(), perspProjD3DStyleReverse(activeCamera->verticalFov, aspectRatio, activeCamera->zNear));
         else
             m_view.SetMatrices(m_camera.GetWorldToViewMatrix(), perspProjD3DStyleReverse(radians(m_ui.verticalFov), aspectRatio, 0.01f));
@@ -438,17 +699,43 @@ public:
             m_ui.environmentMapDirty = 1;
         }
 
+        // Application shaders whose sources changed since the last reload, with "app/" names
+        std::unordered_set<std::string> reloadedShaders;
+        bool reloadAllShaders = false;
+
         if (m_ui.reloadShaders)
         {
             GetDevice()->waitForIdle();
 
+            // The binaries are read again on the next request, but only the passes whose
+            // sources changed request them
             m_shaderFactory->ClearCache();
-            m_renderEnvironmentMapPass = nullptr;
-            m_environmentMapPdfMipmapPass = nullptr;
-            m_localLightPdfMipmapPass = nullptr;
-            m_ui.environmentMapDirty = 1;
+            m_appShaderFactory->ClearCache();
+
+            reloadAllShaders = !m_shaderWatcher.IsStarted();
+            if (!reloadAllShaders)
+            {
+                const ShaderSourceChanges changes = m_shaderWatcher.Poll();
+                reloadAllShaders = changes.reloadAll;
+
+                for (const std::string& source : changes.affectedSources)
+                    reloadedShaders.insert("app/" + source);
+
+                log::info("Reloading %s: %zu changed files affect %zu shaders", reloadAllShaders ? "all shaders" : "changed shaders",
+                    changes.changedFiles.size(), changes.affectedSources.size());
+            }
+
+            if (reloadAllShaders)
+            {
+                m_renderEnvironmentMapPass = nullptr;
+                m_environmentMapPdfMipmapPass = nullptr;
+                m_localLightPdfMipmapPass = nullptr;
+                m_ui.environmentMapDirty = 1;
 
-            LoadShaders();
+                LoadShaders();
+            }
+            else
+                ReloadShaders(reloadedShaders);
         }
 
         bool renderTargetsCreated = false;
@@ -456,15 +743,15 @@ public:
 
         if (!m_renderEnvironmentMapPass)
         {
-            m_renderEnvironmentMapPass = std::make_unique<RenderEnvironmentMapPass>(GetDevice(), m_shaderFactory, m_descriptorTableManager, 2048);
+            m_renderEnvironmentMapPass = std::make_unique<RenderEnvironmentMapPass>(GetDevice(), m_appShaderFactory, m_descriptorTableManager, 2048);
         }
         
         const auto environmentMap = (m_ui.environmentMapIndex > 0)
             ? m_environmentMap->texture.Get()
             : m_renderEnvironmentMapPass->GetTexture();
 
-        uint32_t numEmissiveMeshes, numEmissiveTriangles;
-        m_prepareLightsPass->CountLightsInScene(numEmissiveMeshes, numEmissiveTriangles);
+        uint32_t numEmissiveMeshes, numEmissiveTriangles, numStoredEmissiveTriangles;
+        m_prepareLightsPass->CountLightsInScene(numEmissiveMeshes, numEmissiveTriangles, numStoredEmissiveTriangles);
         uint32_t numPrimitiveLights = uint32_t(m_scene->GetSceneGraph()->GetLights().size());
         uint32_t numGeometryInstances = uint32_t(m_scene->GetSceneGraph()->GetGeometryInstancesCount());
         
@@ -475,6 +762,7 @@ public:
             environmentMapSize.y != m_rtxdiResources->EnvironmentPdfTexture->getDesc().height ||
             numEmissiveMeshes > m_rtxdiResources->GetMaxEmissiveMeshes() ||
             numEmissiveTriangles > m_rtxdiResources->GetMaxEmissiveTriangles() || 
+            numStoredEmissiveTriangles > m_rtxdiResources->GetMaxStoredEmissiveTriangles() ||
             numPrimitiveLights > m_rtxdiResources->GetMaxPrimitiveLights() ||
             numGeometryInstances > m_rtxdiResources->GetMaxGeometryInstances()))
         {
@@ -497,12 +785,8 @@ public:
 
             m_profiler->SetRenderTargets(m_renderTargets);
 
-            m_postprocessGBufferPass->CreateBindingSet(*m_renderTargets);
-
             m_rasterizedGBufferPass->CreatePipeline(*m_renderTargets);
 
-            m_compositingPass->CreateBindingSet(*m_renderTargets);
-
             renderTargetsCreated = true;
         }
 
@@ -512,19 +796,20 @@ public:
             uint32_t triangleAllocationQuantum = 1024;
             uint32_t primitiveAllocationQuantum = 128;
 
+            log::info("Emissive triangles: %u lights, %u stored once per geometry", numEmissiveTriangles, numStoredEmissiveTriangles);
+
             m_rtxdiResources = std::make_unique<RtxdiResources>(
                 GetDevice(), 
                 m_isContext->GetReSTIRDIContext(),
                 m_isContext->GetRISBufferSegmentAllocator(),
                 (numEmissiveMeshes + meshAllocationQuantum - 1) & ~(meshAllocationQuantum - 1),
                 (numEmissiveTriangles + triangleAllocationQuantum - 1) & ~(triangleAllocationQuantum - 1),
+                (numStoredEmissiveTriangles + triangleAllocationQuantum - 1) & ~(triangleAllocationQuantum - 1),
                 (numPrimitiveLights + primitiveAllocationQuantum - 1) & ~(primitiveAllocationQuantum - 1),
                 numGeometryInstances,
                 environmentMapSize.x,
                 environmentMapSize.y);
 
-            m_prepareLightsPass->CreateBindingSet(*m_rtxdiResources);
-            
             rtxdiResourcesCreated = true;
 
             // Make sure that the environment PDF map is re-generated
@@ -535,7 +820,7 @@ public:
         {
             m_environmentMapPdfMipmapPass = std::make_unique<GenerateMipsPass>(
                 GetDevice(),
-                m_shaderFactory,
+                m_appShaderFactory,
                 environmentMap,
                 m_rtxdiResources->EnvironmentPdfTexture);
         }
@@ -544,26 +829,55 @@ public:
         {
             m_localLightPdfMipmapPass = std::make_unique<GenerateMipsPass>(
                 GetDevice(),
-                m_shaderFactory,
+                m_appShaderFactory,
                 nullptr,
                 m_rtxdiResources->LocalLightPdfTexture);
         }
 
         if (renderTargetsCreated || rtxdiResourcesCreated)
         {
+            // The binding set factory reuses the sets whose resources didn't move
+            m_postprocessGBufferPass->CreateBindingSet(*m_renderTargets);
+            m_compositingPass->CreateBindingSet(*m_renderTargets);
+            m_prepareLightsPass->CreateBindingSet(*m_rtxdiResources);
             m_lightingPasses->CreateBindingSet(
                 m_scene->GetTopLevelAS(),
                 m_scene->GetPrevTopLevelAS(),
                 *m_renderTargets,
                 *m_rtxdiResources);
+            m_bindingSetFactory->ReleaseUnused();
+
+            // Totals since startup
+            const BindingSetCacheStats& stats = m_bindingSetFactory->GetStats();
+            log::info("Binding sets: %llu of %llu requests reused (%.0f%%), %llu of %llu bindings changed in the created sets, %zu live",
+                (unsigned long long)stats.hits, (unsigned long long)stats.requests, stats.GetHitRate() * 100.0,
+                (unsigned long long)stats.changedItems, (unsigned long long)stats.createdItems, stats.liveSets);
         }
 
         if (rtxdiResourcesCreated || m_ui.reloadShaders)
         {
-            // Some RTXDI context settings affect the shader permutations
-            m_lightingPasses->CreatePipelines(m_ui.useRayQuery);
+            // Some RTXDI context settings affect the shader permutations.
+            // A reload with an unchanged pipeline type only replaces the passes of the changed shaders.
+            if (rtxdiResourcesCreated || reloadAllShaders)
+                m_lightingPasses->CreatePipelines(m_ui.useRayQuery, m_ui.asyncPipelineCreation);
+            else
+                m_lightingPasses->ReloadPipelines(reloadedShaders, m_ui.useRayQuery, m_ui.asyncPipelineCreation);
+
+            // The shaders are loaded on this thread even when the pipelines are created in the background
+            if (m_shaderCache && m_shaderCache->IsDirty())
+            {
+                const ShaderPermutationCacheStats& stats = m_shaderCache->GetStats();
+                log::debug("Shader cache: %u hits, %u misses, %u corrupt entries", stats.hits, stats.misses, stats.corruptEntries);
+
+                if (!m_shaderCache->Write())
+                    log::warning("Cannot write the shader cache: %s", m_shaderCache->GetError().c_str());
+            }
         }
 
+        // Pipelines created in the background replace the old ones between frames, all at once
+        m_lightingPasses->CommitPipelines();
+        m_ui.creatingPipelines = m_lightingPasses->IsCreatingPipelines();
+
         m_ui.reloadShaders = false;
 
         exposureResetRequired = false;
@@ -645,6 +959,151 @@ public:
         restirGIContext.SetFinalShadingParameters(m_ui.restirGI.finalShadingParams);
     }
 
+    void StoreSweepBaseline()
+    {
+        m_sweepBaseline.restirDI = m_ui.restirDI;
+        m_sweepBaseline.restirDIStaticParams = m_ui.restirDIStaticParams;
+        m_sweepBaseline.lightingSettings = m_ui.lightingSettings;
+        m_sweepBaseline.preset = m_ui.preset;
+        m_sweepBaseline.resolutionScale = m_ui.resolutionScale;
+        m_sweepBaseline.enableFpsLimit = m_ui.enableFpsLimit;
+        m_sweepBaseline.enableAnimations = m_ui.enableAnimations;
+    }
+
+    void RestoreSweepBaseline()
+    {
+        if (m_ui.restirDIStaticParams.CheckerboardSamplingMode != m_sweepBaseline.restirDIStaticParams.CheckerboardSamplingMode)
+            m_ui.resetISContext = true;
+
+        m_ui.restirDI = m_sweepBaseline.restirDI;
+        m_ui.restirDIStaticParams = m_sweepBaseline.restirDIStaticParams;
+        m_ui.lightingSettings = m_sweepBaseline.lightingSettings;
+        m_ui.preset = m_sweepBaseline.preset;
+        m_ui.resolutionScale = m_sweepBaseline.resolutionScale;
+        m_ui.enableFpsLimit = m_sweepBaseline.enableFpsLimit;
+        m_ui.enableAnimations = m_sweepBaseline.enableAnimations;
+    }
+
+    void StartParameterSweep()
+    {
+        SweepGrid grid;
+        std::string errorMessage;
+        if (!grid.Parse(m_ui.parameterSweep.grid, errorMessage))
+        {
+            m_ui.parameterSweep.errorMessage = errorMessage;
+            return;
+        }
+
+        // Validate the parameter names by applying them once, then go back to the current settings
+        StoreSweepBaseline();
+        const bool resetISContext = m_ui.resetISContext;
+        for (const SweepAxis& axis : grid.GetAxes())
+        {
+            if (!m_ui.ApplySweepParameter(axis.name, axis.values[0]))
+            {
+                errorMessage = "Unknown parameter '" + axis.name + "'";
+                break;
+            }
+        }
+        RestoreSweepBaseline();
+        m_ui.resetISContext = resetISContext;
+
+        if (!errorMessage.empty())
+        {
+            m_ui.parameterSweep.errorMessage = errorMessage;
+            return;
+        }
+
+        grid.SetAxisStatic("checkerboard", true);
+
+        m_parameterSweep.Start(grid, m_ui.parameterSweep.settings);
+        m_profiler->EnableProfiler(true);
+        m_ui.animationFrame.reset();
+        m_ui.parameterSweep.running = true;
+        m_ui.parameterSweep.completedPoints = 0;
+        m_ui.parameterSweep.totalPoints = m_parameterSweep.GetTotalPointCount();
+        m_ui.parameterSweep.errorMessage.clear();
+
+        log::info("Starting a parameter sweep over %d configurations", m_parameterSweep.GetTotalPointCount());
+    }
+
+    void ApplyParameterSweepPoint(int pointIndex)
+    {
+        RestoreSweepBaseline();
+
+        if (pointIndex == SweepFramePlan::ReferencePoint)
+        {
+            m_ui.preset = QualityPreset::Reference;
+            m_ui.ApplyPreset();
+        }
+        else if (const SweepPoint* point = m_parameterSweep.GetPoint(pointIndex))
+        {
+            const std::vector<SweepAxis>& axes = m_parameterSweep.GetGrid().GetAxes();
+            for (size_t axisIndex = 0; axisIndex < axes.size(); axisIndex++)
+                m_ui.ApplySweepParameter(axes[axisIndex].name, point->values[axisIndex]);
+        }
+
+        // Timings must not include the FPS limiter, and the scene must not move except along the path
+        m_ui.enableFpsLimit = false;
+        m_ui.enableAnimations = false;
+        m_ui.resetAccumulation = true;
+    }
+
+    void FinishParameterSweep()
+    {
+        RestoreSweepBaseline();
+        m_ui.parameterSweep.running = false;
+
+        const SweepGrid& grid = m_parameterSweep.GetGrid();
+        const SweepResultStore& results = m_parameterSweep.GetResults();
+        if (results.GetResults().empty())
+            return;
+
+        std::vector<std::string> sectionNames;
+        for (uint32_t section = 0; section < ProfilerSection::MaterialReadback; section++)
+            sectionNames.push_back(Profiler::GetSectionName(ProfilerSection::Enum(section)));
+
+        const char* csvFileName = "ParameterSweep.csv";
+        std::ofstream csvFile(csvFileName);
+        if (csvFile.is_open())
+        {
+            results.WriteCsv(csvFile, grid, sectionNames);
+            log::info("Parameter sweep results written to %s", csvFileName);
+        }
+        else
+            log::warning("Cannot write the parameter sweep results to %s", csvFileName);
+
+        std::stringstream report;
+        if (m_ui.parameterSweep.settings.captureReference)
+            report << "Reference: " << std::fixed << std::setprecision(3) << m_parameterSweep.GetReferenceResult().frameTimeMs << " ms" << std::endl;
+        report << results.GetReport(grid);
+
+        m_ui.benchmarkResults = report.str();
+    }
+
+    void ReadBackParameterSweepImage()
+    {
+        const size_t width = m_renderTargets->Size.x;
+        const size_t height = m_renderTargets->Size.y;
+
+        size_t rowPitch = 0;
+        const uint8_t* data = static_cast<const uint8_t*>(GetDevice()->mapStagingTexture(m_sweepReadbackTexture,
+            nvrhi::TextureSlice(), nvrhi::CpuAccessMode::Read, &rowPitch));
+
+        if (!data)
+            return;
+
+        std::vector<float> image(width * height * 4);
+        for (size_t row = 0; row < height; row++)
+        {
+            ConvertHalfToFloat(reinterpret_cast<const uint16_t*>(data + row * rowPitch), image.data() + row * width * 4, width * 4);
+        }
+
+        GetDevice()->unmapStagingTexture(m_sweepReadbackTexture);
+
+        m_parameterSweep.SubmitImage(m_sweepFramePlan.pointIndex, image);
+    }
+
     bool IsLocalLightPowerRISEnabled()
     {
         if (m_ui.indirectLightingMode == IndirectLightingMode::ReStirGI)
@@ -658,6 +1117,146 @@ public:
         return m_isContext->IsLocalLightPowerRISEnabled();
     }
 
+    enum class FrameTask : uint32_t
+    {
+        SceneUpdate,
+        GBufferFill,
+        PrepareLights,
+        LocalLightPdfMips,
+        LightSampling,
+        Lighting    // and the rest of the frame
+    };
+
+    // The tasks of the frame in recording order, with the resources they access
+    static std::vector<AsyncComputeTask> MakeFrameTasks()
+    {
+        enum FrameResource : RenderGraphResource
+        {
+            SceneBuffers,       // and the TLAS
+            EnvironmentPdf,
+            GBuffer,
+            LightData,          // light buffer, index mapping and geometry to light mapping
+            LocalLightPdf,
+            RisBuffers,
+            LightingOutputs
+        };
+
+        // The light sampling passes bind the lighting binding set, which references the G-buffer, so they
+        // can't run on the compute queue while the G-buffer is rendered
+        return {
+            { "SceneUpdate", { { SceneBuffers, RenderGraphAccess::UnorderedWrite }, { EnvironmentPdf, RenderGraphAccess::UnorderedWrite } }, false },
+            { "GBufferFill", { { SceneBuffers, RenderGraphAccess::ShaderRead }, { GBuffer, RenderGraphAccess::UnorderedWrite } }, false },
+            { "PrepareLights", { { SceneBuffers, RenderGraphAccess::ShaderRead }, { LightData, RenderGraphAccess::UnorderedWrite }, { LocalLightPdf, RenderGraphAccess::UnorderedWrite } }, true },
+            { "LocalLightPdfMips", { { LocalLightPdf, RenderGraphAccess::UnorderedReadWrite } }, true },
+            { "LightSampling", { { GBuffer, RenderGraphAccess::ShaderRead }, { EnvironmentPdf, RenderGraphAccess::ShaderRead }, { LightData, RenderGraphAccess::ShaderRead },
+                { LocalLightPdf, RenderGraphAccess::ShaderRead }, { RisBuffers, RenderGraphAccess::UnorderedWrite } }, true },
+            { "Lighting", { { GBuffer, RenderGraphAccess::ShaderRead }, { LightData, RenderGraphAccess::ShaderRead }, { RisBuffers, RenderGraphAccess::UnorderedRead },
+                { LightingOutputs, RenderGraphAccess::UnorderedWrite } }, false }
+        };
+    }
+
+    // Groups of frame tasks that are recorded concurrently after the groups they depend on. The G-buffer
+    // and the light preparation only need the scene update, the tasks from the light sampling on are
+    // recorded after the groups because they need the light buffer parameters.
+    static std::vector<RecordingGroup> MakeFrameRecordingGroups()
+    {
+        return {
+            { "SceneUpdate", {} },
+            { "GBufferFill", { 0 } },
+            { "LightPreparation", { 0 } }
+        };
+    }
+
+    // The recording group of every FrameTask, the light sampling and lighting tasks follow the groups
+    static std::vector<uint32_t> GetFrameTaskRecordingGroups()
+    {
+        return { 0, 1, 2, 2, 3, 3 };
+    }
+
+    // Schedules the frame tasks on the queues and sets up their command lists: one per batch, or one per
+    // recording group and batch with parallel recording. The lighting task records into m_commandList.
+    void UpdateFrameSchedule(bool enableComputeQueue, bool parallelRecording)
+    {
+        if (m_frameCommandLists.IsConfigured() && enableComputeQueue == m_frameScheduleUsesComputeQueue &&
+            parallelRecording == m_frameRecordingIsParallel)
+            return;
+
+        const AsyncComputeSchedule schedule = ScheduleAsyncCompute(MakeFrameTasks(), enableComputeQueue);
+        m_frameScheduleUsesComputeQueue = enableComputeQueue;
+        m_frameRecordingIsParallel = parallelRecording;
+
+        nvrhi::IDevice* device = GetDevice();
+        m_frameCommandLists.Configure(schedule, parallelRecording ? GetFrameTaskRecordingGroups() : std::vector<uint32_t>(), m_commandList,
+            [device](QueueType queueType)
+            {
+                const nvrhi::CommandQueue queue = queueType == QueueType::Compute ? nvrhi::CommandQueue::Compute : nvrhi::CommandQueue::Graphics;
+                return device->createCommandList(nvrhi::CommandListParameters().setQueueType(queue));
+            });
+
+        m_frameRecordingPlan = PlanRecording(MakeFrameRecordingGroups());
+        assert(m_frameRecordingPlan.errors.empty());
+
+        log::info("Frame schedule: %d batches, %d waits%s", int(schedule.batches.size()), int(schedule.GetWaitCount()),
+            parallelRecording ? ", parallel recording" : "");
+    }
+
+    nvrhi::ICommandList* GetFrameTaskCommandList(FrameTask task) const
+    {
+        return m_frameCommandLists.GetCommandList(uint32_t(task));
+    }
+
+    // Records the groups of a wave. With parallel recording, the first group records on this thread and
+    // the others on the executor: the G-buffer group waits for its own draw recording tasks, which must
+    // not block a worker of the executor.
+    void RecordFrameWave(const std::vector<uint32_t>& wave, const std::function<void()>* recordGroups)
+    {
+#ifdef DONUT_WITH_TASKFLOW
+        if (m_frameRecordingIsParallel && m_executor && wave.size() > 1)
+        {
+            tf::Taskflow taskflow;
+            for (size_t index = 1; index < wave.size(); index++)
+                taskflow.emplace(recordGroups[wave[index]]);
+
+            auto otherGroups = m_executor->run(taskflow);
+            recordGroups[wave[0]]();
+            otherGroups.wait();
+            return;
+        }
+#endif
+
+        for (uint32_t group : wave)
+            recordGroups[group]();
+    }
+
+    // Closes the command lists of the frame and submits them in the order of the schedule,
+    // each batch after the waits for the batches of the other queue it depends on
+    void ExecuteFrameCommandLists()
+    {
+        const AsyncComputeSchedule& schedule = m_frameCommandLists.GetSchedule();
+        const std::vector<std::vector<nvrhi::CommandListHandle>> batchCommandLists = m_frameCommandLists.End();
+
+        std::vector<uint64_t> submissions(schedule.batches.size());
+        for (size_t batchIndex = 0; batchIndex < schedule.batches.size(); batchIndex++)
+        {
+            const AsyncComputeBatch& batch = schedule.batches[batchIndex];
+            const nvrhi::CommandQueue queue = batch.queue == QueueType::Compute ? nvrhi::CommandQueue::Compute : nvrhi::CommandQueue::Graphics;
+
+            for (uint32_t wait : batch.waits)
+            {
+                const nvrhi::CommandQueue waitedQueue = schedule.batches[wait].queue == QueueType::Compute
+                    ? nvrhi::CommandQueue::Compute
+                    : nvrhi::CommandQueue::Graphics;
+                GetDevice()->queueWaitForCommandList(queue, waitedQueue, submissions[wait]);
+            }
+
+            std::vector<nvrhi::ICommandList*> commandLists;
+            for (const nvrhi::CommandListHandle& commandList : batchCommandLists[batchIndex])
+                commandLists.push_back(commandList);
+
+            submissions[batchIndex] = GetDevice()->executeCommandLists(commandLists.data(), commandLists.size(), queue);
+        }
+    }
+
     void RenderScene(nvrhi::IFramebuffer* framebuffer) override
     {
         if (m_frameStepMode == FrameStepMode::Wait)
@@ -682,10 +1281,45 @@ public:
         if (m_frameStepMode == FrameStepMode::Step)
             m_frameStepMode = FrameStepMode::Wait;
 
+        AllocationTracker::BeginFrame();
+
         const engine::PerspectiveCamera* activeCamera = nullptr;
         uint effectiveFrameIndex = m_renderFrameIndex;
 
-        if (m_ui.animationFrame.has_value())
+        if (m_ui.parameterSweep.start)
+        {
+            m_ui.parameterSweep.start = false;
+            StartParameterSweep();
+        }
+
+        if (m_ui.parameterSweep.stop)
+        {
+            m_ui.parameterSweep.stop = false;
+            m_parameterSweep.Stop();
+            FinishParameterSweep();
+        }
+
+        const bool sweepActive = m_parameterSweep.IsRunning();
+
+        if (sweepActive)
+        {
+            m_sweepFramePlan = m_parameterSweep.GetFramePlan();
+
+            if (m_sweepFramePlan.applySettings)
+                ApplyParameterSweepPoint(m_sweepFramePlan.pointIndex);
+
+            // Follow the benchmark camera path when the scene has one, otherwise keep the current view
+            auto* animation = m_scene->GetBenchmarkAnimation();
+            if (animation)
+            {
+                const float animationTime = std::min(float(m_sweepFramePlan.pathFrame) * (1.f / 240.f), animation->GetDuration());
+                (void)animation->Apply(animationTime);
+                activeCamera = m_scene->GetBenchmarkCamera();
+            }
+
+            effectiveFrameIndex = m_sweepFramePlan.frameIndex;
+        }
+        else if (m_ui.animationFrame.has_value())
         {
             const float animationTime = float(m_ui.animationFrame.value()) * (1.f / 240.f);
             
@@ -704,6 +1338,14 @@ public:
             }
         }
 
+        UpdateFrameRecordingState();
+
+        if (m_framePlayer && ReplayNextFrame())
+        {
+            activeCamera = nullptr;
+            effectiveFrameIndex = m_playbackFrame->frameIndex;
+        }
+
         bool exposureResetRequired = false;
 
         if (m_ui.enableFpsLimit && GetFrameIndex() > 0)
@@ -741,12 +1383,19 @@ public:
         }
 
         m_scene->RefreshSceneGraph(GetFrameIndex());
+        m_scene->UpdateInstanceBvh();
 
         const auto& fbinfo = framebuffer->getFramebufferInfo();
         uint32_t renderWidth = fbinfo.width;
         uint32_t renderHeight = fbinfo.height;
-        SetupView(renderWidth, renderHeight, activeCamera);
+        SetupView(renderWidth, renderHeight, activeCamera, m_playbackFrame ? &m_playbackFrame->view : nullptr);
         SetupRenderPasses(renderWidth, renderHeight, exposureResetRequired);
+
+        if (m_playbackFrame && m_toneMappingPass)
+            m_toneMappingPass->AdvanceFrame(m_playbackFrame->elapsedTime);
+
+        if (m_frameRecorder)
+            RecordFrame(effectiveFrameIndex, activeCamera);
         if (!m_ui.freezeRegirPosition)
             m_regirCenter = m_camera.GetPosition();
         UpdateReSTIRDIContextFromUI();
@@ -760,11 +1409,25 @@ public:
         
         bool cameraIsStatic = m_previousViewValid && m_view.GetViewMatrix() == m_viewPrevious.GetViewMatrix();
         m_ui.numAccumulatedFrames = 1;
-        m_profiler->EnableAccumulation(m_ui.animationFrame.has_value());
+        m_profiler->EnableAccumulation(sweepActive ? m_sweepFramePlan.accumulateTimings : m_ui.animationFrame.has_value());
 
         float accumulationWeight = 1.f / (float)m_ui.numAccumulatedFrames;
 
+        if (sweepActive && m_sweepFramePlan.resetTimings)
+            m_profiler->ResetAccumulation();
+
         m_profiler->ResolvePreviousFrame();
+
+        UpdateFrameTimeBudget(sweepActive);
+
+        if (sweepActive && m_sweepFramePlan.collectTimings)
+        {
+            std::vector<double> sectionTimes;
+            for (uint32_t section = 0; section < ProfilerSection::MaterialReadback; section++)
+                sectionTimes.push_back(m_profiler->GetTimer(ProfilerSection::Enum(section)));
+
+            m_parameterSweep.SubmitTimings(m_sweepFramePlan.pointIndex, m_profiler->GetTimer(ProfilerSection::Frame), sectionTimes);
+        }
         
         int materialIndex = m_profiler->GetMaterialReadback();
         if (materialIndex >= 0)
@@ -805,79 +1468,130 @@ public:
         
         uint32_t denoiserMode = DENOISER_MODE_OFF;
 
-        m_commandList->open();
+        UpdateFrameSchedule(m_ui.asyncComputeLightPreparation && GetDevice()->queryFeatureSupport(nvrhi::Feature::ComputeQueue),
+            m_ui.parallelCommandRecording);
 
-        m_profiler->BeginFrame(m_commandList);
+        m_frameCommandLists.Begin();
 
-        AssignIesProfiles(m_commandList);
-        m_scene->RefreshBuffers(m_commandList, GetFrameIndex());
-        m_rtxdiResources->InitializeNeighborOffsets(m_commandList, m_isContext->GetNeighborOffsetCount());
+        // PrepareForLightSampling writes the constants of the lighting passes
+        assert(GetFrameTaskCommandList(FrameTask::LightSampling) == m_commandList.Get());
+
+        // The light indexing members of frameParameters are written by PrepareLightsPass below
+        rtxdi::ReSTIRDIContext& restirDIContext = m_isContext->GetReSTIRDIContext();
+        restirDIContext.SetFrameIndex(effectiveFrameIndex);
+        m_isContext->GetReSTIRGIContext().SetFrameIndex(effectiveFrameIndex);
 
-        if (m_framesSinceAnimation < 2)
+        // Without the compute queue and parallel recording, all groups record into m_commandList
+        auto recordSceneUpdate = [&]()
         {
-            ProfilerScope scope(*m_profiler, m_commandList, ProfilerSection::TlasUpdate);
+            nvrhi::ICommandList* sceneCommandList = GetFrameTaskCommandList(FrameTask::SceneUpdate);
 
-            m_scene->UpdateSkinnedMeshBLASes(m_commandList, GetFrameIndex());
-            m_scene->BuildTopLevelAccelStruct(m_commandList);
-        }
-        m_commandList->compactBottomLevelAccelStructs();
+            m_profiler->BeginFrame(sceneCommandList);
 
-        if (m_ui.environmentMapDirty)
-        {
-            ProfilerScope scope(*m_profiler, m_commandList, ProfilerSection::EnvironmentMap);
+            AssignIesProfiles(sceneCommandList);
+            m_scene->RefreshBuffers(sceneCommandList, GetFrameIndex());
+            m_rtxdiResources->InitializeNeighborOffsets(sceneCommandList, m_isContext->GetNeighborOffsetCount());
 
-            if (m_ui.environmentMapIndex == 0)
+            // Compaction copies the BLAS'es that finished building to new memory, and the old memory is released
+            // with this frame. The current TLAS is rebuilt below and the previous one next frame, so neither
+            // TLAS points to the old memory after this frame.
+            sceneCommandList->compactBottomLevelAccelStructs();
+            if (m_scene->UpdateCompactedBLASes())
+                m_pendingTlasRebuilds = 2;
+
+            if (m_framesSinceAnimation < 2 || m_pendingTlasRebuilds > 0 || m_scene->GetPendingBLASBatchCount() > 0)
             {
-                donut::render::SkyParameters params;
-                m_renderEnvironmentMapPass->Render(m_commandList, *m_sunLight, params);
+                ProfilerScope scope(*m_profiler, sceneCommandList, ProfilerSection::TlasUpdate);
+
+                // Meshes whose BLAS is built in this frame go into both the current and the previous TLAS
+                if (m_scene->BuildPendingBLASes(sceneCommandList))
+                    m_pendingTlasRebuilds = 2;
+
+                m_scene->UpdateSkinnedMeshBLASes(sceneCommandList, GetFrameIndex(), m_ui.skinnedBlasRefit);
+                m_scene->BuildTopLevelAccelStruct(sceneCommandList);
+
+                if (m_pendingTlasRebuilds > 0)
+                    m_pendingTlasRebuilds--;
             }
-            
-            m_environmentMapPdfMipmapPass->Process(m_commandList);
 
-            m_ui.environmentMapDirty = 0;
-        }
+            if (m_ui.environmentMapDirty)
+            {
+                ProfilerScope scope(*m_profiler, sceneCommandList, ProfilerSection::EnvironmentMap);
+
+                if (m_ui.environmentMapIndex == 0)
+                {
+                    donut::render::SkyParameters params;
+                    m_renderEnvironmentMapPass->Render(sceneCommandList, *m_sunLight, params);
+                }
+            
+                m_environmentMapPdfMipmapPass->Process(sceneCommandList);
 
-        nvrhi::utils::ClearColorAttachment(m_commandList, framebuffer, 0, nvrhi::Color(0.f));
+                m_ui.environmentMapDirty = 0;
+            }
+        };
 
+        auto recordGBuffer = [&]()
         {
-            ProfilerScope scope(*m_profiler, m_commandList, ProfilerSection::GBufferFill);
+            nvrhi::ICommandList* gbufferCommandList = GetFrameTaskCommandList(FrameTask::GBufferFill);
+
+            nvrhi::utils::ClearColorAttachment(gbufferCommandList, framebuffer, 0, nvrhi::Color(0.f));
+
+            // The section ends in the command list that follows the draw command lists
+            m_profiler->BeginSection(gbufferCommandList, ProfilerSection::GBufferFill);
 
             GBufferSettings gbufferSettings = m_ui.gbufferSettings;
             float upscalingLodBias = ::log2f(m_view.GetViewport().width() / m_upscaledView.GetViewport().width());
             gbufferSettings.textureLodBias += upscalingLodBias;
 
-            m_rasterizedGBufferPass->Render(m_commandList, m_view, m_viewPrevious, *m_renderTargets, m_ui.gbufferSettings);
+            m_rasterizedGBufferPass->Render(gbufferCommandList, m_view, m_viewPrevious, *m_renderTargets, m_ui.gbufferSettings,
+                m_frameRecordingIsParallel);
 
-            m_postprocessGBufferPass->Render(m_commandList, m_view);
-        }
+            const std::vector<nvrhi::CommandListHandle>& drawCommandLists = m_rasterizedGBufferPass->GetDrawCommandLists();
+            if (!drawCommandLists.empty())
+                gbufferCommandList = m_frameCommandLists.Insert(uint32_t(FrameTask::GBufferFill), drawCommandLists);
 
-        // The light indexing members of frameParameters are written by PrepareLightsPass below
-        rtxdi::ReSTIRDIContext& restirDIContext = m_isContext->GetReSTIRDIContext();
-        restirDIContext.SetFrameIndex(effectiveFrameIndex);
-        m_isContext->GetReSTIRGIContext().SetFrameIndex(effectiveFrameIndex);
+            m_ui.gbufferDrawOrder.submitted = m_rasterizedGBufferPass->GetDrawStatistics();
+            m_ui.gbufferDrawOrder.sceneOrder = m_rasterizedGBufferPass->GetSceneOrderDrawStatistics();
+            m_ui.gbufferDrawOrder.resortedDraws = m_rasterizedGBufferPass->GetResortedDrawCount();
 
-        {
-            ProfilerScope scope(*m_profiler, m_commandList, ProfilerSection::MeshProcessing);
-            
-            RTXDI_LightBufferParameters lightBufferParams = m_prepareLightsPass->Process(
-                m_commandList,
-                restirDIContext,
-                m_scene->GetSceneGraph()->GetLights(),
-                m_environmentMapPdfMipmapPass != nullptr && m_ui.environmentMapImportanceSampling);
-            m_isContext->SetLightBufferParams(lightBufferParams);
+            m_postprocessGBufferPass->Render(gbufferCommandList, m_view);
 
-            auto initialSamplingParams = restirDIContext.GetInitialSamplingParameters();
-            initialSamplingParams.environmentMapImportanceSampling = lightBufferParams.environmentLightParams.lightPresent;
-            m_ui.restirDI.initialSamplingParams.environmentMapImportanceSampling = initialSamplingParams.environmentMapImportanceSampling;
-            restirDIContext.SetInitialSamplingParameters(initialSamplingParams);
-        }
+            m_profiler->EndSection(gbufferCommandList, ProfilerSection::GBufferFill);
+        };
 
-        if (IsLocalLightPowerRISEnabled())
+        auto recordLightPreparation = [&]()
         {
-            ProfilerScope scope(*m_profiler, m_commandList, ProfilerSection::LocalLightPdfMap);
+            nvrhi::ICommandList* prepareLightsCommandList = GetFrameTaskCommandList(FrameTask::PrepareLights);
+
+            {
+                ProfilerScope scope(*m_profiler, prepareLightsCommandList, ProfilerSection::MeshProcessing);
             
-            m_localLightPdfMipmapPass->Process(m_commandList);
-        }
+                RTXDI_LightBufferParameters lightBufferParams = m_prepareLightsPass->Process(
+                    prepareLightsCommandList,
+                    restirDIContext,
+                    m_scene->GetSceneGraph()->GetLights(),
+                    m_environmentMapPdfMipmapPass != nullptr && m_ui.environmentMapImportanceSampling);
+                m_isContext->SetLightBufferParams(lightBufferParams);
+
+                auto initialSamplingParams = restirDIContext.GetInitialSamplingParameters();
+                initialSamplingParams.environmentMapImportanceSampling = lightBufferParams.environmentLightParams.lightPresent;
+                m_ui.restirDI.initialSamplingParams.environmentMapImportanceSampling = initialSamplingParams.environmentMapImportanceSampling;
+                restirDIContext.SetInitialSamplingParameters(initialSamplingParams);
+            }
+
+            if (IsLocalLightPowerRISEnabled())
+            {
+                nvrhi::ICommandList* lightPdfCommandList = GetFrameTaskCommandList(FrameTask::LocalLightPdfMips);
+                ProfilerScope scope(*m_profiler, lightPdfCommandList, ProfilerSection::LocalLightPdfMap);
+            
+                m_localLightPdfMipmapPass->Process(lightPdfCommandList);
+            }
+        };
+
+        // By group of MakeFrameRecordingGroups
+        const std::function<void()> recordGroups[] = { recordSceneUpdate, recordGBuffer, recordLightPreparation };
+        for (const std::vector<uint32_t>& wave : m_frameRecordingPlan.waves)
+            RecordFrameWave(wave, recordGroups);
         
         LightingPasses::RenderSettings lightingSettings = m_ui.lightingSettings;
         lightingSettings.enablePreviousTLAS &= m_ui.enableAnimations;
@@ -944,6 +1658,23 @@ public:
 
         Resolve(m_commandList, accumulationWeight);
 
+        if (sweepActive && m_sweepFramePlan.captureImage)
+        {
+            const nvrhi::TextureDesc& resolvedDesc = m_renderTargets->ResolvedColor->getDesc();
+            if (!m_sweepReadbackTexture || m_sweepReadbackTexture->getDesc().width != resolvedDesc.width || m_sweepReadbackTexture->getDesc().height != resolvedDesc.height)
+            {
+                nvrhi::TextureDesc readbackDesc = resolvedDesc;
+                readbackDesc.isRenderTarget = false;
+                readbackDesc.isUAV = false;
+                readbackDesc.initialState = nvrhi::ResourceStates::CopyDest;
+                readbackDesc.keepInitialState = true;
+                readbackDesc.debugName = "ParameterSweepReadback";
+                m_sweepReadbackTexture = GetDevice()->createStagingTexture(readbackDesc, nvrhi::CpuAccessMode::Read);
+            }
+
+            m_commandList->copyTexture(m_sweepReadbackTexture, nvrhi::TextureSlice(), m_renderTargets->ResolvedColor, nvrhi::TextureSlice());
+        }
+
         // Reference image functionality:
         {
             // When the camera is moved, discard the previously stored image, if any, and disable its display.
@@ -1044,8 +1775,19 @@ public:
         
         m_profiler->EndFrame(m_commandList);
 
-        m_commandList->close();
-        GetDevice()->executeCommandList(m_commandList);
+        ExecuteFrameCommandLists();
+
+        if (sweepActive)
+        {
+            if (m_sweepFramePlan.captureImage)
+                ReadBackParameterSweepImage();
+
+            m_parameterSweep.AdvanceFrame();
+            m_ui.parameterSweep.completedPoints = m_parameterSweep.GetCompletedPointCount();
+
+            if (!m_parameterSweep.IsRunning())
+                FinishParameterSweep();
+        }
         
         m_ui.gbufferSettings.enableMaterialReadback = false;
         
@@ -1057,16 +1799,338 @@ public:
         m_viewPrevious = m_view;
         m_previousViewValid = true;
         m_ui.resetAccumulation = false;
+        m_playbackFrame.reset();
         ++m_renderFrameIndex;
+
+        AllocationTracker::EndFrame();
+
+        if (m_allocationBudgetTest)
+            CheckAllocationBudget();
+    }
+
+    void StartFrameRecording()
+    {
+        m_ui.frameRecording.errorMessage.clear();
+
+        m_recordingFile.open(m_ui.frameRecording.fileName, std::ios::binary | std::ios::trunc);
+        if (!m_recordingFile.is_open())
+        {
+            m_ui.frameRecording.errorMessage = std::string("Cannot create ") + m_ui.frameRecording.fileName;
+            return;
+        }
+
+        std::vector<uint8_t> settings;
+        m_ui.SaveRecordedSettings(settings);
+
+        m_frameRecorder = std::make_unique<FrameRecordWriter>(m_recordingFile);
+        if (!m_frameRecorder->Begin(uint32_t(settings.size()), m_ui.GetRecordedSettingsLayout()))
+        {
+            StopFrameRecording("Failed to write the recording header");
+            return;
+        }
+
+        log::info("Recording frames to %s", m_ui.frameRecording.fileName);
+    }
+
+    void RecordFrame(uint32_t frameIndex, const engine::PerspectiveCamera* activeCamera)
+    {
+        RecordedFrame frame;
+        frame.frameIndex = frameIndex;
+        frame.elapsedTime = m_lastElapsedTime;
+        frame.animationTime = m_scene->GetAnimationTime();
+        frame.environmentMapIndex = m_ui.environmentMapIndex;
+        frame.view = activeCamera
+            ? MakeRecordedView(m_view.GetViewMatrix(), activeCamera->verticalFov, activeCamera->zNear)
+            : MakeRecordedView(m_view.GetViewMatrix(), radians(m_ui.verticalFov), 0.01f);
+        m_ui.SaveRecordedSettings(frame.settings);
+
+        if (!m_frameRecorder->WriteFrame(frame))
+        {
+            StopFrameRecording("Failed to write the recording");
+            return;
+        }
+
+        m_ui.frameRecording.frames = m_frameRecorder->GetFrameCount();
+    }
+
+    void StopFrameRecording(const char* errorMessage = nullptr)
+    {
+        if (m_frameRecorder)
+            log::info("Recorded %d frames to %s", m_frameRecorder->GetFrameCount(), m_ui.frameRecording.fileName);
+
+        m_frameRecorder = nullptr;
+        m_recordingFile.close();
+
+        if (errorMessage)
+            m_ui.frameRecording.errorMessage = errorMessage;
+    }
+
+    void StartFramePlayback()
+    {
+        m_ui.frameRecording.errorMessage.clear();
+
+        m_playbackFile.open(m_ui.frameRecording.fileName, std::ios::binary);
+        if (!m_playbackFile.is_open())
+        {
+            StopFramePlayback((std::string("Cannot open ") + m_ui.frameRecording.fileName).c_str());
+            return;
+        }
+
+        m_framePlayer = std::make_unique<FrameRecordReader>(m_playbackFile);
+        if (!m_framePlayer->Begin())
+        {
+            StopFramePlayback(m_framePlayer->GetError().c_str());
+            return;
+        }
+
+        std::vector<uint8_t> settings;
+        m_ui.SaveRecordedSettings(settings);
+        if (settings.size() != m_framePlayer->GetSettingsSize() || m_ui.GetRecordedSettingsLayout() != m_framePlayer->GetSettingsLayout())
+        {
+            StopFramePlayback("The recording was made with a different build of the sample");
+            return;
+        }
+
+        // Benchmark and sweep camera paths would fight with the recorded view
+        m_ui.animationFrame.reset();
+        m_ui.resetAccumulation = true;
+
+        log::info("Replaying frames from %s", m_ui.frameRecording.fileName);
+    }
+
+    bool ReplayNextFrame()
+    {
+        RecordedFrame frame;
+        if (!m_framePlayer->ReadFrame(frame))
+        {
+            const std::string error = m_framePlayer->GetError();
+            StopFramePlayback(error.empty() ? nullptr : error.c_str());
+            return false;
+        }
+
+        if (!m_ui.LoadRecordedSettings(frame.settings))
+        {
+            StopFramePlayback("The recording was made with a different build of the sample");
+            return false;
+        }
+
+        if (frame.environmentMapIndex != m_ui.environmentMapIndex)
+        {
+            if (frame.environmentMapIndex < 0 || frame.environmentMapIndex >= int(m_scene->GetEnvironmentMaps().size()))
+            {
+                log::warning("Recorded environment map %d is not available, using the procedural sky.", frame.environmentMapIndex);
+                frame.environmentMapIndex = 0;
+            }
+
+            m_ui.environmentMapIndex = frame.environmentMapIndex;
+            m_ui.environmentMapDirty = 2;
+        }
+
+        m_scene->SetAnimationTime(frame.animationTime);
+
+        // Keep the interactive camera in sync, so that it continues from the last replayed view
+        const affine3 viewToWorld = inverse(GetRecordedWorldToView(frame.view));
+        m_camera.LookAt(viewToWorld.m_translation, viewToWorld.m_translation + viewToWorld.m_linear.row2, viewToWorld.m_linear.row1);
+
+        m_playbackFrame = std::move(frame);
+        m_ui.frameRecording.frames = m_framePlayer->GetFrameCount();
+        return true;
+    }
+
+    void StopFramePlayback(const char* errorMessage = nullptr)
+    {
+        if (!m_framePlayer && !errorMessage)
+            return;
+
+        if (m_framePlayer)
+            log::info("Replayed %d frames from %s", m_framePlayer->GetFrameCount(), m_ui.frameRecording.fileName);
+
+        m_framePlayer = nullptr;
+        m_playbackFile.close();
+
+        if (errorMessage)
+        {
+            m_ui.frameRecording.errorMessage = errorMessage;
+            log::warning("Frame playback failed: %s", errorMessage);
+        }
+
+        if (m_exitAfterPlayback)
+        {
+            if (errorMessage)
+                g_ExitCode = 1;
+            else
+                log::info("%s", m_profiler->GetAsText().c_str());
+
+            glfwSetWindowShouldClose(GetDeviceManager()->GetWindow(), GLFW_TRUE);
+        }
+    }
+
+    void UpdateFrameRecordingState()
+    {
+        if (m_ui.frameRecording.stop)
+        {
+            m_ui.frameRecording.stop = false;
+            StopFrameRecording();
+            StopFramePlayback();
+        }
+
+        if (m_ui.frameRecording.startRecording)
+        {
+            m_ui.frameRecording.startRecording = false;
+            StopFramePlayback();
+            StartFrameRecording();
+        }
+
+        if (m_ui.frameRecording.startPlayback)
+        {
+            m_ui.frameRecording.startPlayback = false;
+            StopFrameRecording();
+            StartFramePlayback();
+        }
+
+        m_ui.frameRecording.recording = (m_frameRecorder != nullptr);
+        m_ui.frameRecording.playing = (m_framePlayer != nullptr);
+    }
+
+    FrameTimeQuality GetFrameTimeQuality() const
+    {
+        FrameTimeQuality quality;
+        quality.resolutionScale = m_ui.resolutionScale;
+        quality.checkerboard = m_ui.restirDIStaticParams.CheckerboardSamplingMode != rtxdi::CheckerboardMode::Off;
+        quality.numLocalLightSamples = m_ui.restirDI.initialSamplingParams.numPrimaryLocalLightSamples;
+        quality.numSpatialSamples = m_ui.restirDI.spatialResamplingParams.numSpatialSamples;
+        quality.numBrdfSamples = m_ui.restirDI.initialSamplingParams.numPrimaryBrdfSamples;
+        return quality;
+    }
+
+    void ApplyFrameTimeQuality(const FrameTimeQuality& quality)
+    {
+        m_ui.ApplySweepParameter("resolutionScale", quality.resolutionScale);
+        m_ui.ApplySweepParameter("numPrimaryLocalLightSamples", float(quality.numLocalLightSamples));
+        m_ui.ApplySweepParameter("numSpatialSamples", float(quality.numSpatialSamples));
+        m_ui.ApplySweepParameter("numPrimaryBrdfSamples", float(quality.numBrdfSamples));
+
+        // Only touch the static parameter when the level changes it, which resets the importance sampling context
+        if (quality.checkerboard != GetFrameTimeQuality().checkerboard)
+            m_ui.ApplySweepParameter("checkerboard", quality.checkerboard ? 1.f : 0.f);
+    }
+
+    void StoreFrameTimeBudgetBaseline()
+    {
+        FrameTimeBudgetBaseline& baseline = m_frameTimeBudgetBaseline.emplace();
+        baseline.restirDI = m_ui.restirDI;
+        baseline.checkerboardMode = m_ui.restirDIStaticParams.CheckerboardSamplingMode;
+        baseline.preset = m_ui.preset;
+        baseline.resolutionScale = m_ui.resolutionScale;
+    }
+
+    void RestoreFrameTimeBudgetBaseline()
+    {
+        const FrameTimeBudgetBaseline& baseline = *m_frameTimeBudgetBaseline;
+        if (m_ui.restirDIStaticParams.CheckerboardSamplingMode != baseline.checkerboardMode)
+            m_ui.resetISContext = true;
+
+        m_ui.restirDI = baseline.restirDI;
+        m_ui.restirDIStaticParams.CheckerboardSamplingMode = baseline.checkerboardMode;
+        m_ui.preset = baseline.preset;
+        m_ui.resolutionScale = baseline.resolutionScale;
+        m_frameTimeBudgetBaseline.reset();
+    }
+
+    void UpdateFrameTimeBudget(bool sweepActive)
+    {
+        // Benchmarks, sweeps and playback expect the settings to stay as they are
+        const bool suspended = sweepActive || m_ui.animationFrame.has_value() || m_framePlayer;
+
+        if (!m_ui.frameTimeBudget.enabled || suspended)
+        {
+            // Turning the budget off gives the user their settings back, once nothing else is driving them
+            if (!m_ui.frameTimeBudget.enabled && !suspended && m_frameTimeBudgetBaseline)
+                RestoreFrameTimeBudgetBaseline();
+
+            m_frameTimeBudgetActive = false;
+            return;
+        }
+
+        if (!m_frameTimeBudgetActive)
+        {
+            if (!m_frameTimeBudgetBaseline)
+                StoreFrameTimeBudgetBaseline();
+
+            // Start from the level that matches the current settings instead of jumping to the best one.
+            // That level has the same checkerboard mode, so turning the budget on doesn't change a static parameter.
+            m_frameTimeController.Reset(m_frameTimeController.FindLevel(GetFrameTimeQuality()));
+            ApplyFrameTimeQuality(m_frameTimeController.GetQuality());
+            m_frameTimeBudgetActive = true;
+        }
+
+        FrameTimeControllerSettings settings = m_frameTimeController.GetSettings();
+        settings.targetFrameTimeMs = m_ui.frameTimeBudget.targetFrameTimeMs;
+        m_frameTimeController.SetSettings(settings);
+
+        const double frameTimeMs = m_profiler->IsEnabled()
+            ? m_profiler->GetTimer(ProfilerSection::Frame)
+            : GetDeviceManager()->GetAverageFrameTimeSeconds() * 1e3;
+
+        if (m_frameTimeController.Update(float(frameTimeMs)))
+            ApplyFrameTimeQuality(m_frameTimeController.GetQuality());
+
+        m_ui.frameTimeBudget.level = m_frameTimeController.GetLevel();
+        m_ui.frameTimeBudget.levelCount = m_frameTimeController.GetLevelCount();
+        m_ui.frameTimeBudget.filteredFrameTimeMs = m_frameTimeController.GetFilteredFrameTime();
+    }
+
+    void CheckAllocationBudget()
+    {
+        if (!AllocationTracker::IsAvailable())
+        {
+            log::warning("The allocation budget test requires a build with RTXDI_ALLOCATION_TRACKING enabled.");
+            g_ExitCode = 1;
+            glfwSetWindowShouldClose(GetDeviceManager()->GetWindow(), GLFW_TRUE);
+            m_allocationBudgetTest.reset();
+            return;
+        }
+
+        switch (m_allocationBudgetTest->Update(AllocationTracker::GetLastFrameStats()))
+        {
+        case AllocationBudgetTest::Status::Failed: {
+            const char* sectionNames[ProfilerSection::Count];
+            for (uint32_t section = 0; section < ProfilerSection::Count; section++)
+                sectionNames[section] = Profiler::GetSectionName(ProfilerSection::Enum(section));
+
+            log::warning("Allocation budget exceeded on frame %d:\n%s", m_allocationBudgetTest->GetFailedFrame(),
+                AllocationTracker::FormatFrameStats(m_allocationBudgetTest->GetFailedFrameStats(), sectionNames).c_str());
+            g_ExitCode = 1;
+            glfwSetWindowShouldClose(GetDeviceManager()->GetWindow(), GLFW_TRUE);
+            break;
+        }
+        case AllocationBudgetTest::Status::Passed:
+            log::info("Allocation budget test passed.");
+            glfwSetWindowShouldClose(GetDeviceManager()->GetWindow(), GLFW_TRUE);
+            break;
+        case AllocationBudgetTest::Status::Running:
+        default:
+            break;
+        }
     }
 
 private:
     nvrhi::CommandListHandle m_commandList;
 
+    FrameCommandLists<nvrhi::CommandListHandle> m_frameCommandLists;
+    RecordingPlan m_frameRecordingPlan;     // of MakeFrameRecordingGroups
+    bool m_frameScheduleUsesComputeQueue = false;
+    bool m_frameRecordingIsParallel = false;
+
     nvrhi::BindingLayoutHandle m_bindlessLayout;
 
     std::shared_ptr<vfs::RootFileSystem> m_rootFs;
     std::shared_ptr<engine::ShaderFactory> m_shaderFactory;
+    std::unique_ptr<ShaderPermutationCache> m_shaderCache;
+    ShaderUsageRecorder m_shaderUsage;
+    std::shared_ptr<CachedShaderFactory> m_appShaderFactory; // used by the application passes
+    std::shared_ptr<CachedBindingSetFactory> m_bindingSetFactory;
+    ShaderSourceWatcher m_shaderWatcher;
     std::shared_ptr<SampleScene> m_scene;
     std::shared_ptr<engine::DescriptorTableManager> m_descriptorTableManager;
     std::unique_ptr<render::ToneMappingPass> m_toneMappingPass;
@@ -1093,10 +2157,54 @@ private:
     std::unique_ptr<engine::IesProfileLoader> m_iesProfileLoader;
     std::shared_ptr<Profiler> m_profiler;
 
+    std::unique_ptr<AllocationBudgetTest> m_allocationBudgetTest;
+
+#ifdef DONUT_WITH_TASKFLOW
+    std::unique_ptr<tf::Executor> m_executor;
+#endif
+
+    ParameterSweepRunner m_parameterSweep;
+    SweepFramePlan m_sweepFramePlan;
+    nvrhi::StagingTextureHandle m_sweepReadbackTexture;
+
+    std::ofstream m_recordingFile;
+    std::unique_ptr<FrameRecordWriter> m_frameRecorder;
+    std::ifstream m_playbackFile;
+    std::unique_ptr<FrameRecordReader> m_framePlayer;
+    std::optional<RecordedFrame> m_playbackFrame; // the recorded frame that is being rendered
+    bool m_exitAfterPlayback = false;
+
+    FrameTimeController m_frameTimeController;
+    bool m_frameTimeBudgetActive = false;
+
+    // Settings that the frame time budget overrides, restored when the user turns it off
+    struct FrameTimeBudgetBaseline
+    {
+        decltype(UIData::restirDI) restirDI;
+        rtxdi::CheckerboardMode checkerboardMode = rtxdi::CheckerboardMode::Off;
+        QualityPreset preset = QualityPreset::Custom;
+        float resolutionScale = 1.f;
+    };
+    std::optional<FrameTimeBudgetBaseline> m_frameTimeBudgetBaseline;
+    float m_lastElapsedTime = 0.f;
+
+    // Settings that the parameter sweep overrides, restored when the sweep ends
+    struct
+    {
+        decltype(UIData::restirDI) restirDI;
+        rtxdi::ReSTIRDIStaticParameters restirDIStaticParams;
+        LightingPasses::RenderSettings lightingSettings;
+        QualityPreset preset = QualityPreset::Custom;
+        float resolutionScale = 1.f;
+        bool enableFpsLimit = false;
+        ibool enableAnimations = false;
+    } m_sweepBaseline;
+
     uint32_t m_renderFrameIndex = 0;
 
     UIData& m_ui;
     uint m_framesSinceAnimation = 0;
+    uint m_pendingTlasRebuilds = 0;
     bool m_previousViewValid = false;
     time_point<steady_clock> m_previousFrameTimeStamp;
 
@@ -1114,15 +2222,113 @@ private:
     FrameStepMode m_frameStepMode = FrameStepMode::Disabled;
 };
 
+static void ProcessCommandLine(int argc, char** argv)
+{
+    // Allocation budget test mode: any of these options enables the test.
+    // Budgets that are not specified are unlimited.
+    AllocationBudgetSettings allocationBudget;
+    allocationBudget.maxAllocations = UINT64_MAX;
+    allocationBudget.maxBytes = UINT64_MAX;
+    bool allocationTest = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(arg, "-allocationBudget") && hasValue)
+        {
+            allocationBudget.maxAllocations = std::strtoull(argv[++i], nullptr, 10);
+            allocationTest = true;
+        }
+        else if (!strcmp(arg, "-allocationBudgetBytes") && hasValue)
+        {
+            allocationBudget.maxBytes = std::strtoull(argv[++i], nullptr, 10);
+            allocationTest = true;
+        }
+        else if (!strcmp(arg, "-allocationWarmupFrames") && hasValue)
+        {
+            allocationBudget.warmupFrames = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+            allocationTest = true;
+        }
+        else if (!strcmp(arg, "-allocationTestFrames") && hasValue)
+        {
+            allocationBudget.checkedFrames = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+            allocationTest = true;
+        }
+        else if (!strcmp(arg, "-blasScratchBudgetMB") && hasValue)
+        {
+            g_BlasBuildSettings.scratchBudget = std::strtoull(argv[++i], nullptr, 10) << 20;
+        }
+        else if (!strcmp(arg, "-blasBuildAtLoad"))
+        {
+            g_BlasBuildSettings.progressive = false;
+        }
+        else if (!strcmp(arg, "-noBlasCompaction"))
+        {
+            g_CompactStaticBLASes = false;
+        }
+        else if (!strcmp(arg, "-sceneCache") && hasValue)
+        {
+            g_SceneCacheDirectory = argv[++i];
+        }
+        else if (!strcmp(arg, "-shaderCache") && hasValue)
+        {
+            g_ShaderCacheDirectory = argv[++i];
+        }
+        else if (!strcmp(arg, "-shaderUsage") && hasValue)
+        {
+            g_ShaderUsageFile = argv[++i];
+        }
+        else if (!strcmp(arg, "-pruneShaderConfig") && hasValue)
+        {
+            g_PruneShaderConfigFile = argv[++i];
+        }
+        else if (!strcmp(arg, "-shaderSources") && hasValue)
+        {
+            g_ShaderSourceDirectory = argv[++i];
+        }
+        else if (!strcmp(arg, "-recordFrames") && hasValue)
+        {
+            g_RecordFramesFile = argv[++i];
+        }
+        else if (!strcmp(arg, "-replayFrames") && hasValue)
+        {
+            g_ReplayFramesFile = argv[++i];
+        }
+        else
+        {
+            log::warning("Ignoring unknown command line argument: %s", arg);
+        }
+    }
+
+    if (allocationTest)
+        g_AllocationBudget = allocationBudget;
+}
+
 #if defined(_WIN32) && !defined(IS_CONSOLE_APP)
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow)
 #else
 int main(int argc, char** argv)
 #endif
 {
+#if defined(_WIN32) && !defined(IS_CONSOLE_APP)
+    int argc = __argc;
+    char** argv = __argv;
+#endif
+
+    ProcessCommandLine(argc, argv);
+
+    if (!g_PruneShaderConfigFile.empty())
+    {
+        PruneShaderConfigFile();
+        return g_ExitCode;
+    }
+
     app::DeviceCreationParameters deviceParams;
     deviceParams.swapChainBufferCount = 3;
     deviceParams.enableRayTracingExtensions = true;
+    deviceParams.enableComputeQueue = true;
     deviceParams.backBufferWidth = 1920;
     deviceParams.backBufferHeight = 1080;
     deviceParams.vsyncEnabled = true;
@@ -1137,6 +2343,8 @@ int main(int argc, char** argv)
     deviceParams.deviceCreateInfoCallback = [](VkDeviceCreateInfo& info) {
         auto features = const_cast<VkPhysicalDeviceFeatures*>(info.pEnabledFeatures);
         features->fragmentStoresAndAtomics = VK_TRUE;
+        features->multiDrawIndirect = VK_TRUE;
+        features->drawIndirectFirstInstance = VK_TRUE;
         };
 #endif
 
@@ -1177,6 +2385,7 @@ int main(int argc, char** argv)
             deviceManager->AddRenderPassToBack(&userInterface);
             deviceManager->RunMessageLoop();
             deviceManager->GetDevice()->waitForIdle();
+            sceneRenderer.SaveShaderUsage();
             deviceManager->RemoveRenderPass(&sceneRenderer);
             deviceManager->RemoveRenderPass(&userInterface);
         }
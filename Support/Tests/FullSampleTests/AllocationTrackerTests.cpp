@@ -0,0 +1,171 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "AllocationTracker.h"
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+    AllocationFrameStats MakeFrame(uint64_t allocations, uint64_t bytes)
+    {
+        AllocationFrameStats stats;
+        stats.scopes[AllocationFrameStats::OtherScope].allocations = allocations;
+        stats.scopes[AllocationFrameStats::OtherScope].bytes = bytes;
+        stats.total.allocations = allocations;
+        stats.total.bytes = bytes;
+        return stats;
+    }
+
+    AllocationBudgetSettings MakeBudget()
+    {
+        AllocationBudgetSettings settings;
+        settings.warmupFrames = 2;
+        settings.checkedFrames = 3;
+        settings.maxAllocations = 10;
+        settings.maxBytes = 1000;
+        return settings;
+    }
+
+    void TestBudget(TestContext& context)
+    {
+        {
+            AllocationBudgetTest test(MakeBudget());
+            context.Check(test.Update(MakeFrame(100, 100000)) == AllocationBudgetTest::Status::Running, "warmup frames are not checked");
+            context.Check(test.Update(MakeFrame(100, 100000)) == AllocationBudgetTest::Status::Running, "all warmup frames are skipped");
+            context.Check(test.Update(MakeFrame(10, 1000)) == AllocationBudgetTest::Status::Running, "a frame at the budget is within it");
+            context.Check(test.Update(MakeFrame(0, 0)) == AllocationBudgetTest::Status::Running, "the test runs for the checked frames");
+            context.Check(test.Update(MakeFrame(10, 1000)) == AllocationBudgetTest::Status::Passed, "the test passes after the last checked frame");
+            context.Check(test.Update(MakeFrame(100, 100000)) == AllocationBudgetTest::Status::Passed, "frames after the result are ignored");
+        }
+
+        {
+            AllocationBudgetTest test(MakeBudget());
+            test.Update(MakeFrame(0, 0));
+            test.Update(MakeFrame(0, 0));
+            test.Update(MakeFrame(1, 10));
+            context.Check(test.Update(MakeFrame(11, 10)) == AllocationBudgetTest::Status::Failed, "an allocation count over the budget fails");
+            context.Check(test.GetFailedFrame() == 3, "the failed frame counts the warmup frames");
+            context.Check(test.GetFailedFrameStats().total.allocations == 11, "the stats of the failed frame are kept");
+            context.Check(test.Update(MakeFrame(0, 0)) == AllocationBudgetTest::Status::Failed, "a failure is final");
+            context.Check(test.GetStatus() == AllocationBudgetTest::Status::Failed && test.GetFailedFrame() == 3, "later frames don't replace the failure");
+        }
+
+        {
+            AllocationBudgetTest test(MakeBudget());
+            test.Update(MakeFrame(0, 0));
+            test.Update(MakeFrame(0, 0));
+            context.Check(test.Update(MakeFrame(1, 1001)) == AllocationBudgetTest::Status::Failed, "a byte count over the budget fails");
+            context.Check(test.GetFailedFrame() == 2 && test.GetFailedFrameStats().total.bytes == 1001, "the byte overflow is reported");
+        }
+
+        {
+            AllocationBudgetSettings settings = MakeBudget();
+            settings.warmupFrames = 0;
+            AllocationBudgetTest test(settings);
+            context.Check(test.Update(MakeFrame(11, 0)) == AllocationBudgetTest::Status::Failed, "without warmup the first frame is checked");
+            context.Check(test.GetFailedFrame() == 0, "the first frame is frame 0");
+        }
+    }
+
+    void TestCategoryTotals(TestContext& context)
+    {
+        context.Check(AllocationTracker::IsAvailable(), "the tests are built with the allocation hooks");
+        if (!AllocationTracker::IsAvailable())
+            return;
+
+        // Nothing between BeginFrame and EndFrame allocates except the recorded calls and the buffer below,
+        // so the counts are exact
+        AllocationTracker::BeginFrame();
+        AllocationTracker::RecordAllocation(16);
+
+        AllocationTracker::PushScope(ProfilerSection::TlasUpdate);
+        AllocationTracker::RecordAllocation(100);
+        AllocationTracker::RecordAllocation(200);
+
+        AllocationTracker::PushScope(ProfilerSection::Shading);
+        std::unique_ptr<char[]> buffer(new char[256]);
+        char* volatile escaped = buffer.get();  // keeps the compiler from removing the new/delete pair
+        (void)escaped;
+        buffer.reset();
+        AllocationTracker::PopScope();
+
+        AllocationTracker::RecordFree();
+        AllocationTracker::PopScope();
+        AllocationTracker::PopScope();  // unbalanced, stays at the outermost scope
+        AllocationTracker::RecordAllocation(8);
+        AllocationTracker::EndFrame();
+
+        // Not in a frame
+        AllocationTracker::RecordAllocation(1000);
+
+        const AllocationFrameStats stats = AllocationTracker::GetLastFrameStats();
+        const AllocationStats& other = stats.scopes[AllocationFrameStats::OtherScope];
+        const AllocationStats& tlas = stats.scopes[ProfilerSection::TlasUpdate];
+        const AllocationStats& shading = stats.scopes[ProfilerSection::Shading];
+
+        context.Check(other.allocations == 2 && other.bytes == 24 && other.frees == 0, "allocations outside of a section go to the other scope");
+        context.Check(tlas.allocations == 2 && tlas.bytes == 300 && tlas.frees == 1, "allocations go to the open section");
+        context.Check(shading.allocations == 1 && shading.bytes == 256 && shading.frees == 1, "operator new and delete go to the innermost section");
+        context.Check(stats.total.allocations == 5 && stats.total.bytes == 580 && stats.total.frees == 2, "the total is the sum of the scopes");
+
+        uint64_t otherSections = 0;
+        for (uint32_t scope = 0; scope < ProfilerSection::Count; scope++)
+        {
+            if (scope != ProfilerSection::TlasUpdate && scope != ProfilerSection::Shading)
+                otherSections += stats.scopes[scope].allocations + stats.scopes[scope].frees;
+        }
+        context.Check(otherSections == 0, "sections that were not open have no allocations");
+
+        std::vector<const char*> sectionNames(ProfilerSection::Count, "Unused");
+        sectionNames[ProfilerSection::TlasUpdate] = "TLAS";
+        sectionNames[ProfilerSection::Shading] = "Shading";
+        const std::string text = AllocationTracker::FormatFrameStats(stats, sectionNames.data());
+        context.Check(text.find("Total: 5 allocations, 580 bytes, 2 frees") == 0, "the report starts with the total");
+        context.Check(text.find("TLAS: 2 allocations, 300 bytes, 1 frees") != std::string::npos, "the report lists each used section");
+        context.Check(text.find("Other: 2 allocations, 24 bytes, 0 frees") != std::string::npos, "the report lists the other scope");
+        context.Check(text.find("Unused") == std::string::npos, "the report skips empty sections");
+
+        AllocationTracker::BeginFrame();
+        AllocationTracker::EndFrame();
+        context.Check(AllocationTracker::GetLastFrameStats().total.allocations == 0, "each frame starts from zero");
+    }
+
+    void TestScopeDepth(TestContext& context)
+    {
+        if (!AllocationTracker::IsAvailable())
+            return;
+
+        // Scopes deeper than the stack are attributed to the deepest stored one
+        constexpr uint32_t depth = 20;
+        AllocationTracker::BeginFrame();
+        for (uint32_t level = 0; level < depth; level++)
+            AllocationTracker::PushScope(level < 15 ? ProfilerSection::Frame : ProfilerSection::Denoising);
+        AllocationTracker::RecordAllocation(4);
+        for (uint32_t level = 0; level < depth; level++)
+            AllocationTracker::PopScope();
+        AllocationTracker::RecordAllocation(4);
+        AllocationTracker::EndFrame();
+
+        const AllocationFrameStats& stats = AllocationTracker::GetLastFrameStats();
+        context.Check(stats.scopes[ProfilerSection::Denoising].allocations == 1, "deep scopes use the deepest stored section");
+        context.Check(stats.scopes[AllocationFrameStats::OtherScope].allocations == 1, "the scopes unwind after a deep stack");
+    }
+}
+
+void TestAllocationTracker(TestContext& context)
+{
+    TestBudget(context);
+    TestCategoryTotals(context);
+    TestScopeDepth(context);
+}
@@ -0,0 +1,231 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "AnimationEvaluator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace
+{
+    bool IsNear(const float* a, const float* b, int count, float tolerance = 1e-5f)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (!(std::abs(a[i] - b[i]) <= tolerance))
+                return false;
+        }
+        return true;
+    }
+
+    AnimationKeyframe MakeKeyframe(float time, float x, float y = 0.f, float z = 0.f, float w = 0.f)
+    {
+        AnimationKeyframe keyframe;
+        keyframe.time = time;
+        keyframe.value[0] = x;
+        keyframe.value[1] = y;
+        keyframe.value[2] = z;
+        keyframe.value[3] = w;
+        return keyframe;
+    }
+
+    AnimationSample Sample(AnimationInterpolation interpolation, const std::vector<AnimationKeyframe>& keyframes, float time)
+    {
+        AnimationTrack track;
+        track.keyframeCount = uint32_t(keyframes.size());
+        track.interpolation = interpolation;
+        return SampleAnimationTrack(track, keyframes.data(), time);
+    }
+
+    void TestSampling(TestContext& context)
+    {
+        const std::vector<AnimationKeyframe> line = { MakeKeyframe(0.f, 0.f), MakeKeyframe(1.f, 1.f), MakeKeyframe(2.f, 2.f), MakeKeyframe(3.f, 3.f) };
+
+        context.Check(Sample(AnimationInterpolation::Linear, line, -1.f).value[0] == 0.f
+            && Sample(AnimationInterpolation::Linear, line, 5.f).value[0] == 3.f, "the track is clamped to its first and last keyframe");
+        context.Check(Sample(AnimationInterpolation::Linear, {}, 1.f).value[0] == 0.f
+            && Sample(AnimationInterpolation::Linear, { MakeKeyframe(1.f, 7.f) }, 0.f).value[0] == 7.f,
+            "tracks with no or one keyframe are constant");
+
+        context.Check(std::abs(Sample(AnimationInterpolation::Linear, line, 1.25f).value[0] - 1.25f) < 1e-6f, "linear interpolation");
+        context.Check(Sample(AnimationInterpolation::Step, line, 1.75f).value[0] == 1.f, "step interpolation holds the previous keyframe");
+        context.Check(std::abs(Sample(AnimationInterpolation::CatmullRomSpline, line, 1.5f).value[0] - 1.5f) < 1e-6f,
+            "a Catmull-Rom spline through evenly spaced points is a line");
+
+        // Without tangents, a Hermite spline is a smoothstep between the values
+        const std::vector<AnimationKeyframe> step = { MakeKeyframe(0.f, 0.f), MakeKeyframe(2.f, 1.f) };
+        context.Check(std::abs(Sample(AnimationInterpolation::HermiteSpline, step, 0.5f).value[0] - 0.15625f) < 1e-6f,
+            "Hermite interpolation without tangents");
+
+        std::vector<AnimationKeyframe> tangents = step;
+        tangents[0].outTangent[0] = 1.f;
+        tangents[1].inTangent[0] = 1.f;
+        context.Check(std::abs(Sample(AnimationInterpolation::HermiteSpline, tangents, 0.5f).value[0]
+            - Sample(AnimationInterpolation::HermiteSpline, step, 0.5f).value[0] - 0.1875f) < 1e-6f,
+            "the tangents are scaled by the keyframe interval");
+
+        // Halfway between the identity and 90 degrees around Z is 45 degrees
+        const float s45 = std::sqrt(0.5f);
+        const std::vector<AnimationKeyframe> rotation = { MakeKeyframe(0.f, 0.f, 0.f, 0.f, 1.f), MakeKeyframe(1.f, 0.f, 0.f, s45, s45) };
+        const float expected[4] = { 0.f, 0.f, std::sin(0.3926991f), std::cos(0.3926991f) };
+        context.Check(IsNear(Sample(AnimationInterpolation::Slerp, rotation, 0.5f).value, expected, 4), "spherical interpolation");
+
+        std::vector<AnimationKeyframe> flipped = rotation;
+        for (float& component : flipped[1].value)
+            component = -component;
+        context.Check(IsNear(Sample(AnimationInterpolation::Slerp, flipped, 0.5f).value, expected, 4),
+            "spherical interpolation takes the short way around");
+    }
+
+    void TestEvaluator(TestContext& context)
+    {
+        std::mt19937 random(43);
+        std::uniform_real_distribution<float> value(-1.f, 1.f);
+        std::uniform_real_distribution<float> interval(0.05f, 0.5f);
+
+        // Tracks in random target order, with irregular keyframe times and every interpolation mode
+        const uint32_t targetCount = 300;
+        const uint32_t clockCount = 5;
+        std::vector<AnimationTrack> tracks;
+        std::vector<AnimationKeyframe> keyframes;
+        for (uint32_t target = 0; target < targetCount; target++)
+        {
+            for (uint32_t attribute = 0; attribute < 3; attribute++)
+            {
+                AnimationTrack& track = tracks.emplace_back();
+                track.firstKeyframe = uint32_t(keyframes.size());
+                track.keyframeCount = (target % 50 == 0) ? target % 3 : 2 + random() % 20;
+                track.interpolation = AnimationInterpolation(random() % 5);
+                track.clock = random() % clockCount;
+                track.target = (target * 7919) % targetCount;
+
+                float time = value(random);
+                for (uint32_t key = 0; key < track.keyframeCount; key++)
+                {
+                    keyframes.push_back(MakeKeyframe(time, value(random), value(random), value(random), value(random)));
+                    keyframes.back().inTangent[0] = value(random);
+                    keyframes.back().outTangent[1] = value(random);
+                    time += interval(random);
+                }
+            }
+        }
+
+        // Forward in small steps, then back, then jumps, so that the cached segments are hit, missed and stale
+        std::vector<float> times;
+        for (float time = -1.5f; time < 6.f; time += 0.02f)
+            times.push_back(time);
+        for (float time = 6.f; time > -1.5f; time -= 0.3f)
+            times.push_back(time);
+        for (uint32_t jump = 0; jump < 50; jump++)
+            times.push_back(value(random) * 6.f);
+
+        for (uint32_t tracksPerTask : { 1u, 7u, 256u })
+        {
+            AnimationEvaluator serial;
+            AnimationEvaluator parallel;
+            serial.Build(tracks, keyframes, tracksPerTask);
+            parallel.Build(tracks, keyframes, tracksPerTask);
+
+            bool identical = true;
+            for (float time : times)
+            {
+                float clockTimes[clockCount];
+                for (uint32_t clock = 0; clock < clockCount; clock++)
+                    clockTimes[clock] = time + 0.37f * float(clock);
+
+                serial.EvaluateSerial(clockTimes);
+                parallel.Evaluate(clockTimes, RunParallelTasks);
+                identical = identical && memcmp(serial.GetResults().data(), parallel.GetResults().data(),
+                    tracks.size() * sizeof(AnimationSample)) == 0;
+            }
+            context.Check(identical, "the parallel evaluation is bitwise identical to the serial reference");
+
+            if (tracksPerTask == 1)
+                context.Check(parallel.GetTaskCount() == targetCount, "the tracks of one target stay in one task");
+        }
+
+        AnimationEvaluator empty;
+        empty.Build({}, {});
+        empty.Evaluate(nullptr, RunParallelTasks);
+        context.Check(empty.GetResults().empty(), "an evaluator without tracks does nothing");
+    }
+
+    void TestHierarchy(TestContext& context)
+    {
+        const float s45 = std::sqrt(0.5f);
+        std::vector<AnimationTransform> locals(4);
+        locals[0].translation[0] = 1.f;
+        locals[1].translation[0] = 1.f;
+        locals[1].rotation[2] = s45;
+        locals[1].rotation[3] = s45;
+        locals[2].translation[0] = 1.f;
+        locals[2].scaling[0] = locals[2].scaling[1] = locals[2].scaling[2] = 2.f;
+
+        TransformHierarchy hierarchy;
+        hierarchy.Build({ TransformHierarchy::NoParent, 0, 1, 0 });
+        context.Check(hierarchy.GetNodeCount() == 4 && hierarchy.GetLevelCount() == 3, "the nodes are grouped by depth");
+
+        std::vector<AnimationMatrix> worlds(4);
+        hierarchy.Propagate(locals.data(), worlds.data(), RunParallelTasks);
+
+        // Rotated by 90 degrees around Z and scaled by 2, one unit along X from a parent at (2, 0, 0)
+        const float expected[3][4] = { { 0.f, -2.f, 0.f, 2.f }, { 2.f, 0.f, 0.f, 1.f }, { 0.f, 0.f, 2.f, 0.f } };
+        context.Check(IsNear(&worlds[2].m[0][0], &expected[0][0], 12), "the world transform is parent * T * R * S");
+        context.Check(worlds[3].m[0][3] == 1.f && worlds[3].m[0][0] == 1.f, "a sibling only has the root transform");
+
+        // A deep and wide random tree, split into small tasks
+        std::mt19937 random(47);
+        std::uniform_real_distribution<float> value(-1.f, 1.f);
+        const uint32_t nodeCount = 20000;
+        std::vector<uint32_t> parents(nodeCount);
+        locals.resize(nodeCount);
+        for (uint32_t node = 0; node < nodeCount; node++)
+        {
+            parents[node] = (node % 1000 == 0) ? TransformHierarchy::NoParent : node - 1 - random() % std::min(node, 20u);
+            for (float& component : locals[node].translation)
+                component = value(random);
+            for (float& component : locals[node].rotation)
+                component = value(random) * 0.5f;
+        }
+
+        hierarchy.Build(parents);
+        std::vector<AnimationMatrix> serialWorlds(nodeCount);
+        std::vector<AnimationMatrix> parallelWorlds(nodeCount);
+        hierarchy.PropagateSerial(locals.data(), serialWorlds.data());
+        hierarchy.Propagate(locals.data(), parallelWorlds.data(), RunParallelTasks, 16);
+        context.Check(memcmp(serialWorlds.data(), parallelWorlds.data(), nodeCount * sizeof(AnimationMatrix)) == 0,
+            "the parallel propagation is bitwise identical to the serial one");
+    }
+}
+
+void TestAnimationEvaluator(TestContext& context)
+{
+    TestSampling(context);
+    TestEvaluator(context);
+    TestHierarchy(context);
+
+    const AnimationBenchmarkResult result = BenchmarkAnimationEvaluation(1000, 2, RunParallelTasks);
+    context.Check(result.resultsMatch && result.trackCount == 3000, "the benchmark scene evaluates the same on all paths");
+}
+
+void RunAnimationBenchmark()
+{
+    for (uint32_t nodeCount : { 1'000u, 10'000u, 100'000u })
+    {
+        const AnimationBenchmarkResult result = BenchmarkAnimationEvaluation(nodeCount, 10, RunParallelTasks);
+        printf("Animation, %u tracks: sampling serial %.3f ms, parallel %.3f ms, propagation serial %.3f ms, parallel %.3f ms, results %s\n",
+            result.trackCount, result.serialSamplingMs, result.parallelSamplingMs, result.serialPropagationMs, result.parallelPropagationMs,
+            result.resultsMatch ? "match" : "DIFFER");
+    }
+}
@@ -0,0 +1,223 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "AsyncComputeSchedule.h"
+
+namespace
+{
+    const uint32_t c_None = ~0u;
+
+    bool IsWrite(RenderGraphAccess access)
+    {
+        return access == RenderGraphAccess::UnorderedWrite || access == RenderGraphAccess::UnorderedReadWrite;
+    }
+
+    // Two tasks conflict when they access a resource and one of them writes it. A later task depends on
+    // every earlier task it conflicts with, which includes the dependencies that are implied by others.
+    bool Conflict(const AsyncComputeTask& earlier, const AsyncComputeTask& later)
+    {
+        for (const RenderGraphUse& a : earlier.uses)
+        {
+            for (const RenderGraphUse& b : later.uses)
+            {
+                if (a.resource == b.resource && a.access != RenderGraphAccess::None && b.access != RenderGraphAccess::None
+                    && (IsWrite(a.access) || IsWrite(b.access)))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    // Every task is in one batch of its queue, the batches keep the declaration order of each queue,
+    // the waits refer to earlier batches of the other queue, and every dependency on a task of the other
+    // queue is covered by a wait of the batch or an earlier batch of the same queue
+    bool IsScheduleValid(const std::vector<AsyncComputeTask>& tasks, const AsyncComputeSchedule& schedule)
+    {
+        const uint32_t taskCount = uint32_t(tasks.size());
+        if (schedule.taskQueues.size() != taskCount || schedule.taskBatches.size() != taskCount)
+            return false;
+
+        uint32_t lastTasks[2] = { c_None, c_None };
+        std::vector<uint32_t> coveredBatches(schedule.batches.size(), c_None);
+        uint32_t waitedBatches[2] = { c_None, c_None };
+
+        for (uint32_t batchIndex = 0; batchIndex < uint32_t(schedule.batches.size()); batchIndex++)
+        {
+            const AsyncComputeBatch& batch = schedule.batches[batchIndex];
+            const uint32_t queueIndex = (batch.queue == QueueType::Compute) ? 1 : 0;
+
+            for (uint32_t wait : batch.waits)
+            {
+                if (wait >= batchIndex || schedule.batches[wait].queue == batch.queue)
+                    return false;
+                if (waitedBatches[queueIndex] == c_None || wait > waitedBatches[queueIndex])
+                    waitedBatches[queueIndex] = wait;
+            }
+            coveredBatches[batchIndex] = waitedBatches[queueIndex];
+
+            for (uint32_t task : batch.tasks)
+            {
+                if (task >= taskCount || schedule.taskBatches[task] != batchIndex || schedule.taskQueues[task] != batch.queue)
+                    return false;
+                if (lastTasks[queueIndex] != c_None && task < lastTasks[queueIndex])
+                    return false;
+                lastTasks[queueIndex] = task;
+            }
+        }
+
+        for (uint32_t task = 0; task < taskCount; task++)
+        {
+            for (uint32_t dependency = 0; dependency < task; dependency++)
+            {
+                if (schedule.taskQueues[dependency] == schedule.taskQueues[task] || !Conflict(tasks[dependency], tasks[task]))
+                    continue;
+
+                const uint32_t covered = coveredBatches[schedule.taskBatches[task]];
+                if (covered == c_None || covered < schedule.taskBatches[dependency])
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    enum FrameResource : RenderGraphResource
+    {
+        SceneBuffers,
+        EnvironmentPdf,
+        GBuffer,
+        LightData,
+        LocalLightPdf,
+        RisBuffers,
+        LightingOutputs
+    };
+
+    // The tasks of a frame up to the lighting passes, as the application declares them
+    std::vector<AsyncComputeTask> MakeFrameTasks()
+    {
+        return {
+            { "SceneUpdate", { { SceneBuffers, RenderGraphAccess::UnorderedWrite }, { EnvironmentPdf, RenderGraphAccess::UnorderedWrite } }, false },
+            { "GBufferFill", { { SceneBuffers, RenderGraphAccess::ShaderRead }, { GBuffer, RenderGraphAccess::UnorderedWrite } }, false },
+            { "PrepareLights", { { SceneBuffers, RenderGraphAccess::ShaderRead }, { LightData, RenderGraphAccess::UnorderedWrite }, { LocalLightPdf, RenderGraphAccess::UnorderedWrite } }, true },
+            { "LocalLightPdfMips", { { LocalLightPdf, RenderGraphAccess::UnorderedReadWrite } }, true },
+            { "LightSampling", { { GBuffer, RenderGraphAccess::ShaderRead }, { EnvironmentPdf, RenderGraphAccess::ShaderRead }, { LightData, RenderGraphAccess::ShaderRead },
+                { LocalLightPdf, RenderGraphAccess::ShaderRead }, { RisBuffers, RenderGraphAccess::UnorderedWrite } }, true },
+            { "Lighting", { { GBuffer, RenderGraphAccess::ShaderRead }, { LightData, RenderGraphAccess::ShaderRead }, { RisBuffers, RenderGraphAccess::UnorderedRead },
+                { LightingOutputs, RenderGraphAccess::UnorderedWrite } }, false }
+        };
+    }
+
+    void TestSerial(TestContext& context)
+    {
+        const std::vector<AsyncComputeTask> tasks = MakeFrameTasks();
+        const AsyncComputeSchedule schedule = ScheduleAsyncCompute(tasks, false);
+
+        context.Check(schedule.batches.size() == 1 && schedule.batches[0].queue == QueueType::Graphics &&
+            schedule.batches[0].tasks == std::vector<uint32_t>{ 0, 1, 2, 3, 4, 5 } && schedule.GetWaitCount() == 0,
+            "without the compute queue, the frame is one graphics batch");
+        context.Check(IsScheduleValid(tasks, schedule), "the serial schedule is valid");
+    }
+
+    void TestFrame(TestContext& context)
+    {
+        const std::vector<AsyncComputeTask> tasks = MakeFrameTasks();
+        const AsyncComputeSchedule schedule = ScheduleAsyncCompute(tasks, true);
+
+        context.Check(schedule.taskQueues == std::vector<QueueType>{ QueueType::Graphics, QueueType::Graphics, QueueType::Compute,
+            QueueType::Compute, QueueType::Graphics, QueueType::Graphics },
+            "the light preparation overlaps the G-buffer, the light sampling that reads the G-buffer doesn't");
+
+        const bool batches = schedule.batches.size() == 4 &&
+            schedule.batches[0].queue == QueueType::Graphics && schedule.batches[0].tasks == std::vector<uint32_t>{ 0 } && schedule.batches[0].waits.empty() &&
+            schedule.batches[1].queue == QueueType::Compute && schedule.batches[1].tasks == std::vector<uint32_t>{ 2, 3 } && schedule.batches[1].waits == std::vector<uint32_t>{ 0 } &&
+            schedule.batches[2].queue == QueueType::Graphics && schedule.batches[2].tasks == std::vector<uint32_t>{ 1 } && schedule.batches[2].waits.empty() &&
+            schedule.batches[3].queue == QueueType::Graphics && schedule.batches[3].tasks == std::vector<uint32_t>{ 4, 5 } && schedule.batches[3].waits == std::vector<uint32_t>{ 1 };
+        context.Check(batches, "the compute batch waits for the scene update only, the lighting waits for the compute batch");
+        context.Check(IsScheduleValid(tasks, schedule), "the frame schedule is valid");
+    }
+
+    void TestQueueAssignment(TestContext& context)
+    {
+        // A chain has nothing to overlap with
+        std::vector<AsyncComputeTask> tasks = {
+            { "Produce", { { 0, RenderGraphAccess::UnorderedWrite } }, false },
+            { "Process", { { 0, RenderGraphAccess::UnorderedRead }, { 1, RenderGraphAccess::UnorderedWrite } }, true },
+            { "Consume", { { 1, RenderGraphAccess::ShaderRead } }, false }
+        };
+
+        AsyncComputeSchedule schedule = ScheduleAsyncCompute(tasks, true);
+        context.Check(schedule.taskQueues[1] == QueueType::Graphics && schedule.batches.size() == 1,
+            "a task that every graphics task depends on or follows stays on the graphics queue");
+
+        // Only compute tasks
+        tasks = {
+            { "First", { { 0, RenderGraphAccess::UnorderedWrite } }, true },
+            { "Second", { { 1, RenderGraphAccess::UnorderedWrite } }, true }
+        };
+
+        schedule = ScheduleAsyncCompute(tasks, true);
+        context.Check(schedule.taskQueues[0] == QueueType::Graphics && schedule.taskQueues[1] == QueueType::Graphics,
+            "compute tasks need graphics work to overlap with");
+    }
+
+    void TestWaits(TestContext& context)
+    {
+        // The graphics queue waits once for the compute batch, later reads of its results need no wait
+        std::vector<AsyncComputeTask> tasks = {
+            { "Independent", { { 0, RenderGraphAccess::UnorderedWrite } }, false },
+            { "ComputeA", { { 1, RenderGraphAccess::UnorderedWrite } }, true },
+            { "ComputeB", { { 2, RenderGraphAccess::UnorderedWrite } }, true },
+            { "ReadA", { { 1, RenderGraphAccess::ShaderRead } }, false },
+            { "ReadB", { { 2, RenderGraphAccess::ShaderRead } }, false }
+        };
+
+        AsyncComputeSchedule schedule = ScheduleAsyncCompute(tasks, true);
+        context.Check(schedule.GetWaitCount() == 1 && schedule.taskBatches[3] == schedule.taskBatches[4],
+            "a wait covers the later dependencies on the same batch");
+        context.Check(IsScheduleValid(tasks, schedule), "the schedule with a shared wait is valid");
+
+        // The compute queue must not overwrite what the graphics queue still reads
+        tasks = {
+            { "Read", { { 0, RenderGraphAccess::ShaderRead } }, false },
+            { "Overwrite", { { 0, RenderGraphAccess::UnorderedWrite } }, true },
+            { "Other", { { 1, RenderGraphAccess::UnorderedWrite } }, false }
+        };
+
+        schedule = ScheduleAsyncCompute(tasks, true);
+        context.Check(schedule.taskQueues[1] == QueueType::Compute && schedule.batches[schedule.taskBatches[1]].waits.size() == 1 &&
+            schedule.batches[schedule.batches[schedule.taskBatches[1]].waits[0]].tasks == std::vector<uint32_t>{ 0 },
+            "a write after a read on the other queue waits for the read");
+        context.Check(IsScheduleValid(tasks, schedule), "the schedule with a write after read is valid");
+
+        // Alternating dependencies
+        tasks = {
+            { "G0", { { 0, RenderGraphAccess::UnorderedWrite } }, false },
+            { "C0", { { 0, RenderGraphAccess::ShaderRead }, { 1, RenderGraphAccess::UnorderedWrite } }, true },
+            { "G1", { { 2, RenderGraphAccess::UnorderedWrite } }, false },
+            { "G2", { { 1, RenderGraphAccess::ShaderRead }, { 3, RenderGraphAccess::UnorderedWrite } }, false },
+            { "C1", { { 3, RenderGraphAccess::ShaderRead }, { 4, RenderGraphAccess::UnorderedWrite } }, true },
+            { "G3", { { 5, RenderGraphAccess::UnorderedWrite } }, false },
+            { "G4", { { 4, RenderGraphAccess::ShaderRead } }, false }
+        };
+
+        schedule = ScheduleAsyncCompute(tasks, true);
+        context.Check(schedule.GetWaitCount() == 4 && IsScheduleValid(tasks, schedule), "alternating dependencies wait in both directions");
+    }
+}
+
+void TestAsyncComputeSchedule(TestContext& context)
+{
+    TestSerial(context);
+    TestFrame(context);
+    TestQueueAssignment(context);
+    TestWaits(context);
+}
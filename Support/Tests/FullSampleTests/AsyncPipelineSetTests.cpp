@@ -0,0 +1,240 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "AsyncPipelineSet.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace
+{
+    std::atomic<int64_t> g_FakePipelineCount = 0;
+
+    // Stands in for a pipeline handle: counts the live instances and remembers the build that created it
+    class FakePipeline
+    {
+    public:
+        explicit FakePipeline(uint64_t generation)
+            : m_generation(generation)
+        {
+            g_FakePipelineCount++;
+        }
+
+        ~FakePipeline()
+        {
+            g_FakePipelineCount--;
+        }
+
+        FakePipeline(const FakePipeline&) = delete;
+        FakePipeline& operator=(const FakePipeline&) = delete;
+
+        [[nodiscard]] uint64_t GetGeneration() const { return m_generation; }
+
+    private:
+        uint64_t m_generation;
+    };
+
+    struct FakePipelineSet
+    {
+        std::vector<std::unique_ptr<FakePipeline>> pipelines;
+    };
+
+    // Adds jobs that fill the set with pipelines of the given generation, one of them fails if requested
+    AsyncPipelineSet<FakePipelineSet>::JobFactory MakeJobs(uint64_t generation, uint32_t pipelineCount, bool fail,
+        double compileLatencyMs = 0.0)
+    {
+        return [generation, pipelineCount, fail, compileLatencyMs](FakePipelineSet& set, PipelineJobList& jobs)
+        {
+            set.pipelines.resize(pipelineCount);
+            for (uint32_t index = 0; index < pipelineCount; index++)
+            {
+                const bool failJob = fail && index == pipelineCount / 2;
+                jobs.Add("Pipeline" + std::to_string(index), [&set, index, generation, failJob, compileLatencyMs]()
+                {
+                    if (compileLatencyMs > 0.0)
+                        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(compileLatencyMs));
+                    if (failJob)
+                        return false;
+
+                    set.pipelines[index] = std::make_unique<FakePipeline>(generation);
+                    return true;
+                });
+            }
+        };
+    }
+
+    // All pipelines exist and come from the given build
+    bool IsComplete(const FakePipelineSet& set, uint64_t generation)
+    {
+        for (const std::unique_ptr<FakePipeline>& pipeline : set.pipelines)
+        {
+            if (!pipeline || pipeline->GetGeneration() != generation)
+                return false;
+        }
+        return !set.pipelines.empty();
+    }
+
+    // Holds the launched builds until the test runs them, so that the order in which builds finish is fixed
+    struct DeferredLauncher
+    {
+        struct Launch
+        {
+            size_t taskCount;
+            std::function<void(size_t task)> task;
+            std::function<void()> done;
+        };
+
+        std::vector<Launch> launches;
+
+        PipelineJobLauncher GetLauncher()
+        {
+            return [this](size_t taskCount, std::function<void(size_t task)> task, std::function<void()> done)
+            {
+                launches.push_back({ taskCount, std::move(task), std::move(done) });
+            };
+        }
+
+        void Finish(size_t index)
+        {
+            SerialPipelineJobFor(launches[index].taskCount, launches[index].task);
+            launches[index].done();
+        }
+    };
+
+    void TestCommit(TestContext& context)
+    {
+        const int64_t initialPipelineCount = g_FakePipelineCount;
+        {
+            AsyncPipelineSet<FakePipelineSet> builder;
+            FakePipelineSet live;
+            context.Check(builder.Commit(live) == AsyncPipelineStatus::Idle, "there is nothing to commit before a build");
+
+            builder.Build(MakeJobs(1, 8, false), RunParallelTasks);
+            context.Check(builder.Commit(live) == AsyncPipelineStatus::Committed && IsComplete(live, 1)
+                && builder.GetCommittedGeneration() == 1 && builder.GetLastJobCount() == 8, "a successful build is committed");
+            context.Check(builder.Commit(live) == AsyncPipelineStatus::Idle, "a build is committed once");
+
+            builder.Build(MakeJobs(2, 8, true), RunParallelTasks);
+            context.Check(builder.Commit(live) == AsyncPipelineStatus::Failed && IsComplete(live, 1) && builder.GetCommittedGeneration() == 1,
+                "a failed build leaves the live set alone");
+            context.Check(builder.GetLastFailures().size() == 1 && builder.GetLastFailures()[0] == "Pipeline4",
+                "the failed jobs of the last build are reported");
+            context.Check(g_FakePipelineCount - initialPipelineCount == 8, "the set of a failed build is released");
+
+            builder.Build(MakeJobs(3, 8, true), RunParallelTasks);
+            context.Check(builder.Commit(live, true) == AsyncPipelineStatus::Failed && builder.GetCommittedGeneration() == 3
+                && !live.pipelines[4] && live.pipelines[0]->GetGeneration() == 3, "commitFailed makes a failed build live");
+        }
+        context.Check(g_FakePipelineCount == initialPipelineCount, "no pipeline outlives the live set");
+    }
+
+    void TestSupersede(TestContext& context)
+    {
+        const int64_t initialPipelineCount = g_FakePipelineCount;
+        {
+            AsyncPipelineSet<FakePipelineSet> builder;
+            FakePipelineSet live;
+            DeferredLauncher launcher;
+
+            builder.Start(MakeJobs(1, 4, false), launcher.GetLauncher());
+            builder.Start(MakeJobs(2, 4, false), launcher.GetLauncher());
+            context.Check(builder.IsBuilding() && builder.Commit(live) == AsyncPipelineStatus::Building && live.pipelines.empty(),
+                "a running build is not committed");
+
+            // The newer build finishes first and is committed, the superseded one finishes later and is dropped
+            launcher.Finish(1);
+            context.Check(!builder.IsBuilding() && builder.Commit(live) == AsyncPipelineStatus::Committed && IsComplete(live, 2)
+                && builder.GetCommittedGeneration() == 2, "the newest build is committed");
+
+            launcher.Finish(0);
+            context.Check(builder.Commit(live) == AsyncPipelineStatus::Idle && IsComplete(live, 2), "a superseded build is never committed");
+
+            // The launcher holds the last reference to a superseded build
+            launcher.launches.clear();
+            context.Check(g_FakePipelineCount - initialPipelineCount == 4, "the set of a superseded build is released");
+
+            // The newer build is still running when the older one finishes
+            builder.Start(MakeJobs(3, 4, false), launcher.GetLauncher());
+            builder.Start(MakeJobs(4, 4, true), launcher.GetLauncher());
+            launcher.Finish(0);
+            context.Check(builder.Commit(live) == AsyncPipelineStatus::Building && IsComplete(live, 2),
+                "a superseded build that finishes first is not committed");
+            launcher.Finish(1);
+            context.Check(builder.Commit(live) == AsyncPipelineStatus::Failed && IsComplete(live, 2),
+                "the newest build decides, even when it fails");
+        }
+        context.Check(g_FakePipelineCount == initialPipelineCount, "no pipeline outlives the live set");
+    }
+
+    // The worker threads drop their references to a build right after it has finished
+    bool WaitForPipelineCount(int64_t count)
+    {
+        for (uint32_t attempt = 0; attempt < 1000 && g_FakePipelineCount != count; attempt++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return g_FakePipelineCount == count;
+    }
+
+    // A render loop that restarts builds on background threads while it renders with the live set
+    void TestRenderLoop(TestContext& context)
+    {
+        const int64_t initialPipelineCount = g_FakePipelineCount;
+        const uint32_t pipelineCount = 14;
+        uint32_t commits = 0;
+        uint32_t failedBuilds = 0;
+        uint32_t partialFrames = 0;
+        {
+            AsyncPipelineSet<FakePipelineSet> builder;
+            FakePipelineSet live;
+            uint64_t generation = 1;
+
+            builder.Build(MakeJobs(generation, pipelineCount, false), RunParallelTasks);
+            builder.Commit(live);
+
+            for (uint32_t frame = 0; frame < 200; frame++)
+            {
+                // Restart in pairs, so the first build of a pair is superseded while it runs
+                // and the second one has time to finish. Every third build has a failing job.
+                if (frame % 40 == 0 || frame % 40 == 2)
+                {
+                    generation++;
+                    builder.Start(MakeJobs(generation, pipelineCount, generation % 3 == 0, 0.5), LaunchParallelTasks);
+                }
+
+                const AsyncPipelineStatus status = builder.Commit(live);
+                commits += (status == AsyncPipelineStatus::Committed) ? 1 : 0;
+                failedBuilds += (status == AsyncPipelineStatus::Failed) ? 1 : 0;
+
+                // "Render" the frame: all pipelines must exist and come from the same build
+                if (!IsComplete(live, live.pipelines[0] ? live.pipelines[0]->GetGeneration() : 0))
+                    partialFrames++;
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            builder.Wait();
+            commits += (builder.Commit(live) == AsyncPipelineStatus::Committed) ? 1 : 0;
+        }
+
+        context.Check(partialFrames == 0, "no frame renders with pipelines of two builds");
+        context.Check(commits > 0 && commits + failedBuilds <= 10, "the builds are committed or dropped as a whole");
+        context.Check(WaitForPipelineCount(initialPipelineCount), "no pipeline outlives the live set");
+    }
+}
+
+void TestAsyncPipelineSet(TestContext& context)
+{
+    TestCommit(context);
+    TestSupersede(context);
+    TestRenderLoop(context);
+}
@@ -0,0 +1,294 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "BindingSetCache.h"
+
+#include <utility>
+
+namespace
+{
+    // Stands in for a binding set: counts the live instances and remembers its key
+    class FakeBindingSet
+    {
+    public:
+        explicit FakeBindingSet(BindingSetCacheKey key, int& liveCount)
+            : m_key(std::move(key))
+            , m_liveCount(liveCount)
+        {
+            m_liveCount++;
+        }
+
+        ~FakeBindingSet()
+        {
+            m_liveCount--;
+        }
+
+        FakeBindingSet(const FakeBindingSet&) = delete;
+        FakeBindingSet& operator=(const FakeBindingSet&) = delete;
+
+        [[nodiscard]] const BindingSetCacheKey& GetKey() const { return m_key; }
+
+    private:
+        BindingSetCacheKey m_key;
+        int& m_liveCount;
+    };
+
+    using FakeHandle = std::shared_ptr<FakeBindingSet>;
+
+    // Resources are identified by their address only, so any distinct objects will do
+    struct FakeResource
+    {
+        uint32_t id = 0;
+    };
+
+    enum FakeResourceType : uint32_t
+    {
+        FakeTextureSrv = 1,
+        FakeTextureUav,
+        FakeBufferSrv,
+        FakeBufferUav,
+        FakeConstantBuffer
+    };
+
+    BindingSetCacheItem MakeItem(uint32_t slot, uint32_t type, const FakeResource& resource, uint64_t view = 0)
+    {
+        BindingSetCacheItem item;
+        item.slot = slot;
+        item.type = type;
+        item.resource = &resource;
+        item.view = view;
+        return item;
+    }
+
+    void TestHashing(TestContext& context)
+    {
+        FakeResource layout, otherLayout, a, b, c;
+
+        BindingSetCacheKey key;
+        key.layout = &layout;
+        key.items = { MakeItem(0, FakeTextureSrv, a), MakeItem(1, FakeTextureSrv, b), MakeItem(0, FakeTextureUav, c) };
+        const uint64_t hash = HashBindingSetKey(key);
+
+        BindingSetCacheKey copy = key;
+        context.Check(HashBindingSetKey(copy) == hash && copy == key, "equal keys have equal hashes");
+
+        BindingSetCacheKey moved = key;
+        moved.items[1].resource = &c;
+        context.Check(HashBindingSetKey(moved) != hash && !(moved == key), "a moved resource changes the hash");
+
+        BindingSetCacheKey reslotted = key;
+        reslotted.items[1].slot = 2;
+        context.Check(HashBindingSetKey(reslotted) != hash, "a different slot changes the hash");
+
+        BindingSetCacheKey retyped = key;
+        retyped.items[2].type = FakeBufferUav;
+        context.Check(HashBindingSetKey(retyped) != hash, "a different binding type changes the hash");
+
+        BindingSetCacheKey reviewed = key;
+        reviewed.items[0].view = 7;
+        context.Check(HashBindingSetKey(reviewed) != hash, "different view parameters change the hash");
+
+        BindingSetCacheKey relaid = key;
+        relaid.layout = &otherLayout;
+        context.Check(HashBindingSetKey(relaid) != hash && !(relaid == key), "a different layout changes the hash");
+
+        BindingSetCacheKey reordered = key;
+        std::swap(reordered.items[0], reordered.items[1]);
+        context.Check(HashBindingSetKey(reordered) != hash, "the order of the items is part of the hash");
+
+        BindingSetCacheKey shorter = key;
+        shorter.items.pop_back();
+        context.Check(HashBindingSetKey(shorter) != hash, "the item count is part of the hash");
+    }
+
+    void TestDiffing(TestContext& context)
+    {
+        FakeResource layout, otherLayout, a, b, c, d;
+
+        BindingSetCacheKey previous;
+        previous.layout = &layout;
+        previous.items = { MakeItem(0, FakeTextureSrv, a), MakeItem(1, FakeTextureSrv, b), MakeItem(0, FakeBufferUav, c) };
+
+        context.Check(DiffBindingSetItems(previous, previous).empty(), "a key has no differences to itself");
+
+        BindingSetCacheKey current = previous;
+        current.items[2].resource = &d;
+        context.Check(DiffBindingSetItems(previous, current) == std::vector<uint32_t>{ 2 }, "only the moved item differs");
+
+        current.items[0].view = 1;
+        context.Check(DiffBindingSetItems(previous, current) == std::vector<uint32_t>({ 0, 2 }), "changed views differ");
+
+        BindingSetCacheKey longer = previous;
+        longer.items.push_back(MakeItem(1, FakeBufferUav, d));
+        context.Check(DiffBindingSetItems(previous, longer) == std::vector<uint32_t>{ 3 }, "added items differ");
+
+        BindingSetCacheKey relaid = previous;
+        relaid.layout = &otherLayout;
+        context.Check(DiffBindingSetItems(previous, relaid).size() == previous.items.size(), "every item differs with another layout");
+    }
+
+    void TestReuse(TestContext& context)
+    {
+        FakeResource layout, a, b, c;
+        int liveSets = 0;
+        int createCalls = 0;
+
+        {
+            BindingSetCache<FakeHandle> cache;
+            auto creator = [&liveSets, &createCalls](const BindingSetCacheKey& key)
+            {
+                return [&liveSets, &createCalls, key]()
+                {
+                    createCalls++;
+                    return std::make_shared<FakeBindingSet>(key, liveSets);
+                };
+            };
+
+            BindingSetCacheKey key;
+            key.layout = &layout;
+            key.items = { MakeItem(0, FakeTextureSrv, a), MakeItem(1, FakeTextureSrv, b), MakeItem(0, FakeConstantBuffer, c) };
+
+            const FakeHandle first = cache.GetOrCreate("Pass/Current", key, creator(key));
+            context.Check(first && createCalls == 1 && first->GetKey() == key, "the first request creates the set");
+
+            const FakeHandle again = cache.GetOrCreate("Pass/Current", key, creator(key));
+            context.Check(again == first && createCalls == 1, "an unchanged request reuses the set");
+
+            const FakeHandle shared = cache.GetOrCreate("Pass/Previous", key, creator(key));
+            context.Check(shared == first && createCalls == 1 && cache.GetStats().liveSets == 1, "owners with the same items share the set");
+
+            BindingSetCacheKey moved = key;
+            moved.items[1].resource = &c;
+            const FakeHandle patched = cache.GetOrCreate("Pass/Current", moved, creator(moved));
+            context.Check(patched != first && createCalls == 2, "a moved resource recreates the set");
+            context.Check(cache.GetStats().changedItems == 3 + 1, "only the moved item counts as changed");
+            cache.ReleaseUnused();
+            context.Check(cache.GetStats().liveSets == 2, "the replaced set stays while another owner uses it");
+
+            cache.Release("Pass/Previous");
+            context.Check(cache.GetStats().liveSets == 2, "sets without owners stay until ReleaseUnused");
+            context.Check(cache.ReleaseUnused() == 1 && cache.GetStats().liveSets == 1, "the set is released after its last owner");
+
+            const FakeHandle failed = cache.GetOrCreate("Pass/Current", key, []() { return FakeHandle(); });
+            context.Check(!failed && cache.GetStats().liveSets == 1, "failed creations are not cached");
+            context.Check(cache.GetOrCreate("Pass/Current", moved, creator(moved)) == patched, "the owner keeps its set after a failed creation");
+
+            const BindingSetCacheStats& stats = cache.GetStats();
+            context.Check(stats.requests == 6 && stats.hits == 3 && stats.creations == 3, "requests, hits and creations are counted");
+            context.Check(stats.GetHitRate() == 0.5, "the hit rate is hits per request");
+
+            cache.Clear();
+            context.Check(cache.GetStats().liveSets == 0, "clearing releases every set");
+        }
+
+        // The handles held by the test are gone as well now
+        context.Check(liveSets == 0, "no set outlives the cache and its users");
+    }
+
+    // The binding sets of the sample: some reference only render targets, some only the RTXDI resources,
+    // some both. Recreating the RTXDI resources must recreate only the sets that reference them.
+    void TestResourceRecreation(TestContext& context)
+    {
+        int liveSets = 0;
+        BindingSetCache<FakeHandle> cache;
+
+        FakeResource lightingLayout, compositingLayout, prepareLightsLayout;
+        FakeResource depth, normals, albedo, output, sampler;
+        auto lightBuffer = std::make_unique<FakeResource>();
+        auto reservoirBuffer = std::make_unique<FakeResource>();
+
+        auto requestAll = [&]()
+        {
+            std::vector<FakeHandle> sets;
+            auto request = [&](const char* owner, const BindingSetCacheKey& key)
+            {
+                sets.push_back(cache.GetOrCreate(owner, key, [&liveSets, key]() { return std::make_shared<FakeBindingSet>(key, liveSets); }));
+            };
+
+            BindingSetCacheKey compositing;
+            compositing.layout = &compositingLayout;
+            compositing.items = { MakeItem(0, FakeTextureSrv, depth), MakeItem(1, FakeTextureSrv, normals), MakeItem(2, FakeTextureSrv, albedo),
+                MakeItem(0, FakeTextureUav, output), MakeItem(0, FakeConstantBuffer, sampler) };
+            request("Compositing", compositing);
+
+            BindingSetCacheKey prepareLights;
+            prepareLights.layout = &prepareLightsLayout;
+            prepareLights.items = { MakeItem(0, FakeBufferUav, *lightBuffer), MakeItem(0, FakeBufferSrv, sampler) };
+            request("PrepareLights", prepareLights);
+
+            BindingSetCacheKey lighting;
+            lighting.layout = &lightingLayout;
+            lighting.items = { MakeItem(0, FakeTextureSrv, depth), MakeItem(1, FakeTextureSrv, normals), MakeItem(20, FakeBufferSrv, *lightBuffer),
+                MakeItem(0, FakeBufferUav, *reservoirBuffer), MakeItem(1, FakeTextureUav, output) };
+            request("Lighting", lighting);
+
+            return sets;
+        };
+
+        const std::vector<FakeHandle> before = requestAll();
+        cache.ResetStats();
+
+        // Replace the RTXDI resources, the new objects get new addresses while the old ones are alive
+        auto newLightBuffer = std::make_unique<FakeResource>();
+        auto newReservoirBuffer = std::make_unique<FakeResource>();
+        std::swap(lightBuffer, newLightBuffer);
+        std::swap(reservoirBuffer, newReservoirBuffer);
+
+        const std::vector<FakeHandle> after = requestAll();
+        const BindingSetCacheStats& stats = cache.GetStats();
+        context.Check(after[0] == before[0], "sets without the recreated resources are reused");
+        context.Check(after[1] != before[1] && after[2] != before[2], "sets with the recreated resources are recreated");
+        context.Check(stats.requests == 3 && stats.hits == 1 && stats.creations == 2, "one of three sets hits after recreating the RTXDI resources");
+        context.Check(stats.changedItems == 1 + 2 && stats.createdItems == 2 + 5, "only the items of the recreated resources changed");
+        cache.ReleaseUnused();
+        context.Check(cache.GetStats().liveSets == 3, "the replaced sets are released by the cache");
+    }
+
+    // A pass swaps its current and previous frame sets every frame, and the render targets swap their
+    // textures, so requesting the sets again after an odd number of frames trades the sets of the owners
+    void TestOwnerSwap(TestContext& context)
+    {
+        int liveSets = 0;
+        BindingSetCache<FakeHandle> cache;
+
+        FakeResource layout, depth, prevDepth;
+        BindingSetCacheKey current;
+        current.layout = &layout;
+        current.items = { MakeItem(0, FakeTextureSrv, depth), MakeItem(1, FakeTextureSrv, prevDepth) };
+        BindingSetCacheKey previous = current;
+        std::swap(previous.items[0].resource, previous.items[1].resource);
+
+        auto create = [&liveSets](const BindingSetCacheKey& key)
+        {
+            return [&liveSets, key]() { return std::make_shared<FakeBindingSet>(key, liveSets); };
+        };
+
+        const FakeHandle first = cache.GetOrCreate("Pass/Current", current, create(current));
+        const FakeHandle second = cache.GetOrCreate("Pass/Previous", previous, create(previous));
+        cache.ReleaseUnused();
+        cache.ResetStats();
+
+        const FakeHandle swappedFirst = cache.GetOrCreate("Pass/Current", previous, create(previous));
+        const FakeHandle swappedSecond = cache.GetOrCreate("Pass/Previous", current, create(current));
+        context.Check(swappedFirst == second && swappedSecond == first && cache.GetStats().creations == 0, "owners can trade their sets");
+        context.Check(cache.ReleaseUnused() == 0 && liveSets == 2, "traded sets are not released");
+    }
+}
+
+void TestBindingSetCache(TestContext& context)
+{
+    TestHashing(context);
+    TestDiffing(context);
+    TestReuse(context);
+    TestResourceRecreation(context);
+    TestOwnerSwap(context);
+}
@@ -0,0 +1,173 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "BlasBuildPlanner.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+    std::vector<BlasBuildRequest> MakeRequests(uint32_t count, std::mt19937& random)
+    {
+        std::vector<BlasBuildRequest> requests(count);
+        for (BlasBuildRequest& request : requests)
+        {
+            request.cost = 100 + random() % 100000;
+            request.scratchSize = request.cost * 64 + random() % 4096;
+        }
+        return requests;
+    }
+
+    // Every request is in exactly one batch, the batch totals are right, and only a batch of
+    // a single request may go over the limits
+    bool IsValidPlan(const std::vector<BlasBuildRequest>& requests, const std::vector<BlasBuildBatch>& batches,
+        const BlasBuildPlannerSettings& settings)
+    {
+        std::vector<uint32_t> seen(requests.size(), 0);
+        for (const BlasBuildBatch& batch : batches)
+        {
+            if (batch.requests.empty())
+                return false;
+
+            uint64_t scratchSize = 0;
+            uint64_t cost = 0;
+            for (uint32_t index : batch.requests)
+            {
+                if (index >= requests.size())
+                    return false;
+                seen[index]++;
+                scratchSize += requests[index].scratchSize;
+                cost += requests[index].cost;
+            }
+
+            if (scratchSize != batch.scratchSize || cost != batch.cost)
+                return false;
+
+            const bool overLimit = scratchSize > settings.scratchBudget
+                || (settings.maxBatchCost != 0 && cost > settings.maxBatchCost);
+            if (overLimit && batch.requests.size() > 1)
+                return false;
+        }
+
+        return std::all_of(seen.begin(), seen.end(), [](uint32_t count) { return count == 1; });
+    }
+
+    void TestBatches(TestContext& context)
+    {
+        std::mt19937 random(13);
+        const std::vector<BlasBuildRequest> requests = MakeRequests(500, random);
+
+        BlasBuildPlannerSettings settings;
+        settings.scratchBudget = 64ull << 20;
+
+        settings.order = BlasBuildOrder::CheapestFirst;
+        const std::vector<BlasBuildBatch> cheapest = PlanBlasBuildBatches(requests, settings);
+        context.Check(IsValidPlan(requests, cheapest, settings), "cheapest-first batches fit into the scratch budget");
+
+        bool ascending = true;
+        uint64_t previousCost = 0;
+        for (const BlasBuildBatch& batch : cheapest)
+        {
+            for (uint32_t index : batch.requests)
+            {
+                ascending = ascending && requests[index].cost >= previousCost;
+                previousCost = requests[index].cost;
+            }
+        }
+        context.Check(ascending, "cheapest-first batches build the requests in order of cost");
+
+        settings.order = BlasBuildOrder::MostExpensiveFirst;
+        const std::vector<BlasBuildBatch> packed = PlanBlasBuildBatches(requests, settings);
+        context.Check(IsValidPlan(requests, packed, settings), "first-fit batches fit into the scratch budget");
+        context.Check(packed.size() <= cheapest.size(), "first-fit decreasing doesn't need more batches");
+
+        uint64_t totalScratch = 0;
+        for (const BlasBuildRequest& request : requests)
+            totalScratch += request.scratchSize;
+        const size_t lowerBound = size_t((totalScratch + settings.scratchBudget - 1) / settings.scratchBudget);
+        context.Check(packed.size() <= lowerBound + lowerBound / 4 + 1, "first-fit decreasing packs the batches tightly");
+
+        settings.maxBatchCost = 500000;
+        for (BlasBuildOrder order : { BlasBuildOrder::CheapestFirst, BlasBuildOrder::MostExpensiveFirst })
+        {
+            settings.order = order;
+            context.Check(IsValidPlan(requests, PlanBlasBuildBatches(requests, settings), settings),
+                "the batches respect the cost limit");
+        }
+    }
+
+    void TestEdgeCases(TestContext& context)
+    {
+        BlasBuildPlannerSettings settings;
+        settings.scratchBudget = 1000;
+
+        context.Check(PlanBlasBuildBatches({}, settings).empty(), "no requests need no batches");
+
+        const std::vector<BlasBuildRequest> oversized = { { 5000, 1 }, { 400, 2 }, { 400, 3 } };
+        for (BlasBuildOrder order : { BlasBuildOrder::CheapestFirst, BlasBuildOrder::MostExpensiveFirst })
+        {
+            settings.order = order;
+            const std::vector<BlasBuildBatch> batches = PlanBlasBuildBatches(oversized, settings);
+            const bool alone = std::any_of(batches.begin(), batches.end(), [](const BlasBuildBatch& batch)
+            {
+                return batch.requests.size() == 1 && batch.requests[0] == 0;
+            });
+            context.Check(batches.size() == 2 && alone, "a request over the budget is built on its own");
+        }
+    }
+
+    void TestHeapLayout(TestContext& context)
+    {
+        std::mt19937 random(17);
+        std::vector<HeapLayoutRequest> requests(200);
+        uint64_t totalSize = 0;
+        for (HeapLayoutRequest& request : requests)
+        {
+            request.alignment = 1ull << (random() % 17);
+            request.size = request.alignment * (1 + random() % 8);
+            totalSize += request.size;
+        }
+
+        const HeapLayout layout = PlanHeapLayout(requests);
+        context.Check(layout.offsets.size() == requests.size(), "every allocation gets an offset");
+
+        bool aligned = true;
+        std::vector<std::pair<uint64_t, uint64_t>> ranges;
+        for (size_t index = 0; index < requests.size(); index++)
+        {
+            aligned = aligned && layout.offsets[index] % requests[index].alignment == 0;
+            ranges.push_back({ layout.offsets[index], layout.offsets[index] + requests[index].size });
+        }
+        context.Check(aligned, "every allocation is aligned");
+
+        std::sort(ranges.begin(), ranges.end());
+        bool disjoint = ranges.back().second <= layout.size;
+        for (size_t index = 1; index < ranges.size(); index++)
+            disjoint = disjoint && ranges[index].first >= ranges[index - 1].second;
+        context.Check(disjoint, "the allocations don't overlap and fit into the heap");
+
+        // Sizes that are multiples of their alignment pack without padding in decreasing alignment
+        context.Check(layout.size == totalSize, "placing the larger alignments first avoids padding");
+
+        const HeapLayout unaligned = PlanHeapLayout({ { 3, 1 }, { 8, 0 } });
+        context.Check(unaligned.offsets[0] == 0 && unaligned.offsets[1] == 3 && unaligned.size == 11,
+            "an alignment of zero is treated as one");
+    }
+}
+
+void TestBlasBuildPlanner(TestContext& context)
+{
+    TestBatches(context);
+    TestEdgeCases(context);
+    TestHeapLayout(context);
+}
@@ -0,0 +1,205 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "FrameRecording.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+
+namespace
+{
+    constexpr uint32_t c_SettingsSize = 300;
+    constexpr uint64_t c_SettingsLayout = 0x0123456789abcdefull;
+    constexpr size_t c_HeaderSize = 19; // magic, version, two-byte settings size and settings layout, see FrameRecordWriter::Begin
+
+    // Compares the bits, so that NaN and negative zero have to survive the round trip too
+    template<typename T>
+    bool BitwiseEqual(const T& a, const T& b)
+    {
+        return memcmp(&a, &b, sizeof(T)) == 0;
+    }
+
+    bool FramesEqual(const RecordedFrame& a, const RecordedFrame& b)
+    {
+        return a.frameIndex == b.frameIndex
+            && BitwiseEqual(a.elapsedTime, b.elapsedTime)
+            && BitwiseEqual(a.animationTime, b.animationTime)
+            && a.environmentMapIndex == b.environmentMapIndex
+            && BitwiseEqual(a.view.worldToView, b.view.worldToView)
+            && BitwiseEqual(a.view.verticalFov, b.view.verticalFov)
+            && BitwiseEqual(a.view.zNear, b.view.zNear)
+            && a.settings == b.settings;
+    }
+
+    // A camera that moves on most frames, settings that change now and then, a few skipped
+    // frames and environment map switches, and some values that only compare equal bitwise
+    std::vector<RecordedFrame> MakeFrames(uint32_t frameCount)
+    {
+        std::mt19937 random(7);
+        std::vector<RecordedFrame> frames;
+
+        RecordedFrame frame;
+        frame.settings.assign(c_SettingsSize, 0);
+        frame.view.verticalFov = 1.f;
+        frame.view.zNear = 0.1f;
+        frame.elapsedTime = 1.f / 60.f;
+
+        for (uint32_t index = 0; index < frameCount; index++)
+        {
+            if (index > 0)
+                frame.frameIndex += (random() % 16 == 0) ? 3 : 1;
+
+            if (random() % 4 != 0)
+            {
+                frame.view.worldToView[9] += 0.01f;
+                frame.view.worldToView[random() % 9] = float(random() % 1000) / 1000.f;
+            }
+
+            if (random() % 8 == 0)
+            {
+                const uint32_t offset = random() % c_SettingsSize;
+                frame.settings[offset] = uint8_t(random());
+                frame.settings[(offset + 7) % c_SettingsSize] ^= 0x5a;
+            }
+
+            if (random() % 20 == 0)
+                frame.environmentMapIndex = int(random() % 5) - 1;
+
+            frame.animationTime += 1.0 / 60.0;
+            if (index == 10)
+                frame.animationTime = -0.0;
+            if (index == 11)
+                frame.elapsedTime = std::numeric_limits<float>::quiet_NaN();
+            if (index == 12)
+                frame.elapsedTime = 1.f / 30.f;
+
+            frames.push_back(frame);
+        }
+
+        return frames;
+    }
+
+    void TestRoundTrip(TestContext& context)
+    {
+        const std::vector<RecordedFrame> frames = MakeFrames(200);
+        const std::vector<uint8_t> data = EncodeFrameRecording(frames, c_SettingsSize, c_SettingsLayout);
+        context.Check(!data.empty(), "the recording encodes");
+
+        std::vector<RecordedFrame> decoded;
+        std::string error;
+        const bool success = DecodeFrameRecording(data, decoded, error);
+        context.Check(success && error.empty(), "the recording decodes");
+
+        bool equal = decoded.size() == frames.size();
+        for (size_t index = 0; equal && index < frames.size(); index++)
+            equal = FramesEqual(decoded[index], frames[index]);
+        context.Check(equal, "every frame survives the round trip bit for bit");
+
+        // Delta encoding: the full frames would take at least the settings snapshot each
+        context.Check(data.size() < frames.size() * 64, "the records only store what changed");
+
+        std::vector<RecordedFrame> still(10, frames.back());
+        for (uint32_t index = 0; index < still.size(); index++)
+            still[index].frameIndex = index;
+        const size_t stillSize = EncodeFrameRecording(still, c_SettingsSize, c_SettingsLayout).size()
+            - EncodeFrameRecording({ still[0] }, c_SettingsSize, c_SettingsLayout).size();
+        context.Check(stillSize == 9 * 2, "an unchanged frame takes its flags and frame index delta");
+
+        RecordedFrame wrongSize = frames[0];
+        wrongSize.settings.resize(c_SettingsSize - 1);
+        context.Check(EncodeFrameRecording({ wrongSize }, c_SettingsSize, c_SettingsLayout).empty(), "a settings snapshot of the wrong size is rejected");
+    }
+
+    void TestStreaming(TestContext& context)
+    {
+        const std::vector<RecordedFrame> frames = MakeFrames(50);
+
+        std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
+        FrameRecordWriter writer(stream);
+        FrameRecordReader reader(stream);
+        context.Check(writer.Begin(c_SettingsSize, c_SettingsLayout) && reader.Begin(), "the header round-trips");
+        context.Check(reader.GetSettingsSize() == c_SettingsSize, "the reader gets the settings size");
+        context.Check(reader.GetSettingsLayout() == c_SettingsLayout, "the reader gets the settings layout");
+
+        // Interleave writing and reading like a recording that is replayed while it is written
+        bool equal = true;
+        for (const RecordedFrame& frame : frames)
+        {
+            RecordedFrame decoded;
+            equal = equal && writer.WriteFrame(frame) && reader.ReadFrame(decoded) && FramesEqual(decoded, frame);
+        }
+        context.Check(equal, "frames can be read as soon as they are written");
+
+        RecordedFrame end;
+        context.Check(!reader.ReadFrame(end) && reader.GetError().empty(), "the end of the stream is not an error");
+        context.Check(writer.GetFrameCount() == 50 && reader.GetFrameCount() == 50, "both sides count the frames");
+    }
+
+    void TestCorruption(TestContext& context)
+    {
+        const std::vector<RecordedFrame> frames = MakeFrames(20);
+        const std::vector<uint8_t> data = EncodeFrameRecording(frames, c_SettingsSize, c_SettingsLayout);
+        std::vector<RecordedFrame> decoded;
+        std::string error;
+
+        // Every truncation decodes a prefix of the frames or reports an error
+        bool prefixes = true;
+        for (size_t size = 0; size < data.size(); size++)
+        {
+            const std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+            decoded.clear();
+            const bool success = DecodeFrameRecording(truncated, decoded, error);
+            prefixes = prefixes && decoded.size() <= frames.size() && (success || !error.empty());
+            for (size_t index = 0; prefixes && index < decoded.size(); index++)
+                prefixes = FramesEqual(decoded[index], frames[index]);
+        }
+        context.Check(prefixes, "a truncated recording decodes a prefix of the frames");
+
+        std::vector<uint8_t> badMagic = data;
+        badMagic[0] = 'X';
+        context.Check(!DecodeFrameRecording(badMagic, decoded, error) && error == "Not a frame recording", "a bad magic is rejected");
+
+        std::vector<uint8_t> badVersion = data;
+        badVersion[8] = uint8_t(FrameRecordWriter::Version + 1);
+        context.Check(!DecodeFrameRecording(badVersion, decoded, error) && error.find("version") != std::string::npos,
+            "another version is rejected");
+
+        std::vector<uint8_t> truncatedHeader(data.begin(), data.begin() + c_HeaderSize - 1);
+        context.Check(!DecodeFrameRecording(truncatedHeader, decoded, error) && error == "Truncated header", "a header without the settings layout is rejected");
+
+        std::vector<uint8_t> badFlags = data;
+        badFlags[c_HeaderSize] = 0xff;
+        context.Check(!DecodeFrameRecording(badFlags, decoded, error) && error == "Corrupted frame header", "unknown flags are rejected");
+
+        // Flipping bits anywhere must never read outside the settings snapshot
+        std::mt19937 random(11);
+        uint32_t failures = 0;
+        for (uint32_t attempt = 0; attempt < 500; attempt++)
+        {
+            std::vector<uint8_t> corrupted = data;
+            corrupted[c_HeaderSize + 1 + random() % (corrupted.size() - c_HeaderSize - 1)] ^= uint8_t(1u << (random() % 8));
+            decoded.clear();
+            failures += DecodeFrameRecording(corrupted, decoded, error) ? 0 : 1;
+        }
+        context.Check(failures > 0, "corrupted recordings are detected or decoded safely");
+    }
+}
+
+void TestFrameRecording(TestContext& context)
+{
+    TestRoundTrip(context);
+    TestStreaming(context);
+    TestCorruption(context);
+}
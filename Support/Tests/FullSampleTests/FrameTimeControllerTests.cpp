@@ -0,0 +1,181 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "FrameTimeController.h"
+
+#include <functional>
+#include <random>
+
+namespace
+{
+    struct SimulationResult
+    {
+        uint32_t changes = 0;
+        uint32_t lastChangeFrame = 0;
+    };
+
+    // Renders frames whose time is the cost of the current level with a few percent of noise
+    SimulationResult Simulate(FrameTimeController& controller, uint32_t frameCount, const std::function<float(uint32_t level)>& cost,
+        std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> noise(0.97f, 1.03f);
+
+        SimulationResult result;
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            if (controller.Update(cost(controller.GetLevel()) * noise(random)))
+            {
+                result.changes++;
+                result.lastChangeFrame = frame;
+            }
+        }
+        return result;
+    }
+
+    void TestLadder(TestContext& context)
+    {
+        const std::vector<FrameTimeQuality> ladder = BuildFrameTimeQualityLadder();
+        context.Check(ladder.size() > 2, "the ladder has several levels");
+
+        bool oneStep = true;
+        uint32_t staticSteps = 0;
+        for (size_t level = 1; level < ladder.size(); level++)
+        {
+            const FrameTimeQuality& a = ladder[level - 1];
+            const FrameTimeQuality& b = ladder[level];
+            const uint32_t differences = (a.resolutionScale != b.resolutionScale ? 1 : 0)
+                + (a.checkerboard != b.checkerboard ? 1 : 0)
+                + (a.numLocalLightSamples != b.numLocalLightSamples ? 1 : 0)
+                + (a.numSpatialSamples != b.numSpatialSamples ? 1 : 0)
+                + (a.numBrdfSamples != b.numBrdfSamples ? 1 : 0);
+            oneStep = oneStep && differences == 1;
+            staticSteps += (a.checkerboard != b.checkerboard) ? 1 : 0;
+        }
+        context.Check(oneStep, "every step changes one setting");
+        context.Check(staticSteps == 1, "the static parameter changes in a single step");
+
+        const FrameTimeQuality& cheapest = ladder.front();
+        const FrameTimeQuality& best = ladder.back();
+        context.Check(cheapest.resolutionScale < best.resolutionScale && cheapest.checkerboard && !best.checkerboard,
+            "the ladder goes from the cheapest level to the best one");
+
+        FrameTimeController controller;
+        context.Check(controller.GetLevel() == controller.GetLevelCount() - 1, "the controller starts at the best quality");
+    }
+
+    void TestConvergence(TestContext& context)
+    {
+        std::mt19937 random(3);
+        FrameTimeController controller;
+
+        // 8 ms at the cheapest level, 1.6 ms more per level: the levels in the 14.9 - 18.3 ms band are 5 and 6
+        float load = 1.f;
+        auto cost = [&load](uint32_t level) { return (8.f + 1.6f * float(level)) * load; };
+
+        SimulationResult result = Simulate(controller, 3000, cost, random);
+        const float settled = cost(controller.GetLevel());
+        context.Check(settled > 14.94f && settled < 18.26f, "the controller settles in the band around the target");
+        context.Check(result.lastChangeFrame < 1000, "the controller converges within a few hundred frames");
+        context.Check(controller.GetStaticChangeCount() == 0, "a target above the static step doesn't change it");
+
+        // A heavier view pushes the frame time over the band, the controller has to cross the static step
+        load = 1.6f;
+        result = Simulate(controller, 3000, cost, random);
+        const float heavier = cost(controller.GetLevel());
+        context.Check(heavier > 14.94f && heavier < 18.26f, "the controller follows a change of the load");
+        context.Check(controller.GetStaticChangeCount() == 1, "the static parameter changes once");
+        context.Check(result.lastChangeFrame < 1000, "the controller stays at the new level");
+        context.Check(controller.GetStepCostRatio(controller.GetLevel()) > 1.f, "the cost of the steps is learned");
+    }
+
+    void TestOscillation(TestContext& context)
+    {
+        // The middle level is under the band and the top one over it, so alternating would never settle
+        std::vector<FrameTimeQuality> ladder(3);
+        ladder[0].numLocalLightSamples = 1;
+        ladder[1].numLocalLightSamples = 2;
+        ladder[2].numLocalLightSamples = 4;
+
+        FrameTimeController controller(ladder);
+        controller.Reset(1);
+
+        std::mt19937 random(5);
+        auto cost = [](uint32_t level) { return level == 0 ? 8.f : level == 1 ? 13.f : 20.f; };
+        const SimulationResult result = Simulate(controller, 5000, cost, random);
+
+        context.Check(controller.GetLevel() == 1, "the controller stays below the target rather than over it");
+        context.Check(result.changes <= 2, "a level that was measured to be over budget is not tried again");
+        context.Check(controller.GetStepCostRatio(1) > 1.4f && controller.GetStepCostRatio(1) < 1.7f,
+            "the learned step cost matches the measured frame times");
+    }
+
+    void TestFindLevel(TestContext& context)
+    {
+        const std::vector<FrameTimeQuality> ladder = BuildFrameTimeQualityLadder();
+        const FrameTimeController controller(ladder);
+
+        bool exact = true;
+        for (uint32_t level = 0; level < ladder.size(); level++)
+            exact = exact && controller.FindLevel(ladder[level]) == level;
+        context.Check(exact, "the settings of a level find that level");
+
+        // Settings between two levels start at the cheaper one, without going above any of them
+        FrameTimeQuality between = ladder.back();
+        between.numLocalLightSamples = 12;
+        const FrameTimeQuality& found = ladder[controller.FindLevel(between)];
+        context.Check(found.numLocalLightSamples <= 12 && found.resolutionScale <= between.resolutionScale
+            && found.numSpatialSamples <= between.numSpatialSamples && found.numBrdfSamples <= between.numBrdfSamples,
+            "settings between levels find a level below them");
+        context.Check(controller.FindLevel(between) == uint32_t(ladder.size()) - 2, "that level is the best one below them");
+
+        // Expensive settings with checkerboarding stay on the checkerboard levels, cheap ones without it stay off them
+        FrameTimeQuality expensiveCheckerboard = ladder.back();
+        expensiveCheckerboard.checkerboard = true;
+        const uint32_t checkerboardLevel = controller.FindLevel(expensiveCheckerboard);
+        context.Check(ladder[checkerboardLevel].checkerboard && !ladder[checkerboardLevel + 1].checkerboard,
+            "checkerboard settings find the best checkerboard level");
+
+        FrameTimeQuality cheap = ladder.front();
+        cheap.checkerboard = false;
+        context.Check(!ladder[controller.FindLevel(cheap)].checkerboard, "settings without checkerboarding don't find a checkerboard level");
+    }
+
+    void TestSettling(TestContext& context)
+    {
+        FrameTimeControllerSettings settings;
+        settings.settleFrames = 8;
+        settings.measureFrames = 24;
+
+        FrameTimeController controller;
+        controller.SetSettings(settings);
+
+        bool changedEarly = false;
+        for (uint32_t frame = 0; frame < settings.settleFrames + settings.measureFrames - 1; frame++)
+            changedEarly = controller.Update(100.f) || changedEarly;
+        context.Check(!changedEarly && controller.GetLevel() == controller.GetLevelCount() - 1,
+            "nothing changes before the frame time was measured");
+
+        context.Check(controller.Update(100.f) && controller.GetLevel() == controller.GetLevelCount() - 2,
+            "an over-budget frame time steps down one level");
+
+        context.Check(!controller.Update(0.f) && !controller.Update(-1.f), "invalid frame times are ignored");
+    }
+}
+
+void TestFrameTimeController(TestContext& context)
+{
+    TestLadder(context);
+    TestConvergence(context);
+    TestOscillation(context);
+    TestFindLevel(context);
+    TestSettling(context);
+}
@@ -0,0 +1,174 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "GBufferDrawCulling.h"
+
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+namespace
+{
+    affine3 MakeTransform(const float3& row0, const float3& row1, const float3& row2, const float3& translation)
+    {
+        affine3 transform;
+        transform.m_linear.row0 = row0;
+        transform.m_linear.row1 = row1;
+        transform.m_linear.row2 = row2;
+        transform.m_translation = translation;
+        return transform;
+    }
+
+    affine3 MakeTranslation(const float3& translation)
+    {
+        return MakeTransform(float3(1.f, 0.f, 0.f), float3(0.f, 1.f, 0.f), float3(0.f, 0.f, 1.f), translation);
+    }
+
+    GBufferDrawRecord MakeRecord(uint32_t instanceIndex, uint32_t flags, const float3& boundsMin, const float3& boundsMax)
+    {
+        GBufferDrawRecord record = {};
+        record.instanceIndex = instanceIndex;
+        record.indexCount = 3 * (instanceIndex + 1);
+        record.flags = flags;
+        record.boundsMin = boundsMin;
+        record.boundsMax = boundsMax;
+        return record;
+    }
+
+    // The box between -10 and 10 on every axis
+    GBufferCullingConstants MakeCubeFrustum(uint32_t recordCount)
+    {
+        GBufferCullingConstants constants = {};
+        constants.frustumPlanes[0] = float4(-1.f, 0.f, 0.f, 10.f);
+        constants.frustumPlanes[1] = float4(1.f, 0.f, 0.f, 10.f);
+        constants.frustumPlanes[2] = float4(0.f, -1.f, 0.f, 10.f);
+        constants.frustumPlanes[3] = float4(0.f, 1.f, 0.f, 10.f);
+        constants.frustumPlanes[4] = float4(0.f, 0.f, -1.f, 10.f);
+        constants.frustumPlanes[5] = float4(0.f, 0.f, 1.f, 10.f);
+        constants.recordCount = recordCount;
+        constants.enableAlphaTestedGeometry = 1;
+        return constants;
+    }
+
+    bool IsPointInside(const float3& point, const GBufferCullingConstants& constants)
+    {
+        for (const float4& plane : constants.frustumPlanes)
+        {
+            if (plane.x * point.x + plane.y * point.y + plane.z * point.z > plane.w)
+                return false;
+        }
+        return true;
+    }
+
+    void TestLayout(TestContext& context)
+    {
+        // The shader reads the records and constants as structured and constant buffers
+        context.Check(sizeof(GBufferDrawRecord) == 48 && offsetof(GBufferDrawRecord, boundsMin) == 16
+            && offsetof(GBufferDrawRecord, boundsMax) == 32, "the draw record matches the shader layout");
+        context.Check(sizeof(GBufferCullingConstants) % 16 == 0 && offsetof(GBufferCullingConstants, recordCount) == 96,
+            "the culling constants match the shader layout");
+        context.Check(sizeof(GBufferDrawArguments) == 16 && offsetof(GBufferDrawArguments, startInstanceLocation) == 12,
+            "the draw arguments match the indirect argument layout");
+    }
+
+    void TestVisibility(TestContext& context)
+    {
+        const GBufferCullingConstants constants = MakeCubeFrustum(1);
+        const GBufferDrawRecord unitBox = MakeRecord(0, 0, float3(-1.f, -1.f, -1.f), float3(1.f, 1.f, 1.f));
+
+        context.Check(IsGBufferDrawRecordVisible(unitBox, MakeTranslation(float3(0.f, 0.f, 0.f)), constants), "a box inside is visible");
+        context.Check(IsGBufferDrawRecordVisible(unitBox, MakeTranslation(float3(10.5f, 0.f, 0.f)), constants), "a box on a plane is visible");
+        context.Check(!IsGBufferDrawRecordVisible(unitBox, MakeTranslation(float3(11.5f, 0.f, 0.f)), constants), "a box outside is culled");
+        context.Check(!IsGBufferDrawRecordVisible(unitBox, MakeTranslation(float3(0.f, 0.f, -12.f)), constants), "every plane culls");
+
+        const GBufferDrawRecord neverCull = MakeRecord(0, GBUFFER_DRAW_NEVER_CULL, float3(-1.f, -1.f, -1.f), float3(1.f, 1.f, 1.f));
+        context.Check(IsGBufferDrawRecordVisible(neverCull, MakeTranslation(float3(100.f, 0.f, 0.f)), constants),
+            "a record without valid bounds is never culled");
+
+        // Scaled and rotated by 45 degrees around Z, the corner of the box reaches sqrt(2) * 4 from its center
+        const float s = std::sqrt(0.5f) * 4.f;
+        const affine3 rotated = MakeTransform(float3(s, s, 0.f), float3(-s, s, 0.f), float3(0.f, 0.f, 4.f), float3(15.f, 0.f, 0.f));
+        context.Check(IsGBufferDrawRecordVisible(unitBox, rotated, constants), "the corners of a rotated box are taken into account");
+
+        // A rotated box is never culled while a part of it is inside, the world space box is conservative
+        std::mt19937 random(29);
+        std::uniform_real_distribution<float> value(-1.f, 1.f);
+        std::uniform_real_distribution<float> position(-16.f, 16.f);
+        bool conservative = true;
+        uint32_t culled = 0;
+        for (uint32_t attempt = 0; attempt < 2000; attempt++)
+        {
+            const affine3 transform = MakeTransform(
+                float3(value(random), value(random), value(random)) * 3.f,
+                float3(value(random), value(random), value(random)) * 3.f,
+                float3(value(random), value(random), value(random)) * 3.f,
+                float3(position(random), position(random), position(random)));
+
+            if (IsGBufferDrawRecordVisible(unitBox, transform, constants))
+                continue;
+            culled++;
+
+            for (uint32_t corner = 0; corner < 8; corner++)
+            {
+                const float3 point((corner & 1) ? 1.f : -1.f, (corner & 2) ? 1.f : -1.f, (corner & 4) ? 1.f : -1.f);
+                conservative = conservative && !IsPointInside(transform.transformPoint(point), constants);
+            }
+        }
+        context.Check(culled > 0 && conservative, "a culled box has no corner inside the frustum");
+    }
+
+    void TestDrawLists(TestContext& context)
+    {
+        const std::vector<affine3> transforms = {
+            MakeTranslation(float3(0.f, 0.f, 0.f)),
+            MakeTranslation(float3(50.f, 0.f, 0.f)),
+            MakeTranslation(float3(5.f, 5.f, 5.f)),
+        };
+
+        const float3 boundsMin(-1.f, -1.f, -1.f);
+        const float3 boundsMax(1.f, 1.f, 1.f);
+        const std::vector<GBufferDrawRecord> records = {
+            MakeRecord(0, 0, boundsMin, boundsMax),
+            MakeRecord(1, 0, boundsMin, boundsMax),
+            MakeRecord(2, GBUFFER_DRAW_ALPHA_TESTED, boundsMin, boundsMax),
+            MakeRecord(1, GBUFFER_DRAW_ALPHA_TESTED, boundsMin, boundsMax),
+            MakeRecord(2, 0, boundsMin, boundsMax),
+            MakeRecord(0, GBUFFER_DRAW_ALPHA_TESTED, boundsMin, boundsMax),
+        };
+
+        GBufferCullingConstants constants = MakeCubeFrustum(uint32_t(records.size()));
+        std::vector<GBufferDrawArguments> opaque;
+        std::vector<GBufferDrawArguments> alphaTested;
+        CullGBufferDrawRecords(records, transforms, constants, opaque, alphaTested);
+
+        context.Check(opaque.size() == 2 && opaque[0].startInstanceLocation == 0 && opaque[1].startInstanceLocation == 4,
+            "the visible opaque records are drawn in record order");
+        context.Check(alphaTested.size() == 2 && alphaTested[0].startInstanceLocation == 2 && alphaTested[1].startInstanceLocation == 5,
+            "the visible alpha-tested records go to their own list");
+        context.Check(opaque.size() == 2 && opaque[1].vertexCount == records[4].indexCount && opaque[1].instanceCount == 1
+            && opaque[1].startVertexLocation == 0, "a draw covers the indices of its record");
+
+        opaque.clear();
+        alphaTested.clear();
+        constants.enableAlphaTestedGeometry = 0;
+        constants.recordCount = 4;
+        CullGBufferDrawRecords(records, transforms, constants, opaque, alphaTested);
+        context.Check(opaque.size() == 1 && alphaTested.empty(), "the record count and the alpha-tested toggle limit the draws");
+    }
+}
+
+void TestGBufferDrawCulling(TestContext& context)
+{
+    TestLayout(context);
+    TestVisibility(context);
+    TestDrawLists(context);
+}
@@ -0,0 +1,399 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "ParallelRecording.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace
+{
+    // Records the commands as strings, and counts the commands recorded while closed and the
+    // unbalanced opens and closes
+    class MockCommandList
+    {
+    public:
+        void open()
+        {
+            if (m_open)
+                m_misuses++;
+            m_open = true;
+            m_commands.clear();
+        }
+
+        void close()
+        {
+            if (!m_open)
+                m_misuses++;
+            m_open = false;
+        }
+
+        void Record(std::string command)
+        {
+            if (!m_open)
+                m_misuses++;
+            m_commands.push_back(std::move(command));
+        }
+
+        [[nodiscard]] bool IsOpen() const { return m_open; }
+        [[nodiscard]] uint32_t GetMisuseCount() const { return m_misuses; }
+        [[nodiscard]] const std::vector<std::string>& GetCommands() const { return m_commands; }
+
+    private:
+        bool m_open = false;
+        uint32_t m_misuses = 0;
+        std::vector<std::string> m_commands;
+    };
+
+    using MockHandle = std::shared_ptr<MockCommandList>;
+
+    class MockDrawSink
+    {
+    public:
+        explicit MockDrawSink(MockCommandList& commandList)
+            : m_commandList(commandList)
+        {
+        }
+
+        void SetState(uint32_t state)
+        {
+            m_commandList.Record("SetState " + std::to_string(state));
+        }
+
+        void Draw(const DrawStreamItem& item)
+        {
+            m_commandList.Record("Draw " + std::to_string(item.pushConstants[0]) + " " + std::to_string(item.pushConstants[1]) +
+                " " + std::to_string(item.vertexCount));
+        }
+
+    private:
+        MockCommandList& m_commandList;
+    };
+
+    enum ModelTask : uint32_t
+    {
+        SceneUpdate,
+        GBufferFill,
+        PrepareLights,
+        LocalLightPdfMips,
+        LightSampling,
+        Lighting,
+        ModelTaskCount
+    };
+
+    const char* const c_ModelTaskNames[ModelTaskCount] = {
+        "SceneUpdate", "GBufferFill", "PrepareLights", "LocalLightPdfMips", "LightSampling", "Lighting"
+    };
+
+    // The tasks of the frame as the application schedules them
+    std::vector<AsyncComputeTask> MakeModelTasks()
+    {
+        enum ModelResource : RenderGraphResource
+        {
+            SceneBuffers,
+            EnvironmentPdf,
+            GBuffer,
+            LightData,
+            LocalLightPdf,
+            RisBuffers,
+            LightingOutputs
+        };
+
+        return {
+            { "SceneUpdate", { { SceneBuffers, RenderGraphAccess::UnorderedWrite }, { EnvironmentPdf, RenderGraphAccess::UnorderedWrite } }, false },
+            { "GBufferFill", { { SceneBuffers, RenderGraphAccess::ShaderRead }, { GBuffer, RenderGraphAccess::UnorderedWrite } }, false },
+            { "PrepareLights", { { SceneBuffers, RenderGraphAccess::ShaderRead }, { LightData, RenderGraphAccess::UnorderedWrite }, { LocalLightPdf, RenderGraphAccess::UnorderedWrite } }, true },
+            { "LocalLightPdfMips", { { LocalLightPdf, RenderGraphAccess::UnorderedReadWrite } }, true },
+            { "LightSampling", { { GBuffer, RenderGraphAccess::ShaderRead }, { EnvironmentPdf, RenderGraphAccess::ShaderRead }, { LightData, RenderGraphAccess::ShaderRead },
+                { LocalLightPdf, RenderGraphAccess::ShaderRead }, { RisBuffers, RenderGraphAccess::UnorderedWrite } }, true },
+            { "Lighting", { { GBuffer, RenderGraphAccess::ShaderRead }, { LightData, RenderGraphAccess::ShaderRead }, { RisBuffers, RenderGraphAccess::UnorderedRead },
+                { LightingOutputs, RenderGraphAccess::UnorderedWrite } }, false }
+        };
+    }
+
+    // The recording groups of the frame: the G-buffer and the light preparation record concurrently
+    const std::vector<RecordingGroup> c_ModelGroups = {
+        { "SceneUpdate", {} },
+        { "GBufferFill", { 0 } },
+        { "LightPreparation", { 0 } },
+        { "Lighting", { 1, 2 } }
+    };
+
+    const std::vector<std::vector<uint32_t>> c_ModelGroupTasks = {
+        { SceneUpdate },
+        { GBufferFill },
+        { PrepareLights, LocalLightPdfMips },
+        { LightSampling, Lighting }
+    };
+
+    const std::vector<uint32_t> c_ModelTaskGroups = { 0, 1, 2, 2, 3, 3 };
+
+    // Sorted draws: the opaque state, then the alpha-tested state
+    std::vector<DrawStreamItem> MakeModelDraws(uint32_t drawCount)
+    {
+        std::vector<DrawStreamItem> draws(drawCount);
+        for (uint32_t index = 0; index < drawCount; index++)
+        {
+            DrawStreamItem& draw = draws[index];
+            draw.state = index * 3 >= drawCount * 2 ? 1 : 0;
+            draw.pushConstants[0] = index / 4;
+            draw.pushConstants[1] = index % 4;
+            draw.vertexCount = 3 * (index % 7 + 1);
+        }
+        return draws;
+    }
+
+    struct ModelRecorder
+    {
+        FrameCommandLists<MockHandle> lists;
+        MockHandle finalCommandList = std::make_shared<MockCommandList>();
+        std::vector<MockHandle> workerLists;
+        std::atomic<uint32_t> createdLists{ 0 };
+        std::vector<DrawStreamItem> draws;
+        uint32_t workerCount = 1;
+        bool parallel = false;
+
+        FrameCommandLists<MockHandle>::CreateFunction GetCreateFunction()
+        {
+            return [this](QueueType)
+            {
+                createdLists++;
+                return std::make_shared<MockCommandList>();
+            };
+        }
+
+        void RecordTask(uint32_t task)
+        {
+            const std::string name = c_ModelTaskNames[task];
+            MockHandle commandList = lists.GetCommandList(task);
+            commandList->Record(name + " begin");
+
+            if (task == GBufferFill)
+            {
+                if (parallel)
+                    commandList = RecordDrawsInParallel();
+                else
+                {
+                    MockDrawSink sink(*commandList);
+                    RecordDrawStream(sink, draws, { 0, uint32_t(draws.size()) });
+                }
+            }
+
+            commandList->Record(name + " end");
+        }
+
+        // The workers start in reverse order, their lists are submitted in range order
+        MockHandle RecordDrawsInParallel()
+        {
+            const std::vector<RecordingRange> ranges = SplitRecordingRange(uint32_t(draws.size()), workerCount, 16);
+            while (workerLists.size() < ranges.size())
+                workerLists.push_back(GetCreateFunction()(QueueType::Graphics));
+
+            std::vector<std::thread> workers;
+            for (size_t rangeIndex = ranges.size(); rangeIndex-- > 0; )
+            {
+                workers.emplace_back([this, &ranges, rangeIndex]()
+                {
+                    MockCommandList& workerList = *workerLists[rangeIndex];
+                    workerList.open();
+                    MockDrawSink sink(workerList);
+                    RecordDrawStream(sink, draws, ranges[rangeIndex]);
+                    workerList.close();
+                });
+            }
+            for (std::thread& worker : workers)
+                worker.join();
+
+            const std::vector<MockHandle> recordedLists(workerLists.begin(), workerLists.begin() + ranges.size());
+            return lists.Insert(GBufferFill, recordedLists);
+        }
+
+        std::vector<std::vector<MockHandle>> RecordSerial()
+        {
+            lists.Begin();
+            for (uint32_t task = 0; task < ModelTaskCount; task++)
+                RecordTask(task);
+            return lists.End();
+        }
+
+        // The groups of a wave record on their own threads, started in reverse order
+        std::vector<std::vector<MockHandle>> RecordParallel(const RecordingPlan& plan)
+        {
+            lists.Begin();
+            for (const std::vector<uint32_t>& wave : plan.waves)
+            {
+                std::vector<std::thread> threads;
+                for (size_t index = wave.size(); index-- > 0; )
+                {
+                    const uint32_t group = wave[index];
+                    threads.emplace_back([this, group]()
+                    {
+                        for (uint32_t task : c_ModelGroupTasks[group])
+                            RecordTask(task);
+                    });
+                }
+                for (std::thread& thread : threads)
+                    thread.join();
+            }
+            return lists.End();
+        }
+    };
+
+    // The commands of every batch in submission order, without the state changes that set the current state again
+    std::vector<std::vector<std::string>> GetSubmittedCommands(const std::vector<std::vector<MockHandle>>& batches)
+    {
+        std::vector<std::vector<std::string>> result;
+        for (const std::vector<MockHandle>& batch : batches)
+        {
+            std::vector<std::string>& commands = result.emplace_back();
+            std::string currentState;
+            for (const MockHandle& commandList : batch)
+            {
+                for (const std::string& command : commandList->GetCommands())
+                {
+                    if (command.compare(0, 9, "SetState ") == 0)
+                    {
+                        if (command == currentState)
+                            continue;
+                        currentState = command;
+                    }
+                    commands.push_back(command);
+                }
+            }
+        }
+        return result;
+    }
+
+    bool AreListsClosed(const std::vector<std::vector<MockHandle>>& batches)
+    {
+        for (const std::vector<MockHandle>& batch : batches)
+        {
+            for (const MockHandle& commandList : batch)
+            {
+                if (commandList->IsOpen() || commandList->GetMisuseCount() != 0)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void TestSplitRecordingRange(TestContext& context)
+    {
+        std::vector<RecordingRange> ranges = SplitRecordingRange(1000, 6, 64);
+        bool contiguous = ranges.size() == 6 && ranges.front().begin == 0 && ranges.back().end == 1000;
+        for (size_t index = 1; index < ranges.size(); index++)
+            contiguous = contiguous && ranges[index].begin == ranges[index - 1].end;
+        context.Check(contiguous, "the ranges cover the items in order");
+
+        const auto [smallest, largest] = std::minmax_element(ranges.begin(), ranges.end(),
+            [](const RecordingRange& a, const RecordingRange& b) { return a.GetSize() < b.GetSize(); });
+        context.Check(largest->GetSize() - smallest->GetSize() <= 1, "the range sizes differ by one item at most");
+
+        ranges = SplitRecordingRange(200, 6, 64);
+        context.Check(ranges.size() == 3 && ranges.back().end == 200, "ranges have the minimum size");
+
+        ranges = SplitRecordingRange(10, 6, 64);
+        context.Check(ranges.size() == 1 && ranges[0].begin == 0 && ranges[0].end == 10, "fewer items than the minimum make one range");
+
+        context.Check(SplitRecordingRange(0, 6, 64).empty(), "no items make no ranges");
+    }
+
+    void TestRecordDrawStream(TestContext& context)
+    {
+        std::vector<DrawStreamItem> draws(5);
+        draws[2].state = 1;
+        draws[3].state = 1;
+
+        MockCommandList commandList;
+        commandList.open();
+        MockDrawSink sink(commandList);
+        RecordDrawStream(sink, draws, { 0, 5 });
+        context.Check(commandList.GetCommands().size() == 8, "the state is set before the first draw and when it changes");
+
+        commandList.open();
+        RecordDrawStream(sink, draws, { 3, 5 });
+        context.Check(commandList.GetCommands().size() == 4 && commandList.GetCommands()[0] == "SetState 1",
+            "a range sets the state of its first draw");
+    }
+
+    void TestPlanRecording(TestContext& context)
+    {
+        const RecordingPlan plan = PlanRecording(c_ModelGroups);
+        context.Check(plan.errors.empty() && plan.waves == std::vector<std::vector<uint32_t>>{ { 0 }, { 1, 2 }, { 3 } },
+            "the G-buffer and the light preparation record in the same wave");
+
+        const RecordingPlan invalid = PlanRecording({ { "First", { 1 } }, { "Second", {} } });
+        context.Check(invalid.errors.size() == 1 && invalid.waves.empty(), "a dependency on a later group is an error");
+    }
+
+    void TestFrame(TestContext& context, bool enableComputeQueue)
+    {
+        const AsyncComputeSchedule schedule = ScheduleAsyncCompute(MakeModelTasks(), enableComputeQueue);
+        const RecordingPlan plan = PlanRecording(c_ModelGroups);
+
+        ModelRecorder serial;
+        serial.draws = MakeModelDraws(1000);
+        serial.lists.Configure(schedule, {}, serial.finalCommandList, serial.GetCreateFunction());
+
+        ModelRecorder parallel;
+        parallel.draws = serial.draws;
+        parallel.workerCount = 4;
+        parallel.parallel = true;
+        parallel.lists.Configure(schedule, c_ModelTaskGroups, parallel.finalCommandList, parallel.GetCreateFunction());
+
+        bool sameCommands = true;
+        bool closed = true;
+        bool finalLast = true;
+        uint32_t createdAfterFirstFrame = 0;
+
+        for (uint32_t frame = 0; frame < 8; frame++)
+        {
+            const std::vector<std::vector<MockHandle>> serialBatches = serial.RecordSerial();
+            const std::vector<std::vector<MockHandle>> parallelBatches = parallel.RecordParallel(plan);
+
+            sameCommands = sameCommands && GetSubmittedCommands(serialBatches) == GetSubmittedCommands(parallelBatches);
+            closed = closed && AreListsClosed(serialBatches) && AreListsClosed(parallelBatches);
+            finalLast = finalLast && serialBatches.back().back() == serial.finalCommandList &&
+                parallelBatches.back().back() == parallel.finalCommandList && parallel.lists.GetCommandList(LightSampling) == parallel.finalCommandList;
+
+            if (frame == 0)
+                createdAfterFirstFrame = parallel.createdLists;
+        }
+
+        if (enableComputeQueue)
+        {
+            context.Check(sameCommands, "with the compute queue, every batch submits the commands of the serial recording");
+            context.Check(closed, "with the compute queue, the lists are recorded while open and closed before submission");
+            context.Check(finalLast, "with the compute queue, the light sampling records into the final command list, submitted last");
+            context.Check(parallel.createdLists == createdAfterFirstFrame, "with the compute queue, the lists are reused in the next frames");
+        }
+        else
+        {
+            context.Check(sameCommands, "the parallel recording submits the commands of the serial recording");
+            context.Check(closed, "the lists are recorded while open and closed before submission");
+            context.Check(finalLast, "the light sampling records into the final command list, submitted last");
+            context.Check(parallel.createdLists == createdAfterFirstFrame && serial.createdLists == 0,
+                "the lists are reused in the next frames, one batch needs no list besides the final one");
+        }
+    }
+}
+
+void TestParallelRecording(TestContext& context)
+{
+    TestSplitRecordingRange(context);
+    TestRecordDrawStream(context);
+    TestPlanRecording(context);
+    TestFrame(context, false);
+    TestFrame(context, true);
+}
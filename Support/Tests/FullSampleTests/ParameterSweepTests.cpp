@@ -0,0 +1,169 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "ParameterSweep.h"
+
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    SweepResult MakeResult(double frameTimeMs, double imageError, bool hasImageError = true)
+    {
+        SweepResult result;
+        result.frameTimeMs = frameTimeMs;
+        result.imageError = imageError;
+        result.hasImageError = hasImageError;
+        return result;
+    }
+
+    void TestGrid(TestContext& context)
+    {
+        SweepGrid grid;
+        std::string errorMessage;
+        context.Check(grid.Parse("spatialSamples=1,2,4; checkerboard=0,1", errorMessage), "a valid grid parses");
+        context.Check(grid.GetPointCount() == 6, "the grid has the product of the axis sizes as points");
+
+        const SweepPoint point = grid.GetPoint(3);
+        context.Check(point.values.size() == 2 && point.values[0] == 2.f && point.values[1] == 1.f,
+            "the last axis varies fastest");
+
+        context.Check(!grid.Parse("spatialSamples=1,x", errorMessage) && !errorMessage.empty(), "an invalid value is rejected");
+        context.Check(!grid.Parse("a=1; a=2", errorMessage), "a duplicate axis is rejected");
+        context.Check(grid.GetPointCount() == 6, "a failed parse keeps the previous grid");
+
+        grid.SetAxisStatic("checkerboard", true);
+        const std::vector<SweepPoint> schedule = grid.Schedule();
+        uint32_t staticChanges = 0;
+        for (size_t index = 1; index < schedule.size(); index++)
+            staticChanges += (schedule[index].values[1] != schedule[index - 1].values[1]) ? 1 : 0;
+        context.Check(schedule.size() == 6 && staticChanges == 1, "the schedule changes a static axis as rarely as possible");
+    }
+
+    void TestParetoFront(TestContext& context)
+    {
+        // The 3 ms result is dominated by the 2 ms one, and the 5 ms one has no lower error
+        const std::vector<SweepResult> results = {
+            MakeResult(4.0, 0.1),
+            MakeResult(2.0, 0.5),
+            MakeResult(3.0, 0.6),
+            MakeResult(1.0, 0.9),
+            MakeResult(5.0, 0.1),
+        };
+        context.Check(ComputeParetoFront(results) == std::vector<size_t>({ 3, 1, 0 }),
+            "the front holds the non-dominated results by frame time");
+
+        // A result without an image error has an error of 0 and must not dominate the others
+        std::vector<SweepResult> partial = results;
+        partial.push_back(MakeResult(0.5, 0.0, false));
+        context.Check(ComputeParetoFront(partial) == std::vector<size_t>({ 3, 1, 0 }),
+            "results without an image error stay off the front");
+
+        const std::vector<SweepResult> unmeasured = {
+            MakeResult(3.0, 0.0, false),
+            MakeResult(1.0, 0.0, false),
+            MakeResult(2.0, 0.0, false),
+        };
+        context.Check(ComputeParetoFront(unmeasured) == std::vector<size_t>({ 1 }),
+            "without a reference, the front is the cheapest result");
+
+        context.Check(ComputeParetoFront({}).empty(), "no results have an empty front");
+
+        std::vector<SweepResult> broken = results;
+        broken.push_back(MakeResult(0.5, INFINITY));
+        context.Check(ComputeParetoFront(broken) == std::vector<size_t>({ 3, 1, 0 }),
+            "a result with an infinite error stays off the front");
+
+        SweepResultStore store;
+        for (const SweepResult& result : partial)
+            store.Add(result);
+        context.Check(store.GetParetoFront() == ComputeParetoFront(partial), "the store reports the same front");
+    }
+
+    void TestImageError(TestContext& context)
+    {
+        const float reference[8] = { 1.f, 1.f, 1.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+        const float image[8] = { 1.f, 1.f, 1.f, 5.f, 0.f, 0.f, 0.f, 7.f };
+
+        context.Check(ComputeImageError(image, reference, 2, ImageErrorMetric::RMSE) == 0.0,
+            "identical colors have no error, whatever the alpha");
+
+        const float brighter[8] = { 2.f, 1.f, 1.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+        const double rmse = ComputeImageError(brighter, reference, 2, ImageErrorMetric::RMSE);
+        context.Check(std::abs(rmse - std::sqrt(1.0 / 6.0)) < 1e-9, "RMSE averages over the color channels");
+
+        const double relMse = ComputeImageError(brighter, reference, 2, ImageErrorMetric::RelMSE);
+        context.Check(std::abs(relMse - 1.0 / 1.01 / 6.0) < 1e-9, "RelMSE divides by the squared reference");
+
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        const float blackNan[8] = { 0.f, 0.f, 0.f, 0.f, nan, 0.f, 0.f, 0.f };
+        const float blackInf[8] = { 0.f, 0.f, 0.f, 0.f, 0.f, INFINITY, 0.f, 0.f };
+        const float black[8] = {};
+        const double blackError = ComputeImageError(black, reference, 2, ImageErrorMetric::RelMSE);
+        context.Check(std::isinf(ComputeImageError(blackNan, reference, 2, ImageErrorMetric::RelMSE)),
+            "NaN output has an infinite error");
+        context.Check(std::isinf(ComputeImageError(blackInf, reference, 2, ImageErrorMetric::RMSE)),
+            "infinite output has an infinite error");
+        context.Check(blackError > 0.0 && std::isfinite(blackError), "wrong but finite output has a finite error");
+
+        const float nanReference[8] = { 1.f, 1.f, 1.f, 0.f, nan, 0.f, 0.f, 0.f };
+        context.Check(ComputeImageError(image, nanReference, 2, ImageErrorMetric::RMSE) == 0.0,
+            "non-finite reference channels are skipped");
+    }
+
+    void TestRunner(TestContext& context)
+    {
+        SweepGrid grid;
+        grid.AddAxis("samples", { 1.f, 2.f });
+
+        ParameterSweepSettings settings;
+        settings.warmupFrames = 2;
+        settings.measuredFrames = 3;
+        settings.referenceFrames = 2;
+
+        ParameterSweepRunner runner;
+        runner.Start(grid, settings);
+
+        const std::vector<float> referenceImage = { 1.f, 1.f, 1.f, 1.f };
+        const std::vector<float> nanImage = { std::numeric_limits<float>::quiet_NaN(), 1.f, 1.f, 1.f };
+
+        uint32_t frames = 0;
+        while (runner.IsRunning() && frames < 100)
+        {
+            const SweepFramePlan plan = runner.GetFramePlan();
+            if (plan.captureImage)
+                runner.SubmitImage(plan.pointIndex, plan.pointIndex == 1 ? nanImage : referenceImage);
+            if (plan.collectTimings)
+                runner.SubmitTimings(plan.pointIndex, 1.0 + plan.pointIndex, {});
+
+            runner.AdvanceFrame();
+            frames++;
+        }
+
+        const std::vector<SweepResult>& results = runner.GetResults().GetResults();
+        context.Check(!runner.IsRunning() && results.size() == 2, "the runner completes every point");
+        context.Check(results.size() == 2 && results[0].hasImageError && results[0].imageError == 0.0,
+            "a point that matches the reference has no error");
+        context.Check(results.size() == 2 && std::isinf(results[1].imageError),
+            "a point that renders NaN has an infinite error");
+        context.Check(runner.GetResults().GetParetoFront() == std::vector<size_t>({ 0 }),
+            "a broken point is never on the front");
+    }
+}
+
+void TestParameterSweep(TestContext& context)
+{
+    TestGrid(context);
+    TestParetoFront(context);
+    TestImageError(context);
+    TestRunner(context);
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "PipelineJobList.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Jobs that count their runs; every third one fails, and every other failure throws
+    void AddJobs(PipelineJobList& jobs, std::vector<std::atomic<uint32_t>>& runCounts)
+    {
+        for (uint32_t index = 0; index < runCounts.size(); index++)
+        {
+            runCounts[index] = 0;
+            jobs.Add("Pass" + std::to_string(index), [&runCounts, index]()
+            {
+                runCounts[index]++;
+                if (index % 3 != 2)
+                    return true;
+                if (index % 6 == 5)
+                    throw std::runtime_error("compile error");
+                return false;
+            });
+        }
+    }
+
+    bool RanOnce(const std::vector<std::atomic<uint32_t>>& runCounts, uint32_t expected)
+    {
+        for (const std::atomic<uint32_t>& count : runCounts)
+        {
+            if (count != expected)
+                return false;
+        }
+        return true;
+    }
+
+    void TestRun(TestContext& context)
+    {
+        std::vector<std::atomic<uint32_t>> runCounts(40);
+        PipelineJobList jobs;
+        AddJobs(jobs, runCounts);
+        context.Check(jobs.GetJobCount() == 40 && jobs.GetJobName(7) == "Pass7", "the jobs are kept in the order they were added");
+
+        const bool serialSucceeded = jobs.Run(SerialPipelineJobFor);
+        const std::vector<std::string> serialFailures = jobs.GetFailures();
+        context.Check(!serialSucceeded && RanOnce(runCounts, 1), "a serial run runs every job once");
+
+        context.Check(serialFailures.size() == 13 && serialFailures[0] == "Pass2" && serialFailures[1] == "Pass5: compile error",
+            "the failures are reported in job order, with the message of a thrown exception");
+
+        const bool parallelSucceeded = jobs.Run(RunParallelTasks);
+        context.Check(!parallelSucceeded && RanOnce(runCounts, 2) && jobs.GetFailures() == serialFailures,
+            "a parallel run reports the same failures as a serial one");
+        context.Check(jobs.GetResults().size() == 40 && jobs.GetTotalJobTimeMs() >= 0.0 && jobs.GetWallTimeMs() >= 0.0,
+            "every job has a result");
+
+        PipelineJobList succeeding;
+        succeeding.Add("Pass", []() { return true; });
+        context.Check(succeeding.Run(RunParallelTasks) && succeeding.GetFailures().empty(), "a list without failures succeeds");
+
+        PipelineJobList throwingUnknown;
+        throwingUnknown.Add("Pass", []() -> bool { throw 1; });
+        context.Check(!throwingUnknown.Run(SerialPipelineJobFor) && throwingUnknown.GetFailures()[0] == "Pass: unknown exception",
+            "a job that throws anything fails");
+
+        jobs.Clear();
+        context.Check(jobs.GetJobCount() == 0 && jobs.GetResults().empty() && jobs.Run(SerialPipelineJobFor),
+            "an empty list succeeds");
+    }
+
+    void TestRunAsync(TestContext& context)
+    {
+        std::vector<std::atomic<uint32_t>> runCounts(20);
+        PipelineJobList jobs;
+        AddJobs(jobs, runCounts);
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool finished = false;
+        bool succeeded = true;
+        jobs.RunAsync(LaunchParallelTasks, [&](bool result)
+        {
+            std::lock_guard lock(mutex);
+            succeeded = result;
+            finished = true;
+            condition.notify_one();
+        });
+
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [&finished]() { return finished; });
+        context.Check(!succeeded && RanOnce(runCounts, 1) && jobs.GetFailures().size() == 6,
+            "a background run calls done with the outcome after every job ran");
+    }
+}
+
+void TestPipelineJobList(TestContext& context)
+{
+    TestRun(context);
+    TestRunAsync(context);
+
+    const PipelineJobBenchmarkResult result = BenchmarkPipelineJobs(14, 1.0, 5, RunParallelTasks);
+    context.Check(result.resultsMatch && result.jobCount == 14, "the mock jobs give the same results serially and in parallel");
+}
+
+void RunPipelineCreationBenchmark()
+{
+    // 14 jobs like LightingPasses, then a larger permutation set, with a few failures mixed in
+    for (uint32_t jobCount : { 14u, 64u })
+    {
+        const PipelineJobBenchmarkResult result = BenchmarkPipelineJobs(jobCount, 20.0, 5, RunParallelTasks);
+        printf("Pipeline creation, %u jobs of %.0f ms: serial %.1f ms, parallel %.1f ms, results %s\n",
+            result.jobCount, result.compileLatencyMs, result.serialMs, result.parallelMs, result.resultsMatch ? "match" : "DIFFER");
+    }
+}
@@ -0,0 +1,143 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "RayCountHeatmap.h"
+
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+    // Counts rays the way RAB_Buffers.hlsli does: the tile of a pixel is its position divided by
+    // the tile size, and the tiles are stored in rows of gridWidth
+    void TraceRays(RayCountTileGrid& grid, uint32_t pixelX, uint32_t pixelY, uint32_t traced, uint32_t hits)
+    {
+        const uint32_t tileIndex = (pixelY / grid.tileSize) * grid.gridWidth + pixelX / grid.tileSize;
+        grid.counters[tileIndex * 2] += traced;
+        grid.counters[tileIndex * 2 + 1] += hits;
+    }
+
+    void TestTiling(TestContext& context)
+    {
+        RayCountTileGrid grid;
+        grid.Resize(20, 10, 8);
+        context.Check(grid.gridWidth == 3 && grid.gridHeight == 2 && grid.GetTileCount() == 6,
+            "the grid covers partial tiles on the right and bottom edges");
+        context.Check(grid.counters.size() == 12, "every tile has a traced and a hit counter");
+
+        context.Check(grid.GetTilePixelCount(0, 0) == 64, "an interior tile is full");
+        context.Check(grid.GetTilePixelCount(2, 0) == 4 * 8, "the right tile is cut to the image width");
+        context.Check(grid.GetTilePixelCount(2, 1) == 4 * 2, "the corner tile is cut in both directions");
+
+        uint32_t pixels = 0;
+        for (uint32_t y = 0; y < grid.gridHeight; y++)
+        {
+            for (uint32_t x = 0; x < grid.gridWidth; x++)
+                pixels += grid.GetTilePixelCount(x, y);
+        }
+        context.Check(pixels == 20 * 10, "the tiles cover every pixel once");
+
+        grid.Resize(16, 16, 0);
+        context.Check(grid.tileSize == 1 && grid.GetTileCount() == 256, "a zero tile size is clamped to one pixel");
+    }
+
+    void TestAggregation(TestContext& context)
+    {
+        RayCountTileGrid grid;
+        grid.Resize(20, 10, 8);
+
+        // Two frames of one ray per pixel, and a hot corner with 4 more rays per pixel
+        for (uint32_t frame = 0; frame < 2; frame++)
+        {
+            for (uint32_t y = 0; y < 10; y++)
+            {
+                for (uint32_t x = 0; x < 20; x++)
+                {
+                    const bool corner = x >= 16 && y >= 8;
+                    TraceRays(grid, x, y, corner ? 5 : 1, corner ? 2 : 1);
+                }
+            }
+            grid.frameCount++;
+        }
+
+        context.Check(grid.GetTraced(2, 1) == 8 * 5 * 2 && grid.GetHits(2, 1) == 8 * 2 * 2,
+            "the counters of a pixel land in its tile");
+        context.Check(grid.GetRaysPerPixel(0, 0) == 1.0, "rays per pixel are averaged over the frames");
+        context.Check(grid.GetRaysPerPixel(2, 1) == 5.0, "a partial tile is normalized by its own pixel count");
+
+        const RayCountSummary summary = SummarizeRayCounts(grid);
+        context.Check(summary.traced == (192 * 1 + 8 * 5) * 2 && summary.hits == (192 + 8 * 2) * 2,
+            "the summary adds up every tile");
+        context.Check(std::abs(summary.meanRaysPerPixel - 232.0 / 200.0) < 1e-12, "the mean is over the image pixels");
+        context.Check(summary.maxRaysPerPixel == 5.0, "the maximum is the hottest tile");
+
+        const std::vector<RayCountTile> hottest = FindHottestTiles(grid, 2);
+        context.Check(hottest.size() == 2 && hottest[0].x == 2 && hottest[0].y == 1, "the hottest tile comes first");
+        context.Check(hottest.size() == 2 && hottest[1].x == 0 && hottest[1].y == 0, "equal tiles are ordered by position");
+        context.Check(FindHottestTiles(grid, 100).size() == 6, "no more tiles than the grid are returned");
+
+        const RayCountHistogram histogram = BuildRayCountHistogram(grid, 5);
+        context.Check(histogram.binWidth == 1.0 && histogram.bins[1] == 5 && histogram.bins[4] == 1,
+            "the histogram bins the tiles by rays per pixel, the maximum in the last bin");
+
+        std::stringstream csv;
+        WriteRayCountTilesCsv(csv, grid);
+        std::string line;
+        uint32_t lines = 0;
+        while (std::getline(csv, line))
+            lines++;
+        context.Check(lines == 7, "the tile CSV has a header and a line per tile");
+
+        grid.Clear();
+        context.Check(SummarizeRayCounts(grid).traced == 0 && grid.frameCount == 0, "clearing resets the counters");
+    }
+
+    void TestHeatmap(TestContext& context)
+    {
+        RayCountTileGrid grid;
+        grid.Resize(20, 10, 8);
+        TraceRays(grid, 19, 9, 80, 0);
+        grid.frameCount = 1;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        const std::vector<uint8_t> tiles = BuildRayCountHeatmap(grid, 0.0, false, width, height);
+        context.Check(width == 3 && height == 2 && tiles.size() == 18, "the tile heatmap has one pixel per tile");
+        context.Check(tiles[0] == 0 && tiles[1] == 0 && tiles[2] == 0, "a tile without rays is black");
+        context.Check(tiles[15] == 255 && tiles[16] == 0 && tiles[17] == 0, "the hottest tile is red");
+
+        const std::vector<uint8_t> image = BuildRayCountHeatmap(grid, 0.0, true, width, height);
+        context.Check(width == 20 && height == 10 && image.size() == 600, "the full heatmap has the image size");
+
+        bool matches = true;
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const size_t tile = (size_t(y / 8) * 3 + x / 8) * 3;
+                const size_t pixel = (size_t(y) * width + x) * 3;
+                matches = matches && image[pixel] == tiles[tile] && image[pixel + 2] == tiles[tile + 2];
+            }
+        }
+        context.Check(matches, "every pixel of the full heatmap has the color of its tile");
+
+        const std::vector<uint8_t> clamped = BuildRayCountHeatmap(grid, 1000.0, false, width, height);
+        context.Check(clamped[15] == 0 && clamped[17] > 0, "a larger range makes the tile colder");
+    }
+}
+
+void TestRayCountHeatmap(TestContext& context)
+{
+    TestTiling(context);
+    TestAggregation(context);
+    TestHeatmap(context);
+}
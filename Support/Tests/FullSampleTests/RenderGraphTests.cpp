@@ -0,0 +1,240 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+namespace
+{
+    std::vector<RenderGraphPass> GetPassOrder(const RenderGraphSchedule& schedule)
+    {
+        std::vector<RenderGraphPass> order;
+        for (const RenderGraphStep& step : schedule.steps)
+            order.push_back(step.pass);
+        return order;
+    }
+
+    bool HasBarrier(const RenderGraphStep& step, RenderGraphResource resource, RenderGraphBarrierType type)
+    {
+        return std::any_of(step.barriers.begin(), step.barriers.end(),
+            [resource, type](const RenderGraphBarrier& barrier) { return barrier.resource == resource && barrier.type == type; });
+    }
+
+    // A barrier on every resource a pass accesses through an unordered access view,
+    // what issuing barriers without knowing the dependencies takes
+    size_t GetConservativeBarrierCount(const RenderGraph& graph, const std::vector<std::vector<RenderGraphUse>>& passUses, const RenderGraphSchedule& schedule)
+    {
+        size_t count = 0;
+        for (const RenderGraphStep& step : schedule.steps)
+        {
+            for (const RenderGraphUse& use : passUses[step.pass])
+            {
+                if (use.access != RenderGraphAccess::ShaderRead && use.resource < graph.GetResourceCount())
+                    count++;
+            }
+        }
+        return count;
+    }
+
+    void TestDependencies(TestContext& context)
+    {
+        RenderGraph graph;
+        const RenderGraphResource buffer = graph.AddResource("Buffer");
+        graph.AddPass("Write", { { buffer, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("Read", { { buffer, RenderGraphAccess::UnorderedRead } }, true);
+
+        RenderGraphSchedule schedule = graph.Compile();
+        context.Check(schedule.errors.empty() && GetPassOrder(schedule) == std::vector<RenderGraphPass>{ 0, 1 }, "a reader runs after its writer");
+        context.Check(schedule.steps.size() == 2 && schedule.steps[0].barriers.empty() &&
+            schedule.steps[1].barriers.size() == 1 && HasBarrier(schedule.steps[1], buffer, RenderGraphBarrierType::Uav),
+            "a read after a write needs a UAV barrier, the first use needs none");
+
+        graph.Clear();
+        const RenderGraphResource shared = graph.AddResource("Shared", RenderGraphAccess::None, true);
+        graph.AddPass("Write", { { shared, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("ReadA", { { shared, RenderGraphAccess::UnorderedRead } }, true);
+        graph.AddPass("ReadB", { { shared, RenderGraphAccess::UnorderedRead } }, true);
+        graph.AddPass("Overwrite", { { shared, RenderGraphAccess::UnorderedWrite } });
+
+        schedule = graph.Compile();
+        context.Check(GetPassOrder(schedule) == std::vector<RenderGraphPass>{ 0, 1, 2, 3 }, "a writer runs after the readers of the previous contents");
+        context.Check(schedule.GetBarrierCount() == 2 && schedule.steps[2].barriers.empty() &&
+            HasBarrier(schedule.steps[3], shared, RenderGraphBarrierType::Uav),
+            "reads need no barrier between them, a write after reads needs one");
+
+        graph.Clear();
+        const RenderGraphResource texture = graph.AddResource("Texture", RenderGraphAccess::None, true);
+        graph.AddPass("Write", { { texture, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("SampleA", { { texture, RenderGraphAccess::ShaderRead } }, true);
+        graph.AddPass("SampleB", { { texture, RenderGraphAccess::ShaderRead } }, true);
+        graph.AddPass("Update", { { texture, RenderGraphAccess::UnorderedReadWrite } });
+
+        schedule = graph.Compile();
+        const bool transitions = schedule.steps.size() == 4 &&
+            schedule.steps[1].barriers.size() == 1 && HasBarrier(schedule.steps[1], texture, RenderGraphBarrierType::Transition) &&
+            schedule.steps[1].barriers[0].before == RenderGraphState::UnorderedAccess &&
+            schedule.steps[1].barriers[0].after == RenderGraphState::ShaderResource &&
+            schedule.steps[2].barriers.empty() &&
+            schedule.steps[3].barriers.size() == 1 && schedule.steps[3].barriers[0].after == RenderGraphState::UnorderedAccess;
+        context.Check(transitions, "changes between shader resource and unordered access take one transition each");
+    }
+
+    void TestImportedState(TestContext& context)
+    {
+        RenderGraph graph;
+        const RenderGraphResource written = graph.AddResource("Written", RenderGraphAccess::UnorderedWrite);
+        const RenderGraphResource read = graph.AddResource("Read", RenderGraphAccess::UnorderedRead);
+        const RenderGraphResource sampled = graph.AddResource("Sampled", RenderGraphAccess::ShaderRead);
+        const RenderGraphResource unknown = graph.AddResource("Unknown");
+        graph.AddPass("Pass", {
+            { written, RenderGraphAccess::UnorderedRead },
+            { read, RenderGraphAccess::UnorderedRead },
+            { sampled, RenderGraphAccess::UnorderedWrite },
+            { unknown, RenderGraphAccess::UnorderedReadWrite } }, true);
+
+        const RenderGraphSchedule schedule = graph.Compile();
+        const bool barriers = schedule.steps.size() == 1 && schedule.steps[0].barriers.size() == 2 &&
+            HasBarrier(schedule.steps[0], written, RenderGraphBarrierType::Uav) &&
+            HasBarrier(schedule.steps[0], sampled, RenderGraphBarrierType::Transition);
+        context.Check(barriers, "barriers are placed against the accesses before the graph");
+    }
+
+    void TestCulling(TestContext& context)
+    {
+        RenderGraph graph;
+        const RenderGraphResource temporary = graph.AddResource("Temporary");
+        const RenderGraphResource unused = graph.AddResource("Unused");
+        const RenderGraphResource output = graph.AddResource("Output", RenderGraphAccess::None, true);
+        graph.AddPass("Producer", { { temporary, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("Consumer", { { temporary, RenderGraphAccess::ShaderRead }, { output, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("Dead", { { temporary, RenderGraphAccess::ShaderRead }, { unused, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("Logger", { { unused, RenderGraphAccess::UnorderedRead } }, true);
+
+        RenderGraphSchedule schedule = graph.Compile();
+        context.Check(schedule.culledPasses.empty() && schedule.steps.size() == 4, "passes that feed a side effect are live");
+
+        graph.Clear();
+        const RenderGraphResource overwritten = graph.AddResource("Overwritten", RenderGraphAccess::None, true);
+        const RenderGraphResource accumulated = graph.AddResource("Accumulated", RenderGraphAccess::None, true);
+        const RenderGraphResource debug = graph.AddResource("Debug");
+        graph.AddPass("Clear", { { overwritten, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("Fill", { { overwritten, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("Base", { { accumulated, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("Add", { { accumulated, RenderGraphAccess::UnorderedReadWrite } });
+        graph.AddPass("Visualize", { { accumulated, RenderGraphAccess::ShaderRead }, { debug, RenderGraphAccess::UnorderedWrite } });
+
+        schedule = graph.Compile();
+        context.Check(schedule.culledPasses == std::vector<RenderGraphPass>{ 0, 4 }, "overwritten and unread outputs are culled");
+        context.Check(GetPassOrder(schedule) == std::vector<RenderGraphPass>{ 1, 2, 3 }, "culled passes are not scheduled");
+
+        graph.ExportResource(debug);
+        schedule = graph.Compile();
+        context.Check(schedule.culledPasses == std::vector<RenderGraphPass>{ 0 }, "exporting a resource keeps its writer");
+    }
+
+    void TestScheduling(TestContext& context)
+    {
+        RenderGraph graph;
+        const RenderGraphResource first = graph.AddResource("First", RenderGraphAccess::None, true);
+        const RenderGraphResource second = graph.AddResource("Second", RenderGraphAccess::None, true);
+        graph.AddPass("WriteFirst", { { first, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("ReadFirst", { { first, RenderGraphAccess::UnorderedRead } }, true);
+        graph.AddPass("WriteSecond", { { second, RenderGraphAccess::UnorderedWrite } });
+        graph.AddPass("ReadSecond", { { second, RenderGraphAccess::UnorderedRead } }, true);
+
+        const RenderGraphSchedule schedule = graph.Compile();
+        context.Check(GetPassOrder(schedule) == std::vector<RenderGraphPass>{ 0, 2, 1, 3 }, "passes that need no barrier run first");
+        context.Check(schedule.GetBarrierCount() == 2 && schedule.GetBarrierBatchCount() == 1 &&
+            HasBarrier(schedule.steps[2], second, RenderGraphBarrierType::Uav),
+            "the UAV barriers of the ready passes are batched");
+    }
+
+    void TestErrors(TestContext& context)
+    {
+        RenderGraph graph;
+        const RenderGraphResource texture = graph.AddResource("Texture");
+        graph.AddPass("Aliased", { { texture, RenderGraphAccess::ShaderRead }, { texture, RenderGraphAccess::UnorderedWrite } }, true);
+
+        RenderGraphSchedule schedule = graph.Compile();
+        context.Check(schedule.errors.size() == 1 && schedule.steps.empty(), "a resource used through both view types is an error");
+
+        graph.Clear();
+        const RenderGraphResource buffer = graph.AddResource("Buffer");
+        graph.AddPass("Merged", { { buffer, RenderGraphAccess::UnorderedRead }, { buffer, RenderGraphAccess::UnorderedWrite } }, true);
+        graph.AddPass("Undeclared", { { buffer + 1, RenderGraphAccess::UnorderedRead } }, true);
+
+        schedule = graph.Compile();
+        context.Check(schedule.errors.size() == 1 && schedule.steps.empty(), "an undeclared resource is an error");
+    }
+
+    // The direct lighting passes with temporal and spatial resampling, as LightingPasses declares them
+    void TestLightingPasses(TestContext& context, bool enableGradients)
+    {
+        RenderGraph graph;
+        const RenderGraphResource gbuffer = graph.AddResource("GBuffer", RenderGraphAccess::ShaderRead);
+        const RenderGraphResource ris = graph.AddResource("RisBuffer", RenderGraphAccess::UnorderedWrite);
+        const RenderGraphResource reservoirs = graph.AddResource("LightReservoirs", RenderGraphAccess::None, true);
+        const RenderGraphResource samplePositions = graph.AddResource("TemporalSamplePositions", RenderGraphAccess::None, true);
+        const RenderGraphResource diffuse = graph.AddResource("DiffuseLighting", RenderGraphAccess::None, true);
+        const RenderGraphResource specular = graph.AddResource("SpecularLighting", RenderGraphAccess::None, true);
+        const RenderGraphResource luminance = graph.AddResource("RestirLuminance", RenderGraphAccess::None, true);
+        const RenderGraphResource gradients = graph.AddResource("Gradients", RenderGraphAccess::UnorderedWrite, enableGradients);
+
+        const std::vector<std::vector<RenderGraphUse>> passUses = {
+            { { gbuffer, RenderGraphAccess::ShaderRead }, { ris, RenderGraphAccess::UnorderedRead }, { reservoirs, RenderGraphAccess::UnorderedReadWrite } },
+            { { gbuffer, RenderGraphAccess::ShaderRead }, { reservoirs, RenderGraphAccess::UnorderedReadWrite }, { samplePositions, RenderGraphAccess::UnorderedWrite } },
+            { { gbuffer, RenderGraphAccess::ShaderRead }, { reservoirs, RenderGraphAccess::UnorderedReadWrite } },
+            { { gbuffer, RenderGraphAccess::ShaderRead }, { reservoirs, RenderGraphAccess::UnorderedReadWrite },
+              { diffuse, RenderGraphAccess::UnorderedReadWrite }, { specular, RenderGraphAccess::UnorderedReadWrite }, { luminance, RenderGraphAccess::UnorderedWrite } },
+            { { gbuffer, RenderGraphAccess::ShaderRead }, { reservoirs, RenderGraphAccess::UnorderedRead },
+              { samplePositions, RenderGraphAccess::UnorderedRead }, { gradients, RenderGraphAccess::UnorderedWrite } }
+        };
+
+        graph.AddPass("DIGenerateInitialSamples", passUses[0]);
+        graph.AddPass("DITemporalResampling", passUses[1]);
+        graph.AddPass("DISpatialResampling", passUses[2]);
+        graph.AddPass("DIShadeSamples", passUses[3]);
+        const RenderGraphPass gradientPass = graph.AddPass("DIGradients", passUses[4]);
+
+        const RenderGraphSchedule schedule = graph.Compile();
+        const size_t conservativeBarriers = GetConservativeBarrierCount(graph, passUses, schedule);
+
+        if (enableGradients)
+        {
+            context.Check(schedule.culledPasses.empty() && GetPassOrder(schedule) == std::vector<RenderGraphPass>{ 0, 1, 2, 3, 4 },
+                "the lighting passes run in order with gradients");
+            context.Check(schedule.GetBarrierCount() == 7 && schedule.GetBarrierBatchCount() == 5 && schedule.steps[4].barriers.size() == 3,
+                "the gradient pass waits for the reservoirs, sample positions and gradient clear in one batch");
+        }
+        else
+        {
+            context.Check(schedule.culledPasses == std::vector<RenderGraphPass>{ gradientPass } && GetPassOrder(schedule) == std::vector<RenderGraphPass>{ 0, 1, 2, 3 },
+                "the gradient pass is culled when the gradients are not used");
+            context.Check(schedule.GetBarrierCount() == 4 && HasBarrier(schedule.steps[0], ris, RenderGraphBarrierType::Uav),
+                "the resampling passes wait for the presampled RIS buffer and each other's reservoirs");
+        }
+
+        context.Check(schedule.GetBarrierCount() < conservativeBarriers, "the lighting passes need fewer barriers than conservative placement");
+    }
+}
+
+void TestRenderGraph(TestContext& context)
+{
+    TestDependencies(context);
+    TestImportedState(context);
+    TestCulling(context);
+    TestScheduling(context);
+    TestErrors(context);
+    TestLightingPasses(context, false);
+    TestLightingPasses(context, true);
+}
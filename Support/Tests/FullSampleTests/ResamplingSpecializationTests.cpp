@@ -0,0 +1,160 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "ResamplingSpecialization.h"
+#include "ShaderConfig.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+
+namespace
+{
+    std::string GetMacroValue(const std::vector<ShaderPermutationMacro>& macros, const char* name)
+    {
+        for (const ShaderPermutationMacro& macro : macros)
+        {
+            if (macro.name == name)
+                return macro.definition;
+        }
+        return "<none>";
+    }
+
+    void TestMapping(TestContext& context)
+    {
+        ResamplingStaticSettings settings;
+        settings.diTemporalBiasCorrection = 3;
+        settings.diBoilingFilter = 1;
+        settings.diSpatialBiasCorrection = 2;
+
+        const std::vector<ShaderPermutationMacro> temporal = GetResamplingSpecializationMacros(ResamplingShader::DITemporalResampling, settings);
+        context.Check(temporal.size() == 3, "a specialization has one macro per setting its shader reads");
+        context.Check(GetMacroValue(temporal, "SPECIALIZE_DI_TEMPORAL_BIAS_CORRECTION") == "3" &&
+            GetMacroValue(temporal, "SPECIALIZE_DI_BOILING_FILTER") == "1" &&
+            GetMacroValue(temporal, "SPECIALIZE_DI_DISCARD_INVISIBLE_SAMPLES") == "0",
+            "the macro values are the numeric setting values");
+        context.Check(std::is_sorted(temporal.begin(), temporal.end(), [](const ShaderPermutationMacro& a, const ShaderPermutationMacro& b) { return a.name < b.name; }),
+            "the macros are sorted by name");
+
+        const std::vector<ShaderPermutationMacro> initial = GetResamplingSpecializationMacros(ResamplingShader::DIGenerateInitialSamples, settings);
+        context.Check(GetMacroValue(initial, "RTXDI_REGIR_MODE") == "RTXDI_REGIR_DISABLED" && initial.size() == 2,
+            "the specialization keeps the macros of the generic permutation");
+
+        ResamplingStaticSettings unsupported;
+        unsupported.diTemporalBiasCorrection = 7;
+        context.Check(GetResamplingSpecializationMacros(ResamplingShader::DITemporalResampling, unsupported).empty() &&
+            GetResamplingSpecializationKey(ResamplingShader::DITemporalResampling, unsupported).empty(),
+            "values without a compiled permutation select the generic kernel");
+        context.Check(!GetResamplingSpecializationKey(ResamplingShader::DISpatialResampling, unsupported).empty(),
+            "unsupported values of settings a shader doesn't read don't matter");
+
+        ResamplingStaticSettings pairwiseGI;
+        pairwiseGI.giTemporalBiasCorrection = 2;
+        context.Check(GetResamplingSpecializationKey(ResamplingShader::GITemporalResampling, pairwiseGI).empty(), "GI has no pairwise specialization");
+    }
+
+    void TestKeys(TestContext& context)
+    {
+        ResamplingStaticSettings settings;
+        const std::string key = GetResamplingSpecializationKey(ResamplingShader::DISpatialResampling, settings);
+        context.Check(key == GetResamplingSpecializationKey(ResamplingShader::DISpatialResampling, settings), "keys are deterministic");
+
+        // The canonical form of the shader cache key, changing it invalidates the cached permutations
+        context.Check(key == MakeShaderPermutationKey("app/LightingPasses/DI/SpatialResampling.hlsl", "main",
+            { { "USE_RAY_QUERY", "1" }, { "SPECIALIZE_DI_SPATIAL_BIAS_CORRECTION", "0" } }, 0).GetCanonicalString(),
+            "the key is the shader cache key of the compute permutation");
+        context.Check(key == "P44:app/LightingPasses/DI/SpatialResampling.hlslE4:mainM37:SPECIALIZE_DI_SPATIAL_BIAS_CORRECTION=1:0M13:USE_RAY_QUERY=1:1B0000000000000000",
+            "the key is stable across builds");
+
+        ResamplingStaticSettings unrelated = settings;
+        unrelated.diTemporalBiasCorrection = 3;
+        unrelated.diBoilingFilter = 1;
+        unrelated.giSpatialBiasCorrection = 1;
+        context.Check(GetResamplingSpecializationKey(ResamplingShader::DISpatialResampling, unrelated) == key,
+            "settings the shader doesn't read don't change its key");
+
+        ResamplingStaticSettings related = settings;
+        related.diSpatialBiasCorrection = 1;
+        context.Check(GetResamplingSpecializationKey(ResamplingShader::DISpatialResampling, related) != key,
+            "settings the shader reads change its key");
+
+        context.Check(GetResamplingSpecializationKey(ResamplingShader::GITemporalResampling, settings) !=
+            GetResamplingSpecializationKey(ResamplingShader::GIFusedResampling, settings),
+            "shaders with the same settings have different keys");
+
+        bool allDistinct = true;
+        std::unordered_set<std::string> keys;
+        size_t specializationCount = 0;
+        for (uint32_t shader = 0; shader < uint32_t(ResamplingShader::Count); shader++)
+        {
+            for (const ResamplingStaticSettings& combination : EnumerateResamplingSpecializations(ResamplingShader(shader)))
+            {
+                const std::string combinationKey = GetResamplingSpecializationKey(ResamplingShader(shader), combination);
+                allDistinct &= !combinationKey.empty() && keys.insert(combinationKey).second;
+                specializationCount++;
+            }
+        }
+        context.Check(allDistinct && keys.size() == specializationCount, "every specialization has its own key");
+    }
+
+    void TestConfig(TestContext& context)
+    {
+        std::ifstream file(std::filesystem::path(FULL_SAMPLE_SHADER_DIR) / "Shaders.cfg");
+        const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        context.Check(!text.empty(), "Shaders.cfg can be read");
+
+        const ShaderConfig config = ParseShaderConfig(text);
+        context.Check(config.errors.empty(), "Shaders.cfg parses");
+
+        std::unordered_set<std::string> compiled;
+        for (const ShaderConfigEntry& entry : config.entries)
+        {
+            for (const ShaderConfigPermutation& permutation : ExpandShaderConfigEntry(entry))
+                compiled.insert(permutation.GetKey());
+        }
+
+        bool allSpecializationsCompiled = true;
+        bool allGenericCompiled = true;
+        for (uint32_t shader = 0; shader < uint32_t(ResamplingShader::Count); shader++)
+        {
+            // Shaders.cfg names the sources relative to the application shader directory
+            const std::string source = std::string(GetResamplingShaderName(ResamplingShader(shader))).substr(4);
+
+            for (const ResamplingStaticSettings& combination : EnumerateResamplingSpecializations(ResamplingShader(shader)))
+            {
+                std::vector<ShaderPermutationMacro> macros = GetResamplingSpecializationMacros(ResamplingShader(shader), combination);
+                macros.push_back({ "USE_RAY_QUERY", "1" });
+                allSpecializationsCompiled &= compiled.count(MakeShaderConfigPermutation(source, "cs", "main", std::move(macros)).GetKey()) != 0;
+            }
+
+            // The generic permutation has the macros of a specialization that are not settings
+            std::vector<ShaderPermutationMacro> genericMacros = { { "USE_RAY_QUERY", "1" } };
+            for (const ShaderPermutationMacro& macro : GetResamplingSpecializationMacros(ResamplingShader(shader), ResamplingStaticSettings()))
+            {
+                if (macro.name.compare(0, 11, "SPECIALIZE_") != 0)
+                    genericMacros.push_back(macro);
+            }
+            allGenericCompiled &= compiled.count(MakeShaderConfigPermutation(source, "cs", "main", std::move(genericMacros)).GetKey()) != 0;
+        }
+
+        context.Check(allSpecializationsCompiled, "Shaders.cfg compiles every specialized permutation");
+        context.Check(allGenericCompiled, "Shaders.cfg compiles the generic permutations");
+    }
+}
+
+void TestResamplingSpecialization(TestContext& context)
+{
+    TestMapping(context);
+    TestKeys(context);
+    TestConfig(context);
+}
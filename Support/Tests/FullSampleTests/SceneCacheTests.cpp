@@ -0,0 +1,295 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "SceneCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    constexpr uint64_t c_SourceHash = 0x1234567890abcdefull;
+
+    // Byte offsets in the file, see FileHeader and FileSection in SceneCache.cpp
+    constexpr size_t c_HeaderSize = 32;
+    constexpr size_t c_SectionSize = 24;
+    constexpr size_t c_VersionOffset = 4;
+    constexpr size_t c_SectionOffsetOffset = 8;
+    constexpr size_t c_SectionSizeOffset = 16;
+
+    std::vector<uint8_t> ReadBytes(const std::filesystem::path& path)
+    {
+        std::ifstream stream(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    void WriteBytes(const std::filesystem::path& path, const std::vector<uint8_t>& bytes)
+    {
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+    }
+
+    template<typename T>
+    void Poke(std::vector<uint8_t>& bytes, size_t offset, T value)
+    {
+        memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    template<typename T>
+    T Peek(const std::vector<uint8_t>& bytes, size_t offset)
+    {
+        T value;
+        memcpy(&value, bytes.data() + offset, sizeof(value));
+        return value;
+    }
+
+    size_t GetSectionEntry(SceneCacheSectionId id)
+    {
+        return c_HeaderSize + c_SectionSize * size_t(id);
+    }
+
+    // A scene with a node hierarchy, a mesh instance and its vertex data
+    struct TestScene
+    {
+        SceneCacheStringTable strings;
+        std::vector<SceneCacheNode> nodes;
+        std::vector<SceneCacheBufferGroup> bufferGroups;
+        std::vector<SceneCacheMesh> meshes;
+        std::vector<uint8_t> vertexData;
+        std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+        std::vector<float> positions = { 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f, 1.f, 1.f, 0.f };
+
+        TestScene()
+        {
+            SceneCacheNode& root = nodes.emplace_back();
+            root.name = strings.Add("root");
+            root.translation[1] = 2.5;
+
+            SceneCacheNode& child = nodes.emplace_back();
+            child.name = strings.Add("quad");
+            child.parent = 0;
+            child.leafType = SceneCacheLeafType::MeshInstance;
+            child.leafIndex = 0;
+            child.scaling[0] = 3.0;
+
+            SceneCacheBufferGroup& group = bufferGroups.emplace_back();
+            group.indexData = AppendSceneCacheData(vertexData, indices.data(), indices.size() * sizeof(uint32_t));
+            group.positionData = AppendSceneCacheData(vertexData, positions.data(), positions.size() * sizeof(float));
+            group.indexCount = uint32_t(indices.size());
+            group.vertexCount = uint32_t(positions.size() / 3);
+
+            SceneCacheMesh& mesh = meshes.emplace_back();
+            mesh.name = strings.Add("quad");
+            mesh.bufferGroup = 0;
+            mesh.totalIndices = group.indexCount;
+            mesh.totalVertices = group.vertexCount;
+            mesh.boundsMax[0] = 1.f;
+            mesh.boundsMax[1] = 1.f;
+        }
+
+        bool Write(const std::filesystem::path& path) const
+        {
+            SceneCacheWriter writer;
+            writer.AddSection(SceneCacheSectionId::Strings, strings.GetData());
+            writer.AddSection(SceneCacheSectionId::Nodes, nodes);
+            writer.AddSection(SceneCacheSectionId::BufferGroups, bufferGroups);
+            writer.AddSection(SceneCacheSectionId::Meshes, meshes);
+            writer.AddSection(SceneCacheSectionId::VertexData, vertexData);
+            return writer.Write(path, c_SourceHash);
+        }
+    };
+
+    void TestHasher(TestContext& context)
+    {
+        std::vector<uint8_t> data(1000);
+        for (size_t index = 0; index < data.size(); index++)
+            data[index] = uint8_t(index * 7 + 3);
+
+        SceneCacheHasher whole;
+        whole.Update(data.data(), data.size());
+
+        bool chunked = true;
+        for (size_t chunkSize : { 1, 5, 31, 32, 33, 100 })
+        {
+            SceneCacheHasher hasher;
+            for (size_t offset = 0; offset < data.size(); offset += chunkSize)
+                hasher.Update(data.data() + offset, std::min(chunkSize, data.size() - offset));
+            chunked = chunked && hasher.GetHash() == whole.GetHash();
+        }
+        context.Check(chunked, "the hash doesn't depend on how the data is split");
+
+        SceneCacheHasher changed;
+        data[500] ^= 1;
+        changed.Update(data.data(), data.size());
+        context.Check(changed.GetHash() != whole.GetHash(), "changing one bit changes the hash");
+
+        // Trailing zeros still change the hash
+        SceneCacheHasher longer;
+        data.push_back(0);
+        longer.Update(data.data(), data.size());
+        context.Check(longer.GetHash() != changed.GetHash(), "the length is part of the hash");
+    }
+
+    void TestBuilders(TestContext& context)
+    {
+        SceneCacheStringTable strings;
+        const uint32_t a = strings.Add("alpha");
+        const uint32_t b = strings.Add("beta");
+        context.Check(a == 0 && b == 6 && strings.Add("alpha") == a, "the strings are deduplicated");
+        context.Check(strings.GetData().size() == 11 && strings.GetData().back() == 0, "the strings are terminated");
+
+        std::vector<uint8_t> vertexData;
+        const uint8_t three[3] = { 1, 2, 3 };
+        const uint64_t first = AppendSceneCacheData(vertexData, three, sizeof(three));
+        const uint64_t second = AppendSceneCacheData(vertexData, three, sizeof(three));
+        context.Check(first == 0 && second == 16 && vertexData.size() == 19, "the vertex arrays are 16-byte aligned");
+        context.Check(AppendSceneCacheData(vertexData, three, 0) == c_SceneCacheNoData, "an empty array has no data");
+    }
+
+    void TestRoundTrip(TestContext& context, const std::filesystem::path& path)
+    {
+        const TestScene scene;
+        context.Check(scene.Write(path), "the cache is written");
+        context.Check(!std::filesystem::exists(std::filesystem::path(path) += ".tmp"), "the temporary file is replaced");
+
+        SceneCacheFile file;
+        context.Check(file.Open(path, c_SourceHash) && file.IsOpen() && file.GetError().empty(), "the cache opens");
+
+        const SceneCacheArray<SceneCacheNode> nodes = file.GetSection<SceneCacheNode>(SceneCacheSectionId::Nodes);
+        context.Check(nodes.size() == 2 && nodes[1].parent == 0 && nodes[1].leafType == SceneCacheLeafType::MeshInstance
+            && nodes[0].translation[1] == 2.5 && nodes[1].scaling[0] == 3.0, "the nodes are read back");
+        context.Check(nodes.size() == 2 && file.GetString(nodes[0].name) && strcmp(file.GetString(nodes[0].name), "root") == 0,
+            "the names are read back");
+
+        const SceneCacheArray<SceneCacheMesh> meshes = file.GetSection<SceneCacheMesh>(SceneCacheSectionId::Meshes);
+        const SceneCacheArray<SceneCacheBufferGroup> groups = file.GetSection<SceneCacheBufferGroup>(SceneCacheSectionId::BufferGroups);
+        context.Check(meshes.size() == 1 && nodes.size() == 2 && meshes[0].name == nodes[1].name, "the meshes share the deduplicated name");
+
+        bool vertexData = groups.size() == 1;
+        if (vertexData)
+        {
+            const size_t indexSize = groups[0].indexCount * sizeof(uint32_t);
+            const size_t positionSize = groups[0].vertexCount * 3 * sizeof(float);
+            const void* indices = file.GetVertexData(groups[0].indexData, indexSize);
+            const void* positions = file.GetVertexData(groups[0].positionData, positionSize);
+            vertexData = indices && positions
+                && memcmp(indices, scene.indices.data(), indexSize) == 0
+                && memcmp(positions, scene.positions.data(), positionSize) == 0
+                && uintptr_t(positions) % 16 == 0;
+        }
+        context.Check(vertexData, "the vertex data is mapped in place and aligned");
+
+        context.Check(file.GetSection<SceneCacheLight>(SceneCacheSectionId::Lights).empty(), "a missing section is empty");
+        context.Check(file.GetSection<SceneCacheMesh>(SceneCacheSectionId::Nodes).empty(), "a section read with a different record is empty");
+        context.Check(!file.GetString(uint32_t(scene.strings.GetData().size())), "a string outside of the section is rejected");
+        context.Check(!file.GetVertexData(scene.vertexData.size() - 4, 8) && !file.GetVertexData(~0ull - 4, 8),
+            "vertex data outside of the section is rejected");
+
+        file.Close();
+        context.Check(!file.IsOpen() && file.GetSection<SceneCacheNode>(SceneCacheSectionId::Nodes).empty(), "a closed file has no sections");
+    }
+
+    void TestCorruption(TestContext& context, const std::filesystem::path& path, const std::filesystem::path& corruptPath)
+    {
+        const std::vector<uint8_t> original = ReadBytes(path);
+        SceneCacheFile file;
+
+        auto rejects = [&](const std::vector<uint8_t>& bytes, uint64_t sourceHash = c_SourceHash)
+        {
+            WriteBytes(corruptPath, bytes);
+            return !file.Open(corruptPath, sourceHash) && !file.IsOpen() && !file.GetError().empty();
+        };
+
+        context.Check(!original.empty() && !rejects(original), "an unchanged copy opens");
+        context.Check(rejects(original, c_SourceHash + 1), "changed source files invalidate the cache");
+        context.Check(!file.Open(corruptPath.parent_path() / "missing.bin", c_SourceHash), "a missing file is rejected");
+        context.Check(rejects({}), "an empty file is rejected");
+
+        std::vector<uint8_t> bytes = original;
+        bytes[0] ^= 0xff;
+        context.Check(rejects(bytes), "a file that is not a cache is rejected");
+
+        bytes = original;
+        Poke<uint32_t>(bytes, c_VersionOffset, SceneCacheWriter::Version + 1);
+        context.Check(rejects(bytes), "a different version is rejected");
+
+        bytes = original;
+        bytes.resize(bytes.size() - 64);
+        context.Check(rejects(bytes), "a truncated file is rejected");
+
+        bytes = original;
+        bytes.resize(bytes.size() + 64);
+        context.Check(rejects(bytes), "a file with trailing data is rejected");
+
+        // A section that points past the end of the file, and one that is not aligned
+        const size_t meshSection = GetSectionEntry(SceneCacheSectionId::Meshes);
+        bytes = original;
+        Poke<uint64_t>(bytes, meshSection + c_SectionOffsetOffset, uint64_t(original.size()) + 64);
+        context.Check(rejects(bytes), "a section outside of the file is rejected");
+
+        bytes = original;
+        Poke<uint64_t>(bytes, meshSection + c_SectionOffsetOffset, Peek<uint64_t>(original, meshSection + c_SectionOffsetOffset) + 8);
+        context.Check(rejects(bytes), "a misaligned section is rejected");
+
+        bytes = original;
+        Poke<uint32_t>(bytes, meshSection, uint32_t(SceneCacheSectionId::Nodes));
+        context.Check(rejects(bytes), "a section table out of order is rejected");
+
+        // The last string loses its terminator
+        const size_t stringsSection = GetSectionEntry(SceneCacheSectionId::Strings);
+        const uint64_t stringsOffset = Peek<uint64_t>(original, stringsSection + c_SectionOffsetOffset);
+        const uint64_t stringsSize = Peek<uint64_t>(original, stringsSection + c_SectionSizeOffset);
+        bytes = original;
+        bytes[size_t(stringsOffset + stringsSize - 1)] = 'x';
+        context.Check(rejects(bytes), "an unterminated string section is rejected");
+
+        // Changing any byte of the header and section table is either harmless or rejected,
+        // an accepted table never has sections outside of the file
+        bool bounded = true;
+        for (size_t offset = 0; offset < GetSectionEntry(SceneCacheSectionId::Count); offset++)
+        {
+            bytes = original;
+            bytes[offset] ^= 0x5a;
+            WriteBytes(corruptPath, bytes);
+            if (!file.Open(corruptPath, c_SourceHash))
+                continue;
+
+            for (uint32_t id = 0; id < uint32_t(SceneCacheSectionId::Count); id++)
+            {
+                const uint64_t sectionOffset = Peek<uint64_t>(bytes, GetSectionEntry(SceneCacheSectionId(id)) + c_SectionOffsetOffset);
+                const uint64_t sectionSize = Peek<uint64_t>(bytes, GetSectionEntry(SceneCacheSectionId(id)) + c_SectionSizeOffset);
+                bounded = bounded && sectionOffset <= bytes.size() && sectionSize <= bytes.size() - sectionOffset;
+            }
+            file.Close();
+        }
+        context.Check(bounded, "a corrupt header never produces sections outside of the file");
+    }
+}
+
+void TestSceneCache(TestContext& context)
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "FullSampleTests.SceneCache";
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    const std::filesystem::path path = directory / "scene.bin";
+    const std::filesystem::path corruptPath = directory / "corrupt.bin";
+
+    TestHasher(context);
+    TestBuilders(context);
+    TestRoundTrip(context, path);
+    TestCorruption(context, path, corruptPath);
+
+    std::filesystem::remove_all(directory, error);
+}
@@ -0,0 +1,198 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "SceneInstanceBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+    bool IsVisible(const InstanceBounds& bounds, const std::vector<CullingPlane>& planes)
+    {
+        if (bounds.minimum[0] > bounds.maximum[0])
+            return false;
+
+        for (const CullingPlane& plane : planes)
+        {
+            float nearDistance = 0.f;
+            for (int axis = 0; axis < 3; axis++)
+                nearDistance += plane.normal[axis] * ((plane.normal[axis] > 0.f) ? bounds.minimum[axis] : bounds.maximum[axis]);
+
+            if (nearDistance > plane.distance)
+                return false;
+        }
+        return true;
+    }
+
+    std::vector<uint32_t> CullLinear(const std::vector<InstanceBounds>& bounds, const std::vector<CullingPlane>& planes)
+    {
+        std::vector<uint32_t> visible;
+        for (uint32_t instance = 0; instance < bounds.size(); instance++)
+        {
+            if (IsVisible(bounds[instance], planes))
+                visible.push_back(instance);
+        }
+        return visible;
+    }
+
+    std::vector<uint32_t> CullBvh(const SceneInstanceBvh& bvh, const std::vector<CullingPlane>& planes)
+    {
+        std::vector<uint32_t> visible;
+        bvh.Cull(planes.data(), uint32_t(planes.size()), visible);
+        std::sort(visible.begin(), visible.end());
+        return visible;
+    }
+
+    InstanceBounds MakeBox(std::mt19937& random, float extent)
+    {
+        std::uniform_real_distribution<float> position(-extent, extent);
+        std::uniform_real_distribution<float> size(0.1f, 2.f);
+
+        InstanceBounds box;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float center = position(random);
+            const float halfSize = size(random);
+            box.minimum[axis] = center - halfSize;
+            box.maximum[axis] = center + halfSize;
+        }
+        return box;
+    }
+
+    // Planes through points near the origin, facing random directions, so that every query keeps a part of the scene
+    std::vector<CullingPlane> MakePlanes(std::mt19937& random, uint32_t count, float extent)
+    {
+        std::normal_distribution<float> direction;
+        std::uniform_real_distribution<float> offset(0.f, extent);
+
+        std::vector<CullingPlane> planes(count);
+        for (CullingPlane& plane : planes)
+        {
+            float length = 0.f;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                plane.normal[axis] = direction(random);
+                length += plane.normal[axis] * plane.normal[axis];
+            }
+            for (int axis = 0; axis < 3; axis++)
+                plane.normal[axis] /= std::sqrt(length);
+            plane.distance = offset(random);
+        }
+        return planes;
+    }
+
+    void TestCulling(TestContext& context)
+    {
+        std::mt19937 random(19);
+        const float extent = 100.f;
+
+        std::vector<InstanceBounds> bounds(5000);
+        for (InstanceBounds& box : bounds)
+            box = MakeBox(random, extent);
+        for (uint32_t instance = 0; instance < bounds.size(); instance += 97)
+            bounds[instance] = InstanceBounds::Empty();
+
+        SceneInstanceBvh bvh;
+        bvh.Build(bounds);
+        context.Check(bvh.GetInstanceCount() == 5000 && bvh.GetNodeCount() > 0, "the hierarchy covers the instances");
+
+        bool matches = true;
+        bool nonEmpty = true;
+        for (uint32_t query = 0; query < 50; query++)
+        {
+            const std::vector<CullingPlane> planes = MakePlanes(random, 6, extent);
+            const std::vector<uint32_t> expected = CullLinear(bounds, planes);
+            matches = matches && CullBvh(bvh, planes) == expected;
+            nonEmpty = nonEmpty && !expected.empty();
+        }
+        context.Check(nonEmpty, "the queries keep a part of the scene");
+        context.Check(matches, "the hierarchy finds the same instances as a linear loop");
+
+        // More planes than Cull keeps on the stack, e.g. a frustum with several clip planes
+        matches = true;
+        for (uint32_t planeCount : { SceneInstanceBvh::c_MaxLocalPlanes, SceneInstanceBvh::c_MaxLocalPlanes + 1, 16u })
+        {
+            const std::vector<CullingPlane> planes = MakePlanes(random, planeCount, extent);
+            matches = matches && CullBvh(bvh, planes) == CullLinear(bounds, planes);
+        }
+        context.Check(matches, "every plane is used, however many there are");
+
+        context.Check(CullBvh(bvh, {}).size() == bounds.size() - (bounds.size() + 96) / 97, "no planes keep every non-empty instance");
+
+        SceneInstanceBvh empty;
+        empty.Build({});
+        context.Check(CullBvh(empty, MakePlanes(random, 6, extent)).empty(), "an empty hierarchy has no visible instances");
+    }
+
+    void TestRefit(TestContext& context)
+    {
+        std::mt19937 random(23);
+        const float extent = 100.f;
+
+        std::vector<InstanceBounds> bounds(3000);
+        for (InstanceBounds& box : bounds)
+            box = MakeBox(random, extent);
+
+        SceneInstanceBvh bvh;
+        bvh.Build(bounds);
+
+        // Move some instances across the scene, so that stale node boxes would both miss them in their new
+        // place and report them in their old place
+        bool matches = true;
+        for (uint32_t frame = 0; frame < 20; frame++)
+        {
+            for (uint32_t move = 0; move < 30; move++)
+            {
+                const uint32_t instance = random() % uint32_t(bounds.size());
+                bounds[instance] = (move % 10 == 0) ? InstanceBounds::Empty() : MakeBox(random, extent);
+                bvh.SetInstanceBounds(instance, bounds[instance]);
+            }
+            bvh.Refit();
+
+            const std::vector<CullingPlane> planes = MakePlanes(random, 6, extent);
+            matches = matches && CullBvh(bvh, planes) == CullLinear(bounds, planes);
+        }
+        context.Check(matches, "the refit hierarchy finds the instances at their new place");
+
+        // Moves that are undone before the refit leave nothing to refit
+        const InstanceBounds original = bounds[0];
+        bvh.SetInstanceBounds(0, MakeBox(random, extent));
+        bvh.SetInstanceBounds(0, original);
+        bvh.Refit();
+        const std::vector<CullingPlane> planes = MakePlanes(random, 6, extent);
+        context.Check(CullBvh(bvh, planes) == CullLinear(bounds, planes), "a move that is undone before the refit is harmless");
+
+        bvh.SetInstanceBounds(uint32_t(bounds.size()), original);
+        context.Check(bvh.GetInstanceCount() == bounds.size(), "an instance outside of the hierarchy is ignored");
+    }
+}
+
+void TestSceneInstanceBvh(TestContext& context)
+{
+    TestCulling(context);
+    TestRefit(context);
+}
+
+void RunInstanceCullingBenchmark()
+{
+    for (uint32_t instanceCount : { 10'000u, 100'000u, 1'000'000u })
+    {
+        const InstanceCullingBenchmarkResult result = BenchmarkInstanceCulling(instanceCount, 10);
+        printf("Instance culling, %u instances (%u visible): linear %.3f ms, BVH %.3f ms, build %.1f ms, "
+            "refit 10%% %.2f ms, refit 100 instances %.3f ms\n",
+            result.instanceCount, result.visibleCount, result.linearMs, result.bvhMs, result.buildMs,
+            result.refitMs, result.refitFewMs);
+    }
+}
@@ -0,0 +1,181 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "ShaderConfig.h"
+
+#include <algorithm>
+
+namespace
+{
+    std::vector<std::string> GetKeys(const ShaderConfig& config)
+    {
+        std::vector<std::string> keys;
+        for (const ShaderConfigEntry& entry : config.entries)
+        {
+            for (const ShaderConfigPermutation& permutation : ExpandShaderConfigEntry(entry))
+                keys.push_back(permutation.GetKey());
+        }
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    }
+
+    // Lines like those of Shaders.cfg, with a comment, a blank line and a spaced set
+    const char* const c_ConfigText =
+        "RasterizedGBuffer.hlsl -T vs -E vs_main -D INDIRECT_DRAW={0,1}\n"
+        "RasterizedGBuffer.hlsl -T ps -E ps_main -D ALPHA_TESTED={0,1} -D INDIRECT_DRAW={0,1}\n"
+        "// comment\n"
+        "\n"
+        "PrepareLights.hlsl -T cs -E main\n"
+        "LightingPasses/DI/ShadeSamples.hlsl -T cs -E main -D USE_RAY_QUERY=1 -D RTXDI_REGIR_MODE={RTXDI_REGIR_DISABLED}\n"
+        "LightingPasses/DI/ShadeSamples.hlsl -T lib -D USE_RAY_QUERY=0 -D RTXDI_REGIR_MODE={RTXDI_REGIR_DISABLED}\n"
+        "LightingPasses/GI/FinalShading.hlsl -T lib -E main -D USE_RAY_QUERY=0 -O3\n"
+        "Spaced.hlsl -T cs -D MODE={a, b, c} -D FLAG\n";
+
+    void TestParsing(TestContext& context)
+    {
+        const ShaderConfig config = ParseShaderConfig(c_ConfigText);
+        context.Check(config.errors.empty() && config.entries.size() == 7, "all lines are parsed");
+
+        if (config.entries.size() == 7)
+        {
+            const ShaderConfigEntry& pixel = config.entries[1];
+            context.Check(pixel.source == "RasterizedGBuffer.hlsl" && pixel.target == "ps" && pixel.entryPoint == "ps_main", "source, target and entry point are parsed");
+            context.Check(pixel.defines.size() == 2 && pixel.defines[0].name == "ALPHA_TESTED" && pixel.defines[0].values == std::vector<std::string>{ "0", "1" },
+                "value sets are parsed");
+            context.Check(config.entries[2].lineNumber == 5 && config.entries[2].defines.empty(), "comments and blank lines are skipped");
+            context.Check(config.entries[3].defines[1].values == std::vector<std::string>{ "RTXDI_REGIR_DISABLED" }, "a set with one value is parsed");
+            context.Check(config.entries[5].otherOptions == std::vector<std::string>{ "-O3" }, "other options are kept");
+            context.Check(config.entries[6].defines.size() == 2 && config.entries[6].defines[0].values.size() == 3
+                && config.entries[6].defines[1].values == std::vector<std::string>{ "" }, "spaced sets and defines without values are parsed");
+
+            // Expansion
+            const std::vector<ShaderConfigPermutation> pixelPermutations = ExpandShaderConfigEntry(pixel);
+            context.Check(pixelPermutations.size() == 4, "a line expands to every combination");
+            context.Check(pixelPermutations.size() == 4 && pixelPermutations[1].macros[0].definition == "0" && pixelPermutations[1].macros[1].definition == "1"
+                && pixelPermutations[2].macros[0].definition == "1", "the last define varies fastest");
+            context.Check(ExpandShaderConfigEntry(config.entries[2]).size() == 1, "a line without defines is one permutation");
+            context.Check(ExpandShaderConfigEntry(config.entries[6]).size() == 3, "a define without a value doesn't multiply");
+
+            const std::vector<ShaderConfigPermutation> library = ExpandShaderConfigEntry(config.entries[5]);
+            context.Check(library.size() == 1 && library[0].entryPoint.empty()
+                && library[0].GetKey() == MakeShaderConfigPermutation("LightingPasses/GI/FinalShading.hlsl", "lib", "", { { "USE_RAY_QUERY", "0" } }).GetKey(),
+                "the entry point of a library doesn't matter");
+            context.Check(ExpandShaderConfigEntry(config.entries[2])[0].GetKey() == MakeShaderConfigPermutation("PrepareLights.hlsl", "cs", "", {}).GetKey(),
+                "the default entry point is main");
+        }
+
+        // Malformed lines
+        const ShaderConfig broken = ParseShaderConfig(
+            "A.hlsl -T cs -D X={a,b\n"
+            "B.hlsl -E main\n"
+            "C.hlsl -T cs -D X=1 -D X=2\n"
+            "D.hlsl -T cs -D X={a,}\n"
+            "E.hlsl -T cs -D X={}\n"
+            "F.hlsl -T\n"
+            "#ifdef SPIRV\n"
+            "G.hlsl -T cs -D X={a,a}\n"
+            "H.hlsl -T cs -D =1\n"
+            "I.hlsl -T cs\n");
+        context.Check(broken.errors.size() == 9 && broken.entries.size() == 1 && broken.entries[0].source == "I.hlsl", "malformed lines are reported and skipped");
+        context.Check(!broken.errors.empty() && broken.errors[0].compare(0, 7, "line 1:") == 0, "errors carry the line number");
+    }
+
+    void TestRoundTrip(TestContext& context)
+    {
+        const ShaderConfig config = ParseShaderConfig(c_ConfigText);
+
+        const ShaderConfig written = ParseShaderConfig(WriteShaderConfig(config));
+        context.Check(written.errors.empty() && GetKeys(written) == GetKeys(config), "a written configuration parses to the same permutations");
+        context.Check(WriteShaderConfig(written) == WriteShaderConfig(config), "writing is stable");
+        context.Check(WriteShaderConfig(config).find("\n\nPrepareLights.hlsl") != std::string::npos, "groups of lines stay apart");
+    }
+
+    void TestPruning(TestContext& context)
+    {
+        const ShaderConfig config = ParseShaderConfig(c_ConfigText);
+
+        std::vector<ShaderConfigPermutation> used = {
+            MakeShaderConfigPermutation("RasterizedGBuffer.hlsl", "ps", "ps_main", { { "INDIRECT_DRAW", "1" }, { "ALPHA_TESTED", "0" } }),
+            MakeShaderConfigPermutation("RasterizedGBuffer.hlsl", "ps", "ps_main", { { "ALPHA_TESTED", "1" }, { "INDIRECT_DRAW", "1" } }),
+            MakeShaderConfigPermutation("LightingPasses/DI/ShadeSamples.hlsl", "cs", "main", { { "USE_RAY_QUERY", "1" }, { "RTXDI_REGIR_MODE", "RTXDI_REGIR_DISABLED" } }),
+            MakeShaderConfigPermutation("DenoisingPasses/ComputeGradients.hlsl", "cs", "main", { { "USE_RAY_QUERY", "1" } }),
+        };
+
+        ShaderConfigPruneResult pruned = PruneShaderConfig(config, used);
+        context.Check(pruned.config.entries.size() == 2 && pruned.keptPermutations == 3, "only the used lines are kept");
+        context.Check(!pruned.config.entries.empty() && pruned.config.entries[0].defines[0].values.size() == 2
+            && pruned.config.entries[0].defines[1].values == std::vector<std::string>{ "1" }, "value sets are reduced to the used values");
+        context.Check(pruned.removedPermutations == 13 - 3, "removed permutations are counted");
+        context.Check(pruned.unmatched.size() == 1 && pruned.unmatched[0].source == "DenoisingPasses/ComputeGradients.hlsl", "permutations missing from the configuration are reported");
+
+        // A diagonal can't be one line
+        used = {
+            MakeShaderConfigPermutation("RasterizedGBuffer.hlsl", "ps", "ps_main", { { "ALPHA_TESTED", "0" }, { "INDIRECT_DRAW", "0" } }),
+            MakeShaderConfigPermutation("RasterizedGBuffer.hlsl", "ps", "ps_main", { { "ALPHA_TESTED", "1" }, { "INDIRECT_DRAW", "1" } }),
+        };
+        pruned = PruneShaderConfig(config, used);
+        context.Check(pruned.config.entries.size() == 2 && GetKeys(pruned.config).size() == 2, "a line is split when its reduced sets would compile unused permutations");
+
+        // Exactness for every subset of the permutations of a line with three defines
+        const ShaderConfig cube = ParseShaderConfig("Cube.hlsl -T cs -D A={0,1} -D B={x,y} -D C={p,q}\n");
+        const std::vector<ShaderConfigPermutation> corners = ExpandShaderConfigEntry(cube.entries[0]);
+        bool allExact = true;
+        bool allSmall = true;
+        for (uint32_t subset = 0; subset < (1u << corners.size()); subset++)
+        {
+            std::vector<ShaderConfigPermutation> subsetPermutations;
+            std::vector<std::string> expectedKeys;
+            for (size_t index = 0; index < corners.size(); index++)
+            {
+                if (subset & (1u << index))
+                {
+                    subsetPermutations.push_back(corners[index]);
+                    expectedKeys.push_back(corners[index].GetKey());
+                }
+            }
+            std::sort(expectedKeys.begin(), expectedKeys.end());
+
+            const ShaderConfigPruneResult subsetResult = PruneShaderConfig(cube, subsetPermutations);
+            allExact = allExact && GetKeys(subsetResult.config) == expectedKeys && subsetResult.unmatched.empty();
+            allSmall = allSmall && subsetResult.config.entries.size() <= subsetPermutations.size();
+        }
+        context.Check(allExact, "pruning compiles exactly the used permutations");
+        context.Check(allSmall, "pruning never needs more lines than permutations");
+    }
+
+    void TestUsageRecording(TestContext& context)
+    {
+        ShaderUsageRecorder recorder;
+        recorder.Record(MakeShaderConfigPermutation("a/./B.hlsl", "cs", "main", { { "Y", "1" }, { "X", "2" } }));
+        recorder.Record(MakeShaderConfigPermutation("a/B.hlsl", "cs", "", { { "X", "2" }, { "Y", "1" } }));
+        recorder.Record(MakeShaderConfigPermutation("a/B.hlsl", "lib", "main", { { "FLAG", "" } }));
+        context.Check(recorder.GetPermutations().size() == 2, "repeated requests are recorded once");
+
+        ShaderUsageRecorder merged;
+        merged.Merge(ParseShaderConfig(WriteShaderConfig(recorder.GetUsage())));
+        std::vector<std::string> recordedKeys;
+        std::vector<std::string> mergedKeys;
+        for (const ShaderConfigPermutation& permutation : recorder.GetPermutations())
+            recordedKeys.push_back(permutation.GetKey());
+        for (const ShaderConfigPermutation& permutation : merged.GetPermutations())
+            mergedKeys.push_back(permutation.GetKey());
+        context.Check(recordedKeys == mergedKeys, "a usage file reads back to the recorded permutations");
+    }
+}
+
+void TestShaderConfig(TestContext& context)
+{
+    TestParsing(context);
+    TestRoundTrip(context);
+    TestPruning(context);
+    TestUsageRecording(context);
+}
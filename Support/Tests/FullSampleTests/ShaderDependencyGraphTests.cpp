@@ -0,0 +1,195 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "ShaderDependencyGraph.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+    bool WriteTestFile(const std::filesystem::path& path, const std::string& text)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << text;
+        return bool(file);
+    }
+
+    bool Contains(const std::vector<std::string>& names, const std::string& name)
+    {
+        return std::find(names.begin(), names.end(), name) != names.end();
+    }
+
+    void TestScanner(TestContext& context)
+    {
+        const std::string text =
+            "#include \"a.h\"\n"
+            "  #  include   <b/c.h>\n"
+            "// #include \"commented.h\"\n"
+            "/* #include \"block.h\"\n"
+            "#include \"block2.h\" */ #include \"d.h\"\n"
+            "static const char* s = \"// not a comment\";\n"
+            "#include \"e.h\" // trailing comment\n"
+            "#includes \"f.h\"\n"
+            "#define X \"#include \\\"g.h\\\"\"\n"
+            "#include \"h.h\"";
+
+        const std::vector<ShaderInclude> includes = ScanShaderIncludes(text);
+        context.Check(includes.size() == 5, "the scanner finds every include outside of comments");
+        if (includes.size() != 5)
+            return;
+
+        context.Check(includes[0].path == "a.h" && !includes[0].angled && includes[0].lineNumber == 1, "quoted includes are found");
+        context.Check(includes[1].path == "b/c.h" && includes[1].angled && includes[1].lineNumber == 2, "angled includes with spaces are found");
+        context.Check(includes[2].path == "d.h" && includes[2].lineNumber == 5, "a block comment counts as a space before a directive");
+        context.Check(includes[3].path == "e.h" && includes[3].lineNumber == 7, "a comment marker in a string doesn't hide the following lines");
+        context.Check(includes[4].path == "h.h" && includes[4].lineNumber == 10, "the last line doesn't need a line break");
+    }
+
+    void TestShaderTree(TestContext& context, const std::filesystem::path& sourceDirectory,
+        const std::vector<std::filesystem::path>& includeDirectories)
+    {
+        ShaderDependencyGraph graph;
+        context.Check(graph.Build(sourceDirectory, includeDirectories), "the shader tree can be scanned");
+
+        const std::vector<std::string> sources = graph.GetSources();
+        context.Check(Contains(sources, "LightingPasses/DI/ShadeSamples.hlsl") && Contains(sources, "PrepareLights.hlsl"),
+            "the sources are named like in Shaders.cfg");
+        context.Check(!Contains(sources, "PolymorphicLight.hlsli") && !Contains(sources, "ShaderParameters.h"), "headers are not sources");
+
+        const std::vector<std::string> shadeSamples = graph.GetDependencies("LightingPasses/DI/ShadeSamples.hlsl");
+        context.Check(Contains(shadeSamples, "LightingPasses/RtxdiApplicationBridge/RtxdiApplicationBridge.hlsli") &&
+            Contains(shadeSamples, "LightingPasses/RtxdiApplicationBridge/RAB_Material.hlsli") &&
+            Contains(shadeSamples, "PolymorphicLight.hlsli") &&
+            Contains(shadeSamples, "ShaderParameters.h"),
+            "relative includes are followed through the application bridge");
+
+        const std::vector<std::string> polymorphicLight = graph.GetAffectedSources({ "PolymorphicLight.hlsli" });
+        context.Check(Contains(polymorphicLight, "PrepareLights.hlsl") &&
+            Contains(polymorphicLight, "LightingPasses/DI/ShadeSamples.hlsl") &&
+            Contains(polymorphicLight, "LightingPasses/GI/FinalShading.hlsl"),
+            "a light encoding change affects the light preparation and the lighting passes");
+        context.Check(!Contains(polymorphicLight, "CompositingPass.hlsl") && !Contains(polymorphicLight, "RasterizedGBuffer.hlsl"),
+            "a light encoding change doesn't affect the G-buffer and compositing passes");
+
+        const std::vector<std::string> material = graph.GetAffectedSources({ "LightingPasses/RtxdiApplicationBridge/RAB_Material.hlsli" });
+        context.Check(Contains(material, "LightingPasses/DI/TemporalResampling.hlsl") && !Contains(material, "PrepareLights.hlsl"),
+            "a bridge change affects only the passes that include the bridge");
+
+        context.Check(graph.GetAffectedSources({ "CompositingPass.hlsl" }) == std::vector<std::string>{ "CompositingPass.hlsl" },
+            "a source change affects only that source");
+
+        const std::vector<std::string> parameters = graph.GetAffectedSources({ "ShaderParameters.h" });
+        context.Check(Contains(parameters, "CompositingPass.hlsl") && Contains(parameters, "LightingPasses/DI/ShadeSamples.hlsl"),
+            "a shared header change affects the sources of all passes that include it");
+
+        bool onlyLibraryHeadersUnresolved = true;
+        for (const ShaderUnresolvedInclude& unresolved : graph.GetUnresolvedIncludes())
+        {
+            const std::string& path = unresolved.include.path;
+            if (path.compare(0, 6, "donut/") != 0 && path.compare(0, 6, "Rtxdi/") != 0)
+                onlyLibraryHeadersUnresolved = false;
+        }
+        context.Check(onlyLibraryHeadersUnresolved, "all application includes are resolved");
+
+        context.Check(graph.GetChangedFiles(graph).empty(), "a graph has no changes against itself");
+    }
+
+    void TestChangeDetection(TestContext& context, const std::filesystem::path& scratchDirectory)
+    {
+        std::error_code error;
+        std::filesystem::remove_all(scratchDirectory, error);
+
+        const std::filesystem::path source = scratchDirectory / "src";
+        const std::filesystem::path include = scratchDirectory / "include";
+
+        bool written = true;
+        written &= WriteTestFile(source / "Shaders.cfg", "A.hlsl -T cs\n");
+        written &= WriteTestFile(source / "A.hlsl", "#include \"common/B.hlsli\"\n// #include \"Missing.hlsli\"\n");
+        written &= WriteTestFile(source / "common/B.hlsli", "#include \"C.h\"\n#include <lib/D.h>\n");
+        written &= WriteTestFile(source / "common/C.h", "// C\n");
+        written &= WriteTestFile(source / "E.hlsl", "#include \"common/C.h\"\n");
+        written &= WriteTestFile(source / "F.hlsl", "#include \"X.hlsli\"\n");
+        written &= WriteTestFile(source / "X.hlsli", "#include \"Y.hlsli\"\n");
+        written &= WriteTestFile(source / "Y.hlsli", "#include \"X.hlsli\"\n");
+        written &= WriteTestFile(include / "lib/D.h", "/* D */\n");
+        context.Check(written, "the test tree can be written");
+        if (!written)
+            return;
+
+        ShaderDependencyGraph graph;
+        context.Check(graph.Build(source, { include }), "the test tree can be scanned");
+        context.Check(graph.GetFileCount() == 8, "every source and included file is in the graph once");
+        context.Check(graph.GetSources() == std::vector<std::string>{ "A.hlsl", "E.hlsl", "F.hlsl" }, "the .hlsl files are the sources");
+        context.Check(graph.GetDependencies("A.hlsl") == std::vector<std::string>{ "common/B.hlsli", "common/C.h", "lib/D.h" },
+            "includes are resolved next to the including file, then in the include directories");
+        context.Check(graph.GetDependencies("F.hlsl") == std::vector<std::string>{ "X.hlsli", "Y.hlsli" }, "include cycles terminate");
+        context.Check(graph.GetUnresolvedIncludes().empty(), "commented includes are not resolved");
+
+        ShaderSourceWatcher watcher;
+        context.Check(watcher.Start(source, { include }) && watcher.IsStarted(), "the watcher starts on the test tree");
+
+        ShaderSourceChanges changes = watcher.Poll();
+        context.Check(changes.changedFiles.empty() && changes.affectedSources.empty() && !changes.reloadAll, "an unchanged tree has no changes");
+
+        WriteTestFile(source / "common/C.h", "// C\n");
+        changes = watcher.Poll();
+        context.Check(changes.changedFiles.empty(), "rewriting a file with the same content is not a change");
+
+        WriteTestFile(include / "lib/D.h", "/* D2 */\n");
+        changes = watcher.Poll();
+        context.Check(changes.changedFiles == std::vector<std::string>{ "lib/D.h" } &&
+            changes.affectedSources == std::vector<std::string>{ "A.hlsl" },
+            "a library header change affects the sources that include it indirectly");
+
+        WriteTestFile(source / "common/C.h", "// C2\n");
+        changes = watcher.Poll();
+        context.Check(changes.affectedSources == std::vector<std::string>{ "A.hlsl", "E.hlsl" }, "a shared header change affects all its includers");
+
+        WriteTestFile(source / "Y.hlsli", "#include \"X.hlsli\"\n// Y\n");
+        changes = watcher.Poll();
+        context.Check(changes.affectedSources == std::vector<std::string>{ "F.hlsl" }, "changes inside of an include cycle are found");
+
+        WriteTestFile(source / "G.hlsl", "#include \"common/C.h\"\n");
+        changes = watcher.Poll();
+        context.Check(changes.changedFiles == std::vector<std::string>{ "G.hlsl" } &&
+            changes.affectedSources == std::vector<std::string>{ "G.hlsl" },
+            "a new source affects only itself");
+
+        std::filesystem::remove(source / "common/C.h", error);
+        changes = watcher.Poll();
+        context.Check(changes.changedFiles == std::vector<std::string>{ "common/C.h" } &&
+            changes.affectedSources == std::vector<std::string>{ "A.hlsl", "E.hlsl", "G.hlsl" },
+            "a deleted header affects its previous includers");
+        context.Check(watcher.GetGraph().GetUnresolvedIncludes().size() == 3, "includes of a deleted header are unresolved");
+        context.Check(!changes.reloadAll, "header changes don't reload everything");
+
+        WriteTestFile(source / "Shaders.cfg", "A.hlsl -T cs -D X={0,1}\n");
+        changes = watcher.Poll();
+        context.Check(changes.reloadAll, "a configuration change reloads everything");
+
+        std::filesystem::remove_all(scratchDirectory, error);
+    }
+}
+
+void TestShaderDependencyGraph(TestContext& context)
+{
+    TestScanner(context);
+
+    // The application shader tree, with the RTXDI include directory it is compiled with
+    TestShaderTree(context, FULL_SAMPLE_SHADER_DIR, { RTXDI_INCLUDE_DIR });
+
+    TestChangeDetection(context, std::filesystem::temp_directory_path() / "FullSampleTests.ShaderDependencyGraph");
+}
@@ -0,0 +1,291 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "ShaderPermutationCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    // See FileHeader and Write in ShaderPermutationCache.cpp
+    constexpr size_t c_HeaderSize = 48;
+    constexpr uintptr_t c_DataAlignment = 64;
+
+    std::vector<uint8_t> ReadBytes(const std::filesystem::path& path)
+    {
+        std::ifstream stream(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    void WriteBytes(const std::filesystem::path& path, const std::vector<uint8_t>& bytes)
+    {
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+    }
+
+    // Offset of the first occurrence of the given bytes in the file, or the file size
+    size_t FindBytes(const std::vector<uint8_t>& file, const uint8_t* bytes, size_t size)
+    {
+        for (size_t offset = 0; offset + size <= file.size(); offset++)
+        {
+            if (memcmp(file.data() + offset, bytes, size) == 0)
+                return offset;
+        }
+        return file.size();
+    }
+
+    std::vector<uint8_t> MakeBlob(size_t size, uint8_t seed)
+    {
+        std::vector<uint8_t> blob(size);
+        for (size_t index = 0; index < size; index++)
+            blob[index] = uint8_t(seed + index * 31);
+        return blob;
+    }
+
+    bool FindsBlob(ShaderPermutationCache& cache, const ShaderPermutationKey& key, ShaderCacheBlobType type, const std::vector<uint8_t>& blob)
+    {
+        size_t size = 0;
+        const void* data = cache.Find(key, type, size);
+        return data && size == blob.size() && (size == 0 || memcmp(data, blob.data(), size) == 0);
+    }
+
+    // Keys that differ in every part, and one that is spelled differently but equal to the first
+    struct TestKeys
+    {
+        ShaderPermutationKey base = MakeShaderPermutationKey("app/LightingPasses/GenerateInitialSamples.hlsl", "main",
+            { { "USE_RAY_QUERY", "1" }, { "RTXDI_REGIR_MODE", "2" } }, 0x1234);
+        ShaderPermutationKey reordered = MakeShaderPermutationKey("app\\LightingPasses\\..\\LightingPasses\\GenerateInitialSamples.hlsl", "main",
+            { { "RTXDI_REGIR_MODE", "0" }, { "USE_RAY_QUERY", "1" }, { "RTXDI_REGIR_MODE", "2" } }, 0x1234);
+        ShaderPermutationKey otherValue = MakeShaderPermutationKey(base.shaderPath, "main", { { "USE_RAY_QUERY", "0" }, { "RTXDI_REGIR_MODE", "2" } }, 0x1234);
+        ShaderPermutationKey otherEntry = MakeShaderPermutationKey(base.shaderPath, "main2", base.macros, 0x1234);
+        ShaderPermutationKey otherBinary = MakeShaderPermutationKey(base.shaderPath, "main", base.macros, 0x1235);
+    };
+
+    void TestKeyCanonicalization(TestContext& context)
+    {
+        context.Check(NormalizeShaderPath("app\\LightingPasses\\.\\Foo.hlsl") == "app/LightingPasses/Foo.hlsl", "backslashes and . segments are normalized");
+        context.Check(NormalizeShaderPath("app//LightingPasses/../Foo.hlsl") == "app/Foo.hlsl", "repeated slashes and .. segments are resolved");
+        context.Check(NormalizeShaderPath("../a/../b.hlsl") == "../b.hlsl", "leading .. segments of a relative path are kept");
+        context.Check(NormalizeShaderPath("/../a/b.hlsl") == "/a/b.hlsl", "an absolute path can't go above the root");
+
+        const TestKeys keys;
+        context.Check(keys.base.macros.size() == 2 && keys.base.macros[0].name == "RTXDI_REGIR_MODE", "macros are sorted by name");
+        context.Check(keys.base.GetCanonicalString() == keys.reordered.GetCanonicalString(), "path spelling, macro order and redefinitions don't change the key");
+        context.Check(keys.reordered.macros.size() == 2 && keys.reordered.macros[0].definition == "2", "the last definition of a macro wins");
+
+        context.Check(keys.base.GetCanonicalString() != keys.otherValue.GetCanonicalString(), "macro values are part of the key");
+        context.Check(keys.base.GetCanonicalString() != keys.otherEntry.GetCanonicalString(), "the entry point is part of the key");
+        context.Check(keys.base.GetCanonicalString() != keys.otherBinary.GetCanonicalString(), "the binary hash is part of the key");
+
+        const ShaderPermutationKey splitA = MakeShaderPermutationKey("a.hlsl", "main", { { "AB", "" } }, 0);
+        const ShaderPermutationKey splitB = MakeShaderPermutationKey("a.hlsl", "main", { { "A", "B" } }, 0);
+        const ShaderPermutationKey splitC = MakeShaderPermutationKey("a.hlsl", "main", { { "A=", "" } }, 0);
+        const ShaderPermutationKey splitD = MakeShaderPermutationKey("a.hlsl", "main", { { "A", "=" } }, 0);
+        context.Check(splitA.GetCanonicalString() != splitB.GetCanonicalString() && splitC.GetCanonicalString() != splitD.GetCanonicalString(),
+            "names and values can't be confused");
+    }
+
+    void TestBinaryHash(TestContext& context, const std::filesystem::path& directory)
+    {
+        const std::filesystem::path path = directory / "Shader.bin";
+        const std::vector<uint8_t> binary = MakeBlob(200000, 4);
+        WriteBytes(path, binary);
+
+        uint64_t hash = 0;
+        uint64_t rehash = 0;
+        context.Check(HashShaderBinaryFile(path, hash) && HashShaderBinaryFile(path, rehash) && hash == rehash, "the hash of a file is stable");
+
+        // A rebuilt binary of the same size, with the modification time of the old one
+        const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path);
+        std::vector<uint8_t> rebuilt = binary;
+        rebuilt[150000] ^= 0x01;
+        WriteBytes(path, rebuilt);
+        std::filesystem::last_write_time(path, writeTime);
+        context.Check(HashShaderBinaryFile(path, rehash) && rehash != hash, "the hash depends on the contents, not on the file times");
+
+        WriteBytes(path, {});
+        context.Check(HashShaderBinaryFile(path, rehash) && rehash != hash, "an empty file has a hash");
+
+        rehash = 7;
+        context.Check(!HashShaderBinaryFile(directory / "Missing.bin", rehash) && rehash == 7, "a missing file has no hash");
+    }
+
+    void TestRoundTrip(TestContext& context, const std::filesystem::path& path)
+    {
+        const TestKeys keys;
+        const std::vector<uint8_t> blobA = MakeBlob(1000, 1);
+        const std::vector<uint8_t> blobB = MakeBlob(77, 2);
+        const std::vector<uint8_t> blobEmpty;
+        const std::vector<uint8_t> blobPipeline = MakeBlob(300, 3);
+
+        {
+            ShaderPermutationCache cache;
+            context.Check(cache.Open(path) && cache.GetEntryCount() == 0 && cache.GetSession() == 1, "a missing file opens as an empty cache");
+            cache.Store(keys.base, ShaderCacheBlobType::ShaderBinary, blobA.data(), blobA.size());
+            cache.Store(keys.otherValue, ShaderCacheBlobType::ShaderBinary, blobB.data(), blobB.size());
+            cache.Store(keys.otherEntry, ShaderCacheBlobType::ShaderBinary, blobEmpty.data(), blobEmpty.size());
+            cache.Store(keys.base, ShaderCacheBlobType::PipelineCache, blobPipeline.data(), blobPipeline.size());
+            context.Check(cache.IsDirty() && cache.Write() && !cache.IsDirty(), "the cache is written");
+            context.Check(cache.GetSession() == 1 && FindsBlob(cache, keys.base, ShaderCacheBlobType::ShaderBinary, blobA), "entries can be found after writing");
+        }
+
+        ShaderPermutationCache cache;
+        context.Check(cache.Open(path) && cache.GetEntryCount() == 4 && cache.GetSession() == 2, "the written file opens in the next session");
+        context.Check(FindsBlob(cache, keys.reordered, ShaderCacheBlobType::ShaderBinary, blobA), "an equivalent key finds the entry");
+        context.Check(FindsBlob(cache, keys.otherValue, ShaderCacheBlobType::ShaderBinary, blobB), "a second entry round trips");
+        context.Check(FindsBlob(cache, keys.otherEntry, ShaderCacheBlobType::ShaderBinary, blobEmpty), "an empty blob round trips");
+        context.Check(FindsBlob(cache, keys.base, ShaderCacheBlobType::PipelineCache, blobPipeline), "blob types are kept apart");
+
+        size_t size = 0;
+        const void* data = cache.Find(keys.otherBinary, ShaderCacheBlobType::ShaderBinary, size);
+        context.Check(!data && size == 0, "a different binary hash misses");
+        data = cache.Find(keys.otherValue, ShaderCacheBlobType::ShaderBinary, size);
+        context.Check(data && reinterpret_cast<uintptr_t>(data) % c_DataAlignment == 0, "blobs are aligned in the mapping");
+        context.Check(cache.GetStats().hits == 5 && cache.GetStats().misses == 1, "hits and misses are counted");
+        context.Check(cache.Write(), "the used sessions are written");
+    }
+
+    // Runs after TestRoundTrip, on the file it wrote
+    void TestCorruption(TestContext& context, const std::filesystem::path& path)
+    {
+        const TestKeys keys;
+        const std::vector<uint8_t> blobA = MakeBlob(1000, 1);
+        const std::vector<uint8_t> blobB = MakeBlob(77, 2);
+
+        // A damaged blob is a miss and is dropped, the other entries stay
+        std::vector<uint8_t> file = ReadBytes(path);
+        const size_t blobOffset = FindBytes(file, blobA.data() + 100, 32);
+        context.Check(blobOffset < file.size(), "the blob is stored in the file");
+        if (blobOffset < file.size())
+            file[blobOffset + 5] ^= 0x40;
+        WriteBytes(path, file);
+
+        {
+            ShaderPermutationCache cache;
+            context.Check(cache.Open(path) && cache.GetEntryCount() == 4, "a damaged blob doesn't fail the open");
+            context.Check(!FindsBlob(cache, keys.base, ShaderCacheBlobType::ShaderBinary, blobA) && cache.GetStats().corruptEntries == 1, "a damaged blob is detected");
+            context.Check(FindsBlob(cache, keys.otherValue, ShaderCacheBlobType::ShaderBinary, blobB), "the intact entries are still found");
+            context.Check(cache.IsDirty() && cache.Write() && cache.GetEntryCount() == 3, "the damaged entry is dropped on write");
+            context.Check(!FindsBlob(cache, keys.base, ShaderCacheBlobType::ShaderBinary, blobA), "the dropped entry stays a miss");
+        }
+
+        // A damaged table or a truncated file discards the file
+        file = ReadBytes(path);
+        file[c_HeaderSize + 8] ^= 0x01;
+        WriteBytes(path, file);
+
+        {
+            ShaderPermutationCache cache;
+            context.Check(!cache.Open(path) && !cache.GetError().empty() && cache.GetEntryCount() == 0, "a damaged table discards the file");
+            cache.Store(keys.base, ShaderCacheBlobType::ShaderBinary, blobA.data(), blobA.size());
+            context.Check(cache.Write(), "a discarded file is replaced");
+        }
+
+        file = ReadBytes(path);
+        file.resize(file.size() - 10);
+        WriteBytes(path, file);
+
+        {
+            ShaderPermutationCache cache;
+            context.Check(!cache.Open(path) && cache.GetEntryCount() == 0, "a truncated file is discarded");
+            context.Check(cache.IsDirty(), "a discarded file is rewritten on the next write");
+        }
+
+        file.resize(10);
+        WriteBytes(path, file);
+
+        {
+            ShaderPermutationCache cache;
+            context.Check(!cache.Open(path) && cache.GetEntryCount() == 0, "a file shorter than the header is discarded");
+        }
+    }
+
+    void TestEviction(TestContext& context, const std::filesystem::path& path)
+    {
+        const TestKeys keys;
+        const std::vector<uint8_t> blobA = MakeBlob(1000, 1);
+        const std::vector<uint8_t> blobB = MakeBlob(77, 2);
+        const std::vector<uint8_t> blobEmpty;
+
+        // Entries that weren't used for too many sessions
+        ShaderPermutationCacheSettings settings;
+        settings.maxUnusedSessions = 1;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+
+        {
+            ShaderPermutationCache cache;
+            cache.Open(path, settings);
+            cache.Store(keys.base, ShaderCacheBlobType::ShaderBinary, blobA.data(), blobA.size());
+            cache.Write();
+        }
+
+        {
+            ShaderPermutationCache cache;
+            cache.Open(path, settings);
+            cache.Store(keys.otherValue, ShaderCacheBlobType::ShaderBinary, blobB.data(), blobB.size());
+            cache.Write();
+            context.Check(cache.GetEntryCount() == 2 && cache.GetStats().evictedEntries == 0, "an entry from the previous session is kept");
+        }
+
+        {
+            ShaderPermutationCache cache;
+            cache.Open(path, settings);
+            cache.Store(keys.otherEntry, ShaderCacheBlobType::ShaderBinary, blobEmpty.data(), blobEmpty.size());
+            cache.Write();
+            context.Check(cache.GetEntryCount() == 2 && cache.GetStats().evictedEntries == 1, "an entry unused for too long is evicted");
+            context.Check(!FindsBlob(cache, keys.base, ShaderCacheBlobType::ShaderBinary, blobA)
+                && FindsBlob(cache, keys.otherValue, ShaderCacheBlobType::ShaderBinary, blobB), "the oldest entry is the one evicted");
+        }
+
+        // The size budget keeps the most recently used entries
+        settings.maxUnusedSessions = 8;
+        settings.maxDataSize = blobA.size() + blobB.size() / 2;
+        std::filesystem::remove(path, error);
+
+        {
+            ShaderPermutationCache cache;
+            cache.Open(path, settings);
+            cache.Store(keys.otherValue, ShaderCacheBlobType::ShaderBinary, blobB.data(), blobB.size());
+            cache.Write();
+        }
+
+        {
+            ShaderPermutationCache cache;
+            cache.Open(path, settings);
+            cache.Store(keys.base, ShaderCacheBlobType::ShaderBinary, blobA.data(), blobA.size());
+            cache.Write();
+            context.Check(cache.GetEntryCount() == 1 && cache.GetStats().evictedEntries == 1, "the size budget is enforced");
+            context.Check(FindsBlob(cache, keys.base, ShaderCacheBlobType::ShaderBinary, blobA), "the most recently used entry is kept");
+        }
+    }
+}
+
+void TestShaderPermutationCache(TestContext& context)
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "FullSampleTests.ShaderPermutationCache";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory, error);
+
+    const std::filesystem::path path = directory / "ShaderPermutations.cache";
+
+    TestKeyCanonicalization(context);
+    TestBinaryHash(context, directory);
+    TestRoundTrip(context, path);
+    TestCorruption(context, path);
+    TestEviction(context, path);
+
+    std::filesystem::remove_all(directory, error);
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "SkinnedBlasRefitPolicy.h"
+
+#include <cmath>
+
+namespace
+{
+    SkinnedBlasBounds MakeBounds(float minX, float maxX, float size = 1.f)
+    {
+        SkinnedBlasBounds bounds;
+        bounds.minimum[0] = minX;
+        bounds.maximum[0] = maxX;
+        bounds.maximum[1] = size;
+        bounds.maximum[2] = size;
+        return bounds;
+    }
+
+    void TestBoundsGrowth(TestContext& context)
+    {
+        const SkinnedBlasBounds unit = MakeBounds(0.f, 1.f);
+        context.Check(GetSkinnedBlasBoundsGrowth(unit, unit) == 0.f, "the same box doesn't grow");
+        context.Check(GetSkinnedBlasBoundsGrowth(unit, MakeBounds(0.25f, 0.75f, 0.5f)) == 0.f, "a box inside the reference doesn't grow");
+
+        // A unit cube stretched to 2 x 1 x 1 goes from an area of 6 to 10
+        const float growth = GetSkinnedBlasBoundsGrowth(unit, MakeBounds(1.f, 2.f));
+        context.Check(std::abs(growth - 4.f / 6.f) < 1e-6f, "a box that moved away grows the merged area");
+        context.Check(GetSkinnedBlasBoundsGrowth(MakeBounds(1.f, 2.f), unit) == growth, "the growth is symmetric for moved boxes");
+
+        const SkinnedBlasBounds flat = MakeBounds(0.f, 0.f, 0.f);
+        context.Check(GetSkinnedBlasBoundsGrowth(flat, flat) == 0.f, "an empty box doesn't grow");
+        context.Check(std::isinf(GetSkinnedBlasBoundsGrowth(flat, unit)), "growing from an empty box forces a rebuild");
+    }
+
+    void TestPolicy(TestContext& context)
+    {
+        SkinnedBlasRefitSettings settings;
+        settings.rebuildInterval = 4;
+        settings.maxBoundsGrowth = 0.25f;
+
+        SkinnedBlasRefitPolicy policy;
+        const SkinnedBlasBounds rest = MakeBounds(0.f, 1.f);
+        context.Check(policy.Update(rest, settings) == SkinnedBlasUpdate::Rebuild, "the first update builds the BLAS");
+
+        bool refits = true;
+        for (uint32_t frame = 0; frame < 4; frame++)
+            refits = policy.Update(rest, settings) == SkinnedBlasUpdate::Refit && refits;
+        context.Check(refits && policy.GetRefitsSinceRebuild() == 4, "a still pose is refit up to the interval");
+        context.Check(policy.Update(rest, settings) == SkinnedBlasUpdate::Rebuild, "the interval forces a rebuild");
+        context.Check(policy.GetRefitCount() == 4 && policy.GetRebuildCount() == 2, "the decisions are counted");
+
+        // 0.1 of a unit cube adds 0.4 / 6 to the area, 0.5 adds 2 / 6
+        context.Check(policy.Update(MakeBounds(0.f, 1.1f), settings) == SkinnedBlasUpdate::Refit, "a small motion is refit");
+        context.Check(std::abs(policy.GetBoundsGrowth() - 0.4f / 6.f) < 1e-6f, "the growth of the last refit is reported");
+        context.Check(policy.Update(MakeBounds(0.f, 1.5f), settings) == SkinnedBlasUpdate::Rebuild, "a large motion is rebuilt");
+        context.Check(policy.GetBoundsGrowth() == 0.f && policy.GetRefitsSinceRebuild() == 0, "a rebuild resets the growth");
+
+        // The growth is measured against the last rebuild, not the last refit, so a slow drift adds up
+        uint32_t framesUntilRebuild = 0;
+        for (float maxX = 1.5f; framesUntilRebuild < 4; framesUntilRebuild++)
+        {
+            maxX += 0.3f;
+            if (policy.Update(MakeBounds(0.f, maxX), settings) == SkinnedBlasUpdate::Rebuild)
+                break;
+        }
+        context.Check(framesUntilRebuild == 1, "a slow drift is rebuilt once it adds up");
+
+        policy.Invalidate();
+        context.Check(policy.Update(MakeBounds(0.f, 1.6f), settings) == SkinnedBlasUpdate::Rebuild, "invalidating forces a rebuild");
+
+        settings.enableRefit = false;
+        context.Check(policy.Update(MakeBounds(0.f, 1.6f), settings) == SkinnedBlasUpdate::Rebuild, "disabling refits rebuilds every frame");
+
+        settings.enableRefit = true;
+        settings.rebuildInterval = 0;
+        refits = true;
+        for (uint32_t frame = 0; frame < 100; frame++)
+            refits = policy.Update(MakeBounds(0.f, 1.6f), settings) == SkinnedBlasUpdate::Refit && refits;
+        context.Check(refits, "an interval of zero doesn't limit the refits");
+    }
+}
+
+void TestSkinnedBlasRefitPolicy(TestContext& context)
+{
+    TestBoundsGrowth(context);
+    TestPolicy(context);
+}
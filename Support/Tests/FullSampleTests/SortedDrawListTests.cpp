@@ -0,0 +1,239 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include "SortedDrawList.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+
+namespace
+{
+    DrawSortKeyFields MakeFields(uint32_t pipeline, bool alphaTested, uint32_t material, uint32_t depthBucket)
+    {
+        DrawSortKeyFields fields;
+        fields.pipeline = pipeline;
+        fields.alphaTested = alphaTested;
+        fields.material = material;
+        fields.depthBucket = depthBucket;
+        return fields;
+    }
+
+    bool IsSameFields(const DrawSortKeyFields& a, const DrawSortKeyFields& b)
+    {
+        return a.pipeline == b.pipeline && a.alphaTested == b.alphaTested && a.material == b.material && a.depthBucket == b.depthBucket;
+    }
+
+    // Keys with few distinct values in every field, so that there are many equal keys
+    std::vector<uint64_t> MakeKeys(std::mt19937& random, uint32_t count)
+    {
+        std::vector<uint64_t> keys(count);
+        for (uint64_t& key : keys)
+            key = PackDrawSortKey(MakeFields(random() % 3, random() % 4 == 0, random() % 50, random() % 200));
+        return keys;
+    }
+
+    // The draws are a permutation of all draws, and the sorted keys are the keys of the draws in ascending order
+    bool IsSortedList(const SortedDrawList& list)
+    {
+        const std::vector<uint32_t>& draws = list.GetSortedDraws();
+        const std::vector<uint64_t>& keys = list.GetSortedKeys();
+        if (draws.size() != list.GetDrawCount() || keys.size() != list.GetDrawCount())
+            return false;
+
+        std::vector<uint8_t> seen(draws.size(), 0);
+        for (size_t index = 0; index < draws.size(); index++)
+        {
+            if (draws[index] >= draws.size() || seen[draws[index]] || keys[index] != list.GetKey(draws[index]))
+                return false;
+            seen[draws[index]] = 1;
+        }
+        return std::is_sorted(keys.begin(), keys.end());
+    }
+
+    void TestKeys(TestContext& context)
+    {
+        const DrawSortKeyFields fields = MakeFields(0xab, true, 0x7fffff, 0xffff);
+        context.Check(IsSameFields(UnpackDrawSortKey(PackDrawSortKey(fields)), fields), "a key unpacks to its fields");
+
+        std::mt19937 random(31);
+        bool roundTrip = true;
+        for (uint32_t attempt = 0; attempt < 1000; attempt++)
+        {
+            const DrawSortKeyFields randomFields = MakeFields(random() & 0xff, random() & 1, random() & 0x7fffff, random() & 0xffff);
+            roundTrip = roundTrip && IsSameFields(UnpackDrawSortKey(PackDrawSortKey(randomFields)), randomFields);
+        }
+        context.Check(roundTrip, "random fields survive packing");
+
+        // A field that is too wide must not spill into the more significant ones
+        const DrawSortKeyFields wide = UnpackDrawSortKey(PackDrawSortKey(MakeFields(1, false, 0x800001, 0x10002)));
+        context.Check(IsSameFields(wide, MakeFields(1, false, 1, 2)), "values that are too wide are truncated to their field");
+
+        // The fields are ordered from the most expensive state change to the least expensive one
+        const uint64_t base = PackDrawSortKey(MakeFields(1, false, 1, 1));
+        context.Check(PackDrawSortKey(MakeFields(0, true, 0x7fffff, 0xffff)) < base, "the pipeline is the most significant field");
+        context.Check(PackDrawSortKey(MakeFields(1, false, 0x7fffff, 0xffff)) < PackDrawSortKey(MakeFields(1, true, 0, 0)),
+            "opaque draws go before alpha-tested draws");
+        context.Check(PackDrawSortKey(MakeFields(1, false, 0, 0xffff)) < base, "the material is more significant than the depth");
+        context.Check(PackDrawSortKey(MakeFields(1, false, 1, 0)) < base, "nearer draws go first");
+
+        context.Check(IsSameDrawPipeline(base, PackDrawSortKey(MakeFields(1, false, 7, 9))), "keys with other materials share the pipeline");
+        context.Check(!IsSameDrawPipeline(base, PackDrawSortKey(MakeFields(1, true, 1, 1))), "the alpha-tested flag changes the pipeline");
+        context.Check(IsSameDrawMaterial(base, PackDrawSortKey(MakeFields(2, true, 1, 9))), "the material is compared on its own");
+        context.Check(!IsSameDrawMaterial(base, PackDrawSortKey(MakeFields(1, false, 2, 1))), "other materials are different");
+    }
+
+    void TestDepthBuckets(TestContext& context)
+    {
+        context.Check(GetDrawDepthBucket(0.f) == 0 && GetDrawDepthBucket(-5.f) == 0 && GetDrawDepthBucket(NAN) == 0,
+            "depths behind the camera and NaN go to the first bucket");
+        context.Check(GetDrawDepthBucket(INFINITY) == 0xffff, "an infinite depth goes to the last bucket");
+
+        bool monotonic = true;
+        uint32_t previous = 0;
+        for (float depth = 0.01f; depth < 1e6f; depth *= 1.01f)
+        {
+            const uint32_t bucket = GetDrawDepthBucket(depth);
+            monotonic = monotonic && bucket >= previous;
+            previous = bucket;
+        }
+        context.Check(monotonic, "the buckets grow with the depth");
+
+        // The buckets are logarithmic, so a small move changes the bucket of a near draw but not of a far one
+        context.Check(GetDrawDepthBucket(1000.f) == GetDrawDepthBucket(1001.f), "far buckets are coarse");
+        context.Check(GetDrawDepthBucket(1.f) != GetDrawDepthBucket(1.5f), "near buckets are fine");
+    }
+
+    void TestRadixSort(TestContext& context)
+    {
+        std::mt19937 random(37);
+        std::vector<uint64_t> scratchKeys;
+        std::vector<uint32_t> scratchValues;
+
+        for (uint32_t count : { 0u, 1u, 2u, 1000u, 70000u })
+        {
+            std::vector<uint64_t> keys = MakeKeys(random, count);
+            std::vector<uint32_t> values(count);
+            std::iota(values.begin(), values.end(), 0u);
+
+            std::vector<std::pair<uint64_t, uint32_t>> expected(count);
+            for (uint32_t index = 0; index < count; index++)
+                expected[index] = { keys[index], values[index] };
+            std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            RadixSortDrawKeys(keys, values, scratchKeys, scratchValues);
+
+            bool matches = keys.size() == count && values.size() == count;
+            for (uint32_t index = 0; index < count && matches; index++)
+                matches = keys[index] == expected[index].first && values[index] == expected[index].second;
+            context.Check(matches, "the radix sort is a stable sort");
+        }
+
+        // Keys that only differ in the highest digit, all other digits are skipped
+        std::vector<uint64_t> keys = { 3ull << 56, 1ull << 56, 2ull << 56, 1ull << 56 };
+        std::vector<uint32_t> values = { 0, 1, 2, 3 };
+        RadixSortDrawKeys(keys, values, scratchKeys, scratchValues);
+        context.Check(keys[0] == 1ull << 56 && keys[3] == 3ull << 56 && values[0] == 1 && values[1] == 3 && values[2] == 2,
+            "keys that only differ in one digit are sorted");
+    }
+
+    void TestSortedList(TestContext& context)
+    {
+        std::mt19937 random(41);
+        const uint32_t drawCount = 5000;
+        std::vector<uint64_t> keys = MakeKeys(random, drawCount);
+
+        SortedDrawList list;
+        list.Build(keys);
+        context.Check(IsSortedList(list) && list.GetLastSortedCount() == drawCount && list.GetFullSortCount() == 1,
+            "building sorts all draws");
+
+        bool sorted = true;
+        for (uint32_t frame = 0; frame < 20; frame++)
+        {
+            // The same draw may change more than once in a frame
+            for (uint32_t change = 0; change < 50; change++)
+                list.SetKey(random() % drawCount, MakeKeys(random, 1)[0]);
+            list.Sort();
+            sorted = sorted && IsSortedList(list);
+        }
+        context.Check(sorted, "the incremental sort keeps the draws in key order");
+        context.Check(list.GetIncrementalSortCount() == 20 && list.GetFullSortCount() == 1, "a few changes are merged");
+        context.Check(list.GetLastSortedCount() > 0 && list.GetLastSortedCount() <= 50, "only the changed draws are sorted");
+
+        list.SetKey(7, list.GetKey(7));
+        list.Sort();
+        context.Check(list.GetLastSortedCount() == 0 && IsSortedList(list), "setting the same key changes nothing");
+
+        // Moving draws to the very front and back of the order
+        list.SetKey(1, 0);
+        list.SetKey(2, ~0ull);
+        list.Sort();
+        context.Check(IsSortedList(list) && list.GetSortedDraws().front() == 1 && list.GetSortedDraws().back() == 2,
+            "changed draws are merged at both ends");
+
+        for (uint32_t draw = 0; draw < drawCount; draw += 3)
+            list.SetKey(draw, MakeKeys(random, 1)[0] + 1);
+        for (uint32_t draw = 1; draw < drawCount; draw += 3)
+            list.SetKey(draw, MakeKeys(random, 1)[0] + 1);
+        list.Sort();
+        context.Check(IsSortedList(list) && list.GetFullSortCount() == 2, "most draws changing sorts all of them");
+
+        SortedDrawList empty;
+        empty.Build({});
+        empty.Sort();
+        context.Check(empty.GetDrawCount() == 0 && empty.GetSortedDraws().empty(), "an empty list stays empty");
+    }
+
+    void TestStateCounter(TestContext& context)
+    {
+        const uint64_t a1 = PackDrawSortKey(MakeFields(0, false, 1, 5));
+        const uint64_t a2 = PackDrawSortKey(MakeFields(0, false, 1, 9));
+        const uint64_t b1 = PackDrawSortKey(MakeFields(0, false, 2, 5));
+        const uint64_t c1 = PackDrawSortKey(MakeFields(0, true, 2, 5));
+
+        DrawStateCounter counter;
+        for (uint64_t key : { a1, b1, a2, c1 })
+            counter.AddDraw(key);
+        const DrawStateStatistics unsorted = counter.GetStatistics();
+        context.Check(unsorted.draws == 4 && unsorted.pipelineChanges == 2 && unsorted.materialChanges == 4,
+            "the state changes of an unsorted sequence are counted");
+
+        DrawStateCounter sortedCounter;
+        for (uint64_t key : { a1, a2, b1, c1 })
+            sortedCounter.AddDraw(key);
+        const DrawStateStatistics sorted = sortedCounter.GetStatistics();
+        context.Check(sorted.materialChanges == 2 && sorted.GetRedundantMaterialBinds() == 2 && sorted.GetRedundantPipelineBinds() == 2,
+            "sorting turns material binds into redundant ones");
+    }
+}
+
+void TestSortedDrawList(TestContext& context)
+{
+    TestKeys(context);
+    TestDepthBuckets(context);
+    TestRadixSort(context);
+    TestSortedList(context);
+    TestStateCounter(context);
+}
+
+void RunDrawSortingBenchmark()
+{
+    for (uint32_t drawCount : { 10'000u, 100'000u, 1'000'000u })
+    {
+        const DrawSortingBenchmarkResult result = BenchmarkDrawSorting(drawCount, 10);
+        printf("Draw sorting, %u draws: key packing %.3f ms, radix sort %.3f ms, std::stable_sort %.3f ms, incremental 1%% %.3f ms\n",
+            result.drawCount, result.packMs, result.radixSortMs, result.stdSortMs, result.incrementalSortMs);
+    }
+}
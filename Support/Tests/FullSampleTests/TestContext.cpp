@@ -0,0 +1,61 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#include "TestContext.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <utility>
+#include <vector>
+
+TestContext::TestContext(std::string suite)
+    : m_suite(std::move(suite))
+{
+}
+
+void TestContext::Check(bool condition, const char* description)
+{
+    m_checks++;
+    if (condition)
+        return;
+
+    m_failures++;
+    fprintf(stderr, "%s: FAILED: %s\n", m_suite.c_str(), description);
+}
+
+void RunParallelTasks(size_t taskCount, const std::function<void(size_t task)>& task)
+{
+    std::atomic<size_t> nextTask = 0;
+    auto worker = [&nextTask, &task, taskCount]()
+    {
+        for (size_t index = nextTask++; index < taskCount; index = nextTask++)
+            task(index);
+    };
+
+    const size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), taskCount);
+    std::vector<std::thread> threads;
+    for (size_t thread = 1; thread < threadCount; thread++)
+        threads.emplace_back(worker);
+
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void LaunchParallelTasks(size_t taskCount, std::function<void(size_t task)> task, std::function<void()> done)
+{
+    std::thread([taskCount, task = std::move(task), done = std::move(done)]()
+    {
+        RunParallelTasks(taskCount, task);
+        done();
+    }).detach();
+}
@@ -0,0 +1,43 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Checks of one test suite. A failed check is reported when it happens, and the remaining checks
+// of the suite still run, so one run shows every failure.
+class TestContext
+{
+public:
+    explicit TestContext(std::string suite);
+
+    void Check(bool condition, const char* description);
+
+    [[nodiscard]] const std::string& GetSuite() const { return m_suite; }
+    [[nodiscard]] uint32_t GetCheckCount() const { return m_checks; }
+    [[nodiscard]] uint32_t GetFailureCount() const { return m_failures; }
+
+private:
+    std::string m_suite;
+    uint32_t m_checks = 0;
+    uint32_t m_failures = 0;
+};
+
+// Calls task(0) ... task(taskCount - 1) on all hardware threads and returns when all of them are done.
+// Stands in for the thread pool of the application in the modules that take their parallelism from the caller.
+void RunParallelTasks(size_t taskCount, const std::function<void(size_t task)>& task);
+
+// Starts task(0) ... task(taskCount - 1) on a background thread, in parallel with RunParallelTasks, and calls
+// done there once all of them are finished. Returns right away.
+void LaunchParallelTasks(size_t taskCount, std::function<void(size_t task)> task, std::function<void()> done);
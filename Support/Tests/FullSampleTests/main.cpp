@@ -0,0 +1,158 @@
+/***************************************************************************
+ # Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ #
+ # NVIDIA CORPORATION and its licensors retain all intellectual property
+ # and proprietary rights in and to this software, related documentation
+ # and any modifications thereto.  Any use, reproduction, disclosure or
+ # distribution of this software and related documentation without an express
+ # license agreement from NVIDIA CORPORATION is strictly prohibited.
+ **************************************************************************/
+
+// CPU tests of the FullSample modules that don't depend on the renderer.
+//
+// Usage: FullSampleTests [suite...]
+// Runs the named suites, or all of them. The exit code is the number of failed suites.
+//
+// Usage: FullSampleTests -benchmark <name>
+// Measures the throughput of a module on synthetic data and prints the timings.
+
+#include "TestContext.h"
+
+#include <cstdio>
+#include <cstring>
+
+void TestAllocationTracker(TestContext& context);
+void TestAnimationEvaluator(TestContext& context);
+void TestAsyncComputeSchedule(TestContext& context);
+void TestAsyncPipelineSet(TestContext& context);
+void TestBindingSetCache(TestContext& context);
+void TestBlasBuildPlanner(TestContext& context);
+void TestFrameRecording(TestContext& context);
+void TestFrameTimeController(TestContext& context);
+void TestGBufferDrawCulling(TestContext& context);
+void TestParallelRecording(TestContext& context);
+void TestParameterSweep(TestContext& context);
+void TestPipelineJobList(TestContext& context);
+void TestRayCountHeatmap(TestContext& context);
+void TestRenderGraph(TestContext& context);
+void TestResamplingSpecialization(TestContext& context);
+void TestSceneCache(TestContext& context);
+void TestSceneInstanceBvh(TestContext& context);
+void TestShaderConfig(TestContext& context);
+void TestShaderDependencyGraph(TestContext& context);
+void TestShaderPermutationCache(TestContext& context);
+void TestSkinnedBlasRefitPolicy(TestContext& context);
+void TestSortedDrawList(TestContext& context);
+
+void RunAnimationBenchmark();
+void RunDrawSortingBenchmark();
+void RunInstanceCullingBenchmark();
+void RunPipelineCreationBenchmark();
+
+namespace
+{
+    struct TestSuite
+    {
+        const char* name;
+        void (*run)(TestContext& context);
+    };
+
+    const TestSuite g_TestSuites[] = {
+        { "AllocationTracker", TestAllocationTracker },
+        { "AnimationEvaluator", TestAnimationEvaluator },
+        { "AsyncComputeSchedule", TestAsyncComputeSchedule },
+        { "AsyncPipelineSet", TestAsyncPipelineSet },
+        { "BindingSetCache", TestBindingSetCache },
+        { "BlasBuildPlanner", TestBlasBuildPlanner },
+        { "FrameRecording", TestFrameRecording },
+        { "FrameTimeController", TestFrameTimeController },
+        { "GBufferDrawCulling", TestGBufferDrawCulling },
+        { "ParallelRecording", TestParallelRecording },
+        { "ParameterSweep", TestParameterSweep },
+        { "PipelineJobList", TestPipelineJobList },
+        { "RayCountHeatmap", TestRayCountHeatmap },
+        { "RenderGraph", TestRenderGraph },
+        { "ResamplingSpecialization", TestResamplingSpecialization },
+        { "SceneCache", TestSceneCache },
+        { "SceneInstanceBvh", TestSceneInstanceBvh },
+        { "ShaderConfig", TestShaderConfig },
+        { "ShaderDependencyGraph", TestShaderDependencyGraph },
+        { "ShaderPermutationCache", TestShaderPermutationCache },
+        { "SkinnedBlasRefitPolicy", TestSkinnedBlasRefitPolicy },
+        { "SortedDrawList", TestSortedDrawList },
+    };
+
+    struct Benchmark
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const Benchmark g_Benchmarks[] = {
+        { "Animation", RunAnimationBenchmark },
+        { "DrawSorting", RunDrawSortingBenchmark },
+        { "InstanceCulling", RunInstanceCullingBenchmark },
+        { "PipelineCreation", RunPipelineCreationBenchmark },
+    };
+
+    const TestSuite* FindTestSuite(const char* name)
+    {
+        for (const TestSuite& suite : g_TestSuites)
+        {
+            if (strcmp(suite.name, name) == 0)
+                return &suite;
+        }
+        return nullptr;
+    }
+
+    bool RunTestSuite(const TestSuite& suite)
+    {
+        TestContext context(suite.name);
+        suite.run(context);
+
+        printf("%s: %u checks, %u failed\n", suite.name, context.GetCheckCount(), context.GetFailureCount());
+        return context.GetFailureCount() == 0 && context.GetCheckCount() != 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && strcmp(argv[1], "-benchmark") == 0)
+    {
+        for (const Benchmark& benchmark : g_Benchmarks)
+        {
+            if (strcmp(benchmark.name, argv[2]) == 0)
+            {
+                benchmark.run();
+                return 0;
+            }
+        }
+
+        fprintf(stderr, "Unknown benchmark '%s'\n", argv[2]);
+        return 1;
+    }
+
+    int failedSuites = 0;
+
+    if (argc <= 1)
+    {
+        for (const TestSuite& suite : g_TestSuites)
+            failedSuites += RunTestSuite(suite) ? 0 : 1;
+        return failedSuites;
+    }
+
+    for (int index = 1; index < argc; index++)
+    {
+        const TestSuite* suite = FindTestSuite(argv[index]);
+        if (!suite)
+        {
+            fprintf(stderr, "Unknown test suite '%s'\n", argv[index]);
+            failedSuites++;
+            continue;
+        }
+
+        failedSuites += RunTestSuite(*suite) ? 0 : 1;
+    }
+
+    return failedSuites;
+}